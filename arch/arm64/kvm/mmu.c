@@ -951,6 +951,23 @@ void kvm_arch_mmu_enable_log_dirty_pt_masked(struct kvm *kvm,
 	kvm_mmu_write_protect_pt_masked(kvm, slot, gfn_offset, mask);
 }
 
+/*
+ * kvm_arch_mmu_enable_log_dirty_pt_range - enable dirty logging for a run of
+ * dirty pages.
+ *
+ * Write protects [gfn_offset, gfn_offset + npages) of @slot, block mappings
+ * included, in a single walk of the stage-2 page tables.
+ */
+void kvm_arch_mmu_enable_log_dirty_pt_range(struct kvm *kvm,
+		struct kvm_memory_slot *slot,
+		gfn_t gfn_offset, u64 npages)
+{
+	phys_addr_t start = (slot->base_gfn + gfn_offset) << PAGE_SHIFT;
+	phys_addr_t end = start + (npages << PAGE_SHIFT);
+
+	stage2_wp_range(&kvm->arch.mmu, start, end);
+}
+
 static void kvm_send_hwpoison_signal(unsigned long address, short lsb)
 {
 	send_sig_mceerr(BUS_MCEERR_AR, (void __user *)address, lsb, current);
@@ -12,6 +12,7 @@
 
 #define KVM_PIO_PAGE_OFFSET 1
 #define KVM_COALESCED_MMIO_PAGE_OFFSET 2
+#define KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET 3
 #define KVM_DIRTY_LOG_PAGE_OFFSET 64
 
 #define DE_VECTOR 0
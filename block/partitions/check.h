@@ -28,6 +28,8 @@ typedef struct {
 } Sector;
 
 void *read_part_sector(struct parsed_partitions *state, sector_t n, Sector *p);
+void read_part_sectors_ahead(struct parsed_partitions *state, sector_t n,
+		sector_t nr_sects);
 static inline void put_dev_sector(Sector p)
 {
 	folio_put(p.v);
@@ -729,3 +729,30 @@ void *read_part_sector(struct parsed_partitions *state, sector_t n, Sector *p)
 	p->v = NULL;
 	return NULL;
 }
+
+/*
+ * Start reading a range of sectors into the page cache, so that the
+ * read_part_sector() calls that follow find them there instead of waiting
+ * for one synchronous read per page.
+ */
+void read_part_sectors_ahead(struct parsed_partitions *state, sector_t n,
+		sector_t nr_sects)
+{
+	struct address_space *mapping = state->disk->part0->bd_inode->i_mapping;
+	sector_t capacity = get_capacity(state->disk);
+	struct file_ra_state ra;
+	pgoff_t first, last;
+
+	if (!nr_sects || n >= capacity)
+		return;
+	nr_sects = min(nr_sects, capacity - n);
+
+	first = n >> PAGE_SECTORS_SHIFT;
+	last = (n + nr_sects - 1) >> PAGE_SECTORS_SHIFT;
+	if (first == last)
+		return;
+
+	file_ra_state_init(&ra, mapping);
+	ra.ra_pages = max_t(unsigned int, ra.ra_pages, last - first + 1);
+	page_cache_sync_readahead(mapping, &ra, NULL, first, last - first + 1);
+}
@@ -242,6 +242,9 @@ static size_t read_lba(struct parsed_partitions *state,
 	if (!buffer || lba > last_lba(state->disk))
                 return 0;
 
+	/* Read the whole range (e.g. the partition entry array) in one go */
+	read_part_sectors_ahead(state, n, DIV_ROUND_UP(count, 512));
+
 	while (count) {
 		int copied = 512;
 		Sector sect;
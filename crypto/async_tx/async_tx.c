@@ -209,6 +209,60 @@ async_tx_submit(struct dma_chan *chan, struct dma_async_tx_descriptor *tx,
 }
 EXPORT_SYMBOL_GPL(async_tx_submit);
 
+/**
+ * async_tx_batch_add - account an operation to a batch
+ * @batch: batch the operation was prepared for by init_async_submit_batch()
+ * @tx: descriptor returned by the async_* call, NULL if it ran synchronously
+ *
+ * The descriptor becomes the dependency of the next operation of the batch
+ * and its channel is remembered to be kicked by async_tx_batch_issue().
+ */
+void async_tx_batch_add(struct async_tx_batch *batch,
+			struct dma_async_tx_descriptor *tx)
+{
+	int i;
+
+	batch->nr_ops++;
+	batch->tail = tx;
+	if (!tx)
+		return;
+
+	batch->nr_offload++;
+	for (i = 0; i < batch->nr_chans; i++)
+		if (batch->chan[i] == tx->chan)
+			return;
+
+	/* out of slots, kick the oldest channel now and reuse its slot */
+	if (batch->nr_chans == ASYNC_TX_BATCH_CHANS) {
+		dma_async_issue_pending(batch->chan[0]);
+		memmove(&batch->chan[0], &batch->chan[1],
+			sizeof(batch->chan[0]) * (ASYNC_TX_BATCH_CHANS - 1));
+		batch->nr_chans--;
+	}
+	batch->chan[batch->nr_chans++] = tx->chan;
+}
+EXPORT_SYMBOL_GPL(async_tx_batch_add);
+
+/**
+ * async_tx_batch_issue - send the descriptors of a batch to the hardware
+ * @batch: batch to issue
+ *
+ * Returns the last descriptor of the batch, which the caller may depend on
+ * or quiesce like the result of any other async_* call.  The batch can be
+ * reused afterwards, further operations are chained on that descriptor.
+ */
+struct dma_async_tx_descriptor *async_tx_batch_issue(struct async_tx_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->nr_chans; i++)
+		dma_async_issue_pending(batch->chan[i]);
+	batch->nr_chans = 0;
+
+	return batch->tail;
+}
+EXPORT_SYMBOL_GPL(async_tx_batch_issue);
+
 /**
  * async_trigger_callback - schedules the callback function to be run
  * @submit: submission and completion parameters
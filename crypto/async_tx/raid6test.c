@@ -16,6 +16,11 @@
 #define pr(fmt, args...) pr_info("raid6test: " fmt, ##args)
 
 #define NDISKS 64 /* Including P and Q */
+#define BATCH_OPS 16 /* syndromes issued at once in batched throughput mode */
+
+static unsigned int throughput_ms;
+module_param(throughput_ms, uint, 0444);
+MODULE_PARM_DESC(throughput_ms, "Also measure gen_syndrome() throughput for this many ms per mode (default 0: off)");
 
 static struct page *dataptrs[NDISKS];
 unsigned int dataoffs[NDISKS];
@@ -124,6 +129,60 @@ static void raid6_dual_recov(int disks, size_t bytes, int faila, int failb,
 		   __func__, faila, failb, result);
 }
 
+/* Generate syndromes for throughput_ms, issuing nr operations at a time */
+static unsigned long gen_throughput(int disks, int nr)
+{
+	unsigned long end = jiffies + msecs_to_jiffies(throughput_ms);
+	struct dma_async_tx_descriptor *tx;
+	struct async_submit_ctl submit;
+	struct async_tx_batch batch;
+	struct completion cmp;
+	unsigned long ops = 0;
+	int i;
+
+	while (time_before(jiffies, end)) {
+		init_completion(&cmp);
+		async_tx_batch_init(&batch);
+		for (i = 0; i < nr; i++) {
+			bool last = i == nr - 1;
+
+			init_async_submit_batch(&submit, &batch,
+						last ? ASYNC_TX_ACK : 0,
+						last ? callback : NULL, &cmp,
+						addr_conv);
+			tx = async_gen_syndrome(dataptrs, dataoffs, disks,
+						PAGE_SIZE, &submit);
+			async_tx_batch_add(&batch, tx);
+		}
+		async_tx_batch_issue(&batch);
+
+		if (wait_for_completion_timeout(&cmp, msecs_to_jiffies(3000)) == 0) {
+			pr("error: gen_syndrome(%d) throughput batch timed out\n",
+			   disks);
+			return 0;
+		}
+		ops += nr;
+		cond_resched();
+	}
+
+	/* MB/s of data disks */
+	return div_u64((u64)ops * (disks - 2) * PAGE_SIZE * MSEC_PER_SEC,
+		       throughput_ms) >> 20;
+}
+
+static void test_throughput(int disks)
+{
+	unsigned long single, batched;
+
+	makedata(disks);
+
+	single = gen_throughput(disks, 1);
+	batched = gen_throughput(disks, BATCH_OPS);
+
+	pr("gen_syndrome(%d disks): %lu MB/s issued one by one, %lu MB/s issued %d at a time\n",
+	   disks, single, batched, BATCH_OPS);
+}
+
 static int test_disks(int i, int j, int disks)
 {
 	int erra, errb;
@@ -230,6 +289,11 @@ static int __init raid6_test(void)
 	pr("complete (%d tests, %d failure%s)\n",
 	   tests, err, err == 1 ? "" : "s");
 
+	if (throughput_ms) {
+		test_throughput(12);
+		test_throughput(NDISKS);
+	}
+
 	for (i = 0; i < NDISKS+3; i++)
 		put_page(data[i]);
 
@@ -23,6 +23,7 @@
 #include <linux/uaccess.h>
 #include <linux/highmem.h>
 #include <linux/sizes.h>
+#include <linux/ktime.h>
 #include "binder_alloc.h"
 #include "binder_trace.h"
 
@@ -365,6 +366,67 @@ static bool debug_low_async_space_locked(struct binder_alloc *alloc, int pid)
 	return false;
 }
 
+/*
+ * Take a cached small buffer that can hold @size bytes. The buffer is
+ * moved back to allocated_buffers; the caller fills in the rest.
+ */
+static struct binder_buffer *binder_alloc_cache_get(struct binder_alloc *alloc,
+						    size_t size)
+{
+	struct binder_buffer *buffer;
+	size_t buffer_size;
+	int i;
+
+	for (i = 0; i < BINDER_ALLOC_CACHE_SLOTS; i++) {
+		buffer = alloc->cached_buffers[i];
+		if (!buffer)
+			continue;
+
+		buffer_size = binder_alloc_buffer_size(alloc, buffer);
+		if (buffer_size < size || alloc->free_async_space < buffer_size)
+			continue;
+
+		alloc->cached_buffers[i] = NULL;
+		buffer->allow_user_free = 0;
+		binder_insert_allocated_buffer_locked(alloc, buffer);
+		return buffer;
+	}
+
+	return NULL;
+}
+
+/*
+ * Keep a freed small async buffer aside instead of merging it back
+ * into free_buffers. Its pages stay mapped and off the lru, so reuse
+ * needs neither the best-fit search nor binder_update_page_range().
+ * A cached buffer stays !free, which keeps its neighbours from merging
+ * into it and its size fixed.
+ */
+static bool binder_alloc_cache_put(struct binder_alloc *alloc,
+				   struct binder_buffer *buffer,
+				   size_t buffer_size)
+{
+	int i;
+
+	if (!buffer->async_transaction ||
+	    buffer_size > BINDER_ALLOC_CACHE_MAX_SIZE ||
+	    !binder_alloc_get_vma(alloc))
+		return false;
+
+	for (i = 0; i < BINDER_ALLOC_CACHE_SLOTS; i++) {
+		if (alloc->cached_buffers[i])
+			continue;
+
+		rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
+		/* free_async_space was already credited by the caller */
+		buffer->async_transaction = 0;
+		alloc->cached_buffers[i] = buffer;
+		return true;
+	}
+
+	return false;
+}
+
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
 				size_t data_size,
@@ -417,6 +479,20 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		return ERR_PTR(-ENOSPC);
 	}
 
+	if (is_async && size <= BINDER_ALLOC_CACHE_MAX_SIZE) {
+		buffer = binder_alloc_cache_get(alloc, size);
+		if (buffer) {
+			alloc->cache_hits++;
+			/* Account the whole slot, as binder_free_buf_locked() will */
+			size = binder_alloc_buffer_size(alloc, buffer);
+			binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+				     "%d: binder_alloc_buf size %zd got cached %pK\n",
+				      alloc->pid, size, buffer);
+			goto init_buffer;
+		}
+		alloc->cache_misses++;
+	}
+
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -511,6 +587,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
 		     "%d: binder_alloc_buf size %zd got %pK\n",
 		      alloc->pid, size, buffer);
+init_buffer:
 	buffer->data_size = data_size;
 	buffer->offsets_size = offsets_size;
 	buffer->async_transaction = is_async;
@@ -566,11 +643,23 @@ struct binder_buffer *binder_alloc_new_buf(struct binder_alloc *alloc,
 					   int pid)
 {
 	struct binder_buffer *buffer;
+	size_t cache_hits;
+	u64 start = 0;
+
+	if (trace_binder_alloc_new_buf_latency_enabled())
+		start = ktime_get_ns();
 
 	mutex_lock(&alloc->mutex);
+	cache_hits = alloc->cache_hits;
 	buffer = binder_alloc_new_buf_locked(alloc, data_size, offsets_size,
 					     extra_buffers_size, is_async, pid);
+	cache_hits = alloc->cache_hits - cache_hits;
 	mutex_unlock(&alloc->mutex);
+
+	if (start)
+		trace_binder_alloc_new_buf_latency(alloc, data_size, is_async,
+						   cache_hits,
+						   ktime_get_ns() - start);
 	return buffer;
 }
 
@@ -662,6 +751,9 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 			      alloc->pid, size, alloc->free_async_space);
 	}
 
+	if (binder_alloc_cache_put(alloc, buffer, buffer_size))
+		return;
+
 	binder_update_page_range(alloc, 0,
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data),
 		(void __user *)(((uintptr_t)
@@ -806,11 +898,22 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 	struct rb_node *n;
 	int buffers, page_count;
 	struct binder_buffer *buffer;
+	int i;
 
 	buffers = 0;
 	mutex_lock(&alloc->mutex);
 	BUG_ON(alloc->vma);
 
+	/* Hand cached buffers back so they are freed with the rest */
+	for (i = 0; i < BINDER_ALLOC_CACHE_SLOTS; i++) {
+		buffer = alloc->cached_buffers[i];
+		if (!buffer)
+			continue;
+
+		alloc->cached_buffers[i] = NULL;
+		binder_insert_allocated_buffer_locked(alloc, buffer);
+	}
+
 	while ((n = rb_first(&alloc->allocated_buffers))) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 
@@ -910,6 +1013,7 @@ void binder_alloc_print_pages(struct seq_file *m,
 	int active = 0;
 	int lru = 0;
 	int free = 0;
+	int cached = 0;
 
 	mutex_lock(&alloc->mutex);
 	/*
@@ -927,9 +1031,14 @@ void binder_alloc_print_pages(struct seq_file *m,
 				lru++;
 		}
 	}
+	for (i = 0; i < BINDER_ALLOC_CACHE_SLOTS; i++)
+		if (alloc->cached_buffers[i])
+			cached++;
 	mutex_unlock(&alloc->mutex);
 	seq_printf(m, "  pages: %d:%d:%d\n", active, lru, free);
 	seq_printf(m, "  pages high watermark: %zu\n", alloc->pages_high);
+	seq_printf(m, "  buffer cache: %d cached, %zu hits, %zu misses\n",
+		   cached, alloc->cache_hits, alloc->cache_misses);
 }
 
 /**
@@ -18,6 +18,14 @@
 extern struct list_lru binder_alloc_lru;
 struct binder_transaction;
 
+/*
+ * Small buffers of one-way transactions are kept aside on free, pages
+ * still mapped, and handed straight to the next small one-way
+ * allocation without going through the free_buffers best-fit search.
+ */
+#define BINDER_ALLOC_CACHE_SLOTS	4
+#define BINDER_ALLOC_CACHE_MAX_SIZE	512
+
 /**
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
@@ -91,6 +99,10 @@ struct binder_lru_page {
  * @pages_high:         high watermark of offset in @pages
  * @oneway_spam_detected: %true if oneway spam detection fired, clear that
  * flag once the async buffer has returned to a healthy state
+ * @cached_buffers:     freed small async buffers ready for reuse
+ * @cache_hits:         async allocations served from @cached_buffers
+ * @cache_misses:       small async allocations that had to search
+ *                      @free_buffers
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -111,6 +123,9 @@ struct binder_alloc {
 	int pid;
 	size_t pages_high;
 	bool oneway_spam_detected;
+	struct binder_buffer *cached_buffers[BINDER_ALLOC_CACHE_SLOTS];
+	size_t cache_hits;
+	size_t cache_misses;
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
@@ -336,6 +336,29 @@ TRACE_EVENT(binder_update_page_range,
 		  __entry->offset, __entry->size)
 );
 
+TRACE_EVENT(binder_alloc_new_buf_latency,
+	TP_PROTO(struct binder_alloc *alloc, size_t data_size, bool is_async,
+		 bool cached, u64 latency_ns),
+	TP_ARGS(alloc, data_size, is_async, cached, latency_ns),
+	TP_STRUCT__entry(
+		__field(int, proc)
+		__field(size_t, data_size)
+		__field(bool, is_async)
+		__field(bool, cached)
+		__field(u64, latency_ns)
+	),
+	TP_fast_assign(
+		__entry->proc = alloc->pid;
+		__entry->data_size = data_size;
+		__entry->is_async = is_async;
+		__entry->cached = cached;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("proc=%d data_size=%zu is_async=%d cached=%d latency_ns=%llu",
+		  __entry->proc, __entry->data_size, __entry->is_async,
+		  __entry->cached, __entry->latency_ns)
+);
+
 DECLARE_EVENT_CLASS(binder_lru_page_class,
 	TP_PROTO(const struct binder_alloc *alloc, size_t page_index),
 	TP_ARGS(alloc, page_index),
@@ -2595,6 +2595,28 @@ void ahci_set_em_messages(struct ahci_host_priv *hpriv,
 }
 EXPORT_SYMBOL_GPL(ahci_set_em_messages);
 
+static void ahci_clear_irq_hint(void *data)
+{
+	irq_update_affinity_hint((unsigned long)data, NULL);
+}
+
+/*
+ * Spread the per-port vectors over the CPUs local to the controller, so
+ * that busy ports do not all complete on the same CPU. This is only an
+ * initial placement: the vectors are not managed, so they still follow
+ * CPU hotplug and user or irqbalance affinity settings.
+ */
+static void ahci_spread_port_irq(struct ata_host *host, int irq, int port)
+{
+	unsigned int cpu = cpumask_local_spread(port, dev_to_node(host->dev));
+
+	/* The hint must be gone before devres frees the irq */
+	if (devm_add_action(host->dev, ahci_clear_irq_hint,
+			    (void *)(unsigned long)irq))
+		return;
+	irq_set_affinity_and_hint(irq, cpumask_of(cpu));
+}
+
 static int ahci_host_activate_multi_irqs(struct ata_host *host,
 					 struct scsi_host_template *sht)
 {
@@ -2624,6 +2646,8 @@ static int ahci_host_activate_multi_irqs(struct ata_host *host,
 		if (rc)
 			return rc;
 		ata_port_desc(host->ports[i], "irq %d", irq);
+
+		ahci_spread_port_irq(host, irq, i);
 	}
 
 	return ata_host_register(host, sht);
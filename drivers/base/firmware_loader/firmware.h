@@ -73,6 +73,9 @@ struct fw_priv {
 	size_t allocated_size;
 	size_t offset;
 	u32 opt_flags;
+	/* on fw_linger_list, holding a reference, until linger_expires */
+	struct list_head linger_list;
+	unsigned long linger_expires;
 #ifdef CONFIG_FW_LOADER_PAGED_BUF
 	bool is_paged_buf;
 	struct page **pages;
@@ -142,6 +142,7 @@ static struct fw_priv *__allocate_fw_priv(const char *fw_name,
 	fw_priv->allocated_size = size;
 	fw_priv->offset = offset;
 	fw_priv->opt_flags = opt_flags;
+	INIT_LIST_HEAD(&fw_priv->linger_list);
 	fw_state_init(fw_priv);
 #ifdef CONFIG_FW_LOADER_USER_HELPER
 	INIT_LIST_HEAD(&fw_priv->pending_list);
@@ -229,6 +230,80 @@ void free_fw_priv(struct fw_priv *fw_priv)
 		spin_unlock(&fwc->lock);
 }
 
+/*
+ * Identical devices usually probe one after the other, each loading
+ * and releasing the same image.  Keep a loaded image referenced for
+ * linger_ms after its last request, so that later requests for the
+ * same name share it through alloc_lookup_fw_priv() instead of reading
+ * and decompressing it again.
+ */
+static unsigned int linger_ms;
+module_param(linger_ms, uint, 0644);
+MODULE_PARM_DESC(linger_ms,
+		 "Keep released firmware images for this many ms for reuse (0 disables)");
+
+static LIST_HEAD(fw_linger_list);	/* protected by fw_cache.lock */
+static void fw_linger_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(fw_linger_work, fw_linger_work_fn);
+
+static void fw_linger(struct fw_priv *fw_priv)
+{
+	struct firmware_cache *fwc = fw_priv->fwc;
+	unsigned int ms = READ_ONCE(linger_ms);
+
+	/* Only images in the shared lookup list can be found again */
+	if (!ms || fw_priv->allocated_size ||
+	    (fw_priv->opt_flags & (FW_OPT_NOCACHE | FW_OPT_PARTIAL)))
+		return;
+
+	spin_lock(&fwc->lock);
+	fw_priv->linger_expires = jiffies + msecs_to_jiffies(ms);
+	if (list_empty(&fw_priv->linger_list)) {
+		kref_get(&fw_priv->ref);
+		list_add_tail(&fw_priv->linger_list, &fw_linger_list);
+	} else {
+		list_move_tail(&fw_priv->linger_list, &fw_linger_list);
+	}
+	spin_unlock(&fwc->lock);
+
+	schedule_delayed_work(&fw_linger_work, msecs_to_jiffies(ms));
+}
+
+/* Drop the linger references that expired, or all of them */
+static void fw_linger_expire(bool all)
+{
+	struct firmware_cache *fwc = &fw_cache;
+	unsigned long next = 0;
+	struct fw_priv *fw_priv;
+
+restart:
+	spin_lock(&fwc->lock);
+	list_for_each_entry(fw_priv, &fw_linger_list, linger_list) {
+		if (!all && time_before(jiffies, fw_priv->linger_expires)) {
+			if (!next || time_before(fw_priv->linger_expires, next))
+				next = fw_priv->linger_expires;
+			continue;
+		}
+
+		list_del_init(&fw_priv->linger_list);
+		/* __free_fw_priv() drops the lock, so start over */
+		if (kref_put(&fw_priv->ref, __free_fw_priv))
+			goto restart;
+		spin_unlock(&fwc->lock);
+		goto restart;
+	}
+	spin_unlock(&fwc->lock);
+
+	if (next)
+		schedule_delayed_work(&fw_linger_work,
+				      max_t(long, next - jiffies, 1));
+}
+
+static void fw_linger_work_fn(struct work_struct *work)
+{
+	fw_linger_expire(false);
+}
+
 #ifdef CONFIG_FW_LOADER_PAGED_BUF
 bool fw_is_paged_buf(struct fw_priv *fw_priv)
 {
@@ -381,6 +456,72 @@ static int fw_decompress_xz_error(struct device *dev, enum xz_ret xz_ret)
 	return 0;
 }
 
+/* the most Blocks a stream may have to be decompressed in parallel */
+#define FW_XZ_MAX_BLOCKS	4096
+
+/*
+ * parallel decompression of a stream made of several blocks, e.g. by
+ * "xz -T", returns -ENOENT if the stream has to be decompressed serially
+ */
+static int fw_decompress_xz_blocks(struct device *dev, struct fw_priv *fw_priv,
+				   size_t in_size, const void *in_buffer)
+{
+	struct xz_block *blocks;
+	struct xz_index idx;
+	enum xz_ret xz_ret;
+	size_t pos = 0;
+	void *out_buf;
+	u32 i, nr;
+	int err;
+
+	if (xz_index_init(&idx, in_buffer, in_size) != XZ_OK ||
+	    idx.count < 2 || idx.count > FW_XZ_MAX_BLOCKS)
+		return -ENOENT;
+	if (fw_priv->allocated_size && idx.uncompressed > fw_priv->allocated_size)
+		return -ENOENT;
+
+	blocks = kvmalloc_array(idx.count, sizeof(*blocks), GFP_KERNEL);
+	if (!blocks)
+		return -ENOENT;
+
+	if (fw_priv->allocated_size)
+		out_buf = fw_priv->data;
+	else
+		out_buf = vmalloc(max_t(size_t, idx.uncompressed, 1));
+	if (!out_buf) {
+		kvfree(blocks);
+		return -ENOMEM;
+	}
+
+	for (nr = 0; xz_index_next(&idx, &blocks[nr]); nr++) {
+		blocks[nr].out = out_buf + pos;
+		pos += blocks[nr].out_size;
+	}
+
+	xz_ret = xz_dec_blocks(blocks, nr, idx.check_type, 0);
+	if (xz_ret == XZ_OK) {
+		xz_ret = XZ_STREAM_END;
+		for (i = 0; i < nr; i++) {
+			if (blocks[i].ret != XZ_STREAM_END) {
+				xz_ret = blocks[i].ret;
+				break;
+			}
+		}
+	}
+	kvfree(blocks);
+
+	err = fw_decompress_xz_error(dev, xz_ret);
+	if (err) {
+		if (!fw_priv->allocated_size)
+			vfree(out_buf);
+		return err;
+	}
+
+	fw_priv->data = out_buf;
+	fw_priv->size = pos;
+	return 0;
+}
+
 /* single-shot decompression onto the pre-allocated buffer */
 static int fw_decompress_xz_single(struct device *dev, struct fw_priv *fw_priv,
 				   size_t in_size, const void *in_buffer)
@@ -458,6 +599,13 @@ static int fw_decompress_xz_pages(struct device *dev, struct fw_priv *fw_priv,
 static int fw_decompress_xz(struct device *dev, struct fw_priv *fw_priv,
 			    size_t in_size, const void *in_buffer)
 {
+	int err;
+
+	/* streams made of several blocks can be decompressed in parallel */
+	err = fw_decompress_xz_blocks(dev, fw_priv, in_size, in_buffer);
+	if (err != -ENOENT)
+		return err;
+
 	/* if the buffer is pre-allocated, we can perform in single-shot mode */
 	if (fw_priv->data)
 		return fw_decompress_xz_single(dev, fw_priv, in_size, in_buffer);
@@ -716,6 +864,7 @@ int assign_fw(struct firmware *fw, struct device *device)
 
 	/* pass the pages buffer to driver at the last minute */
 	fw_set_page_data(fw_priv, fw);
+	fw_linger(fw_priv);
 	mutex_unlock(&fw_lock);
 	return 0;
 }
@@ -758,6 +907,7 @@ _request_firmware_prepare(struct firmware **firmware_p, const char *name,
 		ret = fw_state_wait(fw_priv);
 		if (!ret) {
 			fw_set_page_data(fw_priv, firmware);
+			fw_linger(fw_priv);
 			return 0; /* assigned */
 		}
 	}
@@ -1590,6 +1740,8 @@ static int __init firmware_class_init(void)
 
 static void __exit firmware_class_exit(void)
 {
+	cancel_delayed_work_sync(&fw_linger_work);
+	fw_linger_expire(true);
 	unregister_fw_pm_ops();
 	unregister_reboot_notifier(&fw_shutdown_nb);
 	unregister_sysfs_loader();
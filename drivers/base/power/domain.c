@@ -254,6 +254,48 @@ static inline void genpd_debug_remove(struct generic_pm_domain *genpd) {}
 static inline void genpd_update_accounting(struct generic_pm_domain *genpd) {}
 #endif
 
+#define GENPD_IDLE_DECAY_SHIFT	3
+#define GENPD_IDLE_PULSE	1024
+#define GENPD_LATENCY_AVG_SHIFT	3
+
+/*
+ * Feed the length of the idle period that is ending into the decaying idle
+ * interval histogram used by pm_domain_predictive_gov.  The period starts
+ * when the last device was suspended, whether or not the governor let the
+ * domain power off, so that a rejection doesn't stop the learning.  Only
+ * runtime transitions are taken into account, system-wide suspend would only
+ * skew the distribution towards very long intervals.
+ */
+static void genpd_update_idle_hist(struct generic_pm_domain *genpd)
+{
+	struct genpd_governor_data *gd = genpd->gd;
+	s64 idle_us;
+	int i, bucket;
+
+	if (!gd->idle_start)
+		return;
+
+	idle_us = ktime_us_delta(ktime_get(), gd->idle_start);
+	gd->idle_start = 0;
+
+	bucket = idle_us > 1 ? ilog2(idle_us) : 0;
+	if (bucket >= GENPD_IDLE_BUCKETS)
+		bucket = GENPD_IDLE_BUCKETS - 1;
+
+	for (i = 0; i < GENPD_IDLE_BUCKETS; i++)
+		gd->idle_hist[i] -= gd->idle_hist[i] >> GENPD_IDLE_DECAY_SHIFT;
+
+	gd->idle_hist[bucket] += GENPD_IDLE_PULSE;
+}
+
+static void genpd_update_avg_latency(s64 *avg, s64 elapsed_ns)
+{
+	if (!*avg)
+		*avg = elapsed_ns;
+	else
+		*avg += (elapsed_ns - *avg) >> GENPD_LATENCY_AVG_SHIFT;
+}
+
 static int _genpd_reeval_performance_state(struct generic_pm_domain *genpd,
 					   unsigned int state)
 {
@@ -509,7 +551,7 @@ static int _genpd_power_on(struct generic_pm_domain *genpd, bool timed)
 	if (!genpd->power_on)
 		goto out;
 
-	timed = timed && genpd->gd && !genpd->states[state_idx].fwnode;
+	timed = timed && genpd->gd;
 	if (!timed) {
 		ret = genpd->power_on(genpd);
 		if (ret)
@@ -524,7 +566,11 @@ static int _genpd_power_on(struct generic_pm_domain *genpd, bool timed)
 		goto err;
 
 	elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), time_start));
-	if (elapsed_ns <= genpd->states[state_idx].power_on_latency_ns)
+	genpd_update_avg_latency(&genpd->states[state_idx].avg_on_latency_ns,
+				 elapsed_ns);
+	/* Latencies of firmware managed states are trusted as declared. */
+	if (genpd->states[state_idx].fwnode ||
+	    elapsed_ns <= genpd->states[state_idx].power_on_latency_ns)
 		goto out;
 
 	genpd->states[state_idx].power_on_latency_ns = elapsed_ns;
@@ -559,7 +605,7 @@ static int _genpd_power_off(struct generic_pm_domain *genpd, bool timed)
 	if (!genpd->power_off)
 		goto out;
 
-	timed = timed && genpd->gd && !genpd->states[state_idx].fwnode;
+	timed = timed && genpd->gd;
 	if (!timed) {
 		ret = genpd->power_off(genpd);
 		if (ret)
@@ -574,7 +620,10 @@ static int _genpd_power_off(struct generic_pm_domain *genpd, bool timed)
 		goto busy;
 
 	elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), time_start));
-	if (elapsed_ns <= genpd->states[state_idx].power_off_latency_ns)
+	genpd_update_avg_latency(&genpd->states[state_idx].avg_off_latency_ns,
+				 elapsed_ns);
+	if (genpd->states[state_idx].fwnode ||
+	    elapsed_ns <= genpd->states[state_idx].power_off_latency_ns)
 		goto out;
 
 	genpd->states[state_idx].power_off_latency_ns = elapsed_ns;
@@ -666,6 +715,10 @@ static int genpd_power_off(struct generic_pm_domain *genpd, bool one_dev_on,
 	if (not_suspended > 1 || (not_suspended == 1 && !one_dev_on))
 		return -EBUSY;
 
+	/* The domain is idle from here on, until genpd_power_on(). */
+	if (genpd->gd && !genpd->gd->idle_start)
+		genpd->gd->idle_start = ktime_get();
+
 	if (genpd->gov && genpd->gov->power_down_ok) {
 		if (!genpd->gov->power_down_ok(&genpd->domain))
 			return -EAGAIN;
@@ -712,6 +765,9 @@ static int genpd_power_on(struct generic_pm_domain *genpd, unsigned int depth)
 	struct gpd_link *link;
 	int ret = 0;
 
+	if (genpd->gd)
+		genpd_update_idle_hist(genpd);
+
 	if (genpd_status_on(genpd))
 		return 0;
 
@@ -1123,6 +1179,10 @@ static void genpd_sync_power_on(struct generic_pm_domain *genpd, bool use_lock,
 {
 	struct gpd_link *link;
 
+	/* Don't count the system suspend as an idle period. */
+	if (genpd->gd)
+		genpd->gd->idle_start = 0;
+
 	if (genpd_status_on(genpd))
 		return;
 
@@ -3335,6 +3395,25 @@ static int devices_show(struct seq_file *s, void *data)
 	return ret;
 }
 
+static int idle_predictor_show(struct seq_file *s, void *data)
+{
+	struct generic_pm_domain *genpd = s->private;
+	struct genpd_governor_data *gd = genpd->gd;
+	int i;
+
+	if (genpd_lock_interruptible(genpd))
+		return -ERESTARTSYS;
+
+	seq_printf(s, "allowed: %llu\nrejected: %llu\n",
+		   gd->predict_ok, gd->predict_rejected);
+	seq_puts(s, "min idle (us)  weight\n");
+	for (i = 0; i < GENPD_IDLE_BUCKETS; i++)
+		seq_printf(s, "%-14lu %u\n", i ? BIT(i) : 0, gd->idle_hist[i]);
+
+	genpd_unlock(genpd);
+	return 0;
+}
+
 static int perf_state_show(struct seq_file *s, void *data)
 {
 	struct generic_pm_domain *genpd = s->private;
@@ -3355,6 +3434,7 @@ DEFINE_SHOW_ATTRIBUTE(idle_states);
 DEFINE_SHOW_ATTRIBUTE(active_time);
 DEFINE_SHOW_ATTRIBUTE(total_idle_time);
 DEFINE_SHOW_ATTRIBUTE(devices);
+DEFINE_SHOW_ATTRIBUTE(idle_predictor);
 DEFINE_SHOW_ATTRIBUTE(perf_state);
 
 static void genpd_debug_add(struct generic_pm_domain *genpd)
@@ -3378,6 +3458,9 @@ static void genpd_debug_add(struct generic_pm_domain *genpd)
 			    d, genpd, &total_idle_time_fops);
 	debugfs_create_file("devices", 0444,
 			    d, genpd, &devices_fops);
+	if (genpd->gd)
+		debugfs_create_file("idle_predictor", 0444,
+				    d, genpd, &idle_predictor_fops);
 	if (genpd->set_performance_state)
 		debugfs_create_file("perf_state", 0444,
 				    d, genpd, &perf_state_fops);
@@ -403,6 +403,78 @@ struct dev_power_governor simple_qos_governor = {
 	.power_down_ok = default_power_down_ok,
 };
 
+/*
+ * Only power off to a state if the recent idle periods of the domain
+ * suggest that it will stay off for longer than it takes to break even,
+ * i.e. if more than half of the (decayed) weight of observed intervals
+ * lies in buckets that lie entirely above the break-even point.
+ */
+static bool idle_predicts_state(struct generic_pm_domain *genpd,
+				unsigned int state)
+{
+	struct genpd_governor_data *gd = genpd->gd;
+	struct genpd_power_state *st = &genpd->states[state];
+	u64 long_weight = 0, total = 0;
+	s64 off_ns, on_ns, break_even_us;
+	int i;
+
+	/* Prefer what entering and leaving the state actually costs. */
+	off_ns = st->avg_off_latency_ns ?: st->power_off_latency_ns;
+	on_ns = st->avg_on_latency_ns ?: st->power_on_latency_ns;
+	break_even_us = div_s64(off_ns + on_ns + st->residency_ns,
+				NSEC_PER_USEC);
+
+	for (i = 0; i < GENPD_IDLE_BUCKETS; i++) {
+		total += gd->idle_hist[i];
+		if (i && BIT_ULL(i) >= break_even_us)
+			long_weight += gd->idle_hist[i];
+	}
+
+	/* Nothing learned yet, trust the latency constraints. */
+	if (!total)
+		return true;
+
+	return long_weight * 2 > total;
+}
+
+static bool predictive_power_down_ok(struct dev_pm_domain *pd)
+{
+	struct generic_pm_domain *genpd = pd_to_genpd(pd);
+	int i;
+
+	/* Validate dev PM QoS constraints. */
+	if (!_default_power_down_ok(pd, ktime_get()))
+		return false;
+
+	/*
+	 * Find the deepest state, starting at the one picked by the QoS
+	 * validation, which the idle interval history makes worth entering.
+	 */
+	i = genpd->state_idx;
+	do {
+		if (idle_predicts_state(genpd, i)) {
+			genpd->state_idx = i;
+			genpd->gd->predict_ok++;
+			return true;
+		}
+	} while (--i >= 0);
+
+	genpd->gd->predict_rejected++;
+	return false;
+}
+
+/**
+ * pm_domain_predictive_gov - A governor that learns the domain's idle periods
+ *
+ * In addition to the checks done by simple_qos_governor, keep the domain on
+ * if the observed idle intervals predict that turning it off would not pay
+ * off, which avoids flapping on and off under bursty I/O.
+ */
+struct dev_power_governor pm_domain_predictive_gov = {
+	.suspend_ok = default_suspend_ok,
+	.power_down_ok = predictive_power_down_ok,
+};
+
 /**
  * pm_genpd_gov_always_on - A governor implementing an always-on policy
  */
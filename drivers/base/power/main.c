@@ -228,6 +228,21 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 		 (unsigned long long)ktime_us_delta(rettime, calltime));
 }
 
+/*
+ * With pm_async set to 2 every device is handled as if its async_suspend
+ * flag was set, so the order is only constrained by the parent and device
+ * link dependencies and independent subtrees proceed in parallel.
+ */
+static bool dpm_async_all(void)
+{
+	return pm_async_enabled > 1;
+}
+
+static bool dev_async(struct device *dev)
+{
+	return pm_async_enabled && (dev->power.async_suspend || dpm_async_all());
+}
+
 /**
  * dpm_wait - Wait for a PM operation to complete.
  * @dev: Device to wait for.
@@ -238,10 +253,39 @@ static void dpm_wait(struct device *dev, bool async)
 	if (!dev)
 		return;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
+	if (async || dev_async(dev))
 		wait_for_completion(&dev->power.completion);
 }
 
+/**
+ * dpm_wait_superior - Wait for a parent or supplier of a device.
+ * @dev: Device about to be handled.
+ * @superior: Device to wait for.
+ * @link: Name of the dependency edge for the trace event.
+ * @async: Same as for dpm_wait().
+ *
+ * Like dpm_wait(), but report the time spent blocking on each dependency
+ * edge so the critical path of a transition can be reconstructed.
+ */
+static void dpm_wait_superior(struct device *dev, struct device *superior,
+			      const char *link, bool async)
+{
+	ktime_t start;
+
+	if (!trace_device_pm_wait_enabled()) {
+		dpm_wait(superior, async);
+		return;
+	}
+
+	if (!superior)
+		return;
+
+	start = ktime_get();
+	dpm_wait(superior, async);
+	trace_device_pm_wait(dev, superior, link,
+			     ktime_to_ns(ktime_sub(ktime_get(), start)));
+}
+
 static int dpm_wait_fn(struct device *dev, void *async_ptr)
 {
 	dpm_wait(dev, *((bool *)async_ptr));
@@ -269,7 +313,7 @@ static void dpm_wait_for_suppliers(struct device *dev, bool async)
 	 */
 	list_for_each_entry_rcu_locked(link, &dev->links.suppliers, c_node)
 		if (READ_ONCE(link->status) != DL_STATE_DORMANT)
-			dpm_wait(link->supplier, async);
+			dpm_wait_superior(dev, link->supplier, "supplier", async);
 
 	device_links_read_unlock(idx);
 }
@@ -296,7 +340,7 @@ static bool dpm_wait_for_superior(struct device *dev, bool async)
 
 	mutex_unlock(&dpm_list_mtx);
 
-	dpm_wait(parent, async);
+	dpm_wait_superior(dev, parent, "parent", async);
 	put_device(parent);
 
 	dpm_wait_for_suppliers(dev, async);
@@ -666,8 +710,7 @@ static void __device_resume_noirq(struct device *dev, pm_message_t state, bool a
 
 static bool is_async(struct device *dev)
 {
-	return dev->power.async_suspend && pm_async_enabled
-		&& !pm_trace_is_enabled();
+	return dev_async(dev) && !pm_trace_is_enabled();
 }
 
 static bool dpm_async_fn(struct device *dev, async_func_t func)
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: GPL-2.0
+//
+// Register cache access API - paged caching support
+//
+// The register space is split into fixed size pages of adjacent
+// registers.  A flat directory indexed by page number points at pages
+// which are only allocated once a register in them is cached, so
+// lookups cost two array accesses like the flat cache while sparse
+// maps only pay for the pages they actually use.
+
+#include <linux/bitmap.h>
+#include <linux/device.h>
+#include <linux/slab.h>
+
+#include "internal.h"
+
+#define REGCACHE_PAGED_SHIFT	6
+#define REGCACHE_PAGED_REGS	(1U << REGCACHE_PAGED_SHIFT)
+#define REGCACHE_PAGED_MASK	(REGCACHE_PAGED_REGS - 1)
+
+struct regcache_paged_page {
+	/* Which registers are present */
+	DECLARE_BITMAP(cache_present, REGCACHE_PAGED_REGS);
+	/* REGCACHE_PAGED_REGS values of map->cache_word_size bytes */
+	u8 block[];
+};
+
+struct regcache_paged_ctx {
+	unsigned int nr_pages;
+	struct regcache_paged_page *pages[];
+};
+
+static inline unsigned int regcache_paged_get_index(const struct regmap *map,
+						    unsigned int reg)
+{
+	return regcache_get_index_by_order(map, reg);
+}
+
+static int regcache_paged_write(struct regmap *map, unsigned int reg,
+				unsigned int value);
+static int regcache_paged_exit(struct regmap *map);
+
+static int regcache_paged_init(struct regmap *map)
+{
+	struct regcache_paged_ctx *ctx;
+	unsigned int nr_pages;
+	int i;
+	int ret;
+
+	if (!map || map->reg_stride_order < 0 || !map->max_register)
+		return -EINVAL;
+
+	nr_pages = (regcache_paged_get_index(map, map->max_register) >>
+		    REGCACHE_PAGED_SHIFT) + 1;
+
+	ctx = kvzalloc(struct_size(ctx, pages, nr_pages), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->nr_pages = nr_pages;
+	map->cache = ctx;
+
+	for (i = 0; i < map->num_reg_defaults; i++) {
+		ret = regcache_paged_write(map, map->reg_defaults[i].reg,
+					   map->reg_defaults[i].def);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	regcache_paged_exit(map);
+	return ret;
+}
+
+static int regcache_paged_exit(struct regmap *map)
+{
+	struct regcache_paged_ctx *ctx = map->cache;
+	unsigned int i;
+
+	if (!ctx)
+		return 0;
+
+	for (i = 0; i < ctx->nr_pages; i++)
+		kfree(ctx->pages[i]);
+
+	kvfree(ctx);
+	map->cache = NULL;
+
+	return 0;
+}
+
+static int regcache_paged_read(struct regmap *map,
+			       unsigned int reg, unsigned int *value)
+{
+	struct regcache_paged_ctx *ctx = map->cache;
+	unsigned int index = regcache_paged_get_index(map, reg);
+	unsigned int offset = index & REGCACHE_PAGED_MASK;
+	struct regcache_paged_page *page;
+
+	page = ctx->pages[index >> REGCACHE_PAGED_SHIFT];
+	if (!page || !test_bit(offset, page->cache_present))
+		return -ENOENT;
+
+	*value = regcache_get_val(map, page->block, offset);
+
+	return 0;
+}
+
+static int regcache_paged_write(struct regmap *map, unsigned int reg,
+				unsigned int value)
+{
+	struct regcache_paged_ctx *ctx = map->cache;
+	unsigned int index = regcache_paged_get_index(map, reg);
+	unsigned int offset = index & REGCACHE_PAGED_MASK;
+	struct regcache_paged_page **slot;
+
+	slot = &ctx->pages[index >> REGCACHE_PAGED_SHIFT];
+	if (!*slot) {
+		*slot = kzalloc(struct_size(*slot, block, REGCACHE_PAGED_REGS *
+					    map->cache_word_size),
+				map->alloc_flags);
+		if (!*slot)
+			return -ENOMEM;
+	}
+
+	set_bit(offset, (*slot)->cache_present);
+	regcache_set_val(map, (*slot)->block, offset, value);
+
+	return 0;
+}
+
+/*
+ * Call fn for every allocated page overlapping [min, max] with the
+ * range of block indices within the page that the window covers.
+ */
+static int regcache_paged_walk(struct regmap *map, unsigned int min,
+			       unsigned int max,
+			       int (*fn)(struct regmap *map,
+					 struct regcache_paged_ctx *ctx,
+					 unsigned int page_nr,
+					 unsigned int start, unsigned int end))
+{
+	struct regcache_paged_ctx *ctx = map->cache;
+	unsigned int first = regcache_paged_get_index(map, min);
+	unsigned int last = regcache_paged_get_index(map, max);
+	unsigned int page_nr;
+	int ret;
+
+	if (last > regcache_paged_get_index(map, map->max_register))
+		last = regcache_paged_get_index(map, map->max_register);
+
+	for (page_nr = first >> REGCACHE_PAGED_SHIFT;
+	     page_nr <= last >> REGCACHE_PAGED_SHIFT; page_nr++) {
+		unsigned int base = page_nr << REGCACHE_PAGED_SHIFT;
+		unsigned int start = 0, end = REGCACHE_PAGED_REGS;
+
+		if (!ctx->pages[page_nr])
+			continue;
+
+		if (first > base)
+			start = first - base;
+		if (last < base + REGCACHE_PAGED_REGS - 1)
+			end = last - base + 1;
+
+		ret = fn(map, ctx, page_nr, start, end);
+		if (ret != 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int regcache_paged_sync_page(struct regmap *map,
+				    struct regcache_paged_ctx *ctx,
+				    unsigned int page_nr,
+				    unsigned int start, unsigned int end)
+{
+	struct regcache_paged_page *page = ctx->pages[page_nr];
+	unsigned int base_reg;
+
+	base_reg = regmap_get_offset(map, page_nr << REGCACHE_PAGED_SHIFT);
+
+	return regcache_sync_block(map, page->block, page->cache_present,
+				   base_reg, start, end);
+}
+
+static int regcache_paged_sync(struct regmap *map, unsigned int min,
+			       unsigned int max)
+{
+	int ret;
+
+	ret = regcache_paged_walk(map, min, max, regcache_paged_sync_page);
+	if (ret != 0)
+		return ret;
+
+	return regmap_async_complete(map);
+}
+
+static int regcache_paged_drop_page(struct regmap *map,
+				    struct regcache_paged_ctx *ctx,
+				    unsigned int page_nr,
+				    unsigned int start, unsigned int end)
+{
+	struct regcache_paged_page *page = ctx->pages[page_nr];
+
+	bitmap_clear(page->cache_present, start, end - start);
+
+	/* Give back pages which no longer cache anything */
+	if (bitmap_empty(page->cache_present, REGCACHE_PAGED_REGS)) {
+		ctx->pages[page_nr] = NULL;
+		kfree(page);
+	}
+
+	return 0;
+}
+
+static int regcache_paged_drop(struct regmap *map, unsigned int min,
+			       unsigned int max)
+{
+	return regcache_paged_walk(map, min, max, regcache_paged_drop_page);
+}
+
+struct regcache_ops regcache_paged_ops = {
+	.type = REGCACHE_PAGED,
+	.name = "paged",
+	.init = regcache_paged_init,
+	.exit = regcache_paged_exit,
+	.read = regcache_paged_read,
+	.write = regcache_paged_write,
+	.sync = regcache_paged_sync,
+	.drop = regcache_paged_drop,
+};
@@ -21,6 +21,7 @@ static const struct regcache_ops *cache_types[] = {
 	&regcache_lzo_ops,
 #endif
 	&regcache_flat_ops,
+	&regcache_paged_ops,
 };
 
 static int regcache_hw_init(struct regmap *map)
@@ -297,11 +298,109 @@ static bool regcache_reg_needs_sync(struct regmap *map, unsigned int reg,
 	return true;
 }
 
+static int regcache_default_sync_flush(struct regmap *map, const void *buf,
+				       unsigned int base, unsigned int *count)
+{
+	unsigned int last;
+	int ret;
+
+	if (!*count)
+		return 0;
+
+	last = base + (*count - 1) * map->reg_stride;
+
+	map->cache_bypass = true;
+	ret = _regmap_raw_write(map, base, buf, *count * map->format.val_bytes,
+				false);
+	map->cache_bypass = false;
+	if (ret)
+		dev_err(map->dev, "Unable to sync registers %#x-%#x. %d\n",
+			base, last, ret);
+	else
+		dev_dbg(map->dev, "Synced %u registers %#x-%#x\n", *count,
+			base, last);
+
+	*count = 0;
+
+	return ret;
+}
+
+/*
+ * Like regcache_default_sync() but writes each run of consecutive registers
+ * that need syncing with a single raw write, as regcache_sync_block_raw()
+ * does for block based caches. buf has room for every register in the
+ * range in device format.
+ */
+static int regcache_default_sync_raw(struct regmap *map, unsigned int min,
+				     unsigned int max, u8 *buf)
+{
+	size_t val_bytes = map->format.val_bytes;
+	unsigned int reg, base = min, count = 0;
+	u8 *data = buf;
+	int ret;
+
+	for (reg = min; reg <= max; reg += map->reg_stride) {
+		unsigned int val;
+
+		if (regmap_volatile(map, reg) ||
+		    !regmap_writeable(map, reg)) {
+			ret = regcache_default_sync_flush(map, data, base,
+							  &count);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		ret = regcache_read(map, reg, &val);
+		if (ret)
+			return ret;
+
+		if (!regcache_reg_needs_sync(map, reg, val)) {
+			ret = regcache_default_sync_flush(map, data, base,
+							  &count);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		if (!count) {
+			base = reg;
+			data = buf + ((reg - min) / map->reg_stride) * val_bytes;
+		}
+		map->format.format_val(data + count * val_bytes, val, 0);
+		count++;
+	}
+
+	return regcache_default_sync_flush(map, data, base, &count);
+}
+
 static int regcache_default_sync(struct regmap *map, unsigned int min,
 				 unsigned int max)
 {
 	unsigned int reg;
 
+	if (regmap_can_raw_write(map) && !map->use_single_write) {
+		size_t nregs = (max - min) / map->reg_stride + 1;
+		bool async = map->async;
+		u8 *buf;
+		int ret;
+
+		buf = kmalloc_array(nregs, map->format.val_bytes,
+				    map->alloc_flags | __GFP_NOWARN);
+		if (buf) {
+			/*
+			 * Raw async writes send the caller's buffer as is,
+			 * so keep the bursts synchronous to be able to free
+			 * it here.
+			 */
+			map->async = false;
+			ret = regcache_default_sync_raw(map, min, max, buf);
+			map->async = async;
+			kfree(buf);
+			return ret;
+		}
+	}
+
 	for (reg = min; reg <= max; reg += map->reg_stride) {
 		unsigned int val;
 		int ret;
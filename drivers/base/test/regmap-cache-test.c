@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-2.0
+// Unit tests and lookup benchmark for the regmap register caches
+
+#include <kunit/test.h>
+#include <linux/bitmap.h>
+#include <linux/ktime.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+
+#define TEST_MAX_REGISTER	0x3fff
+#define TEST_BENCH_LOOPS	16
+
+struct regmap_test_hw {
+	u16 regs[TEST_MAX_REGISTER + 1];
+	unsigned long written[BITS_TO_LONGS(TEST_MAX_REGISTER + 1)];
+	unsigned int nr_reads;
+};
+
+static int regmap_test_reg_read(void *context, unsigned int reg,
+				unsigned int *val)
+{
+	struct regmap_test_hw *hw = context;
+
+	hw->nr_reads++;
+	*val = hw->regs[reg];
+
+	return 0;
+}
+
+static int regmap_test_reg_write(void *context, unsigned int reg,
+				 unsigned int val)
+{
+	struct regmap_test_hw *hw = context;
+
+	hw->regs[reg] = val;
+	set_bit(reg, hw->written);
+
+	return 0;
+}
+
+/* A sparse layout: a few clusters of registers spread over the map */
+static unsigned int regmap_test_reg(unsigned int i)
+{
+	return (i % 4) * 0x1000 + (i / 4) * 3;
+}
+
+#define TEST_NR_REGS	512
+
+static struct regmap *regmap_test_init(struct kunit *test,
+				       enum regcache_type type,
+				       struct regmap_test_hw **hwp)
+{
+	struct regmap_config config = {
+		.reg_bits = 16,
+		.val_bits = 16,
+		.max_register = TEST_MAX_REGISTER,
+		.reg_read = regmap_test_reg_read,
+		.reg_write = regmap_test_reg_write,
+		.cache_type = type,
+	};
+	struct regmap_test_hw *hw;
+	struct regmap *map;
+
+	hw = kunit_kzalloc(test, sizeof(*hw), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, hw);
+
+	map = regmap_init(NULL, NULL, hw, &config);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, map);
+
+	*hwp = hw;
+	return map;
+}
+
+static void regmap_test_paged_read_write(struct kunit *test)
+{
+	struct regmap_test_hw *hw;
+	struct regmap *map;
+	unsigned int i, val;
+
+	map = regmap_test_init(test, REGCACHE_PAGED, &hw);
+
+	for (i = 0; i < TEST_NR_REGS; i++)
+		KUNIT_EXPECT_EQ(test, 0, regmap_write(map, regmap_test_reg(i),
+						      i ^ 0xa5a5));
+
+	/* Everything written must now be served from the cache */
+	hw->nr_reads = 0;
+	regcache_cache_only(map, true);
+	for (i = 0; i < TEST_NR_REGS; i++) {
+		KUNIT_EXPECT_EQ(test, 0, regmap_read(map, regmap_test_reg(i),
+						     &val));
+		KUNIT_EXPECT_EQ(test, i ^ 0xa5a5, val);
+	}
+	KUNIT_EXPECT_EQ(test, 0U, hw->nr_reads);
+
+	/* A register that was never touched is not cached */
+	KUNIT_EXPECT_NE(test, 0, regmap_read(map, TEST_MAX_REGISTER, &val));
+
+	regmap_exit(map);
+}
+
+static void regmap_test_paged_sync(struct kunit *test)
+{
+	struct regmap_test_hw *hw;
+	struct regmap *map;
+	unsigned int i;
+
+	map = regmap_test_init(test, REGCACHE_PAGED, &hw);
+
+	regcache_cache_only(map, true);
+	for (i = 0; i < TEST_NR_REGS; i++)
+		KUNIT_EXPECT_EQ(test, 0, regmap_write(map, regmap_test_reg(i),
+						      i + 1));
+	KUNIT_EXPECT_TRUE(test, bitmap_empty(hw->written,
+					     TEST_MAX_REGISTER + 1));
+
+	regcache_cache_only(map, false);
+	regcache_mark_dirty(map);
+	KUNIT_EXPECT_EQ(test, 0, regcache_sync(map));
+
+	for (i = 0; i < TEST_NR_REGS; i++) {
+		unsigned int reg = regmap_test_reg(i);
+
+		KUNIT_EXPECT_TRUE(test, test_bit(reg, hw->written));
+		KUNIT_EXPECT_EQ(test, i + 1, (unsigned int)hw->regs[reg]);
+	}
+	KUNIT_EXPECT_EQ(test, (unsigned int)TEST_NR_REGS,
+			bitmap_weight(hw->written, TEST_MAX_REGISTER + 1));
+
+	regmap_exit(map);
+}
+
+static void regmap_test_paged_drop(struct kunit *test)
+{
+	struct regmap_test_hw *hw;
+	struct regmap *map;
+	unsigned int i, val;
+
+	map = regmap_test_init(test, REGCACHE_PAGED, &hw);
+
+	for (i = 0; i < 0x200; i++)
+		KUNIT_EXPECT_EQ(test, 0, regmap_write(map, i, i));
+
+	KUNIT_EXPECT_EQ(test, 0, regcache_drop_region(map, 0x30, 0x14f));
+
+	regcache_cache_only(map, true);
+	for (i = 0; i < 0x200; i++) {
+		if (i >= 0x30 && i <= 0x14f) {
+			KUNIT_EXPECT_NE(test, 0, regmap_read(map, i, &val));
+			continue;
+		}
+		KUNIT_EXPECT_EQ(test, 0, regmap_read(map, i, &val));
+		KUNIT_EXPECT_EQ(test, i, val);
+	}
+
+	regmap_exit(map);
+}
+
+static void regmap_test_bench_one(struct kunit *test, enum regcache_type type,
+				  const char *name)
+{
+	struct regmap_test_hw *hw;
+	struct regmap *map;
+	unsigned int i, loop, val;
+	ktime_t start;
+	s64 ns;
+
+	map = regmap_test_init(test, type, &hw);
+
+	for (i = 0; i < TEST_NR_REGS; i++)
+		regmap_write(map, regmap_test_reg(i), i);
+
+	regcache_cache_only(map, true);
+	start = ktime_get();
+	for (loop = 0; loop < TEST_BENCH_LOOPS; loop++)
+		for (i = 0; i < TEST_NR_REGS; i++)
+			regmap_read(map, regmap_test_reg(i), &val);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	kunit_info(test, "%s: %lld ns per cached read\n", name,
+		   div_s64(ns, TEST_BENCH_LOOPS * TEST_NR_REGS));
+
+	regmap_exit(map);
+}
+
+static void regmap_test_bench(struct kunit *test)
+{
+	regmap_test_bench_one(test, REGCACHE_RBTREE, "rbtree");
+	regmap_test_bench_one(test, REGCACHE_FLAT, "flat");
+	regmap_test_bench_one(test, REGCACHE_PAGED, "paged");
+}
+
+static struct kunit_case regmap_cache_test_cases[] = {
+	KUNIT_CASE(regmap_test_paged_read_write),
+	KUNIT_CASE(regmap_test_paged_sync),
+	KUNIT_CASE(regmap_test_paged_drop),
+	KUNIT_CASE(regmap_test_bench),
+	{ }
+};
+
+static struct kunit_suite regmap_cache_test_suite = {
+	.name = "regmap-cache",
+	.test_cases = regmap_cache_test_cases,
+};
+
+kunit_test_suite(regmap_cache_test_suite);
@@ -9,6 +9,8 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include "null_blk.h"
 
 #undef pr_fmt
@@ -68,6 +70,7 @@ struct nullb_page {
 static LIST_HEAD(nullb_list);
 static struct mutex lock;
 static int null_major;
+static struct dentry *null_debugfs_root;
 static DEFINE_IDA(nullb_indexes);
 static struct blk_mq_tag_set tag_set;
 
@@ -193,6 +196,22 @@ static unsigned long g_completion_nsec = 10000;
 module_param_named(completion_nsec, g_completion_nsec, ulong, 0444);
 MODULE_PARM_DESC(completion_nsec, "Time in ns to complete a request in hardware. Default: 10,000ns");
 
+static unsigned long g_completion_tail_nsec = 1000000;
+module_param_named(completion_tail_nsec, g_completion_tail_nsec, ulong, 0444);
+MODULE_PARM_DESC(completion_tail_nsec, "Time in ns to complete a tail latency request. Default: 1,000,000ns");
+
+static unsigned int g_completion_tail_pct;
+module_param_named(completion_tail_pct, g_completion_tail_pct, uint, 0444);
+MODULE_PARM_DESC(completion_tail_pct, "Percentage of requests completing in completion_tail_nsec (irqmode=2). Default: 0");
+
+static unsigned int g_channels;
+module_param_named(channels, g_channels, uint, 0444);
+MODULE_PARM_DESC(channels, "Number of requests the device services in parallel (irqmode=2). Default: 0 (unlimited)");
+
+static unsigned int g_channel_mbps;
+module_param_named(channel_mbps, g_channel_mbps, uint, 0444);
+MODULE_PARM_DESC(channel_mbps, "Per channel transfer bandwidth in MiB/s (irqmode=2). Default: 0 (no limit)");
+
 static int g_hw_queue_depth = 64;
 module_param_named(hw_queue_depth, g_hw_queue_depth, int, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: 64");
@@ -403,6 +422,10 @@ static int nullb_apply_poll_queues(struct nullb_device *dev,
 
 NULLB_DEVICE_ATTR(size, ulong, NULL);
 NULLB_DEVICE_ATTR(completion_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(completion_tail_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(completion_tail_pct, uint, NULL);
+NULLB_DEVICE_ATTR(channels, uint, NULL);
+NULLB_DEVICE_ATTR(channel_mbps, uint, NULL);
 NULLB_DEVICE_ATTR(submit_queues, uint, nullb_apply_submit_queues);
 NULLB_DEVICE_ATTR(poll_queues, uint, nullb_apply_poll_queues);
 NULLB_DEVICE_ATTR(home_node, uint, NULL);
@@ -526,6 +549,10 @@ CONFIGFS_ATTR(nullb_device_, badblocks);
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
+	&nullb_device_attr_completion_tail_nsec,
+	&nullb_device_attr_completion_tail_pct,
+	&nullb_device_attr_channels,
+	&nullb_device_attr_channel_mbps,
 	&nullb_device_attr_submit_queues,
 	&nullb_device_attr_poll_queues,
 	&nullb_device_attr_home_node,
@@ -609,10 +636,12 @@ static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
 			"badblocks,blocking,blocksize,cache_size,"
-			"completion_nsec,discard,home_node,hw_queue_depth,"
-			"irqmode,max_sectors,mbps,memory_backed,no_sched,"
-			"poll_queues,power,queue_mode,shared_tag_bitmap,size,"
-			"submit_queues,use_per_node_hctx,virt_boundary,zoned,"
+			"channel_mbps,channels,completion_nsec,"
+			"completion_tail_nsec,completion_tail_pct,discard,"
+			"home_node,hw_queue_depth,irqmode,max_sectors,mbps,"
+			"memory_backed,no_sched,poll_queues,power,queue_mode,"
+			"shared_tag_bitmap,size,submit_queues,"
+			"use_per_node_hctx,virt_boundary,zoned,"
 			"zone_capacity,zone_max_active,zone_max_open,"
 			"zone_nr_conv,zone_size\n");
 }
@@ -665,6 +694,10 @@ static struct nullb_device *null_alloc_dev(void)
 
 	dev->size = g_gb * 1024;
 	dev->completion_nsec = g_completion_nsec;
+	dev->completion_tail_nsec = g_completion_tail_nsec;
+	dev->completion_tail_pct = g_completion_tail_pct;
+	dev->channels = g_channels;
+	dev->channel_mbps = g_channel_mbps;
 	dev->submit_queues = g_submit_queues;
 	dev->prev_submit_queues = g_submit_queues;
 	dev->poll_queues = g_poll_queues;
@@ -798,11 +831,73 @@ static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
+static u64 null_cmd_bytes(struct nullb_cmd *cmd)
+{
+	if (cmd->nq->dev->queue_mode == NULL_Q_MQ)
+		return blk_rq_bytes(cmd->rq);
+	return cmd->bio->bi_iter.bi_size;
+}
+
+/*
+ * Time a channel is busy with this command: either the base or the tail
+ * latency, plus the transfer time at the per channel bandwidth.
+ */
+static u64 null_cmd_service_nsec(struct nullb_cmd *cmd)
+{
+	struct nullb_device *dev = cmd->nq->dev;
+	u64 nsec = dev->completion_nsec;
+
+	if (dev->completion_tail_pct &&
+	    get_random_u32_below(100) < dev->completion_tail_pct)
+		nsec = dev->completion_tail_nsec;
+	if (dev->channel_mbps)
+		nsec += div_u64(null_cmd_bytes(cmd) * NSEC_PER_SEC,
+				(u64)dev->channel_mbps << 20);
+
+	return nsec;
+}
+
+/*
+ * With a limited number of channels a command is started on whichever
+ * channel frees up first, so it may wait behind earlier commands.
+ */
+static u64 null_cmd_delay_nsec(struct nullb_cmd *cmd)
+{
+	struct nullb *nullb = cmd->nq->dev->nullb;
+	u64 service = null_cmd_service_nsec(cmd);
+	u64 now, done, *busy;
+	unsigned int i;
+
+	if (!nullb->chan_busy)
+		return service;
+
+	now = ktime_get_ns();
+	spin_lock(&nullb->chan_lock);
+	busy = &nullb->chan_busy[0];
+	for (i = 1; i < nullb->dev->channels; i++)
+		if (nullb->chan_busy[i] < *busy)
+			busy = &nullb->chan_busy[i];
+	done = max(now, *busy) + service;
+	*busy = done;
+	spin_unlock(&nullb->chan_lock);
+
+	return done - now;
+}
+
+static void null_account_latency(struct nullb_queue *nq, u64 nsec)
+{
+	unsigned int bucket = fls64(div_u64(nsec, NSEC_PER_USEC));
+
+	bucket = min_t(unsigned int, bucket, NULLB_LAT_BUCKETS - 1);
+	atomic64_inc(&nq->lat_hist[bucket]);
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	u64 nsec = null_cmd_delay_nsec(cmd);
 
-	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
+	null_account_latency(cmd->nq, nsec);
+	hrtimer_start(&cmd->timer, ns_to_ktime(nsec), HRTIMER_MODE_REL);
 }
 
 static void null_complete_rq(struct request *rq)
@@ -1755,6 +1850,25 @@ static const struct blk_mq_ops null_mq_ops = {
 	.exit_hctx	= null_exit_hctx,
 };
 
+static int null_lat_hist_show(struct seq_file *m, void *unused)
+{
+	struct nullb *nullb = m->private;
+	unsigned int i, b;
+
+	for (i = 0; i < nullb->nr_queues; i++) {
+		struct nullb_queue *nq = &nullb->queues[i];
+
+		seq_printf(m, "queue%u:", i);
+		for (b = 0; b < NULLB_LAT_BUCKETS; b++)
+			seq_printf(m, " %llu",
+				   (u64)atomic64_read(&nq->lat_hist[b]));
+		seq_putc(m, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(null_lat_hist);
+
 static void null_del_dev(struct nullb *nullb)
 {
 	struct nullb_device *dev;
@@ -1768,6 +1882,7 @@ static void null_del_dev(struct nullb *nullb)
 
 	list_del_init(&nullb->list);
 
+	debugfs_remove_recursive(nullb->debugfs);
 	del_gendisk(nullb->disk);
 
 	if (test_bit(NULLB_DEV_FL_THROTTLED, &nullb->dev->flags)) {
@@ -1783,6 +1898,7 @@ static void null_del_dev(struct nullb *nullb)
 	cleanup_queues(nullb);
 	if (null_cache_active(nullb))
 		null_free_device_storage(nullb->dev, true);
+	kfree(nullb->chan_busy);
 	kfree(nullb);
 	dev->nullb = NULL;
 }
@@ -1985,6 +2101,10 @@ static int null_validate_conf(struct nullb_device *dev)
 	dev->cache_size = min_t(unsigned long, ULONG_MAX / 1024 / 1024,
 						dev->cache_size);
 	dev->mbps = min_t(unsigned int, 1024 * 40, dev->mbps);
+	dev->channel_mbps = min_t(unsigned int, 1024 * 40, dev->channel_mbps);
+	dev->completion_tail_pct = min_t(unsigned int, 100,
+					 dev->completion_tail_pct);
+	dev->channels = min_t(unsigned int, 4096, dev->channels);
 	/* can not stop a queue */
 	if (dev->queue_mode == NULL_Q_BIO)
 		dev->mbps = 0;
@@ -2043,6 +2163,7 @@ static int null_add_dev(struct nullb_device *dev)
 	dev->nullb = nullb;
 
 	spin_lock_init(&nullb->lock);
+	spin_lock_init(&nullb->chan_lock);
 
 	rv = setup_queues(nullb);
 	if (rv)
@@ -2087,6 +2208,14 @@ static int null_add_dev(struct nullb_device *dev)
 		nullb_setup_bwtimer(nullb);
 	}
 
+	if (dev->channels && dev->irqmode == NULL_IRQ_TIMER) {
+		rv = -ENOMEM;
+		nullb->chan_busy = kcalloc_node(dev->channels, sizeof(u64),
+						GFP_KERNEL, dev->home_node);
+		if (!nullb->chan_busy)
+			goto out_cleanup_disk;
+	}
+
 	if (dev->cache_size > 0) {
 		set_bit(NULLB_DEV_FL_CACHE, &nullb->dev->flags);
 		blk_queue_write_cache(nullb->q, true, true);
@@ -2134,6 +2263,10 @@ static int null_add_dev(struct nullb_device *dev)
 	if (rv)
 		goto out_ida_free;
 
+	nullb->debugfs = debugfs_create_dir(nullb->disk_name, null_debugfs_root);
+	debugfs_create_file("latency_hist", 0444, nullb->debugfs, nullb,
+			    &null_lat_hist_fops);
+
 	mutex_lock(&lock);
 	list_add_tail(&nullb->list, &nullb_list);
 	mutex_unlock(&lock);
@@ -2154,6 +2287,7 @@ static int null_add_dev(struct nullb_device *dev)
 out_cleanup_queues:
 	cleanup_queues(nullb);
 out_free_nullb:
+	kfree(nullb->chan_busy);
 	kfree(nullb);
 	dev->nullb = NULL;
 out:
@@ -2258,6 +2392,8 @@ static int __init null_init(void)
 		goto err_conf;
 	}
 
+	null_debugfs_root = debugfs_create_dir("null_blk", NULL);
+
 	for (i = 0; i < nr_devices; i++) {
 		ret = null_create_dev();
 		if (ret)
@@ -2272,6 +2408,7 @@ static int __init null_init(void)
 		nullb = list_entry(nullb_list.next, struct nullb, list);
 		null_destroy_dev(nullb);
 	}
+	debugfs_remove_recursive(null_debugfs_root);
 	unregister_blkdev(null_major, "nullb");
 err_conf:
 	configfs_unregister_subsystem(&nullb_subsys);
@@ -2296,6 +2433,8 @@ static void __exit null_exit(void)
 	}
 	mutex_unlock(&lock);
 
+	debugfs_remove_recursive(null_debugfs_root);
+
 	if (g_queue_mode == NULL_Q_MQ && shared_tags)
 		blk_mq_free_tag_set(&tag_set);
 
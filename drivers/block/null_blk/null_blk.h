@@ -15,6 +15,9 @@
 #include <linux/spinlock.h>
 #include <linux/mutex.h>
 
+/* log2(usec) buckets of modeled completion latency, last one open-ended */
+#define NULLB_LAT_BUCKETS	20
+
 struct nullb_cmd {
 	union {
 		struct request *rq;
@@ -38,6 +41,7 @@ struct nullb_queue {
 	spinlock_t poll_lock;
 
 	struct nullb_cmd *cmds;
+	atomic64_t lat_hist[NULLB_LAT_BUCKETS];
 };
 
 struct nullb_zone {
@@ -88,6 +92,7 @@ struct nullb_device {
 
 	unsigned long size; /* device size in MB */
 	unsigned long completion_nsec; /* time in ns to complete a request */
+	unsigned long completion_tail_nsec; /* time in ns to complete a tail request */
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
@@ -106,6 +111,9 @@ struct nullb_device {
 	unsigned int hw_queue_depth; /* queue depth */
 	unsigned int index; /* index of the disk, only valid with a disk */
 	unsigned int mbps; /* Bandwidth throttle cap (in MB/s) */
+	unsigned int completion_tail_pct; /* percentage of tail latency requests */
+	unsigned int channels; /* requests serviced in parallel, 0 is unlimited */
+	unsigned int channel_mbps; /* per channel bandwidth cap (in MB/s) */
 	bool blocking; /* blocking blk-mq device */
 	bool use_per_node_hctx; /* use per-node allocation for hardware context */
 	bool power; /* power on/off the device */
@@ -130,6 +138,9 @@ struct nullb {
 	struct hrtimer bw_timer;
 	unsigned long cache_flush_pos;
 	spinlock_t lock;
+	spinlock_t chan_lock;
+	u64 *chan_busy; /* per channel busy-until time in ns */
+	struct dentry *debugfs;
 
 	struct nullb_queue *queues;
 	unsigned int nr_queues;
@@ -112,6 +112,16 @@ static void zram_clear_flag(struct zram *zram, u32 index,
 	zram->table[index].flags &= ~BIT(flag);
 }
 
+/* The compressor that has to be used to decompress the slot */
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
 static inline void zram_set_element(struct zram *zram, u32 index,
 			unsigned long element)
 {
@@ -426,6 +436,30 @@ static ssize_t writeback_limit_show(struct device *dev,
 	return scnprintf(buf, PAGE_SIZE, "%llu\n", val);
 }
 
+static ssize_t writeback_max_inflight_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || !val || val > ZRAM_WB_MAX_INFLIGHT)
+		return -EINVAL;
+
+	WRITE_ONCE(zram->wb_max_inflight, val);
+	/* let a running writeback pick up a raised limit */
+	wake_up(&zram->wb_wait);
+	return len;
+}
+
+static ssize_t writeback_max_inflight_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			 READ_ONCE(zram->wb_max_inflight));
+}
+
 static void reset_bdev(struct zram *zram)
 {
 	struct block_device *bdev;
@@ -633,6 +667,173 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define HUGE_WRITEBACK (1<<0)
 #define IDLE_WRITEBACK (1<<1)
 
+/* pages per writeback bio, all of them on contiguous backing blocks */
+#define ZRAM_WB_BATCH		BIO_MAX_VECS
+
+/* State of one writeback_store() run, shared with its in-flight bios */
+struct zram_wb_ctl {
+	atomic_t inflight;
+	atomic_long_t written;
+	int err;
+};
+
+struct zram_wb_req {
+	struct work_struct work;
+	struct zram *zram;
+	struct zram_wb_ctl *ctl;
+	struct bio *bio;
+	unsigned long blk_idx;	/* first block of the run */
+	unsigned int nr;
+	u32 index[ZRAM_WB_BATCH];
+};
+
+static unsigned long alloc_block_bdev_next(struct zram *zram,
+					   unsigned long blk_idx)
+{
+	if (++blk_idx >= zram->nr_pages)
+		return 0;
+
+	if (test_and_set_bit(blk_idx, zram->bitmap))
+		return 0;
+
+	atomic64_inc(&zram->stats.bd_count);
+	return blk_idx;
+}
+
+static void zram_wb_abort(struct zram *zram, u32 index)
+{
+	zram_slot_lock(zram, index);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_clear_flag(zram, index, ZRAM_IDLE);
+	zram_slot_unlock(zram, index);
+}
+
+static void zram_wb_limit_charge(struct zram *zram, bool charge)
+{
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable) {
+		if (charge && zram->bd_wb_limit > 0)
+			zram->bd_wb_limit -= 1UL << (PAGE_SHIFT - 12);
+		else if (!charge)
+			zram->bd_wb_limit += 1UL << (PAGE_SHIFT - 12);
+	}
+	spin_unlock(&zram->wb_limit_lock);
+}
+
+static struct zram_wb_req *zram_wb_req_alloc(struct zram *zram,
+					     struct zram_wb_ctl *ctl)
+{
+	struct zram_wb_req *req;
+
+	req = kmalloc(sizeof(*req), GFP_KERNEL);
+	if (!req)
+		return NULL;
+
+	req->bio = bio_alloc(zram->bdev, ZRAM_WB_BATCH,
+			     REQ_OP_WRITE | REQ_SYNC, GFP_KERNEL);
+	if (!req->bio) {
+		kfree(req);
+		return NULL;
+	}
+
+	req->zram = zram;
+	req->ctl = ctl;
+	req->blk_idx = 0;
+	req->nr = 0;
+	return req;
+}
+
+static void zram_wb_req_free(struct zram_wb_req *req)
+{
+	struct bio_vec *bvec;
+	struct bvec_iter_all iter_all;
+
+	bio_for_each_segment_all(bvec, req->bio, iter_all)
+		__free_page(bvec->bv_page);
+	bio_put(req->bio);
+	kfree(req);
+}
+
+/*
+ * Runs once the bio hit the backing device. Only now may the slots drop
+ * their zsmalloc objects; until then a read must still find the data there.
+ */
+static void zram_wb_req_done(struct work_struct *work)
+{
+	struct zram_wb_req *req = container_of(work, struct zram_wb_req, work);
+	struct zram *zram = req->zram;
+	struct zram_wb_ctl *ctl = req->ctl;
+	int err = blk_status_to_errno(req->bio->bi_status);
+	unsigned int i;
+
+	if (err)
+		ctl->err = err;
+
+	for (i = 0; i < req->nr; i++) {
+		u32 index = req->index[i];
+		unsigned long blk_idx = req->blk_idx + i;
+
+		if (!err)
+			atomic64_inc(&zram->stats.bd_writes);
+		/*
+		 * We released zram_slot_lock so need to check if the slot was
+		 * changed. If there is freeing for the slot, we can catch it
+		 * easily by zram_allocated.
+		 * A subtle case is the slot is freed/reallocated/marked as
+		 * ZRAM_IDLE again. To close the race, idle_store doesn't
+		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+		 * Thus, we could close the race by checking ZRAM_IDLE bit.
+		 */
+		zram_slot_lock(zram, index);
+		if (err || !zram_allocated(zram, index) ||
+			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
+			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+			zram_clear_flag(zram, index, ZRAM_IDLE);
+			zram_slot_unlock(zram, index);
+			free_block_bdev(zram, blk_idx);
+			zram_wb_limit_charge(zram, false);
+			continue;
+		}
+
+		zram_free_page(zram, index);
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_set_flag(zram, index, ZRAM_WB);
+		zram_set_element(zram, index, blk_idx);
+		atomic64_inc(&zram->stats.pages_stored);
+		zram_slot_unlock(zram, index);
+		atomic_long_inc(&ctl->written);
+	}
+
+	zram_wb_req_free(req);
+	/* ctl may go away as soon as inflight drops to zero */
+	atomic_dec(&ctl->inflight);
+	wake_up(&zram->wb_wait);
+}
+
+static void zram_wb_end_io(struct bio *bio)
+{
+	struct zram_wb_req *req = bio->bi_private;
+
+	/* zram_free_page() and friends are not irq safe */
+	queue_work(system_unbound_wq, &req->work);
+}
+
+static void zram_wb_submit(struct zram_wb_req *req)
+{
+	struct zram *zram = req->zram;
+	struct zram_wb_ctl *ctl = req->ctl;
+
+	wait_event(zram->wb_wait, atomic_read(&ctl->inflight) <
+				  READ_ONCE(zram->wb_max_inflight));
+	atomic_inc(&ctl->inflight);
+
+	INIT_WORK(&req->work, zram_wb_req_done);
+	req->bio->bi_iter.bi_sector = req->blk_idx * (PAGE_SIZE >> 9);
+	req->bio->bi_private = req;
+	req->bio->bi_end_io = zram_wb_end_io;
+	atomic64_inc(&zram->stats.bd_wb_bios);
+	submit_bio(req->bio);
+}
 
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
@@ -640,12 +841,11 @@ static ssize_t writeback_store(struct device *dev,
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_req *req = NULL;
+	struct zram_wb_ctl ctl;
 	ssize_t ret = len;
-	int mode, err;
-	unsigned long blk_idx = 0;
+	u64 start, elapsed;
+	int mode;
 
 	if (sysfs_streq(buf, "idle"))
 		mode = IDLE_WRITEBACK;
@@ -676,18 +876,15 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
-		ret = -ENOMEM;
-		goto release_init_lock;
-	}
+	atomic_set(&ctl.inflight, 0);
+	atomic_long_set(&ctl.written, 0);
+	ctl.err = 0;
+	start = ktime_get_ns();
 
 	for (; nr_pages != 0; index++, nr_pages--) {
 		struct bio_vec bvec;
-
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
+		unsigned long blk_idx = 0;
+		struct page *page;
 
 		spin_lock(&zram->wb_limit_lock);
 		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
@@ -697,14 +894,6 @@ static ssize_t writeback_store(struct device *dev,
 		}
 		spin_unlock(&zram->wb_limit_lock);
 
-		if (!blk_idx) {
-			blk_idx = alloc_block_bdev(zram);
-			if (!blk_idx) {
-				ret = -ENOSPC;
-				break;
-			}
-		}
-
 		zram_slot_lock(zram, index);
 		if (!zram_allocated(zram, index))
 			goto next;
@@ -728,73 +917,86 @@ static ssize_t writeback_store(struct device *dev,
 		/* Need for hugepage writeback racing */
 		zram_set_flag(zram, index, ZRAM_IDLE);
 		zram_slot_unlock(zram, index);
+
+		/* The page stays with the bio until it completes */
+		page = alloc_page(GFP_KERNEL);
+		if (!page) {
+			zram_wb_abort(zram, index);
+			ret = -ENOMEM;
+			break;
+		}
+
+		bvec.bv_page = page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
 		if (zram_bvec_read(zram, &bvec, index, 0, NULL)) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
+			zram_wb_abort(zram, index);
+			__free_page(page);
 			continue;
 		}
 
-		bio_init(&bio, zram->bdev, &bio_vec, 1,
-			 REQ_OP_WRITE | REQ_SYNC);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			/*
-			 * Return last IO error unless every IO were
-			 * not suceeded.
-			 */
-			ret = err;
-			continue;
+		/* Extend the current bio while the backing blocks line up */
+		if (req) {
+			blk_idx = alloc_block_bdev_next(zram,
+					req->blk_idx + req->nr - 1);
+			if (!blk_idx) {
+				zram_wb_submit(req);
+				req = NULL;
+			}
 		}
 
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
+		if (!req) {
+			req = zram_wb_req_alloc(zram, &ctl);
+			if (!req) {
+				zram_wb_abort(zram, index);
+				__free_page(page);
+				ret = -ENOMEM;
+				break;
+			}
+
+			blk_idx = alloc_block_bdev(zram);
+			if (!blk_idx) {
+				zram_wb_abort(zram, index);
+				__free_page(page);
+				ret = -ENOSPC;
+				break;
+			}
+			req->blk_idx = blk_idx;
 		}
 
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
-		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+		bio_add_page(req->bio, page, PAGE_SIZE, 0);
+		req->index[req->nr++] = index;
+		zram_wb_limit_charge(zram, true);
+
+		if (req->nr == ZRAM_WB_BATCH) {
+			zram_wb_submit(req);
+			req = NULL;
+		}
+		cond_resched();
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
 
-	if (blk_idx)
-		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+	if (req) {
+		if (req->nr)
+			zram_wb_submit(req);
+		else
+			zram_wb_req_free(req);
+	}
+
+	wait_event(zram->wb_wait, !atomic_read(&ctl.inflight));
+
+	/*
+	 * Return last IO error unless every IO were
+	 * not suceeded.
+	 */
+	if (ctl.err && ret == len)
+		ret = ctl.err;
+
+	elapsed = ktime_get_ns() - start;
+	WRITE_ONCE(zram->wb_last_pages, atomic_long_read(&ctl.written));
+	WRITE_ONCE(zram->wb_last_ns, elapsed);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -1041,6 +1243,243 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recompressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recompressor)];
+	size_t sz;
+
+	strscpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recompressor, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
+/*
+ * Recompress the slot with the secondary algorithm. Called with the slot
+ * locked; a slot that doesn't get smaller is marked ZRAM_INCOMPRESSIBLE so
+ * that later passes skip it.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page,
+			   unsigned int threshold)
+{
+	struct zcomp_strm *zstrm;
+	unsigned long handle, new_handle;
+	unsigned int old_len, new_len;
+	void *src, *dst;
+	int ret = 0;
+
+	handle = zram_get_handle(zram, index);
+	old_len = zram_get_obj_size(zram, index);
+	if (threshold && old_len < threshold)
+		return 0;
+
+	if (old_len != PAGE_SIZE)
+		zstrm = zcomp_stream_get(zram->comp);
+	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
+	dst = kmap_atomic(page);
+	if (old_len == PAGE_SIZE) {
+		memcpy(dst, src, PAGE_SIZE);
+	} else {
+		ret = zcomp_decompress(zstrm, src, old_len, dst);
+		zcomp_stream_put(zram->comp);
+	}
+	kunmap_atomic(dst);
+	zs_unmap_object(zram->mem_pool, handle);
+	if (WARN_ON(ret))
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &new_len);
+	kunmap_atomic(src);
+	if (ret) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	if (new_len >= huge_class_size || new_len >= old_len) {
+		zcomp_stream_put(zram->recomp);
+		zram_set_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+		return 0;
+	}
+
+	/*
+	 * We hold the slot lock, so we cannot enter direct reclaim here. If
+	 * the allocation fails the slot simply stays as it is.
+	 */
+	new_handle = zs_malloc(zram->mem_pool, new_len,
+			       __GFP_KSWAPD_RECLAIM |
+			       __GFP_NOWARN |
+			       __GFP_HIGHMEM |
+			       __GFP_MOVABLE);
+	if (IS_ERR((void *)new_handle)) {
+		zcomp_stream_put(zram->recomp);
+		return PTR_ERR((void *)new_handle);
+	}
+
+	dst = zs_map_object(zram->mem_pool, new_handle, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, new_len);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, new_handle);
+
+	zs_free(zram->mem_pool, handle);
+	atomic64_sub(old_len - new_len, &zram->stats.compr_data_size);
+	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
+		zram_clear_flag(zram, index, ZRAM_HUGE);
+		atomic64_dec(&zram->stats.huge_pages);
+	}
+	zram_set_handle(zram, index, new_handle);
+	zram_set_obj_size(zram, index, new_len);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	atomic64_inc(&zram->stats.num_recompress);
+
+	return 0;
+}
+
+#define RECOMPRESS_IDLE		(1 << 0)
+#define RECOMPRESS_HUGE		(1 << 1)
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages;
+	unsigned int threshold = 0;
+	int mode = 0;
+	char *args, *param, *val;
+	struct page *page;
+	ssize_t ret = len;
+	u32 index;
+
+	args = kstrdup(buf, GFP_KERNEL);
+	if (!args)
+		return -ENOMEM;
+
+	param = args;
+	while (*param) {
+		char *next = next_arg(param, &param, &val);
+
+		if (!val) {
+			ret = -EINVAL;
+			goto out_free;
+		}
+
+		if (!strcmp(param, "type")) {
+			if (!strcmp(val, "idle"))
+				mode = RECOMPRESS_IDLE;
+			else if (!strcmp(val, "huge"))
+				mode = RECOMPRESS_HUGE;
+			else if (!strcmp(val, "huge_idle"))
+				mode = RECOMPRESS_IDLE | RECOMPRESS_HUGE;
+			else {
+				ret = -EINVAL;
+				goto out_free;
+			}
+		} else if (!strcmp(param, "threshold")) {
+			if (kstrtouint(val, 10, &threshold) ||
+			    threshold >= PAGE_SIZE) {
+				ret = -EINVAL;
+				goto out_free;
+			}
+		} else {
+			ret = -EINVAL;
+			goto out_free;
+		}
+		param = next;
+	}
+
+	/* Refuse to blindly recompress every slot in the device. */
+	if (!mode && !threshold) {
+		ret = -EINVAL;
+		goto out_free;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp) {
+		ret = -EINVAL;
+		goto out_unlock;
+	}
+
+	nr_pages = zram->disksize >> PAGE_SHIFT;
+	for (index = 0; index < nr_pages; index++) {
+		int err;
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+		    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_RECOMP) ||
+		    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+			goto next;
+
+		if ((mode & RECOMPRESS_IDLE) &&
+		    !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+
+		if ((mode & RECOMPRESS_HUGE) &&
+		    !zram_test_flag(zram, index, ZRAM_HUGE))
+			goto next;
+
+		err = zram_recompress(zram, index, page, threshold);
+		if (err) {
+			zram_slot_unlock(zram, index);
+			ret = err;
+			break;
+		}
+next:
+		zram_slot_unlock(zram, index);
+		cond_resched();
+	}
+
+out_unlock:
+	up_read(&zram->init_lock);
+	__free_page(page);
+out_free:
+	kfree(args);
+	return ret;
+}
+#endif
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1058,6 +1497,40 @@ static ssize_t compact_store(struct device *dev,
 	return len;
 }
 
+static ssize_t async_write_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	down_read(&zram->init_lock);
+	val = zram->async_write;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+static ssize_t async_write_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	bool val;
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change async_write for initialized device\n");
+		return -EBUSY;
+	}
+	zram->async_write = val;
+	up_write(&zram->init_lock);
+
+	return len;
+}
+
 static ssize_t io_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1066,11 +1539,13 @@ static ssize_t io_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8llu\n",
+			"%8llu %8llu %8llu %8llu %8llu %8lu\n",
 			(u64)atomic64_read(&zram->stats.failed_reads),
 			(u64)atomic64_read(&zram->stats.failed_writes),
 			(u64)atomic64_read(&zram->stats.invalid_io),
-			(u64)atomic64_read(&zram->stats.notify_free));
+			(u64)atomic64_read(&zram->stats.notify_free),
+			(u64)atomic64_read(&zram->stats.async_pending),
+			atomic_long_read(&zram->stats.async_pending_max));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1118,14 +1593,22 @@ static ssize_t bd_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
 	struct zram *zram = dev_to_zram(dev);
+	u64 pages, ns, kbps = 0;
 	ssize_t ret;
 
 	down_read(&zram->init_lock);
+	pages = READ_ONCE(zram->wb_last_pages);
+	ns = READ_ONCE(zram->wb_last_ns);
+	if (ns)
+		kbps = div64_u64((pages << (PAGE_SHIFT - 10)) * NSEC_PER_SEC,
+				 ns);
 	ret = scnprintf(buf, PAGE_SIZE,
-		"%8llu %8llu %8llu\n",
+		"%8llu %8llu %8llu %8llu %8llu %8llu\n",
 			FOUR_K((u64)atomic64_read(&zram->stats.bd_count)),
 			FOUR_K((u64)atomic64_read(&zram->stats.bd_reads)),
-			FOUR_K((u64)atomic64_read(&zram->stats.bd_writes)));
+			FOUR_K((u64)atomic64_read(&zram->stats.bd_writes)),
+			(u64)atomic64_read(&zram->stats.bd_wb_bios),
+			FOUR_K(pages), kbps);
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1135,9 +1618,10 @@ static ssize_t bd_stat_show(struct device *dev,
 static ssize_t debug_stat_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
-	int version = 1;
+	int version = 2;
 	struct zram *zram = dev_to_zram(dev);
 	ssize_t ret;
+	int i;
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
@@ -1145,6 +1629,15 @@ static ssize_t debug_stat_show(struct device *dev,
 			version,
 			(u64)atomic64_read(&zram->stats.writestall),
 			(u64)atomic64_read(&zram->stats.miss_free));
+	/* async write batch size histogram, see ZRAM_ASYNC_HIST_BUCKETS */
+	for (i = 0; i < ZRAM_ASYNC_HIST_BUCKETS; i++)
+		ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%8llu%c",
+			(u64)atomic64_read(&zram->stats.async_batches[i]),
+			i == ZRAM_ASYNC_HIST_BUCKETS - 1 ? '\n' : ' ');
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	ret += scnprintf(buf + ret, PAGE_SIZE - ret, "%8llu\n",
+			(u64)atomic64_read(&zram->stats.num_recompress));
+#endif
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1205,6 +1698,9 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (zram_test_flag(zram, index, ZRAM_IDLE))
 		zram_clear_flag(zram, index, ZRAM_IDLE);
 
+	zram_clear_flag(zram, index, ZRAM_RECOMP);
+	zram_clear_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
 		atomic64_dec(&zram->stats.huge_pages);
@@ -1246,6 +1742,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 				struct bio *bio, bool partial_io)
 {
 	struct zcomp_strm *zstrm;
+	struct zcomp *comp;
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
@@ -1282,9 +1779,10 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 	}
 
 	size = zram_get_obj_size(zram, index);
+	comp = zram_slot_comp(zram, index);
 
 	if (size != PAGE_SIZE)
-		zstrm = zcomp_stream_get(zram->comp);
+		zstrm = zcomp_stream_get(comp);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1296,7 +1794,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
 	zram_slot_unlock(zram, index);
@@ -1575,6 +2073,232 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
+/*
+ * Async write mode: pages of a write are queued to a per-CPU list and
+ * compressed by a workqueue, so reclaim doesn't stall compressing pages in
+ * the submitter's context. A bio (or rw_page page) is completed only once
+ * every page of it has been compressed and stored.
+ */
+struct zram_async_io {
+	atomic_t pending;
+	struct bio *bio;		/* NULL for rw_page */
+	struct page *page;		/* rw_page only */
+	unsigned long start_time;
+	blk_status_t status;
+};
+
+struct zram_async_req {
+	struct llist_node node;
+	struct zram_async_io *aio;
+	struct page *page;
+	u32 index;
+};
+
+static void zram_async_io_put(struct zram *zram, struct zram_async_io *aio)
+{
+	if (!atomic_dec_and_test(&aio->pending))
+		return;
+
+	if (aio->bio) {
+		if (aio->status)
+			aio->bio->bi_status = aio->status;
+		bio_end_io_acct(aio->bio, aio->start_time);
+		bio_endio(aio->bio);
+	} else {
+		bdev_end_io_acct(zram->disk->part0, REQ_OP_WRITE,
+				 aio->start_time);
+		page_endio(aio->page, true,
+			   aio->status ? blk_status_to_errno(aio->status) : 0);
+	}
+	kfree(aio);
+}
+
+static void zram_async_account(struct zram *zram, long nr)
+{
+	unsigned long cur = atomic64_add_return(nr, &zram->stats.async_pending);
+	unsigned long old_max, cur_max;
+
+	if (nr < 0)
+		return;
+
+	old_max = atomic_long_read(&zram->stats.async_pending_max);
+	do {
+		cur_max = old_max;
+		if (cur > cur_max)
+			old_max = atomic_long_cmpxchg(
+				&zram->stats.async_pending_max, cur_max, cur);
+	} while (old_max != cur_max);
+}
+
+static void zram_async_work(struct work_struct *work)
+{
+	struct zram_async_queue *q = container_of(work, struct zram_async_queue,
+						  work);
+	struct zram *zram = q->zram;
+	struct zram_async_req *req, *next;
+	struct llist_node *list;
+	unsigned int nr = 0;
+
+	list = llist_reverse_order(llist_del_all(&q->list));
+	llist_for_each_entry_safe(req, next, list, node) {
+		struct bio_vec bv = {
+			.bv_page = req->page,
+			.bv_len = PAGE_SIZE,
+			.bv_offset = 0,
+		};
+
+		if (zram_bvec_rw(zram, &bv, req->index, 0, REQ_OP_WRITE,
+				 NULL) < 0)
+			req->aio->status = BLK_STS_IOERR;
+		zram_async_io_put(zram, req->aio);
+		kfree(req);
+		nr++;
+		cond_resched();
+	}
+
+	if (!nr)
+		return;
+	zram_async_account(zram, -nr);
+	atomic64_inc(&zram->stats.async_batches[min_t(unsigned int,
+			ilog2(nr), ZRAM_ASYNC_HIST_BUCKETS - 1)]);
+}
+
+/*
+ * Queue one page for compression on this CPU's list. The work is kicked
+ * when the list goes from empty to non-empty, everything added before the
+ * worker gets to run ends up in the same batch.
+ */
+static bool zram_async_queue_page(struct zram *zram, struct zram_async_io *aio,
+				  struct page *page, u32 index)
+{
+	struct zram_async_queue *q;
+	struct zram_async_req *req;
+
+	req = kmalloc(sizeof(*req), GFP_NOIO | __GFP_NOWARN);
+	if (!req)
+		return false;
+
+	req->aio = aio;
+	req->page = page;
+	req->index = index;
+	atomic_inc(&aio->pending);
+	zram_async_account(zram, 1);
+
+	q = get_cpu_ptr(zram->async_queues);
+	if (llist_add(&req->node, &q->list))
+		queue_work(zram->async_wq, &q->work);
+	put_cpu_ptr(zram->async_queues);
+	return true;
+}
+
+/*
+ * Only whole, page aligned writes are handled asynchronously, anything
+ * else needs a read-modify-write and takes the synchronous path.
+ */
+static bool zram_async_write_bio(struct zram *zram, struct bio *bio)
+{
+	struct zram_async_io *aio;
+	struct bio_vec bvec;
+	struct bvec_iter iter;
+	u32 index;
+
+	if (!zram->async_write || bio_op(bio) != REQ_OP_WRITE)
+		return false;
+	if (bio->bi_iter.bi_sector & (SECTORS_PER_PAGE - 1))
+		return false;
+	bio_for_each_segment(bvec, bio, iter) {
+		if (bvec.bv_offset || bvec.bv_len != PAGE_SIZE)
+			return false;
+	}
+
+	aio = kmalloc(sizeof(*aio), GFP_NOIO | __GFP_NOWARN);
+	if (!aio)
+		return false;
+
+	atomic_set(&aio->pending, 1);
+	aio->bio = bio;
+	aio->page = NULL;
+	aio->status = BLK_STS_OK;
+	aio->start_time = bio_start_io_acct(bio);
+
+	index = bio->bi_iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	bio_for_each_segment(bvec, bio, iter) {
+		if (!zram_async_queue_page(zram, aio, bvec.bv_page, index) &&
+		    zram_bvec_rw(zram, &bvec, index, 0, REQ_OP_WRITE, bio) < 0)
+			aio->status = BLK_STS_IOERR;
+		index++;
+	}
+
+	zram_async_io_put(zram, aio);
+	return true;
+}
+
+static int zram_async_write_page(struct zram *zram, struct page *page,
+				 u32 index)
+{
+	struct zram_async_io *aio;
+
+	aio = kmalloc(sizeof(*aio), GFP_NOIO | __GFP_NOWARN);
+	if (!aio)
+		return -ENOMEM;
+
+	atomic_set(&aio->pending, 1);
+	aio->bio = NULL;
+	aio->page = page;
+	aio->status = BLK_STS_OK;
+	if (!zram_async_queue_page(zram, aio, page, index)) {
+		kfree(aio);
+		return -ENOMEM;
+	}
+	/*
+	 * Our reference in ->pending keeps the worker from completing the
+	 * page, so the accounting can start once it is known to be queued.
+	 */
+	aio->start_time = bdev_start_io_acct(zram->disk->part0,
+			SECTORS_PER_PAGE, REQ_OP_WRITE, jiffies);
+	zram_async_io_put(zram, aio);
+	return 1;
+}
+
+static int zram_async_init(struct zram *zram)
+{
+	int cpu;
+
+	zram->async_queues = alloc_percpu(struct zram_async_queue);
+	if (!zram->async_queues)
+		return -ENOMEM;
+
+	zram->async_wq = alloc_workqueue("zram%d_async",
+			WQ_UNBOUND | WQ_MEM_RECLAIM | WQ_HIGHPRI, 0,
+			zram->disk->first_minor);
+	if (!zram->async_wq) {
+		free_percpu(zram->async_queues);
+		zram->async_queues = NULL;
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct zram_async_queue *q = per_cpu_ptr(zram->async_queues, cpu);
+
+		init_llist_head(&q->list);
+		INIT_WORK(&q->work, zram_async_work);
+		q->zram = zram;
+	}
+	return 0;
+}
+
+static void zram_async_destroy(struct zram *zram)
+{
+	if (!zram->async_wq)
+		return;
+
+	/* drains everything that is still queued */
+	destroy_workqueue(zram->async_wq);
+	zram->async_wq = NULL;
+	free_percpu(zram->async_queues);
+	zram->async_queues = NULL;
+}
+
 static void __zram_make_request(struct zram *zram, struct bio *bio)
 {
 	int offset;
@@ -1597,6 +2321,9 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 		break;
 	}
 
+	if (zram_async_write_bio(zram, bio))
+		return;
+
 	start_time = bio_start_io_acct(bio);
 	bio_for_each_segment(bvec, bio, iter) {
 		struct bio_vec bv = bvec;
@@ -1681,6 +2408,12 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 	bv.bv_len = PAGE_SIZE;
 	bv.bv_offset = 0;
 
+	if (zram->async_write && op_is_write(op)) {
+		ret = zram_async_write_page(zram, page, index);
+		if (ret > 0)
+			goto out;
+	}
+
 	start_time = bdev_start_io_acct(bdev->bd_disk->part0,
 			SECTORS_PER_PAGE, op, jiffies);
 	ret = zram_bvec_rw(zram, &bv, index, offset, op, NULL);
@@ -1724,12 +2457,19 @@ static void zram_reset_device(struct zram *zram)
 	set_capacity_and_notify(zram->disk, 0);
 	part_stat_set_all(zram->disk->part0, 0);
 
+	zram_async_destroy(zram);
+
 	/* I/O operation under all of CPU are done so let's free */
 	zram_meta_free(zram, zram->disksize);
 	zram->disksize = 0;
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(zram->comp);
 	zram->comp = NULL;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recomp)
+		zcomp_destroy(zram->recomp);
+	zram->recomp = NULL;
+#endif
 	reset_bdev(zram);
 
 	up_write(&zram->init_lock);
@@ -1768,6 +2508,33 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recompressor[0]) {
+		zram->recomp = zcomp_create(zram->recompressor);
+		if (IS_ERR(zram->recomp)) {
+			pr_err("Cannot initialise %s recompressing backend\n",
+					zram->recompressor);
+			err = PTR_ERR(zram->recomp);
+			zram->recomp = NULL;
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+	}
+#endif
+
+	if (zram->async_write) {
+		err = zram_async_init(zram);
+		if (err) {
+#ifdef CONFIG_ZRAM_MULTI_COMP
+			if (zram->recomp)
+				zcomp_destroy(zram->recomp);
+			zram->recomp = NULL;
+#endif
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+	}
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity_and_notify(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1854,11 +2621,17 @@ static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+static DEVICE_ATTR_RW(async_write);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
 static DEVICE_ATTR_RW(writeback_limit);
 static DEVICE_ATTR_RW(writeback_limit_enable);
+static DEVICE_ATTR_RW(writeback_max_inflight);
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -1871,11 +2644,17 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_async_write.attr,
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
 	&dev_attr_writeback_limit.attr,
 	&dev_attr_writeback_limit_enable.attr,
+	&dev_attr_writeback_max_inflight.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
@@ -1909,6 +2688,8 @@ static int zram_add(void)
 	init_rwsem(&zram->init_lock);
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
+	init_waitqueue_head(&zram->wb_wait);
+	zram->wb_max_inflight = ZRAM_WB_DEF_INFLIGHT;
 #endif
 
 	/* gendisk structure */
@@ -18,6 +18,8 @@
 #include <linux/rwsem.h>
 #include <linux/zsmalloc.h>
 #include <linux/crypto.h>
+#include <linux/llist.h>
+#include <linux/workqueue.h>
 
 #include "zcomp.h"
 
@@ -28,6 +30,16 @@
 #define ZRAM_SECTOR_PER_LOGICAL_BLOCK	\
 	(1 << (ZRAM_LOGICAL_BLOCK_SHIFT - SECTOR_SHIFT))
 
+/*
+ * Async write batch size histogram: bucket i counts batches of
+ * [2^i, 2^(i+1)) pages, the last bucket everything larger.
+ */
+#define ZRAM_ASYNC_HIST_BUCKETS	8
+
+/* Writeback bios in flight: default and upper bound of the sysfs knob */
+#define ZRAM_WB_DEF_INFLIGHT	8
+#define ZRAM_WB_MAX_INFLIGHT	64
+
 
 /*
  * ZRAM is mainly used for memory efficiency so we want to keep memory
@@ -49,6 +61,8 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page was recompressed by the secondary algorithm */
+	ZRAM_INCOMPRESSIBLE, /* secondary algorithm could not shrink it */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -82,17 +96,34 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	atomic64_t num_recompress;	/* no. of pages recompressed */
+#endif
+	atomic64_t async_pending;	/* no. of pages queued for compression */
+	atomic_long_t async_pending_max; /* max. pages queued for compression */
+	atomic64_t async_batches[ZRAM_ASYNC_HIST_BUCKETS];
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
 	atomic64_t bd_writes;		/* no. of writes from backing device */
+	atomic64_t bd_wb_bios;		/* no. of writeback bios submitted */
 #endif
 };
 
+/* Per-CPU list of pages waiting to be compressed by the worker pool */
+struct zram_async_queue {
+	struct llist_head list;
+	struct work_struct work;
+	struct zram *zram;
+};
+
 struct zram {
 	struct zram_table_entry *table;
 	struct zs_pool *mem_pool;
 	struct zcomp *comp;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	struct zcomp *recomp;
+#endif
 	struct gendisk *disk;
 	/* Prevent concurrent execution of device init */
 	struct rw_semaphore init_lock;
@@ -108,10 +139,17 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	char recompressor[CRYPTO_MAX_ALG_NAME];
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by disk->open_mutex */
+	/* compress writes from a worker pool instead of the submitter */
+	bool async_write;
+	struct workqueue_struct *async_wq;
+	struct zram_async_queue __percpu *async_queues;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	struct file *backing_dev;
 	spinlock_t wb_limit_lock;
@@ -120,6 +158,12 @@ struct zram {
 	struct block_device *bdev;
 	unsigned long *bitmap;
 	unsigned long nr_pages;
+	/* writeback bios allowed in flight per writeback_store() */
+	unsigned int wb_max_inflight;
+	wait_queue_head_t wb_wait;
+	/* outcome of the last writeback_store(), for bd_stat */
+	u64 wb_last_pages;
+	u64 wb_last_ns;
 #endif
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
@@ -271,11 +271,16 @@ static void dbs_update_util_handler(struct update_util_data *data, u64 time,
 {
 	struct cpu_dbs_info *cdbs = container_of(data, struct cpu_dbs_info, update_util);
 	struct policy_dbs_info *policy_dbs = cdbs->policy_dbs;
+	bool io_boost = READ_ONCE(policy_dbs->dbs_data->io_boost);
+	s64 sample_delay_ns;
 	u64 delta_ns, lst;
 
 	if (!cpufreq_this_cpu_can_update(policy_dbs->policy))
 		return;
 
+	if ((flags & SCHED_CPUFREQ_IOWAIT) && io_boost)
+		WRITE_ONCE(policy_dbs->iowait_pending, true);
+
 	/*
 	 * The work may not be allowed to be queued up right now.
 	 * Possible reasons:
@@ -292,7 +297,14 @@ static void dbs_update_util_handler(struct update_util_data *data, u64 time,
 	smp_rmb();
 	lst = READ_ONCE(policy_dbs->last_sample_time);
 	delta_ns = time - lst;
-	if ((s64)delta_ns < policy_dbs->sample_delay_ns)
+	sample_delay_ns = policy_dbs->sample_delay_ns;
+	/*
+	 * Completed I/O makes it likely that more is about to be submitted,
+	 * so evaluate the boost sooner than the load alone would be.
+	 */
+	if (io_boost && READ_ONCE(policy_dbs->iowait_pending))
+		sample_delay_ns >>= 2;
+	if ((s64)delta_ns < sample_delay_ns)
 		return;
 
 	/*
@@ -521,6 +533,7 @@ int cpufreq_dbs_governor_start(struct cpufreq_policy *policy)
 
 	policy_dbs->is_shared = policy_is_shared(policy);
 	policy_dbs->rate_mult = 1;
+	policy_dbs->iowait_pending = false;
 
 	sampling_rate = dbs_data->sampling_rate;
 	ignore_nice = dbs_data->ignore_nice_load;
@@ -44,6 +44,7 @@ struct dbs_data {
 	unsigned int sampling_down_factor;
 	unsigned int up_threshold;
 	unsigned int io_is_busy;
+	unsigned int io_boost;
 };
 
 static inline struct dbs_data *to_dbs_data(struct gov_attr_set *attr_set)
@@ -97,6 +98,7 @@ struct policy_dbs_info {
 	/* Status indicators */
 	bool is_shared;		/* This object is used by multiple CPUs */
 	bool work_in_progress;	/* Work is being queued up or in progress */
+	bool iowait_pending;	/* A task woke up from I/O wait since last sample */
 };
 
 static inline void gov_update_sample_delay(struct policy_dbs_info *policy_dbs,
@@ -25,6 +25,7 @@
 #define MICRO_FREQUENCY_MIN_SAMPLE_RATE		(10000)
 #define MIN_FREQUENCY_UP_THRESHOLD		(1)
 #define MAX_FREQUENCY_UP_THRESHOLD		(100)
+#define MIN_IOWAIT_BOOST			(12)
 
 static struct od_ops od_ops;
 
@@ -128,6 +129,32 @@ static void dbs_freq_increase(struct cpufreq_policy *policy, unsigned int freq)
 			CPUFREQ_RELATION_LE : CPUFREQ_RELATION_HE);
 }
 
+/*
+ * While tasks keep waking up from I/O wait, double a load floor on every
+ * sample, starting from MIN_IOWAIT_BOOST, and halve it again on samples
+ * without any.  Sustained I/O thus ramps the CPU up quickly and keeps
+ * device queues fed, while a single completion barely moves it.
+ */
+static unsigned int od_iowait_boost(struct policy_dbs_info *policy_dbs,
+				    unsigned int load)
+{
+	struct od_policy_dbs_info *dbs_info = to_dbs_info(policy_dbs);
+	unsigned int boost = dbs_info->iowait_boost;
+
+	if (READ_ONCE(policy_dbs->iowait_pending)) {
+		WRITE_ONCE(policy_dbs->iowait_pending, false);
+		boost = boost ? min(boost << 1, 100U) : MIN_IOWAIT_BOOST;
+	} else {
+		boost >>= 1;
+		if (boost < MIN_IOWAIT_BOOST)
+			boost = 0;
+	}
+
+	dbs_info->iowait_boost = boost;
+
+	return max(load, boost);
+}
+
 /*
  * Every sampling_rate, we check, if current idle time is less than 20%
  * (default), then we try to increase frequency. Else, we adjust the frequency
@@ -141,6 +168,14 @@ static void od_update(struct cpufreq_policy *policy)
 	struct od_dbs_tuners *od_tuners = dbs_data->tuners;
 	unsigned int load = dbs_update(policy);
 
+	if (dbs_data->io_boost) {
+		load = od_iowait_boost(policy_dbs, load);
+	} else {
+		/* io_boost may have been turned off with a boost under way */
+		WRITE_ONCE(policy_dbs->iowait_pending, false);
+		dbs_info->iowait_boost = 0;
+	}
+
 	dbs_info->freq_lo = 0;
 
 	/* Check for frequency increase */
@@ -220,6 +255,21 @@ static ssize_t io_is_busy_store(struct gov_attr_set *attr_set, const char *buf,
 	return count;
 }
 
+static ssize_t io_boost_store(struct gov_attr_set *attr_set, const char *buf,
+			      size_t count)
+{
+	struct dbs_data *dbs_data = to_dbs_data(attr_set);
+	unsigned int input;
+	int ret;
+
+	ret = sscanf(buf, "%u", &input);
+	if (ret != 1)
+		return -EINVAL;
+	dbs_data->io_boost = !!input;
+
+	return count;
+}
+
 static ssize_t up_threshold_store(struct gov_attr_set *attr_set,
 				  const char *buf, size_t count)
 {
@@ -319,10 +369,12 @@ gov_show_one_common(up_threshold);
 gov_show_one_common(sampling_down_factor);
 gov_show_one_common(ignore_nice_load);
 gov_show_one_common(io_is_busy);
+gov_show_one_common(io_boost);
 gov_show_one(od, powersave_bias);
 
 gov_attr_rw(sampling_rate);
 gov_attr_rw(io_is_busy);
+gov_attr_rw(io_boost);
 gov_attr_rw(up_threshold);
 gov_attr_rw(sampling_down_factor);
 gov_attr_rw(ignore_nice_load);
@@ -335,6 +387,7 @@ static struct attribute *od_attrs[] = {
 	&ignore_nice_load.attr,
 	&powersave_bias.attr,
 	&io_is_busy.attr,
+	&io_boost.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(od);
@@ -393,6 +446,7 @@ static void od_start(struct cpufreq_policy *policy)
 	struct od_policy_dbs_info *dbs_info = to_dbs_info(policy->governor_data);
 
 	dbs_info->sample_type = OD_NORMAL_SAMPLE;
+	dbs_info->iowait_boost = 0;
 	ondemand_powersave_bias_init(policy);
 }
 
@@ -13,6 +13,7 @@ struct od_policy_dbs_info {
 	unsigned int freq_lo;
 	unsigned int freq_lo_delay_us;
 	unsigned int freq_hi_delay_us;
+	unsigned int iowait_boost;	/* Load floor in percent */
 	unsigned int sample_type:1;
 };
 
@@ -19,6 +19,9 @@
 #include <linux/sched.h>
 #include <linux/module.h>
 #include <linux/kvm_para.h>
+#include <linux/percpu.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <trace/events/power.h>
 
 static unsigned int guest_halt_poll_ns __read_mostly = 200000;
@@ -40,6 +43,62 @@ module_param(guest_halt_poll_grow_start, uint, 0644);
 static bool guest_halt_poll_allow_shrink __read_mostly = true;
 module_param(guest_halt_poll_allow_shrink, bool, 0644);
 
+/*
+ * If non-zero, size the per-cpu poll window so that this percentage of the
+ * recently observed wakeups would have arrived while polling, instead of
+ * growing and shrinking it by fixed factors.
+ */
+static unsigned int guest_halt_poll_percentile __read_mostly;
+module_param(guest_halt_poll_percentile, uint, 0644);
+
+/*
+ * Wakeup interval histogram, bucket n counts intervals below 2^(n + 11) ns,
+ * i.e. the first bucket covers up to 2us and the last one everything above
+ * about 8s.  Counts are halved once HALTPOLL_HIST_MAX samples accumulate so
+ * the distribution follows the workload.
+ */
+#define HALTPOLL_BUCKETS	23
+#define HALTPOLL_HIST_MAX	1024
+
+struct haltpoll_hist {
+	unsigned int count[HALTPOLL_BUCKETS];
+	unsigned int total;
+	/* Time spent in a poll that timed out, part of the next interval */
+	u64 pending_ns;
+};
+
+static DEFINE_PER_CPU(struct haltpoll_hist, haltpoll_hist);
+
+/* One line per bucket: its upper bound in ns and its count */
+static int haltpoll_hist_show(struct seq_file *s, void *unused)
+{
+	struct haltpoll_hist *hist = s->private;
+	int i;
+
+	for (i = 0; i < HALTPOLL_BUCKETS - 1; i++)
+		seq_printf(s, "%llu\t%u\n", 1ULL << (i + 11),
+			   READ_ONCE(hist->count[i]));
+	seq_printf(s, "inf\t%u\n", READ_ONCE(hist->count[i]));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(haltpoll_hist);
+
+static void __init haltpoll_hist_init(void)
+{
+	struct dentry *dir;
+	char name[16];
+	int cpu;
+
+	dir = debugfs_create_dir("cpuidle_haltpoll", NULL);
+	for_each_possible_cpu(cpu) {
+		snprintf(name, sizeof(name), "cpu%d", cpu);
+		debugfs_create_file(name, 0444, dir,
+				    per_cpu_ptr(&haltpoll_hist, cpu),
+				    &haltpoll_hist_fops);
+	}
+}
+
 /**
  * haltpoll_select - selects the next idle state to enter
  * @drv: cpuidle driver containing state data
@@ -107,6 +166,70 @@ static void adjust_poll_limit(struct cpuidle_device *dev, u64 block_ns)
 	}
 }
 
+static void haltpoll_hist_add(struct haltpoll_hist *hist, u64 interval_ns)
+{
+	int i, bucket = 0;
+
+	if (interval_ns >= 2048)
+		bucket = min(ilog2(interval_ns) - 10, HALTPOLL_BUCKETS - 1);
+
+	hist->count[bucket]++;
+	if (++hist->total < HALTPOLL_HIST_MAX)
+		return;
+
+	hist->total = 0;
+	for (i = 0; i < HALTPOLL_BUCKETS; i++) {
+		hist->count[i] >>= 1;
+		hist->total += hist->count[i];
+	}
+}
+
+static void adjust_poll_limit_percentile(struct cpuidle_device *dev,
+					 struct haltpoll_hist *hist)
+{
+	unsigned int pct = min(guest_halt_poll_percentile, 100U);
+	unsigned int sum = 0, target;
+	u64 val;
+	int i;
+
+	target = DIV_ROUND_UP(hist->total * pct, 100);
+	for (i = 0; i < HALTPOLL_BUCKETS - 1; i++) {
+		sum += hist->count[i];
+		if (sum >= target)
+			break;
+	}
+
+	/*
+	 * If the window needed to catch that many wakeups is longer than
+	 * polling is allowed to run, polling mostly burns time, so stop.
+	 */
+	val = 1ULL << (i + 11);
+	if (val > guest_halt_poll_ns)
+		val = guest_halt_poll_allow_shrink ? 0 : guest_halt_poll_ns;
+
+	if (val > dev->poll_limit_ns)
+		trace_guest_halt_poll_ns_grow(val, dev->poll_limit_ns);
+	else if (val < dev->poll_limit_ns)
+		trace_guest_halt_poll_ns_shrink(val, dev->poll_limit_ns);
+	dev->poll_limit_ns = val;
+}
+
+static void haltpoll_reflect_percentile(struct cpuidle_device *dev, int index)
+{
+	struct haltpoll_hist *hist = this_cpu_ptr(&haltpoll_hist);
+	u64 interval_ns = hist->pending_ns + dev->last_residency_ns;
+
+	/* A poll that timed out only tells us the interval is longer. */
+	if (index == 0 && dev->poll_time_limit) {
+		hist->pending_ns = interval_ns;
+		return;
+	}
+
+	hist->pending_ns = 0;
+	haltpoll_hist_add(hist, interval_ns);
+	adjust_poll_limit_percentile(dev, hist);
+}
+
 /**
  * haltpoll_reflect - update variables and update poll time
  * @dev: the CPU
@@ -116,7 +239,9 @@ static void haltpoll_reflect(struct cpuidle_device *dev, int index)
 {
 	dev->last_state_idx = index;
 
-	if (index != 0)
+	if (guest_halt_poll_percentile)
+		haltpoll_reflect_percentile(dev, index);
+	else if (index != 0)
 		adjust_poll_limit(dev, dev->last_residency_ns);
 }
 
@@ -143,8 +268,10 @@ static struct cpuidle_governor haltpoll_governor = {
 
 static int __init init_haltpoll(void)
 {
-	if (kvm_para_available())
+	if (kvm_para_available()) {
+		haltpoll_hist_init();
 		return cpuidle_register_governor(&haltpoll_governor);
+	}
 
 	return 0;
 }
@@ -99,12 +99,22 @@
  *      select the given idle state instead of the candidate one.
  *
  * 3. By default, select the candidate state.
+ *
+ * If CONFIG_CPU_IDLE_GOV_TEO_IRQ_TIMINGS is set, the time till the next
+ * interrupt predicted by the interrupt timings code is used instead of the
+ * sleep length in the steps above whenever it is shorter.  The number of
+ * times the measured idle duration fell into the same bin as the predicted
+ * one (prediction "hits") and into a different one ("misses") is exposed in
+ * debugfs.
  */
 
 #include <linux/cpuidle.h>
+#include <linux/debugfs.h>
+#include <linux/interrupt.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/sched/clock.h>
+#include <linux/seq_file.h>
 #include <linux/tick.h>
 
 /*
@@ -140,6 +150,9 @@ struct teo_bin {
  * @total: Grand total of the "intercepts" and "hits" mertics for all bins.
  * @next_recent_idx: Index of the next @recent_idx entry to update.
  * @recent_idx: Indices of bins corresponding to recent "intercepts".
+ * @irq_length_ns: Time till the predicted next interrupt, if used, or 0.
+ * @irq_hits: Number of predictions matching the measured idle duration.
+ * @irq_misses: Number of predictions not matching it.
  */
 struct teo_cpu {
 	s64 time_span_ns;
@@ -148,10 +161,81 @@ struct teo_cpu {
 	unsigned int total;
 	int next_recent_idx;
 	int recent_idx[NR_RECENT];
+#ifdef CONFIG_CPU_IDLE_GOV_TEO_IRQ_TIMINGS
+	s64 irq_length_ns;
+	unsigned long irq_hits;
+	unsigned long irq_misses;
+#endif
 };
 
 static DEFINE_PER_CPU(struct teo_cpu, teo_cpus);
 
+#ifdef CONFIG_CPU_IDLE_GOV_TEO_IRQ_TIMINGS
+static s64 teo_irq_length(struct teo_cpu *cpu_data)
+{
+	return cpu_data->irq_length_ns;
+}
+
+/**
+ * teo_irq_account - Record whether or not the last interrupt prediction held.
+ * @cpu_data: Governor data for the target CPU.
+ * @hit: Whether or not the measured idle duration fell into the predicted bin.
+ */
+static void teo_irq_account(struct teo_cpu *cpu_data, bool hit)
+{
+	if (!cpu_data->irq_length_ns)
+		return;
+
+	if (hit)
+		cpu_data->irq_hits++;
+	else
+		cpu_data->irq_misses++;
+
+	cpu_data->irq_length_ns = 0;
+}
+
+/**
+ * teo_irq_duration - Cap the expected idle duration by the next interrupt.
+ * @cpu_data: Governor data for the target CPU.
+ * @duration_ns: Time till the closest timer event.
+ *
+ * Must be called with interrupts disabled, as required by
+ * irq_timings_next_event().
+ */
+static s64 teo_irq_duration(struct teo_cpu *cpu_data, s64 duration_ns)
+{
+	u64 now = cpu_data->time_span_ns;
+	u64 next_irq = irq_timings_next_event(now);
+	s64 irq_ns;
+
+	if (next_irq == U64_MAX)
+		return duration_ns;
+
+	irq_ns = next_irq - now;
+	if (irq_ns >= duration_ns)
+		return duration_ns;
+
+	/* 0 means "no prediction", so make an immediate one count too. */
+	cpu_data->irq_length_ns = max_t(s64, irq_ns, 1);
+
+	return irq_ns;
+}
+#else
+static s64 teo_irq_length(struct teo_cpu *cpu_data)
+{
+	return 0;
+}
+
+static void teo_irq_account(struct teo_cpu *cpu_data, bool hit)
+{
+}
+
+static s64 teo_irq_duration(struct teo_cpu *cpu_data, s64 duration_ns)
+{
+	return duration_ns;
+}
+#endif
+
 /**
  * teo_update - Update CPU metrics after wakeup.
  * @drv: cpuidle driver containing state data.
@@ -160,7 +244,7 @@ static DEFINE_PER_CPU(struct teo_cpu, teo_cpus);
 static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 {
 	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
-	int i, idx_timer = 0, idx_duration = 0;
+	int i, idx_timer = 0, idx_duration = 0, idx_irq = 0;
 	u64 measured_ns;
 
 	if (cpu_data->time_span_ns >= cpu_data->sleep_length_ns) {
@@ -214,8 +298,13 @@ static void teo_update(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 			if (target_residency_ns <= measured_ns)
 				idx_duration = i;
 		}
+
+		if (target_residency_ns <= teo_irq_length(cpu_data))
+			idx_irq = i;
 	}
 
+	teo_irq_account(cpu_data, idx_irq == idx_duration);
+
 	i = cpu_data->next_recent_idx++;
 	if (cpu_data->next_recent_idx >= NR_RECENT)
 		cpu_data->next_recent_idx = 0;
@@ -310,6 +399,13 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	duration_ns = tick_nohz_get_sleep_length(&delta_tick);
 	cpu_data->sleep_length_ns = duration_ns;
 
+	/*
+	 * The sleep length is still used for the "hits" and "intercepts"
+	 * accounting, but an interrupt predicted to arrive before the closest
+	 * timer event shortens the expected idle duration.
+	 */
+	duration_ns = teo_irq_duration(cpu_data, duration_ns);
+
 	/* Check if there is any choice in the first place. */
 	if (drv->state_count < 2) {
 		idx = 0;
@@ -526,8 +622,44 @@ static struct cpuidle_governor teo_governor = {
 	.reflect =	teo_reflect,
 };
 
+#ifdef CONFIG_CPU_IDLE_GOV_TEO_IRQ_TIMINGS
+static int teo_irq_timings_show(struct seq_file *s, void *unused)
+{
+	int cpu;
+
+	seq_puts(s, "cpu\thits\tmisses\n");
+	for_each_possible_cpu(cpu) {
+		struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, cpu);
+
+		seq_printf(s, "%d\t%lu\t%lu\n", cpu,
+			   READ_ONCE(cpu_data->irq_hits),
+			   READ_ONCE(cpu_data->irq_misses));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(teo_irq_timings);
+
+static void __init teo_irq_timings_init(void)
+{
+	struct dentry *dir;
+
+	irq_timings_enable();
+
+	dir = debugfs_create_dir("cpuidle_teo", NULL);
+	debugfs_create_file("irq_timings", 0444, dir, NULL,
+			    &teo_irq_timings_fops);
+}
+#else
+static inline void teo_irq_timings_init(void)
+{
+}
+#endif
+
 static int __init teo_governor_init(void)
 {
+	teo_irq_timings_init();
+
 	return cpuidle_register_governor(&teo_governor);
 }
 
@@ -228,6 +228,14 @@ static vm_fault_t __dev_dax_pud_fault(struct dev_dax *dev_dax,
 }
 #endif /* !CONFIG_HAVE_ARCH_TRANSPARENT_HUGEPAGE_PUD */
 
+/*
+ * Faults are always served at the device alignment: with a 1G aligned
+ * device every fault installs a whole PUD and, since the pages are compound
+ * (see vmemmap_shift), only touches the head page. Prefaulting a large
+ * mapping is therefore done with MAP_POPULATE or MADV_POPULATE_(READ|WRITE),
+ * which can be issued on disjoint ranges from several threads in parallel
+ * as faults only take the mmap_lock for read.
+ */
 static vm_fault_t dev_dax_huge_fault(struct vm_fault *vmf,
 		enum page_entry_size pe_size)
 {
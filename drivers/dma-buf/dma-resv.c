@@ -60,6 +60,10 @@ EXPORT_SYMBOL(reservation_ww_class);
 /* Mask for the lower fence pointer bits */
 #define DMA_RESV_LIST_MASK	0x3
 
+/* Mask for the usage bits in &dma_resv.signaled, see dma_resv_fences_changed() */
+#define DMA_RESV_SIGNALED_MASK	0x3
+#define DMA_RESV_SEQ_STEP	(DMA_RESV_SIGNALED_MASK + 1)
+
 struct dma_resv_list {
 	struct rcu_head rcu;
 	u32 num_fences, max_fences;
@@ -135,6 +139,9 @@ void dma_resv_init(struct dma_resv *obj)
 	ww_mutex_init(&obj->lock, &reservation_ww_class);
 
 	RCU_INIT_POINTER(obj->fences, NULL);
+	/* No fences at all, which is trivially signaled */
+	obj->seq = 0;
+	obj->signaled = DMA_RESV_USAGE_BOOKKEEP;
 }
 EXPORT_SYMBOL(dma_resv_init);
 
@@ -159,6 +166,35 @@ static inline struct dma_resv_list *dma_resv_fences_list(struct dma_resv *obj)
 	return rcu_dereference_check(obj->fences, dma_resv_held(obj));
 }
 
+/*
+ * Invalidate the cached signaled state after fences were added or replaced.
+ * Pairs with the smp_load_acquire() in dma_resv_iter_first_unlocked(): a
+ * reader which sees the new sequence number also sees the new fences.
+ */
+static void dma_resv_fences_changed(struct dma_resv *obj)
+{
+	dma_resv_assert_held(obj);
+	smp_store_release(&obj->seq, obj->seq + DMA_RESV_SEQ_STEP);
+}
+
+/* Check if all fences of @usage were already found signaled at @seq */
+static bool dma_resv_signaled_cached(struct dma_resv *obj, unsigned long seq,
+				     enum dma_resv_usage usage)
+{
+	unsigned long signaled = READ_ONCE(obj->signaled);
+
+	return (signaled & ~DMA_RESV_SIGNALED_MASK) == seq &&
+		(signaled & DMA_RESV_SIGNALED_MASK) >= usage;
+}
+
+static void dma_resv_cache_signaled(struct dma_resv *obj, unsigned long seq,
+				    enum dma_resv_usage usage)
+{
+	/* Racing with other readers is fine, at worst we lose a cache hit */
+	if (!dma_resv_signaled_cached(obj, seq, usage))
+		WRITE_ONCE(obj->signaled, seq | usage);
+}
+
 /**
  * dma_resv_reserve_fences - Reserve space to add fences to a dma_resv object.
  * @obj: reservation object
@@ -300,6 +336,7 @@ void dma_resv_add_fence(struct dma_resv *obj, struct dma_fence *fence,
 		    dma_fence_is_signaled(old)) {
 			dma_resv_list_set(fobj, i, fence, usage);
 			dma_fence_put(old);
+			dma_resv_fences_changed(obj);
 			return;
 		}
 	}
@@ -310,6 +347,7 @@ void dma_resv_add_fence(struct dma_resv *obj, struct dma_fence *fence,
 	dma_resv_list_set(fobj, i, fence, usage);
 	/* pointer update must be visible before we extend the num_fences */
 	smp_store_mb(fobj->num_fences, count);
+	dma_resv_fences_changed(obj);
 }
 EXPORT_SYMBOL(dma_resv_add_fence);
 
@@ -347,6 +385,7 @@ void dma_resv_replace_fences(struct dma_resv *obj, uint64_t context,
 		dma_resv_list_set(list, i, dma_fence_get(replacement), usage);
 		dma_fence_put(old);
 	}
+	dma_resv_fences_changed(obj);
 }
 EXPORT_SYMBOL(dma_resv_replace_fences);
 
@@ -402,10 +441,27 @@ static void dma_resv_iter_walk_unlocked(struct dma_resv_iter *cursor)
  * or similar needs to check for this with dma_resv_iter_is_restarted(). For
  * this reason prefer the locked dma_resv_iter_first() whenver possible.
  *
+ * If a previous unlocked iteration already found every fence of the same or
+ * a wider usage signaled, and no fence has been added since, this returns
+ * NULL without walking the fences again.
+ *
  * Returns the first fence from an unlocked dma_resv obj.
  */
 struct dma_fence *dma_resv_iter_first_unlocked(struct dma_resv_iter *cursor)
 {
+	unsigned long seq;
+
+	seq = smp_load_acquire(&cursor->obj->seq);
+	if (dma_resv_signaled_cached(cursor->obj, seq, cursor->usage)) {
+		dma_fence_put(cursor->fence);
+		cursor->fence = NULL;
+		cursor->index = 0;
+		cursor->num_fences = 0;
+		cursor->fences = NULL;
+		cursor->is_restarted = true;
+		return NULL;
+	}
+
 	rcu_read_lock();
 	do {
 		dma_resv_iter_restart_unlocked(cursor);
@@ -413,6 +469,9 @@ struct dma_fence *dma_resv_iter_first_unlocked(struct dma_resv_iter *cursor)
 	} while (dma_resv_fences_list(cursor->obj) != cursor->fences);
 	rcu_read_unlock();
 
+	if (!cursor->fence)
+		dma_resv_cache_signaled(cursor->obj, seq, cursor->usage);
+
 	return cursor->fence;
 }
 EXPORT_SYMBOL(dma_resv_iter_first_unlocked);
@@ -536,6 +595,7 @@ int dma_resv_copy_fences(struct dma_resv *dst, struct dma_resv *src)
 	dma_resv_iter_end(&cursor);
 
 	list = rcu_replace_pointer(dst->fences, list, dma_resv_held(dst));
+	dma_resv_fences_changed(dst);
 	dma_resv_list_free(list);
 	return 0;
 }
@@ -18,10 +18,24 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 static struct dma_heap *sys_heap;
+static struct dma_heap *sys_huge_heap;
+
+/**
+ * struct system_heap_info - per-heap allocation policy
+ * @name:	name of the heap device
+ * @huge_only:	only hand out 1MB pages, rounding the buffer size up to match
+ *		and failing rather than falling back to smaller orders
+ */
+struct system_heap_info {
+	const char *name;
+	bool huge_only;
+};
 
 struct system_heap_buffer {
 	struct dma_heap *heap;
@@ -45,6 +59,12 @@ struct dma_heap_attachment {
 #define HIGH_ORDER_GFP  (((GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN \
 				| __GFP_NORETRY) & ~__GFP_RECLAIM) \
 				| __GFP_COMP)
+/*
+ * Huge-page-only allocations have nothing to fall back to, so let the page
+ * allocator reclaim and compact for them instead of giving up straight away.
+ */
+#define HUGE_ONLY_GFP (GFP_HIGHUSER | __GFP_ZERO | __GFP_NOWARN \
+		       | __GFP_RETRY_MAYFAIL | __GFP_COMP)
 static gfp_t order_flags[] = {HIGH_ORDER_GFP, MID_ORDER_GFP, LOW_ORDER_GFP};
 /*
  * The selection of the orders used for allocation (1MB, 64K, 4K) is designed
@@ -55,6 +75,252 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, MID_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * Pages freed by buffers, and pages allocated ahead of time by the refill
+ * worker, are kept in per-order pools so that the allocation path can hand
+ * out memory that has already been zeroed. Pages coming back from a buffer
+ * go on the dirty list and only move to the clean list once the worker has
+ * cleared them. The pools are bounded by pool_size_mb and are drained by a
+ * shrinker under memory pressure.
+ */
+struct system_heap_pool {
+	spinlock_t lock;
+	struct list_head clean;
+	struct list_head dirty;
+	unsigned int nr_clean;
+	unsigned int nr_dirty;
+	unsigned int order;
+};
+
+static struct system_heap_pool pools[NUM_ORDERS];
+/* Total number of PAGE_SIZE pages held by all pools, clean or dirty. */
+static atomic_long_t pool_pages;
+static unsigned long pool_last_shrink;
+static struct work_struct pool_work;
+static struct shrinker pool_shrinker;
+
+static unsigned int pool_size_mb;
+module_param(pool_size_mb, uint, 0644);
+MODULE_PARM_DESC(pool_size_mb,
+		 "Memory in MiB kept pre-zeroed by the system heap (0 = disabled)");
+
+static unsigned long pool_max_pages(void)
+{
+	return (unsigned long)READ_ONCE(pool_size_mb) << (20 - PAGE_SHIFT);
+}
+
+/* The refill worker gives each order an equal share of the pool. */
+static unsigned int pool_target(struct system_heap_pool *pool)
+{
+	return (pool_max_pages() / NUM_ORDERS) >> pool->order;
+}
+
+static bool pool_reserve(struct system_heap_pool *pool)
+{
+	long nr = 1L << pool->order;
+
+	if (atomic_long_add_return(nr, &pool_pages) > pool_max_pages()) {
+		atomic_long_sub(nr, &pool_pages);
+		return false;
+	}
+	return true;
+}
+
+static void pool_unreserve(struct system_heap_pool *pool)
+{
+	atomic_long_sub(1L << pool->order, &pool_pages);
+}
+
+static struct page *pool_take(struct system_heap_pool *pool)
+{
+	struct page *page;
+	bool refill;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(&pool->clean, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		pool->nr_clean--;
+	}
+	refill = pool->nr_clean < pool_target(pool) / 2;
+	spin_unlock(&pool->lock);
+
+	if (page)
+		pool_unreserve(pool);
+	if (refill)
+		queue_work(system_unbound_wq, &pool_work);
+
+	return page;
+}
+
+/* Returns false if the pool is full and the caller must free the page. */
+static bool pool_put(struct system_heap_pool *pool, struct page *page)
+{
+	if (!pool_reserve(pool))
+		return false;
+
+	spin_lock(&pool->lock);
+	list_add(&page->lru, &pool->dirty);
+	pool->nr_dirty++;
+	spin_unlock(&pool->lock);
+
+	return true;
+}
+
+static struct system_heap_pool *pool_for_order(unsigned int order)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (orders[i] == order)
+			return &pools[i];
+	return NULL;
+}
+
+static void pool_clear_page(struct page *page, unsigned int order)
+{
+	unsigned int i;
+
+	for (i = 0; i < (1U << order); i++) {
+		clear_highpage(page + i);
+		cond_resched();
+	}
+}
+
+static void pool_clear_dirty(struct system_heap_pool *pool)
+{
+	struct page *page;
+
+	for (;;) {
+		spin_lock(&pool->lock);
+		page = list_first_entry_or_null(&pool->dirty, struct page, lru);
+		if (page) {
+			list_del(&page->lru);
+			pool->nr_dirty--;
+		}
+		spin_unlock(&pool->lock);
+
+		if (!page)
+			break;
+
+		pool_clear_page(page, pool->order);
+
+		spin_lock(&pool->lock);
+		list_add(&page->lru, &pool->clean);
+		pool->nr_clean++;
+		spin_unlock(&pool->lock);
+	}
+}
+
+static void pool_refill(struct system_heap_pool *pool, gfp_t gfp)
+{
+	struct page *page;
+
+	while (READ_ONCE(pool->nr_clean) < pool_target(pool)) {
+		if (!pool_reserve(pool))
+			break;
+
+		page = alloc_pages(gfp, pool->order);
+		if (!page) {
+			pool_unreserve(pool);
+			break;
+		}
+
+		spin_lock(&pool->lock);
+		list_add_tail(&page->lru, &pool->clean);
+		pool->nr_clean++;
+		spin_unlock(&pool->lock);
+
+		cond_resched();
+	}
+}
+
+static void system_heap_pool_work(struct work_struct *work)
+{
+	/* Don't refill straight after the shrinker asked for memory back. */
+	bool backoff = time_before(jiffies, READ_ONCE(pool_last_shrink) + HZ);
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		pool_clear_dirty(&pools[i]);
+		if (!backoff)
+			pool_refill(&pools[i], order_flags[i]);
+	}
+}
+
+static unsigned long pool_shrink_list(struct system_heap_pool *pool,
+				      bool dirty, unsigned long nr_to_scan)
+{
+	struct list_head *list = dirty ? &pool->dirty : &pool->clean;
+	unsigned long freed = 0;
+	struct page *page;
+
+	while (freed < nr_to_scan) {
+		spin_lock(&pool->lock);
+		if (list_empty(list)) {
+			spin_unlock(&pool->lock);
+			break;
+		}
+		/* The tail holds the pages that have been pooled the longest. */
+		page = list_last_entry(list, struct page, lru);
+		list_del(&page->lru);
+		if (dirty)
+			pool->nr_dirty--;
+		else
+			pool->nr_clean--;
+		spin_unlock(&pool->lock);
+
+		__free_pages(page, pool->order);
+		pool_unreserve(pool);
+		freed += 1UL << pool->order;
+	}
+
+	return freed;
+}
+
+static unsigned long pool_shrink_count(struct shrinker *shrink,
+				       struct shrink_control *sc)
+{
+	unsigned long count = atomic_long_read(&pool_pages);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long pool_shrink_scan(struct shrinker *shrink,
+				      struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+	int i;
+
+	WRITE_ONCE(pool_last_shrink, jiffies);
+
+	/* Dirty pages would need clearing before reuse, so drop those first. */
+	for (i = 0; i < NUM_ORDERS && freed < sc->nr_to_scan; i++)
+		freed += pool_shrink_list(&pools[i], true, sc->nr_to_scan - freed);
+	for (i = 0; i < NUM_ORDERS && freed < sc->nr_to_scan; i++)
+		freed += pool_shrink_list(&pools[i], false, sc->nr_to_scan - freed);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+static int system_heap_pool_init(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		spin_lock_init(&pools[i].lock);
+		INIT_LIST_HEAD(&pools[i].clean);
+		INIT_LIST_HEAD(&pools[i].dirty);
+		pools[i].order = orders[i];
+	}
+	INIT_WORK(&pool_work, system_heap_pool_work);
+
+	pool_shrinker.count_objects = pool_shrink_count;
+	pool_shrinker.scan_objects = pool_shrink_scan;
+	pool_shrinker.seeks = DEFAULT_SEEKS;
+	return register_shrinker(&pool_shrinker, "dmabuf-system-heap");
+}
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -287,16 +553,26 @@ static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct sg_table *table;
 	struct scatterlist *sg;
+	bool pooled = false;
 	int i;
 
 	table = &buffer->sg_table;
 	for_each_sgtable_sg(table, sg, i) {
 		struct page *page = sg_page(sg);
+		unsigned int order = compound_order(page);
+		struct system_heap_pool *pool = pool_for_order(order);
 
-		__free_pages(page, compound_order(page));
+		if (pool && pool_put(pool, page)) {
+			pooled = true;
+			continue;
+		}
+		__free_pages(page, order);
 	}
 	sg_free_table(table);
 	kfree(buffer);
+
+	if (pooled)
+		queue_work(system_unbound_wq, &pool_work);
 }
 
 static const struct dma_buf_ops system_heap_buf_ops = {
@@ -313,7 +589,8 @@ static const struct dma_buf_ops system_heap_buf_ops = {
 };
 
 static struct page *alloc_largest_available(unsigned long size,
-					    unsigned int max_order)
+					    unsigned int max_order,
+					    bool huge_only)
 {
 	struct page *page;
 	int i;
@@ -324,8 +601,13 @@ static struct page *alloc_largest_available(unsigned long size,
 		if (max_order < orders[i])
 			continue;
 
-		page = alloc_pages(order_flags[i], orders[i]);
-		if (!page)
+		page = pool_take(&pools[i]);
+		if (page)
+			return page;
+
+		page = alloc_pages(huge_only ? HUGE_ONLY_GFP : order_flags[i],
+				   orders[i]);
+		if (!page && !huge_only)
 			continue;
 		return page;
 	}
@@ -337,9 +619,10 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 					    unsigned long fd_flags,
 					    unsigned long heap_flags)
 {
+	const struct system_heap_info *info = dma_heap_get_drvdata(heap);
 	struct system_heap_buffer *buffer;
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
-	unsigned long size_remaining = len;
+	unsigned long size_remaining;
 	unsigned int max_order = orders[0];
 	struct dma_buf *dmabuf;
 	struct sg_table *table;
@@ -348,6 +631,10 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	struct page *page, *tmp_page;
 	int i, ret = -ENOMEM;
 
+	if (info->huge_only)
+		len = ALIGN(len, PAGE_SIZE << orders[0]);
+	size_remaining = len;
+
 	buffer = kzalloc(sizeof(*buffer), GFP_KERNEL);
 	if (!buffer)
 		return ERR_PTR(-ENOMEM);
@@ -369,7 +656,8 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 			goto free_buffer;
 		}
 
-		page = alloc_largest_available(size_remaining, max_order);
+		page = alloc_largest_available(size_remaining, max_order,
+					       info->huge_only);
 		if (!page)
 			goto free_buffer;
 
@@ -422,18 +710,39 @@ static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
 };
 
+static const struct system_heap_info system_heap_info = {
+	.name = "system",
+};
+
+static const struct system_heap_info system_huge_heap_info = {
+	.name = "system-huge",
+	.huge_only = true,
+};
+
 static int system_heap_create(void)
 {
 	struct dma_heap_export_info exp_info;
+	int ret;
 
-	exp_info.name = "system";
+	ret = system_heap_pool_init();
+	if (ret)
+		return ret;
+
+	exp_info.name = system_heap_info.name;
 	exp_info.ops = &system_heap_ops;
-	exp_info.priv = NULL;
+	exp_info.priv = (void *)&system_heap_info;
 
 	sys_heap = dma_heap_add(&exp_info);
 	if (IS_ERR(sys_heap))
 		return PTR_ERR(sys_heap);
 
+	exp_info.name = system_huge_heap_info.name;
+	exp_info.priv = (void *)&system_huge_heap_info;
+
+	sys_huge_heap = dma_heap_add(&exp_info);
+	if (IS_ERR(sys_huge_heap))
+		return PTR_ERR(sys_huge_heap);
+
 	return 0;
 }
 module_init(system_heap_create);
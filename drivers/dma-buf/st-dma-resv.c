@@ -8,6 +8,7 @@
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/dma-resv.h>
+#include <linux/ktime.h>
 
 #include "selftest.h"
 
@@ -23,7 +24,7 @@ static const struct dma_fence_ops fence_ops = {
 	.get_timeline_name = fence_name,
 };
 
-static struct dma_fence *alloc_fence(void)
+static struct dma_fence *alloc_fence_context(u64 context)
 {
 	struct dma_fence *f;
 
@@ -31,10 +32,15 @@ static struct dma_fence *alloc_fence(void)
 	if (!f)
 		return NULL;
 
-	dma_fence_init(f, &fence_ops, &fence_lock, 0, 0);
+	dma_fence_init(f, &fence_ops, &fence_lock, context, 0);
 	return f;
 }
 
+static struct dma_fence *alloc_fence(void)
+{
+	return alloc_fence_context(0);
+}
+
 static int sanitycheck(void *arg)
 {
 	struct dma_resv resv;
@@ -106,6 +112,148 @@ static int test_signaling(void *arg)
 	return r;
 }
 
+static int test_signaled_cache(void *arg)
+{
+	enum dma_resv_usage usage = (unsigned long)arg;
+	struct dma_fence *f1, *f2;
+	struct dma_resv resv;
+	int r = -ENOMEM;
+
+	f1 = alloc_fence_context(dma_fence_context_alloc(1));
+	f2 = alloc_fence_context(dma_fence_context_alloc(1));
+	if (!f1 || !f2)
+		goto err_put;
+
+	dma_fence_enable_sw_signaling(f1);
+	dma_fence_enable_sw_signaling(f2);
+
+	dma_resv_init(&resv);
+	r = dma_resv_lock(&resv, NULL);
+	if (r) {
+		pr_err("Resv locking failed\n");
+		goto err_free;
+	}
+
+	r = dma_resv_reserve_fences(&resv, 2);
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		goto err_unlock;
+	}
+
+	dma_resv_add_fence(&resv, f1, usage);
+	dma_fence_signal(f1);
+	if (!dma_resv_test_signaled(&resv, usage) ||
+	    !dma_resv_test_signaled(&resv, usage)) {
+		pr_err("Resv not reporting signaled\n");
+		r = -EINVAL;
+		goto err_unlock;
+	}
+
+	/* Adding a fence must invalidate the cached state */
+	dma_resv_add_fence(&resv, f2, usage);
+	if (dma_resv_test_signaled(&resv, usage) ||
+	    dma_resv_test_signaled(&resv, DMA_RESV_USAGE_BOOKKEEP)) {
+		pr_err("Resv reporting stale signaled state\n");
+		r = -EINVAL;
+		goto err_unlock;
+	}
+	dma_fence_signal(f2);
+	if (!dma_resv_test_signaled(&resv, usage)) {
+		pr_err("Resv not reporting signaled\n");
+		r = -EINVAL;
+		goto err_unlock;
+	}
+err_unlock:
+	dma_resv_unlock(&resv);
+err_free:
+	dma_resv_fini(&resv);
+err_put:
+	if (f2)
+		dma_fence_signal(f2);
+	dma_fence_put(f2);
+	dma_fence_put(f1);
+	return r;
+}
+
+#define BENCH_FENCES	64
+#define BENCH_LOOPS	1024
+
+static int bench_test_signaled(void *arg)
+{
+	enum dma_resv_usage usage = (unsigned long)arg;
+	struct dma_fence *fences[BENCH_FENCES] = {};
+	struct dma_resv_iter cursor;
+	struct dma_fence *fence;
+	struct dma_resv resv;
+	s64 walk_ns, cached_ns;
+	ktime_t start;
+	int r, i, loop;
+
+	dma_resv_init(&resv);
+	r = dma_resv_lock(&resv, NULL);
+	if (r) {
+		pr_err("Resv locking failed\n");
+		goto err_free;
+	}
+
+	r = dma_resv_reserve_fences(&resv, BENCH_FENCES);
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		dma_resv_unlock(&resv);
+		goto err_free;
+	}
+
+	for (i = 0; i < BENCH_FENCES; i++) {
+		fences[i] = alloc_fence_context(dma_fence_context_alloc(1));
+		if (!fences[i]) {
+			r = -ENOMEM;
+			dma_resv_unlock(&resv);
+			goto err_free;
+		}
+		dma_fence_enable_sw_signaling(fences[i]);
+		dma_resv_add_fence(&resv, fences[i], usage);
+	}
+	for (i = 0; i < BENCH_FENCES; i++)
+		dma_fence_signal(fences[i]);
+
+	/* What every check used to cost: query each fence in turn */
+	start = ktime_get();
+	for (loop = 0; loop < BENCH_LOOPS; loop++) {
+		dma_resv_for_each_fence(&cursor, &resv, usage, fence) {
+			if (!dma_fence_is_signaled(fence)) {
+				r = -EINVAL;
+				break;
+			}
+		}
+	}
+	walk_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	dma_resv_unlock(&resv);
+
+	start = ktime_get();
+	for (loop = 0; loop < BENCH_LOOPS; loop++) {
+		if (!dma_resv_test_signaled(&resv, usage))
+			r = -EINVAL;
+	}
+	cached_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (r) {
+		pr_err("Resv not reporting signaled\n");
+		goto err_free;
+	}
+
+	pr_info("%d signaled fences: %lld ns per walk, %lld ns per cached test\n",
+		BENCH_FENCES, div_s64(walk_ns, BENCH_LOOPS),
+		div_s64(cached_ns, BENCH_LOOPS));
+err_free:
+	dma_resv_fini(&resv);
+	for (i = 0; i < BENCH_FENCES; i++) {
+		if (fences[i])
+			dma_fence_signal(fences[i]);
+		dma_fence_put(fences[i]);
+	}
+	return r;
+}
+
 static int test_for_each(void *arg)
 {
 	enum dma_resv_usage usage = (unsigned long)arg;
@@ -298,6 +446,8 @@ int dma_resv(void)
 	static const struct subtest tests[] = {
 		SUBTEST(sanitycheck),
 		SUBTEST(test_signaling),
+		SUBTEST(test_signaled_cache),
+		SUBTEST(bench_test_signaled),
 		SUBTEST(test_for_each),
 		SUBTEST(test_for_each_unlocked),
 		SUBTEST(test_get_fences),
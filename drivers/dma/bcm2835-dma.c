@@ -40,6 +40,7 @@
 #define BCM2835_DMA_CHAN_NAME_SIZE 8
 #define BCM2835_DMA_BULK_MASK  BIT(0)
 #define BCM2711_DMA_MEMCPY_CHAN 14
+#define BCM2835_DMA_DESC_CACHE 4
 
 struct bcm2835_dma_cfg_data {
 	u64	dma_mask;
@@ -94,8 +95,14 @@ struct bcm2835_chan {
 
 	int ch;
 	struct bcm2835_desc *desc;
+	struct list_head linked;
 	struct dma_pool *cb_pool;
 
+	/* retired descriptors whose control blocks are kept for reuse */
+	spinlock_t cache_lock;
+	struct list_head desc_cache;
+	unsigned int cache_len;
+
 	void __iomem *chan_base;
 	int irq_number;
 	unsigned int irq_flags;
@@ -111,6 +118,7 @@ struct bcm2835_desc {
 	enum dma_transfer_direction dir;
 
 	unsigned int frames;
+	unsigned int max_frames;
 	size_t size;
 
 	bool cyclic;
@@ -401,17 +409,76 @@ static void bcm2835_dma_free_cb_chain(struct bcm2835_desc *desc)
 {
 	size_t i;
 
-	for (i = 0; i < desc->frames; i++)
+	for (i = 0; i < desc->max_frames && desc->cb_list[i].cb; i++)
 		dma_pool_free(desc->c->cb_pool, desc->cb_list[i].cb,
 			      desc->cb_list[i].paddr);
 
 	kfree(desc);
 }
 
+/*
+ * Retired descriptors keep their control blocks and are handed out again
+ * by bcm2835_dma_create_cb_chain(), so that a client streaming similarly
+ * sized scatterlists does not go through kmalloc and the dma_pool for every
+ * prep call.
+ */
+static struct bcm2835_desc *bcm2835_dma_get_cached_desc(
+	struct bcm2835_chan *c, size_t frames)
+{
+	struct bcm2835_desc *d, *found = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->cache_lock, flags);
+	list_for_each_entry(d, &c->desc_cache, vd.node) {
+		if (d->max_frames >= frames) {
+			list_del(&d->vd.node);
+			c->cache_len--;
+			found = d;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&c->cache_lock, flags);
+
+	if (found) {
+		memset(&found->vd, 0, sizeof(found->vd));
+		found->frames = 0;
+		found->size = 0;
+	}
+
+	return found;
+}
+
 static void bcm2835_dma_desc_free(struct virt_dma_desc *vd)
 {
-	bcm2835_dma_free_cb_chain(
-		container_of(vd, struct bcm2835_desc, vd));
+	struct bcm2835_desc *d = container_of(vd, struct bcm2835_desc, vd);
+	struct bcm2835_chan *c = d->c;
+	unsigned long flags;
+
+	spin_lock_irqsave(&c->cache_lock, flags);
+	if (c->cache_len < BCM2835_DMA_DESC_CACHE) {
+		list_add(&d->vd.node, &c->desc_cache);
+		c->cache_len++;
+		d = NULL;
+	}
+	spin_unlock_irqrestore(&c->cache_lock, flags);
+
+	if (d)
+		bcm2835_dma_free_cb_chain(d);
+}
+
+static void bcm2835_dma_drain_desc_cache(struct bcm2835_chan *c)
+{
+	struct bcm2835_desc *d, *tmp;
+	unsigned long flags;
+	LIST_HEAD(head);
+
+	spin_lock_irqsave(&c->cache_lock, flags);
+	list_splice_init(&c->desc_cache, &head);
+	c->cache_len = 0;
+	spin_unlock_irqrestore(&c->cache_lock, flags);
+
+	list_for_each_entry_safe(d, tmp, &head, vd.node)
+		bcm2835_dma_free_cb_chain(d);
 }
 
 static void bcm2835_dma_create_cb_set_length(
@@ -516,10 +583,14 @@ static struct bcm2835_desc *bcm2835_dma_create_cb_chain(
 	if (!frames)
 		return NULL;
 
-	/* allocate and setup the descriptor. */
-	d = kzalloc(struct_size(d, cb_list, frames), gfp);
-	if (!d)
-		return NULL;
+	/* reuse a retired descriptor or allocate and setup a new one. */
+	d = bcm2835_dma_get_cached_desc(c, frames);
+	if (!d) {
+		d = kzalloc(struct_size(d, cb_list, frames), gfp);
+		if (!d)
+			return NULL;
+		d->max_frames = frames;
+	}
 
 	d->c = c;
 	d->dir = direction;
@@ -531,8 +602,9 @@ static struct bcm2835_desc *bcm2835_dma_create_cb_chain(
 	 */
 	for (frame = 0, total_len = 0; frame < frames; d->frames++, frame++) {
 		cb_entry = &d->cb_list[frame];
-		cb_entry->cb = dma_pool_alloc(c->cb_pool, gfp,
-					      &cb_entry->paddr);
+		if (!cb_entry->cb)
+			cb_entry->cb = dma_pool_alloc(c->cb_pool, gfp,
+						      &cb_entry->paddr);
 		if (!cb_entry->cb)
 			goto error_cb;
 
@@ -746,6 +818,126 @@ static void bcm2835_dma_abort(struct bcm2835_chan *c)
 	}
 }
 
+static inline u32 bcm2835_dma_cb_addr(struct bcm2835_chan *c,
+				      dma_addr_t paddr)
+{
+	return (c->is_40bit_channel || c->is_2712) ?
+		to_40bit_cbaddr(paddr) : paddr;
+}
+
+static void bcm2835_dma_set_next_cb(struct bcm2835_chan *c,
+				    struct bcm2835_desc *d, u32 next)
+{
+	struct bcm2835_dma_cb *control_block = d->cb_list[d->frames - 1].cb;
+
+	if (c->is_40bit_channel)
+		((struct bcm2711_dma40_scb *)control_block)->next_cb = next;
+	else
+		control_block->next = next;
+}
+
+static bool bcm2835_dma_desc_has_cb(struct bcm2835_chan *c,
+				    struct bcm2835_desc *d, u32 addr)
+{
+	unsigned int i;
+
+	if (!addr)
+		return false;
+
+	for (i = 0; i < d->frames; i++)
+		if (bcm2835_dma_cb_addr(c, d->cb_list[i].paddr) == addr)
+			return true;
+
+	return false;
+}
+
+static bool bcm2835_dma_chain_has_cb(struct bcm2835_chan *c, u32 addr)
+{
+	struct bcm2835_desc *d;
+
+	if (bcm2835_dma_desc_has_cb(c, c->desc, addr))
+		return true;
+
+	list_for_each_entry(d, &c->linked, vd.node)
+		if (bcm2835_dma_desc_has_cb(c, d, addr))
+			return true;
+
+	return false;
+}
+
+/*
+ * Append @d to the chain the hardware is currently walking by pointing the
+ * last control block of @tail at it. The controller fetches the next-CB
+ * address together with each control block, so the link only counts if the
+ * channel had not yet loaded the last block of @tail when we wrote it (or has
+ * already picked up the new address). Check that after the write; if the
+ * link is not proven, clear it and leave @d for the interrupt handler to
+ * start.
+ */
+static bool bcm2835_dma_link_desc(struct bcm2835_chan *c,
+				  struct bcm2835_desc *tail,
+				  struct bcm2835_desc *d)
+{
+	u32 first = bcm2835_dma_cb_addr(c, d->cb_list[0].paddr);
+	u32 last = bcm2835_dma_cb_addr(c, tail->cb_list[tail->frames - 1].paddr);
+	u32 addr, next;
+	bool linked;
+
+	bcm2835_dma_set_next_cb(c, d, 0);
+	bcm2835_dma_set_next_cb(c, tail, first);
+
+	/* make the control block update visible before sampling the channel */
+	mb();
+
+	if (c->is_40bit_channel) {
+		addr = readl(c->chan_base + BCM2711_DMA40_CB);
+		next = readl(c->chan_base + BCM2711_DMA40_NEXT_CB);
+	} else {
+		addr = readl(c->chan_base + BCM2835_DMA_ADDR);
+		next = readl(c->chan_base + BCM2835_DMA_NEXTCB);
+	}
+
+	if (addr == last)
+		linked = next == first;
+	else
+		linked = bcm2835_dma_chain_has_cb(c, addr) ||
+			 bcm2835_dma_desc_has_cb(c, d, addr);
+
+	if (!linked)
+		bcm2835_dma_set_next_cb(c, tail, 0);
+
+	return linked;
+}
+
+/*
+ * Chain issued descriptors behind the running one so that back-to-back
+ * transfers continue without waiting for the completion interrupt. This is
+ * limited to DREQ paced channels: a free-running memcpy could retire a short
+ * chain before bcm2835_dma_link_desc() gets to sample the channel state.
+ */
+static void bcm2835_dma_link_issued(struct bcm2835_chan *c)
+{
+	struct virt_dma_desc *vd;
+	struct bcm2835_desc *tail, *d;
+
+	if (!c->desc || c->desc->cyclic || !c->dreq)
+		return;
+
+	while ((vd = vchan_next_desc(&c->vc))) {
+		d = to_bcm2835_dma_desc(&vd->tx);
+		if (d->cyclic)
+			break;
+
+		tail = list_empty(&c->linked) ? c->desc :
+			list_last_entry(&c->linked, struct bcm2835_desc,
+					vd.node);
+		if (!bcm2835_dma_link_desc(c, tail, d))
+			break;
+
+		list_move_tail(&vd->node, &c->linked);
+	}
+}
+
 static void bcm2835_dma_start_desc(struct bcm2835_chan *c)
 {
 	struct virt_dma_desc *vd = vchan_next_desc(&c->vc);
@@ -760,6 +952,10 @@ static void bcm2835_dma_start_desc(struct bcm2835_chan *c)
 
 	c->desc = d = to_bcm2835_dma_desc(&vd->tx);
 
+	/* drop a link left over from an earlier run of a reused descriptor */
+	if (!d->cyclic)
+		bcm2835_dma_set_next_cb(c, d, 0);
+
 	if (c->is_40bit_channel) {
 		writel(to_40bit_cbaddr(d->cb_list[0].paddr),
 		       c->chan_base + BCM2711_DMA40_CB);
@@ -813,9 +1009,27 @@ static irqreturn_t bcm2835_dma_callback(int irq, void *data)
 		if (d->cyclic) {
 			/* call the cyclic callback */
 			vchan_cyclic_callback(&d->vd);
-		} else if (!readl(c->chan_base + BCM2835_DMA_ADDR)) {
-			vchan_cookie_complete(&c->desc->vd);
-			bcm2835_dma_start_desc(c);
+		} else {
+			u32 addr = readl(c->chan_base + BCM2835_DMA_ADDR);
+
+			/*
+			 * Everything ahead of the control block the channel
+			 * is on has finished. One interrupt may cover several
+			 * linked descriptors.
+			 */
+			while (d && !bcm2835_dma_desc_has_cb(c, d, addr)) {
+				vchan_cookie_complete(&d->vd);
+				d = list_first_entry_or_null(&c->linked,
+							     struct bcm2835_desc,
+							     vd.node);
+				if (d)
+					list_del(&d->vd.node);
+				c->desc = d;
+			}
+
+			if (!c->desc)
+				bcm2835_dma_start_desc(c);
+			bcm2835_dma_link_issued(c);
 		}
 	}
 
@@ -852,6 +1066,7 @@ static void bcm2835_dma_free_chan_resources(struct dma_chan *chan)
 
 	vchan_free_chan_resources(&c->vc);
 	free_irq(c->irq_number, c);
+	bcm2835_dma_drain_desc_cache(c);
 	dma_pool_destroy(c->cb_pool);
 
 	dev_dbg(c->vc.chan.device->dev, "Freeing DMA channel %u\n", c->ch);
@@ -919,6 +1134,13 @@ static enum dma_status bcm2835_dma_tx_status(struct dma_chan *chan,
 
 	spin_lock_irqsave(&c->vc.lock, flags);
 	vd = vchan_find_desc(&c->vc, cookie);
+	if (!vd) {
+		struct bcm2835_desc *d;
+
+		list_for_each_entry(d, &c->linked, vd.node)
+			if (d->vd.tx.cookie == cookie)
+				vd = &d->vd;
+	}
 	if (vd) {
 		txstate->residue =
 			bcm2835_dma_desc_size(to_bcm2835_dma_desc(&vd->tx));
@@ -962,8 +1184,11 @@ static void bcm2835_dma_issue_pending(struct dma_chan *chan)
 	unsigned long flags;
 
 	spin_lock_irqsave(&c->vc.lock, flags);
-	if (vchan_issue_pending(&c->vc) && !c->desc)
-		bcm2835_dma_start_desc(c);
+	if (vchan_issue_pending(&c->vc)) {
+		if (!c->desc)
+			bcm2835_dma_start_desc(c);
+		bcm2835_dma_link_issued(c);
+	}
 
 	spin_unlock_irqrestore(&c->vc.lock, flags);
 }
@@ -1169,6 +1394,7 @@ static int bcm2835_dma_terminate_all(struct dma_chan *chan)
 		bcm2835_dma_abort(c);
 	}
 
+	list_splice_tail_init(&c->linked, &head);
 	vchan_get_all_descriptors(&c->vc, &head);
 	spin_unlock_irqrestore(&c->vc.lock, flags);
 	vchan_dma_desc_free_list(&c->vc, &head);
@@ -1194,6 +1420,9 @@ static int bcm2835_dma_chan_init(struct bcm2835_dmadev *d, int chan_id,
 
 	c->vc.desc_free = bcm2835_dma_desc_free;
 	vchan_init(&c->vc, &d->ddev);
+	INIT_LIST_HEAD(&c->linked);
+	INIT_LIST_HEAD(&c->desc_cache);
+	spin_lock_init(&c->cache_lock);
 
 	c->chan_base = BCM2835_DMA_CHANIO(d->base, chan_id);
 	c->ch = chan_id;
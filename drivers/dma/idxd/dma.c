@@ -148,11 +148,15 @@ static int idxd_dma_alloc_chan_resources(struct dma_chan *chan)
 	return 0;
 }
 
+static void idxd_dma_issue_pending(struct dma_chan *dma_chan);
+
 static void idxd_dma_free_chan_resources(struct dma_chan *chan)
 {
 	struct idxd_wq *wq = to_idxd_wq(chan);
 	struct device *dev = &wq->idxd->pdev->dev;
 
+	/* don't leave descriptors behind that were never issued */
+	idxd_dma_issue_pending(chan);
 	idxd_wq_put(wq);
 	dev_dbg(dev, "%s: client_count: %d\n", __func__,
 		idxd_wq_refcount(wq));
@@ -166,28 +170,31 @@ static enum dma_status idxd_dma_tx_status(struct dma_chan *dma_chan,
 }
 
 /*
- * issue_pending() does not need to do anything since tx_submit() does the job
- * already.
+ * tx_submit() only queues the descriptor, everything queued since the last
+ * call is pushed to the wq here under a single wq reference and barrier.
  */
 static void idxd_dma_issue_pending(struct dma_chan *dma_chan)
 {
+	struct idxd_dma_chan *idxd_chan;
+	struct llist_node *head;
+
+	idxd_chan = container_of(dma_chan, struct idxd_dma_chan, chan);
+	head = llist_del_all(&idxd_chan->submit_llist);
+	if (!head)
+		return;
+
+	idxd_submit_desc_list(idxd_chan->wq, llist_reverse_order(head));
 }
 
 static dma_cookie_t idxd_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 {
-	struct dma_chan *c = tx->chan;
-	struct idxd_wq *wq = to_idxd_wq(c);
+	struct idxd_dma_chan *idxd_chan;
 	dma_cookie_t cookie;
-	int rc;
 	struct idxd_desc *desc = container_of(tx, struct idxd_desc, txd);
 
+	idxd_chan = container_of(tx->chan, struct idxd_dma_chan, chan);
 	cookie = dma_cookie_assign(tx);
-
-	rc = idxd_submit_desc(wq, desc);
-	if (rc < 0) {
-		idxd_free_desc(wq, desc);
-		return rc;
-	}
+	llist_add(&desc->llnode, &idxd_chan->submit_llist);
 
 	return cookie;
 }
@@ -263,6 +270,7 @@ static int idxd_register_dma_channel(struct idxd_wq *wq)
 	if (!idxd_chan)
 		return -ENOMEM;
 
+	init_llist_head(&idxd_chan->submit_llist);
 	chan = &idxd_chan->chan;
 	chan->device = dma;
 	list_add_tail(&chan->device_node, &dma->channels);
@@ -173,6 +173,8 @@ enum idxd_complete_type {
 struct idxd_dma_chan {
 	struct dma_chan chan;
 	struct idxd_wq *wq;
+	/* descriptors from tx_submit() waiting for issue_pending() */
+	struct llist_head submit_llist;
 };
 
 struct idxd_wq {
@@ -648,6 +650,7 @@ int idxd_wq_request_irq(struct idxd_wq *wq);
 
 /* submission */
 int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc);
+int idxd_submit_desc_list(struct idxd_wq *wq, struct llist_node *head);
 struct idxd_desc *idxd_alloc_desc(struct idxd_wq *wq, enum idxd_op_type optype);
 void idxd_free_desc(struct idxd_wq *wq, struct idxd_desc *desc);
 int idxd_enqcmds(struct idxd_wq *wq, void __iomem *portal, const void *desc);
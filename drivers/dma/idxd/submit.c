@@ -163,15 +163,9 @@ int idxd_enqcmds(struct idxd_wq *wq, void __iomem *portal, const void *desc)
 	return rc;
 }
 
-int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc)
+static int idxd_submit_get(struct idxd_wq *wq)
 {
-	struct idxd_device *idxd = wq->idxd;
-	struct idxd_irq_entry *ie = NULL;
-	u32 desc_flags = desc->hw->flags;
-	void __iomem *portal;
-	int rc;
-
-	if (idxd->state != IDXD_DEV_ENABLED)
+	if (wq->idxd->state != IDXD_DEV_ENABLED)
 		return -EIO;
 
 	if (!percpu_ref_tryget_live(&wq->wq_active)) {
@@ -180,20 +174,21 @@ int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc)
 			return -ENXIO;
 	}
 
-	portal = idxd_wq_portal_addr(wq);
+	return 0;
+}
 
-	/*
-	 * The wmb() flushes writes to coherent DMA data before
-	 * possibly triggering a DMA read. The wmb() is necessary
-	 * even on UP because the recipient is a device.
-	 */
-	wmb();
+/* Called with a wq_active reference held and after the wmb(). */
+static int __idxd_submit_desc(struct idxd_wq *wq, void __iomem *portal,
+			      struct idxd_desc *desc)
+{
+	struct idxd_irq_entry *ie = NULL;
+	int rc;
 
 	/*
 	 * Pending the descriptor to the lockless list for the irq_entry
 	 * that we designated the descriptor to.
 	 */
-	if (desc_flags & IDXD_OP_FLAG_RCI) {
+	if (desc->hw->flags & IDXD_OP_FLAG_RCI) {
 		ie = &wq->ie;
 		desc->hw->int_handle = ie->int_handle;
 		llist_add(&desc->llnode, &ie->pending_llist);
@@ -204,7 +199,6 @@ int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc)
 	} else {
 		rc = idxd_enqcmds(wq, portal, desc->hw);
 		if (rc < 0) {
-			percpu_ref_put(&wq->wq_active);
 			/* abort operation frees the descriptor */
 			if (ie)
 				llist_abort_desc(wq, ie, desc);
@@ -212,6 +206,79 @@ int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc)
 		}
 	}
 
-	percpu_ref_put(&wq->wq_active);
 	return 0;
 }
+
+int idxd_submit_desc(struct idxd_wq *wq, struct idxd_desc *desc)
+{
+	void __iomem *portal;
+	int rc;
+
+	rc = idxd_submit_get(wq);
+	if (rc < 0)
+		return rc;
+
+	portal = idxd_wq_portal_addr(wq);
+
+	/*
+	 * The wmb() flushes writes to coherent DMA data before
+	 * possibly triggering a DMA read. The wmb() is necessary
+	 * even on UP because the recipient is a device.
+	 */
+	wmb();
+
+	rc = __idxd_submit_desc(wq, portal, desc);
+
+	percpu_ref_put(&wq->wq_active);
+	return rc;
+}
+
+/**
+ * idxd_submit_desc_list - submit a list of descriptors to a wq in one go
+ * @wq: work queue to submit to
+ * @head: descriptors linked through their llnode, in submission order
+ *
+ * Like calling idxd_submit_desc() for each descriptor, but the wq reference
+ * and the write barrier are only taken once for the whole list, which is
+ * what dominates submission of many small operations. A descriptor that
+ * cannot be submitted is completed as aborted and freed.
+ *
+ * Return: the number of descriptors submitted.
+ */
+int idxd_submit_desc_list(struct idxd_wq *wq, struct llist_node *head)
+{
+	struct idxd_desc *desc, *n;
+	void __iomem *portal = NULL;
+	int submitted = 0;
+	bool active;
+
+	active = !idxd_submit_get(wq);
+	if (active) {
+		portal = idxd_wq_portal_addr(wq);
+
+		/* See idxd_submit_desc(). */
+		wmb();
+	}
+
+	llist_for_each_entry_safe(desc, n, head, llnode) {
+		if (!active) {
+			idxd_dma_complete_txd(desc, IDXD_COMPLETE_ABORT, true);
+			continue;
+		}
+
+		if (!__idxd_submit_desc(wq, portal, desc)) {
+			submitted++;
+			continue;
+		}
+
+		/* the abort already ran the callback of an RCI descriptor */
+		if (desc->hw->flags & IDXD_OP_FLAG_RCI)
+			idxd_free_desc(wq, desc);
+		else
+			idxd_dma_complete_txd(desc, IDXD_COMPLETE_ABORT, true);
+	}
+
+	if (active)
+		percpu_ref_put(&wq->wq_active);
+	return submitted;
+}
@@ -42,6 +42,7 @@
  * Thomas Hellström <thomas-at-tungstengraphics-dot-com>
  */
 
+#include <linux/bitmap.h>
 #include <linux/export.h>
 #include <linux/interval_tree_generic.h>
 #include <linux/seq_file.h>
@@ -73,10 +74,14 @@
  *
  * drm_mm maintains a stack of most recently freed holes, which of all
  * simplistic datastructures seems to be a fairly decent approach to clustering
- * allocations and avoiding too much fragmentation. This means free space
- * searches are O(num_holes). Given that all the fancy features drm_mm supports
- * something better would be fairly complex and since gfx thrashing is a fairly
- * steep cliff not a real concern. Removing a node again is O(1).
+ * allocations and avoiding too much fragmentation. Holes are also tracked in
+ * trees sorted by size and address, and in segregated lists of size classes
+ * that let a &DRM_MM_INSERT_CLASS search find a suitable hole in constant time
+ * in the common case. Constrained searches are still O(num_holes) in the worst
+ * case.
+ * Given that all the fancy features drm_mm supports something better would be
+ * fairly complex and since gfx thrashing is a fairly steep cliff not a real
+ * concern. Removing a node again is O(1).
  *
  * drm_mm supports a few features: Alignment and range restrictions can be
  * supplied. Furthermore every &drm_mm_node has a color value (which is just an
@@ -263,6 +268,37 @@ static void insert_hole_addr(struct rb_root *root, struct drm_mm_node *node)
 	rb_insert_augmented(&node->rb_hole_addr, root, &augment_callbacks);
 }
 
+/*
+ * There is a size class per power of two, holding the holes of at least
+ * 1 << class but less than 2 << class.
+ */
+static unsigned int hole_class(u64 size)
+{
+	return size ? fls64(size) - 1 : 0;
+}
+
+static u64 hole_class_min(unsigned int class)
+{
+	return 1ULL << class;
+}
+
+static void add_hole_class(struct drm_mm *mm, struct drm_mm_node *node)
+{
+	unsigned int class = hole_class(node->hole_size);
+
+	hlist_add_head(&node->hole_class, &mm->holes_class[class]);
+	__set_bit(class, mm->holes_class_mask);
+}
+
+static void rm_hole_class(struct drm_mm *mm, struct drm_mm_node *node)
+{
+	unsigned int class = hole_class(node->hole_size);
+
+	hlist_del(&node->hole_class);
+	if (hlist_empty(&mm->holes_class[class]))
+		__clear_bit(class, mm->holes_class_mask);
+}
+
 static void add_hole(struct drm_mm_node *node)
 {
 	struct drm_mm *mm = node->mm;
@@ -274,6 +310,7 @@ static void add_hole(struct drm_mm_node *node)
 
 	insert_hole_size(&mm->holes_size, node);
 	insert_hole_addr(&mm->holes_addr, node);
+	add_hole_class(mm, node);
 
 	list_add(&node->hole_stack, &mm->hole_stack);
 }
@@ -282,6 +319,7 @@ static void rm_hole(struct drm_mm_node *node)
 {
 	DRM_MM_BUG_ON(!drm_mm_hole_follows(node));
 
+	rm_hole_class(node->mm, node);
 	list_del(&node->hole_stack);
 	rb_erase_cached(&node->rb_hole_size, &node->mm->holes_size);
 	rb_erase_augmented(&node->rb_hole_addr, &node->mm->holes_addr,
@@ -322,6 +360,31 @@ static struct drm_mm_node *best_hole(struct drm_mm *mm, u64 size)
 	return best;
 }
 
+static struct drm_mm_node *hole_class_first(struct drm_mm *mm,
+					    unsigned int class)
+{
+	return hlist_entry_safe(mm->holes_class[class].first,
+				struct drm_mm_node, hole_class);
+}
+
+/*
+ * Returns the most recent hole of the smallest size class in which every hole
+ * is at least @size, or NULL if there is none.
+ */
+static struct drm_mm_node *class_hole(struct drm_mm *mm, u64 size)
+{
+	unsigned int class = hole_class(size);
+
+	if (hole_class_min(class) < size)
+		class++;
+
+	class = find_next_bit(mm->holes_class_mask, DRM_MM_HOLE_CLASSES, class);
+	if (class >= DRM_MM_HOLE_CLASSES)
+		return NULL;
+
+	return hole_class_first(mm, class);
+}
+
 static bool usable_hole_addr(struct rb_node *rb, u64 size)
 {
 	return rb && rb_hole_addr_to_node(rb)->subtree_max_hole >= size;
@@ -360,6 +423,7 @@ first_hole(struct drm_mm *mm,
 	switch (mode) {
 	default:
 	case DRM_MM_INSERT_BEST:
+	case DRM_MM_INSERT_CLASS:
 		return best_hole(mm, size);
 
 	case DRM_MM_INSERT_LOW:
@@ -419,6 +483,7 @@ next_hole(struct drm_mm *mm,
 	switch (mode) {
 	default:
 	case DRM_MM_INSERT_BEST:
+	case DRM_MM_INSERT_CLASS:
 		return rb_hole_size_to_node(rb_prev(&node->rb_hole_size));
 
 	case DRM_MM_INSERT_LOW:
@@ -495,6 +560,110 @@ static u64 rb_to_hole_size_or_zero(struct rb_node *rb)
 	return rb ? rb_to_hole_size(rb) : 0;
 }
 
+static int insert_into_hole(struct drm_mm * const mm,
+			    struct drm_mm_node * const node,
+			    struct drm_mm_node *hole,
+			    u64 size, u64 alignment, u64 remainder_mask,
+			    unsigned long color,
+			    u64 range_start, u64 range_end,
+			    enum drm_mm_insert_mode mode)
+{
+	u64 hole_start = __drm_mm_hole_node_start(hole);
+	u64 hole_end = hole_start + hole->hole_size;
+	u64 adj_start, adj_end;
+	u64 col_start, col_end;
+
+	col_start = hole_start;
+	col_end = hole_end;
+	if (mm->color_adjust)
+		mm->color_adjust(hole, color, &col_start, &col_end);
+
+	adj_start = max(col_start, range_start);
+	adj_end = min(col_end, range_end);
+
+	if (adj_end <= adj_start || adj_end - adj_start < size)
+		return -ENOSPC;
+
+	if (mode == DRM_MM_INSERT_HIGH)
+		adj_start = adj_end - size;
+
+	if (alignment) {
+		u64 rem;
+
+		if (likely(remainder_mask))
+			rem = adj_start & remainder_mask;
+		else
+			div64_u64_rem(adj_start, alignment, &rem);
+		if (rem) {
+			adj_start -= rem;
+			if (mode != DRM_MM_INSERT_HIGH)
+				adj_start += alignment;
+
+			if (adj_start < max(col_start, range_start) ||
+			    min(col_end, range_end) - adj_start < size)
+				return -ENOSPC;
+
+			if (adj_end <= adj_start ||
+			    adj_end - adj_start < size)
+				return -ENOSPC;
+		}
+	}
+
+	node->mm = mm;
+	node->size = size;
+	node->start = adj_start;
+	node->color = color;
+	node->hole_size = 0;
+
+	__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
+	list_add(&node->node_list, &hole->node_list);
+	drm_mm_interval_tree_add_node(hole, node);
+
+	rm_hole(hole);
+	if (adj_start > hole_start)
+		add_hole(hole);
+	if (adj_start + size < hole_end)
+		add_hole(node);
+
+	save_stack(node);
+	return 0;
+}
+
+/*
+ * Tries the size classes before DRM_MM_INSERT_CLASS walks the size tree: first
+ * the most recent hole of the class @size falls in, which is usually a perfect
+ * fit when allocations of the same size are recycled, and then the most recent
+ * hole of the first class that is large enough regardless of the alignment.
+ */
+static int insert_best_class(struct drm_mm * const mm,
+			     struct drm_mm_node * const node,
+			     u64 size, u64 alignment, u64 remainder_mask,
+			     unsigned long color,
+			     u64 range_start, u64 range_end)
+{
+	struct drm_mm_node *hole;
+	u64 fit = size + (alignment ? alignment - 1 : 0);
+
+	hole = hole_class_first(mm, hole_class(size));
+	if (hole && hole->hole_size >= size &&
+	    !insert_into_hole(mm, node, hole, size, alignment, remainder_mask,
+			      color, range_start, range_end,
+			      DRM_MM_INSERT_BEST))
+		return 0;
+
+	if (fit < size)
+		return -ENOSPC;
+
+	hole = class_hole(mm, fit);
+	if (hole &&
+	    !insert_into_hole(mm, node, hole, size, alignment, remainder_mask,
+			      color, range_start, range_end,
+			      DRM_MM_INSERT_BEST))
+		return 0;
+
+	return -ENOSPC;
+}
+
 /**
  * drm_mm_insert_node_in_range - ranged search for space and insert @node
  * @mm: drm_mm to allocate from
@@ -537,13 +706,17 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 	mode &= ~DRM_MM_INSERT_ONCE;
 
 	remainder_mask = is_power_of_2(alignment) ? alignment - 1 : 0;
+
+	if (mode == DRM_MM_INSERT_CLASS && !once &&
+	    !insert_best_class(mm, node, size, alignment, remainder_mask,
+			       color, range_start, range_end))
+		return 0;
+
 	for (hole = first_hole(mm, range_start, range_end, size, mode);
 	     hole;
 	     hole = once ? NULL : next_hole(mm, hole, size, mode)) {
 		u64 hole_start = __drm_mm_hole_node_start(hole);
 		u64 hole_end = hole_start + hole->hole_size;
-		u64 adj_start, adj_end;
-		u64 col_start, col_end;
 
 		if (mode == DRM_MM_INSERT_LOW && hole_start >= range_end)
 			break;
@@ -551,60 +724,10 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 		if (mode == DRM_MM_INSERT_HIGH && hole_end <= range_start)
 			break;
 
-		col_start = hole_start;
-		col_end = hole_end;
-		if (mm->color_adjust)
-			mm->color_adjust(hole, color, &col_start, &col_end);
-
-		adj_start = max(col_start, range_start);
-		adj_end = min(col_end, range_end);
-
-		if (adj_end <= adj_start || adj_end - adj_start < size)
-			continue;
-
-		if (mode == DRM_MM_INSERT_HIGH)
-			adj_start = adj_end - size;
-
-		if (alignment) {
-			u64 rem;
-
-			if (likely(remainder_mask))
-				rem = adj_start & remainder_mask;
-			else
-				div64_u64_rem(adj_start, alignment, &rem);
-			if (rem) {
-				adj_start -= rem;
-				if (mode != DRM_MM_INSERT_HIGH)
-					adj_start += alignment;
-
-				if (adj_start < max(col_start, range_start) ||
-				    min(col_end, range_end) - adj_start < size)
-					continue;
-
-				if (adj_end <= adj_start ||
-				    adj_end - adj_start < size)
-					continue;
-			}
-		}
-
-		node->mm = mm;
-		node->size = size;
-		node->start = adj_start;
-		node->color = color;
-		node->hole_size = 0;
-
-		__set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
-		list_add(&node->node_list, &hole->node_list);
-		drm_mm_interval_tree_add_node(hole, node);
-
-		rm_hole(hole);
-		if (adj_start > hole_start)
-			add_hole(hole);
-		if (adj_start + size < hole_end)
-			add_hole(node);
-
-		save_stack(node);
-		return 0;
+		if (!insert_into_hole(mm, node, hole, size, alignment,
+				      remainder_mask, color,
+				      range_start, range_end, mode))
+			return 0;
 	}
 
 	return -ENOSPC;
@@ -677,6 +800,8 @@ void drm_mm_replace_node(struct drm_mm_node *old, struct drm_mm_node *new)
 		rb_replace_node(&old->rb_hole_addr,
 				&new->rb_hole_addr,
 				&mm->holes_addr);
+		hlist_add_behind(&new->hole_class, &old->hole_class);
+		hlist_del(&old->hole_class);
 	}
 
 	clear_bit_unlock(DRM_MM_NODE_ALLOCATED_BIT, &old->flags);
@@ -962,6 +1087,8 @@ EXPORT_SYMBOL(drm_mm_scan_color_evict);
  */
 void drm_mm_init(struct drm_mm *mm, u64 start, u64 size)
 {
+	unsigned int i;
+
 	DRM_MM_BUG_ON(start + size <= start);
 
 	mm->color_adjust = NULL;
@@ -970,6 +1097,9 @@ void drm_mm_init(struct drm_mm *mm, u64 start, u64 size)
 	mm->interval_tree = RB_ROOT_CACHED;
 	mm->holes_size = RB_ROOT_CACHED;
 	mm->holes_addr = RB_ROOT;
+	for (i = 0; i < DRM_MM_HOLE_CLASSES; i++)
+		INIT_HLIST_HEAD(&mm->holes_class[i]);
+	bitmap_zero(mm->holes_class_mask, DRM_MM_HOLE_CLASSES);
 
 	/* Clever trick to avoid a special case in the free hole tracking. */
 	INIT_LIST_HEAD(&mm->head_node.node_list);
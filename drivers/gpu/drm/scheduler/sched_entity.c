@@ -66,6 +66,17 @@ int drm_sched_entity_init(struct drm_sched_entity *entity,
 		return -EINVAL;
 
 	memset(entity, 0, sizeof(struct drm_sched_entity));
+
+	/* Only the fair policy looks at the GPU time used by each entity */
+	if (drm_sched_policy == DRM_SCHED_POLICY_FAIR) {
+		entity->stats = kzalloc(sizeof(*entity->stats), GFP_KERNEL);
+		if (!entity->stats)
+			return -ENOMEM;
+
+		kref_init(&entity->stats->kref);
+		atomic64_set(&entity->stats->runtime, 0);
+	}
+
 	INIT_LIST_HEAD(&entity->list);
 	entity->rq = NULL;
 	entity->guilty = guilty;
@@ -308,6 +319,11 @@ void drm_sched_entity_fini(struct drm_sched_entity *entity)
 
 	dma_fence_put(entity->last_scheduled);
 	entity->last_scheduled = NULL;
+
+	if (entity->stats) {
+		drm_sched_entity_stats_put(entity->stats);
+		entity->stats = NULL;
+	}
 }
 EXPORT_SYMBOL(drm_sched_entity_fini);
 
@@ -367,6 +383,20 @@ void drm_sched_entity_set_priority(struct drm_sched_entity *entity,
 }
 EXPORT_SYMBOL(drm_sched_entity_set_priority);
 
+static void drm_sched_entity_stats_release(struct kref *kref)
+{
+	struct drm_sched_entity_stats *stats =
+		container_of(kref, typeof(*stats), kref);
+
+	kfree(stats);
+}
+
+/* Drops a reference to an entity's or job's &drm_sched_entity_stats */
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats)
+{
+	kref_put(&stats->kref, drm_sched_entity_stats_release);
+}
+
 /*
  * Add a callback to the current dependency of the entity to wake up the
  * scheduler when the entity becomes available.
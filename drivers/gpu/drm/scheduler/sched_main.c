@@ -42,6 +42,11 @@
  *    the hardware.
  *
  * The jobs in a entity are always scheduled in the order that they were pushed.
+ *
+ * Within a run queue, entities are picked round robin by default. With the
+ * fair policy (sched_policy=1) the entity that has used the least GPU time is
+ * picked instead. The GPU time of a job is taken from the timestamps of its
+ * scheduled and hardware fences.
  */
 
 #include <linux/kthread.h>
@@ -62,6 +67,17 @@
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
 
+int drm_sched_policy = DRM_SCHED_POLICY_RR;
+
+/**
+ * DOC: sched_policy (int)
+ * Used to override the default entity scheduling policy in a run queue.
+ */
+MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, "
+		 __stringify(DRM_SCHED_POLICY_RR) " = Round Robin (default), "
+		 __stringify(DRM_SCHED_POLICY_FAIR) " = Fair share by GPU time.");
+module_param_named(sched_policy, drm_sched_policy, int, 0444);
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -76,9 +92,31 @@ static void drm_sched_rq_init(struct drm_gpu_scheduler *sched,
 	spin_lock_init(&rq->lock);
 	INIT_LIST_HEAD(&rq->entities);
 	rq->current_entity = NULL;
+	rq->min_vruntime = 0;
 	rq->sched = sched;
 }
 
+/**
+ * drm_sched_entity_update_vruntime - account the GPU time used by an entity
+ *
+ * @entity: scheduler entity
+ *
+ * Folds the GPU time used since the last call into the entity's vruntime.
+ * Must be called with the lock of the entity's run queue held. Entities only
+ * have stats with the fair policy.
+ */
+static void drm_sched_entity_update_vruntime(struct drm_sched_entity *entity)
+{
+	u64 runtime;
+
+	if (!entity->stats)
+		return;
+
+	runtime = atomic64_read(&entity->stats->runtime);
+	entity->vruntime += runtime - entity->vruntime_base;
+	entity->vruntime_base = runtime;
+}
+
 /**
  * drm_sched_rq_add_entity - add an entity
  *
@@ -94,6 +132,9 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 		return;
 	spin_lock(&rq->lock);
 	atomic_inc(rq->sched->score);
+	/* Don't let a new entity catch up on the time it wasn't there for */
+	drm_sched_entity_update_vruntime(entity);
+	entity->vruntime = max(entity->vruntime, rq->min_vruntime);
 	list_add_tail(&entity->list, &rq->entities);
 	spin_unlock(&rq->lock);
 }
@@ -163,6 +204,85 @@ drm_sched_rq_select_entity(struct drm_sched_rq *rq)
 	return NULL;
 }
 
+/**
+ * drm_sched_rq_select_entity_fair - Select the ready entity with the lowest
+ * GPU time
+ *
+ * @rq: scheduler run queue to check.
+ *
+ * Entities which aren't ready don't bank credit while they wait, they restart
+ * from the lowest vruntime selected so far.
+ *
+ * Try to find a ready entity, returns NULL if none found.
+ */
+static struct drm_sched_entity *
+drm_sched_rq_select_entity_fair(struct drm_sched_rq *rq)
+{
+	struct drm_sched_entity *entity, *best = NULL;
+
+	spin_lock(&rq->lock);
+
+	list_for_each_entry(entity, &rq->entities, list) {
+		drm_sched_entity_update_vruntime(entity);
+
+		if (!drm_sched_entity_is_ready(entity)) {
+			entity->vruntime = max(entity->vruntime,
+					       rq->min_vruntime);
+			continue;
+		}
+
+		if (!best || entity->vruntime < best->vruntime)
+			best = entity;
+	}
+
+	if (best) {
+		rq->min_vruntime = max(rq->min_vruntime, best->vruntime);
+		rq->current_entity = best;
+		reinit_completion(&best->entity_idle);
+	}
+
+	spin_unlock(&rq->lock);
+
+	return best;
+}
+
+/*
+ * Account the time between the job being started, or the previous job on the
+ * same scheduler being done if that was later, and the hardware fence being
+ * signaled to the job's entity.
+ */
+static void drm_sched_job_account(struct drm_sched_job *s_job)
+{
+	struct drm_sched_fence *s_fence = s_job->s_fence;
+	struct drm_gpu_scheduler *sched = s_fence->sched;
+	struct dma_fence *parent = s_fence->parent;
+	s64 start, end, last;
+
+	if (!s_job->entity_stats || !parent ||
+	    !test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &parent->flags) ||
+	    !test_bit(DMA_FENCE_FLAG_TIMESTAMP_BIT, &s_fence->scheduled.flags))
+		return;
+
+	end = ktime_to_ns(parent->timestamp);
+	start = ktime_to_ns(s_fence->scheduled.timestamp);
+
+	last = atomic64_read(&sched->last_done_ns);
+	while (last < end) {
+		s64 old = atomic64_cmpxchg(&sched->last_done_ns, last, end);
+
+		if (old == last)
+			break;
+		last = old;
+	}
+
+	/* The job may have been queued behind the previous one */
+	if (last < end)
+		start = max(start, last);
+
+	if (end > start)
+		atomic64_add(end - start, &s_job->entity_stats->runtime);
+}
+
 /**
  * drm_sched_job_done - complete a job
  * @s_job: pointer to the job which is done
@@ -177,6 +297,8 @@ static void drm_sched_job_done(struct drm_sched_job *s_job)
 	atomic_dec(&sched->hw_rq_count);
 	atomic_dec(sched->score);
 
+	drm_sched_job_account(s_job);
+
 	trace_drm_sched_process_job(s_fence);
 
 	dma_fence_get(&s_fence->finished);
@@ -596,6 +718,7 @@ int drm_sched_job_init(struct drm_sched_job *job,
 		return -ENOENT;
 
 	job->entity = entity;
+	job->entity_stats = NULL;
 	job->s_fence = drm_sched_fence_alloc(entity, owner);
 	if (!job->s_fence)
 		return -ENOMEM;
@@ -634,6 +757,11 @@ void drm_sched_job_arm(struct drm_sched_job *job)
 	job->s_priority = entity->rq - sched->sched_rq;
 	job->id = atomic64_inc_return(&sched->job_id_count);
 
+	if (entity->stats) {
+		kref_get(&entity->stats->kref);
+		job->entity_stats = entity->stats;
+	}
+
 	drm_sched_fence_init(job->s_fence, job->entity);
 }
 EXPORT_SYMBOL(drm_sched_job_arm);
@@ -752,6 +880,11 @@ void drm_sched_job_cleanup(struct drm_sched_job *job)
 
 	job->s_fence = NULL;
 
+	if (job->entity_stats) {
+		drm_sched_entity_stats_put(job->entity_stats);
+		job->entity_stats = NULL;
+	}
+
 	xa_for_each(&job->dependencies, index, fence) {
 		dma_fence_put(fence);
 	}
@@ -803,7 +936,9 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 
 	/* Kernel run queue has higher priority than normal run queue*/
 	for (i = DRM_SCHED_PRIORITY_COUNT - 1; i >= DRM_SCHED_PRIORITY_MIN; i--) {
-		entity = drm_sched_rq_select_entity(&sched->sched_rq[i]);
+		entity = drm_sched_policy == DRM_SCHED_POLICY_FAIR ?
+			drm_sched_rq_select_entity_fair(&sched->sched_rq[i]) :
+			drm_sched_rq_select_entity(&sched->sched_rq[i]);
 		if (entity)
 			break;
 	}
@@ -1022,6 +1157,7 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	atomic_set(&sched->hw_rq_count, 0);
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
 	atomic_set(&sched->_score, 0);
+	atomic64_set(&sched->last_done_ns, 0);
 	atomic64_set(&sched->job_id_count, 0);
 
 	/* Each scheduler will run on a seperate kernel thread */
@@ -26,6 +26,7 @@ enum {
 	BOTTOMUP,
 	TOPDOWN,
 	EVICT,
+	CLASS,
 };
 
 static const struct insert_mode {
@@ -36,6 +37,7 @@ static const struct insert_mode {
 	[BOTTOMUP] = { "bottom-up", DRM_MM_INSERT_LOW },
 	[TOPDOWN] = { "top-down", DRM_MM_INSERT_HIGH },
 	[EVICT] = { "evict", DRM_MM_INSERT_EVICT },
+	[CLASS] = { "class", DRM_MM_INSERT_CLASS },
 	{}
 }, evict_modes[] = {
 	{ "bottom-up", DRM_MM_INSERT_LOW },
@@ -1050,6 +1052,80 @@ static void drm_test_mm_frag(struct kunit *test)
 	vfree(nodes);
 }
 
+static u64 get_class_churn_time(struct kunit *test, struct drm_mm *mm,
+			       unsigned int num_insert, struct drm_mm_node *nodes)
+{
+	const struct insert_mode *mode = &insert_modes[CLASS];
+	ktime_t start;
+	unsigned int i;
+
+	/* None of the fragmented holes is suitably aligned for these. */
+	start = ktime_get();
+	for (i = 0; i < num_insert; i++) {
+		if (!expect_insert(test, mm, &nodes[i], 4096, 8192, i, mode)) {
+			KUNIT_FAIL(test, "%s insert failed\n", mode->name);
+			return 0;
+		}
+
+		if (i % 2)
+			drm_mm_remove_node(&nodes[i - 1]);
+	}
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static void drm_test_mm_class_frag(struct kunit *test)
+{
+	struct drm_mm mm;
+	struct drm_mm_node *nodes, *node, *next;
+	unsigned int churn_size = 5000;
+	unsigned int frag_size = 5000;
+	unsigned int scale_factor = 2;
+	u64 churn_time1, churn_time2;
+
+	nodes = vzalloc(array_size(frag_size * 4 + churn_size, sizeof(*nodes)));
+	KUNIT_ASSERT_TRUE(test, nodes);
+
+	/* Start off a page so that every hole left by prepare_frag() is
+	 * misaligned for the churn, then check that a size class insert/remove
+	 * mix doesn't slow down with the number of those holes: quadrupling
+	 * them must not more than double the time taken.
+	 */
+	drm_mm_init(&mm, 4096, U64_MAX - 8192);
+
+	if (prepare_frag(test, &mm, nodes, frag_size, &insert_modes[BEST]))
+		goto err;
+
+	churn_time1 = get_class_churn_time(test, &mm, churn_size,
+					  nodes + frag_size * 4);
+	if (churn_time1 == 0)
+		goto err;
+
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+
+	if (prepare_frag(test, &mm, nodes, frag_size * 4, &insert_modes[BEST]))
+		goto err;
+
+	churn_time2 = get_class_churn_time(test, &mm, churn_size,
+					  nodes + frag_size * 4);
+	if (churn_time2 == 0)
+		goto err;
+
+	kunit_info(test, "size class churn of %u insertions with %u and %u holes took %llu and %llu nsecs\n",
+		   churn_size, frag_size / 2, frag_size * 2, churn_time1, churn_time2);
+
+	if (churn_time2 > (scale_factor * churn_time1))
+		KUNIT_FAIL(test, "size class churn took %llu nsecs more\n",
+			   churn_time2 - (scale_factor * churn_time1));
+
+err:
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+	drm_mm_takedown(&mm);
+	vfree(nodes);
+}
+
 static void drm_test_mm_align(struct kunit *test)
 {
 	const struct insert_mode *mode;
@@ -2229,6 +2305,7 @@ static struct kunit_case drm_mm_tests[] = {
 	KUNIT_CASE(drm_test_mm_replace),
 	KUNIT_CASE(drm_test_mm_insert_range),
 	KUNIT_CASE(drm_test_mm_frag),
+	KUNIT_CASE(drm_test_mm_class_frag),
 	KUNIT_CASE(drm_test_mm_align),
 	KUNIT_CASE(drm_test_mm_align32),
 	KUNIT_CASE(drm_test_mm_align64),
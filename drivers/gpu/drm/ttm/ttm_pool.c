@@ -62,8 +62,17 @@ static unsigned long page_pool_size;
 MODULE_PARM_DESC(page_pool_size, "Number of pages in the WC/UC/DMA pool");
 module_param(page_pool_size, ulong, 0644);
 
+static unsigned long page_pool_refill;
+
+MODULE_PARM_DESC(page_pool_refill, "Number of pages to keep in each per device pool, refilled in the background (0 = disabled)");
+module_param(page_pool_refill, ulong, 0644);
+
 static atomic_long_t allocated_pages;
 
+/* Don't refill the pools for a while after the shrinker freed pages */
+#define TTM_POOL_REFILL_BACKOFF	HZ
+static unsigned long last_shrink;
+
 static struct ttm_pool_type global_write_combined[MAX_ORDER];
 static struct ttm_pool_type global_uncached[MAX_ORDER];
 
@@ -92,7 +101,10 @@ static struct page *ttm_pool_alloc_page(struct ttm_pool *pool, gfp_t gfp_flags,
 			__GFP_KSWAPD_RECLAIM;
 
 	if (!pool->use_dma_alloc) {
-		p = alloc_pages(gfp_flags, order);
+		if (pool->nid != NUMA_NO_NODE)
+			p = alloc_pages_node(pool->nid, gfp_flags, order);
+		else
+			p = alloc_pages(gfp_flags, order);
 		if (p)
 			p->private = order;
 		return p;
@@ -233,19 +245,26 @@ static void ttm_pool_type_give(struct ttm_pool_type *pt, struct page *p)
 
 	spin_lock(&pt->lock);
 	list_add(&p->lru, &pt->pages);
+	pt->nr_pages += 1 << pt->order;
 	spin_unlock(&pt->lock);
 	atomic_long_add(1 << pt->order, &allocated_pages);
 }
 
-/* Take pages from a specific pool_type, return NULL when nothing available */
-static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
+/*
+ * Take pages from a specific pool_type, return NULL when nothing available.
+ * Allocations take the most recently freed pages, while the shrinker takes the
+ * least recently freed ones.
+ */
+static struct page *__ttm_pool_type_take(struct ttm_pool_type *pt, bool lru)
 {
-	struct page *p;
+	struct page *p = NULL;
 
 	spin_lock(&pt->lock);
-	p = list_first_entry_or_null(&pt->pages, typeof(*p), lru);
-	if (p) {
+	if (!list_empty(&pt->pages)) {
+		p = lru ? list_last_entry(&pt->pages, typeof(*p), lru) :
+			list_first_entry(&pt->pages, typeof(*p), lru);
 		atomic_long_sub(1 << pt->order, &allocated_pages);
+		pt->nr_pages -= 1 << pt->order;
 		list_del(&p->lru);
 	}
 	spin_unlock(&pt->lock);
@@ -253,6 +272,11 @@ static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
 	return p;
 }
 
+static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
+{
+	return __ttm_pool_type_take(pt, false);
+}
+
 /* Initialize and add a pool type to the global shrinker list */
 static void ttm_pool_type_init(struct ttm_pool_type *pt, struct ttm_pool *pool,
 			       enum ttm_caching caching, unsigned int order)
@@ -262,6 +286,8 @@ static void ttm_pool_type_init(struct ttm_pool_type *pt, struct ttm_pool *pool,
 	pt->order = order;
 	spin_lock_init(&pt->lock);
 	INIT_LIST_HEAD(&pt->pages);
+	pt->nr_pages = 0;
+	pt->refill = false;
 
 	spin_lock(&shrinker_lock);
 	list_add_tail(&pt->shrinker_list, &shrinker_list);
@@ -281,12 +307,30 @@ static void ttm_pool_type_fini(struct ttm_pool_type *pt)
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
 }
 
+/*
+ * Return true if the pool has its own pool types for the given caching rather
+ * than the global ones. Node local pools only replace the global x86 WC/UC
+ * pools, cached pages are never pooled.
+ */
+static bool ttm_pool_uses_own_type(struct ttm_pool *pool,
+				   enum ttm_caching caching)
+{
+	if (pool->use_dma_alloc)
+		return true;
+
+#ifdef CONFIG_X86
+	return pool->nid != NUMA_NO_NODE && caching != ttm_cached;
+#else
+	return false;
+#endif
+}
+
 /* Return the pool_type to use for the given caching and order */
 static struct ttm_pool_type *ttm_pool_select_type(struct ttm_pool *pool,
 						  enum ttm_caching caching,
 						  unsigned int order)
 {
-	if (pool->use_dma_alloc)
+	if (ttm_pool_uses_own_type(pool, caching))
 		return &pool->caching[caching].orders[order];
 
 #ifdef CONFIG_X86
@@ -321,7 +365,7 @@ static unsigned int ttm_pool_shrink(void)
 	list_move_tail(&pt->shrinker_list, &shrinker_list);
 	spin_unlock(&shrinker_lock);
 
-	p = ttm_pool_type_take(pt);
+	p = __ttm_pool_type_take(pt, true);
 	if (p) {
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
 		num_pages = 1 << pt->order;
@@ -332,6 +376,96 @@ static unsigned int ttm_pool_shrink(void)
 	return num_pages;
 }
 
+/* Set the caching of a freshly allocated page of size 1 << order */
+static int ttm_pool_set_caching(struct page *p, unsigned int order,
+				enum ttm_caching caching)
+{
+#ifdef CONFIG_X86
+	switch (caching) {
+	case ttm_cached:
+		break;
+	case ttm_write_combined:
+		return set_pages_wc(p, 1 << order);
+	case ttm_uncached:
+		return set_pages_uc(p, 1 << order);
+	}
+#endif
+	return 0;
+}
+
+/* Refill a pool type up to the watermark, as long as memory is easy to get */
+static void ttm_pool_refill_type(struct ttm_pool *pool,
+				 struct ttm_pool_type *pt)
+{
+	gfp_t gfp_flags = (GFP_USER & ~__GFP_DIRECT_RECLAIM) | __GFP_NOWARN |
+		__GFP_NORETRY;
+	unsigned long target = READ_ONCE(page_pool_refill);
+	struct page *p;
+
+	/* Pages in the pools are always lowmem, see ttm_pool_set_caching() */
+	if (pool->use_dma32)
+		gfp_flags |= GFP_DMA32;
+
+	while (READ_ONCE(pt->nr_pages) < target &&
+	       atomic_long_read(&allocated_pages) + (1 << pt->order) <=
+	       page_pool_size) {
+		if (time_before(jiffies, READ_ONCE(last_shrink) +
+				TTM_POOL_REFILL_BACKOFF))
+			break;
+
+		p = ttm_pool_alloc_page(pool, gfp_flags, pt->order);
+		if (!p)
+			break;
+
+		if (ttm_pool_set_caching(p, pt->order, pt->caching)) {
+			ttm_pool_free_page(pool, ttm_cached, pt->order, p);
+			break;
+		}
+
+		ttm_pool_type_give(pt, p);
+		cond_resched();
+	}
+}
+
+static void ttm_pool_refill_work(struct work_struct *work)
+{
+	struct ttm_pool *pool = container_of(work, typeof(*pool), refill_work);
+	unsigned int i, j;
+
+	for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i) {
+		if (!ttm_pool_uses_own_type(pool, i))
+			continue;
+
+		for (j = 0; j < MAX_ORDER; ++j) {
+			struct ttm_pool_type *pt = &pool->caching[i].orders[j];
+
+			if (!READ_ONCE(pt->refill))
+				continue;
+
+			WRITE_ONCE(pt->refill, false);
+			ttm_pool_refill_type(pool, pt);
+		}
+	}
+}
+
+/* Kick off the background refill when a pool type runs low */
+static void ttm_pool_check_refill(struct ttm_pool *pool,
+				  struct ttm_pool_type *pt)
+{
+	if (pt->pool != pool || !READ_ONCE(page_pool_refill))
+		return;
+
+	if (READ_ONCE(pt->nr_pages) >= READ_ONCE(page_pool_refill))
+		return;
+
+	WRITE_ONCE(pt->refill, true);
+	if (pool->nid != NUMA_NO_NODE)
+		queue_work_node(pool->nid, system_unbound_wq,
+				&pool->refill_work);
+	else
+		queue_work(system_unbound_wq, &pool->refill_work);
+}
+
 /* Return the allocation order based for a page */
 static unsigned int ttm_pool_page_order(struct ttm_pool *pool, struct page *p)
 {
@@ -474,6 +608,9 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 			} while (p);
 		}
 
+		if (pt)
+			ttm_pool_check_refill(pool, pt);
+
 		page_caching = ttm_cached;
 		while (num_pages >= (1 << order) &&
 		       (p = ttm_pool_alloc_page(pool, gfp_flags, order))) {
@@ -544,27 +681,34 @@ EXPORT_SYMBOL(ttm_pool_free);
  *
  * @pool: the pool to initialize
  * @dev: device for DMA allocations and mappings
+ * @nid: NUMA node to use for allocations
  * @use_dma_alloc: true if coherent DMA alloc should be used
  * @use_dma32: true if GFP_DMA32 should be used
  *
- * Initialize the pool and its pool types.
+ * Initialize the pool and its pool types. On x86, pools with a NUMA node keep
+ * their own node local WC/UC pool types, while the others share the global
+ * ones.
  */
 void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
-		   bool use_dma_alloc, bool use_dma32)
+		   int nid, bool use_dma_alloc, bool use_dma32)
 {
 	unsigned int i, j;
 
 	WARN_ON(!dev && use_dma_alloc);
 
 	pool->dev = dev;
+	pool->nid = nid;
 	pool->use_dma_alloc = use_dma_alloc;
 	pool->use_dma32 = use_dma32;
+	INIT_WORK(&pool->refill_work, ttm_pool_refill_work);
+
+	for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i) {
+		if (!ttm_pool_uses_own_type(pool, i))
+			continue;
 
-	if (use_dma_alloc) {
-		for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i)
-			for (j = 0; j < MAX_ORDER; ++j)
-				ttm_pool_type_init(&pool->caching[i].orders[j],
-						   pool, i, j);
+		for (j = 0; j < MAX_ORDER; ++j)
+			ttm_pool_type_init(&pool->caching[i].orders[j],
+					   pool, i, j);
 	}
 }
 
@@ -580,10 +724,14 @@ void ttm_pool_fini(struct ttm_pool *pool)
 {
 	unsigned int i, j;
 
-	if (pool->use_dma_alloc) {
-		for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i)
-			for (j = 0; j < MAX_ORDER; ++j)
-				ttm_pool_type_fini(&pool->caching[i].orders[j]);
+	cancel_work_sync(&pool->refill_work);
+
+	for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i) {
+		if (!ttm_pool_uses_own_type(pool, i))
+			continue;
+
+		for (j = 0; j < MAX_ORDER; ++j)
+			ttm_pool_type_fini(&pool->caching[i].orders[j]);
 	}
 
 	/* We removed the pool types from the LRU, but we need to also make sure
@@ -598,6 +746,8 @@ static unsigned long ttm_pool_shrinker_scan(struct shrinker *shrink,
 {
 	unsigned long num_freed = 0;
 
+	WRITE_ONCE(last_shrink, jiffies);
+
 	do
 		num_freed += ttm_pool_shrink();
 	while (!num_freed && atomic_long_read(&allocated_pages));
@@ -693,7 +843,7 @@ int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m)
 {
 	unsigned int i;
 
-	if (!pool->use_dma_alloc) {
+	if (!ttm_pool_uses_own_type(pool, ttm_write_combined)) {
 		seq_puts(m, "unused\n");
 		return 0;
 	}
@@ -702,7 +852,12 @@ int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m)
 
 	spin_lock(&shrinker_lock);
 	for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i) {
-		seq_puts(m, "DMA ");
+		if (!ttm_pool_uses_own_type(pool, i))
+			continue;
+		if (pool->use_dma_alloc)
+			seq_puts(m, "DMA ");
+		else
+			seq_printf(m, "N%d ", pool->nid);
 		switch (i) {
 		case ttm_cached:
 			seq_puts(m, "\t:");
@@ -755,6 +910,7 @@ int ttm_pool_mgr_init(unsigned long num_pages)
 
 	spin_lock_init(&shrinker_lock);
 	INIT_LIST_HEAD(&shrinker_list);
+	last_shrink = jiffies - TTM_POOL_REFILL_BACKOFF;
 
 	for (i = 0; i < MAX_ORDER; ++i) {
 		ttm_pool_type_init(&global_write_combined[i], NULL,
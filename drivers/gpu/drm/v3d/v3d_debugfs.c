@@ -221,6 +221,14 @@ static int v3d_debugfs_bo_stats(struct seq_file *m, void *unused)
 		   v3d->bo_stats.num_allocated);
 	seq_printf(m, "allocated bo size (kb): %ld\n",
 		   (long)v3d->bo_stats.pages_allocated << (V3D_MMU_PAGE_SHIFT - 10));
+	seq_printf(m, "mapped with 4K  (kb):   %ld\n",
+		   (long)v3d->bo_stats.pages_4k << (V3D_MMU_PAGE_SHIFT - 10));
+	seq_printf(m, "mapped with 64K (kb):   %ld\n",
+		   (long)v3d->bo_stats.pages_64k << (V3D_MMU_PAGE_SHIFT - 10));
+	seq_printf(m, "mapped with 1M  (kb):   %ld\n",
+		   (long)v3d->bo_stats.pages_1m << (V3D_MMU_PAGE_SHIFT - 10));
+	seq_printf(m, "huge page backing:      %s\n",
+		   v3d->gemfs ? "yes" : "no");
 	mutex_unlock(&v3d->bo_lock);
 
 	return 0;
@@ -338,6 +346,99 @@ static int v3d_measure_clock(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int v3d_debugfs_perfmon_sampling_show(struct seq_file *m, void *unused)
+{
+	struct v3d_dev *v3d = m->private;
+
+	v3d_perfmon_sampler_show(v3d, m);
+
+	return 0;
+}
+
+static int v3d_debugfs_perfmon_sampling_open(struct inode *inode,
+					     struct file *file)
+{
+	return single_open(file, v3d_debugfs_perfmon_sampling_show,
+			   inode->i_private);
+}
+
+/*
+ * Writing "<period_us> <counter> [<counter>...]" starts sampling the given
+ * counters every period_us, and writing "0" stops it.
+ */
+static ssize_t v3d_debugfs_perfmon_sampling_write(struct file *file,
+						  const char __user *ubuf,
+						  size_t len, loff_t *offp)
+{
+	struct seq_file *m = file->private_data;
+	struct v3d_dev *v3d = m->private;
+	u8 counters[DRM_V3D_MAX_PERF_COUNTERS];
+	unsigned int ncounters = 0;
+	char *buf, *cur, *tok;
+	u64 period_us;
+	int ret;
+
+	buf = memdup_user_nul(ubuf, min_t(size_t, len, PAGE_SIZE));
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	cur = strim(buf);
+	tok = strsep(&cur, " \t");
+	ret = kstrtou64(tok, 0, &period_us);
+	if (ret)
+		goto out;
+
+	if (!period_us) {
+		v3d_perfmon_sampler_stop(v3d);
+		ret = len;
+		goto out;
+	}
+
+	while ((tok = strsep(&cur, " \t"))) {
+		if (!*tok)
+			continue;
+		if (ncounters == ARRAY_SIZE(counters)) {
+			ret = -E2BIG;
+			goto out;
+		}
+		ret = kstrtou8(tok, 0, &counters[ncounters++]);
+		if (ret)
+			goto out;
+	}
+
+	ret = v3d_perfmon_sampler_start(v3d, period_us * NSEC_PER_USEC,
+					counters, ncounters);
+	if (!ret)
+		ret = len;
+
+out:
+	kfree(buf);
+	return ret;
+}
+
+static const struct file_operations v3d_debugfs_perfmon_sampling_fops = {
+	.owner = THIS_MODULE,
+	.open = v3d_debugfs_perfmon_sampling_open,
+	.read = seq_read,
+	.write = v3d_debugfs_perfmon_sampling_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int v3d_debugfs_perfmon_samples_mmap(struct file *file,
+					    struct vm_area_struct *vma)
+{
+	struct v3d_dev *v3d = file->private_data;
+
+	return v3d_perfmon_sampler_mmap(v3d, vma);
+}
+
+static const struct file_operations v3d_debugfs_perfmon_samples_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.mmap = v3d_debugfs_perfmon_samples_mmap,
+};
+
 static const struct drm_info_list v3d_debugfs_list[] = {
 	{"v3d_ident", v3d_v3d_debugfs_ident, 0},
 	{"v3d_regs", v3d_v3d_debugfs_regs, 0},
@@ -350,7 +451,14 @@ static const struct drm_info_list v3d_debugfs_list[] = {
 void
 v3d_debugfs_init(struct drm_minor *minor)
 {
+	struct v3d_dev *v3d = to_v3d_dev(minor->dev);
+
 	drm_debugfs_create_files(v3d_debugfs_list,
 				 ARRAY_SIZE(v3d_debugfs_list),
 				 minor->debugfs_root, minor);
+
+	debugfs_create_file("perfmon_sampling", 0600, minor->debugfs_root,
+			    v3d, &v3d_debugfs_perfmon_sampling_fops);
+	debugfs_create_file("perfmon_samples", 0400, minor->debugfs_root,
+			    v3d, &v3d_debugfs_perfmon_samples_fops);
 }
@@ -115,6 +115,41 @@ struct v3d_perfmon {
 	u64 values[];
 };
 
+/* Layout of the ring of perf counter samples that can be mmapped from
+ * the perfmon_samples debugfs file once sampling has been started
+ * through perfmon_sampling.  The first page holds the header, and the
+ * samples follow it.  The kernel increments head after each sample
+ * has been written, so readers should read head, then the samples
+ * they're interested in, and discard any that head has lapped.
+ */
+#define V3D_PERFMON_SAMPLE_VERSION 1
+#define V3D_PERFMON_SAMPLE_ENTRIES 1024
+#define V3D_PERFMON_SAMPLE_QUEUES (V3D_CSD + 1)
+
+struct v3d_perfmon_sample_header {
+	u32 version;
+	u32 ncounters;
+	u32 sample_size;
+	u32 nsamples;
+	u64 period_ns;
+	/* Number of samples written since sampling started. */
+	u64 head;
+	u8 counters[DRM_V3D_MAX_PERF_COUNTERS];
+};
+
+struct v3d_perfmon_sample {
+	u64 timestamp_ns;
+	/* Fence seqno and PID of the job on each of the bin, render,
+	 * TFU and CSD queues at sampling time, 0 if the queue was idle.
+	 */
+	u64 seqno[V3D_PERFMON_SAMPLE_QUEUES];
+	u32 pid[V3D_PERFMON_SAMPLE_QUEUES];
+	/* Counter increments since the previous sample. */
+	u64 values[DRM_V3D_MAX_PERF_COUNTERS];
+};
+
+struct v3d_perfmon_sampler;
+
 struct v3d_dev {
 	struct drm_device drm;
 
@@ -159,6 +194,12 @@ struct v3d_dev {
 	struct drm_mm mm;
 	spinlock_t mm_lock;
 
+	/* Private shmem mountpoint with huge pages enabled, if
+	 * available, so that big BOs can be mapped with 64K and 1M
+	 * PTEs.
+	 */
+	struct vfsmount *gemfs;
+
 	struct work_struct overflow_mem_work;
 
 	struct v3d_bin_job *bin_job;
@@ -169,13 +210,36 @@ struct v3d_dev {
 	struct v3d_queue_state queue[V3D_MAX_QUEUES];
 
 	/* Spinlock used to synchronize the overflow memory
-	 * management against bin job submission.
+	 * management against bin job submission, and the kick of a
+	 * chained render job against completion of its bin job.  It is
+	 * also the lock of the v3d fences.
 	 */
 	spinlock_t job_lock;
 
+	/* Render job whose run_job has been called but which is
+	 * waiting for its bin job to leave the hardware before being
+	 * started from the FLDONE interrupt.
+	 */
+	struct v3d_render_job *chained_render;
+
 	/* Used to track the active perfmon if any. */
 	struct v3d_perfmon *active_perfmon;
 
+	/* System-wide perf counter sampling, if enabled.  Per-job
+	 * perfmons are not switched while it is active.  Protected by
+	 * sampler_lock.
+	 */
+	struct v3d_perfmon_sampler *sampler;
+	struct mutex sampler_lock;
+
+	/* Seqno and client PID of the job currently on each hardware
+	 * queue, used to tag perf counter samples.
+	 */
+	struct {
+		u64 seqno;
+		pid_t pid;
+	} hw_job[V3D_PERFMON_SAMPLE_QUEUES];
+
 	/* Protects bo_stats */
 	struct mutex bo_lock;
 
@@ -199,6 +263,10 @@ struct v3d_dev {
 	struct {
 		u32 num_allocated;
 		u32 pages_allocated;
+		/* 4K pages mapped by each size of PTE. */
+		u32 pages_4k;
+		u32 pages_64k;
+		u32 pages_1m;
 	} bo_stats;
 
 	struct v3d_queue_stats gpu_queue_stats[V3D_MAX_QUEUES];
@@ -304,10 +372,27 @@ struct v3d_job {
 	 */
 	pid_t client_pid;
 
+	/* ktime_get_ns() at ioctl submission, at the push to the
+	 * scheduler entity and when the job was started on the
+	 * hardware, reported by the v3d_job_latency tracepoint.
+	 */
+	u64 submit_ns;
+	u64 queue_ns;
+	u64 run_ns;
+
 	/* Callback for the freeing of the job on refcount going to 0. */
 	void (*free)(struct kref *ref);
 };
 
+static inline void
+v3d_set_hw_job(struct v3d_dev *v3d, enum v3d_queue queue,
+	       struct v3d_job *job)
+{
+	WRITE_ONCE(v3d->hw_job[queue].pid, job ? job->client_pid : 0);
+	WRITE_ONCE(v3d->hw_job[queue].seqno,
+		   job ? to_v3d_fence(job->irq_fence)->seqno : 0);
+}
+
 struct v3d_bin_job {
 	struct v3d_job base;
 
@@ -321,6 +406,12 @@ struct v3d_bin_job {
 
 	/* Submitted tile memory allocation start/size, tile state. */
 	u32 qma, qms, qts;
+
+	/* Set under job_lock once the job has left the hardware, along
+	 * with the error it completed with, for a chained render job.
+	 */
+	bool hw_done;
+	int hw_error;
 };
 
 struct v3d_render_job {
@@ -335,6 +426,12 @@ struct v3d_render_job {
 	 * released once the job is complete.
 	 */
 	struct list_head unref_list;
+
+	/* Bin job this render job is chained to, holding a reference.
+	 * The render job is then scheduled as soon as the bin job is,
+	 * and gets started directly from the bin job's interrupt.
+	 */
+	struct v3d_bin_job *bin;
 };
 
 struct v3d_tfu_job {
@@ -452,6 +549,11 @@ void v3d_reset(struct v3d_dev *v3d);
 void v3d_invalidate_caches(struct v3d_dev *v3d);
 void v3d_clean_caches(struct v3d_dev *v3d);
 
+/* v3d_gemfs.c */
+extern bool super_pages;
+void v3d_gemfs_init(struct v3d_dev *v3d);
+void v3d_gemfs_fini(struct v3d_dev *v3d);
+
 /* v3d_irq.c */
 int v3d_irq_init(struct v3d_dev *v3d);
 void v3d_irq_enable(struct v3d_dev *v3d);
@@ -469,6 +571,9 @@ void v3d_mmu_remove_ptes(struct v3d_bo *bo);
 int v3d_sched_init(struct v3d_dev *v3d);
 void v3d_sched_fini(struct v3d_dev *v3d);
 void v3d_sched_stats_update(struct v3d_queue_stats *queue_stats);
+void v3d_render_job_kick(struct v3d_dev *v3d, struct v3d_render_job *job);
+void v3d_chain_bin_done(struct v3d_dev *v3d, struct v3d_bin_job *bin,
+			int error);
 
 /* v3d_perfmon.c */
 void v3d_perfmon_get(struct v3d_perfmon *perfmon);
@@ -483,5 +588,11 @@ int v3d_perfmon_create_ioctl(struct drm_device *dev, void *data,
 			     struct drm_file *file_priv);
 int v3d_perfmon_destroy_ioctl(struct drm_device *dev, void *data,
 			      struct drm_file *file_priv);
+int v3d_perfmon_sampler_start(struct v3d_dev *v3d, u64 period_ns,
+			      const u8 *counters, u8 ncounters);
+void v3d_perfmon_sampler_stop(struct v3d_dev *v3d);
+void v3d_perfmon_sampler_reset(struct v3d_dev *v3d);
+int v3d_perfmon_sampler_mmap(struct v3d_dev *v3d, struct vm_area_struct *vma);
+void v3d_perfmon_sampler_show(struct v3d_dev *v3d, struct seq_file *m);
 int v3d_perfmon_get_values_ioctl(struct drm_device *dev, void *data,
 				 struct drm_file *file_priv);
@@ -436,6 +436,9 @@ v3d_render_job_free(struct kref *ref)
 		drm_gem_object_put(&bo->base.base);
 	}
 
+	if (job->bin)
+		v3d_job_put(&job->bin->base);
+
 	v3d_job_free(ref);
 }
 
@@ -520,6 +523,7 @@ v3d_job_init(struct v3d_dev *v3d, struct drm_file *file_priv,
 	job->v3d = v3d;
 	job->free = free;
 	job->client_pid = current->pid;
+	job->submit_ns = ktime_get_ns();
 
 	ret = drm_sched_job_init(&job->base, &v3d_priv->sched_entity[queue],
 				 v3d_priv);
@@ -573,6 +577,7 @@ v3d_push_job(struct v3d_job *job)
 	/* put by scheduler job completion */
 	kref_get(&job->refcount);
 
+	job->queue_ns = ktime_get_ns();
 	drm_sched_entity_push_job(&job->base);
 }
 
@@ -853,8 +858,15 @@ v3d_submit_cl_ioctl(struct drm_device *dev, void *data,
 		v3d_perfmon_get(bin->base.perfmon);
 		v3d_push_job(&bin->base);
 
+		/* Rather than waking the render scheduler once the bin
+		 * job has finished, let the render job be scheduled as
+		 * soon as the bin job is running, and have the FLDONE
+		 * interrupt start it on the hardware.
+		 */
+		kref_get(&bin->base.refcount);
+		render->bin = bin;
 		ret = drm_sched_job_add_dependency(&render->base.base,
-						   dma_fence_get(bin->base.done_fence));
+						   dma_fence_get(&bin->base.base.s_fence->scheduled));
 		if (ret)
 			goto fail_unreserve;
 	}
@@ -1129,10 +1141,13 @@ v3d_gem_init(struct drm_device *dev)
 	mutex_init(&v3d->reset_lock);
 	mutex_init(&v3d->sched_lock);
 	mutex_init(&v3d->cache_clean_lock);
+	mutex_init(&v3d->sampler_lock);
 
 	mutex_init(&v3d->clk_lock);
 	INIT_DELAYED_WORK(&v3d->clk_down_work, v3d_clock_down_work);
 
+	v3d_gemfs_init(v3d);
+
 	/* kick the clock so firmware knows we are using firmware clock interface */
 	v3d_clock_up_get(v3d);
 	v3d_clock_up_put(v3d);
@@ -1148,6 +1163,7 @@ v3d_gem_init(struct drm_device *dev)
 			       GFP_KERNEL | __GFP_NOWARN | __GFP_ZERO);
 	if (!v3d->pt) {
 		drm_mm_takedown(&v3d->mm);
+		v3d_gemfs_fini(v3d);
 		dev_err(v3d->drm.dev,
 			"Failed to allocate page tables. Please ensure you have DMA enabled.\n");
 		return -ENOMEM;
@@ -1161,6 +1177,7 @@ v3d_gem_init(struct drm_device *dev)
 		drm_mm_takedown(&v3d->mm);
 		dma_free_coherent(v3d->drm.dev, 4096 * 1024, (void *)v3d->pt,
 				  v3d->pt_paddr);
+		v3d_gemfs_fini(v3d);
 	}
 
 	return 0;
@@ -1171,6 +1188,7 @@ v3d_gem_destroy(struct drm_device *dev)
 {
 	struct v3d_dev *v3d = to_v3d_dev(dev);
 
+	v3d_perfmon_sampler_stop(v3d);
 	v3d_sched_fini(v3d);
 
 	/* Waiting for jobs to finish would need to be done before
@@ -1183,4 +1201,6 @@ v3d_gem_destroy(struct drm_device *dev)
 
 	dma_free_coherent(v3d->drm.dev, 4096 * 1024, (void *)v3d->pt,
 			  v3d->pt_paddr);
+
+	v3d_gemfs_fini(v3d);
 }
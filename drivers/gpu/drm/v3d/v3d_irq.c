@@ -6,7 +6,9 @@
  *
  * When we take a bin, render, TFU done, or CSD done interrupt, we
  * need to signal the fence for that job so that the scheduler can
- * queue up the next one and unblock any waiters.
+ * queue up the next one and unblock any waiters.  A bin done
+ * interrupt also directly starts the render job chained to it, if
+ * that is already waiting.
  *
  * When we take the binner out of memory interrupt, we need to
  * allocate some new memory and pass it to the binner so that the
@@ -100,11 +102,19 @@ v3d_irq(int irq, void *arg)
 	}
 
 	if (intsts & V3D_INT_FLDONE) {
+		struct v3d_bin_job *bin = v3d->bin_job;
 		struct v3d_fence *fence =
-			to_v3d_fence(v3d->bin_job->base.irq_fence);
+			to_v3d_fence(bin->base.irq_fence);
 		v3d->gpu_queue_stats[V3D_BIN].last_exec_end = local_clock();
 
+		spin_lock(&v3d->job_lock);
+		v3d_chain_bin_done(v3d, bin, 0);
+		spin_unlock(&v3d->job_lock);
+
 		trace_v3d_bcl_irq(&v3d->drm, fence->seqno);
+		trace_v3d_job_latency(&v3d->drm, V3D_BIN, fence->seqno,
+				      &bin->base);
+		v3d_set_hw_job(v3d, V3D_BIN, NULL);
 		dma_fence_signal(&fence->base);
 		status = IRQ_HANDLED;
 	}
@@ -115,6 +125,9 @@ v3d_irq(int irq, void *arg)
 		v3d->gpu_queue_stats[V3D_RENDER].last_exec_end = local_clock();
 
 		trace_v3d_rcl_irq(&v3d->drm, fence->seqno);
+		trace_v3d_job_latency(&v3d->drm, V3D_RENDER, fence->seqno,
+				      &v3d->render_job->base);
+		v3d_set_hw_job(v3d, V3D_RENDER, NULL);
 		dma_fence_signal(&fence->base);
 		status = IRQ_HANDLED;
 	}
@@ -126,6 +139,9 @@ v3d_irq(int irq, void *arg)
 		v3d->gpu_queue_stats[V3D_CSD].last_exec_end = local_clock();
 
 		trace_v3d_csd_irq(&v3d->drm, fence->seqno);
+		trace_v3d_job_latency(&v3d->drm, V3D_CSD, fence->seqno,
+				      &v3d->csd_job->base);
+		v3d_set_hw_job(v3d, V3D_CSD, NULL);
 		dma_fence_signal(&fence->base);
 		status = IRQ_HANDLED;
 	}
@@ -163,6 +179,9 @@ v3d_hub_irq(int irq, void *arg)
 		v3d->gpu_queue_stats[V3D_TFU].last_exec_end = local_clock();
 
 		trace_v3d_tfu_irq(&v3d->drm, fence->seqno);
+		trace_v3d_job_latency(&v3d->drm, V3D_TFU, fence->seqno,
+				      &v3d->tfu_job->base);
+		v3d_set_hw_job(v3d, V3D_TFU, NULL);
 		dma_fence_signal(&fence->base);
 		status = IRQ_HANDLED;
 	}
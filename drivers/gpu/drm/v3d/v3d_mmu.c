@@ -16,6 +16,10 @@
  * To protect clients from each other, we should use the GMP to
  * quickly mask out (at 128kb granularity) what pages are available to
  * each client.  This is not yet implemented.
+ *
+ * On V3D 4.1 and later, runs of 16 or 256 PTEs that are contiguous and
+ * aligned in both the GPU and bus address spaces get the bigpage or
+ * superpage bit, so that the TLB covers them with a single entry.
  */
 
 #include "v3d_drv.h"
@@ -25,6 +29,7 @@
  * superpage bit set.
  */
 #define V3D_PTE_SUPERPAGE BIT(31)
+#define V3D_PTE_BIGPAGE BIT(30)
 #define V3D_PTE_WRITEABLE BIT(29)
 #define V3D_PTE_VALID BIT(28)
 
@@ -82,29 +87,66 @@ int v3d_mmu_set_page_table(struct v3d_dev *v3d)
 	return v3d_mmu_flush_all(v3d);
 }
 
+static bool v3d_mmu_is_aligned(u32 page, u32 page_address, size_t alignment)
+{
+	return IS_ALIGNED(page, alignment >> V3D_MMU_PAGE_SHIFT) &&
+		IS_ALIGNED(page_address, alignment >> V3D_MMU_PAGE_SHIFT);
+}
+
 void v3d_mmu_insert_ptes(struct v3d_bo *bo)
 {
 	struct drm_gem_shmem_object *shmem_obj = &bo->base;
 	struct v3d_dev *v3d = to_v3d_dev(shmem_obj->base.dev);
 	u32 page = bo->node.start;
 	u32 page_prot = V3D_PTE_WRITEABLE | V3D_PTE_VALID;
-	struct sg_dma_page_iter dma_iter;
+	bool large_pages = v3d->ver >= 41;
+	u32 pages_64k = 0, pages_1m = 0;
+	struct scatterlist *sgl;
+	unsigned int count;
 
-	for_each_sgtable_dma_page(shmem_obj->sgt, &dma_iter, 0) {
-		dma_addr_t dma_addr = sg_page_iter_dma_address(&dma_iter);
+	for_each_sgtable_dma_sg(shmem_obj->sgt, sgl, count) {
+		dma_addr_t dma_addr = sg_dma_address(sgl);
 		u32 page_address = dma_addr >> V3D_MMU_PAGE_SHIFT;
-		u32 pte = page_prot | page_address;
-		u32 i;
-
-		BUG_ON(page_address + (PAGE_SIZE >> V3D_MMU_PAGE_SHIFT) >=
-		       BIT(24));
-		for (i = 0; i < PAGE_SIZE >> V3D_MMU_PAGE_SHIFT; i++)
-			v3d->pt[page++] = pte + i;
+		unsigned int len = sg_dma_len(sgl);
+
+		while (len > 0) {
+			u32 pte = page_prot | page_address;
+			unsigned int i, page_size;
+
+			if (large_pages && len >= SZ_1M &&
+			    v3d_mmu_is_aligned(page, page_address, SZ_1M)) {
+				page_size = SZ_1M;
+				pte |= V3D_PTE_SUPERPAGE;
+				pages_1m += SZ_1M >> V3D_MMU_PAGE_SHIFT;
+			} else if (large_pages && len >= SZ_64K &&
+				   v3d_mmu_is_aligned(page, page_address, SZ_64K)) {
+				page_size = SZ_64K;
+				pte |= V3D_PTE_BIGPAGE;
+				pages_64k += SZ_64K >> V3D_MMU_PAGE_SHIFT;
+			} else {
+				page_size = min_t(unsigned int, len,
+						  1 << V3D_MMU_PAGE_SHIFT);
+			}
+
+			BUG_ON(page_address + (page_size >> V3D_MMU_PAGE_SHIFT) >=
+			       BIT(24));
+			for (i = 0; i < page_size >> V3D_MMU_PAGE_SHIFT; i++)
+				v3d->pt[page++] = pte + i;
+
+			page_address += page_size >> V3D_MMU_PAGE_SHIFT;
+			len -= page_size;
+		}
 	}
 
 	WARN_ON_ONCE(page - bo->node.start !=
 		     shmem_obj->base.size >> V3D_MMU_PAGE_SHIFT);
 
+	mutex_lock(&v3d->bo_lock);
+	v3d->bo_stats.pages_4k += page - bo->node.start - pages_64k - pages_1m;
+	v3d->bo_stats.pages_64k += pages_64k;
+	v3d->bo_stats.pages_1m += pages_1m;
+	mutex_unlock(&v3d->bo_lock);
+
 	if (v3d_mmu_flush_all(v3d))
 		dev_err(v3d->drm.dev, "MMU flush timeout\n");
 }
@@ -113,10 +155,26 @@ void v3d_mmu_remove_ptes(struct v3d_bo *bo)
 {
 	struct v3d_dev *v3d = to_v3d_dev(bo->base.base.dev);
 	u32 npages = bo->base.base.size >> V3D_MMU_PAGE_SHIFT;
+	u32 pages_64k = 0, pages_1m = 0, pages_4k = 0;
 	u32 page;
 
-	for (page = bo->node.start; page < bo->node.start + npages; page++)
+	for (page = bo->node.start; page < bo->node.start + npages; page++) {
+		u32 pte = v3d->pt[page];
+
+		if (pte & V3D_PTE_SUPERPAGE)
+			pages_1m++;
+		else if (pte & V3D_PTE_BIGPAGE)
+			pages_64k++;
+		else if (pte & V3D_PTE_VALID)
+			pages_4k++;
 		v3d->pt[page] = 0;
+	}
+
+	mutex_lock(&v3d->bo_lock);
+	v3d->bo_stats.pages_4k -= pages_4k;
+	v3d->bo_stats.pages_64k -= pages_64k;
+	v3d->bo_stats.pages_1m -= pages_1m;
+	mutex_unlock(&v3d->bo_lock);
 
 	if (v3d_mmu_flush_all(v3d))
 		dev_err(v3d->drm.dev, "MMU flush timeout\n");
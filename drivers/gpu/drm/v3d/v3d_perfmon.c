@@ -3,12 +3,36 @@
  * Copyright (C) 2021 Raspberry Pi
  */
 
+#include <linux/hrtimer.h>
+#include <linux/mm.h>
+#include <linux/seq_file.h>
+#include <linux/vmalloc.h>
+
 #include "v3d_drv.h"
 #include "v3d_regs.h"
 
 #define V3D_PERFMONID_MIN	1
 #define V3D_PERFMONID_MAX	U32_MAX
 
+/* Sampling more often than this would mostly measure the sampler. */
+#define V3D_PERFMON_SAMPLE_MIN_PERIOD_NS	(100 * NSEC_PER_USEC)
+
+struct v3d_perfmon_sampler {
+	/* One reference for v3d->sampler, one per mapping of the ring. */
+	struct kref refcount;
+	struct v3d_dev *v3d;
+	struct hrtimer timer;
+	ktime_t period;
+
+	u8 ncounters;
+	u8 counters[DRM_V3D_MAX_PERF_COUNTERS];
+
+	void *vaddr;
+	size_t size;
+	struct v3d_perfmon_sample_header *header;
+	struct v3d_perfmon_sample *samples;
+};
+
 void v3d_perfmon_get(struct v3d_perfmon *perfmon)
 {
 	if (perfmon)
@@ -21,30 +45,26 @@ void v3d_perfmon_put(struct v3d_perfmon *perfmon)
 		kfree(perfmon);
 }
 
-void v3d_perfmon_start(struct v3d_dev *v3d, struct v3d_perfmon *perfmon)
+static void v3d_perfmon_program(struct v3d_dev *v3d, const u8 *counters,
+				u8 ncounters)
 {
 	unsigned int i;
 	u32 mask;
-	u8 ncounters;
-
-	if (WARN_ON_ONCE(!perfmon || v3d->active_perfmon))
-		return;
 
-	ncounters = perfmon->ncounters;
 	mask = GENMASK(ncounters - 1, 0);
 
 	for (i = 0; i < ncounters; i++) {
 		u32 source = i / 4;
-		u32 channel = V3D_SET_FIELD(perfmon->counters[i], V3D_PCTR_S0);
+		u32 channel = V3D_SET_FIELD(counters[i], V3D_PCTR_S0);
 
 		i++;
-		channel |= V3D_SET_FIELD(i < ncounters ? perfmon->counters[i] : 0,
+		channel |= V3D_SET_FIELD(i < ncounters ? counters[i] : 0,
 					 V3D_PCTR_S1);
 		i++;
-		channel |= V3D_SET_FIELD(i < ncounters ? perfmon->counters[i] : 0,
+		channel |= V3D_SET_FIELD(i < ncounters ? counters[i] : 0,
 					 V3D_PCTR_S2);
 		i++;
-		channel |= V3D_SET_FIELD(i < ncounters ? perfmon->counters[i] : 0,
+		channel |= V3D_SET_FIELD(i < ncounters ? counters[i] : 0,
 					 V3D_PCTR_S3);
 		V3D_CORE_WRITE(0, V3D_V4_PCTR_0_SRC_X(source), channel);
 	}
@@ -52,6 +72,14 @@ void v3d_perfmon_start(struct v3d_dev *v3d, struct v3d_perfmon *perfmon)
 	V3D_CORE_WRITE(0, V3D_V4_PCTR_0_CLR, mask);
 	V3D_CORE_WRITE(0, V3D_PCTR_0_OVERFLOW, mask);
 	V3D_CORE_WRITE(0, V3D_V4_PCTR_0_EN, mask);
+}
+
+void v3d_perfmon_start(struct v3d_dev *v3d, struct v3d_perfmon *perfmon)
+{
+	if (WARN_ON_ONCE(!perfmon || v3d->active_perfmon))
+		return;
+
+	v3d_perfmon_program(v3d, perfmon->counters, perfmon->ncounters);
 
 	v3d->active_perfmon = perfmon;
 }
@@ -80,6 +108,220 @@ void v3d_perfmon_stop(struct v3d_dev *v3d, struct v3d_perfmon *perfmon,
 	mutex_unlock(&perfmon->lock);
 }
 
+static void v3d_perfmon_sampler_release(struct kref *ref)
+{
+	struct v3d_perfmon_sampler *sampler =
+		container_of(ref, struct v3d_perfmon_sampler, refcount);
+
+	vfree(sampler->vaddr);
+	kfree(sampler);
+}
+
+static enum hrtimer_restart v3d_perfmon_sample(struct hrtimer *timer)
+{
+	struct v3d_perfmon_sampler *sampler =
+		container_of(timer, struct v3d_perfmon_sampler, timer);
+	struct v3d_dev *v3d = sampler->v3d;
+	u64 head = sampler->header->head;
+	struct v3d_perfmon_sample *sample =
+		&sampler->samples[head % V3D_PERFMON_SAMPLE_ENTRIES];
+	unsigned int i;
+
+	sample->timestamp_ns = ktime_get_ns();
+	for (i = 0; i < V3D_PERFMON_SAMPLE_QUEUES; i++) {
+		sample->seqno[i] = READ_ONCE(v3d->hw_job[i].seqno);
+		sample->pid[i] = READ_ONCE(v3d->hw_job[i].pid);
+	}
+	for (i = 0; i < sampler->ncounters; i++)
+		sample->values[i] = V3D_CORE_READ(0, V3D_PCTR_0_PCTRX(i));
+	V3D_CORE_WRITE(0, V3D_V4_PCTR_0_CLR,
+		       GENMASK(sampler->ncounters - 1, 0));
+
+	/* Publish the sample before moving head past it. */
+	smp_wmb();
+	WRITE_ONCE(sampler->header->head, head + 1);
+
+	hrtimer_forward_now(timer, sampler->period);
+
+	return HRTIMER_RESTART;
+}
+
+/*
+ * Starts periodically sampling the given counters into a ring buffer that
+ * can be mapped by userspace, no matter which client the running jobs
+ * belong to.  Any perfmon attached to the current job is stopped, and
+ * perfmons of later jobs are left alone until sampling is stopped.
+ */
+int v3d_perfmon_sampler_start(struct v3d_dev *v3d, u64 period_ns,
+			      const u8 *counters, u8 ncounters)
+{
+	struct v3d_perfmon_sampler *sampler;
+	unsigned int i;
+	int ret = 0;
+
+	if (!ncounters || ncounters > DRM_V3D_MAX_PERF_COUNTERS)
+		return -EINVAL;
+
+	for (i = 0; i < ncounters; i++) {
+		if (counters[i] >= V3D_PERFCNT_NUM)
+			return -EINVAL;
+	}
+
+	if (period_ns < V3D_PERFMON_SAMPLE_MIN_PERIOD_NS)
+		return -EINVAL;
+
+	sampler = kzalloc(sizeof(*sampler), GFP_KERNEL);
+	if (!sampler)
+		return -ENOMEM;
+
+	sampler->size = PAGE_ALIGN(PAGE_SIZE + V3D_PERFMON_SAMPLE_ENTRIES *
+				   sizeof(struct v3d_perfmon_sample));
+	sampler->vaddr = vmalloc_user(sampler->size);
+	if (!sampler->vaddr) {
+		kfree(sampler);
+		return -ENOMEM;
+	}
+
+	kref_init(&sampler->refcount);
+	sampler->v3d = v3d;
+	sampler->period = ns_to_ktime(period_ns);
+	sampler->ncounters = ncounters;
+	memcpy(sampler->counters, counters, ncounters);
+
+	sampler->header = sampler->vaddr;
+	sampler->samples = sampler->vaddr + PAGE_SIZE;
+	sampler->header->version = V3D_PERFMON_SAMPLE_VERSION;
+	sampler->header->ncounters = ncounters;
+	sampler->header->sample_size = sizeof(struct v3d_perfmon_sample);
+	sampler->header->nsamples = V3D_PERFMON_SAMPLE_ENTRIES;
+	sampler->header->period_ns = period_ns;
+	memcpy(sampler->header->counters, counters, ncounters);
+
+	hrtimer_init(&sampler->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	sampler->timer.function = v3d_perfmon_sample;
+
+	mutex_lock(&v3d->sampler_lock);
+	if (v3d->sampler) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	if (v3d->active_perfmon)
+		v3d_perfmon_stop(v3d, v3d->active_perfmon, true);
+
+	v3d_perfmon_program(v3d, counters, ncounters);
+	v3d->sampler = sampler;
+	hrtimer_start(&sampler->timer, sampler->period, HRTIMER_MODE_REL);
+
+unlock:
+	mutex_unlock(&v3d->sampler_lock);
+
+	if (ret)
+		kref_put(&sampler->refcount, v3d_perfmon_sampler_release);
+
+	return ret;
+}
+
+void v3d_perfmon_sampler_stop(struct v3d_dev *v3d)
+{
+	struct v3d_perfmon_sampler *sampler;
+
+	mutex_lock(&v3d->sampler_lock);
+	sampler = v3d->sampler;
+	if (sampler) {
+		hrtimer_cancel(&sampler->timer);
+		V3D_CORE_WRITE(0, V3D_V4_PCTR_0_EN, 0);
+		v3d->sampler = NULL;
+	}
+	mutex_unlock(&v3d->sampler_lock);
+
+	/* Existing mappings keep the ring alive until they go away. */
+	if (sampler)
+		kref_put(&sampler->refcount, v3d_perfmon_sampler_release);
+}
+
+/* Restores the sampled counter setup after a GPU reset. */
+void v3d_perfmon_sampler_reset(struct v3d_dev *v3d)
+{
+	mutex_lock(&v3d->sampler_lock);
+	if (v3d->sampler)
+		v3d_perfmon_program(v3d, v3d->sampler->counters,
+				    v3d->sampler->ncounters);
+	mutex_unlock(&v3d->sampler_lock);
+}
+
+static void v3d_perfmon_sampler_vm_open(struct vm_area_struct *vma)
+{
+	struct v3d_perfmon_sampler *sampler = vma->vm_private_data;
+
+	kref_get(&sampler->refcount);
+}
+
+static void v3d_perfmon_sampler_vm_close(struct vm_area_struct *vma)
+{
+	struct v3d_perfmon_sampler *sampler = vma->vm_private_data;
+
+	kref_put(&sampler->refcount, v3d_perfmon_sampler_release);
+}
+
+static const struct vm_operations_struct v3d_perfmon_sampler_vm_ops = {
+	.open = v3d_perfmon_sampler_vm_open,
+	.close = v3d_perfmon_sampler_vm_close,
+};
+
+int v3d_perfmon_sampler_mmap(struct v3d_dev *v3d, struct vm_area_struct *vma)
+{
+	struct v3d_perfmon_sampler *sampler;
+	int ret;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	mutex_lock(&v3d->sampler_lock);
+	sampler = v3d->sampler;
+	if (!sampler) {
+		ret = -ENODEV;
+		goto unlock;
+	}
+
+	ret = remap_vmalloc_range(vma, sampler->vaddr, vma->vm_pgoff);
+	if (ret)
+		goto unlock;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_private_data = sampler;
+	vma->vm_ops = &v3d_perfmon_sampler_vm_ops;
+	kref_get(&sampler->refcount);
+
+unlock:
+	mutex_unlock(&v3d->sampler_lock);
+
+	return ret;
+}
+
+void v3d_perfmon_sampler_show(struct v3d_dev *v3d, struct seq_file *m)
+{
+	struct v3d_perfmon_sampler *sampler;
+	unsigned int i;
+
+	mutex_lock(&v3d->sampler_lock);
+	sampler = v3d->sampler;
+	if (!sampler) {
+		seq_puts(m, "stopped\n");
+		goto unlock;
+	}
+
+	seq_printf(m, "period_us: %llu\n",
+		   div_u64(ktime_to_ns(sampler->period), NSEC_PER_USEC));
+	seq_puts(m, "counters:");
+	for (i = 0; i < sampler->ncounters; i++)
+		seq_printf(m, " %u", sampler->counters[i]);
+	seq_printf(m, "\nsamples: %llu\n", READ_ONCE(sampler->header->head));
+
+unlock:
+	mutex_unlock(&v3d->sampler_lock);
+}
+
 struct v3d_perfmon *v3d_perfmon_find(struct v3d_file_priv *v3d_priv, int id)
 {
 	struct v3d_perfmon *perfmon;
@@ -16,6 +16,12 @@
  * drm_sched_job_add_dependency() to manage the dependency between bin and
  * render, instead of having the clients submit jobs using the HW's
  * semaphores to interlock between them.
+ *
+ * To avoid a scheduler thread wakeup between the bin and render jobs
+ * of a frame, the render job only depends on its bin job having been
+ * scheduled.  If the bin job is still on the hardware by the time the
+ * render job runs, the render job is parked in v3d->chained_render
+ * and started from the FLDONE interrupt.
  */
 
 #include <linux/kthread.h>
@@ -66,11 +72,19 @@ v3d_sched_job_free(struct drm_sched_job *sched_job)
 static void
 v3d_switch_perfmon(struct v3d_dev *v3d, struct v3d_job *job)
 {
+	/* System-wide sampling owns the counters while it's enabled. */
+	mutex_lock(&v3d->sampler_lock);
+	if (v3d->sampler)
+		goto unlock;
+
 	if (job->perfmon != v3d->active_perfmon)
 		v3d_perfmon_stop(v3d, v3d->active_perfmon, true);
 
 	if (job->perfmon && v3d->active_perfmon != job->perfmon)
 		v3d_perfmon_start(v3d, job->perfmon);
+
+unlock:
+	mutex_unlock(&v3d->sampler_lock);
 }
 
 /*
@@ -189,14 +203,19 @@ static struct dma_fence *v3d_bin_job_run(struct drm_sched_job *sched_job)
 	struct dma_fence *fence;
 	unsigned long irqflags;
 
-	if (unlikely(job->base.base.s_fence->finished.error))
+	if (unlikely(job->base.base.s_fence->finished.error)) {
+		spin_lock_irqsave(&v3d->job_lock, irqflags);
+		v3d_chain_bin_done(v3d, job, job->base.base.s_fence->finished.error);
+		spin_unlock_irqrestore(&v3d->job_lock, irqflags);
 		return NULL;
+	}
 
 	/* Lock required around bin_job update vs
 	 * v3d_overflow_mem_work().
 	 */
 	spin_lock_irqsave(&v3d->job_lock, irqflags);
 	v3d->bin_job = job;
+	job->hw_done = false;
 	/* Clear out the overflow allocation, so we don't
 	 * reuse the overflow attached to a previous job.
 	 */
@@ -206,8 +225,12 @@ static struct dma_fence *v3d_bin_job_run(struct drm_sched_job *sched_job)
 	v3d_invalidate_caches(v3d);
 
 	fence = v3d_fence_create(v3d, V3D_BIN);
-	if (IS_ERR(fence))
+	if (IS_ERR(fence)) {
+		spin_lock_irqsave(&v3d->job_lock, irqflags);
+		v3d_chain_bin_done(v3d, job, PTR_ERR(fence));
+		spin_unlock_irqrestore(&v3d->job_lock, irqflags);
 		return NULL;
+	}
 
 	if (job->base.irq_fence)
 		dma_fence_put(job->base.irq_fence);
@@ -231,22 +254,83 @@ static struct dma_fence *v3d_bin_job_run(struct drm_sched_job *sched_job)
 			       V3D_CLE_CT0QTS_ENABLE |
 			       job->qts);
 	}
+	job->base.run_ns = ktime_get_ns();
+	v3d_set_hw_job(v3d, V3D_BIN, &job->base);
 	V3D_CORE_WRITE(0, V3D_CLE_CT0QBA, job->start);
 	V3D_CORE_WRITE(0, V3D_CLE_CT0QEA, job->end);
 
 	return fence;
 }
 
+/*
+ * Sets the current and end address of the control list.  Writing the
+ * end register is what starts the job.
+ */
+void
+v3d_render_job_kick(struct v3d_dev *v3d, struct v3d_render_job *job)
+{
+	/* XXX: Set the QCFG */
+
+	job->base.run_ns = ktime_get_ns();
+	v3d_set_hw_job(v3d, V3D_RENDER, &job->base);
+	V3D_CORE_WRITE(0, V3D_CLE_CT1QBA, job->start);
+	V3D_CORE_WRITE(0, V3D_CLE_CT1QEA, job->end);
+}
+
+/*
+ * Called with job_lock held once a bin job has left the hardware, either
+ * from its FLDONE interrupt or because it never got started.  Kicks the
+ * render job chained to it if that one is already waiting, or fails it
+ * if the bin job did.
+ */
+void
+v3d_chain_bin_done(struct v3d_dev *v3d, struct v3d_bin_job *bin, int error)
+{
+	struct v3d_render_job *render = v3d->chained_render;
+
+	lockdep_assert_held(&v3d->job_lock);
+
+	bin->hw_done = true;
+	bin->hw_error = error;
+
+	if (!render || render->bin != bin)
+		return;
+
+	v3d->chained_render = NULL;
+	if (error) {
+		/* job_lock is the fence lock. */
+		dma_fence_set_error(render->base.irq_fence, error);
+		dma_fence_signal_locked(render->base.irq_fence);
+		return;
+	}
+
+	v3d_render_job_kick(v3d, render);
+}
+
 static struct dma_fence *v3d_render_job_run(struct drm_sched_job *sched_job)
 {
 	struct v3d_render_job *job = to_render_job(sched_job);
 	struct v3d_dev *v3d = job->base.v3d;
 	struct drm_device *dev = &v3d->drm;
 	struct dma_fence *fence;
+	unsigned long irqflags;
+	bool chained = false;
+	int error = 0;
 
 	if (unlikely(job->base.base.s_fence->finished.error))
 		return NULL;
 
+	if (job->bin) {
+		spin_lock_irqsave(&v3d->job_lock, irqflags);
+		error = job->bin->hw_done ? job->bin->hw_error : 0;
+		spin_unlock_irqrestore(&v3d->job_lock, irqflags);
+		if (error) {
+			dma_fence_set_error(&job->base.base.s_fence->finished,
+					    error);
+			return NULL;
+		}
+	}
+
 	v3d->render_job = job;
 
 	/* Can we avoid this flush?  We need to be careful of
@@ -254,6 +338,10 @@ static struct dma_fence *v3d_render_job_run(struct drm_sched_job *sched_job)
 	 * job1 reading, and them being executed as bin0, bin1,
 	 * render0, render1, so that render1's flush at bin time
 	 * wasn't enough.
+	 *
+	 * This still happens here for a chained job: render0 has
+	 * finished by now, and the bin job only produces tile lists
+	 * that don't go through these caches.
 	 */
 	v3d_invalidate_caches(v3d);
 
@@ -271,13 +359,15 @@ static struct dma_fence *v3d_render_job_run(struct drm_sched_job *sched_job)
 	v3d_sched_stats_add_job(&v3d->gpu_queue_stats[V3D_RENDER], sched_job);
 	v3d_switch_perfmon(v3d, &job->base);
 
-	/* XXX: Set the QCFG */
+	spin_lock_irqsave(&v3d->job_lock, irqflags);
+	if (job->bin && !job->bin->hw_done) {
+		v3d->chained_render = job;
+		chained = true;
+	}
+	spin_unlock_irqrestore(&v3d->job_lock, irqflags);
 
-	/* Set the current and end address of the control list.
-	 * Writing the end register is what starts the job.
-	 */
-	V3D_CORE_WRITE(0, V3D_CLE_CT1QBA, job->start);
-	V3D_CORE_WRITE(0, V3D_CLE_CT1QEA, job->end);
+	if (!chained)
+		v3d_render_job_kick(v3d, job);
 
 	return fence;
 }
@@ -302,6 +392,8 @@ v3d_tfu_job_run(struct drm_sched_job *sched_job)
 	job->base.irq_fence = dma_fence_get(fence);
 
 	trace_v3d_submit_tfu(dev, to_v3d_fence(fence)->seqno);
+	job->base.run_ns = ktime_get_ns();
+	v3d_set_hw_job(v3d, V3D_TFU, &job->base);
 
 	v3d_sched_stats_add_job(&v3d->gpu_queue_stats[V3D_TFU], sched_job);
 	V3D_WRITE(V3D_TFU_REG(IIA), job->args.iia);
@@ -354,6 +446,8 @@ v3d_csd_job_run(struct drm_sched_job *sched_job)
 	csd_cfg_reg_count = v3d->ver < 71 ? 6 : 7;
 	for (i = 1; i <= csd_cfg_reg_count; i++)
 		V3D_CORE_WRITE(0, csd_cfg0_reg + 4 * i, job->args.cfg[i]);
+	job->base.run_ns = ktime_get_ns();
+	v3d_set_hw_job(v3d, V3D_CSD, &job->base);
 	/* CFG0 write kicks off the job. */
 	V3D_CORE_WRITE(0, csd_cfg0_reg, job->args.cfg[0]);
 
@@ -377,6 +471,7 @@ v3d_cache_clean_job_run(struct drm_sched_job *sched_job)
 static enum drm_gpu_sched_stat
 v3d_gpu_reset_for_timeout(struct v3d_dev *v3d, struct drm_sched_job *sched_job)
 {
+	unsigned long irqflags;
 	enum v3d_queue q;
 
 	mutex_lock(&v3d->reset_lock);
@@ -391,6 +486,13 @@ v3d_gpu_reset_for_timeout(struct v3d_dev *v3d, struct drm_sched_job *sched_job)
 	/* get the GPU back into the init state */
 	v3d_reset(v3d);
 
+	/* Any chained render job gets run again below. */
+	spin_lock_irqsave(&v3d->job_lock, irqflags);
+	v3d->chained_render = NULL;
+	spin_unlock_irqrestore(&v3d->job_lock, irqflags);
+
+	v3d_perfmon_sampler_reset(v3d);
+
 	for (q = 0; q < V3D_MAX_QUEUES; q++)
 		drm_sched_resubmit_jobs(&v3d->queue[q].sched);
 
@@ -440,6 +542,18 @@ static enum drm_gpu_sched_stat
 v3d_render_job_timedout(struct drm_sched_job *sched_job)
 {
 	struct v3d_render_job *job = to_render_job(sched_job);
+	struct v3d_dev *v3d = job->base.v3d;
+	unsigned long irqflags;
+	bool chained;
+
+	/* A render job still waiting on its bin job hasn't started, and
+	 * the bin job's own timeout takes care of a hung binner.
+	 */
+	spin_lock_irqsave(&v3d->job_lock, irqflags);
+	chained = v3d->chained_render == job;
+	spin_unlock_irqrestore(&v3d->job_lock, irqflags);
+	if (chained)
+		return DRM_GPU_SCHED_STAT_NOMINAL;
 
 	return v3d_cl_job_timedout(sched_job, V3D_RENDER,
 				   &job->timedout_ctca, &job->timedout_ctra);
@@ -225,6 +225,40 @@ TRACE_EVENT(v3d_submit_csd,
 		      __entry->seqno)
 );
 
+TRACE_EVENT(v3d_job_latency,
+	    TP_PROTO(struct drm_device *dev, enum v3d_queue queue,
+		     uint64_t seqno, struct v3d_job *job),
+	    TP_ARGS(dev, queue, seqno, job),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __string(queue, v3d_queue_to_string(queue))
+			     __field(u64, seqno)
+			     __field(u64, submit_ns)
+			     __field(u64, queue_ns)
+			     __field(u64, run_ns)
+			     __field(u64, complete_ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = dev->primary->index;
+			   __assign_str(queue, v3d_queue_to_string(queue));
+			   __entry->seqno = seqno;
+			   __entry->submit_ns = job->submit_ns;
+			   __entry->queue_ns = job->queue_ns;
+			   __entry->run_ns = job->run_ns;
+			   __entry->complete_ns = ktime_get_ns();
+			   ),
+
+	    TP_printk("dev=%u, %s, seqno=%llu, submit->queue %lluns, queue->run %lluns, run->complete %lluns",
+		      __entry->dev,
+		      __get_str(queue),
+		      __entry->seqno,
+		      __entry->queue_ns - __entry->submit_ns,
+		      __entry->run_ns - __entry->queue_ns,
+		      __entry->complete_ns - __entry->run_ns)
+);
+
 TRACE_EVENT(v3d_cache_clean_begin,
 	    TP_PROTO(struct drm_device *dev),
 	    TP_ARGS(dev),
@@ -337,6 +337,24 @@ struct vc4_v3d {
 
 #define HVS_NUM_CHANNELS 3
 
+/*
+ * Each channel keeps two long-lived regions of the dlist memory and
+ * flips between them on every commit, so that a commit can be
+ * written to one while the hardware is still scanning out the other.
+ */
+#define VC4_HVS_DLIST_BANKS 2
+
+struct vc4_hvs_dlist_bank {
+	struct drm_mm_node mm_node;
+	/* Allocation currently using the bank, NULL if none. */
+	struct vc4_hvs_dlist_allocation *owner;
+	/* Set when the owner was released after being programmed. The
+	 * bank can't be reused until target_frame_count is reached.
+	 */
+	bool retiring;
+	u8 target_frame_count;
+};
+
 struct vc4_hvs {
 	struct vc4_dev *vc4;
 	struct platform_device *pdev;
@@ -370,6 +388,9 @@ struct vc4_hvs {
 	struct list_head stale_dlist_entries;
 	struct work_struct free_dlist_work;
 
+	/* Protected by mm_lock. */
+	struct vc4_hvs_dlist_bank dlist_banks[HVS_NUM_CHANNELS][VC4_HVS_DLIST_BANKS];
+
 	struct drm_mm_node mitchell_netravali_filter;
 
 	struct debugfs_regset32 regset;
@@ -695,6 +716,13 @@ struct drm_encoder *vc4_get_crtc_encoder(struct drm_crtc *crtc,
 struct vc4_hvs_dlist_allocation {
 	struct list_head node;
 	struct drm_mm_node mm_node;
+	/* Bank backing this allocation, if any, in which case mm_node
+	 * is unused.
+	 */
+	struct vc4_hvs_dlist_bank *bank;
+	/* Offset and size of the display list, in dwords. */
+	u32 start;
+	u32 size;
 	unsigned int channel;
 	u8 target_frame_count;
 	bool dlist_programmed;
@@ -1130,6 +1158,7 @@ struct vc4_hvs *__vc4_hvs_alloc(struct vc4_dev *vc4,
 void vc4_hvs_stop_channel(struct vc4_hvs *hvs, unsigned int output);
 int vc4_hvs_get_fifo_from_output(struct vc4_hvs *hvs, unsigned int output);
 u8 vc4_hvs_get_fifo_frame_count(struct vc4_hvs *hvs, unsigned int fifo);
+bool vc4_hvs_check_channel_active(struct vc4_hvs *hvs, unsigned int fifo);
 void vc4_hvs_mark_dlist_entry_stale(struct vc4_hvs *hvs,
 				    struct vc4_hvs_dlist_allocation *alloc);
 int vc4_hvs_atomic_check(struct drm_crtc *crtc, struct drm_atomic_state *state);
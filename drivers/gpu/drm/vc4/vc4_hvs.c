@@ -357,6 +357,7 @@ static int vc4_hvs_debugfs_dlist_allocs(struct seq_file *m, void *data)
 	struct vc4_hvs_dlist_allocation *cur, *next;
 	struct drm_mm_node *mm_node;
 	unsigned long flags;
+	unsigned int i, j;
 
 	spin_lock_irqsave(&hvs->mm_lock, flags);
 
@@ -372,6 +373,26 @@ static int vc4_hvs_debugfs_dlist_allocs(struct seq_file *m, void *data)
 			   cur->target_frame_count);
 	}
 
+	drm_printf(&p, "Banks:\n");
+	for (i = 0; i < HVS_NUM_CHANNELS; i++) {
+		for (j = 0; j < VC4_HVS_DLIST_BANKS; j++) {
+			struct vc4_hvs_dlist_bank *bank = &hvs->dlist_banks[i][j];
+
+			if (!drm_mm_node_allocated(&bank->mm_node))
+				continue;
+
+			drm_printf(&p, "node [%08llx + %08llx] channel %u bank %u %s",
+				   bank->mm_node.start, bank->mm_node.size, i, j,
+				   bank->owner ? "in use" :
+				   bank->retiring ? "retiring" : "idle");
+			if (bank->owner)
+				drm_printf(&p, " (%u dwords)", bank->owner->size);
+			if (bank->retiring)
+				drm_printf(&p, " frcnt %u", bank->target_frame_count);
+			drm_printf(&p, "\n");
+		}
+	}
+
 	spin_unlock_irqrestore(&hvs->mm_lock, flags);
 
 	return 0;
@@ -636,6 +657,108 @@ static void vc4_hvs_irq_clear_eof(struct vc4_hvs *hvs,
 
 static void vc4_hvs_free_dlist_entry_locked(struct vc4_hvs *hvs,
 					    struct vc4_hvs_dlist_allocation *alloc);
+static bool vc4_hvs_frcnt_lte(u8 cnt1, u8 cnt2);
+
+/*
+ * Banks are sized with some headroom so that small changes in the
+ * number of planes don't force them to be reallocated.
+ */
+#define VC4_HVS_DLIST_BANK_ALIGN 64
+
+static bool vc4_hvs_dlist_bank_idle_locked(struct vc4_hvs *hvs,
+					   unsigned int channel,
+					   struct vc4_hvs_dlist_bank *bank)
+{
+	lockdep_assert_held(&hvs->mm_lock);
+
+	if (bank->owner)
+		return false;
+
+	if (!bank->retiring)
+		return true;
+
+	if (vc4_hvs_check_channel_active(hvs, channel) &&
+	    !vc4_hvs_frcnt_lte(bank->target_frame_count,
+			       vc4_hvs_get_fifo_frame_count(hvs, channel)))
+		return false;
+
+	bank->retiring = false;
+	return true;
+}
+
+/*
+ * Returns an idle bank of the channel that can hold dlist_count dwords,
+ * (re)allocating one of them if neither is large enough. Returns NULL
+ * if both banks are still in use by the hardware or there isn't enough
+ * room left, in which case the caller falls back to a one-off
+ * allocation.
+ */
+static struct vc4_hvs_dlist_bank *
+vc4_hvs_get_dlist_bank_locked(struct vc4_hvs *hvs, unsigned int channel,
+			      size_t dlist_count)
+{
+	struct vc4_hvs_dlist_bank *bank = NULL;
+	unsigned int i;
+	int ret;
+
+	lockdep_assert_held(&hvs->mm_lock);
+
+	if (channel >= HVS_NUM_CHANNELS)
+		return NULL;
+
+	for (i = 0; i < VC4_HVS_DLIST_BANKS; i++) {
+		struct vc4_hvs_dlist_bank *cur = &hvs->dlist_banks[channel][i];
+
+		if (!vc4_hvs_dlist_bank_idle_locked(hvs, channel, cur))
+			continue;
+
+		if (drm_mm_node_allocated(&cur->mm_node) &&
+		    cur->mm_node.size >= dlist_count)
+			return cur;
+
+		if (!bank)
+			bank = cur;
+	}
+
+	if (!bank)
+		return NULL;
+
+	if (drm_mm_node_allocated(&bank->mm_node))
+		drm_mm_remove_node(&bank->mm_node);
+
+	ret = drm_mm_insert_node(&hvs->dlist_mm, &bank->mm_node,
+				 round_up(dlist_count, VC4_HVS_DLIST_BANK_ALIGN));
+	if (ret)
+		return NULL;
+
+	return bank;
+}
+
+/*
+ * Gives the space of the banks that aren't used by any channel back to
+ * the allocator, so that their regions can be merged with their free
+ * neighbours.
+ */
+static void vc4_hvs_reclaim_dlist_banks_locked(struct vc4_hvs *hvs)
+{
+	unsigned int i, j;
+
+	lockdep_assert_held(&hvs->mm_lock);
+
+	for (i = 0; i < HVS_NUM_CHANNELS; i++) {
+		for (j = 0; j < VC4_HVS_DLIST_BANKS; j++) {
+			struct vc4_hvs_dlist_bank *bank = &hvs->dlist_banks[i][j];
+
+			if (!drm_mm_node_allocated(&bank->mm_node))
+				continue;
+
+			if (!vc4_hvs_dlist_bank_idle_locked(hvs, i, bank))
+				continue;
+
+			drm_mm_remove_node(&bank->mm_node);
+		}
+	}
+}
 
 static struct vc4_hvs_dlist_allocation *
 vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
@@ -646,6 +769,7 @@ vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
 	struct drm_device *dev = &vc4->base;
 	struct vc4_hvs_dlist_allocation *alloc;
 	struct vc4_hvs_dlist_allocation *cur, *next;
+	struct vc4_hvs_dlist_bank *bank;
 	unsigned long flags;
 	int ret;
 
@@ -657,8 +781,19 @@ vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
 		return ERR_PTR(-ENOMEM);
 
 	INIT_LIST_HEAD(&alloc->node);
+	alloc->channel = channel;
+	alloc->size = dlist_count;
 
 	spin_lock_irqsave(&hvs->mm_lock, flags);
+	bank = vc4_hvs_get_dlist_bank_locked(hvs, channel, dlist_count);
+	if (bank) {
+		bank->owner = alloc;
+		alloc->bank = bank;
+		alloc->start = bank->mm_node.start;
+		spin_unlock_irqrestore(&hvs->mm_lock, flags);
+		return alloc;
+	}
+
 	ret = drm_mm_insert_node(&hvs->dlist_mm, &alloc->mm_node,
 				 dlist_count);
 	spin_unlock_irqrestore(&hvs->mm_lock, flags);
@@ -669,23 +804,26 @@ vc4_hvs_alloc_dlist_entry(struct vc4_hvs *hvs,
 		/* This should never happen as stale entries should get released
 		 * as the frame counter interrupt triggers.
 		 * However we've seen this fail for reasons currently unknown.
-		 * Free all stale entries now so we should be able to complete
-		 * this allocation.
+		 * Free all stale entries and idle banks now so we should be
+		 * able to complete this allocation.
 		 */
 		spin_lock_irqsave(&hvs->mm_lock, flags);
 		list_for_each_entry_safe(cur, next, &hvs->stale_dlist_entries, node) {
 			vc4_hvs_free_dlist_entry_locked(hvs, cur);
 		}
+		vc4_hvs_reclaim_dlist_banks_locked(hvs);
 
 		ret = drm_mm_insert_node(&hvs->dlist_mm, &alloc->mm_node,
 					 dlist_count);
 		spin_unlock_irqrestore(&hvs->mm_lock, flags);
 
-		if (ret)
+		if (ret) {
+			kfree(alloc);
 			return ERR_PTR(ret);
+		}
 	}
 
-	alloc->channel = channel;
+	alloc->start = alloc->mm_node.start;
 
 	return alloc;
 }
@@ -711,6 +849,28 @@ void vc4_hvs_mark_dlist_entry_stale(struct vc4_hvs *hvs,
 	if (!alloc)
 		return;
 
+	/*
+	 * A bank only needs to wait for the hardware to move past it
+	 * before it can be handed out again, which is checked when
+	 * allocating so there's nothing to sweep.
+	 */
+	if (alloc->bank) {
+		struct vc4_hvs_dlist_bank *bank = alloc->bank;
+		bool retiring = !kunit_get_current_test() && alloc->dlist_programmed;
+
+		frcnt = retiring ?
+			vc4_hvs_get_fifo_frame_count(hvs, alloc->channel) : 0;
+
+		spin_lock_irqsave(&hvs->mm_lock, flags);
+		bank->owner = NULL;
+		bank->retiring = retiring;
+		bank->target_frame_count = (frcnt + 1) & ((1 << 6) - 1);
+		spin_unlock_irqrestore(&hvs->mm_lock, flags);
+
+		kfree(alloc);
+		return;
+	}
+
 	if (!drm_mm_node_allocated(&alloc->mm_node))
 		return;
 
@@ -1253,11 +1413,11 @@ static void vc4_hvs_install_dlist(struct drm_crtc *crtc)
 
 	if (vc4->gen >= VC4_GEN_6)
 		HVS_WRITE(SCALER6_DISPX_LPTRS(vc4_state->assigned_channel),
-			  VC4_SET_FIELD(vc4_state->mm->mm_node.start,
+			  VC4_SET_FIELD(vc4_state->mm->start,
 					SCALER6_DISPX_LPTRS_HEADE));
 	else
 		HVS_WRITE(SCALER_DISPLISTX(vc4_state->assigned_channel),
-			  vc4_state->mm->mm_node.start);
+			  vc4_state->mm->start);
 
 	drm_dev_exit(idx);
 }
@@ -1287,7 +1447,7 @@ static void vc4_hvs_update_dlist(struct drm_crtc *crtc)
 	WARN_ON(!vc4_state->mm);
 
 	spin_lock_irqsave(&vc4_crtc->irq_lock, flags);
-	vc4_crtc->current_dlist = vc4_state->mm->mm_node.start;
+	vc4_crtc->current_dlist = vc4_state->mm->start;
 	spin_unlock_irqrestore(&vc4_crtc->irq_lock, flags);
 }
 
@@ -1400,7 +1560,7 @@ void vc4_hvs_atomic_flush(struct drm_crtc *crtc,
 
 	lbm_offset = vc4_crtc->lbm.start;
 
-	dlist_start = vc4->hvs->dlist + vc4_state->mm->mm_node.start;
+	dlist_start = vc4->hvs->dlist + vc4_state->mm->start;
 	dlist_next = dlist_start;
 
 	/* Copy all the active planes' dlist contents to the hardware dlist. */
@@ -1444,7 +1604,7 @@ void vc4_hvs_atomic_flush(struct drm_crtc *crtc,
 	dlist_next++;
 
 	WARN_ON(!vc4_state->mm);
-	WARN_ON_ONCE(dlist_next - dlist_start != vc4_state->mm->mm_node.size);
+	WARN_ON_ONCE(dlist_next - dlist_start != vc4_state->mm->size);
 
 	if (vc4->gen >= VC4_GEN_6) {
 		/* This sets a black background color fill, as is the case
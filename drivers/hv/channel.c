@@ -1088,6 +1088,29 @@ int vmbus_sendpacket_getid(struct vmbus_channel *channel, void *buffer,
 }
 EXPORT_SYMBOL(vmbus_sendpacket_getid);
 
+/**
+ * vmbus_sendpacket_batch() - Send several in-band packets at once
+ * @channel: Pointer to vmbus_channel structure
+ * @pkts: Packets to send, in order
+ * @count: Number of packets in @pkts
+ * @sent: Set to the number of packets actually sent
+ *
+ * Writes as many of @pkts as fit into the outbound ring buffer with a
+ * single lock acquisition and write index update, and signals the host
+ * at most once. Packets are sent in order; a short write stops at the
+ * first packet that does not fit.
+ *
+ * Return: 0 if all packets were sent, otherwise a negative errno with
+ * @sent telling how many made it, e.g. -EAGAIN when the ring is full.
+ */
+int vmbus_sendpacket_batch(struct vmbus_channel *channel,
+			   struct vmbus_batch_packet *pkts, u32 count,
+			   u32 *sent)
+{
+	return hv_ringbuffer_write_batch(channel, pkts, count, sent);
+}
+EXPORT_SYMBOL(vmbus_sendpacket_batch);
+
 /**
  * vmbus_sendpacket() - Send the specified buffer on the given channel
  * @channel: Pointer to vmbus_channel structure
@@ -8,6 +8,7 @@
 #include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/err.h>
+#include <linux/seq_file.h>
 
 #include "hyperv_vmbus.h"
 
@@ -98,6 +99,32 @@ static int hv_debug_set_test_state(struct hv_device *dev, struct dentry *root)
 	return 0;
 }
 
+static void hv_debug_show_channel(struct seq_file *m,
+				  struct vmbus_channel *channel)
+{
+	seq_printf(m, "%u: interrupts %llu sig_events %llu intr_out_empty %llu intr_in_full %llu out_full_total %llu out_batches %llu out_batched_pkts %llu\n",
+		   channel->offermsg.child_relid, channel->interrupts,
+		   channel->sig_events, channel->intr_out_empty,
+		   channel->intr_in_full, channel->out_full_total,
+		   channel->out_batches, channel->out_batched_pkts);
+}
+
+/* Signalling statistics of the primary channel and all sub-channels */
+static int hv_debugfs_signals_show(struct seq_file *m, void *unused)
+{
+	struct hv_device *dev = m->private;
+	struct vmbus_channel *channel = dev->channel, *sc;
+
+	mutex_lock(&vmbus_connection.channel_mutex);
+	hv_debug_show_channel(m, channel);
+	list_for_each_entry(sc, &channel->sc_list, sc_list)
+		hv_debug_show_channel(m, sc);
+	mutex_unlock(&vmbus_connection.channel_mutex);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hv_debugfs_signals);
+
 /* Bind hv device to a dentry for debugfs */
 static void hv_debug_set_dir_dentry(struct hv_device *dev, struct dentry *root)
 {
@@ -122,6 +149,8 @@ int hv_debug_add_dev_dir(struct hv_device *dev)
 		}
 		hv_debug_set_test_state(dev, dev_root);
 		hv_debug_set_dir_dentry(dev, dev_root);
+		debugfs_create_file("signals", 0444, dev_root, dev,
+				    &hv_debugfs_signals_fops);
 		delay = debugfs_create_dir(delay_name, dev_root);
 
 		if (IS_ERR(delay)) {
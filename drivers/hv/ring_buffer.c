@@ -407,6 +407,133 @@ int hv_ringbuffer_write(struct vmbus_channel *channel,
 	return 0;
 }
 
+/*
+ * Write several packets behind a single write index update.  Only
+ * the transition of the ring from empty to non-empty can require a
+ * signal, so the decision is made once for the whole batch, against
+ * the write index the batch started at.
+ */
+int hv_ringbuffer_write_batch(struct vmbus_channel *channel,
+			      struct vmbus_batch_packet *pkts, u32 count,
+			      u32 *sent)
+{
+	struct hv_ring_buffer_info *outring_info = &channel->outbound;
+	u32 bytes_avail_towrite, next_write_location, old_write;
+	u64 aligned_data = 0;
+	unsigned long flags;
+	int ret = 0;
+	u32 i, j;
+
+	*sent = 0;
+	if (channel->rescind)
+		return -ENODEV;
+
+	spin_lock_irqsave(&outring_info->ring_lock, flags);
+
+	bytes_avail_towrite = hv_get_bytes_to_write(outring_info);
+	next_write_location = hv_get_next_write_location(outring_info);
+	old_write = next_write_location;
+
+	for (i = 0; i < count; i++) {
+		struct vmbus_batch_packet *pkt = &pkts[i];
+		u32 packetlen = sizeof(struct vmpacket_descriptor) +
+				pkt->bufferlen;
+		u32 packetlen_aligned = ALIGN(packetlen, sizeof(u64));
+		u32 pkt_start = next_write_location;
+		struct vmpacket_descriptor desc, *ring_desc;
+		u64 rqst_id = VMBUS_NO_RQSTOR;
+		u64 prev_indices;
+
+		/* Same "only room for the packet is full" rule as above */
+		if (bytes_avail_towrite <= packetlen_aligned + sizeof(u64)) {
+			++channel->out_full_total;
+
+			if (!channel->out_full_flag) {
+				++channel->out_full_first;
+				channel->out_full_flag = true;
+			}
+			ret = -EAGAIN;
+			break;
+		}
+		channel->out_full_flag = false;
+
+		desc.type = pkt->type;
+		desc.flags = pkt->flags;
+		desc.offset8 = sizeof(struct vmpacket_descriptor) >> 3;
+		desc.len8 = (u16)(packetlen_aligned >> 3);
+		desc.trans_id = VMBUS_RQST_ERROR;
+
+		next_write_location = hv_copyto_ringbuffer(outring_info,
+						next_write_location, &desc,
+						sizeof(desc));
+		if (pkt->bufferlen) {
+			next_write_location = hv_copyto_ringbuffer(outring_info,
+						next_write_location,
+						pkt->buffer, pkt->bufferlen);
+			next_write_location = hv_copyto_ringbuffer(outring_info,
+						next_write_location,
+						&aligned_data,
+						packetlen_aligned - packetlen);
+		}
+
+		/* As in hv_ringbuffer_write(), only once the data is in */
+		if (pkt->flags == VMBUS_DATA_PACKET_FLAG_COMPLETION_REQUESTED &&
+		    channel->next_request_id_callback != NULL) {
+			rqst_id = channel->next_request_id_callback(channel,
+							pkt->requestid);
+			if (rqst_id == VMBUS_RQST_ERROR) {
+				next_write_location = pkt_start;
+				ret = -EAGAIN;
+				break;
+			}
+		}
+		ring_desc = hv_get_ring_buffer(outring_info) + pkt_start;
+		pkt->trans_id = (rqst_id == VMBUS_NO_RQSTOR) ? pkt->requestid :
+							       rqst_id;
+		WRITE_ONCE(ring_desc->trans_id, pkt->trans_id);
+
+		/* The trailer holds where this packet started */
+		prev_indices = (u64)pkt_start << 32;
+		next_write_location = hv_copyto_ringbuffer(outring_info,
+						next_write_location,
+						&prev_indices, sizeof(u64));
+
+		bytes_avail_towrite -= packetlen_aligned + sizeof(u64);
+	}
+
+	if (i) {
+		/* Issue a full memory barrier before updating the write index */
+		virt_mb();
+		hv_set_next_write_location(outring_info, next_write_location);
+		++channel->out_batches;
+		channel->out_batched_pkts += i;
+	}
+
+	spin_unlock_irqrestore(&outring_info->ring_lock, flags);
+
+	if (!i)
+		return ret;
+
+	hv_signal_on_write(old_write, channel);
+	*sent = i;
+
+	if (channel->rescind) {
+		/* Reclaim request IDs to avoid leaking them */
+		if (channel->request_addr_callback != NULL) {
+			for (j = 0; j < i; j++) {
+				if (pkts[j].flags ==
+				    VMBUS_DATA_PACKET_FLAG_COMPLETION_REQUESTED &&
+				    channel->next_request_id_callback != NULL)
+					channel->request_addr_callback(channel,
+							pkts[j].trans_id);
+			}
+		}
+		return -ENODEV;
+	}
+
+	return ret;
+}
+
 int hv_ringbuffer_read(struct vmbus_channel *channel,
 		       void *buffer, u32 buflen, u32 *buffer_actual_len,
 		       u64 *requestid, bool raw)
@@ -1458,7 +1458,7 @@ int rxe_responder(void *arg)
 	}
 
 	/* A non-zero return value will cause rxe_do_task to
-	 * exit its loop and end the tasklet. A zero return
+	 * exit its loop and end the task. A zero return
 	 * will continue looping and return to rxe_responder
 	 */
 done:
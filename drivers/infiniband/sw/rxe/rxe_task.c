@@ -7,9 +7,45 @@
 #include <linux/kernel.h>
 #include <linux/interrupt.h>
 #include <linux/hardirq.h>
+#include <linux/moduleparam.h>
+#include <linux/workqueue.h>
 
 #include "rxe.h"
 
+static struct workqueue_struct *rxe_wq;
+
+/* 0 selects the workqueue default */
+static unsigned int max_active;
+module_param(max_active, uint, 0444);
+MODULE_PARM_DESC(max_active,
+		 "Max number of rxe tasks running concurrently per node (0 = default)");
+
+int rxe_alloc_wq(void)
+{
+	/* unbound, so the tasks of one busy QP pair are no longer tied
+	 * to the cpu that happened to take the packet or the verb
+	 */
+	rxe_wq = alloc_workqueue("rxe_wq", WQ_UNBOUND, max_active);
+	if (!rxe_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void rxe_destroy_wq(void)
+{
+	destroy_workqueue(rxe_wq);
+}
+
+/* called with state_lock held */
+static void __rxe_queue_task(struct rxe_task *task)
+{
+	if (task->disabled)
+		task->sched_pending = true;
+	else
+		queue_work(rxe_wq, &task->work);
+}
+
 int __rxe_do_task(struct rxe_task *task)
 
 {
@@ -28,11 +64,10 @@ int __rxe_do_task(struct rxe_task *task)
  * a second caller finds the task already running
  * but looks just after the last call to func
  */
-void rxe_do_task(struct tasklet_struct *t)
+void rxe_do_task(struct rxe_task *task)
 {
 	int cont;
 	int ret;
-	struct rxe_task *task = from_tasklet(task, t, tasklet);
 	unsigned int iterations = RXE_MAX_ITERATIONS;
 
 	spin_lock_bh(&task->state_lock);
@@ -67,10 +102,10 @@ void rxe_do_task(struct tasklet_struct *t)
 			} else if (iterations--) {
 				cont = 1;
 			} else {
-				/* reschedule the tasklet and exit
+				/* requeue the task and exit
 				 * the loop to give up the cpu
 				 */
-				tasklet_schedule(&task->tasklet);
+				__rxe_queue_task(task);
 				task->state = TASK_STATE_START;
 			}
 			break;
@@ -94,13 +129,27 @@ void rxe_do_task(struct tasklet_struct *t)
 	task->ret = ret;
 }
 
+static void rxe_do_work(struct work_struct *work)
+{
+	struct rxe_task *task = container_of(work, struct rxe_task, work);
+
+	/* the task functions share their locks with the receive path,
+	 * which runs in softirq context
+	 */
+	local_bh_disable();
+	rxe_do_task(task);
+	local_bh_enable();
+}
+
 int rxe_init_task(struct rxe_task *task, void *arg, int (*func)(void *))
 {
 	task->arg	= arg;
 	task->func	= func;
 	task->destroyed	= false;
+	task->disabled	= 0;
+	task->sched_pending = false;
 
-	tasklet_setup(&task->tasklet, rxe_do_task);
+	INIT_WORK(&task->work, rxe_do_work);
 
 	task->state = TASK_STATE_START;
 	spin_lock_init(&task->state_lock);
@@ -114,7 +163,7 @@ void rxe_cleanup_task(struct rxe_task *task)
 
 	/*
 	 * Mark the task, then wait for it to finish. It might be
-	 * running in a non-tasklet (direct call) context.
+	 * running in a non-workqueue (direct call) context.
 	 */
 	task->destroyed = true;
 
@@ -124,7 +173,7 @@ void rxe_cleanup_task(struct rxe_task *task)
 		spin_unlock_bh(&task->state_lock);
 	} while (!idle);
 
-	tasklet_kill(&task->tasklet);
+	cancel_work_sync(&task->work);
 }
 
 void rxe_run_task(struct rxe_task *task)
@@ -132,7 +181,7 @@ void rxe_run_task(struct rxe_task *task)
 	if (task->destroyed)
 		return;
 
-	rxe_do_task(&task->tasklet);
+	rxe_do_task(task);
 }
 
 void rxe_sched_task(struct rxe_task *task)
@@ -140,15 +189,30 @@ void rxe_sched_task(struct rxe_task *task)
 	if (task->destroyed)
 		return;
 
-	tasklet_schedule(&task->tasklet);
+	spin_lock_bh(&task->state_lock);
+	__rxe_queue_task(task);
+	spin_unlock_bh(&task->state_lock);
 }
 
+/* Scheduling requests made while the task is disabled are held back
+ * until it is enabled again, like for a disabled tasklet. Must be called
+ * from process context since it waits for a queued run to finish.
+ */
 void rxe_disable_task(struct rxe_task *task)
 {
-	tasklet_disable(&task->tasklet);
+	spin_lock_bh(&task->state_lock);
+	task->disabled++;
+	spin_unlock_bh(&task->state_lock);
+
+	flush_work(&task->work);
 }
 
 void rxe_enable_task(struct rxe_task *task)
 {
-	tasklet_enable(&task->tasklet);
+	spin_lock_bh(&task->state_lock);
+	if (!--task->disabled && task->sched_pending) {
+		task->sched_pending = false;
+		queue_work(rxe_wq, &task->work);
+	}
+	spin_unlock_bh(&task->state_lock);
 }
@@ -19,15 +19,22 @@ enum {
  * called again.
  */
 struct rxe_task {
-	struct tasklet_struct	tasklet;
+	struct work_struct	work;
 	int			state;
 	spinlock_t		state_lock; /* spinlock for task state */
 	void			*arg;
 	int			(*func)(void *arg);
 	int			ret;
 	bool			destroyed;
+	/* protected by state_lock */
+	unsigned int		disabled;
+	bool			sched_pending;
 };
 
+/* workqueue shared by all rxe tasks */
+int rxe_alloc_wq(void);
+void rxe_destroy_wq(void);
+
 /*
  * init rxe_task structure
  *	arg  => parameter to pass to fcn
@@ -40,17 +47,17 @@ void rxe_cleanup_task(struct rxe_task *task);
 
 /*
  * raw call to func in loop without any checking
- * can call when tasklets are disabled
+ * can call when tasks are disabled
  */
 int __rxe_do_task(struct rxe_task *task);
 
 /*
- * common function called by any of the main tasklets
+ * common function called by any of the main tasks
  * If there is any chance that there is additional
  * work to do someone must reschedule the task before
  * leaving
  */
-void rxe_do_task(struct tasklet_struct *t);
+void rxe_do_task(struct rxe_task *task);
 
 void rxe_run_task(struct rxe_task *task);
 
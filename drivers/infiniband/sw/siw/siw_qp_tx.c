@@ -320,6 +320,9 @@ static int siw_tx_ctrl(struct siw_iwarp_tx *c_tx, struct socket *s,
  *
  * A general performance limitation might be the extra four bytes
  * trailer checksum segment to be pushed after user data.
+ *
+ * Called with the socket locked, so a whole page list (and the
+ * trailer after it) is pushed without dropping the lock per page.
  */
 static int siw_tcp_sendpages(struct socket *s, struct page **page, int offset,
 			     size_t size)
@@ -336,9 +339,7 @@ static int siw_tcp_sendpages(struct socket *s, struct page **page, int offset,
 
 		tcp_rate_check_app_limited(sk);
 try_page_again:
-		lock_sock(sk);
 		rv = do_tcp_sendpages(sk, page[i], offset, bytes, flags);
-		release_sock(sk);
 
 		if (rv > 0) {
 			size -= rv;
@@ -599,15 +600,19 @@ static int siw_tx_hdt(struct siw_iwarp_tx *c_tx, struct socket *s)
 	data_len = c_tx->bytes_unsent;
 
 	if (c_tx->use_sendpage) {
+		lock_sock(s->sk);
 		rv = siw_0copy_tx(s, page_array, &wqe->sqe.sge[c_tx->sge_idx],
 				  c_tx->sge_off, data_len);
 		if (rv == data_len) {
-			rv = kernel_sendmsg(s, &msg, &iov[seg], 1, trl_len);
+			iov_iter_kvec(&msg.msg_iter, ITER_SOURCE, &iov[seg], 1,
+				      trl_len);
+			rv = tcp_sendmsg_locked(s->sk, &msg, trl_len);
 			if (rv > 0)
 				rv += data_len;
 			else
 				rv = data_len;
 		}
+		release_sock(s->sk);
 	} else {
 		rv = kernel_sendmsg(s, &msg, iov, seg + 1,
 				    hdr_len + data_len + trl_len);
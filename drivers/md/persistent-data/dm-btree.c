@@ -413,10 +413,16 @@ int dm_btree_lookup(struct dm_btree_info *info, dm_block_t root,
 }
 EXPORT_SYMBOL_GPL(dm_btree_lookup);
 
+/*
+ * @sibling, if not NULL, is the node to the right of @root under the same
+ * parent.
+ */
 static int dm_btree_lookup_next_single(struct dm_btree_info *info, dm_block_t root,
-				       uint64_t key, uint64_t *rkey, void *value_le)
+				       dm_block_t *sibling, uint64_t key,
+				       uint64_t *rkey, void *value_le)
 {
 	int r, i;
+	dm_block_t next;
 	uint32_t flags, nr_entries;
 	struct dm_block *node;
 	struct btree_node *n;
@@ -443,13 +449,29 @@ static int dm_btree_lookup_next_single(struct dm_btree_info *info, dm_block_t ro
 			goto out;
 		}
 
-		r = dm_btree_lookup_next_single(info, value64(n, i), key, rkey, value_le);
+		if (i < (nr_entries - 1))
+			next = value64(n, i + 1);
+		r = dm_btree_lookup_next_single(info, value64(n, i),
+						i < (nr_entries - 1) ? &next : NULL,
+						key, rkey, value_le);
 		if (r == -ENODATA && i < (nr_entries - 1)) {
 			i++;
-			r = dm_btree_lookup_next_single(info, value64(n, i), key, rkey, value_le);
+			if (i < (nr_entries - 1))
+				next = value64(n, i + 1);
+			r = dm_btree_lookup_next_single(info, value64(n, i),
+							i < (nr_entries - 1) ? &next : NULL,
+							key, rkey, value_le);
 		}
 
 	} else {
+		/*
+		 * Range walks move on to the next leaf once they are done
+		 * with this one. Internal siblings are left alone, as they
+		 * may be the root of large subtrees we never get to.
+		 */
+		if (sibling)
+			dm_bm_prefetch(dm_tm_get_bm(info->tm), *sibling);
+
 		i = upper_bound(n, key);
 		if (i < 0 || i >= nr_entries) {
 			r = -ENODATA;
@@ -488,7 +510,7 @@ int dm_btree_lookup_next(struct dm_btree_info *info, dm_block_t root,
 		root = le64_to_cpu(internal_value_le);
 	}
 
-	r = dm_btree_lookup_next_single(info, root, keys[level], rkey, value_le);
+	r = dm_btree_lookup_next_single(info, root, NULL, keys[level], rkey, value_le);
 out:
 	exit_ro_spine(&spine);
 	return r;
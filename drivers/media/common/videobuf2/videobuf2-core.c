@@ -304,6 +304,133 @@ static void __vb2_plane_dmabuf_put(struct vb2_buffer *vb, struct vb2_plane *p)
 	p->dbuf_mapped = 0;
 }
 
+/*
+ * Userspace cycling a fixed set of dma-bufs through a queue rarely hands a
+ * dma-buf back at the index it was attached at last time. Rather than
+ * detaching a plane's dma-buf when it gets replaced, park the attachment,
+ * still mapped, on a per-queue cache, so that whichever buffer is given that
+ * dma-buf next can pick it up again. The mapping, and the cache maintenance
+ * the exporter does when creating it, then happens once per dma-buf for the
+ * lifetime of the queue rather than on every QBUF.
+ */
+#define VB2_DMABUF_CACHE_SIZE	VB2_MAX_FRAME
+
+struct vb2_dmabuf_cache_entry {
+	struct list_head	list;
+	struct vb2_buffer	*vb;
+	struct dma_buf		*dbuf;
+	void			*mem_priv;
+	unsigned int		plane;
+	unsigned int		length;
+	unsigned int		mapped;
+};
+
+static void __vb2_dmabuf_cache_evict(struct vb2_queue *q,
+				     struct vb2_dmabuf_cache_entry *e)
+{
+	list_del(&e->list);
+	q->dmabuf_cache_count--;
+
+	if (e->mapped)
+		call_void_memop(e->vb, unmap_dmabuf, e->mem_priv);
+	call_void_memop(e->vb, detach_dmabuf, e->mem_priv);
+	dma_buf_put(e->dbuf);
+	kfree(e);
+}
+
+/*
+ * __vb2_dmabuf_cache_flush() - detach everything parked on the queue's
+ * dma-buf cache
+ */
+static void __vb2_dmabuf_cache_flush(struct vb2_queue *q)
+{
+	struct vb2_dmabuf_cache_entry *e, *tmp;
+
+	list_for_each_entry_safe(e, tmp, &q->dmabuf_cache, list)
+		__vb2_dmabuf_cache_evict(q, e);
+}
+
+/*
+ * __vb2_plane_dmabuf_park() - unbind a DMABUF plane from its buffer, keeping
+ * the attachment on the queue's cache if the allocator allows it
+ */
+static void __vb2_plane_dmabuf_park(struct vb2_buffer *vb, unsigned int plane)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_plane *p = &vb->planes[plane];
+	struct vb2_dmabuf_cache_entry *e;
+
+	if (!p->mem_priv)
+		return;
+
+	if (!q->mem_ops->rebind_dmabuf)
+		goto put;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		goto put;
+
+	e->vb = vb;
+	e->dbuf = p->dbuf;
+	e->mem_priv = p->mem_priv;
+	e->plane = plane;
+	e->length = p->length;
+	e->mapped = p->dbuf_mapped;
+
+	list_add(&e->list, &q->dmabuf_cache);
+	if (++q->dmabuf_cache_count > VB2_DMABUF_CACHE_SIZE)
+		__vb2_dmabuf_cache_evict(q, list_last_entry(&q->dmabuf_cache,
+				struct vb2_dmabuf_cache_entry, list));
+
+	p->mem_priv = NULL;
+	p->dbuf = NULL;
+	p->dbuf_mapped = 0;
+	return;
+
+put:
+	__vb2_plane_dmabuf_put(vb, p);
+}
+
+/*
+ * __vb2_plane_dmabuf_adopt() - bind a cached attachment of @dbuf to a plane
+ *
+ * Returns true if a matching attachment was found, in which case the plane
+ * takes over the cache entry's reference on @dbuf.
+ */
+static bool __vb2_plane_dmabuf_adopt(struct vb2_buffer *vb, unsigned int plane,
+				     struct dma_buf *dbuf, unsigned int length)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_plane *p = &vb->planes[plane];
+	struct vb2_dmabuf_cache_entry *e;
+
+	list_for_each_entry(e, &q->dmabuf_cache, list) {
+		if (e->dbuf != dbuf || e->plane != plane || e->length != length)
+			continue;
+
+		list_del(&e->list);
+		q->dmabuf_cache_count--;
+
+		call_void_memop(vb, rebind_dmabuf, vb, e->mem_priv);
+#ifdef CONFIG_VIDEO_ADV_DEBUG
+		/* Move the attach/map accounting over with the attachment */
+		e->vb->cnt_mem_attach_dmabuf--;
+		vb->cnt_mem_attach_dmabuf++;
+		if (e->mapped) {
+			e->vb->cnt_mem_map_dmabuf--;
+			vb->cnt_mem_map_dmabuf++;
+		}
+#endif
+		p->dbuf = e->dbuf;
+		p->mem_priv = e->mem_priv;
+		p->dbuf_mapped = e->mapped;
+		kfree(e);
+		return true;
+	}
+
+	return false;
+}
+
 /*
  * __vb2_buf_dmabuf_put() - release memory associated with
  * a DMABUF shared buffer
@@ -524,6 +651,9 @@ static int __vb2_queue_free(struct vb2_queue *q, unsigned int buffers)
 		}
 	}
 
+	/* Cached attachments may still be accounted to the buffers going away */
+	__vb2_dmabuf_cache_flush(q);
+
 	/* Call driver-provided cleanup function for each buffer, if provided */
 	for (buffer = q->num_buffers - buffers; buffer < q->num_buffers;
 	     ++buffer) {
@@ -1309,12 +1439,19 @@ static int __prepare_dmabuf(struct vb2_buffer *vb)
 		}
 
 		/* Release previously acquired memory if present */
-		__vb2_plane_dmabuf_put(vb, &vb->planes[plane]);
+		__vb2_plane_dmabuf_park(vb, plane);
 		vb->planes[plane].bytesused = 0;
 		vb->planes[plane].length = 0;
 		vb->planes[plane].m.fd = 0;
 		vb->planes[plane].data_offset = 0;
 
+		/* Reuse an attachment of this dma-buf from another buffer */
+		if (__vb2_plane_dmabuf_adopt(vb, plane, dbuf,
+					     planes[plane].length)) {
+			dma_buf_put(dbuf);
+			continue;
+		}
+
 		/* Acquire each plane's memory */
 		mem_priv = call_ptr_memop(attach_dmabuf,
 					  vb,
@@ -2460,6 +2597,7 @@ int vb2_core_queue_init(struct vb2_queue *q)
 
 	INIT_LIST_HEAD(&q->queued_list);
 	INIT_LIST_HEAD(&q->done_list);
+	INIT_LIST_HEAD(&q->dmabuf_cache);
 	spin_lock_init(&q->done_lock);
 	mutex_init(&q->mmap_lock);
 	init_waitqueue_head(&q->done_wq);
@@ -772,6 +772,13 @@ static void vb2_dc_detach_dmabuf(void *mem_priv)
 	kfree(buf);
 }
 
+static void vb2_dc_rebind_dmabuf(struct vb2_buffer *vb, void *mem_priv)
+{
+	struct vb2_dc_buf *buf = mem_priv;
+
+	buf->vb = vb;
+}
+
 static void *vb2_dc_attach_dmabuf(struct vb2_buffer *vb, struct device *dev,
 				  struct dma_buf *dbuf, unsigned long size)
 {
@@ -823,6 +830,7 @@ const struct vb2_mem_ops vb2_dma_contig_memops = {
 	.finish		= vb2_dc_finish,
 	.map_dmabuf	= vb2_dc_map_dmabuf,
 	.unmap_dmabuf	= vb2_dc_unmap_dmabuf,
+	.rebind_dmabuf	= vb2_dc_rebind_dmabuf,
 	.attach_dmabuf	= vb2_dc_attach_dmabuf,
 	.detach_dmabuf	= vb2_dc_detach_dmabuf,
 	.num_users	= vb2_dc_num_users,
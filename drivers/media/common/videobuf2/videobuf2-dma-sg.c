@@ -621,6 +621,13 @@ static void vb2_dma_sg_detach_dmabuf(void *mem_priv)
 	kfree(buf);
 }
 
+static void vb2_dma_sg_rebind_dmabuf(struct vb2_buffer *vb, void *mem_priv)
+{
+	struct vb2_dma_sg_buf *buf = mem_priv;
+
+	buf->vb = vb;
+}
+
 static void *vb2_dma_sg_attach_dmabuf(struct vb2_buffer *vb, struct device *dev,
 				      struct dma_buf *dbuf, unsigned long size)
 {
@@ -674,6 +681,7 @@ const struct vb2_mem_ops vb2_dma_sg_memops = {
 	.get_dmabuf	= vb2_dma_sg_get_dmabuf,
 	.map_dmabuf	= vb2_dma_sg_map_dmabuf,
 	.unmap_dmabuf	= vb2_dma_sg_unmap_dmabuf,
+	.rebind_dmabuf	= vb2_dma_sg_rebind_dmabuf,
 	.attach_dmabuf	= vb2_dma_sg_attach_dmabuf,
 	.detach_dmabuf	= vb2_dma_sg_detach_dmabuf,
 	.cookie		= vb2_dma_sg_cookie,
@@ -87,6 +87,10 @@ static int media_controller;
 module_param(media_controller, int, 0644);
 MODULE_PARM_DESC(media_controller, "Use media controller API");
 
+static unsigned int line_int;
+module_param(line_int, uint, 0644);
+MODULE_PARM_DESC(line_int, "Signal V4L2_EVENT_UNICAM_LINES this many lines into each frame (0 = disabled)");
+
 #define unicam_dbg(level, dev, fmt, arg...)	\
 		v4l2_dbg(level, debug, &(dev)->v4l2_dev, fmt, ##arg)
 #define unicam_info(dev, fmt, arg...)	\
@@ -134,6 +138,19 @@ MODULE_PARM_DESC(media_controller, "Use media controller API");
  */
 #define DUMMY_BUF_SIZE		(PAGE_SIZE)
 
+/*
+ * Driver private event raised from the line count interrupt when the line_int
+ * module parameter is set, so that consumers can start on the top of a frame
+ * before it has been completely written. The payload in u.data is a
+ * struct unicam_event_lines.
+ */
+#define V4L2_EVENT_UNICAM_LINES	(V4L2_EVENT_PRIVATE_START + 0x1000)
+
+struct unicam_event_lines {
+	__u32 frame_sequence;
+	__u32 lines_done;
+};
+
 enum pad_types {
 	IMAGE_PAD,
 	METADATA_PAD,
@@ -468,6 +485,11 @@ struct unicam_node {
 	struct unicam_buffer *cur_frm;
 	/* Pointer pointing to next v4l2_buffer */
 	struct unicam_buffer *next_frm;
+	/*
+	 * Set between FS and FE, when the hardware has latched the current
+	 * buffer address and a new next_frm can safely be programmed.
+	 */
+	bool in_frame;
 	/* video capture */
 	const struct unicam_fmt *fmt;
 	/* Used to store current pixel format */
@@ -821,6 +843,13 @@ static unsigned int unicam_get_lines_done(struct unicam_device *dev)
 	return (unsigned int)(cur_addr - start_addr) / stride;
 }
 
+/* FS or FE raised by the hardware but not acknowledged by the ISR yet */
+static bool unicam_frame_event_pending(struct unicam_device *dev)
+{
+	return reg_read(dev, UNICAM_ISTA) & (UNICAM_FSI | UNICAM_FEI) ||
+	       reg_read(dev, UNICAM_STA) & UNICAM_PI0;
+}
+
 static void unicam_schedule_next_buffer(struct unicam_node *node)
 {
 	struct unicam_device *dev = node->dev;
@@ -860,6 +889,21 @@ static void unicam_process_buffer_complete(struct unicam_node *node,
 	vb2_buffer_done(&node->cur_frm->vb.vb2_buf, VB2_BUF_STATE_DONE);
 }
 
+static void unicam_queue_event_lines(struct unicam_device *unicam,
+				     unsigned int lines_done)
+{
+	struct v4l2_event event = {
+		.type = V4L2_EVENT_UNICAM_LINES,
+	};
+	struct unicam_event_lines lines = {
+		.frame_sequence = unicam->sequence,
+		.lines_done = lines_done,
+	};
+
+	memcpy(event.u.data, &lines, sizeof(lines));
+	v4l2_event_queue(&unicam->node[IMAGE_PAD].video_dev, &event);
+}
+
 static void unicam_queue_event_sof(struct unicam_device *unicam)
 {
 	struct v4l2_event event = {
@@ -889,11 +933,29 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 	u64 ts;
 
 	sta = reg_read(unicam, UNICAM_STA);
-	/* Write value back to clear the interrupts */
-	reg_write(unicam, UNICAM_STA, sta);
-
 	ista = reg_read(unicam, UNICAM_ISTA);
-	/* Write value back to clear the interrupts */
+
+	/*
+	 * Look for either the Frame End interrupt or the Packet Capture status
+	 * to signal a frame end.
+	 */
+	fe = (ista & UNICAM_FEI || sta & UNICAM_PI0);
+
+	/*
+	 * Close the buf_queue window before acknowledging the frame end, so
+	 * that unicam_buffer_queue() sees either in_frame cleared or the frame
+	 * end still pending in the hardware.
+	 */
+	if (fe) {
+		for (i = 0; i < ARRAY_SIZE(unicam->node); i++) {
+			spin_lock(&unicam->node[i].dma_queue_lock);
+			unicam->node[i].in_frame = false;
+			spin_unlock(&unicam->node[i].dma_queue_lock);
+		}
+	}
+
+	/* Write values back to clear the interrupts */
+	reg_write(unicam, UNICAM_STA, sta);
 	reg_write(unicam, UNICAM_ISTA, ista);
 
 	unicam_dbg(3, unicam, "ISR: ISTA: 0x%X, STA: 0x%X, sequence %d, lines done %d",
@@ -902,12 +964,6 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 	if (!(sta & (UNICAM_IS | UNICAM_PI0)))
 		return IRQ_HANDLED;
 
-	/*
-	 * Look for either the Frame End interrupt or the Packet Capture status
-	 * to signal a frame end.
-	 */
-	fe = (ista & UNICAM_FEI || sta & UNICAM_PI0);
-
 	/*
 	 * We must run the frame end handler first. If we have a valid next_frm
 	 * and we get a simultaneout FE + FS interrupt, running the FS handler
@@ -929,6 +985,8 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 			if (!node->streaming)
 				continue;
 
+			spin_lock(&node->dma_queue_lock);
+
 			/*
 			 * If cur_frm == next_frm, it means we have not had
 			 * a chance to swap buffers, likely due to having
@@ -946,6 +1004,7 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 				 */
 				if (!node->cur_frm->vb.vb2_buf.timestamp) {
 					unicam_dbg(2, unicam, "ISR: FE without FS, dropping frame\n");
+					spin_unlock(&node->dma_queue_lock);
 					continue;
 				}
 
@@ -956,6 +1015,7 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 			} else {
 				node->cur_frm = node->next_frm;
 			}
+			spin_unlock(&node->dma_queue_lock);
 		}
 
 		/*
@@ -981,6 +1041,7 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 			if (!unicam->node[i].streaming)
 				continue;
 
+			spin_lock(&unicam->node[i].dma_queue_lock);
 			if (unicam->node[i].cur_frm)
 				unicam->node[i].cur_frm->vb.vb2_buf.timestamp =
 								ts;
@@ -1001,19 +1062,23 @@ static irqreturn_t unicam_isr(int irq, void *dev)
 				 * contain valid data. Return cur_frm to the
 				 * queue.
 				 */
-				spin_lock(&unicam->node[i].dma_queue_lock);
 				list_add_tail(&unicam->node[i].cur_frm->list,
 					      &unicam->node[i].dma_queue);
-				spin_unlock(&unicam->node[i].dma_queue_lock);
 				unicam->node[i].cur_frm = unicam->node[i].next_frm;
 				unicam->node[i].next_frm = NULL;
 			}
+			unicam->node[i].in_frame = true;
+			spin_unlock(&unicam->node[i].dma_queue_lock);
 		}
 
 		unicam_queue_event_sof(unicam);
 		unicam->frame_started = true;
 	}
 
+	if (ista & UNICAM_LCI && !fe && line_int &&
+	    unicam->node[IMAGE_PAD].streaming && unicam->node[IMAGE_PAD].cur_frm)
+		unicam_queue_event_lines(unicam, lines_done);
+
 	/*
 	 * Cannot swap buffer at frame end, there may be a race condition
 	 * where the HW does not actually swap it if the new frame has
@@ -1750,6 +1815,7 @@ static int unicam_subscribe_event(struct v4l2_fh *fh,
 {
 	switch (sub->type) {
 	case V4L2_EVENT_FRAME_SYNC:
+	case V4L2_EVENT_UNICAM_LINES:
 		return v4l2_event_subscribe(fh, sub, 2, NULL);
 	case V4L2_EVENT_SOURCE_CHANGE:
 		return v4l2_event_subscribe(fh, sub, 4, NULL);
@@ -2210,6 +2276,22 @@ static void unicam_buffer_queue(struct vb2_buffer *vb)
 
 	spin_lock_irqsave(&node->dma_queue_lock, flags);
 	list_add_tail(&buf->list, &node->dma_queue);
+	/*
+	 * Program the buffer straight away if the hardware is part way
+	 * through a frame with nothing lined up for the next one, rather
+	 * than waiting for the line count or frame start interrupt. A buffer
+	 * returned late in a frame then still gets used for the next frame
+	 * instead of that frame going to the dummy buffer.
+	 *
+	 * This is the point at which the ISR programs next_frm: after FS has
+	 * been handled and before FE. The ISR clears in_frame under this lock
+	 * before acknowledging FE, so an FE that it has not got to yet is
+	 * still pending in the hardware. Leave the buffer to the ISR then, as
+	 * well as when a frame start is pending.
+	 */
+	if (node->streaming && node->in_frame && !node->next_frm &&
+	    !unicam_frame_event_pending(node->dev))
+		unicam_schedule_next_buffer(node);
 	spin_unlock_irqrestore(&node->dma_queue_lock, flags);
 }
 
@@ -2287,6 +2369,14 @@ static void unicam_start_rx(struct unicam_device *dev, dma_addr_t *addr)
 	if (line_int_freq < 128)
 		line_int_freq = 128;
 
+	/*
+	 * The line count interrupt also drives buffer scheduling, so moving
+	 * it earlier in the frame for partial frame signalling is harmless.
+	 */
+	if (line_int)
+		line_int_freq = clamp_t(unsigned int, line_int, 1,
+					UNICAM_LCIE_MASK >> 16);
+
 	/* Enable lane clocks */
 	val = 1;
 	for (i = 0; i < dev->active_data_lanes; i++)
@@ -2609,6 +2699,7 @@ static int unicam_start_streaming(struct vb2_queue *vq, unsigned int count)
 				       struct unicam_buffer, list);
 		dev->node[i].cur_frm = buf;
 		dev->node[i].next_frm = buf;
+		dev->node[i].in_frame = false;
 		list_del(&buf->list);
 		spin_unlock_irqrestore(&dev->node[i].dma_queue_lock, flags);
 
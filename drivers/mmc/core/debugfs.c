@@ -316,6 +316,9 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 	debugfs_create_file("err_stats", 0600, root, host,
 			    &mmc_err_stats_fops);
 
+	if (host->hsq_depth)
+		debugfs_create_u32("hsq_depth", 0600, root, &host->hsq_depth);
+
 #ifdef CONFIG_FAIL_MMC_REQUEST
 	if (fail_request)
 		setup_fault_attr(&fail_default_attr, fail_request);
@@ -143,6 +143,10 @@
 
 #define MHZ 1000000
 
+/* data->host_cookie states for the DMA mapping of a request */
+#define COOKIE_UNMAPPED		0
+#define COOKIE_PRE_MAPPED	1	/* mapped by pre_req, unmapped by post_req */
+#define COOKIE_MAPPED		2	/* mapped and unmapped by the request */
 
 struct bcm2835_host {
 	spinlock_t		lock;
@@ -531,6 +535,7 @@ static void bcm2835_sdhost_dma_complete(void *param)
 {
 	struct bcm2835_host *host = param;
 	struct mmc_data *data = host->data;
+	struct device *synced_dev = NULL;
 	unsigned long flags;
 
 	spin_lock_irqsave(&host->lock, flags);
@@ -539,9 +544,21 @@ static void bcm2835_sdhost_dma_complete(void *param)
 		  bcm2835_sdhost_read(host, SDEDM));
 
 	if (host->dma_chan) {
-		dma_unmap_sg(host->dma_chan->device->dev,
-			     data->sg, data->sg_len,
-			     host->dma_dir);
+		if (data->host_cookie == COOKIE_MAPPED) {
+			dma_unmap_sg(host->dma_chan->device->dev,
+				     data->sg, data->sg_len,
+				     host->dma_dir);
+			data->host_cookie = COOKIE_UNMAPPED;
+		} else if (data->host_cookie == COOKIE_PRE_MAPPED &&
+			   host->drain_words) {
+			/*
+			 * post_req unmaps, but the drain below writes next to
+			 * the buffer, possibly into its last cache line.
+			 */
+			synced_dev = host->dma_chan->device->dev;
+			dma_sync_sg_for_cpu(synced_dev, data->sg, data->sg_len,
+					    host->dma_dir);
+		}
 
 		host->dma_chan = NULL;
 	}
@@ -569,6 +586,10 @@ static void bcm2835_sdhost_dma_complete(void *param)
 		kunmap_atomic(page);
 	}
 
+	if (synced_dev)
+		dma_sync_sg_for_device(synced_dev, data->sg, data->sg_len,
+				       host->dma_dir);
+
 	bcm2835_sdhost_finish_data(host);
 
 	log_event("DMA>", host->data, 0);
@@ -788,6 +809,65 @@ static void bcm2835_sdhost_transfer_pio(struct bcm2835_host *host)
 	log_event("XFP>", host->data, host->blocks);
 }
 
+static bool bcm2835_sdhost_want_dma(struct bcm2835_host *host,
+				    struct mmc_data *data)
+{
+	return host->use_dma && data && (data->blocks > host->pio_limit);
+}
+
+/* Number of bytes at the end of a read to leave to PIO, see below */
+static u32 bcm2835_sdhost_drain_len(struct mmc_data *data)
+{
+	if ((data->blocks > 1) && (data->flags & MMC_DATA_READ))
+		return min((u32)(FIFO_READ_THRESHOLD - 1) * 4,
+			   (u32)data->blocks * data->blksz);
+	return 0;
+}
+
+/*
+ * Map the data for DMA. This is either done from pre_req, ahead of the
+ * request and while the previous one is still in flight, or when the request
+ * is started. Returns the number of mapped entries, or 0 on failure.
+ */
+static int bcm2835_sdhost_map_data(struct bcm2835_host *host,
+				   struct mmc_data *data, int cookie)
+{
+	struct dma_chan *dma_chan = host->dma_chan_rxtx;
+	u32 drain_len;
+	int len;
+
+	BUG_ON(!dma_chan->device);
+	BUG_ON(!dma_chan->device->dev);
+	BUG_ON(!data->sg);
+
+	/* The block doesn't manage the FIFO DREQs properly for multi-block
+	   transfers, so don't attempt to DMA the final few words.
+	   Unfortunately this requires the final sg entry to be trimmed.
+	   N.B. This code demands that the overspill is contained in
+	   a single sg entry.
+	*/
+	drain_len = bcm2835_sdhost_drain_len(data);
+	if (drain_len) {
+		struct scatterlist *sg = sg_last(data->sg, data->sg_len);
+
+		BUG_ON(sg->length < drain_len);
+		sg->length -= drain_len;
+	}
+
+	len = dma_map_sg(dma_chan->device->dev, data->sg, data->sg_len,
+			 (data->flags & MMC_DATA_READ) ?
+			 DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	if (len <= 0) {
+		if (drain_len)
+			sg_last(data->sg, data->sg_len)->length += drain_len;
+		return 0;
+	}
+
+	data->sg_count = len;
+	data->host_cookie = cookie;
+	return len;
+}
+
 static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 	struct mmc_data *data)
 {
@@ -808,35 +888,20 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 	}
 	log_event("PRD1", dma_chan, 0);
 
-	BUG_ON(!dma_chan->device);
-	BUG_ON(!dma_chan->device->dev);
-	BUG_ON(!data->sg);
-
-	/* The block doesn't manage the FIFO DREQs properly for multi-block
-	   transfers, so don't attempt to DMA the final few words.
-	   Unfortunately this requires the final sg entry to be trimmed.
-	   N.B. This code demands that the overspill is contained in
-	   a single sg entry.
-	*/
+	/* A retried request may still be mapped from its first attempt */
+	if (data->host_cookie != COOKIE_UNMAPPED)
+		len = data->sg_count;
+	else
+		len = bcm2835_sdhost_map_data(host, data, COOKIE_MAPPED);
 
+	/* The last sg entry has already been trimmed by the mapping */
 	host->drain_words = 0;
-	if ((data->blocks > 1) && (dir_data == DMA_FROM_DEVICE)) {
-		struct scatterlist *sg;
-		u32 len;
-		int i;
-
-		len = min((u32)(FIFO_READ_THRESHOLD - 1) * 4,
-			  (u32)data->blocks * data->blksz);
-
-		for_each_sg(data->sg, sg, data->sg_len, i) {
-			if (sg_is_last(sg)) {
-				BUG_ON(sg->length < len);
-				sg->length -= len;
-				host->drain_page = sg_page(sg);
-				host->drain_offset = sg->offset + sg->length;
-			}
-		}
-		host->drain_words = len/4;
+	if (len > 0 && bcm2835_sdhost_drain_len(data)) {
+		struct scatterlist *sg = sg_last(data->sg, data->sg_len);
+
+		host->drain_page = sg_page(sg);
+		host->drain_offset = sg->offset + sg->length;
+		host->drain_words = bcm2835_sdhost_drain_len(data) / 4;
 	}
 
 	/* The parameters have already been validated, so this will not fail */
@@ -845,9 +910,6 @@ static void bcm2835_sdhost_prepare_dma(struct bcm2835_host *host,
 				     &host->dma_cfg_rx :
 				     &host->dma_cfg_tx);
 
-	len = dma_map_sg(dma_chan->device->dev, data->sg, data->sg_len,
-			 dir_data);
-
 	log_event("PRD2", len, 0);
 	if (len > 0)
 		desc = dmaengine_prep_slave_sg(dma_chan, data->sg,
@@ -1688,8 +1750,7 @@ static void bcm2835_sdhost_request(struct mmc_host *mmc, struct mmc_request *mrq
 		return;
 	}
 
-	if (host->use_dma && mrq->data &&
-	    (mrq->data->blocks > host->pio_limit))
+	if (bcm2835_sdhost_want_dma(host, mrq->data))
 		bcm2835_sdhost_prepare_dma(host, mrq->data);
 
 	if (host->reset_clock)
@@ -1779,8 +1840,38 @@ static void bcm2835_sdhost_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 		bcm2835_sdhost_set_clock(host, ios->clock);
 }
 
+static void bcm2835_sdhost_pre_req(struct mmc_host *mmc,
+				   struct mmc_request *mrq)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!bcm2835_sdhost_want_dma(host, data))
+		return;
+
+	data->host_cookie = COOKIE_UNMAPPED;
+	bcm2835_sdhost_map_data(host, data, COOKIE_PRE_MAPPED);
+}
+
+static void bcm2835_sdhost_post_req(struct mmc_host *mmc,
+				    struct mmc_request *mrq, int err)
+{
+	struct bcm2835_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (data && data->host_cookie == COOKIE_PRE_MAPPED) {
+		dma_unmap_sg(host->dma_chan_rxtx->device->dev,
+			     data->sg, data->sg_len,
+			     (data->flags & MMC_DATA_READ) ?
+			     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+		data->host_cookie = COOKIE_UNMAPPED;
+	}
+}
+
 static struct mmc_host_ops bcm2835_sdhost_ops = {
 	.request = bcm2835_sdhost_request,
+	.pre_req = bcm2835_sdhost_pre_req,
+	.post_req = bcm2835_sdhost_post_req,
 	.set_ios = bcm2835_sdhost_set_ios,
 // todo:fix	.hw_reset = bcm2835_sdhost_reset,
 };
@@ -23,6 +23,22 @@
 #define DCMD_SLOT 31
 #define NUM_SLOTS 32
 
+/*
+ * Interrupt coalescing: raise the completion interrupt once ic_threshold data
+ * tasks have completed, or ic_timeout units of 1024 IC timer clocks after the
+ * first one did, whichever comes first. Takes effect the next time the CQE is
+ * enabled. A threshold or a timeout of 0 disables coalescing.
+ */
+static unsigned int ic_threshold;
+module_param(ic_threshold, uint, 0644);
+MODULE_PARM_DESC(ic_threshold,
+		 "Interrupt coalescing counter threshold (0-31, 0 = disabled)");
+
+static unsigned int ic_timeout = CQHCI_IC_DEFAULT_ICTOVAL;
+module_param(ic_timeout, uint, 0644);
+MODULE_PARM_DESC(ic_timeout,
+		 "Interrupt coalescing timeout (1-127, in 1024 IC timer clocks)");
+
 struct cqhci_slot {
 	struct mmc_request *mrq;
 	unsigned int flags;
@@ -243,6 +259,23 @@ static int cqhci_host_alloc_tdl(struct cqhci_host *cq_host)
 	return 0;
 }
 
+static void cqhci_set_ic(struct cqhci_host *cq_host)
+{
+	unsigned int th = min(READ_ONCE(ic_threshold), 31U);
+	unsigned int to = min(READ_ONCE(ic_timeout), 127U);
+
+	if (!th || !to) {
+		cqhci_writel(cq_host, 0, CQHCI_IC);
+		cq_host->ic_enabled = false;
+		return;
+	}
+
+	cqhci_writel(cq_host, CQHCI_IC_ENABLE | CQHCI_IC_RESET |
+		     CQHCI_IC_ICCTHWEN | CQHCI_IC_ICCTH(th) |
+		     CQHCI_IC_ICTOVALWEN | CQHCI_IC_ICTOVAL(to), CQHCI_IC);
+	cq_host->ic_enabled = true;
+}
+
 static void __cqhci_enable(struct cqhci_host *cq_host)
 {
 	struct mmc_host *mmc = cq_host->mmc;
@@ -276,6 +309,8 @@ static void __cqhci_enable(struct cqhci_host *cq_host)
 
 	cqhci_writel(cq_host, cq_host->rca, CQHCI_SSC2);
 
+	cqhci_set_ic(cq_host);
+
 	cqhci_set_irqs(cq_host, 0);
 
 	cqcfg |= CQHCI_ENABLE;
@@ -426,9 +461,10 @@ static void cqhci_prep_task_desc(struct mmc_request *mrq,
 	u32 req_flags = mrq->data->flags;
 	u64 desc0;
 
+	/* With coalescing, let the IC counter and timer raise the interrupt */
 	desc0 = CQHCI_VALID(1) |
 		CQHCI_END(1) |
-		CQHCI_INT(1) |
+		CQHCI_INT(!cq_host->ic_enabled) |
 		CQHCI_ACT(0x5) |
 		CQHCI_FORCED_PROG(!!(req_flags & MMC_DATA_FORCED_PRG)) |
 		CQHCI_DATA_TAG(!!(req_flags & MMC_DATA_DAT_TAG)) |
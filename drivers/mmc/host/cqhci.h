@@ -243,6 +243,7 @@ struct cqhci_host {
 	bool activated;
 	bool waiting_for_idle;
 	bool recovery_halt;
+	bool ic_enabled;	/* interrupt coalescing programmed */
 
 	size_t desc_size;
 	size_t data_size;
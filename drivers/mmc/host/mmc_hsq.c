@@ -10,6 +10,7 @@
 #include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/module.h>
+#include <linux/sizes.h>
 
 #include "mmc_hsq.h"
 
@@ -24,6 +25,31 @@ static void mmc_hsq_retry_handler(struct work_struct *work)
 	mmc->ops->request(mmc, hsq->mrq);
 }
 
+/*
+ * Unless the host driver picked its own depth, let more requests in flight
+ * while several small (at most 4K) transfers are queued: each of them is
+ * short, so the extra depth hides the per-request overhead without adding
+ * much latency.  Called with hsq->lock held.
+ */
+static void mmc_hsq_modify_threshold(struct mmc_hsq *hsq)
+{
+	struct mmc_host *mmc = hsq->mmc;
+	struct mmc_request *mrq;
+	unsigned int tag, small = 0;
+
+	if (!hsq->auto_depth)
+		return;
+
+	for (tag = 0; tag < HSQ_NUM_SLOTS && small < 2; tag++) {
+		mrq = hsq->slot[tag].mrq;
+		if (mrq && mrq->data &&
+		    mrq->data->blksz * mrq->data->blocks <= SZ_4K)
+			small++;
+	}
+
+	mmc->hsq_depth = small > 1 ? HSQ_PERFORMANCE_DEPTH : HSQ_NORMAL_DEPTH;
+}
+
 static void mmc_hsq_pump_requests(struct mmc_hsq *hsq)
 {
 	struct mmc_host *mmc = hsq->mmc;
@@ -45,6 +71,8 @@ static void mmc_hsq_pump_requests(struct mmc_hsq *hsq)
 		return;
 	}
 
+	mmc_hsq_modify_threshold(hsq);
+
 	slot = &hsq->slot[hsq->next_tag];
 	hsq->mrq = slot->mrq;
 	hsq->qcnt--;
@@ -349,6 +377,10 @@ int mmc_hsq_init(struct mmc_hsq *hsq, struct mmc_host *mmc)
 
 	hsq->mmc = mmc;
 	hsq->mmc->cqe_private = hsq;
+	if (!mmc->hsq_depth) {
+		mmc->hsq_depth = HSQ_NORMAL_DEPTH;
+		hsq->auto_depth = true;
+	}
 	mmc->cqe_ops = &mmc_hsq_ops;
 
 	INIT_WORK(&hsq->retry_work, mmc_hsq_retry_handler);
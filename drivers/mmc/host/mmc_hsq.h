@@ -2,6 +2,9 @@
 #ifndef LINUX_MMC_HSQ_H
 #define LINUX_MMC_HSQ_H
 
+#define HSQ_NORMAL_DEPTH	2
+#define HSQ_PERFORMANCE_DEPTH	5
+
 struct hsq_slot {
 	struct mmc_request *mrq;
 };
@@ -21,6 +24,7 @@ struct mmc_hsq {
 	bool enabled;
 	bool waiting_for_idle;
 	bool recovery_halt;
+	bool auto_depth;	/* hsq_depth follows the queued requests */
 };
 
 int mmc_hsq_init(struct mmc_hsq *hsq, struct mmc_host *mmc);
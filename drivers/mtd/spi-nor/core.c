@@ -44,6 +44,9 @@
 #define SPI_NOR_SRST_SLEEP_MIN 200
 #define SPI_NOR_SRST_SLEEP_MAX 400
 
+/* Status polling period of an erase that other reads may suspend */
+#define SPI_NOR_ERASE_POLL_US	100
+
 /**
  * spi_nor_get_cmd_ext() - Get the command opcode extension based on the
  *			   extension type.
@@ -1072,11 +1075,31 @@ static void spi_nor_set_4byte_opcodes(struct spi_nor *nor)
 	}
 }
 
-int spi_nor_lock_and_prep(struct spi_nor *nor)
+/*
+ * Whether a sector erase, waiting for the flash without holding nor->lock,
+ * has to finish before an access to [@addr, @addr + @len) can go ahead.
+ * A @len of 0 stands for anything other than a read.
+ */
+static bool spi_nor_erase_blocks(struct spi_nor *nor, loff_t addr, size_t len)
+{
+	if (!nor->erase.busy)
+		return false;
+
+	return !len || (addr < nor->erase.addr + nor->erase.size &&
+			addr + len > nor->erase.addr);
+}
+
+static int __spi_nor_lock_and_prep(struct spi_nor *nor, loff_t addr,
+				   size_t len)
 {
 	int ret = 0;
 
 	mutex_lock(&nor->lock);
+	while (spi_nor_erase_blocks(nor, addr, len)) {
+		mutex_unlock(&nor->lock);
+		wait_event(nor->erase.wq, !READ_ONCE(nor->erase.busy));
+		mutex_lock(&nor->lock);
+	}
 
 	if (nor->controller_ops &&  nor->controller_ops->prepare) {
 		ret = nor->controller_ops->prepare(nor);
@@ -1088,6 +1111,11 @@ int spi_nor_lock_and_prep(struct spi_nor *nor)
 	return ret;
 }
 
+int spi_nor_lock_and_prep(struct spi_nor *nor)
+{
+	return __spi_nor_lock_and_prep(nor, 0, 0);
+}
+
 void spi_nor_unlock_and_unprep(struct spi_nor *nor)
 {
 	if (nor->controller_ops && nor->controller_ops->unprepare)
@@ -1095,6 +1123,138 @@ void spi_nor_unlock_and_unprep(struct spi_nor *nor)
 	mutex_unlock(&nor->lock);
 }
 
+/* Account an MTD operation that started at @start, called with nor->lock */
+static void spi_nor_account_op(struct spi_nor *nor, enum spi_nor_op_stat op,
+			       ktime_t start)
+{
+	struct spi_nor_op_stats *st = &nor->stats[op];
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	st->count++;
+	st->total_ns += ns;
+	st->max_ns = max(st->max_ns, ns);
+}
+
+static int spi_nor_send_opcode(struct spi_nor *nor, u8 opcode)
+{
+	if (nor->spimem) {
+		struct spi_mem_op op =
+			SPI_MEM_OP(SPI_MEM_OP_CMD(opcode, 0),
+				   SPI_MEM_OP_NO_ADDR,
+				   SPI_MEM_OP_NO_DUMMY,
+				   SPI_MEM_OP_NO_DATA);
+
+		spi_nor_spimem_setup_op(nor, &op, nor->reg_proto);
+
+		return spi_mem_exec_op(nor->spimem, &op);
+	}
+
+	return spi_nor_controller_ops_write_reg(nor, opcode, NULL, 0);
+}
+
+/**
+ * spi_nor_erase_suspend() - Suspend the sector erase in progress, if any.
+ * @nor:	pointer to 'struct spi_nor', with nor->lock held.
+ *
+ * Return: 1 if the erase was suspended and has to be resumed with
+ * spi_nor_erase_resume(), 0 if there is nothing to suspend, -errno otherwise.
+ */
+static int spi_nor_erase_suspend(struct spi_nor *nor)
+{
+	const struct spi_nor_erase_suspend *es = &nor->params->erase_suspend;
+	s64 ran_us;
+	int ret;
+
+	if (!nor->erase.busy)
+		return 0;
+
+	/* The flash needs the erase to make progress between suspends. */
+	ran_us = ktime_us_delta(ktime_get(), nor->erase.resumed);
+	if (ran_us < es->resume_interval_us)
+		usleep_range(es->resume_interval_us - ran_us,
+			     es->resume_interval_us);
+
+	ret = spi_nor_ready(nor);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	ret = spi_nor_send_opcode(nor, es->suspend_opcode);
+	if (ret)
+		return ret;
+
+	fsleep(es->suspend_us);
+	ret = spi_nor_wait_till_ready(nor);
+	if (ret) {
+		spi_nor_send_opcode(nor, es->resume_opcode);
+		return ret;
+	}
+
+	nor->erase.suspends++;
+	return 1;
+}
+
+static int spi_nor_erase_resume(struct spi_nor *nor)
+{
+	int ret;
+
+	ret = spi_nor_send_opcode(nor, nor->params->erase_suspend.resume_opcode);
+	nor->erase.resumed = ktime_get();
+
+	return ret;
+}
+
+/**
+ * spi_nor_erase_wait() - Wait for the erase of the sector at @addr.
+ * @nor:	pointer to 'struct spi_nor', with nor->lock held.
+ * @addr:	address of the sector being erased.
+ * @size:	size of the sector being erased.
+ *
+ * On flashes that can suspend an erase, the device is released while polling
+ * so that spi_nor_read() can suspend the erase for reads outside the sector,
+ * and resume it before it releases the device again. Everything else waits
+ * for the erase in spi_nor_lock_and_prep().
+ *
+ * Controllers with a prepare hook keep the device for the whole erase, as
+ * their hook cannot nest with the one taken by the reader.
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+static int spi_nor_erase_wait(struct spi_nor *nor, u32 addr, u32 size)
+{
+	unsigned long deadline = jiffies + DEFAULT_READY_WAIT_JIFFIES;
+	int ret;
+
+	if (!(nor->flags & SNOR_F_ERASE_SUSPEND) ||
+	    (nor->controller_ops && nor->controller_ops->prepare))
+		return spi_nor_wait_till_ready(nor);
+
+	nor->erase.addr = addr;
+	nor->erase.size = size;
+	nor->erase.resumed = ktime_get();
+	WRITE_ONCE(nor->erase.busy, true);
+
+	for (;;) {
+		mutex_unlock(&nor->lock);
+		usleep_range(SPI_NOR_ERASE_POLL_US, 2 * SPI_NOR_ERASE_POLL_US);
+		mutex_lock(&nor->lock);
+
+		ret = spi_nor_ready(nor);
+		if (ret)
+			break;
+
+		if (time_after_eq(jiffies, deadline)) {
+			dev_dbg(nor->dev, "flash operation timed out\n");
+			ret = -ETIMEDOUT;
+			break;
+		}
+	}
+
+	WRITE_ONCE(nor->erase.busy, false);
+	wake_up_all(&nor->erase.wq);
+
+	return ret < 0 ? ret : 0;
+}
+
 static u32 spi_nor_convert_addr(struct spi_nor *nor, loff_t addr)
 {
 	if (!nor->params->convert_addr)
@@ -1432,6 +1592,7 @@ static int spi_nor_erase_multi_sectors(struct spi_nor *nor, u64 addr, u32 len)
 static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 {
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
+	ktime_t start = ktime_get();
 	u32 addr, len;
 	uint32_t rem;
 	int ret;
@@ -1493,12 +1654,25 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 			if (ret)
 				goto erase_err;
 
-			ret = spi_nor_wait_till_ready(nor);
+			ret = spi_nor_erase_wait(nor, addr, mtd->erasesize);
 			if (ret)
 				goto erase_err;
 
 			addr += mtd->erasesize;
 			len -= mtd->erasesize;
+
+			/*
+			 * Each sector erase keeps the flash busy for
+			 * milliseconds, so give readers and writers waiting
+			 * for the device a chance to run between sectors.
+			 */
+			if (len) {
+				spi_nor_unlock_and_unprep(nor);
+				cond_resched();
+				ret = spi_nor_lock_and_prep(nor);
+				if (ret)
+					return ret;
+			}
 		}
 
 	/* erase multiple sectors */
@@ -1511,6 +1685,7 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	ret = spi_nor_write_disable(nor);
 
 erase_err:
+	spi_nor_account_op(nor, SPI_NOR_STAT_ERASE, start);
 	spi_nor_unlock_and_unprep(nor);
 
 	return ret;
@@ -1681,14 +1856,26 @@ static int spi_nor_read(struct mtd_info *mtd, loff_t from, size_t len,
 			size_t *retlen, u_char *buf)
 {
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
+	ktime_t start = ktime_get();
+	int suspended;
 	ssize_t ret;
 
 	dev_dbg(nor->dev, "from 0x%08x, len %zd\n", (u32)from, len);
 
-	ret = spi_nor_lock_and_prep(nor);
+	/*
+	 * A read of the sector being erased waits for the erase, any other
+	 * read suspends it and resumes it when done.
+	 */
+	ret = __spi_nor_lock_and_prep(nor, from, len);
 	if (ret)
 		return ret;
 
+	suspended = spi_nor_erase_suspend(nor);
+	if (suspended < 0) {
+		ret = suspended;
+		goto read_err;
+	}
+
 	while (len) {
 		loff_t addr = from;
 
@@ -1712,6 +1899,13 @@ static int spi_nor_read(struct mtd_info *mtd, loff_t from, size_t len,
 	ret = 0;
 
 read_err:
+	if (suspended > 0) {
+		int err = spi_nor_erase_resume(nor);
+
+		if (!ret)
+			ret = err;
+	}
+	spi_nor_account_op(nor, SPI_NOR_STAT_READ, start);
 	spi_nor_unlock_and_unprep(nor);
 	return ret;
 }
@@ -1725,6 +1919,7 @@ static int spi_nor_write(struct mtd_info *mtd, loff_t to, size_t len,
 	size_t *retlen, const u_char *buf)
 {
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
+	ktime_t start = ktime_get();
 	size_t page_offset, page_remain, i;
 	ssize_t ret;
 	u32 page_size = nor->params->page_size;
@@ -1773,6 +1968,7 @@ static int spi_nor_write(struct mtd_info *mtd, loff_t to, size_t len,
 	}
 
 write_err:
+	spi_nor_account_op(nor, SPI_NOR_STAT_WRITE, start);
 	spi_nor_unlock_and_unprep(nor);
 	return ret;
 }
@@ -3002,6 +3198,7 @@ int spi_nor_scan(struct spi_nor *nor, const char *name,
 	nor->info = info;
 
 	mutex_init(&nor->lock);
+	init_waitqueue_head(&nor->erase.wq);
 
 	/* Init flash parameters based on flash_info struct and SFDP */
 	ret = spi_nor_init_params(nor);
@@ -132,6 +132,7 @@ enum spi_nor_option_flags {
 	SNOR_F_SWP_IS_VOLATILE	= BIT(13),
 	SNOR_F_RWW		= BIT(14),
 	SNOR_F_ECC		= BIT(15),
+	SNOR_F_ERASE_SUSPEND	= BIT(16),
 };
 
 struct spi_nor_read_command {
@@ -332,6 +333,21 @@ struct spi_nor_otp {
 	const struct spi_nor_otp_ops *ops;
 };
 
+/**
+ * struct spi_nor_erase_suspend - Structure for describing erase suspend
+ * @suspend_opcode:	the opcode that suspends an erase in progress
+ * @resume_opcode:	the opcode that resumes a suspended erase
+ * @suspend_us:		maximum time for a suspend to take effect
+ * @resume_interval_us:	minimum time an erase has to run after a resume
+ *			before it can be suspended again
+ */
+struct spi_nor_erase_suspend {
+	u8 suspend_opcode;
+	u8 resume_opcode;
+	u32 suspend_us;
+	u32 resume_interval_us;
+};
+
 /**
  * struct spi_nor_flash_parameter - SPI NOR flash parameters and settings.
  * Includes legacy flash parameters and settings that can be overwritten
@@ -373,6 +389,8 @@ struct spi_nor_otp {
  * @ready:		(optional) flashes might use a different mechanism
  *			than reading the status register to indicate they
  *			are ready for a new command
+ * @erase_suspend:	erase suspend and resume instructions, valid with
+ *			SNOR_F_ERASE_SUSPEND.
  * @locking_ops:	SPI NOR locking methods.
  */
 struct spi_nor_flash_parameter {
@@ -398,6 +416,8 @@ struct spi_nor_flash_parameter {
 	int (*setup)(struct spi_nor *nor, const struct spi_nor_hwcaps *hwcaps);
 	int (*ready)(struct spi_nor *nor);
 
+	struct spi_nor_erase_suspend	erase_suspend;
+
 	const struct spi_nor_locking_ops *locking_ops;
 };
 
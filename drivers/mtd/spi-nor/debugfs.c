@@ -27,6 +27,7 @@ static const char *const snor_f_names[] = {
 	SNOR_F_NAME(SWP_IS_VOLATILE),
 	SNOR_F_NAME(RWW),
 	SNOR_F_NAME(ECC),
+	SNOR_F_NAME(ERASE_SUSPEND),
 };
 #undef SNOR_F_NAME
 
@@ -220,6 +221,34 @@ static int spi_nor_capabilities_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(spi_nor_capabilities);
 
+static int spi_nor_stats_show(struct seq_file *s, void *data)
+{
+	static const char *const names[SPI_NOR_STAT_MAX] = {
+		[SPI_NOR_STAT_READ] = "read",
+		[SPI_NOR_STAT_WRITE] = "write",
+		[SPI_NOR_STAT_ERASE] = "erase",
+	};
+	struct spi_nor *nor = s->private;
+	int i;
+
+	mutex_lock(&nor->lock);
+	seq_printf(s, "%-8s %12s %16s %12s %12s\n", "op", "count",
+		   "total (ns)", "avg (ns)", "max (ns)");
+	for (i = 0; i < SPI_NOR_STAT_MAX; i++) {
+		const struct spi_nor_op_stats *st = &nor->stats[i];
+
+		seq_printf(s, "%-8s %12llu %16llu %12llu %12llu\n", names[i],
+			   st->count, st->total_ns,
+			   st->count ? div64_u64(st->total_ns, st->count) : 0,
+			   st->max_ns);
+	}
+	seq_printf(s, "erase suspends: %llu\n", nor->erase.suspends);
+	mutex_unlock(&nor->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(spi_nor_stats);
+
 static void spi_nor_debugfs_unregister(void *data)
 {
 	struct spi_nor *nor = data;
@@ -248,6 +277,7 @@ void spi_nor_debugfs_register(struct spi_nor *nor)
 	debugfs_create_file("params", 0444, d, nor, &spi_nor_params_fops);
 	debugfs_create_file("capabilities", 0444, d, nor,
 			    &spi_nor_capabilities_fops);
+	debugfs_create_file("stats", 0444, d, nor, &spi_nor_stats_fops);
 }
 
 void spi_nor_debugfs_shutdown(void)
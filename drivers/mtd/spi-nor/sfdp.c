@@ -401,6 +401,44 @@ static void spi_nor_regions_sort_erase_types(struct spi_nor_erase_map *map)
 	}
 }
 
+/**
+ * spi_nor_parse_bfpt_erase_suspend() - parse the erase suspend/resume fields
+ * of the Basic Flash Parameter Table.
+ * @nor:	pointer to a 'struct spi_nor'
+ * @bfpt:	pointer to the BFPT, JESD216 rev B or later
+ *
+ * Erase suspend is only used for reads, so it is only enabled when the flash
+ * allows them everywhere but in the sector whose erase is suspended.
+ */
+static void spi_nor_parse_bfpt_erase_suspend(struct spi_nor *nor,
+					     const struct sfdp_bfpt *bfpt)
+{
+	static const u32 lat_unit_ns[] = { 128, 1000, 8000, 64000 };
+	struct spi_nor_erase_suspend *es = &nor->params->erase_suspend;
+	u32 dword12 = bfpt->dwords[BFPT_DWORD(12)];
+	u32 dword13 = bfpt->dwords[BFPT_DWORD(13)];
+	u32 unit, cnt;
+
+	if (dword12 & BFPT_DWORD12_SUSPEND_UNSUPPORTED ||
+	    !(dword12 & BFPT_DWORD12_ERASE_SUS_READ_SECTOR))
+		return;
+
+	es->suspend_opcode = FIELD_GET(BFPT_DWORD13_ERASE_SUSPEND_MASK,
+				       dword13);
+	es->resume_opcode = FIELD_GET(BFPT_DWORD13_ERASE_RESUME_MASK, dword13);
+	if (!es->suspend_opcode || !es->resume_opcode)
+		return;
+
+	unit = FIELD_GET(BFPT_DWORD12_ERASE_SUS_LAT_UNIT_MASK, dword12);
+	cnt = FIELD_GET(BFPT_DWORD12_ERASE_SUS_LAT_CNT_MASK, dword12);
+	es->suspend_us = DIV_ROUND_UP((cnt + 1) * lat_unit_ns[unit], 1000);
+
+	cnt = FIELD_GET(BFPT_DWORD12_ERASE_RESUME_INT_MASK, dword12);
+	es->resume_interval_us = (cnt + 1) * 64;
+
+	nor->flags |= SNOR_F_ERASE_SUSPEND;
+}
+
 /**
  * spi_nor_parse_bfpt() - read and parse the Basic Flash Parameter Table.
  * @nor:		pointer to a 'struct spi_nor'
@@ -612,6 +650,8 @@ static int spi_nor_parse_bfpt(struct spi_nor *nor,
 	if (bfpt.dwords[BFPT_DWORD(16)] & BFPT_DWORD16_SWRST_EN_RST)
 		nor->flags |= SNOR_F_SOFT_RESET;
 
+	spi_nor_parse_bfpt_erase_suspend(nor, &bfpt);
+
 	/* Stop here if not JESD216 rev C or later. */
 	if (bfpt_header->length == BFPT_DWORD_MAX_JESD216B)
 		return spi_nor_post_bfpt_fixups(nor, bfpt_header, &bfpt);
@@ -49,6 +49,18 @@ struct sfdp_bfpt {
 #define BFPT_DWORD11_PAGE_SIZE_SHIFT		4
 #define BFPT_DWORD11_PAGE_SIZE_MASK		GENMASK(7, 4)
 
+/* 12th DWORD. */
+#define BFPT_DWORD12_SUSPEND_UNSUPPORTED	BIT(31)
+#define BFPT_DWORD12_ERASE_SUS_LAT_UNIT_MASK	GENMASK(30, 29)
+#define BFPT_DWORD12_ERASE_SUS_LAT_CNT_MASK	GENMASK(28, 24)
+#define BFPT_DWORD12_ERASE_RESUME_INT_MASK	GENMASK(23, 20)
+/* Reads are only prohibited in the sector whose erase is suspended. */
+#define BFPT_DWORD12_ERASE_SUS_READ_SECTOR	BIT(6)
+
+/* 13th DWORD. */
+#define BFPT_DWORD13_ERASE_SUSPEND_MASK		GENMASK(31, 24)
+#define BFPT_DWORD13_ERASE_RESUME_MASK		GENMASK(23, 16)
+
 /* 15th DWORD. */
 
 /*
@@ -7,6 +7,8 @@
 #include <net/bonding.h>
 #include <net/bond_alb.h>
 
+#include "bonding_priv.h"
+
 #if defined(CONFIG_DEBUG_FS) && !defined(CONFIG_NET_NS)
 
 #include <linux/debugfs.h>
@@ -47,6 +49,34 @@ static int bond_debug_rlb_hash_show(struct seq_file *m, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(bond_debug_rlb_hash);
 
+/* Show 802.3ad/xor per-cpu xmit slave array counters */
+static int bond_debug_xmit_cache_show(struct seq_file *m, void *v)
+{
+	struct bonding *bond = m->private;
+	struct bond_priv *priv = bond_priv(bond);
+	unsigned long hits = 0, misses = 0, hash_reused = 0;
+	int cpu;
+
+	if (BOND_MODE(bond) != BOND_MODE_8023AD &&
+	    BOND_MODE(bond) != BOND_MODE_XOR)
+		return 0;
+
+	for_each_possible_cpu(cpu) {
+		struct bond_pcpu_xmit *px = per_cpu_ptr(priv->pcpu_xmit, cpu);
+
+		hits += READ_ONCE(px->hits);
+		misses += READ_ONCE(px->misses);
+		hash_reused += READ_ONCE(px->hash_reused);
+	}
+
+	seq_printf(m, "hits:        %lu\n", hits);
+	seq_printf(m, "misses:      %lu\n", misses);
+	seq_printf(m, "hash_reused: %lu\n", hash_reused);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bond_debug_xmit_cache);
+
 void bond_debug_register(struct bonding *bond)
 {
 	if (!bonding_debug_root)
@@ -57,6 +87,9 @@ void bond_debug_register(struct bonding *bond)
 
 	debugfs_create_file("rlb_hash_table", 0400, bond->debug_dir,
 				bond, &bond_debug_rlb_hash_fops);
+
+	debugfs_create_file("xmit_slave_cache", 0400, bond->debug_dir,
+				bond, &bond_debug_xmit_cache_fops);
 }
 
 void bond_debug_unregister(struct bonding *bond)
@@ -120,6 +120,7 @@ static struct bond_params bonding_defaults;
 static int resend_igmp = BOND_DEFAULT_RESEND_IGMP;
 static int packets_per_slave = 1;
 static int lp_interval = BOND_ALB_DEFAULT_LP_INTERVAL;
+static int reuse_l4_hash;
 
 module_param(max_bonds, int, 0);
 MODULE_PARM_DESC(max_bonds, "Max number of bonded devices");
@@ -200,6 +201,10 @@ module_param(lp_interval, uint, 0);
 MODULE_PARM_DESC(lp_interval, "The number of seconds between instances where "
 			      "the bonding driver sends learning packets to "
 			      "each slaves peer switch. The default is 1.");
+module_param(reuse_l4_hash, int, 0644);
+MODULE_PARM_DESC(reuse_l4_hash, "Use a valid L4 skb->hash instead of "
+				"dissecting headers for xmit_hash_policy "
+				"layer3+4; 0 for off (default), 1 for on.");
 
 /*----------------------------- Global variables ----------------------------*/
 
@@ -4172,10 +4177,27 @@ static u32 __bond_xmit_hash(struct bonding *bond, struct sk_buff *skb, const voi
  * This function will extract the necessary headers from the skb buffer and use
  * them to generate a hash based on the xmit_policy set in the bonding device
  */
+/* A flow hash computed over the L4 tuple by the stack or the NIC can stand in
+ * for the encap3+4 hash, and for the layer3+4 one if the admin allows it.
+ */
+static bool bond_xmit_hash_reusable(struct bonding *bond, struct sk_buff *skb)
+{
+	if (!skb->l4_hash)
+		return false;
+
+	switch (bond->params.xmit_policy) {
+	case BOND_XMIT_POLICY_ENCAP34:
+		return true;
+	case BOND_XMIT_POLICY_LAYER34:
+		return READ_ONCE(reuse_l4_hash);
+	default:
+		return false;
+	}
+}
+
 u32 bond_xmit_hash(struct bonding *bond, struct sk_buff *skb)
 {
-	if (bond->params.xmit_policy == BOND_XMIT_POLICY_ENCAP34 &&
-	    skb->l4_hash)
+	if (bond_xmit_hash_reusable(bond, skb))
 		return skb->hash;
 
 	return __bond_xmit_hash(bond, skb, skb->data, skb->protocol,
@@ -5040,6 +5062,18 @@ static void bond_skip_slave(struct bond_up_slave *slaves,
 	}
 }
 
+/* Invalidate the per-cpu copies of usable_slaves. Called with RTNL held
+ * after the array has been replaced or modified.
+ */
+static void bond_slave_arr_changed(struct bonding *bond)
+{
+	struct bond_priv *priv = bond_priv(bond);
+
+	/* pairs with smp_rmb() in bond_xmit_3ad_xor_pcpu_slave_get() */
+	smp_wmb();
+	WRITE_ONCE(priv->slave_arr_gen, priv->slave_arr_gen + 1);
+}
+
 static void bond_set_slave_arr(struct bonding *bond,
 			       struct bond_up_slave *usable_slaves,
 			       struct bond_up_slave *all_slaves)
@@ -5049,6 +5083,7 @@ static void bond_set_slave_arr(struct bonding *bond,
 	usable = rtnl_dereference(bond->usable_slaves);
 	rcu_assign_pointer(bond->usable_slaves, usable_slaves);
 	kfree_rcu(usable, rcu);
+	bond_slave_arr_changed(bond);
 
 	all = rtnl_dereference(bond->all_slaves);
 	rcu_assign_pointer(bond->all_slaves, all_slaves);
@@ -5063,6 +5098,7 @@ static void bond_reset_slave_arr(struct bonding *bond)
 	if (usable) {
 		RCU_INIT_POINTER(bond->usable_slaves, NULL);
 		kfree_rcu(usable, rcu);
+		bond_slave_arr_changed(bond);
 	}
 
 	all = rtnl_dereference(bond->all_slaves);
@@ -5143,6 +5179,7 @@ int bond_update_slave_arr(struct bonding *bond, struct slave *skipslave)
 				skipslave);
 		bond_skip_slave(rtnl_dereference(bond->usable_slaves),
 				skipslave);
+		bond_slave_arr_changed(bond);
 	}
 	kfree_rcu(all_slaves, rcu);
 	kfree_rcu(usable_slaves, rcu);
@@ -5183,6 +5220,53 @@ static struct slave *bond_xdp_xmit_3ad_xor_slave_get(struct bonding *bond,
 	return slaves->arr[hash % count];
 }
 
+/* xmit path variant of bond_xmit_3ad_xor_slave_get(). Every CPU works on
+ * its own copy of usable_slaves, refreshed when the control path has
+ * rebuilt the array, so the hot path only touches CPU local cache lines.
+ * Called with BH disabled.
+ */
+static struct slave *bond_xmit_3ad_xor_pcpu_slave_get(struct bonding *bond,
+						      struct sk_buff *skb)
+{
+	struct bond_priv *priv = bond_priv(bond);
+	struct bond_pcpu_xmit *px = this_cpu_ptr(priv->pcpu_xmit);
+	struct bond_up_slave *slaves;
+	unsigned int count;
+	unsigned long gen;
+	u32 hash;
+
+	gen = READ_ONCE(priv->slave_arr_gen);
+	/* pairs with smp_wmb() in bond_slave_arr_changed() */
+	smp_rmb();
+
+	if (likely(px->gen == gen)) {
+		px->hits++;
+	} else {
+		px->misses++;
+		slaves = rcu_dereference(bond->usable_slaves);
+		count = slaves ? READ_ONCE(slaves->count) : 0;
+		if (unlikely(count > BOND_PCPU_SLAVES_MAX))
+			return bond_xmit_3ad_xor_slave_get(bond, skb, slaves);
+
+		if (count)
+			memcpy(px->arr, slaves->arr, count * sizeof(px->arr[0]));
+		px->count = count;
+		px->gen = gen;
+	}
+
+	if (unlikely(!px->count))
+		return NULL;
+
+	if (bond_xmit_hash_reusable(bond, skb)) {
+		px->hash_reused++;
+		hash = skb->hash;
+	} else {
+		hash = bond_xmit_hash(bond, skb);
+	}
+
+	return px->arr[hash % px->count];
+}
+
 /* Use this Xmit function for 3AD as well as XOR modes. The current
  * usable slave array is formed in the control path. The xmit function
  * just calculates hash and sends the packet out.
@@ -5191,11 +5275,9 @@ static netdev_tx_t bond_3ad_xor_xmit(struct sk_buff *skb,
 				     struct net_device *dev)
 {
 	struct bonding *bond = netdev_priv(dev);
-	struct bond_up_slave *slaves;
 	struct slave *slave;
 
-	slaves = rcu_dereference(bond->usable_slaves);
-	slave = bond_xmit_3ad_xor_slave_get(bond, skb, slaves);
+	slave = bond_xmit_3ad_xor_pcpu_slave_get(bond, skb);
 	if (likely(slave))
 		return bond_dev_queue_xmit(bond, skb, slave->dev);
 
@@ -5795,6 +5877,8 @@ static void bond_destructor(struct net_device *bond_dev)
 
 	if (bond->rr_tx_counter)
 		free_percpu(bond->rr_tx_counter);
+
+	free_percpu(bond_priv(bond)->pcpu_xmit);
 }
 
 void bond_setup(struct net_device *bond_dev)
@@ -5885,6 +5969,7 @@ static void bond_uninit(struct net_device *bond_dev)
 	if (usable) {
 		RCU_INIT_POINTER(bond->usable_slaves, NULL);
 		kfree_rcu(usable, rcu);
+		bond_slave_arr_changed(bond);
 	}
 
 	all = rtnl_dereference(bond->all_slaves);
@@ -6297,9 +6382,18 @@ static int bond_init(struct net_device *bond_dev)
 
 	netdev_dbg(bond_dev, "Begin bond_init\n");
 
+	/* per-cpu copies start out at gen 0, i.e. stale */
+	bond_priv(bond)->slave_arr_gen = 1;
+	bond_priv(bond)->pcpu_xmit = alloc_percpu(struct bond_pcpu_xmit);
+	if (!bond_priv(bond)->pcpu_xmit)
+		return -ENOMEM;
+
 	bond->wq = alloc_ordered_workqueue(bond_dev->name, WQ_MEM_RECLAIM);
-	if (!bond->wq)
+	if (!bond->wq) {
+		free_percpu(bond_priv(bond)->pcpu_xmit);
+		bond_priv(bond)->pcpu_xmit = NULL;
 		return -ENOMEM;
+	}
 
 	bond->notifier_ctx = false;
 
@@ -6338,7 +6432,7 @@ int bond_create(struct net *net, const char *name)
 
 	rtnl_lock();
 
-	bond_dev = alloc_netdev_mq(sizeof(struct bonding),
+	bond_dev = alloc_netdev_mq(BOND_PRIV_SIZE,
 				   name ? name : "bond%d", NET_NAME_UNKNOWN,
 				   bond_setup, tx_queues);
 	if (!bond_dev)
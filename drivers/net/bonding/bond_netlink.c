@@ -16,6 +16,8 @@
 #include <net/bonding.h>
 #include <net/ipv6.h>
 
+#include "bonding_priv.h"
+
 static size_t bond_get_slave_size(const struct net_device *bond_dev,
 				  const struct net_device *slave_dev)
 {
@@ -891,7 +893,7 @@ static int bond_fill_linkxstats(struct sk_buff *skb,
 
 struct rtnl_link_ops bond_link_ops __read_mostly = {
 	.kind			= "bond",
-	.priv_size		= sizeof(struct bonding),
+	.priv_size		= BOND_PRIV_SIZE,
 	.setup			= bond_setup,
 	.maxtype		= IFLA_BOND_MAX,
 	.policy			= bond_policy,
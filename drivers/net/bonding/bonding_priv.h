@@ -21,4 +21,31 @@
 
 #define bond_version DRV_DESCRIPTION ": v" UTS_RELEASE "\n"
 
+/* Per-cpu copy of bond->usable_slaves used by the 802.3ad/xor xmit path */
+#define BOND_PCPU_SLAVES_MAX	16
+
+struct bond_pcpu_xmit {
+	unsigned long gen;	/* bond_priv.slave_arr_gen of arr[] */
+	unsigned int count;
+	struct slave *arr[BOND_PCPU_SLAVES_MAX];
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long hash_reused;
+};
+
+/* Driver private data kept in the netdev private area right after
+ * struct bonding.
+ */
+struct bond_priv {
+	unsigned long slave_arr_gen;	/* bumped when usable_slaves changes */
+	struct bond_pcpu_xmit __percpu *pcpu_xmit;
+};
+
+#define BOND_PRIV_SIZE	(sizeof(struct bonding) + sizeof(struct bond_priv))
+
+static inline struct bond_priv *bond_priv(struct bonding *bond)
+{
+	return (struct bond_priv *)(bond + 1);
+}
+
 #endif
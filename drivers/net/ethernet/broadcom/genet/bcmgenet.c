@@ -36,6 +36,10 @@
 #include <linux/ipv6.h>
 #include <linux/phy.h>
 #include <linux/platform_data/bcmgenet.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool.h>
+#include <net/xdp.h>
 
 #include <asm/unaligned.h>
 
@@ -53,7 +57,14 @@
 	(TOTAL_DESC - priv->hw_params->tx_queues * priv->hw_params->tx_bds_per_q)
 
 #define RX_BUF_LENGTH		2048
-#define SKB_ALIGNMENT		32
+
+/* Rx buffers are whole page_pool pages: XDP headroom, then the 64B RSB and
+ * the 2 bytes of IP alignment padding written by the hardware, then the
+ * frame itself, with room left at the end for the skb_shared_info.
+ */
+#define GENET_RX_HEADROOM	XDP_PACKET_HEADROOM
+#define GENET_RX_OFFSET		(sizeof(struct status_64) + 2)
+#define GENET_RX_TRUESIZE	PAGE_SIZE
 
 /* Tx/Rx DMA register offset, skip 256 descriptors */
 #define WORDS_PER_BD(p)		(p->hw_params->words_per_bd)
@@ -73,6 +84,9 @@ MODULE_PARM_DESC(skip_umac_reset, "Skip UMAC reset step");
 static bool eee = true;
 module_param(eee, bool, 0444);
 MODULE_PARM_DESC(eee, "Enable EEE (default Y)");
+static bool rx_steering = true;
+module_param(rx_steering, bool, 0444);
+MODULE_PARM_DESC(rx_steering, "Spread Rx flows across the priority rings (default Y)");
 
 static inline void bcmgenet_writel(u32 value, void __iomem *offset)
 {
@@ -698,9 +712,9 @@ static void bcmgenet_hfb_create_rxnfc_filter(struct bcmgenet_priv *priv,
 		bcmgenet_hfb_set_filter_rx_queue_mapping(priv, f, 0);
 		rule->state = BCMGENET_RXNFC_STATE_DISABLED;
 	} else {
-		/* Other Rx rings are direct mapped here */
+		/* Rx queue n > 0 is priority ring n - 1 */
 		bcmgenet_hfb_set_filter_rx_queue_mapping(priv, f,
-							 fs->ring_cookie);
+							 fs->ring_cookie - 1);
 		bcmgenet_hfb_enable_filter(priv, f);
 		rule->state = BCMGENET_RXNFC_STATE_ENABLED;
 	}
@@ -757,6 +771,79 @@ static void bcmgenet_hfb_init(struct bcmgenet_priv *priv)
 	bcmgenet_hfb_clear(priv);
 }
 
+static void bcmgenet_hfb_create_steering_filter(struct bcmgenet_priv *priv,
+						u32 f, __be16 proto,
+						u32 l4_offset, u8 nibble,
+						u32 rx_ring)
+{
+	__be16 val_16 = proto;
+	u16 mask_16 = 0xFFFF;
+	u8 val_8, mask_8;
+
+	bcmgenet_hfb_insert_data(priv, f, 2 * ETH_ALEN, &val_16, &mask_16,
+				 sizeof(val_16));
+
+	/* Only supports 20 byte IPv4 header */
+	if (proto == htons(ETH_P_IP)) {
+		val_8 = 0x45;
+		mask_8 = 0xFF;
+		bcmgenet_hfb_insert_data(priv, f, ETH_HLEN, &val_8, &mask_8,
+					 sizeof(val_8));
+	}
+
+	/* Low nibble of the source port, in its second byte */
+	val_8 = nibble;
+	mask_8 = 0x0F;
+	bcmgenet_hfb_insert_data(priv, f, l4_offset + 1, &val_8, &mask_8,
+				 sizeof(val_8));
+
+	bcmgenet_hfb_set_filter_length(priv, f, l4_offset + 2);
+	bcmgenet_hfb_set_filter_rx_queue_mapping(priv, f, rx_ring);
+	bcmgenet_hfb_enable_filter(priv, f);
+}
+
+/* bcmgenet_hfb_create_steering_filters
+ *
+ * Spread IPv4 and IPv6 flows over the Rx priority rings and the default
+ * ring 16 by the low nibble of their L4 source port. The HFB only matches
+ * under nibble masks, so this takes one filter per nibble value mapped to a
+ * priority ring; values left to ring 16 need none. The filters live above
+ * the MAX_NUM_OF_FS_RULES locations owned by rxnfc rules.
+ */
+static void bcmgenet_hfb_create_steering_filters(struct bcmgenet_priv *priv)
+{
+	static const struct {
+		__be16 proto;
+		u32 l4_offset;
+	} keys[] = {
+		{ htons(ETH_P_IP), ETH_HLEN + sizeof(struct iphdr) },
+		{ htons(ETH_P_IPV6), ETH_HLEN + sizeof(struct ipv6hdr) },
+	};
+	u32 nr_rings = priv->hw_params->rx_queues + 1;
+	u32 f = MAX_NUM_OF_FS_RULES;
+	u32 k, v, rx_ring;
+
+	if (!rx_steering || !priv->hw_params->rx_queues ||
+	    priv->hw_params->hfb_filter_size < 128)
+		return;
+
+	for (k = 0; k < ARRAY_SIZE(keys); k++) {
+		for (v = 0; v < 16; v++) {
+			rx_ring = v % nr_rings;
+			if (rx_ring == priv->hw_params->rx_queues)
+				continue;
+
+			if (f >= priv->hw_params->hfb_filter_cnt)
+				return;
+
+			bcmgenet_hfb_create_steering_filter(priv, f++,
+							    keys[k].proto,
+							    keys[k].l4_offset,
+							    v, rx_ring);
+		}
+	}
+}
+
 static int bcmgenet_begin(struct net_device *dev)
 {
 	struct bcmgenet_priv *priv = netdev_priv(dev);
@@ -857,6 +944,7 @@ static int bcmgenet_get_coalesce(struct net_device *dev,
 	}
 	ring = &priv->rx_rings[DESC_INDEX];
 	ec->use_adaptive_rx_coalesce |= ring->dim.use_dim;
+	ec->rx_coalesce_usecs_high = ring->rx_coalesce_usecs_high;
 
 	return 0;
 }
@@ -884,15 +972,29 @@ static void bcmgenet_set_ring_rx_coalesce(struct bcmgenet_rx_ring *ring,
 
 	ring->rx_coalesce_usecs = ec->rx_coalesce_usecs;
 	ring->rx_max_coalesced_frames = ec->rx_max_coalesced_frames;
+	ring->rx_coalesce_usecs_high = ec->rx_coalesce_usecs_high;
 	usecs = ring->rx_coalesce_usecs;
 	pkts = ring->rx_max_coalesced_frames;
 
+	/* With adaptive RX, rx-usecs-high is the latency target DIM keeps to */
+	net_dim_set_rx_latency_target(&ring->dim.dim,
+				      min_t(u32, ring->rx_coalesce_usecs_high,
+					    U16_MAX));
+
 	if (ec->use_adaptive_rx_coalesce && !ring->dim.use_dim) {
 		moder = net_dim_get_def_rx_moderation(ring->dim.dim.mode);
 		usecs = moder.usec;
 		pkts = moder.pkts;
 	}
 
+	if (ec->use_adaptive_rx_coalesce && ring->rx_coalesce_usecs_high &&
+	    usecs > ring->rx_coalesce_usecs_high) {
+		moder = net_dim_get_rx_moderation(ring->dim.dim.mode,
+						  ring->dim.dim.profile_ix);
+		usecs = moder.usec;
+		pkts = moder.pkts;
+	}
+
 	ring->dim.use_dim = ec->use_adaptive_rx_coalesce;
 	bcmgenet_set_rx_coalesce(ring, usecs, pkts);
 }
@@ -1139,6 +1241,11 @@ static const struct bcmgenet_stats bcmgenet_gstrings_stats[] = {
 	STAT_GENET_SOFT_MIB("tx_realloc_tsb", mib.tx_realloc_tsb),
 	STAT_GENET_SOFT_MIB("tx_realloc_tsb_failed",
 			    mib.tx_realloc_tsb_failed),
+	STAT_GENET_SOFT_MIB("rx_xdp_drop", mib.rx_xdp_drop),
+	STAT_GENET_SOFT_MIB("rx_xdp_tx", mib.rx_xdp_tx),
+	STAT_GENET_SOFT_MIB("rx_xdp_redirect", mib.rx_xdp_redirect),
+	STAT_GENET_SOFT_MIB("tx_xdp_xmit", mib.tx_xdp_xmit),
+	STAT_GENET_SOFT_MIB("tx_xdp_xmit_errors", mib.tx_xdp_xmit_errors),
 	/* Per TX queues */
 	STAT_GENET_Q(0),
 	STAT_GENET_Q(1),
@@ -1582,7 +1689,7 @@ static int bcmgenet_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *cmd,
 
 	switch (cmd->cmd) {
 	case ETHTOOL_GRXRINGS:
-		cmd->data = priv->hw_params->rx_queues ?: 1;
+		cmd->data = priv->hw_params->rx_queues + 1;
 		break;
 	case ETHTOOL_GRXCLSRLCNT:
 		cmd->rule_cnt = bcmgenet_get_num_flows(priv);
@@ -1610,7 +1717,8 @@ static int bcmgenet_get_rxnfc(struct net_device *dev, struct ethtool_rxnfc *cmd,
 static const struct ethtool_ops bcmgenet_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_RX_USECS |
 				     ETHTOOL_COALESCE_MAX_FRAMES |
-				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX |
+				     ETHTOOL_COALESCE_RX_USECS_HIGH,
 	.begin			= bcmgenet_begin,
 	.complete		= bcmgenet_complete,
 	.get_strings		= bcmgenet_get_strings,
@@ -1821,6 +1929,21 @@ static struct sk_buff *bcmgenet_free_tx_cb(struct device *dev,
 {
 	struct sk_buff *skb;
 
+	if (cb->xdpf) {
+		/* Frames transmitted with XDP_TX are still mapped by the Rx
+		 * page_pool and carry no dma_addr of their own.
+		 */
+		if (dma_unmap_addr(cb, dma_addr)) {
+			dma_unmap_single(dev, dma_unmap_addr(cb, dma_addr),
+					 dma_unmap_len(cb, dma_len),
+					 DMA_TO_DEVICE);
+			dma_unmap_addr_set(cb, dma_addr, 0);
+		}
+		xdp_return_frame(cb->xdpf);
+		cb->xdpf = NULL;
+		return NULL;
+	}
+
 	skb = cb->skb;
 
 	if (skb) {
@@ -1849,22 +1972,18 @@ static struct sk_buff *bcmgenet_free_tx_cb(struct device *dev,
 	return NULL;
 }
 
-/* Simple helper to free a receive control block's resources */
-static struct sk_buff *bcmgenet_free_rx_cb(struct device *dev,
-					   struct enet_cb *cb)
+/* Simple helper to detach a receive control block's page. The page stays
+ * DMA mapped by the ring's page_pool until it is handed back to it.
+ */
+static struct page *bcmgenet_free_rx_cb(struct enet_cb *cb)
 {
-	struct sk_buff *skb;
+	struct page *page;
 
-	skb = cb->skb;
-	cb->skb = NULL;
-
-	if (dma_unmap_addr(cb, dma_addr)) {
-		dma_unmap_single(dev, dma_unmap_addr(cb, dma_addr),
-				 dma_unmap_len(cb, dma_len), DMA_FROM_DEVICE);
-		dma_unmap_addr_set(cb, dma_addr, 0);
-	}
+	page = cb->page;
+	cb->page = NULL;
+	dma_unmap_addr_set(cb, dma_addr, 0);
 
-	return skb;
+	return page;
 }
 
 /* Unlocked version of the reclaim routine */
@@ -1875,8 +1994,11 @@ static unsigned int __bcmgenet_tx_reclaim(struct net_device *dev,
 	unsigned int txbds_processed = 0;
 	unsigned int bytes_compl = 0;
 	unsigned int pkts_compl = 0;
+	unsigned int xdp_bytes = 0;
+	unsigned int xdp_pkts = 0;
 	unsigned int txbds_ready;
 	unsigned int c_index;
+	struct enet_cb *tx_cb_ptr;
 	struct sk_buff *skb;
 
 	/* Clear status before servicing to reduce spurious interrupts */
@@ -1898,8 +2020,13 @@ static unsigned int __bcmgenet_tx_reclaim(struct net_device *dev,
 
 	/* Reclaim transmitted buffers */
 	while (txbds_processed < txbds_ready) {
-		skb = bcmgenet_free_tx_cb(&priv->pdev->dev,
-					  &priv->tx_cbs[ring->clean_ptr]);
+		tx_cb_ptr = &priv->tx_cbs[ring->clean_ptr];
+		if (tx_cb_ptr->xdpf) {
+			xdp_pkts++;
+			xdp_bytes += tx_cb_ptr->xdpf->len;
+		}
+
+		skb = bcmgenet_free_tx_cb(&priv->pdev->dev, tx_cb_ptr);
 		if (skb) {
 			pkts_compl++;
 			bytes_compl += GENET_CB(skb)->bytes_sent;
@@ -1916,9 +2043,10 @@ static unsigned int __bcmgenet_tx_reclaim(struct net_device *dev,
 	ring->free_bds += txbds_processed;
 	ring->c_index = c_index;
 
-	ring->packets += pkts_compl;
-	ring->bytes += bytes_compl;
+	ring->packets += pkts_compl + xdp_pkts;
+	ring->bytes += bytes_compl + xdp_bytes;
 
+	/* XDP frames bypass BQL, only account for the stack's skbs */
 	netdev_tx_completed_queue(netdev_get_tx_queue(dev, ring->queue),
 				  pkts_compl, bytes_compl);
 
@@ -2188,46 +2316,209 @@ static netdev_tx_t bcmgenet_xmit(struct sk_buff *skb, struct net_device *dev)
 	goto out;
 }
 
-static struct sk_buff *bcmgenet_rx_refill(struct bcmgenet_priv *priv,
-					  struct enet_cb *cb)
+/* Queue one XDP frame on a Tx ring, ring->lock must be held. Frames coming
+ * from our own Rx rings (XDP_TX) reuse the page_pool mapping, redirected
+ * frames get mapped here and unmapped on reclaim.
+ */
+static int bcmgenet_xdp_xmit_frame(struct bcmgenet_priv *priv,
+				   struct bcmgenet_tx_ring *ring,
+				   struct xdp_frame *xdpf, bool dma_map)
 {
 	struct device *kdev = &priv->pdev->dev;
-	struct sk_buff *skb;
-	struct sk_buff *rx_skb;
+	struct enet_cb *tx_cb_ptr;
+	struct netdev_queue *txq;
 	dma_addr_t mapping;
+	unsigned int size;
+	struct page *page;
+	u32 len_stat;
 
-	/* Allocate a new Rx skb */
-	skb = __netdev_alloc_skb(priv->dev, priv->rx_buf_len + SKB_ALIGNMENT,
-				 GFP_ATOMIC | __GFP_NOWARN);
-	if (!skb) {
-		priv->mib.alloc_rx_buff_failed++;
-		netif_err(priv, rx_err, priv->dev,
-			  "%s: Rx skb allocation failed\n", __func__);
-		return NULL;
+	/* Keep enough descriptors for a fully fragmented skb from the stack so
+	 * that bcmgenet_xmit() never finds the ring full with the queue awake.
+	 */
+	if (ring->free_bds <= (MAX_SKB_FRAGS + 2))
+		return -EBUSY;
+
+	/* The hardware expects a Transmit Status Block in front of the frame */
+	if (xdpf->headroom < sizeof(struct status_64))
+		return -EINVAL;
+
+	memset(xdpf->data - sizeof(struct status_64), 0,
+	       sizeof(struct status_64));
+	size = xdpf->len + sizeof(struct status_64);
+
+	if (dma_map) {
+		mapping = dma_map_single(kdev,
+					 xdpf->data - sizeof(struct status_64),
+					 size, DMA_TO_DEVICE);
+		if (dma_mapping_error(kdev, mapping)) {
+			priv->mib.tx_dma_failed++;
+			return -ENOMEM;
+		}
+	} else {
+		page = virt_to_page(xdpf->data);
+		mapping = page_pool_get_dma_addr(page) +
+			  sizeof(*xdpf) + xdpf->headroom -
+			  sizeof(struct status_64);
+		dma_sync_single_for_device(kdev, mapping, size,
+					   DMA_BIDIRECTIONAL);
 	}
 
-	/* DMA-map the new Rx skb */
-	mapping = dma_map_single(kdev, skb->data, priv->rx_buf_len,
-				 DMA_FROM_DEVICE);
-	if (dma_mapping_error(kdev, mapping)) {
-		priv->mib.rx_dma_failed++;
-		dev_kfree_skb_any(skb);
+	tx_cb_ptr = bcmgenet_get_txcb(priv, ring);
+	tx_cb_ptr->xdpf = xdpf;
+	dma_unmap_addr_set(tx_cb_ptr, dma_addr, dma_map ? mapping : 0);
+	dma_unmap_len_set(tx_cb_ptr, dma_len, size);
+
+	len_stat = (size << DMA_BUFLENGTH_SHIFT) |
+		   (priv->hw_params->qtag_mask << DMA_TX_QTAG_SHIFT) |
+		   DMA_TX_APPEND_CRC | DMA_SOP | DMA_EOP;
+	dmadesc_set(priv, tx_cb_ptr->bd_addr, mapping, len_stat);
+
+	ring->free_bds--;
+	ring->prod_index++;
+	ring->prod_index &= DMA_P_INDEX_MASK;
+
+	if (ring->free_bds <= (MAX_SKB_FRAGS + 1)) {
+		txq = netdev_get_tx_queue(priv->dev, ring->queue);
+		netif_tx_stop_queue(txq);
+	}
+
+	return 0;
+}
+
+/* XDP frames all go out of the default Tx queue 16 */
+static struct bcmgenet_tx_ring *bcmgenet_xdp_tx_ring(struct bcmgenet_priv *priv)
+{
+	return &priv->tx_rings[DESC_INDEX];
+}
+
+static void bcmgenet_xdp_tx_flush(struct bcmgenet_priv *priv,
+				  struct bcmgenet_tx_ring *ring)
+{
+	bcmgenet_tdma_ring_writel(priv, ring->index, ring->prod_index,
+				  TDMA_PROD_INDEX);
+}
+
+static int bcmgenet_xdp_xmit(struct net_device *dev, int num_frames,
+			     struct xdp_frame **frames, u32 flags)
+{
+	struct bcmgenet_priv *priv = netdev_priv(dev);
+	struct bcmgenet_tx_ring *ring;
+	int nxmit = 0;
+	int i;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		return -ENETDOWN;
+
+	ring = bcmgenet_xdp_tx_ring(priv);
+
+	spin_lock(&ring->lock);
+	for (i = 0; i < num_frames; i++) {
+		if (bcmgenet_xdp_xmit_frame(priv, ring, frames[i], true))
+			break;
+		nxmit++;
+	}
+
+	if (nxmit && (flags & XDP_XMIT_FLUSH))
+		bcmgenet_xdp_tx_flush(priv, ring);
+	spin_unlock(&ring->lock);
+
+	priv->mib.tx_xdp_xmit += nxmit;
+	priv->mib.tx_xdp_xmit_errors += num_frames - nxmit;
+
+	return nxmit;
+}
+
+static struct page *bcmgenet_rx_refill(struct bcmgenet_rx_ring *ring,
+				       struct enet_cb *cb)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct page *rx_page;
+	dma_addr_t mapping;
+	struct page *page;
+
+	/* Allocate a new Rx page, already DMA-mapped by the page_pool */
+	page = page_pool_dev_alloc_pages(ring->page_pool);
+	if (!page) {
+		priv->mib.alloc_rx_buff_failed++;
 		netif_err(priv, rx_err, priv->dev,
-			  "%s: Rx skb DMA mapping failed\n", __func__);
+			  "%s: Rx page allocation failed\n", __func__);
 		return NULL;
 	}
 
-	/* Grab the current Rx skb from the ring and DMA-unmap it */
-	rx_skb = bcmgenet_free_rx_cb(kdev, cb);
+	/* Grab the current Rx page from the ring */
+	rx_page = bcmgenet_free_rx_cb(cb);
 
-	/* Put the new Rx skb on the ring */
-	cb->skb = skb;
+	/* Put the new Rx page on the ring */
+	mapping = page_pool_get_dma_addr(page) + GENET_RX_HEADROOM;
+	cb->page = page;
 	dma_unmap_addr_set(cb, dma_addr, mapping);
 	dma_unmap_len_set(cb, dma_len, priv->rx_buf_len);
 	dmadesc_set_addr(priv, cb->bd_addr, mapping);
 
-	/* Return the current Rx skb to caller */
-	return rx_skb;
+	/* Return the current Rx page to caller */
+	return rx_page;
+}
+
+#define GENET_XDP_PASS		0
+#define GENET_XDP_CONSUMED	BIT(0)
+#define GENET_XDP_TX		BIT(1)
+#define GENET_XDP_REDIR		BIT(2)
+
+static unsigned int bcmgenet_run_xdp(struct bcmgenet_rx_ring *ring,
+				     struct bpf_prog *prog,
+				     struct xdp_buff *xdp, struct page *page)
+{
+	struct bcmgenet_priv *priv = ring->priv;
+	struct net_device *dev = priv->dev;
+	struct bcmgenet_tx_ring *tx_ring;
+	struct xdp_frame *xdpf;
+	unsigned int act;
+	int err;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+
+	switch (act) {
+	case XDP_PASS:
+		return GENET_XDP_PASS;
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(xdp);
+		if (unlikely(!xdpf))
+			goto out_failure;
+
+		tx_ring = bcmgenet_xdp_tx_ring(priv);
+		spin_lock(&tx_ring->lock);
+		err = bcmgenet_xdp_xmit_frame(priv, tx_ring, xdpf, false);
+		spin_unlock(&tx_ring->lock);
+		if (unlikely(err))
+			goto out_failure;
+
+		priv->mib.rx_xdp_tx++;
+		return GENET_XDP_TX;
+	case XDP_REDIRECT:
+		err = xdp_do_redirect(dev, xdp, prog);
+		if (unlikely(err))
+			goto out_failure;
+
+		priv->mib.rx_xdp_redirect++;
+		return GENET_XDP_REDIR;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	priv->mib.rx_xdp_drop++;
+	page_pool_recycle_direct(ring->page_pool, page);
+
+	return GENET_XDP_CONSUMED;
 }
 
 /* bcmgenet_desc_rx - descriptor based rx process.
@@ -2237,16 +2528,23 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 				     unsigned int budget)
 {
 	struct bcmgenet_priv *priv = ring->priv;
+	struct device *kdev = &priv->pdev->dev;
 	struct net_device *dev = priv->dev;
+	unsigned int xdp_status = 0;
+	struct bpf_prog *xdp_prog;
 	struct enet_cb *cb;
 	struct sk_buff *skb;
+	struct xdp_buff xdp;
+	struct page *page;
 	u32 dma_length_status;
 	unsigned long dma_flag;
+	dma_addr_t dma;
 	int len;
 	unsigned int rxpktprocessed = 0, rxpkttoprocess;
 	unsigned int bytes_processed = 0;
 	unsigned int p_index, mask;
 	unsigned int discards;
+	void *va;
 
 	/* Clear status before servicing to reduce spurious interrupts */
 	if (ring->index == DESC_INDEX) {
@@ -2282,28 +2580,31 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 	netif_dbg(priv, rx_status, dev,
 		  "RDMA: rxpkttoprocess=%d\n", rxpkttoprocess);
 
+	xdp_prog = READ_ONCE(priv->xdp_prog);
+	xdp_init_buff(&xdp, GENET_RX_TRUESIZE, &ring->xdp_rxq);
+
 	while ((rxpktprocessed < rxpkttoprocess) &&
 	       (rxpktprocessed < budget)) {
 		struct status_64 *status;
+		unsigned int act;
 		__be16 rx_csum;
 
 		cb = &priv->rx_cbs[ring->read_ptr];
-		skb = bcmgenet_rx_refill(priv, cb);
+		dma = dma_unmap_addr(cb, dma_addr);
+		page = bcmgenet_rx_refill(ring, cb);
 
-		if (unlikely(!skb)) {
+		if (unlikely(!page)) {
 			ring->dropped++;
 			goto next;
 		}
 
-		status = (struct status_64 *)skb->data;
+		/* Only the RSB first, the frame length is not known yet */
+		dma_sync_single_for_cpu(kdev, dma, sizeof(*status),
+					page_pool_get_dma_dir(ring->page_pool));
+
+		va = page_address(page);
+		status = (struct status_64 *)(va + GENET_RX_HEADROOM);
 		dma_length_status = status->length_status;
-		if (dev->features & NETIF_F_RXCSUM) {
-			rx_csum = (__force __be16)(status->rx_csum & 0xffff);
-			if (rx_csum) {
-				skb->csum = (__force __wsum)ntohs(rx_csum);
-				skb->ip_summed = CHECKSUM_COMPLETE;
-			}
-		}
 
 		/* DMA flags and length are still valid no matter how
 		 * we got the Receive Status Vector (64B RSB or register)
@@ -2320,7 +2621,7 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 			netif_err(priv, rx_status, dev, "oversized packet\n");
 			dev->stats.rx_length_errors++;
 			dev->stats.rx_errors++;
-			dev_kfree_skb_any(skb);
+			page_pool_recycle_direct(ring->page_pool, page);
 			goto next;
 		}
 
@@ -2328,7 +2629,7 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 			netif_err(priv, rx_status, dev,
 				  "dropping fragmented packet!\n");
 			ring->errors++;
-			dev_kfree_skb_any(skb);
+			page_pool_recycle_direct(ring->page_pool, page);
 			goto next;
 		}
 
@@ -2349,27 +2650,62 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 			if (dma_flag & DMA_RX_LG)
 				dev->stats.rx_length_errors++;
 			dev->stats.rx_errors++;
-			dev_kfree_skb_any(skb);
+			page_pool_recycle_direct(ring->page_pool, page);
 			goto next;
 		} /* error packet */
 
-		skb_put(skb, len);
+		if (len > sizeof(*status))
+			dma_sync_single_for_cpu(kdev, dma + sizeof(*status),
+						len - sizeof(*status),
+						page_pool_get_dma_dir(ring->page_pool));
 
 		/* remove RSB and hardware 2bytes added for IP alignment */
-		skb_pull(skb, 66);
-		len -= 66;
+		len -= GENET_RX_OFFSET;
 
-		if (priv->crc_fwd_en) {
-			skb_trim(skb, len - ETH_FCS_LEN);
+		if (priv->crc_fwd_en)
 			len -= ETH_FCS_LEN;
-		}
 
 		bytes_processed += len;
+		ring->packets++;
+		ring->bytes += len;
+
+		xdp_prepare_buff(&xdp, va, GENET_RX_HEADROOM + GENET_RX_OFFSET,
+				 len, false);
+
+		if (xdp_prog) {
+			act = bcmgenet_run_xdp(ring, xdp_prog, &xdp, page);
+			if (act != GENET_XDP_PASS) {
+				xdp_status |= act;
+				goto next;
+			}
+		}
+
+		skb = napi_build_skb(va, GENET_RX_TRUESIZE);
+		if (unlikely(!skb)) {
+			priv->mib.alloc_rx_buff_failed++;
+			ring->dropped++;
+			page_pool_recycle_direct(ring->page_pool, page);
+			goto next;
+		}
+
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		__skb_put(skb, xdp.data_end - xdp.data);
+
+		/* The program may have rewritten the frame, the checksum
+		 * computed by the hardware can only be trusted without one.
+		 */
+		if ((dev->features & NETIF_F_RXCSUM) && !xdp_prog) {
+			rx_csum = (__force __be16)(status->rx_csum & 0xffff);
+			if (rx_csum) {
+				skb->csum = (__force __wsum)ntohs(rx_csum);
+				skb->ip_summed = CHECKSUM_COMPLETE;
+			}
+		}
 
 		/*Finish setting up the received SKB and send it to the kernel*/
 		skb->protocol = eth_type_trans(skb, priv->dev);
-		ring->packets++;
-		ring->bytes += len;
+		skb_record_rx_queue(skb, ring->queue);
 		if (dma_flag & DMA_RX_MULT)
 			dev->stats.multicast++;
 
@@ -2388,6 +2724,17 @@ static unsigned int bcmgenet_desc_rx(struct bcmgenet_rx_ring *ring,
 		bcmgenet_rdma_ring_writel(priv, ring->index, ring->c_index, RDMA_CONS_INDEX);
 	}
 
+	if (xdp_status & GENET_XDP_TX) {
+		struct bcmgenet_tx_ring *tx_ring = bcmgenet_xdp_tx_ring(priv);
+
+		spin_lock(&tx_ring->lock);
+		bcmgenet_xdp_tx_flush(priv, tx_ring);
+		spin_unlock(&tx_ring->lock);
+	}
+
+	if (xdp_status & GENET_XDP_REDIR)
+		xdp_do_flush();
+
 	ring->dim.bytes = bytes_processed;
 	ring->dim.packets = rxpktprocessed;
 
@@ -2432,12 +2779,58 @@ static void bcmgenet_dim_work(struct work_struct *work)
 	dim->state = DIM_START_MEASURE;
 }
 
-/* Assign skb to RX DMA descriptor. */
+static int bcmgenet_create_page_pool(struct bcmgenet_priv *priv,
+				     struct bcmgenet_rx_ring *ring)
+{
+	struct page_pool_params pp_params = {
+		.order = 0,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = ring->size,
+		.nid = NUMA_NO_NODE,
+		.dev = &priv->pdev->dev,
+		/* XDP_TX sends the Rx pages back out without remapping them */
+		.dma_dir = priv->xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE,
+		.offset = GENET_RX_HEADROOM,
+		.max_len = RX_BUF_LENGTH,
+	};
+	int ret;
+
+	BUILD_BUG_ON(GENET_RX_HEADROOM + RX_BUF_LENGTH +
+		     SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) >
+		     GENET_RX_TRUESIZE);
+
+	ring->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(ring->page_pool)) {
+		ret = PTR_ERR(ring->page_pool);
+		ring->page_pool = NULL;
+		return ret;
+	}
+
+	ret = xdp_rxq_info_reg(&ring->xdp_rxq, priv->dev, ring->queue, 0);
+	if (ret)
+		goto err_destroy_pool;
+
+	ret = xdp_rxq_info_reg_mem_model(&ring->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 ring->page_pool);
+	if (ret)
+		goto err_unreg_rxq;
+
+	return 0;
+
+err_unreg_rxq:
+	xdp_rxq_info_unreg(&ring->xdp_rxq);
+err_destroy_pool:
+	page_pool_destroy(ring->page_pool);
+	ring->page_pool = NULL;
+	return ret;
+}
+
+/* Assign page_pool pages to RX DMA descriptor. */
 static int bcmgenet_alloc_rx_buffers(struct bcmgenet_priv *priv,
 				     struct bcmgenet_rx_ring *ring)
 {
 	struct enet_cb *cb;
-	struct sk_buff *skb;
+	struct page *page;
 	int i;
 
 	netif_dbg(priv, hw, priv->dev, "%s\n", __func__);
@@ -2445,29 +2838,49 @@ static int bcmgenet_alloc_rx_buffers(struct bcmgenet_priv *priv,
 	/* loop here for each buffer needing assign */
 	for (i = 0; i < ring->size; i++) {
 		cb = ring->cbs + i;
-		skb = bcmgenet_rx_refill(priv, cb);
-		if (skb)
-			dev_consume_skb_any(skb);
-		if (!cb->skb)
+		page = bcmgenet_rx_refill(ring, cb);
+		if (page)
+			page_pool_put_full_page(ring->page_pool, page, false);
+		if (!cb->page)
 			return -ENOMEM;
 	}
 
 	return 0;
 }
 
-static void bcmgenet_free_rx_buffers(struct bcmgenet_priv *priv)
+static void bcmgenet_free_rx_ring_buffers(struct bcmgenet_rx_ring *ring)
 {
-	struct sk_buff *skb;
+	struct page *page;
 	struct enet_cb *cb;
 	int i;
 
-	for (i = 0; i < priv->num_rx_bds; i++) {
-		cb = &priv->rx_cbs[i];
+	if (!ring->page_pool)
+		return;
 
-		skb = bcmgenet_free_rx_cb(&priv->pdev->dev, cb);
-		if (skb)
-			dev_consume_skb_any(skb);
+	for (i = 0; i < ring->size; i++) {
+		cb = ring->cbs + i;
+
+		page = bcmgenet_free_rx_cb(cb);
+		if (page)
+			page_pool_put_full_page(ring->page_pool, page, false);
 	}
+
+	/* Pages still held by the stack or XDP targets are released to the
+	 * pool when they are freed, page_pool_destroy() defers accordingly.
+	 */
+	xdp_rxq_info_unreg(&ring->xdp_rxq);
+	page_pool_destroy(ring->page_pool);
+	ring->page_pool = NULL;
+}
+
+static void bcmgenet_free_rx_buffers(struct bcmgenet_priv *priv)
+{
+	int i;
+
+	for (i = 0; i < priv->hw_params->rx_queues; i++)
+		bcmgenet_free_rx_ring_buffers(&priv->rx_rings[i]);
+
+	bcmgenet_free_rx_ring_buffers(&priv->rx_rings[DESC_INDEX]);
 }
 
 static void umac_enable_set(struct bcmgenet_priv *priv, u32 mask, bool enable)
@@ -2632,6 +3045,10 @@ static void bcmgenet_init_rx_coalesce(struct bcmgenet_rx_ring *ring)
 	/* If DIM was enabled, re-apply default parameters */
 	if (dim->use_dim) {
 		moder = net_dim_get_def_rx_moderation(dim->dim.mode);
+		if (ring->rx_coalesce_usecs_high &&
+		    moder.usec > ring->rx_coalesce_usecs_high)
+			moder = net_dim_get_rx_moderation(dim->dim.mode,
+							  dim->dim.profile_ix);
 		usecs = moder.usec;
 		pkts = moder.pkts;
 	}
@@ -2709,6 +3126,8 @@ static int bcmgenet_init_rx_ring(struct bcmgenet_priv *priv,
 
 	ring->priv = priv;
 	ring->index = index;
+	/* Rx queue 0 is ring 16, priority ring n is queue n + 1 */
+	ring->queue = index == DESC_INDEX ? 0 : index + 1;
 	if (index == DESC_INDEX) {
 		ring->int_enable = bcmgenet_rx_ring16_int_enable;
 		ring->int_disable = bcmgenet_rx_ring16_int_disable;
@@ -2723,6 +3142,10 @@ static int bcmgenet_init_rx_ring(struct bcmgenet_priv *priv,
 	ring->cb_ptr = start_ptr;
 	ring->end_ptr = end_ptr - 1;
 
+	ret = bcmgenet_create_page_pool(priv, ring);
+	if (ret)
+		return ret;
+
 	ret = bcmgenet_alloc_rx_buffers(priv, ring);
 	if (ret)
 		return ret;
@@ -3428,6 +3851,7 @@ static int bcmgenet_open(struct net_device *dev)
 
 	/* HFB init */
 	bcmgenet_hfb_init(priv);
+	bcmgenet_hfb_create_steering_filters(priv);
 
 	ret = request_irq(priv->irq0, bcmgenet_isr0, IRQF_SHARED,
 			  dev->name, priv);
@@ -3753,6 +4177,47 @@ static int bcmgenet_change_carrier(struct net_device *dev, bool new_carrier)
 	return 0;
 }
 
+static int bcmgenet_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			      struct netlink_ext_ack *extack)
+{
+	struct bcmgenet_priv *priv = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+	bool reinit;
+	int ret;
+
+	/* Rx pages are mapped for XDP_TX only while a program is attached,
+	 * the page_pools have to be recreated when that changes.
+	 */
+	reinit = netif_running(dev) && !!priv->xdp_prog != !!prog;
+	if (reinit)
+		bcmgenet_close(dev);
+
+	old_prog = xchg(&priv->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (reinit) {
+		ret = bcmgenet_open(dev);
+		if (ret) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "failed to reopen device for XDP");
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int bcmgenet_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return bcmgenet_xdp_setup(dev, xdp->prog, xdp->extack);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 static const struct net_device_ops bcmgenet_netdev_ops = {
 	.ndo_open		= bcmgenet_open,
 	.ndo_stop		= bcmgenet_close,
@@ -3767,6 +4232,8 @@ static const struct net_device_ops bcmgenet_netdev_ops = {
 #endif
 	.ndo_get_stats		= bcmgenet_get_stats,
 	.ndo_change_carrier	= bcmgenet_change_carrier,
+	.ndo_bpf		= bcmgenet_xdp,
+	.ndo_xdp_xmit		= bcmgenet_xdp_xmit,
 };
 
 /* Array of GENET hardware parameters/characteristics */
@@ -3805,8 +4272,8 @@ static struct bcmgenet_hw_params bcmgenet_hw_params[] = {
 	[GENET_V3] = {
 		.tx_queues = 4,
 		.tx_bds_per_q = 32,
-		.rx_queues = 0,
-		.rx_bds_per_q = 0,
+		.rx_queues = 4,
+		.rx_bds_per_q = 32,
 		.bp_in_en_shift = 17,
 		.bp_in_mask = 0x1ffff,
 		.hfb_filter_cnt = 48,
@@ -3824,8 +4291,8 @@ static struct bcmgenet_hw_params bcmgenet_hw_params[] = {
 	[GENET_V4] = {
 		.tx_queues = 4,
 		.tx_bds_per_q = 32,
-		.rx_queues = 0,
-		.rx_bds_per_q = 0,
+		.rx_queues = 4,
+		.rx_bds_per_q = 32,
 		.bp_in_en_shift = 17,
 		.bp_in_mask = 0x1ffff,
 		.hfb_filter_cnt = 48,
@@ -3843,8 +4310,8 @@ static struct bcmgenet_hw_params bcmgenet_hw_params[] = {
 	[GENET_V5] = {
 		.tx_queues = 4,
 		.tx_bds_per_q = 32,
-		.rx_queues = 0,
-		.rx_bds_per_q = 0,
+		.rx_queues = 4,
+		.rx_bds_per_q = 32,
 		.bp_in_en_shift = 17,
 		.bp_in_mask = 0x1ffff,
 		.hfb_filter_cnt = 48,
@@ -4189,6 +4656,13 @@ static int bcmgenet_probe(struct platform_device *pdev)
 	priv->rx_rings[DESC_INDEX].rx_max_coalesced_frames = 1;
 	priv->rx_rings[DESC_INDEX].rx_coalesce_usecs = 50;
 
+	/* The priority rings all interrupt through irq1, run their NAPI
+	 * contexts in kthreads so the scheduler can spread them over the
+	 * CPUs instead of polling every ring from the one taking irq1.
+	 */
+	if (rx_steering && priv->hw_params->rx_queues)
+		dev_set_threaded(dev, true);
+
 	/* libphy will determine the link state */
 	netif_carrier_off(dev);
 
@@ -4301,6 +4775,7 @@ static int bcmgenet_resume(struct device *d)
 	list_for_each_entry(rule, &priv->rxnfc_list, list)
 		if (rule->state != BCMGENET_RXNFC_STATE_UNUSED)
 			bcmgenet_hfb_create_rxnfc_filter(priv, rule);
+	bcmgenet_hfb_create_steering_filters(priv);
 
 	/* Disable RX/TX DMA and flush TX queues */
 	dma_ctrl = bcmgenet_dma_disable(priv, false);
@@ -15,6 +15,7 @@
 #include <linux/phy.h>
 #include <linux/dim.h>
 #include <linux/ethtool.h>
+#include <net/xdp.h>
 
 #include "../unimac.h"
 
@@ -150,6 +151,11 @@ struct bcmgenet_mib_counters {
 	u32	tx_dma_failed;
 	u32	tx_realloc_tsb;
 	u32	tx_realloc_tsb_failed;
+	u32	rx_xdp_drop;
+	u32	rx_xdp_tx;
+	u32	rx_xdp_redirect;
+	u32	tx_xdp_xmit;
+	u32	tx_xdp_xmit_errors;
 };
 
 #define UMAC_MIB_START			0x400
@@ -440,6 +446,8 @@ struct bcmgenet_mib_counters {
 
 struct enet_cb {
 	struct sk_buff      *skb;
+	struct xdp_frame    *xdpf;	/* Tx XDP frame */
+	struct page         *page;	/* Rx page_pool buffer */
 	void __iomem *bd_addr;
 	DEFINE_DMA_UNMAP_ADDR(dma_addr);
 	DEFINE_DMA_UNMAP_LEN(dma_len);
@@ -543,6 +551,7 @@ struct bcmgenet_rx_ring {
 	unsigned long	errors;
 	unsigned long	dropped;
 	unsigned int	index;		/* Rx ring index */
+	unsigned int	queue;		/* queue index */
 	struct enet_cb	*cbs;		/* Rx ring buffer control block */
 	unsigned int	size;		/* Rx ring size */
 	unsigned int	c_index;	/* Rx last consumer index */
@@ -553,9 +562,12 @@ struct bcmgenet_rx_ring {
 	struct bcmgenet_net_dim dim;
 	u32		rx_max_coalesced_frames;
 	u32		rx_coalesce_usecs;
+	u32		rx_coalesce_usecs_high;
 	void (*int_enable)(struct bcmgenet_rx_ring *);
 	void (*int_disable)(struct bcmgenet_rx_ring *);
 	struct bcmgenet_priv *priv;
+	struct page_pool *page_pool;	/* Rx buffer pool */
+	struct xdp_rxq_info xdp_rxq;
 };
 
 enum bcmgenet_rxnfc_state {
@@ -595,6 +607,9 @@ struct bcmgenet_priv {
 
 	struct bcmgenet_rx_ring rx_rings[DESC_INDEX + 1];
 
+	/* XDP program attached to every Rx ring, if any */
+	struct bpf_prog *xdp_prog;
+
 	/* other misc variables */
 	struct bcmgenet_hw_params *hw_params;
 	unsigned autoneg_pause:1;
@@ -180,6 +180,8 @@ int bcmgenet_wol_power_down_cfg(struct bcmgenet_priv *priv,
 	priv->wol_active = 1;
 
 	if (hfb_enable) {
+		/* Only wake filters, Rx steering filters must not wake us */
+		bcmgenet_hfb_reg_writel(priv, 0, HFB_FLT_ENABLE_V3PLUS);
 		bcmgenet_hfb_reg_writel(priv, hfb_enable,
 					HFB_FLT_ENABLE_V3PLUS + 4);
 		hfb_ctrl_reg = RBUF_HFB_EN | RBUF_ACPI_EN;
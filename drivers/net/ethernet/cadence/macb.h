@@ -13,6 +13,7 @@
 #include <linux/net_tstamp.h>
 #include <linux/interrupt.h>
 #include <linux/phy/phy.h>
+#include <net/xdp.h>
 
 #if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) || defined(CONFIG_MACB_USE_HWSTAMP)
 #define MACB_EXT_DESC
@@ -950,6 +951,7 @@ struct gem_tx_ts {
  */
 struct macb_tx_skb {
 	struct sk_buff		*skb;
+	struct xdp_frame	*xdpf;
 	dma_addr_t		mapping;
 	size_t			size;
 	bool			mapped_as_page;
@@ -1243,9 +1245,11 @@ struct macb_queue {
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	void			**rx_buff;
 	void			*rx_buffers;
 	struct napi_struct	napi_rx;
+	struct page_pool	*page_pool;
+	struct xdp_rxq_info	xdp_rxq;
 	struct queue_stats stats;
 
 #ifdef CONFIG_MACB_USE_HWSTAMP
@@ -1274,6 +1278,7 @@ struct macb {
 	void	(*macb_reg_writel)(struct macb *bp, int offset, u32 value);
 
 	size_t			rx_buffer_size;
+	unsigned int		rx_headroom;
 
 	unsigned int		rx_ring_size;
 	unsigned int		tx_ring_size;
@@ -1297,6 +1302,8 @@ struct macb {
 
 	struct macb_or_gem_ops	macbgem_ops;
 
+	struct bpf_prog		*prog;
+
 	struct mii_bus		*mii_bus;
 	struct phylink		*phylink;
 	struct phylink_config	phylink_config;
@@ -39,6 +39,9 @@
 #include <linux/ptp_classify.h>
 #include <linux/reset.h>
 #include <linux/firmware/xlnx-zynqmp.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool.h>
 #include "macb.h"
 
 static unsigned int txdelay = 35;
@@ -1005,6 +1008,11 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb, int budge
 		napi_consume_skb(tx_skb->skb, budget);
 		tx_skb->skb = NULL;
 	}
+
+	if (tx_skb->xdpf) {
+		xdp_return_frame(tx_skb->xdpf);
+		tx_skb->xdpf = NULL;
+	}
 }
 
 static void macb_set_addr(struct macb *bp, struct macb_dma_desc *desc, dma_addr_t addr)
@@ -1091,8 +1099,10 @@ static void macb_tx_error_task(struct work_struct *work)
 		skb = tx_skb->skb;
 
 		if (ctrl & MACB_BIT(TX_USED)) {
-			/* skb is set for the last buffer of the frame */
-			while (!skb) {
+			unsigned int len;
+
+			/* skb or xdpf is set for the last buffer of the frame */
+			while (!skb && !tx_skb->xdpf) {
 				macb_tx_unmap(bp, tx_skb, 0);
 				tail++;
 				tx_skb = macb_tx_skb(queue, tail);
@@ -1103,13 +1113,13 @@ static void macb_tx_error_task(struct work_struct *work)
 			 * since it's the only one written back by the hardware
 			 */
 			if (!(ctrl & MACB_BIT(TX_BUF_EXHAUSTED))) {
-				netdev_vdbg(bp->dev, "txerr skb %u (data %p) TX complete\n",
-					    macb_tx_ring_wrap(bp, tail),
-					    skb->data);
+				len = skb ? skb->len : tx_skb->xdpf->len;
+				netdev_vdbg(bp->dev, "txerr frame %u (len %u) TX complete\n",
+					    macb_tx_ring_wrap(bp, tail), len);
 				bp->dev->stats.tx_packets++;
 				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				bp->dev->stats.tx_bytes += len;
+				queue->stats.tx_bytes += len;
 			}
 		} else {
 			/* "Buffers exhausted mid-frame" errors may only happen
@@ -1198,6 +1208,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 	head = queue->tx_head;
 	for (tail = queue->tx_tail; tail != head && packets < budget; tail++) {
 		struct macb_tx_skb	*tx_skb;
+		struct xdp_frame	*xdpf;
 		struct sk_buff		*skb;
 		struct macb_dma_desc	*desc;
 		u32			ctrl;
@@ -1219,6 +1230,18 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 		for (;; tail++) {
 			tx_skb = macb_tx_skb(queue, tail);
 			skb = tx_skb->skb;
+			xdpf = tx_skb->xdpf;
+
+			/* XDP frames always fit a single descriptor */
+			if (xdpf) {
+				bp->dev->stats.tx_packets++;
+				queue->stats.tx_packets++;
+				bp->dev->stats.tx_bytes += xdpf->len;
+				queue->stats.tx_bytes += xdpf->len;
+				packets++;
+				macb_tx_unmap(bp, tx_skb, budget);
+				break;
+			}
 
 			/* First, update TX stats if needed */
 			if (skb) {
@@ -1262,13 +1285,173 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 	return packets;
 }
 
+static unsigned int gem_rx_truesize(struct macb *bp)
+{
+	return SKB_DATA_ALIGN(bp->rx_headroom + bp->rx_buffer_size) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
+/* Software padding and FCS for XDP frames, see macb_pad_and_fcs() */
+static int macb_xdp_pad_and_fcs(struct macb *bp, struct xdp_frame *xdpf)
+{
+	void *hard_end = (void *)xdpf + xdpf->frame_sz -
+			 SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	int padlen = max_t(int, ETH_ZLEN - xdpf->len, 0);
+	u8 *tail = xdpf->data + xdpf->len;
+	u32 fcs;
+
+	if (!(bp->dev->features & NETIF_F_HW_CSUM))
+		return 0;
+
+	if (tail + padlen + ETH_FCS_LEN > (u8 *)hard_end)
+		return -ENOMEM;
+
+	memset(tail, 0, padlen);
+	xdpf->len += padlen;
+
+	fcs = crc32_le(~0, xdpf->data, xdpf->len);
+	fcs = ~fcs;
+
+	tail += padlen;
+	*tail++ = fcs		& 0xff;
+	*tail++ = (fcs >> 8)	& 0xff;
+	*tail++ = (fcs >> 16)	& 0xff;
+	*tail++ = (fcs >> 24)	& 0xff;
+	xdpf->len += ETH_FCS_LEN;
+
+	return 0;
+}
+
+/* Queue one XDP frame on a TX queue, tx_ptr_lock must be held. Frames
+ * coming from our own RX queues (XDP_TX) reuse the page_pool mapping,
+ * redirected frames are mapped here and unmapped on completion.
+ */
+static int macb_xdp_submit_frame(struct macb *bp, struct macb_queue *queue,
+				struct xdp_frame *xdpf, bool dma_map)
+{
+	struct device *dev = &bp->pdev->dev;
+	struct macb_tx_skb *tx_skb;
+	struct macb_dma_desc *desc;
+	unsigned int entry;
+	dma_addr_t mapping;
+	struct page *page;
+	u32 ctrl;
+
+	/* Also covers macb_tx_error_task() reinitializing the ring */
+	if (__netif_subqueue_stopped(bp->dev, queue - bp->queues) ||
+	    CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
+		return -EBUSY;
+
+	if (xdpf->len > bp->max_tx_length)
+		return -EINVAL;
+
+	if (macb_xdp_pad_and_fcs(bp, xdpf))
+		return -ENOMEM;
+
+	if (dma_map) {
+		mapping = dma_map_single(dev, xdpf->data, xdpf->len,
+					 DMA_TO_DEVICE);
+		if (dma_mapping_error(dev, mapping))
+			return -ENOMEM;
+	} else {
+		page = virt_to_head_page(xdpf->data);
+		mapping = page_pool_get_dma_addr(page) +
+			  (xdpf->data - page_address(page));
+		dma_sync_single_for_device(dev, mapping, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+	}
+
+	entry = macb_tx_ring_wrap(bp, queue->tx_head);
+	tx_skb = &queue->tx_skb[entry];
+	tx_skb->skb = NULL;
+	tx_skb->xdpf = xdpf;
+	tx_skb->mapping = dma_map ? mapping : 0;
+	tx_skb->size = xdpf->len;
+	tx_skb->mapped_as_page = false;
+
+	/* Set end of TX queue before handing the frame to the hardware */
+	desc = macb_tx_desc(queue, macb_tx_ring_wrap(bp, queue->tx_head + 1));
+	desc->ctrl = MACB_BIT(TX_USED);
+
+	ctrl = xdpf->len | MACB_BIT(TX_LAST);
+	if (unlikely(entry == (bp->tx_ring_size - 1)))
+		ctrl |= MACB_BIT(TX_WRAP);
+	if (bp->dev->features & NETIF_F_HW_CSUM)
+		ctrl |= MACB_BIT(TX_NOCRC);
+
+	desc = macb_tx_desc(queue, entry);
+	macb_set_addr(bp, desc, mapping);
+	/* desc->addr must be visible to hardware before clearing
+	 * 'TX_USED' bit in desc->ctrl.
+	 */
+	wmb();
+	desc->ctrl = ctrl;
+
+	queue->tx_head++;
+
+	return 0;
+}
+
+static void macb_xdp_tx_start(struct macb *bp, struct macb_queue *queue)
+{
+	u16 queue_index = queue - bp->queues;
+	unsigned long flags;
+
+	/* Make newly initialized descriptors visible to hardware */
+	wmb();
+
+	spin_lock_irqsave(&bp->lock, flags);
+
+	/* TSTART write might get dropped, so make the IRQ retrigger a buffer read */
+	if (macb_readl(bp, TSR) & MACB_BIT(TGO))
+		queue->tx_pending = 1;
+
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	spin_unlock_irqrestore(&bp->lock, flags);
+
+	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
+		netif_stop_subqueue(bp->dev, queue_index);
+}
+
+static int macb_xdp_xmit(struct net_device *dev, int num_frames,
+			struct xdp_frame **frames, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+	int nxmit = 0;
+	int i;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		return -ENETDOWN;
+
+	queue = &bp->queues[smp_processor_id() % bp->num_queues];
+
+	spin_lock(&queue->tx_ptr_lock);
+	for (i = 0; i < num_frames; i++) {
+		if (macb_xdp_submit_frame(bp, queue, frames[i], true))
+			break;
+		nxmit++;
+	}
+
+	if (nxmit && (flags & XDP_XMIT_FLUSH))
+		macb_xdp_tx_start(bp, queue);
+	spin_unlock(&queue->tx_ptr_lock);
+
+	return nxmit;
+}
+
 static void gem_rx_refill(struct macb_queue *queue)
 {
 	unsigned int		entry;
-	struct sk_buff		*skb;
 	dma_addr_t		paddr;
 	struct macb *bp = queue->bp;
 	struct macb_dma_desc *desc;
+	unsigned int truesize = gem_rx_truesize(bp);
+	unsigned int offset;
+	struct page *page;
 
 	while (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
 			bp->rx_ring_size) > 0) {
@@ -1279,25 +1462,26 @@ static void gem_rx_refill(struct macb_queue *queue)
 
 		desc = macb_rx_desc(queue, entry);
 
-		if (!queue->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		if (!queue->rx_buff[entry]) {
+			/* allocate a page_pool fragment for this free entry */
+			page = page_pool_dev_alloc_frag(queue->page_pool,
+							&offset, truesize);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
+					   "Unable to allocate rx buffer\n");
 				break;
 			}
 
-			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
-			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
-				break;
-			}
+			/* now fill corresponding descriptor entry, recycled
+			 * fragments may hold stale CPU cache lines
+			 */
+			paddr = page_pool_get_dma_addr(page) + offset +
+				bp->rx_headroom;
+			dma_sync_single_for_device(&bp->pdev->dev, paddr,
+						   bp->rx_buffer_size,
+						   page_pool_get_dma_dir(queue->page_pool));
 
-			queue->rx_skbuff[entry] = skb;
+			queue->rx_buff[entry] = page_address(page) + offset;
 
 			if (entry == bp->rx_ring_size - 1)
 				paddr |= MACB_BIT(RX_WRAP);
@@ -1307,9 +1491,6 @@ static void gem_rx_refill(struct macb_queue *queue)
 			 */
 			dma_wmb();
 			macb_set_addr(bp, desc, paddr);
-
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
 		} else {
 			desc->ctrl = 0;
 			dma_wmb();
@@ -1346,17 +1527,78 @@ static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 	 */
 }
 
+#define GEM_XDP_PASS		0
+#define GEM_XDP_CONSUMED	BIT(0)
+#define GEM_XDP_TX		BIT(1)
+#define GEM_XDP_REDIR		BIT(2)
+
+static unsigned int gem_run_xdp(struct macb_queue *queue,
+				struct bpf_prog *prog, struct xdp_buff *xdp)
+{
+	struct macb *bp = queue->bp;
+	struct xdp_frame *xdpf;
+	unsigned int act;
+	int err;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+
+	switch (act) {
+	case XDP_PASS:
+		return GEM_XDP_PASS;
+	case XDP_TX:
+		xdpf = xdp_convert_buff_to_frame(xdp);
+		if (unlikely(!xdpf))
+			goto out_failure;
+
+		spin_lock(&queue->tx_ptr_lock);
+		err = macb_xdp_submit_frame(bp, queue, xdpf, false);
+		spin_unlock(&queue->tx_ptr_lock);
+		if (unlikely(err))
+			goto out_failure;
+
+		return GEM_XDP_TX;
+	case XDP_REDIRECT:
+		err = xdp_do_redirect(bp->dev, xdp, prog);
+		if (unlikely(err))
+			goto out_failure;
+
+		return GEM_XDP_REDIR;
+	default:
+		bpf_warn_invalid_xdp_action(bp->dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(bp->dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	page_pool_recycle_direct(queue->page_pool,
+				 virt_to_head_page(xdp->data_hard_start));
+
+	return GEM_XDP_CONSUMED;
+}
+
 static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		  int budget)
 {
 	struct macb *bp = queue->bp;
+	unsigned int truesize = gem_rx_truesize(bp);
+	struct bpf_prog *prog = READ_ONCE(bp->prog);
+	unsigned int		xdp_status = 0;
 	unsigned int		len;
 	unsigned int		entry;
 	struct sk_buff		*skb;
 	struct macb_dma_desc	*desc;
+	struct xdp_buff		xdp;
 	int			count = 0;
+	void			*va;
+
+	xdp_init_buff(&xdp, truesize, &queue->xdp_rxq);
 
 	while (count < budget) {
+		unsigned int act;
 		u32 ctrl;
 		dma_addr_t addr;
 		bool rxused;
@@ -1388,8 +1630,8 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			queue->stats.rx_dropped++;
 			break;
 		}
-		skb = queue->rx_skbuff[entry];
-		if (unlikely(!skb)) {
+		va = queue->rx_buff[entry];
+		if (unlikely(!va)) {
 			netdev_err(bp->dev,
 				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
@@ -1397,19 +1639,48 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			break;
 		}
 		/* now everything is ready for receiving packet */
-		queue->rx_skbuff[entry] = NULL;
+		queue->rx_buff[entry] = NULL;
 		len = ctrl & bp->rx_frm_len_mask;
 
 		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
 
-		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
+		dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+					len + NET_IP_ALIGN,
+					page_pool_get_dma_dir(queue->page_pool));
+
+		xdp_prepare_buff(&xdp, va, bp->rx_headroom + NET_IP_ALIGN,
+				 len, false);
+
+		if (prog) {
+			act = gem_run_xdp(queue, prog, &xdp);
+			if (act != GEM_XDP_PASS) {
+				xdp_status |= act;
+				bp->dev->stats.rx_packets++;
+				queue->stats.rx_packets++;
+				bp->dev->stats.rx_bytes += len;
+				queue->stats.rx_bytes += len;
+				continue;
+			}
+		}
+
+		skb = napi_build_skb(va, truesize);
+		if (unlikely(!skb)) {
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			page_pool_recycle_direct(queue->page_pool,
+						 virt_to_head_page(va));
+			continue;
+		}
+
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		__skb_put(skb, xdp.data_end - xdp.data);
 
 		skb->protocol = eth_type_trans(skb, bp->dev);
 		skb_checksum_none_assert(skb);
+		/* The program may have rewritten the frame */
 		if (bp->dev->features & NETIF_F_RXCSUM &&
-		    !(bp->dev->flags & IFF_PROMISC) &&
+		    !(bp->dev->flags & IFF_PROMISC) && !prog &&
 		    GEM_BFEXT(RX_CSUM, ctrl) & GEM_RX_CSUM_CHECKED_MASK)
 			skb->ip_summed = CHECKSUM_UNNECESSARY;
 
@@ -1432,6 +1703,15 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		napi_gro_receive(napi, skb);
 	}
 
+	if (xdp_status & GEM_XDP_TX) {
+		spin_lock(&queue->tx_ptr_lock);
+		macb_xdp_tx_start(bp, queue);
+		spin_unlock(&queue->tx_ptr_lock);
+	}
+
+	if (xdp_status & GEM_XDP_REDIR)
+		xdp_do_flush();
+
 	gem_rx_refill(queue);
 
 	return count;
@@ -2386,6 +2666,9 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 			bp->rx_buffer_size =
 				roundup(bp->rx_buffer_size, RX_BUFFER_MULTIPLE);
 		}
+
+		/* Only reserve the full XDP headroom when it can be used */
+		bp->rx_headroom = bp->prog ? XDP_PACKET_HEADROOM : NET_SKB_PAD;
 	}
 
 	netdev_dbg(bp->dev, "mtu [%u] rx_buffer_size [%zu]\n",
@@ -2394,34 +2677,33 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
 	struct macb_queue *queue;
-	dma_addr_t		addr;
 	unsigned int q;
+	void *va;
 	int i;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		if (!queue->rx_skbuff)
+		if (!queue->rx_buff)
 			continue;
 
 		for (i = 0; i < bp->rx_ring_size; i++) {
-			skb = queue->rx_skbuff[i];
+			va = queue->rx_buff[i];
 
-			if (!skb)
+			if (!va)
 				continue;
 
-			desc = macb_rx_desc(queue, i);
-			addr = macb_get_addr(bp, desc);
-
-			dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-					DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			skb = NULL;
+			page_pool_put_full_page(queue->page_pool,
+						virt_to_head_page(va), false);
 		}
 
-		kfree(queue->rx_skbuff);
-		queue->rx_skbuff = NULL;
+		kfree(queue->rx_buff);
+		queue->rx_buff = NULL;
+
+		if (queue->page_pool) {
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+			page_pool_destroy(queue->page_pool);
+			queue->page_pool = NULL;
+		}
 	}
 }
 
@@ -2463,6 +2745,46 @@ static void macb_free_consistent(struct macb *bp)
 	}
 }
 
+static int gem_create_page_pool(struct macb *bp, struct macb_queue *queue)
+{
+	struct page_pool_params pp_params = {
+		.order = get_order(gem_rx_truesize(bp)),
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_PAGE_FRAG,
+		.pool_size = bp->rx_ring_size,
+		.nid = NUMA_NO_NODE,
+		.dev = &bp->pdev->dev,
+		/* XDP_TX sends the RX buffers back out without remapping */
+		.dma_dir = bp->prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE,
+	};
+	int err;
+
+	queue->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(queue->page_pool)) {
+		err = PTR_ERR(queue->page_pool);
+		queue->page_pool = NULL;
+		return err;
+	}
+
+	err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, queue - bp->queues,
+			       queue->napi_rx.napi_id);
+	if (err)
+		goto err_destroy_pool;
+
+	err = xdp_rxq_info_reg_mem_model(&queue->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					 queue->page_pool);
+	if (err)
+		goto err_unreg_rxq;
+
+	return 0;
+
+err_unreg_rxq:
+	xdp_rxq_info_unreg(&queue->xdp_rxq);
+err_destroy_pool:
+	page_pool_destroy(queue->page_pool);
+	queue->page_pool = NULL;
+	return err;
+}
+
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
 	struct macb_queue *queue;
@@ -2470,14 +2792,17 @@ static int gem_alloc_rx_buffers(struct macb *bp)
 	int size;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		size = bp->rx_ring_size * sizeof(struct sk_buff *);
-		queue->rx_skbuff = kzalloc(size, GFP_KERNEL);
-		if (!queue->rx_skbuff)
+		size = bp->rx_ring_size * sizeof(void *);
+		queue->rx_buff = kzalloc(size, GFP_KERNEL);
+		if (!queue->rx_buff)
 			return -ENOMEM;
 		else
 			netdev_dbg(bp->dev,
-				   "Allocated %d RX struct sk_buff entries at %p\n",
-				   bp->rx_ring_size, queue->rx_skbuff);
+				   "Allocated %d RX buffer entries at %p\n",
+				   bp->rx_ring_size, queue->rx_buff);
+
+		if (gem_create_page_pool(bp, queue))
+			return -ENOMEM;
 	}
 	return 0;
 }
@@ -2518,7 +2843,7 @@ static int macb_alloc_consistent(struct macb *bp)
 			   queue->tx_ring);
 
 		size = bp->tx_ring_size * sizeof(struct macb_tx_skb);
-		queue->tx_skb = kmalloc(size, GFP_KERNEL);
+		queue->tx_skb = kzalloc(size, GFP_KERNEL);
 		if (!queue->tx_skb)
 			goto out_err;
 
@@ -3008,16 +3333,84 @@ static int macb_close(struct net_device *dev)
 	return 0;
 }
 
+/* XDP needs each frame in a single page, with the XDP headroom in front */
+static bool macb_xdp_mtu_ok(int mtu)
+{
+	size_t bufsz = roundup(mtu + ETH_HLEN + ETH_FCS_LEN + NET_IP_ALIGN,
+			       RX_BUFFER_MULTIPLE);
+
+	return SKB_DATA_ALIGN(XDP_PACKET_HEADROOM + bufsz) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) <= PAGE_SIZE;
+}
+
 static int macb_change_mtu(struct net_device *dev, int new_mtu)
 {
+	struct macb *bp = netdev_priv(dev);
+
 	if (netif_running(dev))
 		return -EBUSY;
 
+	if (bp->prog && !macb_xdp_mtu_ok(new_mtu)) {
+		netdev_err(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	dev->mtu = new_mtu;
 
 	return 0;
 }
 
+static int macb_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			  struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+	bool reinit;
+	int err;
+
+	if (prog && !macb_is_gem(bp)) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP is only supported on GEM");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && !macb_xdp_mtu_ok(dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* The RX headroom and DMA direction depend on whether a program is
+	 * attached, the buffers have to be reallocated when that changes.
+	 */
+	reinit = netif_running(dev) && !!bp->prog != !!prog;
+	if (reinit)
+		macb_close(dev);
+
+	old_prog = xchg(&bp->prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (reinit) {
+		err = macb_open(dev);
+		if (err) {
+			NL_SET_ERR_MSG_MOD(extack,
+					   "failed to reopen device for XDP");
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static int macb_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return macb_xdp_setup(dev, xdp->prog, xdp->extack);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 static void gem_update_stats(struct macb *bp)
 {
 	struct macb_queue *queue;
@@ -3913,6 +4306,8 @@ static const struct net_device_ops macb_netdev_ops = {
 #endif
 	.ndo_set_features	= macb_set_features,
 	.ndo_features_check	= macb_features_check,
+	.ndo_bpf		= macb_xdp,
+	.ndo_xdp_xmit		= macb_xdp_xmit,
 };
 
 /* Configure peripheral capabilities according to device tree
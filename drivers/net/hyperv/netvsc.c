@@ -1336,6 +1336,9 @@ int netvsc_send(struct net_device *ndev,
 	return ret;
 }
 
+/* Receive completions sent to the host with one ring buffer update */
+#define NETVSC_RECV_COMP_BATCH	8
+
 /* Send pending recv completions */
 static int send_recv_completions(struct net_device *ndev,
 				 struct netvsc_device *nvdev,
@@ -1346,27 +1349,42 @@ static int send_recv_completions(struct net_device *ndev,
 		struct nvsp_message_header hdr;
 		u32 status;
 	}  __packed;
-	struct recv_comp_msg msg = {
-		.hdr.msg_type = NVSP_MSG1_TYPE_SEND_RNDIS_PKT_COMPLETE,
-	};
+	struct recv_comp_msg msgs[NETVSC_RECV_COMP_BATCH];
+	struct vmbus_batch_packet pkts[NETVSC_RECV_COMP_BATCH];
+	u32 slot, nr, sent;
 	int ret;
 
 	while (mrc->first != mrc->next) {
-		const struct recv_comp_data *rcd
-			= mrc->slots + mrc->first;
+		for (nr = 0, slot = mrc->first;
+		     nr < NETVSC_RECV_COMP_BATCH && slot != mrc->next; nr++) {
+			const struct recv_comp_data *rcd = mrc->slots + slot;
+
+			msgs[nr].hdr.msg_type =
+				NVSP_MSG1_TYPE_SEND_RNDIS_PKT_COMPLETE;
+			msgs[nr].status = rcd->status;
+			pkts[nr].buffer = &msgs[nr];
+			pkts[nr].bufferlen = sizeof(msgs[nr]);
+			pkts[nr].requestid = rcd->tid;
+			pkts[nr].type = VM_PKT_COMP;
+			pkts[nr].flags = 0;
+
+			if (++slot == nvdev->recv_completion_cnt)
+				slot = 0;
+		}
+
+		ret = vmbus_sendpacket_batch(nvchan->channel, pkts, nr, &sent);
+
+		/* whatever made it into the ring is done, even on a short write */
+		mrc->first += sent;
+		if (mrc->first >= nvdev->recv_completion_cnt)
+			mrc->first -= nvdev->recv_completion_cnt;
 
-		msg.status = rcd->status;
-		ret = vmbus_sendpacket(nvchan->channel, &msg, sizeof(msg),
-				       rcd->tid, VM_PKT_COMP, 0);
 		if (unlikely(ret)) {
 			struct net_device_context *ndev_ctx = netdev_priv(ndev);
 
 			++ndev_ctx->eth_stats.rx_comp_busy;
 			return ret;
 		}
-
-		if (++mrc->first == nvdev->recv_completion_cnt)
-			mrc->first = 0;
 	}
 
 	/* receive completion ring has been emptied */
@@ -15,6 +15,7 @@
 #include <linux/igmp.h>
 #include <linux/if_ether.h>
 #include <linux/ethtool.h>
+#include <linux/proc_fs.h>
 #include <net/arp.h>
 #include <net/ndisc.h>
 #include <net/gro.h>
@@ -455,25 +456,89 @@ static inline struct hlist_head *vxlan_fdb_head(struct vxlan_dev *vxlan,
 	return &vxlan->fdb_head[fdb_head_index(vxlan, mac, vni)];
 }
 
+/* Lookups go through one resizable table per namespace, keyed by the
+ * owning device as well as MAC and VNI. The per-device fdb_head chains
+ * are only walked to dump, age and flush a device's entries.
+ */
+struct vxlan_fdb_key {
+	const struct vxlan_dev *vxlan;
+	__be32 vni;
+	u8 eth_addr[ETH_ALEN];
+};
+
+/* Only devices in metadata mode tell entries apart by VNI */
+static __be32 vxlan_fdb_key_vni(const struct vxlan_dev *vxlan, __be32 vni)
+{
+	return vxlan->cfg.flags & VXLAN_F_COLLECT_METADATA ? vni : 0;
+}
+
+static void vxlan_fdb_key_init(struct vxlan_fdb_key *key,
+			       const struct vxlan_dev *vxlan,
+			       const u8 *mac, __be32 vni)
+{
+	key->vxlan = vxlan;
+	key->vni = vxlan_fdb_key_vni(vxlan, vni);
+	memcpy(key->eth_addr, mac, ETH_ALEN);
+}
+
+static u32 __vxlan_fdb_hash(const struct vxlan_dev *vxlan, const u8 *mac,
+			    __be32 vni, u32 seed)
+{
+	u32 a = get_unaligned((u32 *)mac);
+	u32 b = get_unaligned((u16 *)(mac + 4)) ^ (__force u32)vni;
+
+	return jhash_3words(a, b, hash_ptr(vxlan, 32), seed);
+}
+
+static u32 vxlan_fdb_key_hashfn(const void *data, u32 len, u32 seed)
+{
+	const struct vxlan_fdb_key *key = data;
+
+	return __vxlan_fdb_hash(key->vxlan, key->eth_addr, key->vni, seed);
+}
+
+static u32 vxlan_fdb_obj_hashfn(const void *data, u32 len, u32 seed)
+{
+	const struct vxlan_fdb *f = data;
+	const struct vxlan_dev *vxlan = rcu_dereference_raw(f->vdev);
+
+	return __vxlan_fdb_hash(vxlan, f->eth_addr,
+				vxlan_fdb_key_vni(vxlan, f->vni), seed);
+}
+
+static int vxlan_fdb_key_cmp(const struct vxlan_fdb_key *key,
+			     const struct vxlan_fdb *f)
+{
+	return rcu_access_pointer(f->vdev) != key->vxlan ||
+	       vxlan_fdb_key_vni(key->vxlan, f->vni) != key->vni ||
+	       !ether_addr_equal(f->eth_addr, key->eth_addr);
+}
+
+static int vxlan_fdb_obj_cmpfn(struct rhashtable_compare_arg *arg,
+			       const void *obj)
+{
+	return vxlan_fdb_key_cmp(arg->key, obj);
+}
+
+static const struct rhashtable_params vxlan_fdb_rht_params = {
+	.head_offset = offsetof(struct vxlan_fdb, rhnode),
+	.key_len = sizeof(struct vxlan_fdb_key),
+	.hashfn = vxlan_fdb_key_hashfn,
+	.obj_hashfn = vxlan_fdb_obj_hashfn,
+	.obj_cmpfn = vxlan_fdb_obj_cmpfn,
+	.automatic_shrinking = true,
+};
+
 /* Look up Ethernet address in forwarding table */
 static struct vxlan_fdb *__vxlan_find_mac(struct vxlan_dev *vxlan,
 					  const u8 *mac, __be32 vni)
 {
-	struct hlist_head *head = vxlan_fdb_head(vxlan, mac, vni);
-	struct vxlan_fdb *f;
-
-	hlist_for_each_entry_rcu(f, head, hlist) {
-		if (ether_addr_equal(mac, f->eth_addr)) {
-			if (vxlan->cfg.flags & VXLAN_F_COLLECT_METADATA) {
-				if (vni == f->vni)
-					return f;
-			} else {
-				return f;
-			}
-		}
-	}
+	struct vxlan_net *vn = net_generic(vxlan->net, vxlan_net_id);
+	struct vxlan_fdb_key key;
 
-	return NULL;
+	vxlan_fdb_key_init(&key, vxlan, mac, vni);
+	return rhashtable_lookup_fast(&vn->fdb_hash_tbl, &key,
+				      vxlan_fdb_rht_params);
 }
 
 static struct vxlan_fdb *vxlan_find_mac(struct vxlan_dev *vxlan,
@@ -488,6 +553,50 @@ static struct vxlan_fdb *vxlan_find_mac(struct vxlan_dev *vxlan,
 	return f;
 }
 
+/* Transmit side lookup. Hot destinations are served from a small per-cpu
+ * cache of recent hits, which is only trusted as long as no FDB entry has
+ * been removed from the namespace since it was filled. Called with bottom
+ * halves disabled.
+ */
+static struct vxlan_fdb *vxlan_find_mac_tx(struct vxlan_dev *vxlan,
+					   const u8 *mac, __be32 vni)
+{
+	struct vxlan_net *vn = net_generic(vxlan->net, vxlan_net_id);
+	struct vxlan_fdb_pcpu *pcpu = this_cpu_ptr(vn->fdb_pcpu);
+	struct vxlan_fdb_key key;
+	struct vxlan_fdb *f;
+	unsigned long gen;
+	u32 idx;
+
+	vxlan_fdb_key_init(&key, vxlan, mac, vni);
+	idx = vxlan_fdb_key_hashfn(&key, sizeof(key), 0) &
+	      (VXLAN_FDB_CACHE_SIZE - 1);
+
+	gen = atomic_long_read(&vn->fdb_gen);
+	/* pairs with smp_mb__before_atomic() in vxlan_fdb_destroy() */
+	smp_rmb();
+
+	pcpu->lookups++;
+	f = pcpu->cache[idx].fdb;
+	if (f && pcpu->cache[idx].gen == gen && !vxlan_fdb_key_cmp(&key, f)) {
+		pcpu->cache_hits++;
+	} else {
+		f = rhashtable_lookup_fast(&vn->fdb_hash_tbl, &key,
+					   vxlan_fdb_rht_params);
+		if (!f) {
+			pcpu->misses++;
+			return NULL;
+		}
+		pcpu->cache[idx].fdb = f;
+		pcpu->cache[idx].gen = gen;
+	}
+
+	if (f->used != jiffies)
+		f->used = jiffies;
+
+	return f;
+}
+
 /* caller should hold vxlan->hash_lock */
 static struct vxlan_rdst *vxlan_fdb_find_rdst(struct vxlan_fdb *f,
 					      union vxlan_addr *ip, __be16 port,
@@ -859,12 +968,21 @@ static struct vxlan_fdb *vxlan_fdb_alloc(struct vxlan_dev *vxlan, const u8 *mac,
 	return f;
 }
 
-static void vxlan_fdb_insert(struct vxlan_dev *vxlan, const u8 *mac,
-			     __be32 src_vni, struct vxlan_fdb *f)
+static int vxlan_fdb_insert(struct vxlan_dev *vxlan, const u8 *mac,
+			    __be32 src_vni, struct vxlan_fdb *f)
 {
+	struct vxlan_net *vn = net_generic(vxlan->net, vxlan_net_id);
+	int err;
+
+	err = rhashtable_insert_fast(&vn->fdb_hash_tbl, &f->rhnode,
+				     vxlan_fdb_rht_params);
+	if (err)
+		return err;
+
 	++vxlan->addrcnt;
 	hlist_add_head_rcu(&f->hlist,
 			   vxlan_fdb_head(vxlan, mac, src_vni));
+	return 0;
 }
 
 static int vxlan_fdb_nh_update(struct vxlan_dev *vxlan, struct vxlan_fdb *fdb,
@@ -991,9 +1109,17 @@ static void vxlan_fdb_free(struct rcu_head *head)
 	__vxlan_fdb_free(f);
 }
 
+/* Free an entry that vxlan_fdb_insert() failed to link */
+static void vxlan_fdb_discard(struct vxlan_fdb *f)
+{
+	list_del_rcu(&f->nh_list);
+	call_rcu(&f->rcu, vxlan_fdb_free);
+}
+
 static void vxlan_fdb_destroy(struct vxlan_dev *vxlan, struct vxlan_fdb *f,
 			      bool do_notify, bool swdev_notify)
 {
+	struct vxlan_net *vn = net_generic(vxlan->net, vxlan_net_id);
 	struct vxlan_rdst *rd;
 
 	netdev_dbg(vxlan->dev, "delete %pM\n", f->eth_addr);
@@ -1010,6 +1136,11 @@ static void vxlan_fdb_destroy(struct vxlan_dev *vxlan, struct vxlan_fdb *f,
 	}
 
 	hlist_del_rcu(&f->hlist);
+	rhashtable_remove_fast(&vn->fdb_hash_tbl, &f->rhnode,
+			       vxlan_fdb_rht_params);
+	/* invalidate per-cpu cache entries that may still point to @f */
+	smp_mb__before_atomic();
+	atomic_long_inc(&vn->fdb_gen);
 	list_del_rcu(&f->nh_list);
 	call_rcu(&f->rcu, vxlan_fdb_free);
 }
@@ -1145,7 +1276,12 @@ static int vxlan_fdb_update_create(struct vxlan_dev *vxlan,
 	if (rc < 0)
 		return rc;
 
-	vxlan_fdb_insert(vxlan, mac, src_vni, f);
+	rc = vxlan_fdb_insert(vxlan, mac, src_vni, f);
+	if (rc) {
+		vxlan_fdb_discard(f);
+		return rc;
+	}
+
 	rc = vxlan_fdb_notify(vxlan, f, first_remote_rtnl(f), RTM_NEWNEIGH,
 			      swdev_notify, extack);
 	if (rc)
@@ -2861,7 +2997,7 @@ static netdev_tx_t vxlan_xmit(struct sk_buff *skb, struct net_device *dev)
 	}
 
 	eth = eth_hdr(skb);
-	f = vxlan_find_mac(vxlan, eth->h_dest, vni);
+	f = vxlan_find_mac_tx(vxlan, eth->h_dest, vni);
 	did_rsc = false;
 
 	if (f && (f->flags & NTF_ROUTER) && (vxlan->cfg.flags & VXLAN_F_RSC) &&
@@ -2869,11 +3005,11 @@ static netdev_tx_t vxlan_xmit(struct sk_buff *skb, struct net_device *dev)
 	     ntohs(eth->h_proto) == ETH_P_IPV6)) {
 		did_rsc = route_shortcircuit(dev, skb);
 		if (did_rsc)
-			f = vxlan_find_mac(vxlan, eth->h_dest, vni);
+			f = vxlan_find_mac_tx(vxlan, eth->h_dest, vni);
 	}
 
 	if (f == NULL) {
-		f = vxlan_find_mac(vxlan, all_zeros_mac, vni);
+		f = vxlan_find_mac_tx(vxlan, all_zeros_mac, vni);
 		if (f == NULL) {
 			if ((vxlan->cfg.flags & VXLAN_F_L2MISS) &&
 			    !is_multicast_ether_addr(eth->h_dest))
@@ -3876,7 +4012,14 @@ static int __vxlan_dev_create(struct net *net, struct net_device *dev,
 		goto unlink;
 
 	if (f) {
-		vxlan_fdb_insert(vxlan, all_zeros_mac, dst->remote_vni, f);
+		err = vxlan_fdb_insert(vxlan, all_zeros_mac, dst->remote_vni,
+				       f);
+		if (err) {
+			vxlan_fdb_discard(f);
+			if (remote_dev)
+				netdev_upper_dev_unlink(remote_dev, dev);
+			goto unregister;
+		}
 
 		/* notify default fdb entry */
 		err = vxlan_fdb_notify(vxlan, f, first_remote_rtnl(f),
@@ -4712,10 +4855,56 @@ static int vxlan_nexthop_event(struct notifier_block *nb,
 	return NOTIFY_DONE;
 }
 
+#ifdef CONFIG_PROC_FS
+/* /proc/net/vxlan_fdb: FDB table occupancy, chain depth of the current
+ * bucket array and transmit lookup counters of the namespace.
+ */
+static int vxlan_fdb_stats_show(struct seq_file *seq, void *v)
+{
+	struct vxlan_net *vn = net_generic(seq_file_single_net(seq),
+					   vxlan_net_id);
+	unsigned long lookups = 0, cache_hits = 0, misses = 0;
+	unsigned int i, used = 0, max_depth = 0;
+	const struct bucket_table *tbl;
+	struct rhash_head *pos;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct vxlan_fdb_pcpu *pcpu = per_cpu_ptr(vn->fdb_pcpu,
+								cpu);
+
+		lookups += READ_ONCE(pcpu->lookups);
+		cache_hits += READ_ONCE(pcpu->cache_hits);
+		misses += READ_ONCE(pcpu->misses);
+	}
+
+	rcu_read_lock();
+	tbl = rht_dereference_rcu(vn->fdb_hash_tbl.tbl, &vn->fdb_hash_tbl);
+	for (i = 0; i < tbl->size; i++) {
+		unsigned int depth = 0;
+
+		rht_for_each_rcu(pos, tbl, i)
+			depth++;
+		if (depth)
+			used++;
+		max_depth = max(max_depth, depth);
+	}
+	seq_printf(seq, "entries %u buckets %u used %u max_depth %u\n",
+		   atomic_read(&vn->fdb_hash_tbl.nelems), tbl->size, used,
+		   max_depth);
+	rcu_read_unlock();
+
+	seq_printf(seq, "lookups %lu cache_hits %lu misses %lu\n",
+		   lookups, cache_hits, misses);
+	return 0;
+}
+#endif
+
 static __net_init int vxlan_init_net(struct net *net)
 {
 	struct vxlan_net *vn = net_generic(net, vxlan_net_id);
 	unsigned int h;
+	int err;
 
 	INIT_LIST_HEAD(&vn->vxlan_list);
 	spin_lock_init(&vn->sock_lock);
@@ -4724,8 +4913,41 @@ static __net_init int vxlan_init_net(struct net *net)
 	for (h = 0; h < PORT_HASH_SIZE; ++h)
 		INIT_HLIST_HEAD(&vn->sock_list[h]);
 
-	return register_nexthop_notifier(net, &vn->nexthop_notifier_block,
-					 NULL);
+	err = rhashtable_init(&vn->fdb_hash_tbl, &vxlan_fdb_rht_params);
+	if (err)
+		return err;
+
+	atomic_long_set(&vn->fdb_gen, 0);
+	vn->fdb_pcpu = alloc_percpu(struct vxlan_fdb_pcpu);
+	if (!vn->fdb_pcpu) {
+		err = -ENOMEM;
+		goto err_destroy_fdb;
+	}
+
+#ifdef CONFIG_PROC_FS
+	if (!proc_create_net_single("vxlan_fdb", 0444, net->proc_net,
+				    vxlan_fdb_stats_show, NULL)) {
+		err = -ENOMEM;
+		goto err_free_pcpu;
+	}
+#endif
+
+	err = register_nexthop_notifier(net, &vn->nexthop_notifier_block,
+					NULL);
+	if (err)
+		goto err_remove_proc;
+
+	return 0;
+
+err_remove_proc:
+	remove_proc_entry("vxlan_fdb", net->proc_net);
+#ifdef CONFIG_PROC_FS
+err_free_pcpu:
+#endif
+	free_percpu(vn->fdb_pcpu);
+err_destroy_fdb:
+	rhashtable_destroy(&vn->fdb_hash_tbl);
+	return err;
 }
 
 static void vxlan_destroy_tunnels(struct net *net, struct list_head *head)
@@ -4758,6 +4980,7 @@ static void __net_exit vxlan_exit_batch_net(struct list_head *net_list)
 		struct vxlan_net *vn = net_generic(net, vxlan_net_id);
 
 		unregister_nexthop_notifier(net, &vn->nexthop_notifier_block);
+		remove_proc_entry("vxlan_fdb", net->proc_net);
 	}
 	rtnl_lock();
 	list_for_each_entry(net, net_list, exit_list)
@@ -4771,6 +4994,9 @@ static void __net_exit vxlan_exit_batch_net(struct list_head *net_list)
 
 		for (h = 0; h < PORT_HASH_SIZE; ++h)
 			WARN_ON_ONCE(!hlist_empty(&vn->sock_list[h]));
+
+		rhashtable_destroy(&vn->fdb_hash_tbl);
+		free_percpu(vn->fdb_pcpu);
 	}
 }
 
@@ -16,17 +16,34 @@ extern const struct rhashtable_params vxlan_vni_rht_params;
 #define PORT_HASH_BITS	8
 #define PORT_HASH_SIZE  (1 << PORT_HASH_BITS)
 
+#define VXLAN_FDB_CACHE_SIZE	64
+
+/* per-cpu transmit side FDB lookup cache and statistics */
+struct vxlan_fdb_pcpu {
+	struct {
+		struct vxlan_fdb *fdb;
+		unsigned long	  gen;	/* vxlan_net.fdb_gen when cached */
+	} cache[VXLAN_FDB_CACHE_SIZE];
+	unsigned long	  lookups;
+	unsigned long	  cache_hits;
+	unsigned long	  misses;
+};
+
 /* per-network namespace private data for this module */
 struct vxlan_net {
 	struct list_head  vxlan_list;
 	struct hlist_head sock_list[PORT_HASH_SIZE];
 	spinlock_t	  sock_lock;
 	struct notifier_block nexthop_notifier_block;
+	struct rhashtable fdb_hash_tbl;	/* FDB entries of all devices */
+	atomic_long_t	  fdb_gen;	/* bumped when an entry is removed */
+	struct vxlan_fdb_pcpu __percpu *fdb_pcpu;
 };
 
 /* Forwarding table entry */
 struct vxlan_fdb {
 	struct hlist_node hlist;	/* linked list of entries */
+	struct rhash_head rhnode;	/* vxlan_net.fdb_hash_tbl linkage */
 	struct rcu_head	  rcu;
 	unsigned long	  updated;	/* jiffies */
 	unsigned long	  used;
@@ -111,14 +111,21 @@ static bool prefix_matches(const struct allowedips_node *node, const u8 *key,
 static struct allowedips_node *find_node(struct allowedips_node *trie, u8 bits,
 					 const u8 *key)
 {
-	struct allowedips_node *node = trie, *found = NULL;
-
-	while (node && prefix_matches(node, key, bits)) {
+	struct allowedips_node *node = trie, *found = NULL, *next;
+
+	while (node) {
+		/* Each step down the trie is a dependent load, so start
+		 * fetching the child we are going to visit next before doing
+		 * the prefix comparison on this one.
+		 */
+		next = node->cidr == bits ? NULL :
+		       rcu_dereference_bh(node->bit[choose(node, key)]);
+		prefetch(next);
+		if (!prefix_matches(node, key, bits))
+			break;
 		if (rcu_access_pointer(node->peer))
 			found = node;
-		if (node->cidr == bits)
-			break;
-		node = rcu_dereference_bh(node->bit[choose(node, key)]);
+		node = next;
 	}
 	return found;
 }
@@ -5,6 +5,43 @@
 
 #include "queueing.h"
 #include <linux/skb_array.h>
+#include <linux/moduleparam.h>
+
+static struct cpumask crypt_cpumask;
+const struct cpumask *wg_crypt_cpus __read_mostly = cpu_possible_mask;
+
+static int crypt_cpus_set(const char *val, const struct kernel_param *kp)
+{
+	cpumask_var_t mask;
+	int ret;
+
+	if (!alloc_cpumask_var(&mask, GFP_KERNEL))
+		return -ENOMEM;
+	ret = cpulist_parse(val, mask);
+	if (!ret && !cpumask_intersects(mask, cpu_possible_mask))
+		ret = -EINVAL;
+	if (!ret) {
+		/* Readers may briefly see a mix of the old and new mask,
+		 * which only affects which CPU the next packet is queued on.
+		 */
+		cpumask_copy(&crypt_cpumask, mask);
+		WRITE_ONCE(wg_crypt_cpus, &crypt_cpumask);
+	}
+	free_cpumask_var(mask);
+	return ret;
+}
+
+static int crypt_cpus_get(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%*pbl\n", cpumask_pr_args(wg_crypt_cpus));
+}
+
+static const struct kernel_param_ops crypt_cpus_ops = {
+	.set = crypt_cpus_set,
+	.get = crypt_cpus_get,
+};
+module_param_cb(crypt_cpus, &crypt_cpus_ops, NULL, 0644);
+MODULE_PARM_DESC(crypt_cpus, "CPUs doing encryption and decryption, as a CPU list (default: all)");
 
 struct multicore_worker __percpu *
 wg_packet_percpu_multicore_worker_alloc(work_func_t function, void *ptr)
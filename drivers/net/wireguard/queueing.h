@@ -117,16 +117,23 @@ static inline int wg_cpumask_choose_online(int *stored_cpu, unsigned int id)
 	return cpu;
 }
 
+extern const struct cpumask *wg_crypt_cpus;
+
 /* This function is racy, in the sense that it's called while last_cpu is
  * unlocked, so it could return the same CPU twice. Adding locking or using
  * atomic sequence numbers is slower though, and the consequences of racing are
- * harmless, so live with it.
+ * harmless, so live with it. Only the CPUs of the crypt_cpus module parameter
+ * are used, unless none of them is online.
  */
 static inline int wg_cpumask_next_online(int *last_cpu)
 {
-	int cpu = cpumask_next(*last_cpu, cpu_online_mask);
-	if (cpu >= nr_cpu_ids)
-		cpu = cpumask_first(cpu_online_mask);
+	const struct cpumask *mask = READ_ONCE(wg_crypt_cpus);
+	int cpu = cpumask_next_and(*last_cpu, mask, cpu_online_mask);
+	if (cpu >= nr_cpu_ids) {
+		cpu = cpumask_first_and(mask, cpu_online_mask);
+		if (unlikely(cpu >= nr_cpu_ids))
+			cpu = cpumask_first(cpu_online_mask);
+	}
 	*last_cpu = cpu;
 	return cpu;
 }
@@ -17,9 +17,15 @@
 #include <net/ip_tunnels.h>
 
 /* Must be called with bh disabled. */
-static void update_rx_stats(struct wg_peer *peer, size_t len)
+static void update_rx_stats(struct wg_peer *peer, unsigned int packets,
+			    size_t len)
 {
-	dev_sw_netstats_rx_add(peer->device->dev, len);
+	struct pcpu_sw_netstats *tstats = this_cpu_ptr(peer->device->dev->tstats);
+
+	u64_stats_update_begin(&tstats->syncp);
+	u64_stats_add(&tstats->rx_bytes, len);
+	u64_stats_add(&tstats->rx_packets, packets);
+	u64_stats_update_end(&tstats->syncp);
 	peer->rx_bytes += len;
 }
 
@@ -195,7 +201,7 @@ static void wg_receive_handshake_packet(struct wg_device *wg,
 	}
 
 	local_bh_disable();
-	update_rx_stats(peer, skb->len);
+	update_rx_stats(peer, 1, skb->len);
 	local_bh_enable();
 
 	wg_timers_any_authenticated_packet_received(peer);
@@ -332,13 +338,17 @@ static bool counter_validate(struct noise_replay_counter *counter, u64 their_cou
 
 #include "selftest/counter.c"
 
-static void wg_packet_consume_data_done(struct wg_peer *peer,
-					struct sk_buff *skb,
-					struct endpoint *endpoint)
+/* Returns the number of bytes to account to the peer, which the caller adds
+ * up for a whole burst of packets.
+ */
+static size_t wg_packet_consume_data_done(struct wg_peer *peer,
+					  struct sk_buff *skb,
+					  struct endpoint *endpoint)
 {
 	struct net_device *dev = peer->device->dev;
 	unsigned int len, len_before_trim;
 	struct wg_peer *routed_peer;
+	size_t rx_len = 0;
 
 	wg_socket_set_peer_endpoint(peer, endpoint);
 
@@ -355,7 +365,7 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 
 	/* A packet with length 0 is a keepalive packet */
 	if (unlikely(!skb->len)) {
-		update_rx_stats(peer, message_data_len(0));
+		rx_len = message_data_len(0);
 		net_dbg_ratelimited("%s: Receiving keepalive packet from peer %llu (%pISpfsc)\n",
 				    dev->name, peer->internal_id,
 				    &peer->endpoint.addr);
@@ -409,8 +419,7 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 		goto dishonest_packet_peer;
 
 	napi_gro_receive(&peer->napi, skb);
-	update_rx_stats(peer, message_data_len(len_before_trim));
-	return;
+	return message_data_len(len_before_trim);
 
 dishonest_packet_peer:
 	net_dbg_skb_ratelimited("%s: Packet has unallowed src IP (%pISc) from peer %llu (%pISpfsc)\n",
@@ -433,16 +442,20 @@ static void wg_packet_consume_data_done(struct wg_peer *peer,
 	goto packet_processed;
 packet_processed:
 	dev_kfree_skb(skb);
+	return rx_len;
 }
 
 int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 {
 	struct wg_peer *peer = container_of(napi, struct wg_peer, napi);
 	struct noise_keypair *keypair;
+	unsigned int rx_packets = 0;
 	struct endpoint endpoint;
 	enum packet_state state;
 	struct sk_buff *skb;
+	size_t rx_bytes = 0;
 	int work_done = 0;
+	size_t len;
 	bool free;
 
 	if (unlikely(budget <= 0))
@@ -471,7 +484,11 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 			goto next;
 
 		wg_reset_packet(skb, false);
-		wg_packet_consume_data_done(peer, skb, &endpoint);
+		len = wg_packet_consume_data_done(peer, skb, &endpoint);
+		if (len) {
+			rx_bytes += len;
+			++rx_packets;
+		}
 		free = false;
 
 next:
@@ -484,6 +501,13 @@ int wg_packet_rx_poll(struct napi_struct *napi, int budget)
 			break;
 	}
 
+	/* Statistics are updated once per burst rather than per packet, the
+	 * packets themselves are coalesced by GRO and flushed when the poll
+	 * completes.
+	 */
+	if (rx_packets)
+		update_rx_stats(peer, rx_packets, rx_bytes);
+
 	if (work_done < budget)
 		napi_complete_done(napi, work_done);
 
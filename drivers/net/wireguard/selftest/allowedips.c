@@ -10,7 +10,8 @@
  * to graphviz (the dot command) to visualize it. If you define the macro
  * DEBUG_RANDOM_TRIE to be 1, then there will be an extremely costly set of
  * randomized tests done against a trivial implementation, which may take
- * upwards of a half-hour to complete. There's no set of users who should be
+ * upwards of a half-hour to complete, followed by a lookup rate benchmark on
+ * the resulting tries. There's no set of users who should be
  * enabling these, and the only developers that should go anywhere near these
  * nobs are the ones who are reading this comment.
  */
@@ -72,7 +73,9 @@ enum {
 	NUM_PEERS = 2000,
 	NUM_RAND_ROUTES = 400,
 	NUM_MUTATED_ROUTES = 100,
-	NUM_QUERIES = NUM_RAND_ROUTES * NUM_MUTATED_ROUTES * 30
+	NUM_QUERIES = NUM_RAND_ROUTES * NUM_MUTATED_ROUTES * 30,
+	NUM_BENCHMARK_KEYS = 4096,
+	NUM_BENCHMARK_ROUNDS = 256
 };
 
 struct horrible_allowedips {
@@ -251,6 +254,40 @@ horrible_allowedips_remove_by_value(struct horrible_allowedips *table, void *val
 
 }
 
+static __init u64 benchmark_lookups(struct allowedips_node __rcu *root,
+				     u8 bits, u8 (*keys)[16])
+{
+	unsigned int i, j;
+	u64 start;
+
+	start = ktime_get_ns();
+	for (j = 0; j < NUM_BENCHMARK_ROUNDS; ++j) {
+		for (i = 0; i < NUM_BENCHMARK_KEYS; ++i)
+			lookup(root, bits, keys[i]);
+	}
+	return div_u64(ktime_get_ns() - start,
+		       NUM_BENCHMARK_ROUNDS * NUM_BENCHMARK_KEYS);
+}
+
+static __init void benchmark(struct allowedips *t)
+{
+	u8 (*keys)[16];
+	u64 ns4, ns6;
+
+	keys = kvmalloc_array(NUM_BENCHMARK_KEYS, sizeof(*keys), GFP_KERNEL);
+	if (unlikely(!keys)) {
+		pr_err("allowedips lookup benchmark malloc: FAIL\n");
+		return;
+	}
+	get_random_bytes(keys, NUM_BENCHMARK_KEYS * sizeof(*keys));
+
+	ns4 = benchmark_lookups(t->root4, 32, keys);
+	ns6 = benchmark_lookups(t->root6, 128, keys);
+	pr_info("allowedips lookup benchmark: %llu ns per v4 lookup, %llu ns per v6 lookup\n",
+		ns4, ns6);
+	kvfree(keys);
+}
+
 static __init bool randomized_test(void)
 {
 	unsigned int i, j, k, mutate_amount, cidr;
@@ -379,6 +416,8 @@ static __init bool randomized_test(void)
 		print_tree(t.root6, 128);
 	}
 
+	benchmark(&t);
+
 	for (j = 0;; ++j) {
 		for (i = 0; i < NUM_QUERIES; ++i) {
 			get_random_bytes(ip, 4);
@@ -239,6 +239,58 @@ void wg_packet_send_keepalive(struct wg_peer *peer)
 	wg_packet_send_staged_packets(peer);
 }
 
+#define GSO_MAX_PAYLOAD (IP_MAX_MTU - sizeof(struct iphdr) - sizeof(struct udphdr))
+
+/* Consecutive encrypted packets of the same size and outer DS field are sent
+ * as a single UDP GSO packet, so that they only go through the UDP and IP
+ * output paths once. They are chained on the frag_list of the first packet,
+ * which the stack or the device splits again at the same boundaries. Only the
+ * last packet of a chain may be shorter. Returns the first packet not chained.
+ */
+static struct sk_buff *wg_packet_gso_chain(struct sk_buff *head)
+{
+	unsigned int mss = head->len, len = head->len, truesize = 0, segs = 1;
+	struct sk_buff *skb, *last = head;
+
+	if (skb_has_frag_list(head) || skb_cloned(head))
+		return head->next;
+
+	for (skb = head->next; skb && segs < UDP_MAX_SEGMENTS; skb = skb->next) {
+		if (skb->len > mss || len + skb->len > GSO_MAX_PAYLOAD ||
+		    PACKET_CB(skb)->ds != PACKET_CB(head)->ds ||
+		    skb_has_frag_list(skb))
+			break;
+		len += skb->len;
+		truesize += skb->truesize;
+		last = skb;
+		++segs;
+		if (skb->len < mss)
+			break;
+	}
+	if (segs == 1)
+		return head->next;
+
+	skb = last->next;
+	last->next = NULL;
+	skb_shinfo(head)->frag_list = head->next;
+	head->next = skb;
+	head->data_len += len - head->len;
+	head->len = len;
+	head->truesize += truesize;
+
+	skb_shinfo(head)->gso_size = mss;
+	skb_shinfo(head)->gso_type = SKB_GSO_UDP_L4;
+	skb_shinfo(head)->gso_segs = segs;
+
+	/* The UDP header goes right in front of the message header, and the
+	 * UDP layer fills in the pseudo header checksum for GSO packets.
+	 */
+	head->ip_summed = CHECKSUM_PARTIAL;
+	head->csum_start = skb_headroom(head) - sizeof(struct udphdr);
+	head->csum_offset = offsetof(struct udphdr, check);
+	return skb;
+}
+
 static void wg_packet_create_data_done(struct wg_peer *peer, struct sk_buff *first)
 {
 	struct sk_buff *skb, *next;
@@ -248,6 +300,7 @@ static void wg_packet_create_data_done(struct wg_peer *peer, struct sk_buff *fir
 	wg_timers_any_authenticated_packet_sent(peer);
 	skb_list_walk_safe(first, skb, next) {
 		is_keepalive = skb->len == message_data_len(0);
+		next = wg_packet_gso_chain(skb);
 		if (likely(!wg_socket_send_skb_to_peer(peer, skb,
 				PACKET_CB(skb)->ds) && !is_keepalive))
 			data_sent = true;
@@ -344,6 +344,11 @@ static void set_sock_opts(struct socket *sock)
 	sock->sk->sk_allocation = GFP_ATOMIC;
 	sock->sk->sk_sndbuf = INT_MAX;
 	sk_set_memalloc(sock->sk);
+	/* Let GRO aggregate datagrams from the same endpoint, so that they
+	 * take a single trip through the IP and UDP input paths. They are
+	 * split up again before reaching wg_receive().
+	 */
+	udp_set_bit(GRO_ENABLED, sock->sk);
 }
 
 int wg_socket_init(struct wg_device *wg, u16 port)
@@ -19,6 +19,11 @@
 #include "btt.h"
 #include "nd.h"
 
+static bool map_cache;
+module_param(map_cache, bool, 0444);
+MODULE_PARM_DESC(map_cache,
+		 "Keep a DRAM copy of each arena map (4 bytes per block)");
+
 enum log_ent_request {
 	LOG_NEW_ENT = 0,
 	LOG_OLD_ENT
@@ -95,12 +100,21 @@ static int __btt_map_write(struct arena_info *arena, u32 lba, __le32 mapping,
 		unsigned long flags)
 {
 	u64 ns_off = arena->mapoff + (lba * MAP_ENT_SIZE);
+	int ret;
 
-	if (unlikely(lba >= arena->external_nlba))
+	if (unlikely(lba >= arena->external_nlba)) {
 		dev_err_ratelimited(to_dev(arena),
 			"%s: lba %#x out of range (max: %#x)\n",
 			__func__, lba, arena->external_nlba);
-	return arena_write_bytes(arena, ns_off, &mapping, MAP_ENT_SIZE, flags);
+		return arena_write_bytes(arena, ns_off, &mapping,
+				MAP_ENT_SIZE, flags);
+	}
+
+	ret = arena_write_bytes(arena, ns_off, &mapping, MAP_ENT_SIZE, flags);
+	/* The cache is write-through: only update it once the media is */
+	if (!ret && arena->map_cache)
+		WRITE_ONCE(arena->map_cache[lba], mapping);
+	return ret;
 }
 
 static int btt_map_write(struct arena_info *arena, u32 lba, u32 mapping,
@@ -160,9 +174,14 @@ static int btt_map_read(struct arena_info *arena, u32 lba, u32 *mapping,
 			"%s: lba %#x out of range (max: %#x)\n",
 			__func__, lba, arena->external_nlba);
 
-	ret = arena_read_bytes(arena, ns_off, &in, MAP_ENT_SIZE, rwb_flags);
-	if (ret)
-		return ret;
+	if (arena->map_cache && lba < arena->external_nlba) {
+		in = READ_ONCE(arena->map_cache[lba]);
+	} else {
+		ret = arena_read_bytes(arena, ns_off, &in, MAP_ENT_SIZE,
+				rwb_flags);
+		if (ret)
+			return ret;
+	}
 
 	raw_mapping = le32_to_cpu(in);
 
@@ -742,6 +761,35 @@ static int btt_maplocks_init(struct arena_info *arena)
 	return 0;
 }
 
+/*
+ * Load a copy of the map into DRAM so that lookups don't have to go to the
+ * media. This must run after btt_freelist_init(), which may still fix up map
+ * entries during recovery. Failing to set up the cache is not fatal.
+ */
+static void btt_mapcache_init(struct arena_info *arena)
+{
+	__le32 *cache;
+
+	if (!map_cache)
+		return;
+
+	cache = kvmalloc_array(arena->external_nlba, MAP_ENT_SIZE, GFP_KERNEL);
+	if (!cache)
+		goto fail;
+
+	if (arena_read_bytes(arena, arena->mapoff, cache,
+			(size_t)arena->external_nlba * MAP_ENT_SIZE, 0)) {
+		kvfree(cache);
+		goto fail;
+	}
+
+	arena->map_cache = cache;
+	return;
+
+ fail:
+	dev_warn(to_dev(arena), "Unable to cache the map, continuing without\n");
+}
+
 static struct arena_info *alloc_arena(struct btt *btt, size_t size,
 				size_t start, size_t arena_off)
 {
@@ -807,6 +855,7 @@ static void free_arenas(struct btt *btt)
 		list_del(&arena->list);
 		kfree(arena->rtt);
 		kfree(arena->map_locks);
+		kvfree(arena->map_cache);
 		kfree(arena->freelist);
 		debugfs_remove_recursive(arena->debugfs_dir);
 		kfree(arena);
@@ -905,6 +954,8 @@ static int discover_arenas(struct btt *btt)
 		if (ret)
 			goto out;
 
+		btt_mapcache_init(arena);
+
 		list_add_tail(&arena->list, &btt->arena_list);
 
 		remaining -= arena->size;
@@ -1044,6 +1095,8 @@ static int btt_meta_init(struct btt *btt)
 		ret = btt_maplocks_init(arena);
 		if (ret)
 			goto unlock;
+
+		btt_mapcache_init(arena);
 	}
 
 	btt->init_state = INIT_READY;
@@ -155,6 +155,7 @@ struct aligned_lock {
  * @freelist:		Pointer to in-memory list of free blocks
  * @rtt:		Pointer to in-memory "Read Tracking Table"
  * @map_locks:		Spinlocks protecting concurrent map writes
+ * @map_cache:		Optional write-through DRAM copy of the on-media map
  * @nd_btt:		Pointer to parent nd_btt structure.
  * @list:		List head for list of arenas
  * @debugfs_dir:	Debugfs dentry
@@ -187,6 +188,7 @@ struct arena_info {
 	struct free_entry *freelist;
 	u32 *rtt;
 	struct aligned_lock *map_locks;
+	__le32 *map_cache;
 	struct nd_btt *nd_btt;
 	struct list_head list;
 	struct dentry *debugfs_dir;
@@ -420,7 +420,7 @@ static void bcm2835_gpio_irq_handle_bank(struct bcm2835_pinctrl *pc,
 	unsigned long events;
 	unsigned offset;
 	unsigned gpio;
-	u32 levs, levs2;
+	u32 levs, levs2, ren, fen;
 
 	events = bcm2835_gpio_rd(pc, GPEDS0 + bank * 4);
 	levs = bcm2835_gpio_rd(pc, GPLEV0 + bank * 4);
@@ -428,6 +428,13 @@ static void bcm2835_gpio_irq_handle_bank(struct bcm2835_pinctrl *pc,
 	events &= pc->enabled_irq_map[bank];
 	bcm2835_gpio_wr(pc, GPEDS0 + bank * 4, events);
 
+	/*
+	 * The edge enables are not expected to change while the handlers run, so
+	 * read them once instead of on every pass of a busy bank.
+	 */
+	ren = bcm2835_gpio_rd(pc, GPREN0 + bank * 4);
+	fen = bcm2835_gpio_rd(pc, GPFEN0 + bank * 4);
+
 retry:
 	for_each_set_bit(offset, &events, 32) {
 		gpio = (32 * bank) + offset;
@@ -437,8 +444,8 @@ static void bcm2835_gpio_irq_handle_bank(struct bcm2835_pinctrl *pc,
 	events = bcm2835_gpio_rd(pc, GPEDS0 + bank * 4);
 	levs2 = bcm2835_gpio_rd(pc, GPLEV0 + bank * 4);
 
-	events |= levs2 & ~levs & bcm2835_gpio_rd(pc, GPREN0 + bank * 4);
-	events |= ~levs2 & levs & bcm2835_gpio_rd(pc, GPFEN0 + bank * 4);
+	events |= levs2 & ~levs & ren;
+	events |= ~levs2 & levs & fen;
 	events &= mask;
 	events &= pc->enabled_irq_map[bank];
 	if (events) {
@@ -105,6 +105,12 @@ MODULE_PARM_DESC(polling_limit_us,
  *      These are counted as well in @count_transfer_polling and
  *      @count_transfer_irq
  * @count_transfer_dma: count how often dma mode is used
+ * @speed_hz: requested clock speed that the cached values below are for
+ * @polling_limit_us: value of the polling_limit_us module parameter that
+ *	@byte_limit was computed for
+ * @cdiv: clock divider programmed into the CLK register for @speed_hz
+ * @effective_speed_hz: actual clock speed resulting from @cdiv
+ * @byte_limit: transfers shorter than this are run in polling mode
  * @slv: SPI slave currently selected
  *	(used by bcm2835_spi_dma_tx_done() to write @clear_rx_cs)
  * @tx_dma_active: whether a TX DMA descriptor is in progress
@@ -136,6 +142,12 @@ struct bcm2835_spi {
 	u64 count_transfer_irq_after_polling;
 	u64 count_transfer_dma;
 
+	u32 speed_hz;
+	unsigned int polling_limit_us;
+	unsigned long cdiv;
+	u32 effective_speed_hz;
+	unsigned long byte_limit;
+
 	struct bcm2835_spidev *slv;
 	unsigned int tx_dma_active;
 	unsigned int rx_dma_active;
@@ -1035,14 +1047,57 @@ static int bcm2835_spi_transfer_one_poll(struct spi_controller *ctlr,
 	return 0;
 }
 
+/*
+ * Messages made of many small transfers usually run them all at the same
+ * speed, so only recompute the divider and the polling threshold, and
+ * only reprogram the CLK register, when the speed actually changes.
+ */
+static void bcm2835_spi_set_clock(struct bcm2835_spi *bs, u32 spi_hz)
+{
+	unsigned long cdiv, hz_per_byte;
+	unsigned int limit_us = READ_ONCE(polling_limit_us);
+
+	if (spi_hz == bs->speed_hz && limit_us == bs->polling_limit_us)
+		return;
+
+	if (spi_hz >= bs->clk_hz / 2) {
+		cdiv = 2; /* clk_hz/2 is the fastest we can go */
+	} else if (spi_hz) {
+		/* CDIV must be a multiple of two */
+		cdiv = DIV_ROUND_UP(bs->clk_hz, spi_hz);
+		cdiv += (cdiv % 2);
+
+		if (cdiv >= 65536)
+			cdiv = 0; /* 0 is the slowest we can go */
+	} else {
+		cdiv = 0; /* 0 is the slowest we can go */
+	}
+
+	if (cdiv != bs->cdiv || !bs->speed_hz)
+		bcm2835_wr(bs, BCM2835_SPI_CLK, cdiv);
+
+	bs->speed_hz = spi_hz;
+	bs->cdiv = cdiv;
+	bs->effective_speed_hz = cdiv ? (bs->clk_hz / cdiv) :
+					(bs->clk_hz / 65536);
+
+	/* Calculate the estimated time in us the transfer runs.  Note that
+	 * there is 1 idle clocks cycles after each byte getting transferred
+	 * so we have 9 cycles/byte.  This is used to find the number of Hz
+	 * per byte per polling limit.  E.g., we can transfer 1 byte in 30 us
+	 * per 300,000 Hz of bus clock.
+	 */
+	bs->polling_limit_us = limit_us;
+	hz_per_byte = limit_us ? (9 * 1000000) / limit_us : 0;
+	bs->byte_limit = hz_per_byte ? bs->effective_speed_hz / hz_per_byte : 1;
+}
+
 static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 				    struct spi_device *spi,
 				    struct spi_transfer *tfr)
 {
 	struct bcm2835_spi *bs = spi_controller_get_devdata(ctlr);
 	struct bcm2835_spidev *slv = spi_get_ctldata(spi);
-	unsigned long spi_hz, cdiv;
-	unsigned long hz_per_byte, byte_limit;
 	u32 cs = slv->prepare_cs;
 
 	if (unlikely(!tfr->len)) {
@@ -1055,23 +1110,8 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 		return 0;
 	}
 
-	/* set clock */
-	spi_hz = tfr->speed_hz;
-
-	if (spi_hz >= bs->clk_hz / 2) {
-		cdiv = 2; /* clk_hz/2 is the fastest we can go */
-	} else if (spi_hz) {
-		/* CDIV must be a multiple of two */
-		cdiv = DIV_ROUND_UP(bs->clk_hz, spi_hz);
-		cdiv += (cdiv % 2);
-
-		if (cdiv >= 65536)
-			cdiv = 0; /* 0 is the slowest we can go */
-	} else {
-		cdiv = 0; /* 0 is the slowest we can go */
-	}
-	tfr->effective_speed_hz = cdiv ? (bs->clk_hz / cdiv) : (bs->clk_hz / 65536);
-	bcm2835_wr(bs, BCM2835_SPI_CLK, cdiv);
+	bcm2835_spi_set_clock(bs, tfr->speed_hz);
+	tfr->effective_speed_hz = bs->effective_speed_hz;
 
 	/* handle all the 3-wire mode */
 	if (spi->mode & SPI_3WIRE && tfr->rx_buf)
@@ -1083,17 +1123,8 @@ static int bcm2835_spi_transfer_one(struct spi_controller *ctlr,
 	bs->tx_len = tfr->len;
 	bs->rx_len = tfr->len;
 
-	/* Calculate the estimated time in us the transfer runs.  Note that
-	 * there is 1 idle clocks cycles after each byte getting transferred
-	 * so we have 9 cycles/byte.  This is used to find the number of Hz
-	 * per byte per polling limit.  E.g., we can transfer 1 byte in 30 us
-	 * per 300,000 Hz of bus clock.
-	 */
-	hz_per_byte = polling_limit_us ? (9 * 1000000) / polling_limit_us : 0;
-	byte_limit = hz_per_byte ? tfr->effective_speed_hz / hz_per_byte : 1;
-
 	/* run in polling mode for short transfers */
-	if (tfr->len < byte_limit)
+	if (tfr->len < bs->byte_limit)
 		return bcm2835_spi_transfer_one_poll(ctlr, spi, tfr, cs);
 
 	/* run in dma mode if conditions are right
@@ -21,13 +21,16 @@
  * License, or (at your option) any later version
  */
 #include <linux/module.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
 #include <linux/timer.h>
 #include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/platform_device.h>
 #include <linux/syscalls.h>
+#include <linux/workqueue.h>
 
 #include <media/v4l2-mem2mem.h>
 #include <media/v4l2-device.h>
@@ -89,6 +92,15 @@ static int field_override;
 module_param(field_override, int, 0644);
 MODULE_PARM_DESC(field_override, "force TB(8)/BT(9) field");
 
+/*
+ * Maximum number of buffers handed to the VPU from each queue every time an
+ * instance is scheduled. Submitting several at once amortises the scheduling
+ * and VCHIQ round trip, at the cost of other instances waiting slightly longer.
+ */
+static unsigned int batch = 4;
+module_param(batch, uint, 0644);
+MODULE_PARM_DESC(batch, "max buffers submitted per queue each time an instance runs");
+
 enum bcm2835_codec_role {
 	DECODE,
 	ENCODE,
@@ -646,6 +658,15 @@ struct bcm2835_codec_fmt_list {
 struct m2m_mmal_buffer {
 	struct v4l2_m2m_buffer	m2m;
 	struct mmal_buffer	mmal;
+	/* ktime_get_ns() when queued by userspace and when sent to the VPU */
+	u64			queued_ns;
+	u64			submitted_ns;
+};
+
+struct bcm2835_codec_latency {
+	u64 count;
+	u64 total_ns;
+	u64 max_ns;
 };
 
 /* Per-queue, driver-specific private data */
@@ -698,6 +719,22 @@ struct bcm2835_codec_dev {
 	struct vchiq_mmal_instance	*instance;
 
 	struct v4l2_m2m_dev	*m2m_dev;
+
+	/*
+	 * All open instances, ordered by nothing in particular. The list is
+	 * modified with both sched_mutex and sched_lock held, so either is
+	 * sufficient for walking it. sched_lock also protects the per-instance
+	 * scheduling state.
+	 */
+	struct list_head	sched_ctxs;
+	struct mutex		sched_mutex;
+	spinlock_t		sched_lock;
+	/* Set when an instance was held back in favour of an earlier deadline */
+	bool			sched_retry;
+	struct work_struct	sched_work;
+
+	struct dentry		*debugfs_dir;
+	atomic_t		next_id;
 };
 
 struct bcm2835_codec_ctx {
@@ -728,6 +765,24 @@ struct bcm2835_codec_ctx {
 	int num_ip_buffers;
 	int num_op_buffers;
 	struct completion frame_cmplt;
+
+	/* Scheduling state, protected by dev->sched_lock */
+	struct list_head sched_list;
+	u64 deadline;
+	/* Queued or running in the m2m framework */
+	bool sched_queued;
+	bool sched_deferred;
+	u64 runs;
+	u64 deferrals;
+
+	/* Latency statistics, protected by stats_lock */
+	spinlock_t stats_lock;
+	struct bcm2835_codec_latency out_wait;
+	struct bcm2835_codec_latency out_done;
+	struct bcm2835_codec_latency cap_done;
+
+	unsigned int id;
+	struct dentry *debugfs;
 };
 
 struct bcm2835_codec_driver {
@@ -739,6 +794,8 @@ struct bcm2835_codec_driver {
 	struct bcm2835_codec_dev *isp;
 	struct bcm2835_codec_dev *deinterlace;
 	struct bcm2835_codec_dev *encode_image;
+
+	struct dentry *debugfs_root;
 };
 
 enum {
@@ -845,18 +902,137 @@ static struct vchiq_mmal_port *get_port_data(struct bcm2835_codec_ctx *ctx,
  * mem2mem callbacks
  */
 
+static inline struct m2m_mmal_buffer *
+to_m2m_mmal_buf(struct vb2_v4l2_buffer *vbuf)
+{
+	struct v4l2_m2m_buffer *m2m = container_of(vbuf, struct v4l2_m2m_buffer,
+						   vb);
+
+	return container_of(m2m, struct m2m_mmal_buffer, m2m);
+}
+
+static void bcm2835_codec_account(struct bcm2835_codec_ctx *ctx,
+				  struct bcm2835_codec_latency *lat,
+				  u64 start_ns)
+{
+	u64 delta = ktime_get_ns() - start_ns;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->stats_lock, flags);
+	lat->count++;
+	lat->total_ns += delta;
+	if (delta > lat->max_ns)
+		lat->max_ns = delta;
+	spin_unlock_irqrestore(&ctx->stats_lock, flags);
+}
+
+/*
+ * The deadline of an instance is one frame period after its oldest pending
+ * buffer was queued. Instances without a sensible frame rate just use the
+ * queue time, which degenerates to FIFO ordering.
+ */
+static u64 bcm2835_codec_deadline(struct bcm2835_codec_ctx *ctx)
+{
+	struct vb2_v4l2_buffer *vbuf;
+	u64 deadline;
+
+	vbuf = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
+	if (!vbuf)
+		vbuf = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
+	deadline = vbuf ? to_m2m_mmal_buf(vbuf)->queued_ns : ktime_get_ns();
+
+	if (ctx->framerate_num)
+		deadline += div_u64((u64)NSEC_PER_SEC * ctx->framerate_denom,
+				    ctx->framerate_num);
+
+	return deadline;
+}
+
+/*
+ * The m2m framework runs queued instances strictly in FIFO order. To share the
+ * VPU fairly between several streams, an instance is only allowed onto the
+ * job queue if no other queued or running instance has an earlier deadline.
+ * Held back instances are retried from sched_work once the device moves on.
+ */
+static void bcm2835_codec_sched_work(struct work_struct *work)
+{
+	struct bcm2835_codec_dev *dev =
+		container_of(work, struct bcm2835_codec_dev, sched_work);
+	struct bcm2835_codec_ctx *ctx;
+	unsigned long flags;
+	bool deferred;
+
+	mutex_lock(&dev->sched_mutex);
+	spin_lock_irqsave(&dev->sched_lock, flags);
+	dev->sched_retry = false;
+	spin_unlock_irqrestore(&dev->sched_lock, flags);
+
+	list_for_each_entry(ctx, &dev->sched_ctxs, sched_list) {
+		spin_lock_irqsave(&dev->sched_lock, flags);
+		deferred = ctx->sched_deferred;
+		ctx->sched_deferred = false;
+		spin_unlock_irqrestore(&dev->sched_lock, flags);
+
+		if (deferred)
+			v4l2_m2m_try_schedule(ctx->fh.m2m_ctx);
+	}
+	mutex_unlock(&dev->sched_mutex);
+}
+
+static void bcm2835_codec_sched_done(struct bcm2835_codec_ctx *ctx)
+{
+	struct bcm2835_codec_dev *dev = ctx->dev;
+	unsigned long flags;
+	bool retry;
+
+	spin_lock_irqsave(&dev->sched_lock, flags);
+	ctx->sched_queued = false;
+	retry = dev->sched_retry;
+	spin_unlock_irqrestore(&dev->sched_lock, flags);
+
+	if (retry)
+		schedule_work(&dev->sched_work);
+}
+
 /*
  * job_ready() - check whether an instance is ready to be scheduled to run
  */
 static int job_ready(void *priv)
 {
 	struct bcm2835_codec_ctx *ctx = priv;
+	struct bcm2835_codec_dev *dev = ctx->dev;
+	struct bcm2835_codec_ctx *other;
+	unsigned long flags;
+	bool defer = false;
+	u64 deadline;
 
 	if (!v4l2_m2m_num_src_bufs_ready(ctx->fh.m2m_ctx) &&
 	    !v4l2_m2m_num_dst_bufs_ready(ctx->fh.m2m_ctx))
 		return 0;
 
-	return 1;
+	deadline = bcm2835_codec_deadline(ctx);
+
+	spin_lock_irqsave(&dev->sched_lock, flags);
+	list_for_each_entry(other, &dev->sched_ctxs, sched_list) {
+		if (other == ctx || !other->sched_queued)
+			continue;
+		if (other->deadline < deadline ||
+		    (other->deadline == deadline && other < ctx)) {
+			defer = true;
+			break;
+		}
+	}
+	if (defer) {
+		ctx->sched_deferred = true;
+		ctx->deferrals++;
+		dev->sched_retry = true;
+	} else {
+		ctx->sched_queued = true;
+		ctx->deadline = deadline;
+	}
+	spin_unlock_irqrestore(&dev->sched_lock, flags);
+
+	return !defer;
 }
 
 static void job_abort(void *priv)
@@ -999,6 +1175,8 @@ static void ip_buffer_cb(struct vchiq_mmal_instance *instance,
 
 	v4l2_dbg(3, debug, &ctx->dev->v4l2_dev, "%s: no error. Return buffer %p\n",
 		 __func__, &buf->m2m.vb.vb2_buf);
+	if (port->enabled)
+		bcm2835_codec_account(ctx, &ctx->out_done, buf->submitted_ns);
 	vb2_buffer_done(&buf->m2m.vb.vb2_buf,
 			port->enabled ? VB2_BUF_STATE_DONE :
 					VB2_BUF_STATE_QUEUED);
@@ -1252,6 +1430,7 @@ static void op_buffer_cb(struct vchiq_mmal_instance *instance,
 	if (mmal_buf->mmal_flags & MMAL_BUFFER_HEADER_FLAG_KEYFRAME)
 		vb2->flags |= V4L2_BUF_FLAG_KEYFRAME;
 
+	bcm2835_codec_account(ctx, &ctx->cap_done, buf->submitted_ns);
 	vb2_buffer_done(&vb2->vb2_buf, buf_state);
 	ctx->num_op_buffers++;
 
@@ -1324,60 +1503,74 @@ static void device_run(void *priv)
 {
 	struct bcm2835_codec_ctx *ctx = priv;
 	struct bcm2835_codec_dev *dev = ctx->dev;
+	unsigned int max_batch = max(READ_ONCE(batch), 1U);
+	unsigned int num_src = 0, num_dst = 0;
 	struct vb2_v4l2_buffer *src_buf, *dst_buf;
-	struct m2m_mmal_buffer *src_m2m_buf = NULL, *dst_m2m_buf = NULL;
-	struct v4l2_m2m_buffer *m2m;
+	struct m2m_mmal_buffer *src_m2m_buf, *dst_m2m_buf;
+	unsigned long flags;
 	int ret;
 
 	v4l2_dbg(3, debug, &ctx->dev->v4l2_dev, "%s: off we go\n", __func__);
 
-	if (ctx->fh.m2m_ctx->out_q_ctx.q.streaming) {
+	spin_lock_irqsave(&dev->sched_lock, flags);
+	ctx->runs++;
+	spin_unlock_irqrestore(&dev->sched_lock, flags);
+
+	while (ctx->fh.m2m_ctx->out_q_ctx.q.streaming && num_src < max_batch) {
 		src_buf = v4l2_m2m_buf_remove(&ctx->fh.m2m_ctx->out_q_ctx);
-		if (src_buf) {
-			m2m = container_of(src_buf, struct v4l2_m2m_buffer, vb);
-			src_m2m_buf = container_of(m2m, struct m2m_mmal_buffer,
-						   m2m);
-			vb2_to_mmal_buffer(src_m2m_buf, src_buf);
-
-			ret = vchiq_mmal_submit_buffer(dev->instance,
-						       &ctx->component->input[0],
-						       &src_m2m_buf->mmal);
-			v4l2_dbg(3, debug, &ctx->dev->v4l2_dev,
-				 "%s: Submitted ip buffer len %lu, pts %llu, flags %04x\n",
-				 __func__, src_m2m_buf->mmal.length,
-				 src_m2m_buf->mmal.pts,
-				 src_m2m_buf->mmal.mmal_flags);
-			if (ret)
-				v4l2_err(&ctx->dev->v4l2_dev,
-					 "%s: Failed submitting ip buffer\n",
-					 __func__);
-		}
+		if (!src_buf)
+			break;
+
+		src_m2m_buf = to_m2m_mmal_buf(src_buf);
+		vb2_to_mmal_buffer(src_m2m_buf, src_buf);
+
+		bcm2835_codec_account(ctx, &ctx->out_wait,
+				      src_m2m_buf->queued_ns);
+		src_m2m_buf->submitted_ns = ktime_get_ns();
+		ret = vchiq_mmal_submit_buffer(dev->instance,
+					       &ctx->component->input[0],
+					       &src_m2m_buf->mmal);
+		v4l2_dbg(3, debug, &ctx->dev->v4l2_dev,
+			 "%s: Submitted ip buffer len %lu, pts %llu, flags %04x\n",
+			 __func__, src_m2m_buf->mmal.length,
+			 src_m2m_buf->mmal.pts,
+			 src_m2m_buf->mmal.mmal_flags);
+		if (ret)
+			v4l2_err(&ctx->dev->v4l2_dev,
+				 "%s: Failed submitting ip buffer\n",
+				 __func__);
+		num_src++;
 	}
 
-	if (ctx->fh.m2m_ctx->cap_q_ctx.q.streaming) {
+	while (ctx->fh.m2m_ctx->cap_q_ctx.q.streaming && num_dst < max_batch) {
 		dst_buf = v4l2_m2m_buf_remove(&ctx->fh.m2m_ctx->cap_q_ctx);
-		if (dst_buf) {
-			m2m = container_of(dst_buf, struct v4l2_m2m_buffer, vb);
-			dst_m2m_buf = container_of(m2m, struct m2m_mmal_buffer,
-						   m2m);
-			vb2_to_mmal_buffer(dst_m2m_buf, dst_buf);
+		if (!dst_buf)
+			break;
 
-			v4l2_dbg(3, debug, &ctx->dev->v4l2_dev,
-				 "%s: Submitted op buffer\n", __func__);
-			ret = vchiq_mmal_submit_buffer(dev->instance,
-						       &ctx->component->output[0],
-						       &dst_m2m_buf->mmal);
-			if (ret)
-				v4l2_err(&ctx->dev->v4l2_dev,
-					 "%s: Failed submitting op buffer\n",
-					 __func__);
-		}
+		dst_m2m_buf = to_m2m_mmal_buf(dst_buf);
+		vb2_to_mmal_buffer(dst_m2m_buf, dst_buf);
+
+		v4l2_dbg(3, debug, &ctx->dev->v4l2_dev,
+			 "%s: Submitted op buffer\n", __func__);
+		dst_m2m_buf->submitted_ns = ktime_get_ns();
+		ret = vchiq_mmal_submit_buffer(dev->instance,
+					       &ctx->component->output[0],
+					       &dst_m2m_buf->mmal);
+		if (ret)
+			v4l2_err(&ctx->dev->v4l2_dev,
+				 "%s: Failed submitting op buffer\n",
+				 __func__);
+		num_dst++;
 	}
 
-	v4l2_dbg(3, debug, &ctx->dev->v4l2_dev, "%s: Submitted src %p, dst %p\n",
-		 __func__, src_m2m_buf, dst_m2m_buf);
+	v4l2_dbg(3, debug, &ctx->dev->v4l2_dev, "%s: Submitted %u src, %u dst\n",
+		 __func__, num_src, num_dst);
 
-	/* Complete the job here. */
+	/*
+	 * Complete the job here. Clear our queued state first, as
+	 * v4l2_m2m_job_finish() may immediately requeue this instance.
+	 */
+	bcm2835_codec_sched_done(ctx);
 	v4l2_m2m_job_finish(ctx->dev->m2m_dev, ctx->fh.m2m_ctx);
 }
 
@@ -2952,6 +3145,7 @@ static void bcm2835_codec_buf_queue(struct vb2_buffer *vb)
 	v4l2_dbg(4, debug, &ctx->dev->v4l2_dev, "%s: type: %d ptr %p vbuf->flags %u, seq %u, bytesused %u\n",
 		 __func__, vb->vb2_queue->type, vb, vbuf->flags, vbuf->sequence,
 		 vb->planes[0].bytesused);
+	to_m2m_mmal_buf(vbuf)->queued_ns = ktime_get_ns();
 	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vbuf);
 }
 
@@ -3127,6 +3321,9 @@ static void bcm2835_codec_stop_streaming(struct vb2_queue *q)
 		v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_QUEUED);
 	}
 
+	/* Nothing left to schedule, so stop holding back other instances */
+	bcm2835_codec_sched_done(ctx);
+
 	/* Disable MMAL port - this will flush buffers back */
 	ret = vchiq_mmal_port_disable(dev->instance, port);
 	if (ret)
@@ -3307,6 +3504,43 @@ static void dec_add_profile_ctrls(struct bcm2835_codec_dev *const dev,
 /*
  * File operations
  */
+static void bcm2835_codec_show_latency(struct seq_file *m, const char *name,
+				       const struct bcm2835_codec_latency *lat)
+{
+	seq_printf(m, "%-14s count %llu avg %llu us max %llu us\n", name,
+		   lat->count,
+		   lat->count ? div64_u64(lat->total_ns, lat->count) / 1000 : 0,
+		   div_u64(lat->max_ns, 1000));
+}
+
+static int bcm2835_codec_stats_show(struct seq_file *m, void *v)
+{
+	struct bcm2835_codec_ctx *ctx = m->private;
+	struct bcm2835_codec_dev *dev = ctx->dev;
+	struct bcm2835_codec_latency out_wait, out_done, cap_done;
+	u64 runs, deferrals;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->sched_lock, flags);
+	runs = ctx->runs;
+	deferrals = ctx->deferrals;
+	spin_unlock_irqrestore(&dev->sched_lock, flags);
+
+	spin_lock_irqsave(&ctx->stats_lock, flags);
+	out_wait = ctx->out_wait;
+	out_done = ctx->out_done;
+	cap_done = ctx->cap_done;
+	spin_unlock_irqrestore(&ctx->stats_lock, flags);
+
+	seq_printf(m, "runs %llu deferrals %llu\n", runs, deferrals);
+	bcm2835_codec_show_latency(m, "output_wait", &out_wait);
+	bcm2835_codec_show_latency(m, "output_done", &out_done);
+	bcm2835_codec_show_latency(m, "capture_done", &cap_done);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bcm2835_codec_stats);
+
 static int bcm2835_codec_open(struct file *file)
 {
 	struct bcm2835_codec_dev *dev = video_drvdata(file);
@@ -3523,6 +3757,23 @@ static int bcm2835_codec_open(struct file *file)
 	v4l2_m2m_set_src_buffered(ctx->fh.m2m_ctx, true);
 	v4l2_m2m_set_dst_buffered(ctx->fh.m2m_ctx, true);
 
+	spin_lock_init(&ctx->stats_lock);
+	mutex_lock(&dev->sched_mutex);
+	spin_lock_irq(&dev->sched_lock);
+	list_add_tail(&ctx->sched_list, &dev->sched_ctxs);
+	spin_unlock_irq(&dev->sched_lock);
+	mutex_unlock(&dev->sched_mutex);
+
+	if (dev->debugfs_dir) {
+		char name[12];
+
+		ctx->id = atomic_inc_return(&dev->next_id);
+		snprintf(name, sizeof(name), "%u", ctx->id);
+		ctx->debugfs = debugfs_create_file(name, 0444,
+						   dev->debugfs_dir, ctx,
+						   &bcm2835_codec_stats_fops);
+	}
+
 	v4l2_fh_add(&ctx->fh);
 	atomic_inc(&dev->num_inst);
 
@@ -3545,6 +3796,16 @@ static int bcm2835_codec_release(struct file *file)
 	v4l2_dbg(1, debug, &dev->v4l2_dev, "%s: Releasing instance %p\n",
 		 __func__, ctx);
 
+	debugfs_remove(ctx->debugfs);
+
+	mutex_lock(&dev->sched_mutex);
+	spin_lock_irq(&dev->sched_lock);
+	list_del(&ctx->sched_list);
+	spin_unlock_irq(&dev->sched_lock);
+	mutex_unlock(&dev->sched_mutex);
+	/* Anything held back behind this instance can go now */
+	bcm2835_codec_sched_done(ctx);
+
 	v4l2_fh_del(&ctx->fh);
 	v4l2_fh_exit(&ctx->fh);
 	v4l2_ctrl_handler_free(&ctx->hdl);
@@ -3735,6 +3996,11 @@ static int bcm2835_codec_create(struct bcm2835_codec_driver *drv,
 	atomic_set(&dev->num_inst, 0);
 	mutex_init(&dev->dev_mutex);
 
+	INIT_LIST_HEAD(&dev->sched_ctxs);
+	mutex_init(&dev->sched_mutex);
+	spin_lock_init(&dev->sched_lock);
+	INIT_WORK(&dev->sched_work, bcm2835_codec_sched_work);
+
 	/* Initialise the video device */
 	dev->vfd = bcm2835_codec_videodev;
 
@@ -3820,6 +4086,10 @@ static int bcm2835_codec_create(struct bcm2835_codec_driver *drv,
 	if (ret)
 		goto err_m2m;
 
+	if (drv->debugfs_root)
+		dev->debugfs_dir = debugfs_create_dir(roles[role],
+						      drv->debugfs_root);
+
 	v4l2_info(&dev->v4l2_dev, "Loaded V4L2 %s\n",
 		  roles[role]);
 	return 0;
@@ -3841,6 +4111,8 @@ static int bcm2835_codec_destroy(struct bcm2835_codec_dev *dev)
 
 	v4l2_info(&dev->v4l2_dev, "Removing " MEM2MEM_NAME ", %s\n",
 		  roles[dev->role]);
+	debugfs_remove_recursive(dev->debugfs_dir);
+	cancel_work_sync(&dev->sched_work);
 	v4l2_m2m_unregister_media_controller(dev->m2m_dev);
 	v4l2_m2m_release(dev->m2m_dev);
 	video_unregister_device(&dev->vfd);
@@ -3873,6 +4145,10 @@ static int bcm2835_codec_probe(struct platform_device *pdev)
 	mdev->hw_revision = 1;
 	media_device_init(mdev);
 
+	drv->debugfs_root = debugfs_create_dir("bcm2835-codec", NULL);
+	if (IS_ERR(drv->debugfs_root))
+		drv->debugfs_root = NULL;
+
 	ret = bcm2835_codec_create(drv, &drv->decode, DECODE);
 	if (ret)
 		goto out;
@@ -3922,6 +4198,7 @@ static int bcm2835_codec_probe(struct platform_device *pdev)
 		bcm2835_codec_destroy(drv->decode);
 		drv->decode = NULL;
 	}
+	debugfs_remove_recursive(drv->debugfs_root);
 	return ret;
 }
 
@@ -3941,6 +4218,7 @@ static int bcm2835_codec_remove(struct platform_device *pdev)
 
 	bcm2835_codec_destroy(drv->decode);
 
+	debugfs_remove_recursive(drv->debugfs_root);
 	media_device_cleanup(&drv->mdev);
 
 	return 0;
@@ -148,6 +148,20 @@ struct vchiq_pagelist_info {
 	struct page **pages;
 	struct scatterlist *scatterlist;
 	unsigned int scatterlist_mapped;
+	struct vchiq_registered_buffer *registered;
+};
+
+/*
+ * A user buffer pinned, mapped and described by a pagelist once, through
+ * VCHIQ_IOC_REGISTER_BULK_BUFFER. Bulk transfers that start at @ubuf and
+ * fit in @size reuse @pagelistinfo instead of building their own.
+ */
+struct vchiq_registered_buffer {
+	struct list_head list;
+	void __user *ubuf;
+	size_t size;
+	struct vchiq_pagelist_info *pagelistinfo;
+	bool in_use;
 };
 
 static void __iomem *g_regs;
@@ -187,6 +201,7 @@ vchiq_doorbell_irq(int irq, void *dev_id)
 	status = readl(g_regs + BELL0);
 
 	if (status & ARM_DS_ACTIVE) {  /* Was the doorbell rung? */
+		atomic_long_inc(&state->traffic.rx_doorbells);
 		remote_event_pollall(state);
 		ret = IRQ_HANDLED;
 	}
@@ -202,8 +217,16 @@ cleanup_pagelistinfo(struct vchiq_instance *instance, struct vchiq_pagelist_info
 			     pagelistinfo->num_pages, pagelistinfo->dma_dir);
 	}
 
+	/*
+	 * Registered buffers stay pinned across many transfers, so whatever
+	 * the VPU wrote into them may have been cleaned since: dirty them once
+	 * more on the way out.
+	 */
 	if (pagelistinfo->pages_need_release)
-		unpin_user_pages(pagelistinfo->pages, pagelistinfo->num_pages);
+		unpin_user_pages_dirty_lock(pagelistinfo->pages,
+					    pagelistinfo->num_pages,
+					    pagelistinfo->registered &&
+					    pagelistinfo->dma_dir != DMA_TO_DEVICE);
 
 	if (pagelistinfo->is_from_pool) {
 		dma_pool_free(g_dma_pool, pagelistinfo->pagelist,
@@ -237,8 +260,9 @@ is_adjacent_block(u32 *addrs, u32 addr, unsigned int k)
  */
 
 static struct vchiq_pagelist_info *
-create_pagelist(struct vchiq_instance *instance, char *buf, char __user *ubuf,
-		size_t count, unsigned short type)
+__create_pagelist(struct vchiq_instance *instance, char *buf, char __user *ubuf,
+		  size_t count, unsigned short type,
+		  enum dma_data_direction dma_dir, unsigned int gup_flags)
 {
 	struct pagelist *pagelist;
 	struct vchiq_pagelist_info *pagelistinfo;
@@ -305,13 +329,13 @@ create_pagelist(struct vchiq_instance *instance, char *buf, char __user *ubuf,
 	pagelistinfo->pagelist_buffer_size = pagelist_size;
 	pagelistinfo->dma_addr = dma_addr;
 	pagelistinfo->is_from_pool = is_from_pool;
-	pagelistinfo->dma_dir =  (type == PAGELIST_WRITE) ?
-				  DMA_TO_DEVICE : DMA_FROM_DEVICE;
+	pagelistinfo->dma_dir = dma_dir;
 	pagelistinfo->num_pages = num_pages;
 	pagelistinfo->pages_need_release = 0;
 	pagelistinfo->pages = pages;
 	pagelistinfo->scatterlist = scatterlist;
 	pagelistinfo->scatterlist_mapped = 0;
+	pagelistinfo->registered = NULL;
 
 	if (buf) {
 		unsigned long length = count;
@@ -338,7 +362,7 @@ create_pagelist(struct vchiq_instance *instance, char *buf, char __user *ubuf,
 		/* do not try and release vmalloc pages */
 	} else {
 		actual_pages = pin_user_pages_fast((unsigned long)ubuf & PAGE_MASK, num_pages,
-						   type == PAGELIST_READ, pages);
+						   gup_flags, pages);
 
 		if (actual_pages != num_pages) {
 			vchiq_log_info(vchiq_arm_log_level,
@@ -442,27 +466,102 @@ create_pagelist(struct vchiq_instance *instance, char *buf, char __user *ubuf,
 		}
 	}
 
-	/* Partial cache lines (fragments) require special measures */
-	if ((type == PAGELIST_READ) &&
-	    ((pagelist->offset & (g_cache_line_size - 1)) ||
-	    ((pagelist->offset + pagelist->length) &
-	    (g_cache_line_size - 1)))) {
-		char *fragments;
+	return pagelistinfo;
+}
 
-		if (down_interruptible(&g_free_fragments_sema)) {
-			cleanup_pagelistinfo(instance, pagelistinfo);
-			return NULL;
+/* Partial cache lines (fragments) require special measures */
+static int
+claim_fragments(struct vchiq_pagelist_info *pagelistinfo)
+{
+	struct pagelist *pagelist = pagelistinfo->pagelist;
+	char *fragments;
+
+	if ((pagelist->type != PAGELIST_READ) ||
+	    !((pagelist->offset & (g_cache_line_size - 1)) ||
+	      ((pagelist->offset + pagelist->length) &
+	       (g_cache_line_size - 1))))
+		return 0;
+
+	if (down_interruptible(&g_free_fragments_sema))
+		return -EINTR;
+
+	WARN_ON(!g_free_fragments);
+
+	down(&g_free_fragments_mutex);
+	fragments = g_free_fragments;
+	WARN_ON(!fragments);
+	g_free_fragments = *(char **)g_free_fragments;
+	up(&g_free_fragments_mutex);
+	pagelist->type = PAGELIST_READ_WITH_FRAGMENTS +
+		(fragments - g_fragments_base) / g_fragments_size;
+
+	return 0;
+}
+
+static struct vchiq_pagelist_info *
+create_pagelist(struct vchiq_instance *instance, char *buf, char __user *ubuf,
+		size_t count, unsigned short type)
+{
+	struct vchiq_pagelist_info *pagelistinfo;
+
+	pagelistinfo = __create_pagelist(instance, buf, ubuf, count, type,
+					 (type == PAGELIST_WRITE) ?
+					 DMA_TO_DEVICE : DMA_FROM_DEVICE,
+					 (type == PAGELIST_READ) ? FOLL_WRITE : 0);
+	if (!pagelistinfo)
+		return NULL;
+
+	if (claim_fragments(pagelistinfo)) {
+		cleanup_pagelistinfo(instance, pagelistinfo);
+		return NULL;
+	}
+
+	return pagelistinfo;
+}
+
+/*
+ * Hand out the pagelist of a registered buffer for a transfer of @count
+ * bytes starting at @ubuf. Returns NULL if there is no idle registered
+ * buffer covering the transfer, in which case the caller builds a pagelist
+ * from scratch.
+ */
+static struct vchiq_pagelist_info *
+get_registered_pagelist(struct vchiq_instance *instance, void __user *ubuf,
+			size_t count, unsigned short type)
+{
+	struct vchiq_registered_buffer *reg;
+	struct vchiq_pagelist_info *pagelistinfo = NULL;
+	struct pagelist *pagelist;
+
+	mutex_lock(&instance->registered_buffers_mutex);
+	list_for_each_entry(reg, &instance->registered_buffers, list) {
+		if (reg->ubuf == ubuf && count <= reg->size && !reg->in_use) {
+			reg->in_use = true;
+			pagelistinfo = reg->pagelistinfo;
+			break;
 		}
+	}
+	mutex_unlock(&instance->registered_buffers_mutex);
 
-		WARN_ON(!g_free_fragments);
+	if (!pagelistinfo)
+		return NULL;
 
-		down(&g_free_fragments_mutex);
-		fragments = g_free_fragments;
-		WARN_ON(!fragments);
-		g_free_fragments = *(char **)g_free_fragments;
-		up(&g_free_fragments_mutex);
-		pagelist->type = PAGELIST_READ_WITH_FRAGMENTS +
-			(fragments - g_fragments_base) / g_fragments_size;
+	/*
+	 * The pagelist describes the whole registered buffer; the VPU stops
+	 * after length bytes, so only the header needs refreshing.
+	 */
+	pagelist = pagelistinfo->pagelist;
+	pagelist->length = count;
+	pagelist->type = type;
+
+	dma_sync_sg_for_device(g_dma_dev, pagelistinfo->scatterlist,
+			       pagelistinfo->num_pages, pagelistinfo->dma_dir);
+
+	if (claim_fragments(pagelistinfo)) {
+		mutex_lock(&instance->registered_buffers_mutex);
+		reg->in_use = false;
+		mutex_unlock(&instance->registered_buffers_mutex);
+		return ERR_PTR(-EINTR);
 	}
 
 	return pagelistinfo;
@@ -480,12 +579,19 @@ free_pagelist(struct vchiq_instance *instance, struct vchiq_pagelist_info *pagel
 			__func__, pagelistinfo->pagelist, actual);
 
 	/*
-	 * NOTE: dma_unmap_sg must be called before the
-	 * cpu can touch any of the data/pages.
+	 * NOTE: dma_unmap_sg (or a sync for registered buffers, which stay
+	 * mapped) must be called before the cpu can touch any of the
+	 * data/pages.
 	 */
-	dma_unmap_sg(g_dma_dev, pagelistinfo->scatterlist,
-		     pagelistinfo->num_pages, pagelistinfo->dma_dir);
-	pagelistinfo->scatterlist_mapped = 0;
+	if (pagelistinfo->registered) {
+		dma_sync_sg_for_cpu(g_dma_dev, pagelistinfo->scatterlist,
+				    pagelistinfo->num_pages,
+				    pagelistinfo->dma_dir);
+	} else {
+		dma_unmap_sg(g_dma_dev, pagelistinfo->scatterlist,
+			     pagelistinfo->num_pages, pagelistinfo->dma_dir);
+		pagelistinfo->scatterlist_mapped = 0;
+	}
 
 	/* Deal with any partial cache lines (fragments) */
 	if (pagelist->type >= PAGELIST_READ_WITH_FRAGMENTS && g_fragments_base) {
@@ -510,7 +616,8 @@ free_pagelist(struct vchiq_instance *instance, struct vchiq_pagelist_info *pagel
 		}
 		if ((actual >= 0) && (head_bytes < actual) &&
 		    (tail_bytes != 0))
-			memcpy_to_page(pages[num_pages - 1],
+			memcpy_to_page(pages[(pagelist->offset + actual) >>
+					     PAGE_SHIFT],
 				(pagelist->offset + actual) &
 				(PAGE_SIZE - 1) & ~(g_cache_line_size - 1),
 				fragments + g_cache_line_size,
@@ -524,7 +631,7 @@ free_pagelist(struct vchiq_instance *instance, struct vchiq_pagelist_info *pagel
 	}
 
 	/* Need to mark all the pages dirty. */
-	if (pagelist->type != PAGELIST_WRITE &&
+	if (pagelistinfo->dma_dir != DMA_TO_DEVICE &&
 	    pagelistinfo->pages_need_release) {
 		unsigned int i;
 
@@ -532,9 +639,114 @@ free_pagelist(struct vchiq_instance *instance, struct vchiq_pagelist_info *pagel
 			set_page_dirty(pages[i]);
 	}
 
+	if (pagelistinfo->registered) {
+		mutex_lock(&instance->registered_buffers_mutex);
+		pagelistinfo->registered->in_use = false;
+		mutex_unlock(&instance->registered_buffers_mutex);
+		wake_up_var(&pagelistinfo->registered->in_use);
+		return;
+	}
+
 	cleanup_pagelistinfo(instance, pagelistinfo);
 }
 
+int
+vchiq_register_bulk_buffer(struct vchiq_instance *instance, void __user *ubuf,
+			   unsigned int size)
+{
+	struct vchiq_registered_buffer *reg, *iter;
+	struct vchiq_pagelist_info *pagelistinfo;
+	int ret = 0;
+
+	if (!size)
+		return -EINVAL;
+
+	reg = kzalloc(sizeof(*reg), GFP_KERNEL);
+	if (!reg)
+		return -ENOMEM;
+
+	/*
+	 * The buffer may be used in either direction and stays pinned for as
+	 * long as it is registered.
+	 */
+	pagelistinfo = __create_pagelist(instance, NULL, ubuf, size,
+					 PAGELIST_WRITE, DMA_BIDIRECTIONAL,
+					 FOLL_WRITE | FOLL_LONGTERM);
+	if (!pagelistinfo) {
+		kfree(reg);
+		return -ENOMEM;
+	}
+
+	pagelistinfo->registered = reg;
+	reg->ubuf = ubuf;
+	reg->size = size;
+	reg->pagelistinfo = pagelistinfo;
+
+	mutex_lock(&instance->registered_buffers_mutex);
+	list_for_each_entry(iter, &instance->registered_buffers, list) {
+		if (iter->ubuf == ubuf) {
+			ret = -EEXIST;
+			break;
+		}
+	}
+	if (!ret)
+		list_add(&reg->list, &instance->registered_buffers);
+	mutex_unlock(&instance->registered_buffers_mutex);
+
+	if (ret) {
+		cleanup_pagelistinfo(instance, pagelistinfo);
+		kfree(reg);
+	}
+
+	return ret;
+}
+
+int
+vchiq_unregister_bulk_buffer(struct vchiq_instance *instance, void __user *ubuf)
+{
+	struct vchiq_registered_buffer *reg = NULL, *iter;
+	int ret = -EINVAL;
+
+	mutex_lock(&instance->registered_buffers_mutex);
+	list_for_each_entry(iter, &instance->registered_buffers, list) {
+		if (iter->ubuf != ubuf)
+			continue;
+		if (iter->in_use) {
+			ret = -EBUSY;
+		} else {
+			list_del(&iter->list);
+			reg = iter;
+			ret = 0;
+		}
+		break;
+	}
+	mutex_unlock(&instance->registered_buffers_mutex);
+
+	if (reg) {
+		cleanup_pagelistinfo(instance, reg->pagelistinfo);
+		kfree(reg);
+	}
+
+	return ret;
+}
+
+void
+vchiq_free_registered_buffers(struct vchiq_instance *instance)
+{
+	struct vchiq_registered_buffer *reg, *tmp;
+
+	list_for_each_entry_safe(reg, tmp, &instance->registered_buffers, list) {
+		/*
+		 * The services are closed by now, so any bulk transfer still
+		 * using the buffer is on its way to free_pagelist().
+		 */
+		wait_var_event(&reg->in_use, !READ_ONCE(reg->in_use));
+		list_del(&reg->list);
+		cleanup_pagelistinfo(instance, reg->pagelistinfo);
+		kfree(reg);
+	}
+}
+
 static int vchiq_platform_init(struct platform_device *pdev, struct vchiq_state *state)
 {
 	struct device *dev = &pdev->dev;
@@ -700,7 +912,7 @@ static struct vchiq_arm_state *vchiq_platform_get_arm_state(struct vchiq_state *
 	return &platform_state->arm_state;
 }
 
-void
+int
 remote_event_signal(struct remote_event *event)
 {
 	/*
@@ -713,20 +925,32 @@ remote_event_signal(struct remote_event *event)
 
 	dsb(sy);         /* data barrier operation */
 
-	if (event->armed)
+	if (event->armed) {
 		writel(0, g_regs + BELL2); /* trigger vc interrupt */
+		return 1;
+	}
+
+	return 0;
 }
 
 int
 vchiq_prepare_bulk_data(struct vchiq_instance *instance, struct vchiq_bulk *bulk, void *offset,
 			void __user *uoffset, int size, int dir)
 {
-	struct vchiq_pagelist_info *pagelistinfo;
+	struct vchiq_pagelist_info *pagelistinfo = NULL;
+	unsigned short type = (dir == VCHIQ_BULK_RECEIVE) ?
+			      PAGELIST_READ : PAGELIST_WRITE;
+
+	if (uoffset) {
+		pagelistinfo = get_registered_pagelist(instance, uoffset,
+						       size, type);
+		if (IS_ERR(pagelistinfo))
+			return PTR_ERR(pagelistinfo);
+	}
 
-	pagelistinfo = create_pagelist(instance, offset, uoffset, size,
-				       (dir == VCHIQ_BULK_RECEIVE)
-				       ? PAGELIST_READ
-				       : PAGELIST_WRITE);
+	if (!pagelistinfo)
+		pagelistinfo = create_pagelist(instance, offset, uoffset,
+					       size, type);
 
 	if (!pagelistinfo)
 		return -ENOMEM;
@@ -797,6 +1021,8 @@ int vchiq_initialise(struct vchiq_instance **instance_out)
 	instance->connected = 0;
 	instance->state = state;
 	mutex_init(&instance->bulk_waiter_list_mutex);
+	INIT_LIST_HEAD(&instance->registered_buffers);
+	mutex_init(&instance->registered_buffers_mutex);
 	INIT_LIST_HEAD(&instance->bulk_waiter_list);
 
 	*instance_out = instance;
@@ -66,6 +66,9 @@ struct vchiq_instance {
 	struct list_head bulk_waiter_list;
 	struct mutex bulk_waiter_list_mutex;
 
+	struct list_head registered_buffers;
+	struct mutex registered_buffers_mutex;
+
 	struct vchiq_debugfs_node debugfs_node;
 };
 
@@ -144,4 +147,14 @@ service_callback(struct vchiq_instance *vchiq_instance, enum vchiq_reason reason
 extern void
 free_bulk_waiter(struct vchiq_instance *instance);
 
+extern int
+vchiq_register_bulk_buffer(struct vchiq_instance *instance, void __user *ubuf,
+			   unsigned int size);
+
+extern int
+vchiq_unregister_bulk_buffer(struct vchiq_instance *instance, void __user *ubuf);
+
+extern void
+vchiq_free_registered_buffers(struct vchiq_instance *instance);
+
 #endif /* VCHIQ_ARM_H */
@@ -10,6 +10,7 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/kref.h>
+#include <linux/moduleparam.h>
 #include <linux/rcupdate.h>
 #include <linux/sched/signal.h>
 
@@ -159,6 +160,28 @@ int vchiq_core_log_level = VCHIQ_LOG_DEFAULT;
 int vchiq_core_msg_log_level = VCHIQ_LOG_DEFAULT;
 int vchiq_sync_log_level = VCHIQ_LOG_DEFAULT;
 
+/*
+ * Opt-in interrupt mitigation. With tx_batch set, up to that many data
+ * messages are queued before the VPU is signalled, and a pending batch is
+ * flushed after tx_batch_usecs at the latest. With rx_poll_usecs set, the
+ * slot handler stops arming its trigger after a busy pass and polls the
+ * remote tx_pos at that interval until a pass finds less than
+ * VCHIQ_RX_POLL_WEIGHT messages.
+ */
+static unsigned int tx_batch;
+module_param(tx_batch, uint, 0644);
+MODULE_PARM_DESC(tx_batch, "Data messages to coalesce per doorbell (0 = off)");
+
+static unsigned int tx_batch_usecs = 100;
+module_param(tx_batch_usecs, uint, 0644);
+MODULE_PARM_DESC(tx_batch_usecs, "Maximum delay of a batched doorbell");
+
+static unsigned int rx_poll_usecs;
+module_param(rx_poll_usecs, uint, 0644);
+MODULE_PARM_DESC(rx_poll_usecs, "Receive polling interval under load (0 = off)");
+
+#define VCHIQ_RX_POLL_WEIGHT 16
+
 DEFINE_SPINLOCK(bulk_waiter_spinlock);
 static DEFINE_SPINLOCK(quota_spinlock);
 
@@ -560,6 +583,57 @@ remote_event_pollall(struct vchiq_state *state)
 	remote_event_poll(&state->recycle_event, &state->local->recycle);
 }
 
+static void
+signal_remote_trigger(struct vchiq_state *state)
+{
+	atomic_long_inc(&state->traffic.tx_signals);
+	if (remote_event_signal(&state->remote->trigger))
+		atomic_long_inc(&state->traffic.tx_doorbells);
+}
+
+static enum hrtimer_restart
+tx_batch_expired(struct hrtimer *timer)
+{
+	struct vchiq_state *state =
+		container_of(timer, struct vchiq_state, tx_batch_timer);
+
+	if (atomic_xchg(&state->tx_batched, 0))
+		signal_remote_trigger(state);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Called with slot_mutex held once a message has been made visible to the
+ * peer. Returns true if the remote trigger must be signalled now; otherwise
+ * the message joins the current batch, which tx_batch_timer flushes.
+ */
+static bool
+tx_batch_message(struct vchiq_state *state, int type)
+{
+	unsigned int limit = READ_ONCE(tx_batch);
+	int batched;
+
+	atomic_long_inc(&state->traffic.tx_msgs);
+
+	if (limit > 1 && type == VCHIQ_MSG_DATA) {
+		batched = atomic_inc_return(&state->tx_batched);
+		if (batched < limit) {
+			if (batched == 1)
+				hrtimer_start(&state->tx_batch_timer,
+					      us_to_ktime(READ_ONCE(tx_batch_usecs)),
+					      HRTIMER_MODE_REL);
+			return false;
+		}
+	}
+
+	/* Anything else flushes the batch along with it */
+	if (atomic_xchg(&state->tx_batched, 0))
+		hrtimer_try_to_cancel(&state->tx_batch_timer);
+
+	return true;
+}
+
 /*
  * Round up message sizes so that any space at the end of a slot is always big
  * enough for a header. This relies on header size being a power of two, which
@@ -695,7 +769,7 @@ reserve_space(struct vchiq_state *state, size_t space, int is_blocking)
 			/* But first, flush through the last slot. */
 			state->local_tx_pos = tx_pos;
 			local->tx_pos = tx_pos;
-			remote_event_signal(&state->remote->trigger);
+			signal_remote_trigger(state);
 
 			if (!is_blocking ||
 			    (wait_for_completion_interruptible(&state->slot_available_event)))
@@ -911,6 +985,7 @@ queue_message(struct vchiq_state *state, struct vchiq_service *service,
 	struct vchiq_service_quota *quota = NULL;
 	struct vchiq_header *header;
 	int type = VCHIQ_MSG_TYPE(msgid);
+	bool signal;
 
 	size_t stride;
 
@@ -1130,10 +1205,13 @@ queue_message(struct vchiq_state *state, struct vchiq_service *service,
 	if (service && (type == VCHIQ_MSG_CLOSE))
 		set_service_state(service, VCHIQ_SRVSTATE_CLOSESENT);
 
+	signal = tx_batch_message(state, type);
+
 	if (!(flags & QMFLAGS_NO_MUTEX_UNLOCK))
 		mutex_unlock(&state->slot_mutex);
 
-	remote_event_signal(&state->remote->trigger);
+	if (signal)
+		signal_remote_trigger(state);
 
 	return VCHIQ_SUCCESS;
 }
@@ -1843,12 +1921,13 @@ parse_message(struct vchiq_state *state, struct vchiq_header *header)
 	return ret;
 }
 
-/* Called by the slot handler thread */
-static void
+/* Called by the slot handler thread; returns the number of messages parsed */
+static int
 parse_rx_slots(struct vchiq_state *state)
 {
 	struct vchiq_shared_state *remote = state->remote;
 	int tx_pos;
+	int count = 0;
 
 	DEBUG_INITIALISE(state->local);
 
@@ -1882,9 +1961,10 @@ parse_rx_slots(struct vchiq_state *state)
 			(state->rx_pos & VCHIQ_SLOT_MASK));
 		size = parse_message(state, header);
 		if (size < 0)
-			return;
+			break;
 
 		state->rx_pos += calc_stride(size);
+		count++;
 
 		DEBUG_TRACE(PARSE_LINE);
 		/*
@@ -1897,6 +1977,10 @@ parse_rx_slots(struct vchiq_state *state)
 			state->rx_data = NULL;
 		}
 	}
+
+	atomic_long_add(count, &state->traffic.rx_msgs);
+
+	return count;
 }
 
 /**
@@ -1954,13 +2038,27 @@ slot_handler_func(void *v)
 {
 	struct vchiq_state *state = v;
 	struct vchiq_shared_state *local = state->local;
+	unsigned int poll_usecs = 0;
 
 	DEBUG_INITIALISE(local);
 
 	while (1) {
 		DEBUG_COUNT(SLOT_HANDLER_COUNT);
 		DEBUG_TRACE(SLOT_HANDLER_LINE);
-		remote_event_wait(&state->trigger_event, &local->trigger);
+		if (poll_usecs) {
+			/*
+			 * Leave the trigger unarmed so the VPU doesn't ring the
+			 * doorbell, and pick up whatever it has queued since
+			 * the last pass. Clear fired first so that nothing
+			 * signalled from here on is lost when we next wait.
+			 */
+			usleep_range(poll_usecs, 2 * poll_usecs);
+			local->trigger.fired = 0;
+			mb();
+			atomic_long_inc(&state->traffic.rx_polls);
+		} else {
+			remote_event_wait(&state->trigger_event, &local->trigger);
+		}
 
 		/* Ensure that reads don't overtake the remote_event_wait. */
 		rmb();
@@ -1978,7 +2076,10 @@ slot_handler_func(void *v)
 		}
 
 		DEBUG_TRACE(SLOT_HANDLER_LINE);
-		parse_rx_slots(state);
+		if (parse_rx_slots(state) >= VCHIQ_RX_POLL_WEIGHT)
+			poll_usecs = READ_ONCE(rx_poll_usecs);
+		else
+			poll_usecs = 0;
 	}
 	return 0;
 }
@@ -2201,6 +2302,9 @@ vchiq_init_state(struct vchiq_state *state, struct vchiq_slot_zero *slot_zero, s
 	init_completion(&state->slot_remove_event);
 	init_completion(&state->data_quota_event);
 
+	hrtimer_init(&state->tx_batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	state->tx_batch_timer.function = tx_batch_expired;
+
 	state->slot_queue_available = 0;
 
 	for (i = 0; i < VCHIQ_MAX_SERVICES; i++) {
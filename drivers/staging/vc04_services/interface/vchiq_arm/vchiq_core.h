@@ -4,8 +4,10 @@
 #ifndef VCHIQ_CORE_H
 #define VCHIQ_CORE_H
 
+#include <linux/atomic.h>
 #include <linux/mutex.h>
 #include <linux/completion.h>
+#include <linux/hrtimer.h>
 #include <linux/kthread.h>
 #include <linux/kref.h>
 #include <linux/rcupdate.h>
@@ -418,6 +420,20 @@ struct vchiq_state {
 		int error_count;
 	} stats;
 
+	/* Message and doorbell traffic, reported through debugfs */
+	struct vchiq_traffic_stats {
+		atomic_long_t tx_msgs;
+		atomic_long_t tx_signals;
+		atomic_long_t tx_doorbells;
+		atomic_long_t rx_msgs;
+		atomic_long_t rx_doorbells;
+		atomic_long_t rx_polls;
+	} traffic;
+
+	/* Data messages queued since the remote trigger was last signalled */
+	atomic_t tx_batched;
+	struct hrtimer tx_batch_timer;
+
 	struct vchiq_service __rcu *services[VCHIQ_MAX_SERVICES];
 	struct vchiq_service_quota service_quotas[VCHIQ_MAX_SERVICES];
 	struct vchiq_slot_info slot_info[VCHIQ_MAX_SLOTS];
@@ -548,7 +564,7 @@ int vchiq_prepare_bulk_data(struct vchiq_instance *instance, struct vchiq_bulk *
 
 void vchiq_complete_bulk(struct vchiq_instance *instance, struct vchiq_bulk *bulk);
 
-void remote_event_signal(struct remote_event *event);
+int remote_event_signal(struct remote_event *event);
 
 int vchiq_dump(void *dump_context, const char *str, int len);
 
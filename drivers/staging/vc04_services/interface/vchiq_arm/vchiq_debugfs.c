@@ -109,6 +109,26 @@ static const struct file_operations debugfs_log_fops = {
 	.release	= single_release,
 };
 
+static int debugfs_traffic_show(struct seq_file *f, void *offset)
+{
+	struct vchiq_state *state = vchiq_get_state();
+	struct vchiq_traffic_stats *traffic;
+
+	if (!state)
+		return -ENOTCONN;
+
+	traffic = &state->traffic;
+	seq_printf(f, "tx_msgs: %ld\n", atomic_long_read(&traffic->tx_msgs));
+	seq_printf(f, "tx_signals: %ld\n", atomic_long_read(&traffic->tx_signals));
+	seq_printf(f, "tx_doorbells: %ld\n", atomic_long_read(&traffic->tx_doorbells));
+	seq_printf(f, "rx_msgs: %ld\n", atomic_long_read(&traffic->rx_msgs));
+	seq_printf(f, "rx_doorbells: %ld\n", atomic_long_read(&traffic->rx_doorbells));
+	seq_printf(f, "rx_polls: %ld\n", atomic_long_read(&traffic->rx_polls));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(debugfs_traffic);
+
 static int debugfs_usecount_show(struct seq_file *f, void *offset)
 {
 	struct vchiq_instance *instance = f->private;
@@ -210,6 +230,8 @@ void vchiq_debugfs_init(void)
 
 	vchiq_dbg_dir = debugfs_create_dir("vchiq", NULL);
 	vchiq_dbg_clients = debugfs_create_dir("clients", vchiq_dbg_dir);
+	debugfs_create_file("traffic", 0444, vchiq_dbg_dir, NULL,
+			    &debugfs_traffic_fops);
 
 	/* create an entry under <debugfs>/vchiq/log for each log category */
 	dir = debugfs_create_dir("log", vchiq_dbg_dir);
@@ -80,6 +80,11 @@ struct vchiq_dump_mem {
 	size_t    num_bytes;
 };
 
+struct vchiq_bulk_buffer {
+	void __user *data;
+	unsigned int size;
+};
+
 #define VCHIQ_IOC_CONNECT              _IO(VCHIQ_IOC_MAGIC,   0)
 #define VCHIQ_IOC_SHUTDOWN             _IO(VCHIQ_IOC_MAGIC,   1)
 #define VCHIQ_IOC_CREATE_SERVICE \
@@ -107,6 +112,10 @@ struct vchiq_dump_mem {
 	_IOW(VCHIQ_IOC_MAGIC,  15, struct vchiq_dump_mem)
 #define VCHIQ_IOC_LIB_VERSION          _IO(VCHIQ_IOC_MAGIC,   16)
 #define VCHIQ_IOC_CLOSE_DELIVERED      _IO(VCHIQ_IOC_MAGIC,   17)
-#define VCHIQ_IOC_MAX                  17
+#define VCHIQ_IOC_REGISTER_BULK_BUFFER \
+	_IOW(VCHIQ_IOC_MAGIC,  18, struct vchiq_bulk_buffer)
+#define VCHIQ_IOC_UNREGISTER_BULK_BUFFER \
+	_IOW(VCHIQ_IOC_MAGIC,  19, struct vchiq_bulk_buffer)
+#define VCHIQ_IOC_MAX                  19
 
 #endif
@@ -36,6 +36,7 @@
 #include <linux/fs.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
 #include <linux/mm.h>
@@ -66,6 +67,7 @@ MODULE_IMPORT_NS(DMA_BUF);
 
 #define VC_SM_DIR_ROOT_NAME	"vcsm-cma"
 #define VC_SM_STATE		"state"
+#define VC_SM_IMPORT_CACHE	"import_cache"
 
 /* Private file data associated with each opened device. */
 struct vc_sm_privdata_t {
@@ -101,6 +103,13 @@ struct sm_state_t {
 	struct vc_sm_privdata_t *vpu_allocs; /* All allocations from the VPU */
 	struct dentry *dir_root;	/* Debug fs entries root. */
 	struct sm_pde_t dir_state;	/* Debug fs entries state sub-tree. */
+	struct sm_pde_t dir_import_cache; /* Debug fs import cache stats. */
+
+	struct mutex import_cache_lock;	/* Protects the import cache. */
+	struct list_head import_cache;	/* Imported buffers, MRU first. */
+	unsigned int import_cache_len;
+	u64 import_cache_hits;
+	u64 import_cache_misses;
 
 	bool require_released_callback;	/* VPU will send a released msg when it
 					 * has finished with a resource.
@@ -223,6 +232,96 @@ static int vc_sm_cma_global_state_show(struct seq_file *s, void *v)
 	return 0;
 }
 
+static int vc_sm_cma_import_cache_show(struct seq_file *s, void *v)
+{
+	u64 hits, lookups;
+
+	if (!sm_state)
+		return 0;
+
+	mutex_lock(&sm_state->import_cache_lock);
+	hits = sm_state->import_cache_hits;
+	lookups = hits + sm_state->import_cache_misses;
+	seq_printf(s, "entries:   %u\n", sm_state->import_cache_len);
+	seq_printf(s, "hits:      %llu\n", hits);
+	seq_printf(s, "misses:    %llu\n", sm_state->import_cache_misses);
+	seq_printf(s, "hit rate:  %llu%%\n",
+		   lookups ? div64_u64(hits * 100, lookups) : 0);
+	mutex_unlock(&sm_state->import_cache_lock);
+
+	return 0;
+}
+
+/*
+ * Imported dma_bufs are looked up in the import cache, so that importing the
+ * same dma_buf again (as V4L2 M2M users do every frame) hands back the
+ * existing wrapper, still mapped on the VPU, instead of creating a new VPU
+ * handle. The cache holds no reference: an entry lives exactly as long as
+ * its wrapper, which is what pins the source dma_buf and so keeps the source
+ * pointer a stable key. vc_sm_dma_buf_release() drops the entry.
+ */
+
+/* Returns a new reference on the cached wrapper of @src, if there is one. */
+static struct dma_buf *vc_sm_import_cache_lookup(struct dma_buf *src)
+{
+	struct vc_sm_buffer *buffer;
+	struct dma_buf *found = NULL;
+
+	mutex_lock(&sm_state->import_cache_lock);
+	list_for_each_entry(buffer, &sm_state->import_cache,
+			    import_cache_list) {
+		if (buffer->import.dma_buf != src)
+			continue;
+
+		/* The wrapper may be on its way to being released */
+		if (buffer->vpu_state == VPU_MAPPED &&
+		    get_file_rcu(buffer->dma_buf->file)) {
+			found = buffer->dma_buf;
+			list_move(&buffer->import_cache_list,
+				  &sm_state->import_cache);
+		}
+		break;
+	}
+
+	if (found)
+		sm_state->import_cache_hits++;
+	else
+		sm_state->import_cache_misses++;
+	mutex_unlock(&sm_state->import_cache_lock);
+
+	return found;
+}
+
+static void vc_sm_import_cache_add(struct vc_sm_buffer *buffer)
+{
+	mutex_lock(&sm_state->import_cache_lock);
+	list_add(&buffer->import_cache_list, &sm_state->import_cache);
+	sm_state->import_cache_len++;
+	mutex_unlock(&sm_state->import_cache_lock);
+}
+
+static void vc_sm_import_cache_del(struct vc_sm_buffer *buffer)
+{
+	mutex_lock(&sm_state->import_cache_lock);
+	if (!list_empty(&buffer->import_cache_list)) {
+		list_del_init(&buffer->import_cache_list);
+		sm_state->import_cache_len--;
+	}
+	mutex_unlock(&sm_state->import_cache_lock);
+}
+
+static void vc_sm_import_cache_flush(void)
+{
+	struct vc_sm_buffer *buffer, *tmp;
+
+	mutex_lock(&sm_state->import_cache_lock);
+	list_for_each_entry_safe(buffer, tmp, &sm_state->import_cache,
+				 import_cache_list)
+		list_del_init(&buffer->import_cache_list);
+	sm_state->import_cache_len = 0;
+	mutex_unlock(&sm_state->import_cache_lock);
+}
+
 /*
  * Adds a buffer to the private data list which tracks all the allocated
  * data.
@@ -529,6 +628,9 @@ static void vc_sm_dma_buf_release(struct dma_buf *dmabuf)
 
 	buffer = (struct vc_sm_buffer *)dmabuf->priv;
 
+	if (buffer->imported)
+		vc_sm_import_cache_del(buffer);
+
 	mutex_lock(&buffer->lock);
 
 	pr_debug("%s dmabuf %p, buffer %p\n", __func__, dmabuf, buffer);
@@ -738,6 +840,14 @@ vc_sm_cma_import_dmabuf_internal(struct vc_sm_privdata_t *private,
 	if (!dma_buf)
 		return -EINVAL;
 
+	*imported_buf = vc_sm_import_cache_lookup(dma_buf);
+	if (*imported_buf) {
+		pr_debug("%s: dma_buf %p found in import cache\n", __func__,
+			 dma_buf);
+		dma_buf_put(dma_buf);
+		return 0;
+	}
+
 	attach = dma_buf_attach(dma_buf, &sm_state->pdev->dev);
 	if (IS_ERR(attach)) {
 		ret = PTR_ERR(attach);
@@ -804,6 +914,7 @@ vc_sm_cma_import_dmabuf_internal(struct vc_sm_privdata_t *private,
 
 	mutex_init(&buffer->lock);
 	INIT_LIST_HEAD(&buffer->attachments);
+	INIT_LIST_HEAD(&buffer->import_cache_list);
 	memcpy(buffer->name, import.name,
 	       min(sizeof(buffer->name), sizeof(import.name) - 1));
 
@@ -839,6 +950,7 @@ vc_sm_cma_import_dmabuf_internal(struct vc_sm_privdata_t *private,
 	}
 
 	vc_sm_add_resource(private, buffer);
+	vc_sm_import_cache_add(buffer);
 
 	*imported_buf = buffer->dma_buf;
 
@@ -1536,6 +1648,13 @@ static void vc_sm_connected_init(void)
 				    &sm_state->dir_state,
 				    &vc_sm_cma_debug_fs_fops);
 
+	sm_state->dir_import_cache.show = &vc_sm_cma_import_cache_show;
+	sm_state->dir_import_cache.dir_entry =
+		debugfs_create_file(VC_SM_IMPORT_CACHE, 0444,
+				    sm_state->dir_root,
+				    &sm_state->dir_import_cache,
+				    &vc_sm_cma_debug_fs_fops);
+
 	INIT_LIST_HEAD(&sm_state->buffer_list);
 
 	/* Create a shared memory device. */
@@ -1589,6 +1708,8 @@ static int bcm2835_vc_sm_cma_probe(struct platform_device *pdev)
 		return -ENOMEM;
 	sm_state->pdev = pdev;
 	mutex_init(&sm_state->map_lock);
+	mutex_init(&sm_state->import_cache_lock);
+	INIT_LIST_HEAD(&sm_state->import_cache);
 
 	spin_lock_init(&sm_state->kernelid_map_lock);
 	idr_init_base(&sm_state->kernelid_map, 1);
@@ -1610,6 +1731,9 @@ static int bcm2835_vc_sm_cma_remove(struct platform_device *pdev)
 	if (sm_inited) {
 		misc_deregister(&sm_state->misc_dev);
 
+		/* Forget the imports that are still alive. */
+		vc_sm_import_cache_flush();
+
 		/* Remove all proc entries. */
 		debugfs_remove_recursive(sm_state->dir_root);
 
@@ -1621,6 +1745,7 @@ static int bcm2835_vc_sm_cma_remove(struct platform_device *pdev)
 		idr_destroy(&sm_state->kernelid_map);
 
 		/* Free the memory for the state structure. */
+		mutex_destroy(&sm_state->import_cache_lock);
 		mutex_destroy(&sm_state->map_lock);
 	}
 
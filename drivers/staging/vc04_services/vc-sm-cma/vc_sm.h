@@ -75,6 +75,9 @@ struct vc_sm_buffer {
 
 	struct vc_sm_privdata_t *private;
 
+	/* Entry in the import cache, which holds a reference on dma_buf */
+	struct list_head import_cache_list;
+
 	union {
 		struct vc_sm_alloc_data alloc;
 		struct vc_sm_imported import;
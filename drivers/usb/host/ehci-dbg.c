@@ -412,6 +412,13 @@ static void qh_lines(struct ehci_hcd *ehci, struct ehci_qh *qh,
 	size -= temp;
 	next += temp;
 
+#ifdef EHCI_STATS
+	temp = scnprintf(next, size, " done %lu noirq %lu err %lu",
+			qh->done, qh->done_no_ioc, qh->done_error);
+	size -= temp;
+	next += temp;
+#endif
+
 	/* hc may be modifying the list as we read it ... */
 	list_for_each(entry, &qh->qtd_list) {
 		char *type;
@@ -281,6 +281,21 @@ ehci_urb_done(struct ehci_hcd *ehci, struct urb *urb, int status)
 
 static int qh_schedule (struct ehci_hcd *ehci, struct ehci_qh *qh);
 
+static inline void
+qh_urb_done(struct ehci_hcd *ehci, struct ehci_qh *qh, struct urb *urb,
+		int status)
+{
+#ifdef EHCI_STATS
+	/* URB_NO_INTERRUPT urbs piggyback on a later urb's IOC */
+	INCR(qh->done);
+	if (urb->transfer_flags & URB_NO_INTERRUPT)
+		INCR(qh->done_no_ioc);
+	if (status != -EINPROGRESS && status != -EREMOTEIO && status != 0)
+		INCR(qh->done_error);
+#endif
+	ehci_urb_done(ehci, urb, status);
+}
+
 /*
  * Process and free completed qtds for a qh, returning URBs to drivers.
  * Chases up to qh->hw_current.  Returns nonzero if the caller should
@@ -331,7 +346,7 @@ qh_completions (struct ehci_hcd *ehci, struct ehci_qh *qh)
 		/* clean up any state from previous QTD ...*/
 		if (last) {
 			if (likely (last->urb != urb)) {
-				ehci_urb_done(ehci, last->urb, last_status);
+				qh_urb_done(ehci, qh, last->urb, last_status);
 				last_status = -EINPROGRESS;
 			}
 			ehci_qtd_free (ehci, last);
@@ -509,7 +524,7 @@ qh_completions (struct ehci_hcd *ehci, struct ehci_qh *qh)
 
 	/* last urb's completion might still need calling */
 	if (likely (last != NULL)) {
-		ehci_urb_done(ehci, last->urb, last_status);
+		qh_urb_done(ehci, qh, last->urb, last_status);
 		ehci_qtd_free (ehci, last);
 	}
 
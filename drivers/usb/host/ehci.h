@@ -442,6 +442,13 @@ struct ehci_qh {
 	unsigned		clearing_tt:1;	/* Clear-TT-Buf in progress */
 	unsigned		dequeue_during_giveback:1;
 	unsigned		should_be_inactive:1;
+
+#ifdef EHCI_STATS
+	/* per-endpoint completions, shown in the async debug file */
+	unsigned long		done;		/* urbs given back */
+	unsigned long		done_no_ioc;	/* ... queued with URB_NO_INTERRUPT */
+	unsigned long		done_error;	/* ... with an error status */
+#endif
 };
 
 /*-------------------------------------------------------------------------*/
@@ -32,6 +32,7 @@
 #include <linux/rbtree.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/mm.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/vfio.h>
@@ -61,6 +62,11 @@ module_param_named(dma_entry_limit, dma_entry_limit, uint, 0644);
 MODULE_PARM_DESC(dma_entry_limit,
 		 "Maximum number of user DMA mappings per container (65535).");
 
+static unsigned int prefault_threads = 8;
+module_param_named(prefault_threads, prefault_threads, uint, 0644);
+MODULE_PARM_DESC(prefault_threads,
+		 "Threads faulting in large DMA mappings before they are pinned, 0 to disable (8).");
+
 struct vfio_iommu {
 	struct list_head	domain_list;
 	struct list_head	iova_list;
@@ -662,6 +668,44 @@ static int vfio_wait_all_valid(struct vfio_iommu *iommu)
 	return ret;
 }
 
+/*
+ * Number of pages starting at the batch offset, at most @max, that are
+ * physically contiguous within one folio.  They share the folio's
+ * reserved state, so they can be accounted for as a single run.
+ */
+static long vfio_batch_folio_run(struct vfio_batch *batch, long max)
+{
+	struct page *page = batch->pages[batch->offset];
+	struct folio *folio = page_folio(page);
+	long nr, i;
+
+	nr = min_t(long, max, folio_nr_pages(folio) -
+			      folio_page_idx(folio, page));
+	for (i = 1; i < nr; i++) {
+		if (batch->pages[batch->offset + i] != nth_page(page, i))
+			break;
+	}
+
+	return i;
+}
+
+/* Number of pages in [iova, iova + npage) already pinned externally */
+static long vfio_count_vpfns(struct vfio_dma *dma, dma_addr_t iova,
+			     long npage)
+{
+	long i, nr = 0;
+
+	if (RB_EMPTY_ROOT(&dma->pfn_list))
+		return 0;
+
+	for (i = 0; i < npage; i++, iova += PAGE_SIZE) {
+		if (vfio_find_vpfn(dma, iova))
+			nr++;
+	}
+
+	return nr;
+}
+
 /*
  * Attempt to pin pages.  We really don't want to track all the pfns and
  * the iommu can only map chunks of consecutive pfns anyway, so get the
@@ -718,32 +762,41 @@ static long vfio_pin_pages_remote(struct vfio_dma *dma, unsigned long vaddr,
 		 * !VM_PFNMAP vma.
 		 */
 		while (true) {
+			long nr = 1;
+
 			if (pfn != *pfn_base + pinned ||
 			    rsvd != is_invalid_reserved_pfn(pfn))
 				goto out;
 
+			/* Consume the rest of a huge page in one step. */
+			if (batch->size > 1 && !rsvd)
+				nr = vfio_batch_folio_run(batch,
+						min_t(long, npage, batch->size));
+
 			/*
 			 * Reserved pages aren't counted against the user,
 			 * externally pinned pages are already counted against
 			 * the user.
 			 */
-			if (!rsvd && !vfio_find_vpfn(dma, iova)) {
+			if (!rsvd) {
+				long acct = nr - vfio_count_vpfns(dma, iova, nr);
+
 				if (!dma->lock_cap &&
-				    mm->locked_vm + lock_acct + 1 > limit) {
+				    mm->locked_vm + lock_acct + acct > limit) {
 					pr_warn("%s: RLIMIT_MEMLOCK (%ld) exceeded\n",
 						__func__, limit << PAGE_SHIFT);
 					ret = -ENOMEM;
 					goto unpin_out;
 				}
-				lock_acct++;
+				lock_acct += acct;
 			}
 
-			pinned++;
-			npage--;
-			vaddr += PAGE_SIZE;
-			iova += PAGE_SIZE;
-			batch->offset++;
-			batch->size--;
+			pinned += nr;
+			npage -= nr;
+			vaddr += nr << PAGE_SHIFT;
+			iova += (dma_addr_t)nr << PAGE_SHIFT;
+			batch->offset += nr;
+			batch->size -= nr;
 
 			if (!batch->size)
 				break;
@@ -1528,6 +1581,112 @@ static int vfio_iommu_map(struct vfio_iommu *iommu, dma_addr_t iova,
 	return ret;
 }
 
+/*
+ * Faulting in and zeroing guest memory dominates pinning large maps.
+ * Fault disjoint chunks of the range in on a few threads first, so
+ * the serial pin and map loop mostly finds pages already present.
+ * Pages are pinned FOLL_LONGTERM, and so migrated where a long term
+ * pin needs them, and then released again. Errors are left for the
+ * serial pass to report.
+ */
+#define VFIO_PREFAULT_CHUNK	SZ_256M
+#define VFIO_PREFAULT_MIN_SIZE	SZ_1G
+
+struct vfio_prefault {
+	struct mm_struct	*mm;
+	unsigned long		vaddr;
+	size_t			size;
+	unsigned int		gup_flags;
+	unsigned int		nr_chunks;
+	atomic_t		next_chunk;
+};
+
+struct vfio_prefault_work {
+	struct work_struct	work;
+	struct vfio_prefault	*pf;
+};
+
+static void vfio_prefault_chunks(struct vfio_prefault *pf)
+{
+	struct page **pages;
+	unsigned int i;
+
+	pages = (struct page **)__get_free_page(GFP_KERNEL);
+	if (!pages)
+		return;
+
+	while ((i = atomic_fetch_inc(&pf->next_chunk)) < pf->nr_chunks) {
+		unsigned long vaddr = pf->vaddr + (unsigned long)i *
+						  VFIO_PREFAULT_CHUNK;
+		unsigned long end = min_t(unsigned long,
+					  vaddr + VFIO_PREFAULT_CHUNK,
+					  pf->vaddr + pf->size);
+
+		while (vaddr < end) {
+			long npages = min_t(long, (end - vaddr) >> PAGE_SHIFT,
+					    VFIO_BATCH_MAX_CAPACITY);
+			long ret;
+
+			mmap_read_lock(pf->mm);
+			ret = pin_user_pages_remote(pf->mm, vaddr, npages,
+						    pf->gup_flags, pages,
+						    NULL, NULL);
+			mmap_read_unlock(pf->mm);
+			if (ret <= 0)
+				break;
+
+			unpin_user_pages(pages, ret);
+			vaddr += ret << PAGE_SHIFT;
+			cond_resched();
+		}
+	}
+
+	free_page((unsigned long)pages);
+}
+
+static void vfio_prefault_work_fn(struct work_struct *work)
+{
+	struct vfio_prefault_work *pw =
+		container_of(work, struct vfio_prefault_work, work);
+
+	vfio_prefault_chunks(pw->pf);
+}
+
+static void vfio_prefault_range(unsigned long vaddr, size_t size, int prot)
+{
+	struct vfio_prefault_work *works;
+	struct vfio_prefault pf;
+	unsigned int i, nr_works;
+
+	if (!prefault_threads || size < VFIO_PREFAULT_MIN_SIZE || !current->mm)
+		return;
+
+	pf.mm = current->mm;
+	pf.vaddr = vaddr;
+	pf.size = size;
+	pf.gup_flags = FOLL_LONGTERM | (prot & IOMMU_WRITE ? FOLL_WRITE : 0);
+	pf.nr_chunks = DIV_ROUND_UP(size, VFIO_PREFAULT_CHUNK);
+	atomic_set(&pf.next_chunk, 0);
+
+	/* The calling thread takes part, so ask for one worker less */
+	nr_works = min3(prefault_threads, num_online_cpus(), pf.nr_chunks) - 1;
+	works = nr_works ? kcalloc(nr_works, sizeof(*works), GFP_KERNEL) : NULL;
+	if (!works)
+		nr_works = 0;
+
+	for (i = 0; i < nr_works; i++) {
+		INIT_WORK(&works[i].work, vfio_prefault_work_fn);
+		works[i].pf = &pf;
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	vfio_prefault_chunks(&pf);
+
+	for (i = 0; i < nr_works; i++)
+		flush_work(&works[i].work);
+	kfree(works);
+}
+
 static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
 			    size_t map_size)
 {
@@ -1540,6 +1699,7 @@ static int vfio_pin_map_dma(struct vfio_iommu *iommu, struct vfio_dma *dma,
 	int ret = 0;
 
 	vfio_batch_init(&batch);
+	vfio_prefault_range(vaddr + dma->size, map_size, dma->prot);
 
 	while (size) {
 		/* Pin a contiguous chunk of memory */
@@ -21,32 +21,44 @@ struct virtio_input {
 	bool                       ready;
 };
 
-static void virtinput_queue_evtbuf(struct virtio_input *vi,
-				   struct virtio_input_event *evtbuf)
+/* Event buffers reaped and requeued per virtqueue call */
+#define VIRTINPUT_EVT_BATCH	16
+
+static void virtinput_queue_evtbufs(struct virtio_input *vi,
+				    struct virtio_input_event **evtbufs,
+				    unsigned int num)
 {
-	struct scatterlist sg[1];
+	struct scatterlist sg[VIRTINPUT_EVT_BATCH];
+	struct scatterlist *sgs[VIRTINPUT_EVT_BATCH];
+	unsigned int i;
 
-	sg_init_one(sg, evtbuf, sizeof(*evtbuf));
-	virtqueue_add_inbuf(vi->evt, sg, 1, evtbuf, GFP_ATOMIC);
+	for (i = 0; i < num; i++) {
+		sg_init_one(&sg[i], evtbufs[i], sizeof(*evtbufs[i]));
+		sgs[i] = &sg[i];
+	}
+	virtqueue_add_inbufs(vi->evt, sgs, (void **)evtbufs, num, GFP_ATOMIC);
 }
 
 static void virtinput_recv_events(struct virtqueue *vq)
 {
 	struct virtio_input *vi = vq->vdev->priv;
-	struct virtio_input_event *event;
+	struct virtio_input_event *events[VIRTINPUT_EVT_BATCH];
+	unsigned int lens[VIRTINPUT_EVT_BATCH];
 	unsigned long flags;
-	unsigned int len;
+	unsigned int i, n;
 
 	spin_lock_irqsave(&vi->lock, flags);
 	if (vi->ready) {
-		while ((event = virtqueue_get_buf(vi->evt, &len)) != NULL) {
+		while ((n = virtqueue_get_bufs(vi->evt, (void **)events, lens,
+					       ARRAY_SIZE(events)))) {
 			spin_unlock_irqrestore(&vi->lock, flags);
-			input_event(vi->idev,
-				    le16_to_cpu(event->type),
-				    le16_to_cpu(event->code),
-				    le32_to_cpu(event->value));
+			for (i = 0; i < n; i++)
+				input_event(vi->idev,
+					    le16_to_cpu(events[i]->type),
+					    le16_to_cpu(events[i]->code),
+					    le32_to_cpu(events[i]->value));
 			spin_lock_irqsave(&vi->lock, flags);
-			virtinput_queue_evtbuf(vi, event);
+			virtinput_queue_evtbufs(vi, events, n);
 		}
 		virtqueue_kick(vq);
 	}
@@ -202,15 +214,20 @@ static int virtinput_init_vqs(struct virtio_input *vi)
 
 static void virtinput_fill_evt(struct virtio_input *vi)
 {
+	struct virtio_input_event *evtbufs[VIRTINPUT_EVT_BATCH];
 	unsigned long flags;
-	int i, size;
+	int i, j, n, size;
 
 	spin_lock_irqsave(&vi->lock, flags);
 	size = virtqueue_get_vring_size(vi->evt);
 	if (size > ARRAY_SIZE(vi->evts))
 		size = ARRAY_SIZE(vi->evts);
-	for (i = 0; i < size; i++)
-		virtinput_queue_evtbuf(vi, &vi->evts[i]);
+	for (i = 0; i < size; i += n) {
+		n = min_t(int, size - i, VIRTINPUT_EVT_BATCH);
+		for (j = 0; j < n; j++)
+			evtbufs[j] = &vi->evts[i + j];
+		virtinput_queue_evtbufs(vi, evtbufs, n);
+	}
 	virtqueue_kick(vi->evt);
 	spin_unlock_irqrestore(&vi->lock, flags);
 }
@@ -139,6 +139,14 @@ struct vring_virtqueue_packed {
 	 */
 	u16 event_flags_shadow;
 
+	/*
+	 * First descriptor list of a batched add, made available only
+	 * when the batch ends.
+	 */
+	bool batch_pending;
+	u16 batch_head;
+	__le16 batch_flags;
+
 	/* Per-descriptor state. */
 	struct vring_desc_state_packed *desc_state;
 	struct vring_desc_extra *desc_extra;
@@ -160,6 +168,9 @@ struct vring_virtqueue {
 	/* Is DMA API used? */
 	bool use_dma_api;
 
+	/* Do the drivers map the buffers themselves? */
+	bool premapped;
+
 	/* Can we use weak barriers? */
 	bool weak_barriers;
 
@@ -172,6 +183,9 @@ struct vring_virtqueue {
 	/* Host publishes avail event idx */
 	bool event;
 
+	/* Within virtqueue_add_batch(): defer exposing the buffers. */
+	bool batch_add;
+
 	/* Head of free buffer list. */
 	unsigned int free_head;
 	/* Number we've added since last sync. */
@@ -363,6 +377,10 @@ static dma_addr_t vring_map_one_sg(const struct vring_virtqueue *vq,
 		return (dma_addr_t)sg_phys(sg);
 	}
 
+	/* The driver owns the mapping, see virtqueue_set_dma_premapped(). */
+	if (vq->premapped)
+		return sg_dma_address(sg);
+
 	/*
 	 * We can't use dma_map_sg, because we don't use scatterlists in
 	 * the way it expects (we don't guarantee that the scatterlist
@@ -421,7 +439,7 @@ static void vring_unmap_one_split_indirect(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = virtio16_to_cpu(vq->vq.vdev, desc->flags);
@@ -450,7 +468,7 @@ static unsigned int vring_unmap_one_split(const struct vring_virtqueue *vq,
 				 extra[i].len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra[i].addr,
 			       extra[i].len,
@@ -514,6 +532,16 @@ static inline unsigned int virtqueue_add_desc_split(struct virtqueue *vq,
 	return next;
 }
 
+/* Expose the available array entries added so far to the device. */
+static inline void virtqueue_publish_split(struct vring_virtqueue *vq)
+{
+	/* Descriptors and available array need to be set before we expose the
+	 * new available array entries. */
+	virtio_wmb(vq->weak_barriers);
+	vq->split.vring.avail->idx = cpu_to_virtio16(vq->vq.vdev,
+						vq->split.avail_idx_shadow);
+}
+
 static inline int virtqueue_add_split(struct virtqueue *_vq,
 				      struct scatterlist *sgs[],
 				      unsigned int total_sg,
@@ -654,12 +682,9 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 	avail = vq->split.avail_idx_shadow & (vq->split.vring.num - 1);
 	vq->split.vring.avail->ring[avail] = cpu_to_virtio16(_vq->vdev, head);
 
-	/* Descriptors and available array need to be set before we expose the
-	 * new available array entries. */
-	virtio_wmb(vq->weak_barriers);
 	vq->split.avail_idx_shadow++;
-	vq->split.vring.avail->idx = cpu_to_virtio16(_vq->vdev,
-						vq->split.avail_idx_shadow);
+	if (likely(!vq->batch_add))
+		virtqueue_publish_split(vq);
 	vq->num_added++;
 
 	pr_debug("Added buffer head %i to %p\n", head, vq);
@@ -667,8 +692,11 @@ static inline int virtqueue_add_split(struct virtqueue *_vq,
 
 	/* This is very unlikely, but theoretically possible.  Kick
 	 * just in case. */
-	if (unlikely(vq->num_added == (1 << 16) - 1))
+	if (unlikely(vq->num_added == (1 << 16) - 1)) {
+		if (vq->batch_add)
+			virtqueue_publish_split(vq);
 		virtqueue_kick(_vq);
+	}
 
 	return 0;
 
@@ -842,6 +870,64 @@ static void *virtqueue_get_buf_ctx_split(struct virtqueue *_vq,
 	return ret;
 }
 
+static unsigned int virtqueue_get_bufs_split(struct virtqueue *_vq,
+					     void **bufs, unsigned int *lens,
+					     unsigned int num)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int i, n = 0;
+	u16 used_idx, last_used;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return 0;
+	}
+
+	used_idx = virtio16_to_cpu(_vq->vdev, vq->split.vring.used->idx);
+	if (used_idx == vq->last_used_idx) {
+		END_USE(vq);
+		return 0;
+	}
+
+	/* Only get used array entries after they have been exposed by host. */
+	virtio_rmb(vq->weak_barriers);
+
+	while (n < num && vq->last_used_idx != used_idx) {
+		last_used = (vq->last_used_idx & (vq->split.vring.num - 1));
+		i = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].id);
+		lens[n] = virtio32_to_cpu(_vq->vdev,
+				vq->split.vring.used->ring[last_used].len);
+
+		if (unlikely(i >= vq->split.vring.num)) {
+			BAD_RING(vq, "id %u out of range\n", i);
+			break;
+		}
+		if (unlikely(!vq->split.desc_state[i].data)) {
+			BAD_RING(vq, "id %u is not a head!\n", i);
+			break;
+		}
+
+		/* detach_buf_split clears data, so grab it now. */
+		bufs[n++] = vq->split.desc_state[i].data;
+		detach_buf_split(vq, i, NULL);
+		vq->last_used_idx++;
+	}
+
+	/* Tell the host where we expect the next interrupt, once. */
+	if (n && !(vq->split.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT))
+		virtio_store_mb(vq->weak_barriers,
+				&vring_used_event(&vq->split.vring),
+				cpu_to_virtio16(_vq->vdev, vq->last_used_idx));
+
+	LAST_ADD_TIME_INVALID(vq);
+
+	END_USE(vq);
+	return n;
+}
+
 static void virtqueue_disable_cb_split(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -1193,7 +1279,7 @@ static void vring_unmap_extra_packed(const struct vring_virtqueue *vq,
 				 extra->addr, extra->len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra->addr, extra->len,
 			       (flags & VRING_DESC_F_WRITE) ?
@@ -1206,7 +1292,7 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = le16_to_cpu(desc->flags);
@@ -1235,6 +1321,33 @@ static struct vring_packed_desc *alloc_indirect_packed(unsigned int total_sg,
 	return desc;
 }
 
+/*
+ * Make the descriptor list at @head available.  Within a batched add only
+ * the first list is held back, and made available with a single barrier by
+ * virtqueue_add_batch(): the device can't consume the later lists before
+ * it, so they need no barrier of their own.
+ */
+static inline void virtqueue_publish_packed(struct vring_virtqueue *vq,
+					    u16 head, __le16 flags)
+{
+	if (vq->batch_add) {
+		if (!vq->packed.batch_pending) {
+			vq->packed.batch_pending = true;
+			vq->packed.batch_head = head;
+			vq->packed.batch_flags = flags;
+			return;
+		}
+	} else {
+		/*
+		 * A driver MUST NOT make the first descriptor in the list
+		 * available before all subsequent descriptors comprising
+		 * the list are made available.
+		 */
+		virtio_wmb(vq->weak_barriers);
+	}
+	vq->packed.vring.desc[head].flags = flags;
+}
+
 static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 					 struct scatterlist *sgs[],
 					 unsigned int total_sg,
@@ -1300,14 +1413,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						  vq->packed.avail_used_flags;
 	}
 
-	/*
-	 * A driver MUST NOT make the first descriptor in the list
-	 * available before all subsequent descriptors comprising
-	 * the list are made available.
-	 */
-	virtio_wmb(vq->weak_barriers);
-	vq->packed.vring.desc[head].flags = cpu_to_le16(VRING_DESC_F_INDIRECT |
-						vq->packed.avail_used_flags);
+	virtqueue_publish_packed(vq, head, cpu_to_le16(VRING_DESC_F_INDIRECT |
+						vq->packed.avail_used_flags));
 
 	/* We're using some buffers from the free list. */
 	vq->vq.num_free -= 1;
@@ -1465,13 +1572,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
 
-	/*
-	 * A driver MUST NOT make the first descriptor in the list
-	 * available before all subsequent descriptors comprising
-	 * the list are made available.
-	 */
-	virtio_wmb(vq->weak_barriers);
-	vq->packed.vring.desc[head].flags = head_flags;
+	virtqueue_publish_packed(vq, head, head_flags);
 	vq->num_added += descs_used;
 
 	pr_debug("Added buffer head %i to %p\n", head, vq);
@@ -1689,6 +1790,67 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	return ret;
 }
 
+static unsigned int virtqueue_get_bufs_packed(struct virtqueue *_vq,
+					      void **bufs, unsigned int *lens,
+					      unsigned int num)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	u16 last_used, id, last_used_idx;
+	bool used_wrap_counter;
+	unsigned int n = 0;
+
+	START_USE(vq);
+
+	if (unlikely(vq->broken)) {
+		END_USE(vq);
+		return 0;
+	}
+
+	while (n < num && more_used_packed(vq)) {
+		/* Only get used elements after they have been exposed by host. */
+		virtio_rmb(vq->weak_barriers);
+
+		last_used_idx = READ_ONCE(vq->last_used_idx);
+		used_wrap_counter = packed_used_wrap_counter(last_used_idx);
+		last_used = packed_last_used(last_used_idx);
+		id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+		lens[n] = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+
+		if (unlikely(id >= vq->packed.vring.num)) {
+			BAD_RING(vq, "id %u out of range\n", id);
+			break;
+		}
+		if (unlikely(!vq->packed.desc_state[id].data)) {
+			BAD_RING(vq, "id %u is not a head!\n", id);
+			break;
+		}
+
+		/* detach_buf_packed clears data, so grab it now. */
+		bufs[n++] = vq->packed.desc_state[id].data;
+		detach_buf_packed(vq, id, NULL);
+
+		last_used += vq->packed.desc_state[id].num;
+		if (unlikely(last_used >= vq->packed.vring.num)) {
+			last_used -= vq->packed.vring.num;
+			used_wrap_counter ^= 1;
+		}
+
+		last_used = (last_used | (used_wrap_counter << VRING_PACKED_EVENT_F_WRAP_CTR));
+		WRITE_ONCE(vq->last_used_idx, last_used);
+	}
+
+	/* Tell the host where we expect the next interrupt, once. */
+	if (n && vq->packed.event_flags_shadow == VRING_PACKED_EVENT_FLAG_DESC)
+		virtio_store_mb(vq->weak_barriers,
+				&vq->packed.vring.driver->off_wrap,
+				cpu_to_le16(vq->last_used_idx));
+
+	LAST_ADD_TIME_INVALID(vq);
+
+	END_USE(vq);
+	return n;
+}
+
 static void virtqueue_disable_cb_packed(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
@@ -1962,6 +2124,7 @@ static void virtqueue_vring_init_packed(struct vring_virtqueue_packed *vring_pac
 	vring_packed->next_avail_idx = 0;
 	vring_packed->avail_wrap_counter = 1;
 	vring_packed->event_flags_shadow = 0;
+	vring_packed->batch_pending = false;
 	vring_packed->avail_used_flags = 1 << VRING_PACKED_DESC_F_AVAIL;
 
 	/* No callback?  Tell other side not to bother us. */
@@ -2031,6 +2194,8 @@ static struct virtqueue *vring_create_virtqueue_packed(
 #endif
 	vq->packed_ring = true;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->batch_add = false;
+	vq->premapped = false;
 
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
@@ -2216,6 +2381,84 @@ int virtqueue_add_inbuf_ctx(struct virtqueue *vq,
 }
 EXPORT_SYMBOL_GPL(virtqueue_add_inbuf_ctx);
 
+static int virtqueue_add_batch(struct virtqueue *_vq,
+			       struct scatterlist *sgs[], void *data[],
+			       unsigned int num, bool out, gfp_t gfp)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	unsigned int i;
+	int err = 0;
+
+	vq->batch_add = true;
+	for (i = 0; i < num; i++) {
+		err = virtqueue_add(_vq, &sgs[i], sg_nents(sgs[i]),
+				    out, !out, data[i], NULL, gfp);
+		if (err)
+			break;
+	}
+	vq->batch_add = false;
+
+	if (vq->packed_ring) {
+		if (vq->packed.batch_pending) {
+			virtio_wmb(vq->weak_barriers);
+			vq->packed.vring.desc[vq->packed.batch_head].flags =
+				vq->packed.batch_flags;
+			vq->packed.batch_pending = false;
+		}
+	} else if (i) {
+		virtqueue_publish_split(vq);
+	}
+
+	return i ? i : err;
+}
+
+/**
+ * virtqueue_add_outbufs - expose several output buffers to other end
+ * @vq: the struct virtqueue we're talking about.
+ * @sgs: array of @num scatterlists (each well-formed and terminated!)
+ * @data: array of @num tokens identifying the buffers.
+ * @num: the number of buffers.
+ * @gfp: how to do memory allocations (if necessary).
+ *
+ * Like @num virtqueue_add_outbuf() calls, one per scatterlist, but the
+ * buffers are exposed to the device with a single barrier and available
+ * index (or descriptor flags) update.
+ *
+ * Caller must ensure we don't call this with other virtqueue operations
+ * at the same time (except where noted).
+ *
+ * Returns the number of buffers added, which is short of @num if the ring
+ * filled up, or a negative error (ie. ENOSPC, ENOMEM, EIO) if none was.
+ */
+int virtqueue_add_outbufs(struct virtqueue *vq,
+			  struct scatterlist *sgs[], void *data[],
+			  unsigned int num, gfp_t gfp)
+{
+	return virtqueue_add_batch(vq, sgs, data, num, true, gfp);
+}
+EXPORT_SYMBOL_GPL(virtqueue_add_outbufs);
+
+/**
+ * virtqueue_add_inbufs - expose several input buffers to other end
+ * @vq: the struct virtqueue we're talking about.
+ * @sgs: array of @num scatterlists (each well-formed and terminated!)
+ * @data: array of @num tokens identifying the buffers.
+ * @num: the number of buffers.
+ * @gfp: how to do memory allocations (if necessary).
+ *
+ * Batched virtqueue_add_inbuf(), see virtqueue_add_outbufs().
+ *
+ * Returns the number of buffers added, which is short of @num if the ring
+ * filled up, or a negative error (ie. ENOSPC, ENOMEM, EIO) if none was.
+ */
+int virtqueue_add_inbufs(struct virtqueue *vq,
+			 struct scatterlist *sgs[], void *data[],
+			 unsigned int num, gfp_t gfp)
+{
+	return virtqueue_add_batch(vq, sgs, data, num, false, gfp);
+}
+EXPORT_SYMBOL_GPL(virtqueue_add_inbufs);
+
 /**
  * virtqueue_kick_prepare - first half of split virtqueue_kick call.
  * @_vq: the struct virtqueue
@@ -2312,6 +2555,32 @@ void *virtqueue_get_buf(struct virtqueue *_vq, unsigned int *len)
 	return virtqueue_get_buf_ctx(_vq, len, NULL);
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_buf);
+
+/**
+ * virtqueue_get_bufs - get up to @num used buffers
+ * @_vq: the struct virtqueue we're talking about.
+ * @bufs: array receiving the "data" tokens handed to virtqueue_add_*()
+ * @lens: array receiving the lengths written into the buffers
+ * @num: size of @bufs and @lens
+ *
+ * Like calling virtqueue_get_buf() until it returns NULL or @num buffers
+ * were returned, but the event index is only updated once at the end and,
+ * for split rings, the used index is only read once.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ *
+ * Returns the number of buffers returned in @bufs.
+ */
+unsigned int virtqueue_get_bufs(struct virtqueue *_vq, void **bufs,
+				unsigned int *lens, unsigned int num)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	return vq->packed_ring ? virtqueue_get_bufs_packed(_vq, bufs, lens, num) :
+				 virtqueue_get_bufs_split(_vq, bufs, lens, num);
+}
+EXPORT_SYMBOL_GPL(virtqueue_get_bufs);
 /**
  * virtqueue_disable_cb - disable callbacks
  * @_vq: the struct virtqueue we're talking about.
@@ -2518,6 +2787,8 @@ static struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->broken = false;
 #endif
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->batch_add = false;
+	vq->premapped = false;
 
 	vq->indirect = virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC) &&
 		!context;
@@ -2736,6 +3007,63 @@ void vring_transport_features(struct virtio_device *vdev)
 }
 EXPORT_SYMBOL_GPL(vring_transport_features);
 
+/**
+ * virtqueue_set_dma_premapped - let the driver own the buffer DMA mappings
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * In premapped mode virtio_ring neither maps nor unmaps the buffers handed
+ * to virtqueue_add_*(): the driver fills in sg_dma_address() of every
+ * scatterlist entry with an address mapped for virtqueue_dma_dev(), and may
+ * keep that mapping across requests, e.g. for page_pool pages.  Indirect
+ * descriptor tables are still mapped by virtio_ring.
+ *
+ * Must be called before any buffer is added.
+ *
+ * Caller must ensure we don't call this with other virtqueue
+ * operations at the same time (except where noted).
+ *
+ * Returns zero, -EINVAL if the device doesn't use the DMA API or -EBUSY if
+ * buffers are outstanding.
+ */
+int virtqueue_set_dma_premapped(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	u32 num;
+
+	START_USE(vq);
+
+	num = vq->packed_ring ? vq->packed.vring.num : vq->split.vring.num;
+	if (num != vq->vq.num_free) {
+		END_USE(vq);
+		return -EBUSY;
+	}
+
+	if (!vq->use_dma_api) {
+		END_USE(vq);
+		return -EINVAL;
+	}
+
+	vq->premapped = true;
+
+	END_USE(vq);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(virtqueue_set_dma_premapped);
+
+/**
+ * virtqueue_dma_dev - get the device premapped buffers are mapped for
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Returns the DMA device, or NULL if the device doesn't use the DMA API.
+ */
+struct device *virtqueue_dma_dev(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	return vq->use_dma_api ? vring_dma_dev(vq) : NULL;
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_dev);
+
 /**
  * virtqueue_get_vring_size - return the size of the virtqueue's vring
  * @_vq: the struct virtqueue containing the vring of interest.
@@ -27,11 +27,8 @@
 #include "cache.h"
 #include "fid.h"
 
-/**
- * v9fs_issue_read - Issue a read from 9P
- * @subreq: The read to make
- */
-static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
+static void __v9fs_issue_read(struct netfs_io_subrequest *subreq,
+			      bool was_async)
 {
 	struct netfs_io_request *rreq = subreq->rreq;
 	struct p9_fid *fid = rreq->netfs_priv;
@@ -48,7 +45,55 @@ static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
 	 * cache won't be on server and is zeroes */
 	__set_bit(NETFS_SREQ_CLEAR_TAIL, &subreq->flags);
 
-	netfs_subreq_terminated(subreq, err ?: total, false);
+	netfs_subreq_terminated(subreq, err ?: total, was_async);
+}
+
+static void v9fs_issue_read_work(struct work_struct *work)
+{
+	struct netfs_io_subrequest *subreq =
+		container_of(work, struct netfs_io_subrequest, work);
+
+	__v9fs_issue_read(subreq, true);
+}
+
+/**
+ * v9fs_issue_read - Issue a read from 9P
+ * @subreq: The read to make
+ *
+ * Readahead is split into one subrequest per Tread by v9fs_clamp_length();
+ * issue those from a workqueue so that they are all in flight on the
+ * transport together instead of costing a round trip each in turn.
+ */
+static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
+{
+	if (subreq->rreq->origin == NETFS_READAHEAD) {
+		INIT_WORK(&subreq->work, v9fs_issue_read_work);
+		queue_work(system_unbound_wq, &subreq->work);
+		return;
+	}
+
+	__v9fs_issue_read(subreq, false);
+}
+
+/**
+ * v9fs_clamp_length - Limit a readahead subrequest to a single Tread
+ * @subreq: The read to limit
+ */
+static bool v9fs_clamp_length(struct netfs_io_subrequest *subreq)
+{
+	struct p9_fid *fid = subreq->rreq->netfs_priv;
+	size_t rsize;
+
+	if (subreq->rreq->origin != NETFS_READAHEAD)
+		return true;
+
+	rsize = fid->clnt->msize - P9_IOHDRSZ;
+	if (fid->iounit && fid->iounit < rsize)
+		rsize = fid->iounit;
+	rsize = max_t(size_t, round_down(rsize, PAGE_SIZE), PAGE_SIZE);
+
+	subreq->len = min(subreq->len, rsize);
+	return true;
 }
 
 /**
@@ -108,6 +153,7 @@ const struct netfs_request_ops v9fs_req_ops = {
 	.init_request		= v9fs_init_request,
 	.free_request		= v9fs_free_request,
 	.begin_cache_operation	= v9fs_begin_cache_operation,
+	.clamp_length		= v9fs_clamp_length,
 	.issue_read		= v9fs_issue_read,
 };
 
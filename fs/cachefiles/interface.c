@@ -88,6 +88,7 @@ void cachefiles_put_object(struct cachefiles_object *object,
 		ASSERTCMP(object->file, ==, NULL);
 
 		kfree(object->d_name);
+		bitmap_free(object->present);
 
 		cache = object->volume->cache->cache;
 		fscache_put_cookie(object->cookie, fscache_cookie_put_object);
@@ -235,6 +236,11 @@ static bool cachefiles_shorten_object(struct cachefiles_object *object,
 	dio_size = round_up(new_size, CACHEFILES_DIO_BLOCK_SIZE);
 	i_size = i_size_read(inode);
 
+	/* The map describes the current backing file only */
+	if (file == READ_ONCE(object->file))
+		cachefiles_clear_present(object, new_size,
+					 LLONG_MAX - new_size);
+
 	trace_cachefiles_trunc(object, inode, i_size, dio_size,
 			       cachefiles_trunc_shrink);
 	ret = cachefiles_inject_remove_error();
@@ -402,8 +408,15 @@ static bool cachefiles_invalidate_cookie(struct fscache_cookie *cookie)
 	spin_lock(&object->lock);
 
 	old_file = object->file;
-	object->file = new_file;
+	WRITE_ONCE(object->file, new_file);
 	object->content_info = CACHEFILES_CONTENT_NO_DATA;
+	/*
+	 * Writes to the old file that complete from here on see the new
+	 * file and don't mark anything, see cachefiles_mark_present().
+	 */
+	smp_mb();
+	if (object->present)
+		bitmap_zero(object->present, CACHEFILES_PRESENT_MAX);
 	set_bit(CACHEFILES_OBJECT_USING_TMPFILE, &object->flags);
 	set_bit(FSCACHE_COOKIE_NEEDS_UPDATE, &object->cookie->flags);
 
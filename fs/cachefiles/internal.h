@@ -60,13 +60,33 @@ struct cachefiles_object {
 	enum cachefiles_content		content_info:8;	/* Info about content presence */
 	unsigned long			flags;
 #define CACHEFILES_OBJECT_USING_TMPFILE	0		/* Have an unlinked tmpfile */
+	unsigned long			*present;	/* Granules known to be fully cached */
 #ifdef CONFIG_CACHEFILES_ONDEMAND
 	int				ondemand_id;
+	loff_t				ondemand_ra_end;	/* End of the last READ window */
+	size_t				ondemand_ra_size;	/* Size of the last READ window */
 #endif
 };
 
 #define CACHEFILES_ONDEMAND_ID_CLOSED	-1
 
+/*
+ * Upper bound of the range asked of the daemon by one on-demand READ request,
+ * reached by growing the window on sequential misses or by merging misses
+ * into a request the daemon hasn't picked up yet.
+ */
+#define CACHEFILES_ONDEMAND_RA_MAX	(4UL << 20)
+
+/*
+ * In-memory presence map granularity.  Each bit in object->present covers one
+ * granule and is set only once the whole granule has been written to the
+ * backing file, letting reads skip SEEK_DATA/SEEK_HOLE.  Offsets beyond the
+ * end of the map fall back to querying the backing filesystem.
+ */
+#define CACHEFILES_PRESENT_SHIFT	18		/* 256KiB granules */
+#define CACHEFILES_PRESENT_GRANULE	(1UL << CACHEFILES_PRESENT_SHIFT)
+#define CACHEFILES_PRESENT_MAX		8192		/* Granules tracked (2GiB) */
+
 /*
  * Cache files cache definition
  */
@@ -125,6 +145,7 @@ static inline bool cachefiles_in_ondemand_mode(struct cachefiles_cache *cache)
 struct cachefiles_req {
 	struct cachefiles_object *object;
 	struct completion done;
+	refcount_t ref;		/* sender plus READ misses waiting on it */
 	int error;
 	struct cachefiles_msg msg;
 };
@@ -241,6 +262,8 @@ extern int __cachefiles_write(struct cachefiles_object *object,
 			      struct iov_iter *iter,
 			      netfs_io_terminated_t term_func,
 			      void *term_func_priv);
+extern void cachefiles_clear_present(struct cachefiles_object *object,
+				     loff_t start, loff_t len);
 
 /*
  * key.c
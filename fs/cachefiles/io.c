@@ -248,6 +248,72 @@ static int cachefiles_query_occupancy(struct netfs_cache_resources *cres,
 	return 0;
 }
 
+/*
+ * Note that a range of the backing file has been written.  Only granules that
+ * are entirely covered are marked as present, and only if @file is still the
+ * object's backing file: a write to the file replaced by invalidation may
+ * complete after the map was cleared for the new one.
+ */
+static void cachefiles_mark_present(struct cachefiles_object *object,
+				    struct file *file, loff_t start, loff_t len)
+{
+	unsigned long first, last, i;
+
+	if (!object->present || len <= 0 || READ_ONCE(object->file) != file)
+		return;
+
+	first = round_up(start, CACHEFILES_PRESENT_GRANULE) >> CACHEFILES_PRESENT_SHIFT;
+	last = (start + len) >> CACHEFILES_PRESENT_SHIFT;
+	last = min_t(unsigned long, last, CACHEFILES_PRESENT_MAX);
+	for (i = first; i < last; i++)
+		set_bit(i, object->present);
+
+	/* Pairs with smp_mb() in cachefiles_invalidate_cookie(). */
+	smp_mb();
+	if (unlikely(READ_ONCE(object->file) != file))
+		for (i = first; i < last; i++)
+			clear_bit(i, object->present);
+}
+
+/*
+ * Note that a range of the backing file may no longer hold data.  Any granule
+ * the range touches is dropped from the presence map.
+ */
+void cachefiles_clear_present(struct cachefiles_object *object,
+			      loff_t start, loff_t len)
+{
+	unsigned long first, last;
+
+	if (!object->present || len <= 0)
+		return;
+
+	first = start >> CACHEFILES_PRESENT_SHIFT;
+	if (first >= CACHEFILES_PRESENT_MAX)
+		return;
+	last = min_t(loff_t, CACHEFILES_PRESENT_MAX,
+		     (start + len - 1) / CACHEFILES_PRESENT_GRANULE + 1);
+	for (; first < last; first++)
+		clear_bit(first, object->present);
+}
+
+/*
+ * See if the presence map says the whole of a read is cached.
+ */
+static bool cachefiles_range_present(struct cachefiles_object *object,
+				     loff_t start, size_t len)
+{
+	unsigned long first, last;
+
+	if (!object->present || len == 0)
+		return false;
+
+	first = start >> CACHEFILES_PRESENT_SHIFT;
+	last = (start + len - 1) >> CACHEFILES_PRESENT_SHIFT;
+	if (last >= CACHEFILES_PRESENT_MAX)
+		return false;
+	return find_next_zero_bit(object->present, last + 1, first) > last;
+}
+
 /*
  * Handle completion of a write to the cache.
  */
@@ -266,6 +332,9 @@ static void cachefiles_write_complete(struct kiocb *iocb, long ret)
 	if (ret < 0)
 		trace_cachefiles_io_error(object, inode, ret,
 					  cachefiles_trace_write_error);
+	else
+		cachefiles_mark_present(object, ki->iocb.ki_filp, ki->start,
+					ret);
 
 	atomic_long_sub(ki->b_writing, &object->volume->cache->b_writing);
 	set_bit(FSCACHE_COOKIE_HAVE_DATA, &object->cookie->flags);
@@ -298,6 +367,19 @@ int __cachefiles_write(struct cachefiles_object *object,
 	       file, file_inode(file)->i_ino, start_pos, len,
 	       i_size_read(file_inode(file)));
 
+	/* The presence map is allocated on first write and lives as long as
+	 * the object.  Failing to get it just means we keep asking the backing
+	 * filesystem.
+	 */
+	if (!READ_ONCE(object->present) &&
+	    start_pos < (loff_t)CACHEFILES_PRESENT_MAX * CACHEFILES_PRESENT_GRANULE) {
+		unsigned long *present = bitmap_zalloc(CACHEFILES_PRESENT_MAX,
+						       GFP_NOFS);
+
+		if (present && cmpxchg(&object->present, NULL, present))
+			bitmap_free(present);
+	}
+
 	ki = kzalloc(sizeof(struct cachefiles_kiocb), GFP_KERNEL);
 	if (!ki) {
 		if (term_func)
@@ -433,6 +515,13 @@ static enum netfs_io_source cachefiles_prepare_read(struct netfs_io_subrequest *
 
 	object = cachefiles_cres_object(cres);
 	cache = object->volume->cache;
+
+	if (cachefiles_range_present(object, subreq->start, subreq->len)) {
+		why = cachefiles_trace_read_have_map;
+		ret = NETFS_READ_FROM_CACHE;
+		goto out_no_object;
+	}
+
 	cachefiles_begin_secure(cache, &saved_cred);
 retry:
 	off = cachefiles_inject_read_error();
@@ -560,6 +649,7 @@ int __cachefiles_prepare_write(struct cachefiles_object *object,
 
 	/* Partially allocated, but insufficient space: cull. */
 	fscache_count_no_write_space();
+	cachefiles_clear_present(object, *_start, *_len);
 	ret = cachefiles_inject_remove_error();
 	if (ret == 0)
 		ret = vfs_fallocate(file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
@@ -24,7 +24,7 @@ static int cachefiles_ondemand_fd_release(struct inode *inode,
 		if (req->msg.object_id == object_id &&
 		    req->msg.opcode == CACHEFILES_OP_READ) {
 			req->error = -EIO;
-			complete(&req->done);
+			complete_all(&req->done);
 			xas_store(&xas, NULL);
 		}
 	}
@@ -97,7 +97,7 @@ static long cachefiles_ondemand_fd_ioctl(struct file *filp, unsigned int ioctl,
 		return -EINVAL;
 
 	trace_cachefiles_ondemand_cread(object, id);
-	complete(&req->done);
+	complete_all(&req->done);
 	return 0;
 }
 
@@ -300,10 +300,16 @@ ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
 error:
 	xa_erase(&cache->reqs, id);
 	req->error = ret;
-	complete(&req->done);
+	complete_all(&req->done);
 	return ret;
 }
 
+static void cachefiles_req_put(struct cachefiles_req *req)
+{
+	if (refcount_dec_and_test(&req->ref))
+		kfree(req);
+}
+
 typedef int (*init_req_fn)(struct cachefiles_req *req, void *private);
 
 static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
@@ -329,6 +335,7 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 
 	req->object = object;
 	init_completion(&req->done);
+	refcount_set(&req->ref, 1);
 	req->msg.opcode = opcode;
 	req->msg.len = sizeof(struct cachefiles_msg) + data_len;
 
@@ -388,7 +395,7 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 	wait_for_completion(&req->done);
 	ret = req->error;
 out:
-	kfree(req);
+	cachefiles_req_put(req);
 	return ret;
 }
 
@@ -503,10 +510,117 @@ void cachefiles_ondemand_clean_object(struct cachefiles_object *object)
 			cachefiles_ondemand_init_close_req, NULL);
 }
 
+/*
+ * Size the READ request for a miss at @pos.  Misses continuing the previous
+ * window of the object double it, up to CACHEFILES_ONDEMAND_RA_MAX, so that
+ * a blob read sequentially is fetched by the daemon in a few large ranges
+ * rather than one small range per miss; any other miss starts over from the
+ * length actually needed.
+ */
+static size_t cachefiles_ondemand_ra_len(struct cachefiles_object *object,
+					 loff_t pos, size_t len)
+{
+	loff_t object_size = object->cookie->object_size;
+	size_t ra_len = len;
+
+	spin_lock(&object->lock);
+	if (object->ondemand_ra_size &&
+	    pos >= object->ondemand_ra_end - object->ondemand_ra_size &&
+	    pos <= object->ondemand_ra_end)
+		ra_len = clamp_t(size_t, object->ondemand_ra_size * 2, len,
+				 max_t(size_t, len, CACHEFILES_ONDEMAND_RA_MAX));
+
+	/* never ask for anything past the end of the blob */
+	if (object_size > pos && ra_len > object_size - pos)
+		ra_len = max_t(size_t, len, object_size - pos);
+
+	object->ondemand_ra_size = ra_len;
+	object->ondemand_ra_end = pos + ra_len;
+	spin_unlock(&object->lock);
+
+	return ra_len;
+}
+
+/*
+ * Find a READ request of @object which already covers [@pos, @pos + @len),
+ * or one the daemon hasn't picked up yet that touches the range and can be
+ * extended to cover it, so that concurrent misses on a blob are batched into
+ * one request and completed by a single READ_COMPLETE from the daemon.
+ *
+ * Returns the request with a reference held, or NULL if a new request has to
+ * be sent.
+ */
+static struct cachefiles_req *
+cachefiles_ondemand_join_read(struct cachefiles_object *object,
+			      loff_t pos, size_t len, size_t ra_len)
+{
+	struct cachefiles_cache *cache = object->volume->cache;
+	struct cachefiles_read *load;
+	struct cachefiles_req *req;
+	unsigned long index;
+	loff_t start, end;
+
+	if (!test_bit(CACHEFILES_ONDEMAND_MODE, &cache->flags))
+		return NULL;
+
+	xa_lock(&cache->reqs);
+	/* flushed requests are completed but not erased, don't pick them */
+	if (test_bit(CACHEFILES_DEAD, &cache->flags) ||
+	    object->ondemand_id <= 0)
+		goto out;
+
+	xa_for_each(&cache->reqs, index, req) {
+		if (req->msg.opcode != CACHEFILES_OP_READ ||
+		    req->msg.object_id != object->ondemand_id)
+			continue;
+
+		load = (void *)req->msg.data;
+		if (load->off <= pos && load->off + load->len >= pos + len)
+			goto found;
+
+		/* the daemon copies the message only once the mark is gone */
+		if (!xa_get_mark(&cache->reqs, index, CACHEFILES_REQ_NEW) ||
+		    pos > load->off + load->len || pos + len < load->off)
+			continue;
+
+		start = min_t(loff_t, load->off, pos);
+		end = max_t(loff_t, load->off + load->len, pos + ra_len);
+		end = max_t(loff_t, min_t(loff_t, end,
+					  start + CACHEFILES_ONDEMAND_RA_MAX),
+			    load->off + load->len);
+		if (end < pos + len)
+			continue;
+
+		load->off = start;
+		load->len = end - start;
+		goto found;
+	}
+out:
+	xa_unlock(&cache->reqs);
+	return NULL;
+
+found:
+	refcount_inc(&req->ref);
+	xa_unlock(&cache->reqs);
+	return req;
+}
+
 int cachefiles_ondemand_read(struct cachefiles_object *object,
 			     loff_t pos, size_t len)
 {
 	struct cachefiles_read_ctx read_ctx = {pos, len};
+	struct cachefiles_req *req;
+	int ret;
+
+	read_ctx.len = cachefiles_ondemand_ra_len(object, pos, len);
+
+	req = cachefiles_ondemand_join_read(object, pos, len, read_ctx.len);
+	if (req) {
+		wait_for_completion(&req->done);
+		ret = req->error;
+		cachefiles_req_put(req);
+		return ret;
+	}
 
 	return cachefiles_ondemand_send_req(object, CACHEFILES_OP_READ,
 			sizeof(struct cachefiles_read),
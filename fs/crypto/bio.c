@@ -11,6 +11,7 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/namei.h>
+#include <crypto/skcipher.h>
 #include "fscrypt_private.h"
 
 /**
@@ -30,19 +31,32 @@
  */
 bool fscrypt_decrypt_bio(struct bio *bio)
 {
+	const struct inode *inode = bio_first_page_all(bio)->mapping->host;
+	struct skcipher_request *req;
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
 
+	/* All pages of the bio share the inode, and hence the tfm. */
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     GFP_NOFS);
+	if (!req) {
+		bio->bi_status = BLK_STS_RESOURCE;
+		return false;
+	}
+
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
-		int err = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
-							   bv->bv_offset);
+		int err = fscrypt_decrypt_pagecache_blocks_req(req, page,
+							       bv->bv_len,
+							       bv->bv_offset);
 
 		if (err) {
+			skcipher_request_free(req);
 			bio->bi_status = errno_to_blk_status(err);
 			return false;
 		}
 	}
+	skcipher_request_free(req);
 	return true;
 }
 EXPORT_SYMBOL(fscrypt_decrypt_bio);
@@ -97,18 +97,21 @@ void fscrypt_generate_iv(union fscrypt_iv *iv, u64 lblk_num,
 	iv->lblk_num = cpu_to_le64(lblk_num);
 }
 
-/* Encrypt or decrypt a single filesystem block of file contents */
-int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
-			u64 lblk_num, struct page *src_page,
-			struct page *dest_page, unsigned int len,
-			unsigned int offs, gfp_t gfp_flags)
+/*
+ * Encrypt or decrypt a single filesystem block of file contents, using a
+ * request the caller allocated for the inode's contents tfm.  Callers handling
+ * many blocks allocate the request once and reuse it for each of them.
+ */
+int fscrypt_crypt_block_req(const struct inode *inode,
+			    struct skcipher_request *req,
+			    fscrypt_direction_t rw, u64 lblk_num,
+			    struct page *src_page, struct page *dest_page,
+			    unsigned int len, unsigned int offs)
 {
 	union fscrypt_iv iv;
-	struct skcipher_request *req = NULL;
 	DECLARE_CRYPTO_WAIT(wait);
 	struct scatterlist dst, src;
 	struct fscrypt_info *ci = inode->i_crypt_info;
-	struct crypto_skcipher *tfm = ci->ci_enc_key.tfm;
 	int res = 0;
 
 	if (WARN_ON_ONCE(len <= 0))
@@ -118,10 +121,6 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 
 	fscrypt_generate_iv(&iv, lblk_num, ci);
 
-	req = skcipher_request_alloc(tfm, gfp_flags);
-	if (!req)
-		return -ENOMEM;
-
 	skcipher_request_set_callback(
 		req, CRYPTO_TFM_REQ_MAY_BACKLOG | CRYPTO_TFM_REQ_MAY_SLEEP,
 		crypto_req_done, &wait);
@@ -135,7 +134,6 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 		res = crypto_wait_req(crypto_skcipher_decrypt(req), &wait);
 	else
 		res = crypto_wait_req(crypto_skcipher_encrypt(req), &wait);
-	skcipher_request_free(req);
 	if (res) {
 		fscrypt_err(inode, "%scryption failed for block %llu: %d",
 			    (rw == FS_DECRYPT ? "De" : "En"), lblk_num, res);
@@ -144,6 +142,26 @@ int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 	return 0;
 }
 
+/* Encrypt or decrypt a single filesystem block of file contents */
+int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
+			u64 lblk_num, struct page *src_page,
+			struct page *dest_page, unsigned int len,
+			unsigned int offs, gfp_t gfp_flags)
+{
+	struct skcipher_request *req;
+	int res;
+
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     gfp_flags);
+	if (!req)
+		return -ENOMEM;
+
+	res = fscrypt_crypt_block_req(inode, req, rw, lblk_num, src_page,
+				      dest_page, len, offs);
+	skcipher_request_free(req);
+	return res;
+}
+
 /**
  * fscrypt_encrypt_pagecache_blocks() - Encrypt filesystem blocks from a
  *					pagecache page
@@ -179,6 +197,7 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	const unsigned int blockbits = inode->i_blkbits;
 	const unsigned int blocksize = 1 << blockbits;
 	struct page *ciphertext_page;
+	struct skcipher_request *req;
 	u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
 		       (offs >> blockbits);
 	unsigned int i;
@@ -194,15 +213,24 @@ struct page *fscrypt_encrypt_pagecache_blocks(struct page *page,
 	if (!ciphertext_page)
 		return ERR_PTR(-ENOMEM);
 
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     gfp_flags);
+	if (!req) {
+		fscrypt_free_bounce_page(ciphertext_page);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_ENCRYPT, lblk_num,
-					  page, ciphertext_page,
-					  blocksize, i, gfp_flags);
+		err = fscrypt_crypt_block_req(inode, req, FS_ENCRYPT, lblk_num,
+					      page, ciphertext_page,
+					      blocksize, i);
 		if (err) {
+			skcipher_request_free(req);
 			fscrypt_free_bounce_page(ciphertext_page);
 			return ERR_PTR(err);
 		}
 	}
+	skcipher_request_free(req);
 	SetPagePrivate(ciphertext_page);
 	set_page_private(ciphertext_page, (unsigned long)page);
 	return ciphertext_page;
@@ -254,6 +282,29 @@ EXPORT_SYMBOL(fscrypt_encrypt_block_inplace);
  */
 int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 				     unsigned int offs)
+{
+	const struct inode *inode = page->mapping->host;
+	struct skcipher_request *req;
+	int err;
+
+	req = skcipher_request_alloc(inode->i_crypt_info->ci_enc_key.tfm,
+				     GFP_NOFS);
+	if (!req)
+		return -ENOMEM;
+
+	err = fscrypt_decrypt_pagecache_blocks_req(req, page, len, offs);
+	skcipher_request_free(req);
+	return err;
+}
+EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
+
+/*
+ * As fscrypt_decrypt_pagecache_blocks(), but with a request the caller
+ * allocated for the inode's contents tfm, e.g. once for a whole bio.
+ */
+int fscrypt_decrypt_pagecache_blocks_req(struct skcipher_request *req,
+					 struct page *page, unsigned int len,
+					 unsigned int offs)
 {
 	const struct inode *inode = page->mapping->host;
 	const unsigned int blockbits = inode->i_blkbits;
@@ -270,14 +321,13 @@ int fscrypt_decrypt_pagecache_blocks(struct page *page, unsigned int len,
 		return -EINVAL;
 
 	for (i = offs; i < offs + len; i += blocksize, lblk_num++) {
-		err = fscrypt_crypt_block(inode, FS_DECRYPT, lblk_num, page,
-					  page, blocksize, i, GFP_NOFS);
+		err = fscrypt_crypt_block_req(inode, req, FS_DECRYPT, lblk_num,
+					      page, page, blocksize, i);
 		if (err)
 			return err;
 	}
 	return 0;
 }
-EXPORT_SYMBOL(fscrypt_decrypt_pagecache_blocks);
 
 /**
  * fscrypt_decrypt_block_inplace() - Decrypt a filesystem block in-place
@@ -263,8 +263,17 @@ typedef enum {
 } fscrypt_direction_t;
 
 /* crypto.c */
+struct skcipher_request;
 extern struct kmem_cache *fscrypt_info_cachep;
 int fscrypt_initialize(unsigned int cop_flags);
+int fscrypt_crypt_block_req(const struct inode *inode,
+			    struct skcipher_request *req,
+			    fscrypt_direction_t rw, u64 lblk_num,
+			    struct page *src_page, struct page *dest_page,
+			    unsigned int len, unsigned int offs);
+int fscrypt_decrypt_pagecache_blocks_req(struct skcipher_request *req,
+					 struct page *page, unsigned int len,
+					 unsigned int offs);
 int fscrypt_crypt_block(const struct inode *inode, fscrypt_direction_t rw,
 			u64 lblk_num, struct page *src_page,
 			struct page *dest_page, unsigned int len,
@@ -73,6 +73,9 @@ struct erofs_mount_opts {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* jobs one queue is split into by the decompression pool, 0 - off */
+	unsigned int decompress_threads;
 #endif
 	unsigned int mount_opt;
 };
@@ -89,6 +92,7 @@ struct erofs_fs_context {
 	struct erofs_dev_context *devs;
 	char *fsid;
 	char *domain_id;
+	char *decompress_cpus;
 };
 
 /* all filesystem-wide lz4 configurations */
@@ -132,6 +136,11 @@ struct erofs_sb_info {
 
 	struct erofs_sb_lz4_info lz4;
 	struct inode *packed_inode;
+
+	/* per-sb decompression pool, see z_erofs_fanout_queue() */
+	struct workqueue_struct *decompress_wq;
+	cpumask_var_t decompress_cpus;
+	int decompress_last_cpu;
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct erofs_dev_context *devs;
 	struct dax_device *dax_dev;
@@ -568,6 +577,8 @@ int erofs_try_to_free_all_cached_pages(struct erofs_sb_info *sbi,
 				       struct erofs_workgroup *egrp);
 int erofs_try_to_free_cached_page(struct page *page);
 int z_erofs_parse_cfgs(struct super_block *sb, struct erofs_super_block *dsb);
+int z_erofs_init_decompress_pool(struct super_block *sb, const char *cpus);
+void z_erofs_exit_decompress_pool(struct erofs_sb_info *sbi);
 #else
 static inline void erofs_shrinker_register(struct super_block *sb) {}
 static inline void erofs_shrinker_unregister(struct super_block *sb) {}
@@ -575,6 +586,9 @@ static inline int erofs_init_shrinker(void) { return 0; }
 static inline void erofs_exit_shrinker(void) {}
 static inline int z_erofs_init_zip_subsystem(void) { return 0; }
 static inline void z_erofs_exit_zip_subsystem(void) {}
+static inline int z_erofs_init_decompress_pool(struct super_block *sb,
+					       const char *cpus) { return 0; }
+static inline void z_erofs_exit_decompress_pool(struct erofs_sb_info *sbi) {}
 #endif	/* !CONFIG_EROFS_FS_ZIP */
 
 #ifdef CONFIG_EROFS_FS_ZIP_LZMA
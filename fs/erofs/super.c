@@ -394,6 +394,8 @@ enum {
 	Opt_device,
 	Opt_fsid,
 	Opt_domain_id,
+	Opt_decompress_threads,
+	Opt_decompress_cpus,
 	Opt_err
 };
 
@@ -420,6 +422,8 @@ static const struct fs_parameter_spec erofs_fs_parameters[] = {
 	fsparam_string("device",	Opt_device),
 	fsparam_string("fsid",		Opt_fsid),
 	fsparam_string("domain_id",	Opt_domain_id),
+	fsparam_u32("decompress_threads", Opt_decompress_threads),
+	fsparam_string("decompress_cpus", Opt_decompress_cpus),
 	{}
 };
 
@@ -533,6 +537,28 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 	case Opt_domain_id:
 		errorfc(fc, "%s option not supported", erofs_fs_parameters[opt].name);
 		break;
+#endif
+#ifdef CONFIG_EROFS_FS_ZIP
+	case Opt_decompress_threads:
+		if (result.uint_32 > nr_cpu_ids) {
+			errorfc(fc, "decompress_threads must not exceed %u",
+				nr_cpu_ids);
+			return -EINVAL;
+		}
+		ctx->opt.decompress_threads = result.uint_32;
+		break;
+	case Opt_decompress_cpus:
+		kfree(ctx->decompress_cpus);
+		ctx->decompress_cpus = kstrdup(param->string, GFP_KERNEL);
+		if (!ctx->decompress_cpus)
+			return -ENOMEM;
+		break;
+#else
+	case Opt_decompress_threads:
+	case Opt_decompress_cpus:
+		errorfc(fc, "compression not supported, %s ignored",
+			erofs_fs_parameters[opt].name);
+		break;
 #endif
 	default:
 		return -ENOPARAM;
@@ -752,6 +778,10 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 	if (err)
 		return err;
 
+	err = z_erofs_init_decompress_pool(sb, ctx->decompress_cpus);
+	if (err)
+		return err;
+
 	err = erofs_register_sysfs(sb);
 	if (err)
 		return err;
@@ -785,6 +815,8 @@ static int erofs_fc_reconfigure(struct fs_context *fc)
 
 	if (ctx->fsid || ctx->domain_id)
 		erofs_info(sb, "ignoring reconfiguration for fsid|domain_id.");
+	if (ctx->decompress_cpus)
+		erofs_info(sb, "ignoring reconfiguration for decompress_cpus.");
 
 	if (test_opt(&ctx->opt, POSIX_ACL))
 		fc->sb_flags |= SB_POSIXACL;
@@ -827,6 +859,7 @@ static void erofs_fc_free(struct fs_context *fc)
 	erofs_free_dev_context(ctx->devs);
 	kfree(ctx->fsid);
 	kfree(ctx->domain_id);
+	kfree(ctx->decompress_cpus);
 	kfree(ctx);
 }
 
@@ -896,6 +929,7 @@ static void erofs_kill_sb(struct super_block *sb)
 	erofs_free_dev_context(sbi->devs);
 	fs_put_dax(sbi->dax_dev, NULL);
 	erofs_fscache_unregister_fs(sb);
+	z_erofs_exit_decompress_pool(sbi);
 	kfree(sbi->fsid);
 	kfree(sbi->domain_id);
 	kfree(sbi);
@@ -912,6 +946,7 @@ static void erofs_put_super(struct super_block *sb)
 	erofs_unregister_sysfs(sb);
 	erofs_shrinker_unregister(sb);
 #ifdef CONFIG_EROFS_FS_ZIP
+	z_erofs_exit_decompress_pool(sbi);
 	iput(sbi->managed_cache);
 	sbi->managed_cache = NULL;
 	iput(sbi->packed_inode);
@@ -1044,6 +1079,12 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 		seq_puts(seq, ",cache_strategy=readahead");
 	else if (opt->cache_strategy == EROFS_ZIP_CACHE_READAROUND)
 		seq_puts(seq, ",cache_strategy=readaround");
+	if (opt->decompress_threads)
+		seq_printf(seq, ",decompress_threads=%u",
+			   opt->decompress_threads);
+	if (sbi->decompress_wq)
+		seq_printf(seq, ",decompress_cpus=%*pbl",
+			   cpumask_pr_args(sbi->decompress_cpus));
 #endif
 	if (test_opt(opt, DAX_ALWAYS))
 		seq_puts(seq, ",dax=always");
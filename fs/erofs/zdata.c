@@ -358,6 +358,47 @@ static inline int z_erofs_init_workqueue(void)
 	return z_erofs_workqueue ? 0 : -ENOMEM;
 }
 
+int z_erofs_init_decompress_pool(struct super_block *sb, const char *cpus)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(sb);
+
+	if (!sbi->opt.decompress_threads)
+		return 0;
+
+	if (!zalloc_cpumask_var(&sbi->decompress_cpus, GFP_KERNEL))
+		return -ENOMEM;
+
+	if (!cpus) {
+		cpumask_copy(sbi->decompress_cpus, cpu_possible_mask);
+	} else if (cpulist_parse(cpus, sbi->decompress_cpus) ||
+		   cpumask_empty(sbi->decompress_cpus)) {
+		erofs_err(sb, "invalid decompress_cpus list \"%s\"", cpus);
+		free_cpumask_var(sbi->decompress_cpus);
+		return -EINVAL;
+	}
+
+	sbi->decompress_last_cpu = -1;
+	sbi->decompress_wq = alloc_workqueue("erofs_unzipd/%s", WQ_HIGHPRI, 0,
+					     sb->s_id);
+	if (!sbi->decompress_wq) {
+		free_cpumask_var(sbi->decompress_cpus);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void z_erofs_exit_decompress_pool(struct erofs_sb_info *sbi)
+{
+	if (!sbi->decompress_wq)
+		return;
+
+	/* background queues may still be fanning out to this pool */
+	flush_workqueue(z_erofs_workqueue);
+	destroy_workqueue(sbi->decompress_wq);
+	sbi->decompress_wq = NULL;
+	free_cpumask_var(sbi->decompress_cpus);
+}
+
 int __init z_erofs_init_zip_subsystem(void)
 {
 	int err = z_erofs_create_pcluster_pool();
@@ -1236,16 +1277,16 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	return err;
 }
 
-static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
-				     struct page **pagepool)
+static void __z_erofs_decompress_queue(struct super_block *sb,
+				       z_erofs_next_pcluster_t owned, bool eio,
+				       struct page **pagepool)
 {
 	struct z_erofs_decompress_backend be = {
-		.sb = io->sb,
+		.sb = sb,
 		.pagepool = pagepool,
 		.decompressed_secondary_bvecs =
 			LIST_HEAD_INIT(be.decompressed_secondary_bvecs),
 	};
-	z_erofs_next_pcluster_t owned = io->head;
 
 	while (owned != Z_EROFS_PCLUSTER_TAIL) {
 		DBG_BUGON(owned == Z_EROFS_PCLUSTER_NIL);
@@ -1253,11 +1294,119 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 		be.pcl = container_of(owned, struct z_erofs_pcluster, next);
 		owned = READ_ONCE(be.pcl->next);
 
-		z_erofs_decompress_pcluster(&be, io->eio ? -EIO : 0);
+		z_erofs_decompress_pcluster(&be, eio ? -EIO : 0);
 		erofs_workgroup_put(&be.pcl->obj);
 	}
 }
 
+/*
+ * Per-superblock decompression pool (decompress_threads=N): the pclusters
+ * of one queue are split into up to N contiguous shares.  The caller keeps
+ * the first share, the others become jobs queued round-robin on the CPUs
+ * in decompress_cpus= (all of them by default).
+ */
+struct z_erofs_decompress_job {
+	struct work_struct work;
+	struct super_block *sb;
+	z_erofs_next_pcluster_t head;
+	unsigned int nr;
+	bool eio;
+	u64 queued;
+};
+
+static void z_erofs_decompress_job_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_job *job =
+		container_of(work, struct z_erofs_decompress_job, work);
+	struct page *pagepool = NULL;
+	u64 start = ktime_get_ns();
+
+	__z_erofs_decompress_queue(job->sb, job->head, job->eio, &pagepool);
+	erofs_release_pages(&pagepool);
+
+	trace_z_erofs_decompress_job(job->sb, job->nr, start - job->queued,
+				     ktime_get_ns() - start);
+	kfree(job);
+}
+
+static void z_erofs_queue_job(struct erofs_sb_info *sbi,
+			      struct z_erofs_decompress_job *job)
+{
+	int cpu;
+
+	INIT_WORK(&job->work, z_erofs_decompress_job_work);
+	job->queued = ktime_get_ns();
+
+	cpu = cpumask_next_and(READ_ONCE(sbi->decompress_last_cpu),
+			       sbi->decompress_cpus, cpu_online_mask);
+	if (cpu >= nr_cpu_ids)
+		cpu = cpumask_first_and(sbi->decompress_cpus, cpu_online_mask);
+	if (cpu >= nr_cpu_ids) {
+		/* none of the requested CPUs is online */
+		queue_work(sbi->decompress_wq, &job->work);
+		return;
+	}
+	WRITE_ONCE(sbi->decompress_last_cpu, cpu);
+	queue_work_on(cpu, sbi->decompress_wq, &job->work);
+}
+
+/* Fan the queue out to the pool, returning the caller's own share */
+static z_erofs_next_pcluster_t z_erofs_fanout_queue(
+				const struct z_erofs_decompressqueue *io)
+{
+	struct erofs_sb_info *const sbi = EROFS_SB(io->sb);
+	struct z_erofs_decompress_job *job = NULL, *next;
+	z_erofs_next_pcluster_t owned, *tailp = NULL;
+	unsigned int nr = 0, i = 0, share;
+
+	if (!sbi->decompress_wq || sbi->opt.decompress_threads < 2)
+		return io->head;
+
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL; ++nr)
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+	if (nr < 2)
+		return io->head;
+	share = DIV_ROUND_UP(nr, min(nr, sbi->opt.decompress_threads));
+
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL; ++i) {
+		struct z_erofs_pcluster *pcl =
+			container_of(owned, struct z_erofs_pcluster, next);
+
+		if (i && !(i % share)) {
+			next = kmalloc(sizeof(*next), GFP_NOIO | __GFP_NOWARN);
+			/* the current share just grows to the end then */
+			if (!next)
+				break;
+
+			/* close the previous share before handing it over */
+			WRITE_ONCE(*tailp, Z_EROFS_PCLUSTER_TAIL);
+			if (job)
+				z_erofs_queue_job(sbi, job);
+
+			job = next;
+			job->sb = io->sb;
+			job->head = owned;
+			job->nr = 0;
+			job->eio = io->eio;
+		}
+		if (job)
+			++job->nr;
+		tailp = &pcl->next;
+		owned = READ_ONCE(pcl->next);
+	}
+	if (job)
+		z_erofs_queue_job(sbi, job);
+	return io->head;
+}
+
+static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+				     struct page **pagepool)
+{
+	__z_erofs_decompress_queue(io->sb, z_erofs_fanout_queue(io), io->eio,
+				   pagepool);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -215,10 +215,30 @@ __releases(fiq->lock)
 	spin_unlock(&fiq->lock);
 }
 
+/*
+ * A new request was added to the tail of fiq->pending.  The sender of a
+ * synchronous request goes to sleep in request_wait_answer() right after
+ * this, so do a sync wakeup and let the scheduler pull the daemon thread
+ * onto the submitting CPU instead of waking it up elsewhere.
+ */
+static void fuse_dev_wake_pending_and_unlock(struct fuse_iqueue *fiq)
+__releases(fiq->lock)
+{
+	struct fuse_req *req = list_last_entry(&fiq->pending,
+					       struct fuse_req, list);
+
+	if (test_bit(FR_BACKGROUND, &req->flags))
+		wake_up(&fiq->waitq);
+	else
+		wake_up_interruptible_sync(&fiq->waitq);
+	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
+	spin_unlock(&fiq->lock);
+}
+
 const struct fuse_iqueue_ops fuse_dev_fiq_ops = {
 	.wake_forget_and_unlock		= fuse_dev_wake_and_unlock,
 	.wake_interrupt_and_unlock	= fuse_dev_wake_and_unlock,
-	.wake_pending_and_unlock	= fuse_dev_wake_and_unlock,
+	.wake_pending_and_unlock	= fuse_dev_wake_pending_and_unlock,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_fiq_ops);
 
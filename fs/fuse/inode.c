@@ -34,6 +34,7 @@ struct list_head fuse_conn_list;
 DEFINE_MUTEX(fuse_mutex);
 
 static int set_global_limit(const char *val, const struct kernel_param *kp);
+static int set_max_pages_limit(const char *val, const struct kernel_param *kp);
 
 unsigned max_user_bgreq;
 module_param_call(max_user_bgreq, set_global_limit, param_get_uint,
@@ -51,6 +52,14 @@ MODULE_PARM_DESC(max_user_congthresh,
  "Global limit for the maximum congestion threshold an "
  "unprivileged user can set");
 
+static unsigned int fuse_max_pages_limit = FUSE_MAX_MAX_PAGES;
+module_param_call(max_pages_limit, set_max_pages_limit, param_get_uint,
+		  &fuse_max_pages_limit, 0644);
+__MODULE_PARM_TYPE(max_pages_limit, "uint");
+MODULE_PARM_DESC(max_pages_limit,
+ "Upper bound for the max_pages a server can negotiate for new "
+ "connections (1..65535)");
+
 #define FUSE_DEFAULT_BLKSIZE 512
 
 /** Maximum number of outstanding background requests */
@@ -901,7 +910,7 @@ void fuse_conn_init(struct fuse_conn *fc, struct fuse_mount *fm,
 	fc->pid_ns = get_pid_ns(task_active_pid_ns(current));
 	fc->user_ns = get_user_ns(user_ns);
 	fc->max_pages = FUSE_DEFAULT_MAX_PAGES_PER_REQ;
-	fc->max_pages_limit = FUSE_MAX_MAX_PAGES;
+	fc->max_pages_limit = READ_ONCE(fuse_max_pages_limit);
 
 	INIT_LIST_HEAD(&fc->mounts);
 	list_add(&fm->fc_entry, &fc->mounts);
@@ -1133,6 +1142,12 @@ static int set_global_limit(const char *val, const struct kernel_param *kp)
 	return 0;
 }
 
+static int set_max_pages_limit(const char *val, const struct kernel_param *kp)
+{
+	/* fuse_init_out::max_pages is a u16 */
+	return param_set_uint_minmax(val, kp, 1, U16_MAX);
+}
+
 static void process_init_limits(struct fuse_conn *fc, struct fuse_init_out *arg)
 {
 	int cap_sys_admin = capable(CAP_SYS_ADMIN);
@@ -1399,6 +1399,7 @@ iomap_ioend_try_merge(struct iomap_ioend *ioend, struct list_head *more_ioends)
 		list_move_tail(&next->io_list, &ioend->io_list);
 		ioend->io_size += next->io_size;
 	}
+	trace_iomap_ioend_try_merge(ioend);
 }
 EXPORT_SYMBOL_GPL(iomap_ioend_try_merge);
 
@@ -1459,6 +1460,7 @@ iomap_submit_ioend(struct iomap_writepage_ctx *wpc, struct iomap_ioend *ioend,
 		return error;
 	}
 
+	trace_iomap_submit_ioend(ioend);
 	submit_bio(ioend->io_bio);
 	return 0;
 }
@@ -1536,15 +1538,16 @@ iomap_can_add_to_ioend(struct iomap_writepage_ctx *wpc, loff_t offset,
 
 /*
  * Test to see if we have an existing ioend structure that we could append to
- * first; otherwise finish off the current ioend and start another.
+ * first; otherwise finish off the current ioend and start another.  @len
+ * covers one or more blocks of @folio inside the current mapping.
  */
 static void
-iomap_add_to_ioend(struct inode *inode, loff_t pos, struct folio *folio,
-		struct iomap_page *iop, struct iomap_writepage_ctx *wpc,
-		struct writeback_control *wbc, struct list_head *iolist)
+iomap_add_to_ioend(struct inode *inode, loff_t pos, size_t len,
+		struct folio *folio, struct iomap_page *iop,
+		struct iomap_writepage_ctx *wpc, struct writeback_control *wbc,
+		struct list_head *iolist)
 {
 	sector_t sector = iomap_sector(&wpc->iomap, pos);
-	unsigned len = i_blocksize(inode);
 	size_t poff = offset_in_folio(folio, pos);
 
 	if (!wpc->ioend || !iomap_can_add_to_ioend(wpc, pos, sector)) {
@@ -1590,7 +1593,7 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	unsigned len = i_blocksize(inode);
 	unsigned nblocks = i_blocks_per_folio(inode, folio);
 	u64 pos = folio_pos(folio);
-	int error = 0, count = 0, i;
+	int error = 0, count = 0, i, run;
 	LIST_HEAD(submit_list);
 
 	WARN_ON_ONCE(iop && atomic_read(&iop->write_bytes_pending) != 0);
@@ -1600,7 +1603,8 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 	 * run off the end of the current map or find the current map
 	 * invalid, grab a new one.
 	 */
-	for (i = 0; i < nblocks && pos < end_pos; i++, pos += len) {
+	for (i = 0; i < nblocks && pos < end_pos; i += run, pos += run * len) {
+		run = 1;
 		if (iop && !test_bit(i, iop->uptodate))
 			continue;
 
@@ -1612,7 +1616,16 @@ iomap_writepage_map(struct iomap_writepage_ctx *wpc,
 			continue;
 		if (wpc->iomap.type == IOMAP_HOLE)
 			continue;
-		iomap_add_to_ioend(inode, pos, folio, iop, wpc, wbc,
+
+		/*
+		 * Add every following uptodate block that the same mapping
+		 * covers in one go rather than one block at a time.
+		 */
+		while (i + run < nblocks && pos + run * len < end_pos &&
+		       pos + run * len < wpc->iomap.offset + wpc->iomap.length &&
+		       (!iop || test_bit(i + run, iop->uptodate)))
+			run++;
+		iomap_add_to_ioend(inode, pos, run * len, folio, iop, wpc, wbc,
 				 &submit_list);
 		count++;
 	}
@@ -20,6 +20,7 @@
  * Private flags for iomap_dio, must not overlap with the public ones in
  * iomap.h:
  */
+#define IOMAP_DIO_INLINE_COMP	(1 << 27)
 #define IOMAP_DIO_WRITE_FUA	(1 << 28)
 #define IOMAP_DIO_NEED_SYNC	(1 << 29)
 #define IOMAP_DIO_WRITE		(1 << 30)
@@ -108,8 +109,8 @@ ssize_t iomap_dio_complete(struct iomap_dio *dio)
 	 * ->end_io() when necessary, otherwise a racing buffer read would cache
 	 * zeros from unwritten extents.
 	 */
-	if (!dio->error && dio->size &&
-	    (dio->flags & IOMAP_DIO_WRITE) && inode->i_mapping->nrpages) {
+	if (!dio->error && dio->size && (dio->flags & IOMAP_DIO_WRITE) &&
+	    !(dio->flags & IOMAP_DIO_INLINE_COMP) && inode->i_mapping->nrpages) {
 		int err;
 		err = invalidate_inode_pages2_range(inode->i_mapping,
 				offset >> PAGE_SHIFT,
@@ -154,6 +155,33 @@ static inline void iomap_dio_set_error(struct iomap_dio *dio, int ret)
 	cmpxchg(&dio->error, 0, ret);
 }
 
+/*
+ * A write flagged IOMAP_DIO_INLINE_COMP may complete from the bio end_io
+ * handler, unless it failed, so that ->end_io may have recovery to do, or
+ * there are cached pages that iomap_dio_complete() would have to invalidate,
+ * which can sleep. Pages are inserted under the i_pages lock, so checking
+ * under it sees any page added before the write completed. A page added
+ * after it is read from the device once the write is done and can't be
+ * stale. Otherwise the flag is cleared and the completion punted.
+ */
+static bool iomap_dio_can_complete_inline(struct iomap_dio *dio)
+{
+	struct address_space *mapping = file_inode(dio->iocb->ki_filp)->i_mapping;
+	unsigned long flags;
+	bool empty;
+
+	if (!(dio->flags & IOMAP_DIO_INLINE_COMP))
+		return false;
+
+	xa_lock_irqsave(&mapping->i_pages, flags);
+	empty = !dio->error && !mapping->nrpages;
+	xa_unlock_irqrestore(&mapping->i_pages, flags);
+
+	if (!empty)
+		dio->flags &= ~IOMAP_DIO_INLINE_COMP;
+	return empty;
+}
+
 void iomap_dio_bio_end_io(struct bio *bio)
 {
 	struct iomap_dio *dio = bio->bi_private;
@@ -167,13 +195,20 @@ void iomap_dio_bio_end_io(struct bio *bio)
 			struct task_struct *waiter = dio->submit.waiter;
 			WRITE_ONCE(dio->submit.waiter, NULL);
 			blk_wake_io_task(waiter);
-		} else if (dio->flags & IOMAP_DIO_WRITE) {
+		} else if ((dio->flags & IOMAP_DIO_WRITE) &&
+			   !iomap_dio_can_complete_inline(dio)) {
 			struct inode *inode = file_inode(dio->iocb->ki_filp);
 
 			WRITE_ONCE(dio->iocb->private, NULL);
 			INIT_WORK(&dio->aio.work, iomap_dio_complete_work);
 			queue_work(inode->i_sb->s_dio_done_wq, &dio->aio.work);
 		} else {
+			/*
+			 * Reads, and pure overwrites with no page cache to
+			 * invalidate, complete right here. The latter leave
+			 * IOMAP_DIO_INLINE_COMP set so that nothing is
+			 * invalidated even if a page shows up meanwhile.
+			 */
 			WRITE_ONCE(dio->iocb->private, NULL);
 			iomap_dio_complete_work(&dio->aio.work);
 		}
@@ -297,6 +332,17 @@ static loff_t iomap_dio_bio_iter(const struct iomap_iter *iter,
 	    ((dio->flags & IOMAP_DIO_WRITE) && pos >= i_size_read(inode)))
 		dio->iocb->ki_flags &= ~IOCB_HIPRI;
 
+	/*
+	 * Only a pure overwrite that the file system vouched for can be
+	 * completed from the end_io handler: no zeroing or extent conversion,
+	 * no COW, no size update and no cache flush at completion.
+	 */
+	if (!(iomap->flags & IOMAP_F_DIO_INLINE_COMP) || need_zeroout ||
+	    (iomap->flags & IOMAP_F_SHARED) ||
+	    ((dio->flags & IOMAP_DIO_NEED_SYNC) && !use_fua) ||
+	    pos + length > i_size_read(inode))
+		dio->flags &= ~IOMAP_DIO_INLINE_COMP;
+
 	if (need_zeroout) {
 		/* zero out from the start of the block to the write offset */
 		pad = pos & (fs_block_size - 1);
@@ -537,7 +583,8 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 			dio->flags |= IOMAP_DIO_DIRTY;
 	} else {
 		iomi.flags |= IOMAP_WRITE;
-		dio->flags |= IOMAP_DIO_WRITE;
+		/* cleared by any extent that is not a pure overwrite */
+		dio->flags |= IOMAP_DIO_WRITE | IOMAP_DIO_INLINE_COMP;
 
 		if (iocb->ki_flags & IOCB_NOWAIT) {
 			if (filemap_range_has_page(mapping, iomi.pos, end)) {
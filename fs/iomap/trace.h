@@ -150,6 +150,44 @@ DEFINE_IOMAP_EVENT(iomap_iter_dstmap);
 DEFINE_IOMAP_EVENT(iomap_iter_srcmap);
 DEFINE_IOMAP_EVENT(iomap_writepage_map);
 
+DECLARE_EVENT_CLASS(iomap_ioend_class,
+	TP_PROTO(struct iomap_ioend *ioend),
+	TP_ARGS(ioend),
+	TP_STRUCT__entry(
+		__field(dev_t, dev)
+		__field(u64, ino)
+		__field(loff_t, pos)
+		__field(size_t, length)
+		__field(u32, folios)
+		__field(u64, sector)
+		__field(u16, type)
+	),
+	TP_fast_assign(
+		__entry->dev = ioend->io_inode->i_sb->s_dev;
+		__entry->ino = ioend->io_inode->i_ino;
+		__entry->pos = ioend->io_offset;
+		__entry->length = ioend->io_size;
+		__entry->folios = ioend->io_folios;
+		__entry->sector = ioend->io_sector;
+		__entry->type = ioend->io_type;
+	),
+	TP_printk("dev %d:%d ino 0x%llx pos 0x%llx length 0x%zx folios %u sector 0x%llx type %s",
+		  MAJOR(__entry->dev), MINOR(__entry->dev),
+		  __entry->ino,
+		  __entry->pos,
+		  __entry->length,
+		  __entry->folios,
+		  __entry->sector,
+		  __print_symbolic(__entry->type, IOMAP_TYPE_STRINGS))
+)
+
+#define DEFINE_IOEND_EVENT(name)		\
+DEFINE_EVENT(iomap_ioend_class, name,	\
+	TP_PROTO(struct iomap_ioend *ioend), \
+	TP_ARGS(ioend))
+DEFINE_IOEND_EVENT(iomap_submit_ioend);
+DEFINE_IOEND_EVENT(iomap_ioend_try_merge);
+
 TRACE_EVENT(iomap_iter,
 	TP_PROTO(struct iomap_iter *iter, const void *ops,
 		 unsigned long caller),
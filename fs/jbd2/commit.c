@@ -392,6 +392,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	unsigned long long blocknr;
 	ktime_t start_time;
 	u64 commit_time;
+	u64 phase_start;
 	char *tagp = NULL;
 	journal_block_tag_t *tag = NULL;
 	int space_left = 0;
@@ -601,6 +602,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 					       stats.run.rs_logging);
 	stats.run.rs_blocks = commit_transaction->t_nr_buffers;
 	stats.run.rs_blocks_logged = 0;
+	phase_start = ktime_get_ns();
 
 	J_ASSERT(commit_transaction->t_nr_buffers <=
 		 atomic_read(&commit_transaction->t_outstanding_credits));
@@ -827,6 +829,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	}
 
 	blk_finish_plug(&plug);
+	stats.run.rs_log_submit_ns = ktime_get_ns() - phase_start;
+	phase_start += stats.run.rs_log_submit_ns;
 
 	/* Lo and behold: we have just managed to send a transaction to
            the log.  Before we can commit it, wait for the IO so far to
@@ -906,6 +910,9 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	if (err)
 		jbd2_journal_abort(journal, err);
 
+	stats.run.rs_log_wait_ns = ktime_get_ns() - phase_start;
+	phase_start += stats.run.rs_log_wait_ns;
+
 	jbd2_debug(3, "JBD2: commit phase 5\n");
 	write_lock(&journal->j_state_lock);
 	J_ASSERT(commit_transaction->t_state == T_COMMIT_DFLUSH);
@@ -925,6 +932,7 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	    journal->j_flags & JBD2_BARRIER) {
 		blkdev_issue_flush(journal->j_dev);
 	}
+	stats.run.rs_log_commit_ns = ktime_get_ns() - phase_start;
 
 	if (err)
 		jbd2_journal_abort(journal, err);
@@ -1194,6 +1202,9 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	journal->j_stats.run.rs_locked += stats.run.rs_locked;
 	journal->j_stats.run.rs_flushing += stats.run.rs_flushing;
 	journal->j_stats.run.rs_logging += stats.run.rs_logging;
+	journal->j_stats.run.rs_log_submit_ns += stats.run.rs_log_submit_ns;
+	journal->j_stats.run.rs_log_wait_ns += stats.run.rs_log_wait_ns;
+	journal->j_stats.run.rs_log_commit_ns += stats.run.rs_log_commit_ns;
 	journal->j_stats.run.rs_handle_count += stats.run.rs_handle_count;
 	journal->j_stats.run.rs_blocks += stats.run.rs_blocks;
 	journal->j_stats.run.rs_blocks_logged += stats.run.rs_blocks_logged;
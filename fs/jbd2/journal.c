@@ -1190,6 +1190,15 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    jiffies_to_msecs(s->stats->run.rs_flushing / s->stats->ts_tid));
 	seq_printf(seq, "  %ums logging transaction\n",
 	    jiffies_to_msecs(s->stats->run.rs_logging / s->stats->ts_tid));
+	seq_printf(seq, "    %lluus submitting log blocks\n",
+	    div_u64(s->stats->run.rs_log_submit_ns, s->stats->ts_tid) /
+	    NSEC_PER_USEC);
+	seq_printf(seq, "    %lluus waiting for log IO\n",
+	    div_u64(s->stats->run.rs_log_wait_ns, s->stats->ts_tid) /
+	    NSEC_PER_USEC);
+	seq_printf(seq, "    %lluus writing commit record\n",
+	    div_u64(s->stats->run.rs_log_commit_ns, s->stats->ts_tid) /
+	    NSEC_PER_USEC);
 	seq_printf(seq, "  %lluus average transaction commit time\n",
 		   div_u64(s->journal->j_average_commit_time, 1000));
 	seq_printf(seq, "  %lu handles per transaction\n",
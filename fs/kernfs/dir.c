@@ -1097,20 +1097,21 @@ static int kernfs_dop_revalidate(struct dentry *dentry, unsigned int flags)
 
 		/* If the kernfs parent node has changed discard and
 		 * proceed to ->lookup.
+		 *
+		 * The revision is bumped after the directory has been
+		 * changed, so there's no need to take kernfs_rwsem here:
+		 * seeing the old revision just orders this lookup before the
+		 * change, as if we had won the race for the lock.  Not waiting
+		 * behind writers keeps lookups of missing names in large,
+		 * busy directories (cgroups, net devices) off the rwsem.
 		 */
 		spin_lock(&dentry->d_lock);
 		parent = kernfs_dentry_node(dentry->d_parent);
-		if (parent) {
-			spin_unlock(&dentry->d_lock);
-			root = kernfs_root(parent);
-			down_read(&root->kernfs_rwsem);
-			if (kernfs_dir_changed(parent, dentry)) {
-				up_read(&root->kernfs_rwsem);
-				return 0;
-			}
-			up_read(&root->kernfs_rwsem);
-		} else
+		if (parent && kernfs_dir_changed(parent, dentry)) {
 			spin_unlock(&dentry->d_lock);
+			return 0;
+		}
+		spin_unlock(&dentry->d_lock);
 
 		/* The kernfs parent node hasn't changed, leave the
 		 * dentry negative and return success.
@@ -108,13 +108,13 @@ static inline void kernfs_set_rev(struct kernfs_node *parent,
 
 static inline void kernfs_inc_rev(struct kernfs_node *parent)
 {
-	parent->dir.rev++;
+	WRITE_ONCE(parent->dir.rev, parent->dir.rev + 1);
 }
 
 static inline bool kernfs_dir_changed(struct kernfs_node *parent,
 				      struct dentry *dentry)
 {
-	if (parent->dir.rev != dentry->d_time)
+	if (READ_ONCE(parent->dir.rev) != dentry->d_time)
 		return true;
 	return false;
 }
@@ -70,6 +70,7 @@ extern atomic_t netfs_n_rh_write;
 extern atomic_t netfs_n_rh_write_begin;
 extern atomic_t netfs_n_rh_write_done;
 extern atomic_t netfs_n_rh_write_failed;
+extern atomic_t netfs_n_rh_write_merged;
 extern atomic_t netfs_n_rh_write_zskip;
 
 
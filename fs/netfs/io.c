@@ -195,6 +195,7 @@ static void netfs_rreq_do_write_to_cache(struct netfs_io_request *rreq)
 			if (next->start != subreq->start + subreq->len)
 				break;
 			subreq->len += next->len;
+			netfs_stat(&netfs_n_rh_write_merged);
 			list_del_init(&next->rreq_link);
 			netfs_put_subrequest(next, false,
 					     netfs_sreq_trace_put_merged);
@@ -26,6 +26,7 @@ atomic_t netfs_n_rh_write;
 atomic_t netfs_n_rh_write_begin;
 atomic_t netfs_n_rh_write_done;
 atomic_t netfs_n_rh_write_failed;
+atomic_t netfs_n_rh_write_merged;
 atomic_t netfs_n_rh_write_zskip;
 
 void netfs_stats_show(struct seq_file *m)
@@ -50,9 +51,10 @@ void netfs_stats_show(struct seq_file *m)
 		   atomic_read(&netfs_n_rh_read),
 		   atomic_read(&netfs_n_rh_read_done),
 		   atomic_read(&netfs_n_rh_read_failed));
-	seq_printf(m, "RdHelp : WR=%u ws=%u wf=%u\n",
+	seq_printf(m, "RdHelp : WR=%u ws=%u wf=%u wm=%u\n",
 		   atomic_read(&netfs_n_rh_write),
 		   atomic_read(&netfs_n_rh_write_done),
-		   atomic_read(&netfs_n_rh_write_failed));
+		   atomic_read(&netfs_n_rh_write_failed),
+		   atomic_read(&netfs_n_rh_write_merged));
 }
 EXPORT_SYMBOL(netfs_stats_show);
@@ -672,16 +672,37 @@ nfs4_ff_layout_stat_io_start_read(struct inode *inode,
 		pnfs_report_layoutstat(inode, nfs_io_gfp_mask());
 }
 
+/* Weight of a new sample in the read latency average, as a shift */
+#define FF_READ_LATENCY_EWMA_SHIFT	3
+
+static void
+nfs4_ff_layout_stat_update_read_latency(struct nfs4_ff_layout_mirror *mirror,
+		ktime_t time_completed, ktime_t time_started)
+{
+	s64 sample = ktime_us_delta(time_completed, time_started);
+	s64 avg = mirror->read_latency_us;
+
+	sample = clamp_t(s64, sample, 1, U32_MAX);
+	if (avg)
+		avg += (sample - avg) >> FF_READ_LATENCY_EWMA_SHIFT;
+	else
+		avg = sample;
+	WRITE_ONCE(mirror->read_latency_us, clamp_t(s64, avg, 1, U32_MAX));
+}
+
 static void
 nfs4_ff_layout_stat_io_end_read(struct rpc_task *task,
 		struct nfs4_ff_layout_mirror *mirror,
 		__u64 requested,
 		__u64 completed)
 {
+	ktime_t now = ktime_get();
+
 	spin_lock(&mirror->lock);
 	nfs4_ff_layout_stat_io_update_completed(&mirror->read_stat,
 			requested, completed,
-			ktime_get(), task->tk_start);
+			now, task->tk_start);
+	nfs4_ff_layout_stat_update_read_latency(mirror, now, task->tk_start);
 	set_bit(NFS4_FF_MIRROR_STAT_AVAIL, &mirror->flags);
 	spin_unlock(&mirror->lock);
 }
@@ -792,13 +813,71 @@ ff_layout_choose_best_ds_for_read(struct pnfs_layout_segment *lseg,
 	return ff_layout_choose_any_ds_for_read(lseg, start_idx, best_idx);
 }
 
+/*
+ * Expected time for a new read on @mirror to complete: its recent read
+ * latency, times the reads already queued on it.  Mirrors without samples
+ * yet count as 1us, so each of them gets probed early on.
+ */
+static u64
+ff_layout_mirror_read_cost(struct nfs4_ff_layout_mirror *mirror)
+{
+	u64 latency = max_t(u32, READ_ONCE(mirror->read_latency_us), 1);
+
+	return latency * (atomic_read(&mirror->reads_in_flight) + 1);
+}
+
+/*
+ * Pick the healthy mirror with the lowest read cost. This is done for every
+ * rsize batch in ff_layout_pg_init_read(), so large reads get striped over
+ * all mirrors in proportion to how fast they serve them, instead of all
+ * going to the first available one.
+ */
+static struct nfs4_pnfs_ds *
+ff_layout_choose_fastest_ds_for_read(struct pnfs_layout_segment *lseg,
+				     u32 *best_idx)
+{
+	struct nfs4_ff_layout_segment *fls = FF_LAYOUT_LSEG(lseg);
+	struct nfs4_ff_layout_mirror *mirror;
+	struct nfs4_pnfs_ds *ds, *best_ds = NULL;
+	u64 cost, best_cost = U64_MAX;
+	u32 idx;
+
+	for (idx = 0; idx < fls->mirror_array_cnt; idx++) {
+		mirror = FF_LAYOUT_COMP(lseg, idx);
+		ds = nfs4_ff_layout_prepare_ds(lseg, mirror, false);
+		if (!ds)
+			continue;
+
+		if (nfs4_test_deviceid_unavailable(&mirror->mirror_ds->id_node))
+			continue;
+
+		/* ties go to the earlier, more efficient mirror */
+		cost = ff_layout_mirror_read_cost(mirror);
+		if (cost < best_cost) {
+			best_cost = cost;
+			best_ds = ds;
+			*best_idx = idx;
+		}
+	}
+
+	return best_ds;
+}
+
 static struct nfs4_pnfs_ds *
 ff_layout_get_ds_for_read(struct nfs_pageio_descriptor *pgio,
-			  u32 *best_idx)
+			  u32 *best_idx, bool resend)
 {
 	struct pnfs_layout_segment *lseg = pgio->pg_lseg;
 	struct nfs4_pnfs_ds *ds;
 
+	if (!resend) {
+		ds = ff_layout_choose_fastest_ds_for_read(lseg, best_idx);
+		if (ds)
+			return ds;
+		return ff_layout_choose_any_ds_for_read(lseg, 0, best_idx);
+	}
+
+	/* A resend must move on from the mirror that failed */
 	ds = ff_layout_choose_best_ds_for_read(lseg, pgio->pg_mirror_idx,
 					       best_idx);
 	if (ds || !pgio->pg_mirror_idx)
@@ -838,6 +917,12 @@ ff_layout_pg_init_read(struct nfs_pageio_descriptor *pgio,
 	struct nfs4_ff_layout_mirror *mirror;
 	struct nfs4_pnfs_ds *ds;
 	u32 ds_idx;
+	/*
+	 * pnfs_read_resend_pnfs() starts a fresh descriptor at the mirror
+	 * after the one that failed; later batches of a descriptor keep
+	 * their layout segment and are free to pick any mirror.
+	 */
+	bool resend = !pgio->pg_lseg && pgio->pg_mirror_idx;
 
 retry:
 	ff_layout_pg_check_layout(pgio, req);
@@ -853,7 +938,7 @@ ff_layout_pg_init_read(struct nfs_pageio_descriptor *pgio,
 			goto out_nolseg;
 	}
 
-	ds = ff_layout_get_ds_for_read(pgio, &ds_idx);
+	ds = ff_layout_get_ds_for_read(pgio, &ds_idx, resend);
 	if (!ds) {
 		if (!ff_layout_no_fallback_to_mds(pgio->pg_lseg))
 			goto out_mds;
@@ -1443,7 +1528,10 @@ static void ff_layout_read_count_stats(struct rpc_task *task, void *data)
 static void ff_layout_read_release(void *data)
 {
 	struct nfs_pgio_header *hdr = data;
+	struct nfs4_ff_layout_mirror *mirror;
 
+	mirror = FF_LAYOUT_COMP(hdr->lseg, hdr->pgio_mirror_idx);
+	atomic_dec(&mirror->reads_in_flight);
 	ff_layout_read_record_layoutstats_done(&hdr->task, hdr);
 	if (test_bit(NFS_IOHDR_RESEND_PNFS, &hdr->flags))
 		ff_layout_resend_pnfs_read(hdr);
@@ -1810,6 +1898,9 @@ ff_layout_read_pagelist(struct nfs_pgio_header *hdr)
 	hdr->args.offset = offset;
 	hdr->mds_offset = offset;
 
+	/* Dropped in ff_layout_read_release() */
+	atomic_inc(&mirror->reads_in_flight);
+
 	/* Perform an asynchronous read to ds */
 	nfs_initiate_pgio(ds_clnt, hdr, ds_cred, ds->ds_clp->rpc_ops,
 			  vers == 3 ? &ff_layout_read_call_ops_v3 :
@@ -90,6 +90,9 @@ struct nfs4_ff_layout_mirror {
 	struct nfs4_ff_layoutstat	write_stat;
 	ktime_t				start_time;
 	u32				report_interval;
+	/* read balancing, see ff_layout_choose_fastest_ds_for_read() */
+	u32				read_latency_us;
+	atomic_t			reads_in_flight;
 };
 
 #define NFS4_FF_MIRROR_STAT_AVAIL	(0)
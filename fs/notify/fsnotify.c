@@ -198,6 +198,23 @@ int __fsnotify_parent(struct dentry *dentry, __u32 mask, const void *data,
 	    (!mnt || !mnt->mnt_fsnotify_marks) && !parent_watched)
 		return 0;
 
+	/*
+	 * With no watching parent, only inode/sb/mount marks can be interested,
+	 * and fsnotify() would drop the event on the very same mask test.  Do
+	 * it here, before taking the parent/name into account, so that a
+	 * filesystem wide watch for some event types costs next to nothing
+	 * for all the other events (e.g. FS_MODIFY on every write).
+	 */
+	if (!parent_watched) {
+		__u32 marks_mask = inode->i_fsnotify_mask |
+				   inode->i_sb->s_fsnotify_mask;
+
+		if (mnt)
+			marks_mask |= mnt->mnt_fsnotify_mask;
+		if (!(mask & ALL_FSNOTIFY_EVENTS & marks_mask))
+			return 0;
+	}
+
 	parent = NULL;
 	parent_needed = fsnotify_event_needs_parent(inode, mnt, mask);
 	if (!parent_watched && !parent_needed)
@@ -19,9 +19,21 @@
 #include <linux/fdtable.h>
 #include <linux/ratelimit.h>
 #include <linux/exportfs.h>
+#include <linux/workqueue.h>
 #include "overlayfs.h"
 
 #define OVL_COPY_UP_CHUNK_SIZE (1 << 20)
+#define OVL_COPY_UP_MAX_THREADS 16
+
+static unsigned int ovl_copy_up_threads = 1;
+module_param_named(copy_up_threads, ovl_copy_up_threads, uint, 0644);
+MODULE_PARM_DESC(copy_up_threads,
+		 "Number of concurrent data copy streams for large files");
+
+static unsigned int ovl_copy_up_thread_min_mb = 64;
+module_param_named(copy_up_thread_min_mb, ovl_copy_up_thread_min_mb, uint, 0644);
+MODULE_PARM_DESC(copy_up_thread_min_mb,
+		 "Minimum file size in MiB handled by each copy stream");
 
 static int ovl_ccup_set(const char *buf, const struct kernel_param *param)
 {
@@ -193,45 +205,34 @@ static int ovl_copy_fileattr(struct inode *inode, const struct path *old,
 	return ovl_real_fileattr_set(new, &newfa);
 }
 
-static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
-			    struct file *new_file, loff_t len)
+/*
+ * Copy the data in [pos, pos + len) of old_file to the same offset in
+ * new_file.  *abort is polled between chunks so that a killed copy up can
+ * stop the other streams.
+ */
+static int ovl_copy_up_range(struct file *old_file, struct file *new_file,
+			     loff_t pos, loff_t len, bool *abort)
 {
-	struct path datapath;
-	struct file *old_file;
-	loff_t old_pos = 0;
-	loff_t new_pos = 0;
-	loff_t cloned;
+	loff_t old_pos = pos;
+	loff_t new_pos = pos;
+	loff_t end = pos + len;
 	loff_t data_pos = -1;
-	loff_t hole_len;
 	bool skip_hole = false;
 	int error = 0;
 
-	ovl_path_lowerdata(dentry, &datapath);
-	if (WARN_ON(datapath.dentry == NULL))
-		return -EIO;
-
-	old_file = ovl_path_open(&datapath, O_LARGEFILE | O_RDONLY);
-	if (IS_ERR(old_file))
-		return PTR_ERR(old_file);
-
-	/* Try to use clone_file_range to clone up within the same fs */
-	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
-	if (cloned == len)
-		goto out_fput;
-	/* Couldn't clone, so now we try to copy the data */
-
 	/* Check if lower fs supports seek operation */
 	if (old_file->f_mode & FMODE_LSEEK)
 		skip_hole = true;
 
-	while (len) {
+	while (old_pos < end) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
 
-		if (len < this_len)
-			this_len = len;
+		if (end - old_pos < this_len)
+			this_len = end - old_pos;
 
-		if (signal_pending_state(TASK_KILLABLE, current)) {
+		if (READ_ONCE(*abort) ||
+		    signal_pending_state(TASK_KILLABLE, current)) {
 			error = -EINTR;
 			break;
 		}
@@ -255,9 +256,7 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 		if (skip_hole && data_pos < old_pos) {
 			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
 			if (data_pos > old_pos) {
-				hole_len = data_pos - old_pos;
-				len -= hole_len;
-				old_pos = new_pos = data_pos;
+				old_pos = new_pos = min(data_pos, end);
 				continue;
 			} else if (data_pos == -ENXIO) {
 				break;
@@ -274,9 +273,118 @@ static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
 			break;
 		}
 		WARN_ON(old_pos != new_pos);
+	}
+	return error;
+}
 
-		len -= bytes;
+struct ovl_copy_up_stream {
+	struct work_struct work;
+	struct file *old_file;
+	struct file *new_file;
+	const struct cred *cred;
+	loff_t pos;
+	loff_t len;
+	bool *abort;
+	int error;
+};
+
+static void ovl_copy_up_stream_work(struct work_struct *work)
+{
+	struct ovl_copy_up_stream *s =
+		container_of(work, struct ovl_copy_up_stream, work);
+	const struct cred *old_cred;
+
+	old_cred = override_creds(s->cred);
+	s->error = ovl_copy_up_range(s->old_file, s->new_file,
+				     s->pos, s->len, s->abort);
+	revert_creds(old_cred);
+	if (s->error)
+		WRITE_ONCE(*s->abort, true);
+}
+
+/*
+ * Split a large copy into streams of whole chunks.  The first stream is run
+ * by the caller, the others by unbound workers under the caller's creds.
+ */
+static int ovl_copy_up_streams(struct file *old_file, struct file *new_file,
+			       loff_t len)
+{
+	struct ovl_copy_up_stream *streams;
+	unsigned int nr, i, min_mb;
+	loff_t per, pos = 0;
+	bool abort = false;
+	int error;
+
+	nr = min_t(unsigned int, READ_ONCE(ovl_copy_up_threads),
+		   OVL_COPY_UP_MAX_THREADS);
+	min_mb = max_t(unsigned int, READ_ONCE(ovl_copy_up_thread_min_mb), 1);
+	nr = min_t(loff_t, nr, div_u64(len, (u64)min_mb << 20));
+	if (nr <= 1)
+		goto single;
+
+	streams = kcalloc(nr, sizeof(*streams), GFP_KERNEL);
+	if (!streams)
+		goto single;
+
+	per = round_up(div_u64(len, nr), OVL_COPY_UP_CHUNK_SIZE);
+	for (i = 0; i < nr; i++) {
+		struct ovl_copy_up_stream *s = &streams[i];
+
+		INIT_WORK(&s->work, ovl_copy_up_stream_work);
+		s->old_file = old_file;
+		s->new_file = new_file;
+		s->cred = current_cred();
+		s->pos = pos;
+		s->len = min(per, len - pos);
+		s->abort = &abort;
+		pos += s->len;
+		if (i > 0 && s->len)
+			queue_work(system_unbound_wq, &s->work);
 	}
+
+	error = ovl_copy_up_range(old_file, new_file, streams[0].pos,
+				  streams[0].len, &abort);
+	if (error)
+		WRITE_ONCE(abort, true);
+
+	/* The workers use our files and creds, so always wait for them. */
+	for (i = 1; i < nr; i++) {
+		if (!streams[i].len)
+			continue;
+		flush_work(&streams[i].work);
+		if (!error)
+			error = streams[i].error;
+	}
+	kfree(streams);
+	return error;
+
+single:
+	return ovl_copy_up_range(old_file, new_file, 0, len, &abort);
+}
+
+static int ovl_copy_up_file(struct ovl_fs *ofs, struct dentry *dentry,
+			    struct file *new_file, loff_t len)
+{
+	struct path datapath;
+	struct file *old_file;
+	loff_t cloned;
+	int error = 0;
+
+	ovl_path_lowerdata(dentry, &datapath);
+	if (WARN_ON(datapath.dentry == NULL))
+		return -EIO;
+
+	old_file = ovl_path_open(&datapath, O_LARGEFILE | O_RDONLY);
+	if (IS_ERR(old_file))
+		return PTR_ERR(old_file);
+
+	/* Try to use clone_file_range to clone up within the same fs */
+	cloned = do_clone_file_range(old_file, 0, new_file, 0, len, 0);
+	if (cloned == len)
+		goto out_fput;
+	/* Couldn't clone, so now we try to copy the data */
+
+	error = ovl_copy_up_streams(old_file, new_file, len);
 	if (!error && ovl_should_sync(ofs))
 		error = vfs_fsync(new_file, 0);
 out_fput:
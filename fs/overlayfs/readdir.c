@@ -15,6 +15,11 @@
 #include <linux/ratelimit.h>
 #include "overlayfs.h"
 
+static bool ovl_readdir_cache_keep;
+module_param_named(readdir_cache_keep, ovl_readdir_cache_keep, bool, 0644);
+MODULE_PARM_DESC(readdir_cache_keep,
+		 "Keep merged directory caches after the last close");
+
 struct ovl_cache_entry {
 	unsigned int len;
 	unsigned int type;
@@ -242,8 +247,18 @@ static void ovl_cache_put(struct ovl_dir_file *od, struct dentry *dentry)
 	WARN_ON(cache->refcount <= 0);
 	cache->refcount--;
 	if (!cache->refcount) {
-		if (ovl_dir_cache(d_inode(dentry)) == cache)
+		/*
+		 * Leave an up to date cache attached to the inode so that the
+		 * next open doesn't have to merge all the layers again.  It is
+		 * dropped by the next ovl_cache_get() once the version moves
+		 * on, or together with the inode.
+		 */
+		if (ovl_dir_cache(d_inode(dentry)) == cache) {
+			if (READ_ONCE(ovl_readdir_cache_keep) &&
+			    ovl_dentry_version_get(dentry) == cache->version)
+				return;
 			ovl_set_dir_cache(d_inode(dentry), NULL);
+		}
 
 		ovl_cache_free(&cache->entries);
 		kfree(cache);
@@ -397,10 +412,12 @@ static struct ovl_dir_cache *ovl_cache_get(struct dentry *dentry)
 
 	cache = ovl_dir_cache(d_inode(dentry));
 	if (cache && ovl_dentry_version_get(dentry) == cache->version) {
-		WARN_ON(!cache->refcount);
 		cache->refcount++;
 		return cache;
 	}
+	/* A stale cache nobody has open belongs to the inode, free it here */
+	if (cache && !cache->refcount)
+		ovl_dir_cache_free(d_inode(dentry));
 	ovl_set_dir_cache(d_inode(dentry), NULL);
 
 	cache = kzalloc(sizeof(struct ovl_dir_cache), GFP_KERNEL);
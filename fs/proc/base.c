@@ -89,6 +89,7 @@
 #include <linux/slab.h>
 #include <linux/sched/autogroup.h>
 #include <linux/sched/mm.h>
+#include <linux/sched/cputime.h>
 #include <linux/sched/coredump.h>
 #include <linux/sched/debug.h>
 #include <linux/sched/stat.h>
@@ -96,6 +97,7 @@
 #include <linux/time_namespace.h>
 #include <linux/resctrl.h>
 #include <linux/cn_proc.h>
+#include <linux/proc_pidstats.h>
 #include <trace/events/oom.h>
 #include "internal.h"
 #include "fd.h"
@@ -3545,6 +3547,145 @@ int proc_pid_readdir(struct file *file, struct dir_context *ctx)
 	return 0;
 }
 
+/*
+ * /proc/pidstats: the commonly scraped parts of stat, statm and io for all
+ * thread groups, as fixed-size binary records, so monitoring agents don't
+ * have to open and parse several files per process.
+ */
+static void proc_pidstats_fill(struct proc_pidstats *rec,
+			       struct pid_namespace *ns,
+			       struct task_struct *task)
+{
+	struct signal_struct *sig = task->signal;
+	struct mm_struct *mm;
+	unsigned long flags;
+	u64 utime, stime;
+
+	rec->size = sizeof(*rec);
+	rec->pid = task_tgid_nr_ns(task, ns);
+	rec->state = task_state_to_char(task);
+
+	if (lock_task_sighand(task, &flags)) {
+		struct task_struct *t;
+
+		rec->ppid = task_tgid_nr_ns(task->real_parent, ns);
+		rec->num_threads = get_nr_threads(task);
+		rec->minflt = sig->min_flt;
+		rec->majflt = sig->maj_flt;
+		__for_each_thread(sig, t) {
+			rec->minflt += t->min_flt;
+			rec->majflt += t->maj_flt;
+		}
+		unlock_task_sighand(task, &flags);
+	}
+
+	thread_group_cputime_adjusted(task, &utime, &stime);
+	rec->utime_ns = utime;
+	rec->stime_ns = stime;
+	rec->start_time_ns = timens_add_boottime_ns(task->start_boottime);
+
+	mm = get_task_mm(task);
+	if (mm) {
+		rec->vsize = PAGE_SIZE * mm->total_vm;
+		rec->rss = get_mm_rss(mm);
+		mmput(mm);
+	}
+
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+	/* Same rules as /proc/PID/io */
+	if (down_read_killable(&sig->exec_update_lock))
+		return;
+	if (ptrace_may_access(task, PTRACE_MODE_READ_FSCREDS) &&
+	    lock_task_sighand(task, &flags)) {
+		struct task_io_accounting acct = task->ioac;
+		struct task_struct *t = task;
+
+		task_io_accounting_add(&acct, &sig->ioac);
+		while_each_thread(task, t)
+			task_io_accounting_add(&acct, &t->ioac);
+		unlock_task_sighand(task, &flags);
+
+		rec->flags |= PROC_PIDSTATS_F_IO;
+		rec->rchar = acct.rchar;
+		rec->wchar = acct.wchar;
+		rec->read_bytes = acct.read_bytes;
+		rec->write_bytes = acct.write_bytes;
+	}
+	up_read(&sig->exec_update_lock);
+#endif
+}
+
+static void *proc_pidstats_find(struct seq_file *m, loff_t *pos)
+{
+	struct tgid_iter *iter = m->private;
+	struct super_block *sb = file_inode(m->file)->i_sb;
+	struct proc_fs_info *fs_info = proc_sb_info(sb);
+	struct pid_namespace *ns = proc_pid_ns(sb);
+
+	for (*iter = next_tgid(ns, *iter);
+	     iter->task;
+	     iter->tgid += 1, *iter = next_tgid(ns, *iter)) {
+		if (has_pid_permissions(fs_info, iter->task,
+					HIDEPID_NO_ACCESS)) {
+			*pos = iter->tgid;
+			return iter->task;
+		}
+	}
+	*pos = PID_MAX_LIMIT;
+	return NULL;
+}
+
+static void *proc_pidstats_start(struct seq_file *m, loff_t *pos)
+{
+	struct tgid_iter *iter = m->private;
+
+	if (*pos >= PID_MAX_LIMIT)
+		return NULL;
+	iter->tgid = *pos;
+	iter->task = NULL;
+	return proc_pidstats_find(m, pos);
+}
+
+static void *proc_pidstats_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	struct tgid_iter *iter = m->private;
+
+	cond_resched();
+	iter->tgid += 1;
+	return proc_pidstats_find(m, pos);
+}
+
+static void proc_pidstats_stop(struct seq_file *m, void *v)
+{
+	struct tgid_iter *iter = m->private;
+
+	if (iter->task)
+		put_task_struct(iter->task);
+	iter->task = NULL;
+}
+
+static int proc_pidstats_show(struct seq_file *m, void *v)
+{
+	struct proc_pidstats rec = {};
+
+	proc_pidstats_fill(&rec, proc_pid_ns(file_inode(m->file)->i_sb), v);
+	seq_write(m, &rec, sizeof(rec));
+	return 0;
+}
+
+static const struct seq_operations proc_pidstats_seq_ops = {
+	.start	= proc_pidstats_start,
+	.next	= proc_pidstats_next,
+	.stop	= proc_pidstats_stop,
+	.show	= proc_pidstats_show,
+};
+
+void __init proc_pidstats_init(void)
+{
+	proc_create_seq_private("pidstats", 0444, NULL, &proc_pidstats_seq_ops,
+				sizeof(struct tgid_iter), NULL);
+}
+
 /*
  * proc_tid_comm_permission is a special permission function exclusively
  * used for the node /proc/<pid>/task/<tid>/comm.
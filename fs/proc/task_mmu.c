@@ -774,6 +774,16 @@ static void smap_gather_stats(struct vm_area_struct *vma,
 	if (start >= vma->vm_end)
 		return;
 
+	/*
+	 * An anonymous VMA without an anon_vma has never had a page faulted
+	 * in for writing: at most it maps the zero page, which isn't
+	 * accounted, and nothing in it can have been swapped out.  Skip the
+	 * page table walk, which for large, sparsely used reservations would
+	 * otherwise dominate the cost of smaps_rollup.
+	 */
+	if (vma_is_anonymous(vma) && !vma->anon_vma)
+		return;
+
 #ifdef CONFIG_SHMEM
 	if (vma->vm_file && shmem_mapping(vma->vm_file->f_mapping)) {
 		/*
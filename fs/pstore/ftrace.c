@@ -17,12 +17,10 @@
 #include <linux/err.h>
 #include <linux/cache.h>
 #include <linux/slab.h>
+#include <linux/trace_clock.h>
 #include <asm/barrier.h>
 #include "internal.h"
 
-/* This doesn't need to be atomic: speed is chosen over correctness here. */
-static u64 pstore_ftrace_stamp;
-
 static void notrace pstore_ftrace_call(unsigned long ip,
 				       unsigned long parent_ip,
 				       struct ftrace_ops *op,
@@ -49,7 +47,13 @@ static void notrace pstore_ftrace_call(unsigned long ip,
 
 	rec.ip = ip;
 	rec.parent_ip = parent_ip;
-	pstore_ftrace_write_timestamp(&rec, pstore_ftrace_stamp++);
+	/*
+	 * Stamp records with the CPU-local trace clock rather than a shared
+	 * counter: with per-CPU zones nothing else on this path touches
+	 * memory written by other CPUs, and the reader still gets an order
+	 * to merge the zones by.
+	 */
+	pstore_ftrace_write_timestamp(&rec, trace_clock_local());
 	pstore_ftrace_encode_cpu(&rec, raw_smp_processor_id());
 	psinfo->write(&record);
 
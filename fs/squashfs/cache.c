@@ -39,6 +39,8 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -48,35 +50,87 @@
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
+ *
+ * The cache is split into shards, each owning a slice of the entries and
+ * protected by its own lock, a block always living in the shard its number
+ * hashes to.  A block already in use by somebody else is found without
+ * taking any lock at all: entries are never freed while the filesystem is
+ * mounted, and holding a reference stops the entry from being reused, so
+ * it is enough to re-check the block number once the reference is taken.
  */
+static struct squashfs_cache_shard *squashfs_cache_shard(
+	struct squashfs_cache *cache, u64 block)
+{
+	if (cache->shard_bits == 0)
+		return cache->shard;
+
+	return &cache->shard[hash_64(block, cache->shard_bits)];
+}
+
+static struct squashfs_cache_entry *squashfs_cache_lookup(
+	struct squashfs_cache *cache, struct squashfs_cache_shard *shard,
+	u64 block)
+{
+	struct squashfs_cache_entry *entry;
+	int i;
+
+	for (i = 0; i < shard->entries; i++) {
+		entry = &cache->entry[shard->first + i];
+		if (READ_ONCE(entry->block) != block)
+			continue;
+
+		/* Idle entries are left to the locked path to resurrect */
+		if (!atomic_inc_not_zero(&entry->refcount))
+			return NULL;
+
+		if (READ_ONCE(entry->block) == block)
+			return entry;
+
+		/* Reused under us before we got our reference */
+		squashfs_cache_put(entry);
+		return NULL;
+	}
+
+	return NULL;
+}
+
 struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	struct squashfs_cache *cache, u64 block, int length)
 {
-	int i, n;
+	struct squashfs_cache_shard *shard = squashfs_cache_shard(cache, block);
 	struct squashfs_cache_entry *entry;
+	int i, n;
 
-	spin_lock(&cache->lock);
+	entry = squashfs_cache_lookup(cache, shard, block);
+	if (entry) {
+		atomic_long_inc(&cache->hits);
+		goto wait_pending;
+	}
+
+	spin_lock(&shard->lock);
 
 	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
+		for (i = shard->curr_blk, n = 0; n < shard->entries; n++) {
+			if (cache->entry[shard->first + i].block == block) {
+				shard->curr_blk = i;
 				break;
 			}
-			i = (i + 1) % cache->entries;
+			i = (i + 1) % shard->entries;
 		}
 
-		if (n == cache->entries) {
+		if (n == shard->entries) {
 			/*
 			 * Block not in cache, if all cache entries are used
 			 * go to sleep waiting for one to become available.
 			 */
-			if (cache->unused == 0) {
-				cache->num_waiters++;
-				spin_unlock(&cache->lock);
-				wait_event(cache->wait_queue, cache->unused);
-				spin_lock(&cache->lock);
-				cache->num_waiters--;
+			if (shard->unused == 0) {
+				atomic_long_inc(&cache->waits);
+				shard->num_waiters++;
+				spin_unlock(&shard->lock);
+				wait_event(shard->wait_queue,
+					   READ_ONCE(shard->unused));
+				spin_lock(&shard->lock);
+				shard->num_waiters--;
 				continue;
 			}
 
@@ -85,48 +139,45 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			 * round-robin strategy is used to choose the entry to
 			 * be evicted from the cache.
 			 */
-			i = cache->next_blk;
-			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
+			i = shard->next_blk;
+			for (n = 0; n < shard->entries; n++) {
+				if (!atomic_read(&cache->entry[shard->first +
+							       i].refcount))
 					break;
-				i = (i + 1) % cache->entries;
+				i = (i + 1) % shard->entries;
 			}
 
-			cache->next_blk = (i + 1) % cache->entries;
-			entry = &cache->entry[i];
+			shard->next_blk = (i + 1) % shard->entries;
+			entry = &cache->entry[shard->first + i];
 
 			/*
 			 * Initialise chosen cache entry, and fill it in from
-			 * disk.
+			 * disk.  The reference is published last, so that a
+			 * lockless lookup which manages to grab it also sees
+			 * the new block number and the pending flag.
 			 */
-			cache->unused--;
-			entry->block = block;
-			entry->refcount = 1;
-			entry->pending = 1;
-			entry->num_waiters = 0;
+			shard->unused--;
+			WRITE_ONCE(entry->pending, 1);
 			entry->error = 0;
-			spin_unlock(&cache->lock);
+			WRITE_ONCE(entry->block, block);
+			atomic_set_release(&entry->refcount, 1);
+			spin_unlock(&shard->lock);
+
+			atomic_long_inc(&cache->misses);
 
 			entry->length = squashfs_read_data(sb, block, length,
 				&entry->next_index, entry->actor);
 
-			spin_lock(&cache->lock);
-
 			if (entry->length < 0)
 				entry->error = entry->length;
 
-			entry->pending = 0;
-
 			/*
 			 * While filling this entry one or more other processes
-			 * have looked it up in the cache, and have slept
+			 * may have looked it up in the cache, and have slept
 			 * waiting for it to become available.
 			 */
-			if (entry->num_waiters) {
-				spin_unlock(&cache->lock);
-				wake_up_all(&entry->wait_queue);
-			} else
-				spin_unlock(&cache->lock);
+			smp_store_release(&entry->pending, 0);
+			wake_up_all(&entry->wait_queue);
 
 			goto out;
 		}
@@ -137,28 +188,30 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * previously unused there's one less cache entry available
 		 * for reuse.
 		 */
-		entry = &cache->entry[i];
-		if (entry->refcount == 0)
-			cache->unused--;
-		entry->refcount++;
+		entry = &cache->entry[shard->first + i];
+		if (atomic_inc_return(&entry->refcount) == 1)
+			shard->unused--;
+		spin_unlock(&shard->lock);
 
-		/*
-		 * If the entry is currently being filled in by another process
-		 * go to sleep waiting for it to become available.
-		 */
-		if (entry->pending) {
-			entry->num_waiters++;
-			spin_unlock(&cache->lock);
-			wait_event(entry->wait_queue, !entry->pending);
-		} else
-			spin_unlock(&cache->lock);
-
-		goto out;
+		atomic_long_inc(&cache->hits);
+		goto wait_pending;
+	}
+
+wait_pending:
+	/*
+	 * If the entry is currently being filled in by another process
+	 * go to sleep waiting for it to become available.
+	 */
+	if (smp_load_acquire(&entry->pending)) {
+		atomic_long_inc(&cache->waits);
+		wait_event(entry->wait_queue,
+			   !smp_load_acquire(&entry->pending));
 	}
 
 out:
-	TRACE("Got %s %d, start block %lld, refcount %d, error %d\n",
-		cache->name, i, entry->block, entry->refcount, entry->error);
+	TRACE("Got %s, start block %lld, refcount %d, error %d\n",
+		cache->name, entry->block, atomic_read(&entry->refcount),
+		entry->error);
 
 	if (entry->error)
 		ERROR("Unable to read %s cache entry [%llx]\n", cache->name,
@@ -172,23 +225,22 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
  */
 void squashfs_cache_put(struct squashfs_cache_entry *entry)
 {
-	struct squashfs_cache *cache = entry->cache;
+	struct squashfs_cache_shard *shard = entry->shard;
 
-	spin_lock(&cache->lock);
-	entry->refcount--;
-	if (entry->refcount == 0) {
-		cache->unused++;
-		/*
-		 * If there's any processes waiting for a block to become
-		 * available, wake one up.
-		 */
-		if (cache->num_waiters) {
-			spin_unlock(&cache->lock);
-			wake_up(&cache->wait_queue);
-			return;
-		}
+	if (!atomic_dec_and_lock(&entry->refcount, &shard->lock))
+		return;
+
+	shard->unused++;
+	/*
+	 * If there's any processes waiting for a block to become
+	 * available, wake one up.
+	 */
+	if (shard->num_waiters) {
+		spin_unlock(&shard->lock);
+		wake_up(&shard->wait_queue);
+		return;
 	}
-	spin_unlock(&cache->lock);
+	spin_unlock(&shard->lock);
 }
 
 /*
@@ -210,6 +262,7 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 		kfree(cache->entry[i].actor);
 	}
 
+	kfree(cache->shard);
 	kfree(cache->entry);
 	kfree(cache);
 }
@@ -223,7 +276,7 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	int block_size)
 {
-	int i, j;
+	int i, j, nr_shards;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -237,17 +290,39 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		goto cleanup;
 	}
 
-	cache->curr_blk = 0;
-	cache->next_blk = 0;
-	cache->unused = entries;
+	/*
+	 * Small caches stay in one shard: a block can only use the entries
+	 * of its own shard, so many tiny shards would just wait sooner.
+	 */
+	nr_shards = min(entries / SQUASHFS_CACHE_SHARD_ENTRIES,
+			SQUASHFS_CACHE_MAX_SHARDS);
+	nr_shards = nr_shards > 1 ? rounddown_pow_of_two(nr_shards) : 1;
+
+	cache->shard = kcalloc(nr_shards, sizeof(*(cache->shard)), GFP_KERNEL);
+	if (cache->shard == NULL) {
+		ERROR("Failed to allocate %s cache\n", name);
+		goto cleanup;
+	}
+
 	cache->entries = entries;
+	cache->shard_bits = ilog2(nr_shards);
 	cache->block_size = block_size;
 	cache->pages = block_size >> PAGE_SHIFT;
 	cache->pages = cache->pages ? cache->pages : 1;
 	cache->name = name;
-	cache->num_waiters = 0;
-	spin_lock_init(&cache->lock);
-	init_waitqueue_head(&cache->wait_queue);
+
+	for (i = 0; i < nr_shards; i++) {
+		struct squashfs_cache_shard *shard = &cache->shard[i];
+
+		shard->first = i * entries / nr_shards;
+		shard->entries = (i + 1) * entries / nr_shards - shard->first;
+		shard->unused = shard->entries;
+		spin_lock_init(&shard->lock);
+		init_waitqueue_head(&shard->wait_queue);
+
+		for (j = 0; j < shard->entries; j++)
+			cache->entry[shard->first + j].shard = shard;
+	}
 
 	for (i = 0; i < entries; i++) {
 		struct squashfs_cache_entry *entry = &cache->entry[i];
@@ -34,6 +34,8 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -533,6 +535,108 @@ static int squashfs_readahead_fragment(struct page **page,
 	return error;
 }
 
+/* Datablocks one readahead batch decompresses concurrently, at most */
+#define SQUASHFS_RA_BLOCKS	8
+
+static struct workqueue_struct *squashfs_read_wq;
+
+struct squashfs_ra_ctl {
+	atomic_t pending;
+	struct completion done;
+};
+
+struct squashfs_ra_block {
+	struct work_struct work;
+	struct squashfs_ra_ctl *ctl;
+	struct inode *inode;
+	struct page **pages;
+	unsigned int nr_pages;
+	unsigned int expected;
+	bool tail;
+	u64 block;
+	int bsize;
+};
+
+/*
+ * Decompress one datablock straight into its page cache pages, then mark
+ * them uptodate (on success), unlock and release them.
+ */
+static void squashfs_readahead_block(struct inode *inode, struct page **pages,
+	unsigned int nr_pages, u64 block, int bsize, unsigned int expected,
+	bool tail)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	struct squashfs_page_actor *actor;
+	struct page *last_page;
+	int i, res = -ENOMEM;
+
+	actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
+						 expected);
+	if (!actor)
+		goto out;
+
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+
+	last_page = squashfs_page_actor_free(actor);
+
+	if (res == expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (tail && bytes && last_page)
+			memzero_page(last_page, bytes,
+				     PAGE_SIZE - bytes);
+
+		for (i = 0; i < nr_pages; i++) {
+			flush_dcache_page(pages[i]);
+			SetPageUptodate(pages[i]);
+		}
+	}
+
+out:
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+}
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_ra_block *ra = container_of(work,
+					struct squashfs_ra_block, work);
+	struct squashfs_ra_ctl *ctl = ra->ctl;
+
+	squashfs_readahead_block(ra->inode, ra->pages, ra->nr_pages,
+				 ra->block, ra->bsize, ra->expected, ra->tail);
+
+	/* ra belongs to the submitter again once this drops */
+	if (atomic_dec_and_test(&ctl->pending))
+		complete(&ctl->done);
+}
+
+/* Wait for every queued datablock, and get ctl ready for the next batch */
+static void squashfs_readahead_wait(struct squashfs_ra_ctl *ctl)
+{
+	if (!atomic_dec_and_test(&ctl->pending))
+		wait_for_completion(&ctl->done);
+
+	atomic_set(&ctl->pending, 1);
+	reinit_completion(&ctl->done);
+}
+
+/*
+ * How many datablocks to have in flight at once. Only worth it if the
+ * decompressor can run on several CPUs at the same time.
+ */
+static unsigned int squashfs_readahead_blocks(void)
+{
+	if (!squashfs_read_wq)
+		return 1;
+
+	return clamp(squashfs_max_decompressors(), 1, SQUASHFS_RA_BLOCKS);
+}
+
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -541,24 +645,42 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
-	unsigned int nr_pages = 0;
+	unsigned int nr_blocks = squashfs_readahead_blocks();
+	unsigned int slot = 0, nr_pages = 0;
+	struct squashfs_ra_block *ra;
+	struct squashfs_ra_ctl ctl;
 	struct page **pages;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
-	pages = kmalloc_array(max_pages, sizeof(void *), GFP_KERNEL);
-	if (!pages)
+	ra = kcalloc(nr_blocks, sizeof(*ra), GFP_KERNEL);
+	if (!ra)
 		return;
 
+	pages = kmalloc_array(nr_blocks * max_pages, sizeof(void *),
+			      GFP_KERNEL);
+	if (!pages) {
+		kfree(ra);
+		return;
+	}
+
+	atomic_set(&ctl.pending, 1);
+	init_completion(&ctl.done);
+
+	for (i = 0; i < nr_blocks; i++) {
+		INIT_WORK(&ra[i].work, squashfs_readahead_work);
+		ra[i].ctl = &ctl;
+		ra[i].inode = inode;
+		ra[i].pages = pages + i * max_pages;
+	}
+
 	for (;;) {
 		pgoff_t index;
 		int res, bsize;
 		u64 block = 0;
 		unsigned int expected;
-		struct page *last_page;
 
 		expected = start >> msblk->block_log == file_end ?
 			   (i_size_read(inode) & (msblk->block_size - 1)) :
@@ -566,22 +688,22 @@ static void squashfs_readahead(struct readahead_control *ractl)
 
 		max_pages = (expected + PAGE_SIZE - 1) >> PAGE_SHIFT;
 
-		nr_pages = __readahead_batch(ractl, pages, max_pages);
+		nr_pages = __readahead_batch(ractl, ra[slot].pages, max_pages);
 		if (!nr_pages)
 			break;
 
 		if (readahead_pos(ractl) >= i_size_read(inode))
 			goto skip_pages;
 
-		index = pages[0]->index >> shift;
+		index = ra[slot].pages[0]->index >> shift;
 
-		if ((pages[nr_pages - 1]->index >> shift) != index)
+		if ((ra[slot].pages[nr_pages - 1]->index >> shift) != index)
 			goto skip_pages;
 
 		if (index == file_end && squashfs_i(inode)->fragment_block !=
 						SQUASHFS_INVALID_BLK) {
-			res = squashfs_readahead_fragment(pages, nr_pages,
-							  expected);
+			res = squashfs_readahead_fragment(ra[slot].pages,
+							  nr_pages, expected);
 			if (res)
 				goto skip_pages;
 			continue;
@@ -591,45 +713,61 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		last_page = squashfs_page_actor_free(actor);
-
-		if (res == expected) {
-			int bytes;
-
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (index == file_end && bytes && last_page)
-				memzero_page(last_page, bytes,
-					     PAGE_SIZE - bytes);
-
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
+		if (nr_blocks == 1) {
+			squashfs_readahead_block(inode, ra[slot].pages,
+						 nr_pages, block, bsize,
+						 expected, index == file_end);
+			continue;
 		}
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
+		/*
+		 * Hand the datablock to a worker: the I/O and decompression
+		 * of up to nr_blocks blocks then proceed in parallel, each
+		 * worker using the decompressor stream of the CPU it runs on.
+		 */
+		ra[slot].nr_pages = nr_pages;
+		ra[slot].expected = expected;
+		ra[slot].tail = index == file_end;
+		ra[slot].block = block;
+		ra[slot].bsize = bsize;
+		atomic_inc(&ctl.pending);
+		queue_work(squashfs_read_wq, &ra[slot].work);
+
+		if (++slot == nr_blocks) {
+			squashfs_readahead_wait(&ctl);
+			slot = 0;
 		}
 	}
 
+	squashfs_readahead_wait(&ctl);
 	kfree(pages);
+	kfree(ra);
 	return;
 
 skip_pages:
+	squashfs_readahead_wait(&ctl);
 	for (i = 0; i < nr_pages; i++) {
-		unlock_page(pages[i]);
-		put_page(pages[i]);
+		unlock_page(ra[slot].pages[i]);
+		put_page(ra[slot].pages[i]);
 	}
 	kfree(pages);
+	kfree(ra);
+}
+
+int __init squashfs_readahead_init(void)
+{
+	/* Without parallel decompressors the serial path is just as good */
+	if (squashfs_max_decompressors() == 1)
+		return 0;
+
+	squashfs_read_wq = alloc_workqueue("squashfs_read", WQ_UNBOUND, 0);
+	return squashfs_read_wq ? 0 : -ENOMEM;
+}
+
+void squashfs_readahead_exit(void)
+{
+	if (squashfs_read_wq)
+		destroy_workqueue(squashfs_read_wq);
 }
 
 const struct address_space_operations squashfs_aops = {
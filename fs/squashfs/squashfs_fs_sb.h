@@ -10,32 +10,49 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/kobject.h>
+#include <linux/completion.h>
+
 #include "squashfs_fs.h"
 
-struct squashfs_cache {
-	char			*name;
+/* Entries per cache shard, at least, and number of shards, at most */
+#define SQUASHFS_CACHE_SHARD_ENTRIES	4
+#define SQUASHFS_CACHE_MAX_SHARDS	16
+
+struct squashfs_cache_shard {
+	spinlock_t		lock;
+	int			first;
 	int			entries;
 	int			curr_blk;
 	int			next_blk;
 	int			num_waiters;
 	int			unused;
+	wait_queue_head_t	wait_queue;
+} ____cacheline_aligned_in_smp;
+
+struct squashfs_cache {
+	char			*name;
+	int			entries;
+	int			shard_bits;
 	int			block_size;
 	int			pages;
-	spinlock_t		lock;
-	wait_queue_head_t	wait_queue;
+	atomic_long_t		hits;
+	atomic_long_t		misses;
+	atomic_long_t		waits;
+	struct squashfs_cache_shard *shard;
 	struct squashfs_cache_entry *entry;
 };
 
 struct squashfs_cache_entry {
 	u64			block;
 	int			length;
-	int			refcount;
+	atomic_t		refcount;
 	u64			next_index;
 	int			pending;
 	int			error;
-	int			num_waiters;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache	*cache;
+	struct squashfs_cache_shard *shard;
 	void			**data;
 	struct squashfs_page_actor	*actor;
 };
@@ -66,5 +83,7 @@ struct squashfs_sb_info {
 	unsigned int				xattr_ids;
 	unsigned int				ids;
 	bool					panic_on_errors;
+	struct kobject				s_kobj;
+	struct completion			s_kobj_unregister;
 };
 #endif
@@ -47,10 +47,18 @@ enum Opt_errors {
 
 enum squashfs_param {
 	Opt_errors,
+	Opt_metadata_cache,
+	Opt_fragment_cache,
 };
 
+/* Upper bounds of the cache sizes selectable at mount time, in entries */
+#define SQUASHFS_MAX_CACHED_BLKS	1024
+#define SQUASHFS_MAX_CACHED_FRAGMENTS	64
+
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
+	unsigned int metadata_cache;
+	unsigned int fragment_cache;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -61,6 +69,8 @@ static const struct constant_table squashfs_param_errors[] = {
 
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
+	fsparam_u32("metadata_cache", Opt_metadata_cache),
+	fsparam_u32("fragment_cache", Opt_fragment_cache),
 	{}
 };
 
@@ -78,6 +88,20 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 	case Opt_errors:
 		opts->errors = result.uint_32;
 		break;
+	case Opt_metadata_cache:
+		if (!result.uint_32 ||
+		    result.uint_32 > SQUASHFS_MAX_CACHED_BLKS)
+			return invalfc(fc, "metadata_cache must be 1..%d",
+				       SQUASHFS_MAX_CACHED_BLKS);
+		opts->metadata_cache = result.uint_32;
+		break;
+	case Opt_fragment_cache:
+		if (!result.uint_32 ||
+		    result.uint_32 > SQUASHFS_MAX_CACHED_FRAGMENTS)
+			return invalfc(fc, "fragment_cache must be 1..%d",
+				       SQUASHFS_MAX_CACHED_FRAGMENTS);
+		opts->fragment_cache = result.uint_32;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -246,7 +270,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			opts->metadata_cache ?: SQUASHFS_CACHED_BLKS,
+			SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -321,7 +346,8 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts->fragment_cache ?: SQUASHFS_CACHED_FRAGMENTS,
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -373,6 +399,10 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto failed_mount;
 	}
 
+	/* Statistics only, not worth failing the mount over */
+	if (squashfs_register_sysfs(sb))
+		WARNING("Unable to register sysfs entries\n");
+
 	TRACE("Leaving squashfs_fill_super\n");
 	kfree(sblk);
 	return 0;
@@ -410,6 +440,13 @@ static int squashfs_reconfigure(struct fs_context *fc)
 
 	msblk->panic_on_errors = (opts->errors == Opt_errors_panic);
 
+	if (opts->metadata_cache &&
+	    opts->metadata_cache != msblk->block_cache->entries)
+		return invalfc(fc, "metadata_cache cannot be changed on remount");
+	if (opts->fragment_cache && msblk->fragment_cache &&
+	    opts->fragment_cache != msblk->fragment_cache->entries)
+		return invalfc(fc, "fragment_cache cannot be changed on remount");
+
 	return 0;
 }
 
@@ -435,6 +472,14 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 	else
 		seq_puts(s, ",errors=continue");
 
+	if (msblk->block_cache->entries != SQUASHFS_CACHED_BLKS)
+		seq_printf(s, ",metadata_cache=%d",
+			   msblk->block_cache->entries);
+	if (msblk->fragment_cache &&
+	    msblk->fragment_cache->entries != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache=%d",
+			   msblk->fragment_cache->entries);
+
 	return 0;
 }
 
@@ -475,6 +520,7 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_unregister_sysfs(sb);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -529,8 +575,23 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_readahead_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
+	err = squashfs_init_sysfs();
+	if (err) {
+		squashfs_readahead_exit();
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_exit_sysfs();
+		squashfs_readahead_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -544,6 +605,8 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_exit_sysfs();
+	squashfs_readahead_exit();
 	destroy_inodecache();
 }
 
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * sysfs.c
+ */
+
+/*
+ * Per-filesystem statistics under /sys/fs/squashfs/<dev>/, currently the
+ * hit, miss and wait counts of the metadata and fragment caches.
+ */
+
+#include <linux/fs.h>
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+struct squashfs_attr {
+	struct attribute attr;
+	int cache;		/* offset of the cache in squashfs_sb_info */
+	int stat;		/* offset of the counter in squashfs_cache */
+};
+
+#define SQUASHFS_CACHE_ATTR(_cache, _stat)				\
+static struct squashfs_attr squashfs_attr_##_cache##_cache_##_stat = {	\
+	.attr = {.name = __stringify(_cache) "_cache_" __stringify(_stat), \
+		 .mode = 0444 },					\
+	.cache = offsetof(struct squashfs_sb_info, _cache##_cache),	\
+	.stat = offsetof(struct squashfs_cache, _stat),			\
+}
+
+#define ATTR_LIST(_cache, _stat) (&squashfs_attr_##_cache##_cache_##_stat.attr)
+
+SQUASHFS_CACHE_ATTR(block, hits);
+SQUASHFS_CACHE_ATTR(block, misses);
+SQUASHFS_CACHE_ATTR(block, waits);
+SQUASHFS_CACHE_ATTR(fragment, hits);
+SQUASHFS_CACHE_ATTR(fragment, misses);
+SQUASHFS_CACHE_ATTR(fragment, waits);
+
+static struct attribute *squashfs_attrs[] = {
+	ATTR_LIST(block, hits),
+	ATTR_LIST(block, misses),
+	ATTR_LIST(block, waits),
+	ATTR_LIST(fragment, hits),
+	ATTR_LIST(fragment, misses),
+	ATTR_LIST(fragment, waits),
+	NULL,
+};
+ATTRIBUTE_GROUPS(squashfs);
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+				struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+					struct squashfs_sb_info, s_kobj);
+	struct squashfs_attr *a = container_of(attr, struct squashfs_attr,
+					       attr);
+	struct squashfs_cache *cache;
+
+	/* Filesystems without fragments have no fragment cache */
+	cache = *(struct squashfs_cache **)((unsigned char *)msblk + a->cache);
+	if (!cache)
+		return sysfs_emit(buf, "0\n");
+
+	return sysfs_emit(buf, "%ld\n", atomic_long_read(
+		(atomic_long_t *)((unsigned char *)cache + a->stat)));
+}
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+					struct squashfs_sb_info, s_kobj);
+
+	complete(&msblk->s_kobj_unregister);
+}
+
+static const struct sysfs_ops squashfs_attr_ops = {
+	.show	= squashfs_attr_show,
+};
+
+static struct kobj_type squashfs_sb_ktype = {
+	.default_groups = squashfs_groups,
+	.sysfs_ops	= &squashfs_attr_ops,
+	.release	= squashfs_sb_release,
+};
+
+static struct kobj_type squashfs_ktype = {
+	.sysfs_ops	= &squashfs_attr_ops,
+};
+
+static struct kset squashfs_root = {
+	.kobj	= {.ktype = &squashfs_ktype},
+};
+
+int squashfs_register_sysfs(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	msblk->s_kobj.kset = &squashfs_root;
+	init_completion(&msblk->s_kobj_unregister);
+	err = kobject_init_and_add(&msblk->s_kobj, &squashfs_sb_ktype, NULL,
+				   "%s", sb->s_id);
+	if (err) {
+		kobject_put(&msblk->s_kobj);
+		wait_for_completion(&msblk->s_kobj_unregister);
+	}
+	return err;
+}
+
+void squashfs_unregister_sysfs(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	if (msblk->s_kobj.state_in_sysfs) {
+		kobject_del(&msblk->s_kobj);
+		kobject_put(&msblk->s_kobj);
+		wait_for_completion(&msblk->s_kobj_unregister);
+	}
+}
+
+int __init squashfs_init_sysfs(void)
+{
+	kobject_set_name(&squashfs_root.kobj, "squashfs");
+	squashfs_root.kobj.parent = fs_kobj;
+	return kset_register(&squashfs_root);
+}
+
+void squashfs_exit_sysfs(void)
+{
+	kset_unregister(&squashfs_root);
+}
@@ -56,6 +56,40 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
 	return -EBADMSG;
 }
 
+/*
+ * The level 0 hash page used by the previous data page of a bio.  Adjacent data
+ * pages almost always share it, so holding on to it spares a pagecache lookup
+ * (and possibly a ->read_merkle_tree_page() call into the filesystem) for each
+ * of them.
+ */
+struct fsverity_hpage_cache {
+	struct page *page;
+	pgoff_t index;
+};
+
+static struct page *
+fsverity_read_level0_page(struct inode *inode, struct fsverity_hpage_cache *hc,
+			  pgoff_t hindex, unsigned long ra_pages)
+{
+	struct page *hpage;
+
+	if (hc && hc->page && hc->index == hindex) {
+		get_page(hc->page);
+		return hc->page;
+	}
+
+	hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
+							  ra_pages);
+	if (hc && !IS_ERR(hpage)) {
+		if (hc->page)
+			put_page(hc->page);
+		get_page(hpage);
+		hc->page = hpage;
+		hc->index = hindex;
+	}
+	return hpage;
+}
+
 /*
  * Verify a single data page against the file's Merkle tree.
  *
@@ -75,7 +109,8 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
  */
 static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 			struct ahash_request *req, struct page *data_page,
-			unsigned long level0_ra_pages)
+			unsigned long level0_ra_pages,
+			struct fsverity_hpage_cache *hc)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
@@ -108,8 +143,12 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		pr_debug_ratelimited("Level %d: hindex=%lu, hoffset=%u\n",
 				     level, hindex, hoffset);
 
-		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
-				level == 0 ? level0_ra_pages : 0);
+		if (level == 0)
+			hpage = fsverity_read_level0_page(inode, hc, hindex,
+							  level0_ra_pages);
+		else
+			hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode,
+								hindex, 0);
 		if (IS_ERR(hpage)) {
 			err = PTR_ERR(hpage);
 			fsverity_err(inode,
@@ -186,7 +225,7 @@ bool fsverity_verify_page(struct page *page)
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(vi->tree_params.hash_alg, GFP_NOFS);
 
-	valid = verify_page(inode, vi, req, page, 0);
+	valid = verify_page(inode, vi, req, page, 0, NULL);
 
 	fsverity_free_hash_request(vi->tree_params.hash_alg, req);
 
@@ -219,6 +258,7 @@ void fsverity_verify_bio(struct bio *bio)
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
 	unsigned long max_ra_pages = 0;
+	struct fsverity_hpage_cache hc = {};
 
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(params->hash_alg, GFP_NOFS);
@@ -245,10 +285,13 @@ void fsverity_verify_bio(struct bio *bio)
 			min(max_ra_pages, params->level0_blocks - level0_index);
 
 		if (!PageError(page) &&
-		    !verify_page(inode, vi, req, page, level0_ra_pages))
+		    !verify_page(inode, vi, req, page, level0_ra_pages, &hc))
 			SetPageError(page);
 	}
 
+	if (hc.page)
+		put_page(hc.page);
+
 	fsverity_free_hash_request(params->hash_alg, req);
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_bio);
@@ -121,6 +121,35 @@
  * - "xfs_scrub_" are symbols that tie online fsck to the rest of XFS.
  */
 
+/*
+ * Scrub throttling -- a full scrub of a large filesystem issues a great deal
+ * of metadata IO, which competes with the regular workload.  If the duty
+ * cycle is set below 100%, each scrub call sleeps after it has dropped all
+ * of its locks and buffers, long enough that the time spent scrubbing is at
+ * most scrub_duty_cycle percent of the wall clock time.  Userspace already
+ * runs one scrub thread per AG, so this bounds the load of each of them
+ * without holding up the allocators in the AG being checked.
+ */
+static unsigned int xchk_duty_cycle = 100;
+module_param_named(scrub_duty_cycle, xchk_duty_cycle, uint, 0644);
+MODULE_PARM_DESC(scrub_duty_cycle,
+		 "Percentage of time online scrub may spend checking metadata (1-100)");
+
+static void
+xchk_throttle(
+	struct xfs_scrub_metadata	*sm,
+	ktime_t				start)
+{
+	unsigned int			duty = READ_ONCE(xchk_duty_cycle);
+	u64				busy_us;
+
+	if (duty == 0 || duty >= 100 || sm->sm_type == XFS_SCRUB_TYPE_PROBE)
+		return;
+
+	busy_us = ktime_us_delta(ktime_get(), start);
+	msleep_interruptible(div_u64(busy_us * (100 - duty), duty * 1000));
+}
+
 /*
  * Scrub probe -- userspace uses this to probe if we're willing to scrub
  * or repair a given mountpoint.  This will be used by xfs_scrub to
@@ -443,6 +472,7 @@ xfs_scrub_metadata(
 {
 	struct xfs_scrub		*sc;
 	struct xfs_mount		*mp = XFS_I(file_inode(file))->i_mount;
+	ktime_t				start = ktime_get();
 	int				error = 0;
 
 	BUILD_BUG_ON(sizeof(meta_scrub_ops) !=
@@ -556,6 +586,7 @@ xfs_scrub_metadata(
 	error = xchk_teardown(sc, error);
 out_sc:
 	kmem_free(sc);
+	xchk_throttle(sm, start);
 out:
 	trace_xchk_done(XFS_I(file_inode(file)), sm, error);
 	if (error == -EFSCORRUPTED || error == -EFSBADCRC) {
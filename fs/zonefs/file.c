@@ -101,6 +101,13 @@ static int zonefs_write_iomap_begin(struct inode *inode, loff_t offset,
 	}
 	mutex_unlock(&zi->i_truncate_mutex);
 
+	/*
+	 * zonefs_file_write_dio_end_io() only sleeps for sequential zones or
+	 * on errors, so overwrites of conventional zones can complete inline.
+	 */
+	if ((flags & IOMAP_DIRECT) && !zonefs_zone_is_seq(z))
+		iomap->flags |= IOMAP_F_DIO_INLINE_COMP;
+
 	trace_zonefs_iomap_begin(inode, iomap);
 
 	return 0;
@@ -381,12 +388,103 @@ static const struct iomap_dio_ops zonefs_write_dio_ops = {
 	.end_io			= zonefs_file_write_dio_end_io,
 };
 
+/*
+ * Context of an asynchronous zone append write, completed from a workqueue as
+ * zonefs_file_write_dio_end_io() may sleep.
+ */
+struct zonefs_dio_append {
+	struct kiocb		*iocb;
+	struct bio		*bio;
+	ssize_t			size;
+	sector_t		wpsector;
+	struct work_struct	work;
+};
+
+/*
+ * If the file zone was written underneath the file system, the zone write
+ * pointer may not be where we expect it to be, but the zone append write can
+ * still succeed. So check manually that we wrote where we intended to, that
+ * is, at the zone write pointer offset reserved for the write.
+ */
+static int zonefs_file_dio_append_check(struct inode *inode, struct bio *bio,
+					sector_t wpsector)
+{
+	if (bio->bi_iter.bi_sector != wpsector) {
+		zonefs_warn(inode->i_sb,
+			"Corrupted write pointer %llu for zone at %llu\n",
+			bio->bi_iter.bi_sector, zonefs_inode_zone(inode)->z_sector);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void zonefs_file_dio_append_work(struct work_struct *work)
+{
+	struct zonefs_dio_append *da =
+		container_of(work, struct zonefs_dio_append, work);
+	struct kiocb *iocb = da->iocb;
+	struct inode *inode = file_inode(iocb->ki_filp);
+	struct bio *bio = da->bio;
+	ssize_t ret;
+
+	ret = blk_status_to_errno(bio->bi_status);
+	if (!ret)
+		ret = zonefs_file_dio_append_check(inode, bio, da->wpsector);
+
+	zonefs_file_write_dio_end_io(iocb, da->size, ret, 0);
+	trace_zonefs_file_dio_append(inode, da->size, ret);
+
+	bio_release_pages(bio, false);
+	bio_put(bio);
+
+	atomic_set(&ZONEFS_I(inode)->i_append_inflight, 0);
+	wake_up_var(&ZONEFS_I(inode)->i_append_inflight);
+	inode_dio_end(inode);
+
+	if (!ret) {
+		iocb->ki_pos += da->size;
+		ret = da->size;
+	}
+	kfree(da);
+
+	iocb->ki_complete(iocb, ret);
+}
+
+static void zonefs_file_dio_append_end_io(struct bio *bio)
+{
+	struct zonefs_dio_append *da = bio->bi_private;
+
+	queue_work(system_unbound_wq, &da->work);
+}
+
+/*
+ * An asynchronous zone append write must be issued as a single BIO: the device
+ * may reorder zone append commands, so a write split into several BIOs could
+ * end up with its pieces in the wrong order in the zone.
+ */
+static bool zonefs_file_dio_append_async(struct kiocb *iocb,
+					 struct iov_iter *from)
+{
+	struct block_device *bdev = file_inode(iocb->ki_filp)->i_sb->s_bdev;
+	size_t max = (size_t)bdev_max_zone_append_sectors(bdev) << SECTOR_SHIFT;
+
+	if (iocb->ki_flags & IOCB_HIPRI)
+		return false;
+
+	return iov_iter_count(from) <= max &&
+		iov_iter_npages(from, BIO_MAX_VECS + 1) <= BIO_MAX_VECS;
+}
+
 static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 {
 	struct inode *inode = file_inode(iocb->ki_filp);
 	struct zonefs_zone *z = zonefs_inode_zone(inode);
 	struct block_device *bdev = inode->i_sb->s_bdev;
 	unsigned int max = bdev_max_zone_append_sectors(bdev);
+	bool sync = is_sync_kiocb(iocb);
+	struct zonefs_dio_append *da = NULL;
+	sector_t wpsector;
 	pgoff_t start, end;
 	struct bio *bio;
 	ssize_t size;
@@ -413,6 +511,12 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 	if (!nr_pages)
 		return 0;
 
+	if (!sync) {
+		da = kmalloc(sizeof(*da), GFP_NOFS);
+		if (!da)
+			return -ENOMEM;
+	}
+
 	bio = bio_alloc(bdev, nr_pages,
 			REQ_OP_ZONE_APPEND | REQ_SYNC | REQ_IDLE, GFP_NOFS);
 	bio->bi_iter.bi_sector = z->z_sector;
@@ -425,37 +529,58 @@ static ssize_t zonefs_file_dio_append(struct kiocb *iocb, struct iov_iter *from)
 		goto out_release;
 
 	size = bio->bi_iter.bi_size;
-	task_io_account_write(size);
 
-	if (iocb->ki_flags & IOCB_HIPRI)
-		bio_set_polled(bio, iocb);
-
-	ret = submit_bio_wait(bio);
+	/*
+	 * zonefs_file_dio_write() checked that ki_pos is the zone write pointer
+	 * offset and then already advanced z_wpoffset past this write, so the
+	 * offset reserved for it, where the device must report having written
+	 * it, is ki_pos. An asynchronous append also can't look at z_wpoffset
+	 * from its completion, as later writes may have moved it on by then.
+	 */
+	wpsector = z->z_sector + (iocb->ki_pos >> SECTOR_SHIFT);
 
 	/*
-	 * If the file zone was written underneath the file system, the zone
-	 * write pointer may not be where we expect it to be, but the zone
-	 * append write can still succeed. So check manually that we wrote where
-	 * we intended to, that is, at zi->i_wpoffset.
+	 * The caller reserved the whole write in the zone: a short asynchronous
+	 * write cannot be completed, so let the caller fall back to a regular
+	 * direct write.
 	 */
-	if (!ret) {
-		sector_t wpsector =
-			z->z_sector + (z->z_wpoffset >> SECTOR_SHIFT);
+	if (!sync && iov_iter_count(from)) {
+		iov_iter_revert(from, size);
+		ret = -ENOTBLK;
+		goto out_release;
+	}
 
-		if (bio->bi_iter.bi_sector != wpsector) {
-			zonefs_warn(inode->i_sb,
-				"Corrupted write pointer %llu for zone at %llu\n",
-				bio->bi_iter.bi_sector, z->z_sector);
-			ret = -EIO;
-		}
+	task_io_account_write(size);
+
+	if (!sync) {
+		da->iocb = iocb;
+		da->bio = bio;
+		da->size = size;
+		da->wpsector = wpsector;
+		INIT_WORK(&da->work, zonefs_file_dio_append_work);
+		bio->bi_private = da;
+		bio->bi_end_io = zonefs_file_dio_append_end_io;
+
+		atomic_set(&ZONEFS_I(inode)->i_append_inflight, 1);
+		inode_dio_begin(inode);
+		submit_bio(bio);
+		return -EIOCBQUEUED;
 	}
 
+	if (iocb->ki_flags & IOCB_HIPRI)
+		bio_set_polled(bio, iocb);
+
+	ret = submit_bio_wait(bio);
+	if (!ret)
+		ret = zonefs_file_dio_append_check(inode, bio, wpsector);
+
 	zonefs_file_write_dio_end_io(iocb, size, ret, 0);
 	trace_zonefs_file_dio_append(inode, size, ret);
 
 out_release:
 	bio_release_pages(bio, false);
 	bio_put(bio);
+	kfree(da);
 
 	if (ret >= 0) {
 		iocb->ki_pos += size;
@@ -591,12 +716,24 @@ static ssize_t zonefs_file_dio_write(struct kiocb *iocb, struct iov_iter *from)
 		z->z_wpoffset += count;
 		zonefs_inode_account_active(inode);
 		mutex_unlock(&zi->i_truncate_mutex);
-		append = sync;
+
+		/*
+		 * The device may reorder a zone append with any other write to
+		 * the zone, so only issue one when no direct IO is in flight,
+		 * rather than waiting for those with the inode locked. Regular
+		 * writes are kept in order by zone write locking and only have
+		 * to wait for an asynchronous zone append still in flight.
+		 */
+		append = !atomic_read(&inode->i_dio_count) &&
+			 (sync || zonefs_file_dio_append_async(iocb, from));
+		if (!append)
+			wait_var_event(&zi->i_append_inflight,
+				       !atomic_read(&zi->i_append_inflight));
 	}
 
-	if (append) {
+	if (append)
 		ret = zonefs_file_dio_append(iocb, from);
-	} else {
+	if (!append || ret == -ENOTBLK) {
 		/*
 		 * iomap_dio_rw() may return ENOTBLK if there was an issue with
 		 * page invalidation. Overwrite that error code with EBUSY to
@@ -424,6 +424,7 @@ static struct inode *zonefs_alloc_inode(struct super_block *sb)
 	inode_init_once(&zi->i_vnode);
 	mutex_init(&zi->i_truncate_mutex);
 	zi->i_wr_refcnt = 0;
+	atomic_set(&zi->i_append_inflight, 0);
 
 	return &zi->i_vnode;
 }
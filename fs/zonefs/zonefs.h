@@ -98,6 +98,9 @@ struct zonefs_inode_info {
 
 	/* guarded by i_truncate_mutex */
 	unsigned int		i_wr_refcnt;
+
+	/* Asynchronous zone append write in flight (sequential zones only) */
+	atomic_t		i_append_inflight;
 };
 
 static inline struct zonefs_inode_info *ZONEFS_I(struct inode *inode)
@@ -112,6 +112,20 @@ enum drm_mm_insert_mode {
 	 */
 	DRM_MM_INSERT_EVICT,
 
+	/**
+	 * @DRM_MM_INSERT_CLASS:
+	 *
+	 * Like @DRM_MM_INSERT_BEST, but first try the most recent hole of the
+	 * size class (power of two) the node falls in, and then the most recent
+	 * hole of the smallest class that fits the node whatever its alignment,
+	 * before searching the size tree. This finds a hole in constant time in
+	 * the common case, at the cost of fit: the hole may be up to four times
+	 * larger than the smallest suitable one.
+	 *
+	 * Allocates the node from the bottom of the found hole.
+	 */
+	DRM_MM_INSERT_CLASS,
+
 	/**
 	 * @DRM_MM_INSERT_ONCE:
 	 *
@@ -145,6 +159,14 @@ enum drm_mm_insert_mode {
 	DRM_MM_INSERT_LOWEST  = DRM_MM_INSERT_LOW | DRM_MM_INSERT_ONCE,
 };
 
+/*
+ * Number of segregated size classes free holes are sorted into for
+ * DRM_MM_INSERT_CLASS: one for each power of two. The heads cost 512 bytes
+ * per &struct drm_mm, which is one per address space rather than per node,
+ * and a smaller table would leave holes above 4GiB unclassified.
+ */
+#define DRM_MM_HOLE_CLASSES 64
+
 /**
  * struct drm_mm_node - allocated block in the DRM allocator
  *
@@ -168,6 +190,7 @@ struct drm_mm_node {
 	struct rb_node rb;
 	struct rb_node rb_hole_size;
 	struct rb_node rb_hole_addr;
+	struct hlist_node hole_class;
 	u64 __subtree_last;
 	u64 hole_size;
 	u64 subtree_max_hole;
@@ -211,6 +234,9 @@ struct drm_mm {
 	struct rb_root_cached interval_tree;
 	struct rb_root_cached holes_size;
 	struct rb_root holes_addr;
+	/* Holes by size class, and classes with at least one hole. */
+	struct hlist_head holes_class[DRM_MM_HOLE_CLASSES];
+	DECLARE_BITMAP(holes_class_mask, DRM_MM_HOLE_CLASSES);
 
 	unsigned long scan_active;
 };
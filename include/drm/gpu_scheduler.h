@@ -27,11 +27,17 @@
 #include <drm/spsc_queue.h>
 #include <linux/dma-fence.h>
 #include <linux/completion.h>
+#include <linux/kref.h>
 #include <linux/xarray.h>
 #include <linux/workqueue.h>
 
 #define MAX_WAIT_SCHED_ENTITY_Q_EMPTY msecs_to_jiffies(1000)
 
+#define DRM_SCHED_POLICY_RR	0
+#define DRM_SCHED_POLICY_FAIR	1
+
+extern int drm_sched_policy;
+
 /**
  * DRM_SCHED_FENCE_DONT_PIPELINE - Prefent dependency pipelining
  *
@@ -58,6 +64,20 @@ enum drm_sched_priority {
 	DRM_SCHED_PRIORITY_COUNT
 };
 
+/**
+ * struct drm_sched_entity_stats - GPU time used by an entity
+ *
+ * @kref: reference count, held by the entity and by each of its armed jobs
+ * @runtime: total time in ns the entity's jobs spent on the hardware
+ *
+ * Jobs can still be running on the hardware after their entity is gone, so
+ * the time they take is accounted here rather than in the entity itself.
+ */
+struct drm_sched_entity_stats {
+	struct kref			kref;
+	atomic64_t			runtime;
+};
+
 /**
  * struct drm_sched_entity - A wrapper around a job queue (typically
  * attached to the DRM file_priv).
@@ -204,6 +224,30 @@ struct drm_sched_entity {
 	 * drm_sched_entity_fini().
 	 */
 	struct completion		entity_idle;
+
+	/**
+	 * @stats:
+	 *
+	 * GPU time used by the entity's jobs, see &drm_sched_entity_stats.
+	 * Only allocated with %DRM_SCHED_POLICY_FAIR.
+	 */
+	struct drm_sched_entity_stats	*stats;
+
+	/**
+	 * @vruntime:
+	 *
+	 * GPU time used by the entity, which the fair policy runs the entity
+	 * with the lowest of. Protected by the lock of @rq.
+	 */
+	u64				vruntime;
+
+	/**
+	 * @vruntime_base:
+	 *
+	 * Value of &drm_sched_entity_stats.runtime last accounted in @vruntime.
+	 * Protected by the lock of @rq.
+	 */
+	u64				vruntime_base;
 };
 
 /**
@@ -213,6 +257,9 @@ struct drm_sched_entity {
  * @sched: the scheduler to which this rq belongs to.
  * @entities: list of the entities to be scheduled.
  * @current_entity: the entity which is to be scheduled.
+ * @min_vruntime: lowest &drm_sched_entity.vruntime selected so far, used as
+ *                the starting point of entities joining or coming back to the
+ *                run queue with %DRM_SCHED_POLICY_FAIR.
  *
  * Run queue is a set of entities scheduling command submissions for
  * one specific ring. It implements the scheduling policy that selects
@@ -223,6 +270,7 @@ struct drm_sched_rq {
 	struct drm_gpu_scheduler	*sched;
 	struct list_head		entities;
 	struct drm_sched_entity		*current_entity;
+	u64				min_vruntime;
 };
 
 /**
@@ -285,6 +333,7 @@ struct drm_sched_fence *to_drm_sched_fence(struct dma_fence *f);
  *         be scheduled further.
  * @s_priority: the priority of the job.
  * @entity: the entity to which this job belongs.
+ * @entity_stats: where the time the job spends on the hardware is accounted.
  * @cb: the callback for the parent fence in s_fence.
  *
  * A job is created by the driver using drm_sched_job_init(), and
@@ -310,6 +359,7 @@ struct drm_sched_job {
 	atomic_t			karma;
 	enum drm_sched_priority		s_priority;
 	struct drm_sched_entity         *entity;
+	struct drm_sched_entity_stats	*entity_stats;
 	struct dma_fence_cb		cb;
 	/**
 	 * @dependencies:
@@ -465,6 +515,7 @@ struct drm_gpu_scheduler {
 	int				hang_limit;
 	atomic_t                        *score;
 	atomic_t                        _score;
+	atomic64_t			last_done_ns;
 	bool				ready;
 	bool				free_guilty;
 	struct device			*dev;
@@ -510,6 +561,7 @@ void drm_sched_rq_add_entity(struct drm_sched_rq *rq,
 			     struct drm_sched_entity *entity);
 void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 				struct drm_sched_entity *entity);
+void drm_sched_entity_stats_put(struct drm_sched_entity_stats *stats);
 
 int drm_sched_entity_init(struct drm_sched_entity *entity,
 			  enum drm_sched_priority priority,
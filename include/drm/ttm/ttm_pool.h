@@ -29,6 +29,7 @@
 #include <linux/mmzone.h>
 #include <linux/llist.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <drm/ttm/ttm_caching.h>
 
 struct device;
@@ -44,7 +45,9 @@ struct ttm_operation_ctx;
  * @caching: the caching type our pages have
  * @shrinker_list: our place on the global shrinker list
  * @lock: protection of the page list
- * @pages: the list of pages in the pool
+ * @pages: the list of pages in the pool, most recently freed first
+ * @nr_pages: number of pages in the list, counted in PAGE_SIZE units
+ * @refill: set when the pool fell below the refill watermark
  */
 struct ttm_pool_type {
 	struct ttm_pool *pool;
@@ -55,18 +58,24 @@ struct ttm_pool_type {
 
 	spinlock_t lock;
 	struct list_head pages;
+	unsigned long nr_pages;
+
+	bool refill;
 };
 
 /**
  * struct ttm_pool - Pool for all caching and orders
  *
  * @dev: the device we allocate pages for
+ * @nid: the numa node to allocate pages from, NUMA_NO_NODE for any
  * @use_dma_alloc: if coherent DMA allocations should be used
  * @use_dma32: if GFP_DMA32 should be used
  * @caching: pools for each caching/order
+ * @refill_work: refills the pools below the watermark in the background
  */
 struct ttm_pool {
 	struct device *dev;
+	int nid;
 
 	bool use_dma_alloc;
 	bool use_dma32;
@@ -74,6 +83,8 @@ struct ttm_pool {
 	struct {
 		struct ttm_pool_type orders[MAX_ORDER];
 	} caching[TTM_NUM_CACHING_TYPES];
+
+	struct work_struct refill_work;
 };
 
 int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
@@ -81,7 +92,7 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 void ttm_pool_free(struct ttm_pool *pool, struct ttm_tt *tt);
 
 void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
-		   bool use_dma_alloc, bool use_dma32);
+		   int nid, bool use_dma_alloc, bool use_dma32);
 void ttm_pool_fini(struct ttm_pool *pool);
 
 int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m);
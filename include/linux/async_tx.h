@@ -74,6 +74,29 @@ struct async_submit_ctl {
 	void *scribble;
 };
 
+#define ASYNC_TX_BATCH_CHANS 4
+
+/**
+ * struct async_tx_batch - operations whose descriptors are issued together
+ * @tail: last descriptor submitted through the batch, the implicit
+ *	dependency of the next operation
+ * @chan: channels holding descriptors from this batch that are not issued
+ * @nr_chans: number of valid entries in @chan
+ * @nr_ops: operations submitted through the batch
+ * @nr_offload: how many of those were handed to a dma engine
+ *
+ * Operations added to a batch are chained on one another, so they stay on
+ * one channel whenever it has the capabilities, and the channel is kicked
+ * once by async_tx_batch_issue() instead of once per operation.
+ */
+struct async_tx_batch {
+	struct dma_async_tx_descriptor *tail;
+	struct dma_chan *chan[ASYNC_TX_BATCH_CHANS];
+	int nr_chans;
+	unsigned int nr_ops;
+	unsigned int nr_offload;
+};
+
 #if defined(CONFIG_DMA_ENGINE) && !defined(CONFIG_ASYNC_TX_CHANNEL_SWITCH)
 #define async_tx_issue_pending_all dma_issue_pending_all
 
@@ -155,6 +178,34 @@ init_async_submit(struct async_submit_ctl *args, enum async_tx_flags flags,
 	args->scribble = scribble;
 }
 
+static inline void async_tx_batch_init(struct async_tx_batch *batch)
+{
+	memset(batch, 0, sizeof(*batch));
+}
+
+/**
+ * init_async_submit_batch - prepare the submission of an operation in a batch
+ * @args: submission parameters to fill in
+ * @batch: batch the operation is added to with async_tx_batch_add()
+ * @flags: as for init_async_submit(), ASYNC_TX_ACK is only valid for the
+ *	last operation of the batch
+ * @cb_fn: callback routine to run at operation completion
+ * @cb_param: parameter for the callback routine
+ * @scribble: caller provided space for dma/page address conversions
+ */
+static inline void
+init_async_submit_batch(struct async_submit_ctl *args,
+			struct async_tx_batch *batch, enum async_tx_flags flags,
+			dma_async_tx_callback cb_fn, void *cb_param,
+			addr_conv_t *scribble)
+{
+	init_async_submit(args, flags, batch->tail, cb_fn, cb_param, scribble);
+}
+
+void async_tx_batch_add(struct async_tx_batch *batch,
+			struct dma_async_tx_descriptor *tx);
+struct dma_async_tx_descriptor *async_tx_batch_issue(struct async_tx_batch *batch);
+
 void async_tx_submit(struct dma_chan *chan, struct dma_async_tx_descriptor *tx,
 		     struct async_submit_ctl *submit);
 
@@ -323,10 +323,18 @@ struct cgroup_base_stat {
  * become very expensive.  By propagating selectively, increasing reading
  * frequency decreases the cost of each read.
  *
+ * Each controller implementing ->css_rstat_flush() gets its own updated
+ * tree, so that reading one controller's stats doesn't flush the others'.
+ * Tree CGROUP_RSTAT_BASE carries the basic resource statistics, bpf and
+ * the controllers which didn't get a tree of their own.
+ *
  * This struct hosts both the fields which implement the above -
  * updated_children and updated_next - and the fields which track basic
  * resource statistics on top of it - bsync, bstat and last_bstat.
  */
+#define CGROUP_RSTAT_BASE	0
+#define CGROUP_RSTAT_NR_TREES	4
+
 struct cgroup_rstat_cpu {
 	/*
 	 * ->bsync protects ->bstat.  These are the only fields which get
@@ -352,8 +360,10 @@ struct cgroup_rstat_cpu {
 	 *
 	 * Protected by per-cpu cgroup_rstat_cpu_lock.
 	 */
-	struct cgroup *updated_children;	/* terminated by self cgroup */
-	struct cgroup *updated_next;		/* NULL iff not on the list */
+	struct {
+		struct cgroup *updated_children; /* terminated by self cgroup */
+		struct cgroup *updated_next;	 /* NULL iff not on the list */
+	} tree[CGROUP_RSTAT_NR_TREES];
 };
 
 struct cgroup_freezer_state {
@@ -476,6 +486,8 @@ struct cgroup {
 	/* per-cpu recursive resource statistics */
 	struct cgroup_rstat_cpu __percpu *rstat_cpu;
 	struct list_head rstat_css_list;
+	/* get_jiffies_64() of the last flush of each tree in this subtree */
+	u64 rstat_flushed[CGROUP_RSTAT_NR_TREES];
 
 	/* cgroup basic resource statistics */
 	struct cgroup_base_stat last_bstat;
@@ -701,6 +713,9 @@ struct cgroup_subsys {
 	int id;
 	const char *name;
 
+	/* rstat updated tree, assigned by cgroup_rstat_boot() */
+	int rstat_tree;
+
 	/* optional, initialized automatically during boot if not set */
 	const char *legacy_name;
 
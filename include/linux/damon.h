@@ -18,6 +18,8 @@
 #define DAMON_MIN_REGION	PAGE_SIZE
 /* Max priority score for DAMON-based operation schemes */
 #define DAMOS_MAX_SCORE		(99)
+/* Max number of threads the access checks of a context are sharded over */
+#define DAMON_MAX_WORKERS	(32)
 
 /* Get a random number in [l, r) */
 static inline unsigned long damon_rand(unsigned long l, unsigned long r)
@@ -89,6 +91,10 @@ struct damon_target {
  * @DAMOS_NOHUGEPAGE:	Call ``madvise()`` for the region with MADV_NOHUGEPAGE.
  * @DAMOS_LRU_PRIO:	Prioritize the region on its LRU lists.
  * @DAMOS_LRU_DEPRIO:	Deprioritize the region on its LRU lists.
+ * @DAMOS_MIGRATE_HOT:	Migrate the region to &damos->target_nid,
+ *			prioritizing hot regions.
+ * @DAMOS_MIGRATE_COLD:	Migrate the region to &damos->target_nid,
+ *			prioritizing cold regions.
  * @DAMOS_STAT:		Do nothing but count the stat.
  * @NR_DAMOS_ACTIONS:	Total number of DAMOS actions
  */
@@ -100,6 +106,8 @@ enum damos_action {
 	DAMOS_NOHUGEPAGE,
 	DAMOS_LRU_PRIO,
 	DAMOS_LRU_DEPRIO,
+	DAMOS_MIGRATE_HOT,
+	DAMOS_MIGRATE_COLD,
 	DAMOS_STAT,		/* Do nothing but only record the stat */
 	NR_DAMOS_ACTIONS,
 };
@@ -130,7 +138,9 @@ enum damos_action {
  * target memory regions using the &struct damon_operations->get_scheme_score.
  * You could customize the prioritization logic by setting &weight_sz,
  * &weight_nr_accesses, and &weight_age, because monitoring operations are
- * encouraged to respect those.
+ * encouraged to respect those.  The score of each region is computed once
+ * per aggregation interval, and the regions are applied in the order of the
+ * scores until the quota is charged, rather than in the address order.
  */
 struct damos_quota {
 	unsigned long ms;
@@ -157,6 +167,11 @@ struct damos_quota {
 	/* For prioritization */
 	unsigned long histogram[DAMOS_MAX_SCORE + 1];
 	unsigned int min_score;
+	/* candidate regions in descending score order, if @queued */
+	struct damos_candidate *queue;
+	unsigned int queue_len;
+	unsigned int queue_cap;
+	bool queued;
 };
 
 /**
@@ -207,6 +222,9 @@ struct damos_watermarks {
  * @nr_applied:	Total number of regions that the scheme is applied.
  * @sz_applied:	Total size of regions that the scheme is applied.
  * @qt_exceeds: Total number of times the quota of the scheme has exceeded.
+ * @ns_applied:	Total nanoseconds spent for applying the action.
+ *
+ * @sz_applied divided by @ns_applied is the throughput of the action.
  */
 struct damos_stat {
 	unsigned long nr_tried;
@@ -214,6 +232,7 @@ struct damos_stat {
 	unsigned long nr_applied;
 	unsigned long sz_applied;
 	unsigned long qt_exceeds;
+	unsigned long ns_applied;
 };
 
 /**
@@ -241,6 +260,7 @@ struct damos_access_pattern {
  * @quota:		Control the aggressiveness of this scheme.
  * @wmarks:		Watermarks for automated (in)activation of this scheme.
  * @stat:		Statistics of this scheme.
+ * @target_nid:		Destination node for the migration actions.
  * @list:		List head for siblings.
  *
  * For each aggregation interval, DAMON finds regions which fit in the
@@ -265,6 +285,7 @@ struct damos {
 	struct damos_quota quota;
 	struct damos_watermarks wmarks;
 	struct damos_stat stat;
+	int target_nid;
 	struct list_head list;
 };
 
@@ -285,6 +306,9 @@ enum damon_ops_id {
 };
 
 struct damon_ctx;
+struct damos_candidate;
+struct kdamond_shard;
+struct workqueue_struct;
 
 /**
  * struct damon_operations - Monitoring operations for given use cases.
@@ -294,6 +318,8 @@ struct damon_ctx;
  * @update:			Update operations-related data structures.
  * @prepare_access_checks:	Prepare next access check of target regions.
  * @check_accesses:		Check the accesses to target regions.
+ * @prepare_access_checks_target:	@prepare_access_checks for one target.
+ * @check_accesses_target:	@check_accesses for one target.
  * @reset_aggregated:		Reset aggregated accesses monitoring results.
  * @get_scheme_score:		Get the score of a region for a scheme.
  * @apply_scheme:		Apply a DAMON-based operation scheme.
@@ -322,6 +348,11 @@ struct damon_ctx;
  * last preparation and update the number of observed accesses of each region.
  * It should also return max number of observed accesses that made as a result
  * of its update.  The value will be used for regions adjustment threshold.
+ * @prepare_access_checks_target and @check_accesses_target are optional and do
+ * the same for a single target.  If both are set and &damon_attrs.nr_workers
+ * is larger than one, @kdamond shards the targets over that many workers and
+ * calls them concurrently, for different targets, instead of the two
+ * context-wide callbacks.
  * @reset_aggregated should reset the access monitoring results that aggregated
  * by @check_accesses.
  * @get_scheme_score should return the priority score of a region for a scheme
@@ -340,6 +371,10 @@ struct damon_operations {
 	void (*update)(struct damon_ctx *context);
 	void (*prepare_access_checks)(struct damon_ctx *context);
 	unsigned int (*check_accesses)(struct damon_ctx *context);
+	void (*prepare_access_checks_target)(struct damon_ctx *context,
+			struct damon_target *t);
+	unsigned int (*check_accesses_target)(struct damon_ctx *context,
+			struct damon_target *t);
 	void (*reset_aggregated)(struct damon_ctx *context);
 	int (*get_scheme_score)(struct damon_ctx *context,
 			struct damon_target *t, struct damon_region *r,
@@ -399,6 +434,11 @@ struct damon_callback {
  *				regions.
  * @max_nr_regions:		The maximum number of adaptive monitoring
  *				regions.
+ * @cpu_budget:			The maximum share of one CPU, in per-mille, that
+ *				kdamond may spend on access checks.  Zero means
+ *				no limit.
+ * @nr_workers:			Number of threads the access checks of the
+ *				targets are sharded over.
  *
  * For each @sample_interval, DAMON checks whether each region is accessed or
  * not.  It aggregates and keeps the access information (number of accesses to
@@ -406,6 +446,14 @@ struct damon_callback {
  * memory regions need update (e.g., by ``mmap()`` calls from the application,
  * in case of virtual memory monitoring) and applies the changes for each
  * @ops_update_interval.  All time intervals are in micro-seconds.
+ * If the access checks of one sample take more than @cpu_budget of the
+ * time, kdamond waits longer than @sample_interval between samples until
+ * they fit again, but never longer than @aggr_interval.
+ *
+ * With @nr_workers larger than one, the access checks of the targets are
+ * spread over that many worker threads, while regions merge/split and the
+ * schemes application stay in kdamond.  It is bounded by
+ * %DAMON_MAX_WORKERS.
  * Please refer to &struct damon_operations and &struct damon_callback for more
  * detail.
  */
@@ -415,6 +463,23 @@ struct damon_attrs {
 	unsigned long ops_update_interval;
 	unsigned long min_nr_regions;
 	unsigned long max_nr_regions;
+	unsigned long cpu_budget;
+	unsigned long nr_workers;
+};
+
+/**
+ * struct damon_ops_stat - Cost of the monitoring operations.
+ * @nr_rmap_walks:	Number of folios that reverse mapping walks visited.
+ * @nr_rmap_locks:	Number of times anon_vma or i_mmap trees were locked.
+ * @rmap_walk_ns:	Time spent on the reverse mapping walks.
+ *
+ * The counters are of the last aggregation interval.  Operations that don't
+ * do reverse mapping walks leave them zero.
+ */
+struct damon_ops_stat {
+	unsigned long nr_rmap_walks;
+	unsigned long nr_rmap_locks;
+	unsigned long rmap_walk_ns;
 };
 
 /**
@@ -442,6 +507,7 @@ struct damon_attrs {
  * Accesses to other fields must be protected by themselves.
  *
  * @ops:	Set of monitoring operations for given use cases.
+ * @ops_stat:	Cost of @ops in the last aggregation interval.
  * @callback:	Set of callbacks for monitoring events notifications.
  *
  * @adaptive_targets:	Head of monitoring targets (&damon_target) list.
@@ -453,6 +519,13 @@ struct damon_ctx {
 /* private: internal use only */
 	struct timespec64 last_aggregation;
 	struct timespec64 last_ops_update;
+	/* accumulated by the operations during the current interval */
+	struct damon_ops_stat ops_stat_cur;
+	/* sleep between samples, stretched to honour attrs.cpu_budget */
+	unsigned long sample_sleep_us;
+	/* workers that the access checks are sharded over, if any */
+	struct workqueue_struct *workers_wq;
+	struct kdamond_shard *shards;
 	/* for waiting until the execution of the kdamond_fn is started */
 	struct completion kdamond_started;
 
@@ -461,6 +534,7 @@ struct damon_ctx {
 	struct mutex kdamond_lock;
 
 	struct damon_operations ops;
+	struct damon_ops_stat ops_stat;
 	struct damon_callback callback;
 
 	struct list_head adaptive_targets;
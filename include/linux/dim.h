@@ -98,6 +98,8 @@ struct dim_stats {
  * @steps_right: Number of steps taken towards higher moderation
  * @steps_left: Number of steps taken towards lower moderation
  * @tired: Parking depth counter
+ * @profile_cap: Latency target mode when non-zero: one more than the highest
+ * profile whose moderation fits the target (see dim_set_profile_cap())
  */
 struct dim {
 	u8 state;
@@ -112,6 +114,7 @@ struct dim {
 	u8 steps_right;
 	u8 steps_left;
 	u8 tired;
+	u8 profile_cap;
 };
 
 /**
@@ -228,6 +231,45 @@ void dim_park_on_top(struct dim *dim);
  */
 void dim_park_tired(struct dim *dim);
 
+/**
+ *	dim_set_profile_cap - switch DIM to latency target mode
+ *	@dim: DIM context
+ *	@max_ix: highest profile that still meets the latency target
+ *
+ * In latency target mode DIM never moves above @max_ix and, below it, looks
+ * for the profile with the lowest event rate that does not cost packet
+ * rate, instead of the one with the highest throughput.  If the current
+ * profile is above @max_ix it is lowered at once, and the caller has to
+ * apply &dim->profile_ix itself.
+ */
+static inline void dim_set_profile_cap(struct dim *dim, u8 max_ix)
+{
+	dim->profile_cap = max_ix + 1;
+	if (dim->profile_ix > max_ix)
+		dim->profile_ix = max_ix;
+}
+
+/**
+ *	dim_clear_profile_cap - leave latency target mode
+ *	@dim: DIM context
+ */
+static inline void dim_clear_profile_cap(struct dim *dim)
+{
+	dim->profile_cap = 0;
+}
+
+/**
+ *	dim_max_profile - highest profile DIM may step to
+ *	@dim: DIM context
+ *	@nr_profiles: number of profiles of the DIM flavour
+ */
+static inline u8 dim_max_profile(struct dim *dim, u8 nr_profiles)
+{
+	if (dim->profile_cap && dim->profile_cap < nr_profiles)
+		return dim->profile_cap - 1;
+	return nr_profiles - 1;
+}
+
 /**
  *	dim_calc_stats - calculate the difference between two samples
  *	@start: start sample
@@ -302,6 +344,16 @@ struct dim_cq_moder net_dim_get_tx_moderation(u8 cq_period_mode, int ix);
  */
 struct dim_cq_moder net_dim_get_def_tx_moderation(u8 cq_period_mode);
 
+/**
+ *	net_dim_set_rx_latency_target - cap RX moderation to a latency target
+ *	@dim: DIM context, @dim->mode must already be set
+ *	@usec: highest acceptable moderation delay, 0 to leave latency mode
+ *
+ * Picks the highest RX profile whose timer does not exceed @usec, falling
+ * back to the lowest profile if none does.
+ */
+void net_dim_set_rx_latency_target(struct dim *dim, u16 usec);
+
 /**
  *	net_dim - main DIM algorithm entry point
  *	@dim: DIM instance information
@@ -176,6 +176,24 @@ struct dma_resv {
 	 * reserved by calling dma_resv_reserve_fences().
 	 */
 	struct dma_resv_list __rcu *fences;
+
+	/**
+	 * @seq:
+	 *
+	 * Bumped by DMA_RESV_SEQ_STEP whenever the set of fences changes, so
+	 * that lockless readers can tell whether @signaled still applies.
+	 */
+	unsigned long seq;
+
+	/**
+	 * @signaled:
+	 *
+	 * Cache of the last unlocked iteration which found no unsignaled
+	 * fence: the @seq it ran against, with the &enum dma_resv_usage it
+	 * covered in the low bits. Fences never become unsignaled again, so
+	 * as long as @seq hasn't moved, repeat checks of busy BOs are O(1).
+	 */
+	unsigned long signaled;
 };
 
 /**
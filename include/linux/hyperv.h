@@ -1040,6 +1040,13 @@ struct vmbus_channel {
 	 */
 	u64 out_full_first;
 
+	/*
+	 * The number of vmbus_sendpacket_batch() calls that wrote at least
+	 * one packet, and the number of packets they wrote.
+	 */
+	u64 out_batches;
+	u64 out_batched_pkts;
+
 	/* enabling/disabling fuzz testing on the channel (default is false)*/
 	bool fuzz_testing_state;
 
@@ -1224,6 +1231,28 @@ extern int vmbus_sendpacket(struct vmbus_channel *channel,
 				  enum vmbus_packet_type type,
 				  u32 flags);
 
+/**
+ * struct vmbus_batch_packet - one in-band packet of vmbus_sendpacket_batch()
+ * @buffer:	packet payload
+ * @bufferlen:	length of @buffer
+ * @requestid:	identifier of the request
+ * @trans_id:	set to the transaction ID the packet was sent with
+ * @type:	type of the packet
+ * @flags:	0 or VMBUS_DATA_PACKET_FLAG_COMPLETION_REQUESTED
+ */
+struct vmbus_batch_packet {
+	void *buffer;
+	u32 bufferlen;
+	u64 requestid;
+	u64 trans_id;
+	enum vmbus_packet_type type;
+	u32 flags;
+};
+
+extern int vmbus_sendpacket_batch(struct vmbus_channel *channel,
+				  struct vmbus_batch_packet *pkts,
+				  u32 count, u32 *sent);
+
 extern int vmbus_sendpacket_pagebuffer(struct vmbus_channel *channel,
 					    struct hv_page_buffer pagebuffers[],
 					    u32 pagecount,
@@ -262,6 +262,13 @@ struct io_ring_ctx {
 	struct wait_queue_head	sqo_sq_wait;
 	struct list_head	sqd_list;
 
+	/* SQPOLL fair share budget and stats, protected by sqd->lock */
+	unsigned int		sq_deficit;
+	u64			sq_submitted;
+	u64			sq_batches;
+	u64			sq_submit_ns;
+	u64			sq_submit_max_ns;
+
 	unsigned long		check_cq;
 
 	unsigned int		file_alloc_start;
@@ -344,9 +351,15 @@ struct io_ring_ctx {
 	struct list_head		tctx_list;
 	struct completion		ref_comp;
 
+	/* zerocopy send notification coalescing, under ->uring_lock */
+	struct io_notif_batch		*notif_batch;
+	unsigned int			notif_batch_nr;
+	u64				notif_seq;
+
 	/* io-wq management, e.g. thread count */
 	u32				iowq_limits[2];
 	bool				iowq_limits_set;
+	bool				iowq_steal;
 
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
@@ -52,6 +52,11 @@ struct vm_fault;
  *
  * IOMAP_F_XATTR indicates that the iomap is for an extended attribute extent
  * rather than a file data extent.
+ *
+ * IOMAP_F_DIO_INLINE_COMP indicates that the file system's direct I/O
+ * ->end_io does not need to sleep for a successful pure overwrite of this
+ * mapping, so such a write may be completed straight from the bio end_io
+ * handler.
  */
 #define IOMAP_F_NEW		(1U << 0)
 #define IOMAP_F_DIRTY		(1U << 1)
@@ -60,6 +65,7 @@ struct vm_fault;
 #define IOMAP_F_BUFFER_HEAD	(1U << 4)
 #define IOMAP_F_ZONE_APPEND	(1U << 5)
 #define IOMAP_F_XATTR		(1U << 6)
+#define IOMAP_F_DIO_INLINE_COMP	(1U << 7)
 
 /*
  * Flags set by the core iomap code during operations:
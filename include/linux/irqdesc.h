@@ -37,6 +37,10 @@ struct pt_regs;
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
  * @pending_mask:	pending rebalanced interrupts
+ * @balance_count:	interrupt count at the last load balancing pass
+ * @balance_load:	interrupts taken between the last two balancing passes
+ * @balance_moves:	number of load balancing migrations
+ * @balance_cpu:	target CPU of the last load balancing migration
  * @threads_oneshot:	bitfield to handle shared oneshot threads
  * @threads_active:	number of irqaction threads currently running
  * @wait_for_threads:	wait queue for sync_irq to wait for threaded handlers
@@ -77,6 +81,12 @@ struct irq_desc {
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_var_t		pending_mask;
 #endif
+#ifdef CONFIG_IRQ_LOAD_BALANCE
+	unsigned int		balance_count;
+	unsigned int		balance_load;
+	unsigned int		balance_moves;
+	unsigned int		balance_cpu;
+#endif
 #endif
 	unsigned long		threads_oneshot;
 	atomic_t		threads_active;
@@ -730,6 +730,11 @@ struct transaction_run_stats_s {
 	unsigned long		rs_flushing;
 	unsigned long		rs_logging;
 
+	/* Breakdown of rs_logging, in nanoseconds */
+	u64			rs_log_submit_ns;
+	u64			rs_log_wait_ns;
+	u64			rs_log_commit_ns;
+
 	__u32			rs_handle_count;
 	__u32			rs_blocks;
 	__u32			rs_blocks_logged;
@@ -15,6 +15,7 @@
 #ifdef CONFIG_KFENCE
 
 #include <linux/atomic.h>
+#include <linux/percpu.h>
 #include <linux/static_key.h>
 
 extern unsigned long kfence_sample_interval;
@@ -30,6 +31,10 @@ extern char *__kfence_pool;
 DECLARE_STATIC_KEY_FALSE(kfence_allocation_key);
 extern atomic_t kfence_allocation_gate;
 
+DECLARE_STATIC_KEY_FALSE(kfence_per_cpu_key);
+extern unsigned long kfence_sample_gen;
+DECLARE_PER_CPU(unsigned long, kfence_cpu_sample_gen);
+
 /**
  * is_kfence_address() - check if an address belongs to KFENCE pool
  * @addr: address to check
@@ -116,6 +121,15 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags);
  */
 static __always_inline void *kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 {
+	/*
+	 * With kfence.per_cpu_sample, each CPU may sample once per interval:
+	 * no static key is toggled, the budget check is all it costs.
+	 */
+	if (static_branch_unlikely(&kfence_per_cpu_key)) {
+		if (likely(this_cpu_read(kfence_cpu_sample_gen) == READ_ONCE(kfence_sample_gen)))
+			return NULL;
+		return __kfence_alloc(s, size, flags);
+	}
 #if defined(CONFIG_KFENCE_STATIC_KEYS) || CONFIG_KFENCE_SAMPLE_INTERVAL == 0
 	if (!static_branch_unlikely(&kfence_allocation_key))
 		return NULL;
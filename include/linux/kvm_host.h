@@ -233,6 +233,11 @@ struct kvm_async_pf {
 	gpa_t cr2_or_gpa;
 	unsigned long addr;
 	struct kvm_arch_async_pf arch;
+	/* leader: faults coalesced into this one; coalesced fault: link */
+	struct list_head coalesced;
+	struct kvm_async_pf *leader;
+	unsigned int nr_coalesced;
+	bool started;
 	bool   wakeup_all;
 	bool notpresent_injected;
 };
@@ -369,7 +374,13 @@ struct kvm_vcpu {
 	struct kvm_vcpu_arch arch;
 	struct kvm_vcpu_stat stat;
 	char stats_id[KVM_STATS_NAME_SIZE];
+	/* mmap-able copy of @stat, allocated on first mmap of the stats fd */
+	void *stats_page;
 	struct kvm_dirty_ring dirty_ring;
+#ifdef CONFIG_KVM_MMIO
+	/* Only filled by this vCPU, see kvm_coalesced_mmio_enable_vcpu_rings() */
+	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
+#endif
 
 	/*
 	 * The most recently used memslot by this vCPU and the slots generation
@@ -749,6 +760,7 @@ struct kvm {
 	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
 	spinlock_t ring_lock;
 	struct list_head coalesced_zones;
+	bool coalesced_mmio_vcpu_rings;
 #endif
 
 	struct mutex irq_lock;
@@ -786,6 +798,12 @@ struct kvm {
 	struct notifier_block pm_notifier;
 #endif
 	char stats_id[KVM_STATS_NAME_SIZE];
+	/* mmap-able copy of @stat, refreshed at most once per jiffy */
+	void *stats_page;
+	unsigned long stats_page_stamp;
+	/* refreshes the VM and vCPU stats pages while any is mapped */
+	struct delayed_work stats_page_work;
+	atomic_t stats_page_maps;
 };
 
 #define kvm_err(fmt, ...) \
@@ -1384,6 +1402,9 @@ void kvm_arch_mmu_enable_log_dirty_pt_masked(struct kvm *kvm,
 					struct kvm_memory_slot *slot,
 					gfn_t gfn_offset,
 					unsigned long mask);
+void kvm_arch_mmu_enable_log_dirty_pt_range(struct kvm *kvm,
+					    struct kvm_memory_slot *slot,
+					    gfn_t gfn_offset, u64 npages);
 void kvm_arch_sync_dirty_log(struct kvm *kvm, struct kvm_memory_slot *memslot);
 
 #ifdef CONFIG_KVM_GENERIC_DIRTYLOG_READ_PROTECT
@@ -1864,7 +1885,10 @@ struct _kvm_stats_desc {
 			HALT_POLL_HIST_COUNT),				       \
 	STATS_DESC_LOGHIST_TIME_NSEC(VCPU_GENERIC, halt_wait_hist,	       \
 			HALT_POLL_HIST_COUNT),				       \
-	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking)
+	STATS_DESC_IBOOLEAN(VCPU_GENERIC, blocking),			       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, dirty_ring_reset_entries),	       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, dirty_ring_reset_ranges),	       \
+	STATS_DESC_COUNTER(VCPU_GENERIC, coalesced_mmio_ring_full)
 
 extern struct dentry *kvm_debugfs_dir;
 
@@ -1872,6 +1896,9 @@ ssize_t kvm_stats_read(char *id, const struct kvm_stats_header *header,
 		       const struct _kvm_stats_desc *desc,
 		       void *stats, size_t size_stats,
 		       char __user *user_buffer, size_t size, loff_t *offset);
+void kvm_stats_publish(void *page, const void *stats, size_t size_stats);
+int kvm_stats_mmap(void **pagep, const void *stats, size_t size_stats,
+		   struct vm_area_struct *vma);
 
 /**
  * kvm_stats_linear_hist_update() - Update bucket value for linear histogram
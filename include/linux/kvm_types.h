@@ -118,6 +118,9 @@ struct kvm_vcpu_stat_generic {
 	u64 halt_poll_fail_hist[HALT_POLL_HIST_COUNT];
 	u64 halt_wait_hist[HALT_POLL_HIST_COUNT];
 	u64 blocking;
+	u64 dirty_ring_reset_entries;
+	u64 dirty_ring_reset_ranges;
+	u64 coalesced_mmio_ring_full;
 };
 
 #define KVM_STATS_NAME_SIZE	48
@@ -6,7 +6,14 @@
 #ifndef _KERNEL_DMA_BENCHMARK_H
 #define _KERNEL_DMA_BENCHMARK_H
 
-#define DMA_MAP_BENCHMARK       _IOWR('d', 1, struct map_benchmark)
+/*
+ * DMA_MAP_BENCHMARK only passes the original fields, up to and including
+ * granule; DMA_MAP_BENCHMARK_V2 passes the whole struct map_benchmark.
+ */
+#define DMA_MAP_BENCHMARK_V1_SIZE offsetof(struct map_benchmark, mode)
+#define DMA_MAP_BENCHMARK       _IOC(_IOC_READ | _IOC_WRITE, 'd', 1, \
+				     DMA_MAP_BENCHMARK_V1_SIZE)
+#define DMA_MAP_BENCHMARK_V2    _IOWR('d', 2, struct map_benchmark)
 #define DMA_MAP_MAX_THREADS     1024
 #define DMA_MAP_MAX_SECONDS     300
 #define DMA_MAP_MAX_TRANS_DELAY (10 * NSEC_PER_MSEC)
@@ -15,6 +22,16 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_SINGLE_MODE     0 /* dma_map_single() */
+#define DMA_MAP_PAGE_MODE       1 /* dma_map_page() */
+#define DMA_MAP_SG_MODE         2 /* dma_map_sg(), one page per entry */
+
+/* spread the threads over the online nodes, round robin */
+#define DMA_MAP_NODE_INTERLEAVE (-2)
+
+/* latency histogram resolution is 100ns, the last bucket collects overflow */
+#define DMA_MAP_HIST_BUCKETS    1024
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +44,15 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	/* the fields below are only used by DMA_MAP_BENCHMARK_V2 */
+	__u32 granule_max; /* if above granule, pick sizes in [granule, granule_max] */
+	__u32 mode; /* which DMA API is benchmarked, DMA_MAP_*_MODE */
+	__u32 reserved; /* must be zero */
+	__u64 map_p50_100ns; /* map latency percentiles in 100ns */
+	__u64 map_p99_100ns;
+	__u64 map_p999_100ns;
+	__u64 unmap_p50_100ns; /* as above */
+	__u64 unmap_p99_100ns;
+	__u64 unmap_p999_100ns;
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
@@ -691,6 +691,14 @@ struct mm_struct {
 		atomic_t tlb_flush_batched;
 #endif
 		struct uprobes_state uprobes_state;
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+		/* Hash for private futexes, see kernel/futex/core.c */
+		struct futex_private_hash *futex_phash;
+		/* Private futex ops in flight, -1 while futex_phash changes */
+		atomic_t futex_ops;
+		/* The mm futex_phash was set up for, differs after dup_mm() */
+		struct mm_struct *futex_phash_owner;
+#endif
 #ifdef CONFIG_PREEMPT_RT
 		struct rcu_head delayed_drop;
 #endif
@@ -7,8 +7,10 @@
 #define __LINUX_MTD_SPI_NOR_H
 
 #include <linux/bitops.h>
+#include <linux/ktime.h>
 #include <linux/mtd/mtd.h>
 #include <linux/spi/spi-mem.h>
+#include <linux/wait.h>
 
 /*
  * Note on opcode nomenclature: some opcodes have a format like
@@ -331,6 +333,32 @@ enum spi_nor_cmd_ext {
 	SPI_NOR_EXT_HEX,
 };
 
+/**
+ * enum spi_nor_op_stat - MTD operations whose latency is tracked
+ * @SPI_NOR_STAT_READ:	mtd_read()
+ * @SPI_NOR_STAT_WRITE:	mtd_write()
+ * @SPI_NOR_STAT_ERASE:	mtd_erase()
+ * @SPI_NOR_STAT_MAX:	number of tracked operations
+ */
+enum spi_nor_op_stat {
+	SPI_NOR_STAT_READ,
+	SPI_NOR_STAT_WRITE,
+	SPI_NOR_STAT_ERASE,
+	SPI_NOR_STAT_MAX,
+};
+
+/**
+ * struct spi_nor_op_stats - latency of one kind of MTD operation
+ * @count:	number of operations
+ * @total_ns:	time they took in total, waiting for the device included
+ * @max_ns:	the longest of them
+ */
+struct spi_nor_op_stats {
+	u64 count;
+	u64 total_ns;
+	u64 max_ns;
+};
+
 /*
  * Forward declarations that are used internally by the core and manufacturer
  * drivers.
@@ -369,6 +397,15 @@ struct spi_nor_flash_parameter;
  *                      settings that can be overwritten by the spi_nor_fixups
  *                      hooks, or dynamically when parsing the SFDP tables.
  * @dirmap:		pointers to struct spi_mem_dirmap_desc for reads/writes.
+ * @erase:		state of a sector erase that waits for the flash without
+ *			holding @lock, see spi_nor_erase_wait()
+ * @erase.wq:		wait queue for the end of the erase
+ * @erase.addr:		address of the sector being erased
+ * @erase.size:		size of the sector being erased
+ * @erase.busy:		an erase is in progress, protected by @lock
+ * @erase.resumed:	when the erase was last resumed
+ * @erase.suspends:	number of times a read suspended an erase
+ * @stats:		latency of the MTD operations, protected by @lock
  * @priv:		pointer to the private data
  */
 struct spi_nor {
@@ -403,6 +440,17 @@ struct spi_nor {
 		struct spi_mem_dirmap_desc *wdesc;
 	} dirmap;
 
+	struct {
+		wait_queue_head_t wq;
+		u32 addr;
+		u32 size;
+		bool busy;
+		ktime_t resumed;
+		u64 suspends;
+	} erase;
+
+	struct spi_nor_op_stats stats[SPI_NOR_STAT_MAX];
+
 	void *priv;
 };
 
@@ -76,6 +76,8 @@ struct ebt_chainstack {
 	unsigned int n; /* n'th entry */
 };
 
+struct ebt_mac_index;
+
 struct ebt_table_info {
 	/* total size of the entries */
 	unsigned int entries_size;
@@ -84,6 +86,8 @@ struct ebt_table_info {
 	struct ebt_entries *hook_entry[NF_BR_NUMHOOKS];
 	/* room to maintain the stack used for jumping from and into udc */
 	struct ebt_chainstack **chainstack;
+	/* source MAC index over runs of exact-match rules, may be NULL */
+	struct ebt_mac_index *mac_index;
 	char *entries;
 	struct ebt_counter counters[] ____cacheline_aligned;
 };
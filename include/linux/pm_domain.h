@@ -91,18 +91,27 @@ struct gpd_dev_ops {
 	int (*stop)(struct device *dev);
 };
 
+/* Idle interval buckets, bucket n counts intervals of [2^n, 2^(n+1)) us. */
+#define GENPD_IDLE_BUCKETS	20
+
 struct genpd_governor_data {
 	s64 max_off_time_ns;
 	bool max_off_time_changed;
 	ktime_t next_wakeup;
 	bool cached_power_down_ok;
 	bool cached_power_down_state_idx;
+	ktime_t idle_start;	/* Domain idle since, 0 if it isn't. */
+	u32 idle_hist[GENPD_IDLE_BUCKETS];	/* Decaying interval weights. */
+	u64 predict_ok;
+	u64 predict_rejected;
 };
 
 struct genpd_power_state {
 	s64 power_off_latency_ns;
 	s64 power_on_latency_ns;
 	s64 residency_ns;
+	s64 avg_off_latency_ns;	/* Measured, 0 until first used. */
+	s64 avg_on_latency_ns;
 	u64 usage;
 	u64 rejected;
 	struct fwnode_handle *fwnode;
@@ -235,6 +244,7 @@ void dev_pm_genpd_set_next_wakeup(struct device *dev, ktime_t next);
 
 extern struct dev_power_governor simple_qos_governor;
 extern struct dev_power_governor pm_domain_always_on_gov;
+extern struct dev_power_governor pm_domain_predictive_gov;
 #ifdef CONFIG_CPU_IDLE
 extern struct dev_power_governor pm_domain_cpu_gov;
 #endif
@@ -295,6 +305,7 @@ static inline void dev_pm_genpd_set_next_wakeup(struct device *dev, ktime_t next
 
 #define simple_qos_governor		(*(struct dev_power_governor *)(NULL))
 #define pm_domain_always_on_gov		(*(struct dev_power_governor *)(NULL))
+#define pm_domain_predictive_gov	(*(struct dev_power_governor *)(NULL))
 #endif
 
 #ifdef CONFIG_PM_GENERIC_DOMAINS_SLEEP
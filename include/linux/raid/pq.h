@@ -68,6 +68,8 @@ extern const char raid6_empty_zero_page[PAGE_SIZE];
 #define EXPORT_SYMBOL_GPL(sym)
 #define MODULE_LICENSE(licence)
 #define MODULE_DESCRIPTION(desc)
+#define MODULE_PARM_DESC(name, desc)
+#define module_param_named(name, var, type, perm)
 #define subsys_initcall(x)
 #define module_exit(x)
 
@@ -28,6 +28,9 @@
  * @iprim:	prim-th root of 1, index form
  * @gfpoly:	The primitive generator polynominal
  * @gffunc:	Function to generate the field, if non-canonical representation
+ * @syn_tbl:	Per root and per nibble products for the syndrome
+ *		computation, or NULL if there are too many roots
+ * @syn_nibbles: Nibbles per symbol (= (mm+3)/4)
  * @users:	Users of this structure
  * @list:	List entry for the rs codec list
 */
@@ -43,6 +46,8 @@ struct rs_codec {
 	int		iprim;
 	int		gfpoly;
 	int		(*gffunc)(int);
+	uint16_t	*syn_tbl;
+	int		syn_nibbles;
 	int		users;
 	struct list_head list;
 };
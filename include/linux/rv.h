@@ -52,6 +52,13 @@ struct rv_monitor {
 #ifdef CONFIG_RV_REACTORS
 	void			(*react)(char *msg);
 #endif
+	/*
+	 * Set by monitors that can queue events and evaluate them in batches,
+	 * see DECLARE_DA_MON_DEFER_PER_CPU(). deferred selects that mode, and
+	 * may only change while the monitor is disabled.
+	 */
+	void			(*get_events)(unsigned long *handled, unsigned long *dropped);
+	bool			deferred;
 };
 
 bool rv_monitoring_on(void);
@@ -1473,6 +1473,10 @@ struct task_struct {
 #endif
 #ifdef CONFIG_LIVEPATCH
 	int patch_state;
+	/* context switch count + 1 of the last failed stack check, or 0 */
+	unsigned long patch_check_switches;
+	/* function found by that check, NULL if the stack was unreliable */
+	const char *patch_check_func;
 #endif
 #ifdef CONFIG_SECURITY
 	/* Used by LSM modules for access restriction: */
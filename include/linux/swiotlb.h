@@ -87,6 +87,8 @@ dma_addr_t swiotlb_map(struct device *dev, phys_addr_t phys,
  * @for_alloc:  %true if the pool is used for memory allocation
  * @nareas:  The area number in the pool.
  * @area_nslabs: The slot number in the area.
+ * @pcp:	Per-CPU caches of recently freed slot ranges, %NULL until set
+ *		up by an initcall for the default pool.
  */
 struct io_tlb_mem {
 	phys_addr_t start;
@@ -102,6 +104,13 @@ struct io_tlb_mem {
 	unsigned int area_nslabs;
 	struct io_tlb_area *areas;
 	struct io_tlb_slot *slots;
+	struct io_tlb_pcp __percpu *pcp;
+#ifdef CONFIG_DEBUG_FS
+	atomic_long_t total_used;
+	atomic_long_t used_hiwater;
+	atomic_long_t full_count;
+	atomic_long_t contended;
+#endif
 };
 extern struct io_tlb_mem io_tlb_default_mem;
 
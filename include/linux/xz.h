@@ -339,6 +339,97 @@ extern enum xz_ret xz_dec_microlzma_run(struct xz_dec_microlzma *s,
  */
 extern void xz_dec_microlzma_end(struct xz_dec_microlzma *s);
 
+/*
+ * Parallel decoder for .xz Streams made of several Blocks, like those
+ * written by "xz -T". The Index at the end of the Stream gives the size of
+ * every Block, so the Blocks can be located up front and decoded
+ * independently. This needs the whole Stream in memory and, like MicroLZMA,
+ * isn't available in preboot code.
+ */
+
+/**
+ * struct xz_index - Iterator over the Blocks listed in the Index
+ * @check_type: Check ID from the Stream Flags
+ * @count:      Number of Blocks in the Stream
+ * @uncompressed: Sum of the uncompressed sizes of all Blocks
+ *
+ * The remaining members are private to xz_index_init() and xz_index_next().
+ */
+struct xz_index {
+	uint8_t check_type;
+	uint64_t count;
+	uint64_t uncompressed;
+
+	const uint8_t *records;
+	size_t records_size;
+	size_t pos;
+	uint64_t remaining;
+	const uint8_t *block;
+};
+
+/**
+ * struct xz_block - A Block to be decoded by xz_dec_blocks()
+ * @in:         Start of the Block Header
+ * @in_size:    Size of the Block including Block Padding and Check
+ * @out:        Buffer for the uncompressed data, set by the caller
+ * @out_size:   Uncompressed size of the Block as stored in the Index
+ * @ret:        Set by xz_dec_blocks() to XZ_STREAM_END if the Block was
+ *              decoded successfully and to an error code otherwise
+ */
+struct xz_block {
+	const uint8_t *in;
+	size_t in_size;
+	uint8_t *out;
+	size_t out_size;
+	enum xz_ret ret;
+};
+
+/**
+ * xz_index_init() - Locate the Blocks of a single-Stream .xz file
+ * @idx:        Iterator to initialize
+ * @in:         The .xz file
+ * @in_size:    Size of the file. Stream Padding at the end is allowed.
+ *
+ * Returns XZ_OK if in holds exactly one Stream whose Index accounts for all
+ * the data between the Stream Header and the Index. XZ_FORMAT_ERROR means
+ * the file doesn't look like that, e.g. because it has several Streams;
+ * such files have to be decoded with xz_dec_run(). XZ_OPTIONS_ERROR is
+ * returned for Check types other than none and CRC32, and XZ_DATA_ERROR if
+ * the Stream Header, Index, or Stream Footer is corrupt.
+ */
+extern enum xz_ret xz_index_init(struct xz_index *idx, const uint8_t *in,
+				 size_t in_size);
+
+/**
+ * xz_index_next() - Get the next Block from the Index
+ * @idx:        Iterator initialized with xz_index_init()
+ * @block:      Filled in with everything but @block->out and @block->ret
+ *
+ * Returns 1 if a Block was returned and 0 once all Blocks have been
+ * returned. This is an int instead of bool to avoid requiring stdbool.h.
+ */
+extern int xz_index_next(struct xz_index *idx, struct xz_block *block);
+
+/**
+ * xz_dec_blocks() - Decode independent Blocks in parallel
+ * @blocks:     Blocks from xz_index_next() with an output buffer of at
+ *              least @blocks->out_size bytes each
+ * @nr_blocks:  Number of entries in blocks
+ * @check_type: Check ID from struct xz_index
+ * @max_workers: Maximum number of Blocks decoded at the same time, including
+ *              by the calling thread. 0 means one per online CPU.
+ *
+ * Each worker owns a single-call decoder and takes the next pending Block
+ * until none are left. The caller decodes Blocks as well and then waits for
+ * the other workers, so this function may sleep.
+ *
+ * Returns XZ_OK once every Block has been attempted, in which case the
+ * result of each Block is in its @ret member, or XZ_MEM_ERROR if not even
+ * a single decoder could be allocated.
+ */
+extern enum xz_ret xz_dec_blocks(struct xz_block *blocks, uint32_t nr_blocks,
+				 uint8_t check_type, uint32_t max_workers);
+
 /*
  * Standalone build (userspace build or in-kernel build for boot time use)
  * needs a CRC32 implementation. For normal in-kernel use, kernel's own
@@ -444,4 +444,45 @@ typedef ZSTD_frameHeader zstd_frame_header;
 size_t zstd_get_frame_header(zstd_frame_header *params, const void *src,
 	size_t src_size);
 
+/* ======   Parallel Decompression Functions ====== */
+
+/**
+ * struct zstd_frame_job - an independent zstd frame to decompress
+ * @src:          The start of the compressed frame.
+ * @src_size:     The compressed size of the frame, see
+ *                zstd_find_frame_compressed_size().
+ * @dst:          The buffer to decompress the frame into.
+ * @dst_capacity: The size of dst. It should be at least the frame content
+ *                size from zstd_get_frame_header().
+ * @result:       Set to the decompressed size of the frame or an error, which
+ *                can be checked using zstd_is_error().
+ */
+struct zstd_frame_job {
+	const void *src;
+	size_t src_size;
+	void *dst;
+	size_t dst_capacity;
+	size_t result;
+};
+
+/**
+ * zstd_decompress_frames() - decompress independent frames concurrently
+ * @jobs:        The frames to decompress. The frames must not reference each
+ *               other, which holds for any frame that does not use a
+ *               dictionary.
+ * @nr_jobs:     The number of entries in jobs.
+ * @max_workers: The maximum number of frames decompressed at the same time,
+ *               including by the calling thread. 0 means one per online CPU.
+ *
+ * Each worker owns a zstd_dctx and takes the next pending job until none are
+ * left. The caller works through jobs too, and then waits for the others, so
+ * this function may sleep.
+ *
+ * Return:       0 once every job has been attempted, in which case each job's
+ *               result must be checked, or -ENOMEM if not even a single
+ *               decompression context could be allocated.
+ */
+int zstd_decompress_frames(struct zstd_frame_job *jobs, unsigned int nr_jobs,
+	unsigned int max_workers);
+
 #endif  /* LINUX_ZSTD_H */
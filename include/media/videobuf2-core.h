@@ -86,6 +86,10 @@ struct vb2_buffer;
  *		dmabuf.
  * @unmap_dmabuf: releases access control to the dmabuf - allocator is notified
  *		  that this driver is done using the dmabuf for now.
+ * @rebind_dmabuf: move an attachment previously returned from the
+ *		   attach_dmabuf callback over to another buffer of the same
+ *		   queue, optional; allocators implementing it let vb2 keep
+ *		   attachments and their mappings cached across buffers.
  * @prepare:	called every time the buffer is passed from userspace to the
  *		driver, useful for cache synchronisation, optional.
  * @finish:	called every time the buffer is passed back from the driver
@@ -140,6 +144,7 @@ struct vb2_mem_ops {
 	void		(*detach_dmabuf)(void *buf_priv);
 	int		(*map_dmabuf)(void *buf_priv);
 	void		(*unmap_dmabuf)(void *buf_priv);
+	void		(*rebind_dmabuf)(struct vb2_buffer *vb, void *buf_priv);
 
 	void		*(*vaddr)(struct vb2_buffer *vb, void *buf_priv);
 	void		*(*cookie)(struct vb2_buffer *vb, void *buf_priv);
@@ -303,6 +308,7 @@ struct vb2_buffer {
 	u32		cnt_mem_detach_dmabuf;
 	u32		cnt_mem_map_dmabuf;
 	u32		cnt_mem_unmap_dmabuf;
+	u32		cnt_mem_rebind_dmabuf;
 	u32		cnt_mem_vaddr;
 	u32		cnt_mem_cookie;
 	u32		cnt_mem_num_users;
@@ -552,6 +558,9 @@ struct vb2_buf_ops {
  * @done_list:	list of buffers ready to be dequeued to userspace
  * @done_lock:	lock to protect done_list list
  * @done_wq:	waitqueue for processes waiting for buffers ready to be dequeued
+ * @dmabuf_cache: dma-buf attachments no longer bound to a buffer, kept
+ *		mapped so that a later QBUF of the same dma-buf can reuse them
+ * @dmabuf_cache_count: number of entries on @dmabuf_cache
  * @streaming:	current streaming state
  * @start_streaming_called: @start_streaming was called successfully and we
  *		started streaming.
@@ -618,6 +627,9 @@ struct vb2_queue {
 	spinlock_t			done_lock;
 	wait_queue_head_t		done_wq;
 
+	struct list_head		dmabuf_cache;
+	unsigned int			dmabuf_cache_count;
+
 	unsigned int			streaming:1;
 	unsigned int			start_streaming_called:1;
 	unsigned int			error:1;
@@ -14,6 +14,39 @@
 #include <rv/automata.h>
 #include <linux/rv.h>
 #include <linux/bug.h>
+#include <linux/irq_work.h>
+#include <linux/percpu.h>
+#include <linux/tracepoint.h>
+
+/*
+ * Deferred evaluation: instead of running the automaton in the tracepoint,
+ * per-cpu monitors can queue events to a per-cpu buffer that is evaluated in
+ * batches from irq_work. A batch is started at the next tick after the first
+ * event is queued, or right away once the buffer is half full, bounding the
+ * detection latency to a tick under normal load. Events that find the buffer
+ * full are dropped, and the monitor is reset after the batch so that it
+ * resynchronizes on the next start event.
+ */
+#define DA_DEFER_BUF_SIZE	512
+#define DA_DEFER_KIND_SHIFT	8
+#define DA_DEFER_EVENT_MASK	((1 << DA_DEFER_KIND_SHIFT) - 1)
+
+enum da_defer_kind {
+	DA_DEFER_EVENT,
+	DA_DEFER_START_EVENT,
+	DA_DEFER_START_RUN_EVENT,
+};
+
+struct da_defer_buf {
+	unsigned int	head;
+	unsigned int	tail;
+	unsigned long	handled;
+	unsigned long	dropped;
+	bool		resync;
+	struct irq_work	lazy_work;
+	struct irq_work	work;
+	u16		events[DA_DEFER_BUF_SIZE];
+};
 
 #ifdef CONFIG_RV_REACTORS
 
@@ -288,18 +321,190 @@ static void da_monitor_reset_all_##name(void)							\
 /*												\
  * da_monitor_init_##name - initialize all CPUs' monitor					\
  */												\
+static void da_defer_reset_##name(void);							\
 static inline int da_monitor_init_##name(void)							\
 {												\
 	da_monitor_reset_all_##name();								\
+	da_defer_reset_##name();								\
 	return 0;										\
 }												\
 												\
 /*												\
  * da_monitor_destroy_##name - destroy the monitor						\
  */												\
+static void da_defer_sync_##name(void);								\
 static inline void da_monitor_destroy_##name(void)						\
 {												\
-	return;											\
+	da_defer_sync_##name();									\
+}
+
+/*
+ * Deferred evaluation is only available to per-cpu monitors.
+ */
+#define DECLARE_DA_MON_DEFER_NONE(name, type)							\
+												\
+static inline bool da_defer_event_##name(enum events_##name event, unsigned int kind)		\
+{												\
+	return false;										\
+}
+
+/*
+ * Functions to queue events of a per-cpu monitor and evaluate them in batches.
+ */
+#define DECLARE_DA_MON_DEFER_PER_CPU(name, type)						\
+												\
+static void da_defer_drain_##name(struct irq_work *work);					\
+												\
+static DEFINE_PER_CPU(struct da_defer_buf, da_defer_buf_##name) = {				\
+	.lazy_work = IRQ_WORK_INIT_LAZY(da_defer_drain_##name),					\
+	.work = IRQ_WORK_INIT(da_defer_drain_##name),						\
+};												\
+												\
+/*												\
+ * __da_process_event_##name - apply one queued event as its handler would have			\
+ */												\
+static inline void										\
+__da_process_event_##name(struct da_monitor *da_mon, unsigned int kind,				\
+			  enum events_##name event)						\
+{												\
+	if (kind != DA_DEFER_EVENT && unlikely(!da_monitoring_##name(da_mon))) {		\
+		da_monitor_start_##name(da_mon);						\
+		if (kind == DA_DEFER_START_EVENT)						\
+			return;									\
+	}											\
+												\
+	if (unlikely(!da_monitoring_##name(da_mon)))						\
+		return;										\
+												\
+	if (!da_event_##name(da_mon, event))							\
+		da_monitor_reset_##name(da_mon);						\
+}												\
+												\
+/*												\
+ * da_defer_drain_##name - evaluate this CPU's queued events					\
+ */												\
+static void da_defer_drain_##name(struct irq_work *work)					\
+{												\
+	struct da_defer_buf *buf = this_cpu_ptr(&da_defer_buf_##name);				\
+	struct da_monitor *da_mon = da_get_monitor_##name();					\
+	unsigned int tail, head;								\
+	unsigned long flags;									\
+	bool enabled;										\
+	u16 entry;										\
+												\
+	local_irq_save(flags);									\
+	enabled = da_monitor_enabled_##name();							\
+	head = READ_ONCE(buf->head);								\
+	for (tail = buf->tail; tail != head; tail++) {						\
+		entry = buf->events[tail % DA_DEFER_BUF_SIZE];					\
+		if (enabled)									\
+			__da_process_event_##name(da_mon, entry >> DA_DEFER_KIND_SHIFT,		\
+						  entry & DA_DEFER_EVENT_MASK);			\
+		buf->handled++;									\
+	}											\
+	WRITE_ONCE(buf->tail, tail);								\
+												\
+	/* Queued events all precede the dropped ones. */					\
+	if (unlikely(READ_ONCE(buf->resync))) {							\
+		WRITE_ONCE(buf->resync, false);							\
+		da_monitor_reset_##name(da_mon);						\
+	}											\
+	local_irq_restore(flags);								\
+}												\
+												\
+/*												\
+ * da_defer_event_##name - queue an event if the monitor is in deferred mode			\
+ *												\
+ * Returns true if the event was taken care of, false if it has to be				\
+ * handled synchronously. Called from tracepoints, with preemption disabled.			\
+ */												\
+static inline bool da_defer_event_##name(enum events_##name event, unsigned int kind)		\
+{												\
+	struct da_defer_buf *buf;								\
+	unsigned int head, queued;								\
+	unsigned long flags;									\
+												\
+	if (likely(!READ_ONCE(rv_##name.deferred)))						\
+		return false;									\
+												\
+	if (!da_monitor_enabled_##name())							\
+		return true;									\
+												\
+	buf = this_cpu_ptr(&da_defer_buf_##name);						\
+												\
+	/* An NMI cannot be ordered against a batch running on this CPU. */			\
+	if (unlikely(in_nmi())) {								\
+		WRITE_ONCE(buf->resync, true);							\
+		return true;									\
+	}											\
+												\
+	local_irq_save(flags);									\
+	head = buf->head;									\
+	queued = head - buf->tail;								\
+	if (unlikely(queued >= DA_DEFER_BUF_SIZE)) {						\
+		buf->dropped++;									\
+		WRITE_ONCE(buf->resync, true);							\
+	} else {										\
+		buf->events[head % DA_DEFER_BUF_SIZE] = kind << DA_DEFER_KIND_SHIFT | event;	\
+		WRITE_ONCE(buf->head, head + 1);						\
+	}											\
+	local_irq_restore(flags);								\
+												\
+	if (queued == 0)									\
+		irq_work_queue(&buf->lazy_work);						\
+	else if (queued == DA_DEFER_BUF_SIZE / 2)						\
+		irq_work_queue(&buf->work);							\
+												\
+	return true;										\
+}												\
+												\
+/*												\
+ * da_defer_reset_##name - discard all CPUs' queued events and counters				\
+ */												\
+static void da_defer_reset_##name(void)								\
+{												\
+	struct da_defer_buf *buf;								\
+	int cpu;										\
+												\
+	for_each_possible_cpu(cpu) {								\
+		buf = per_cpu_ptr(&da_defer_buf_##name, cpu);					\
+		buf->head = buf->tail = 0;							\
+		buf->handled = buf->dropped = 0;						\
+		buf->resync = false;								\
+	}											\
+}												\
+												\
+/*												\
+ * da_defer_sync_##name - wait for in-flight probes and batches to finish			\
+ */												\
+static void da_defer_sync_##name(void)								\
+{												\
+	int cpu;										\
+												\
+	if (!READ_ONCE(rv_##name.deferred))							\
+		return;										\
+												\
+	tracepoint_synchronize_unregister();							\
+	for_each_possible_cpu(cpu) {								\
+		irq_work_sync(per_cpu_ptr(&da_defer_buf_##name.lazy_work, cpu));		\
+		irq_work_sync(per_cpu_ptr(&da_defer_buf_##name.work, cpu));			\
+	}											\
+}												\
+												\
+/*												\
+ * da_monitor_events_##name - events evaluated and dropped in deferred mode			\
+ */												\
+static void da_monitor_events_##name(unsigned long *handled, unsigned long *dropped)		\
+{												\
+	struct da_defer_buf *buf;								\
+	int cpu;										\
+												\
+	*handled = *dropped = 0;								\
+	for_each_possible_cpu(cpu) {								\
+		buf = per_cpu_ptr(&da_defer_buf_##name, cpu);					\
+		*handled += READ_ONCE(buf->handled);						\
+		*dropped += READ_ONCE(buf->dropped);						\
+	}											\
 }
 
 /*
@@ -386,9 +591,13 @@ static inline void __da_handle_event_##name(struct da_monitor *da_mon,				\
  */												\
 static inline void da_handle_event_##name(enum events_##name event)				\
 {												\
-	struct da_monitor *da_mon = da_get_monitor_##name();					\
+	struct da_monitor *da_mon;								\
 	bool retval;										\
 												\
+	if (da_defer_event_##name(event, DA_DEFER_EVENT))					\
+		return;										\
+												\
+	da_mon = da_get_monitor_##name();							\
 	retval = da_monitor_handling_event_##name(da_mon);					\
 	if (!retval)										\
 		return;										\
@@ -410,6 +619,9 @@ static inline bool da_handle_start_event_##name(enum events_##name event)			\
 {												\
 	struct da_monitor *da_mon;								\
 												\
+	if (da_defer_event_##name(event, DA_DEFER_START_EVENT))					\
+		return 1;									\
+												\
 	if (!da_monitor_enabled_##name())							\
 		return 0;									\
 												\
@@ -435,6 +647,9 @@ static inline bool da_handle_start_run_event_##name(enum events_##name event)
 {												\
 	struct da_monitor *da_mon;								\
 												\
+	if (da_defer_event_##name(event, DA_DEFER_START_RUN_EVENT))				\
+		return 1;									\
+												\
 	if (!da_monitor_enabled_##name())							\
 		return 0;									\
 												\
@@ -519,6 +734,7 @@ DECLARE_AUTOMATA_HELPERS(name, type)								\
 DECLARE_DA_MON_GENERIC_HELPERS(name, type)							\
 DECLARE_DA_MON_MODEL_HANDLER_IMPLICIT(name, type)						\
 DECLARE_DA_MON_INIT_GLOBAL(name, type)								\
+DECLARE_DA_MON_DEFER_NONE(name, type)								\
 DECLARE_DA_MON_MONITOR_HANDLER_IMPLICIT(name, type)
 
 /*
@@ -530,6 +746,7 @@ DECLARE_AUTOMATA_HELPERS(name, type)								\
 DECLARE_DA_MON_GENERIC_HELPERS(name, type)							\
 DECLARE_DA_MON_MODEL_HANDLER_IMPLICIT(name, type)						\
 DECLARE_DA_MON_INIT_PER_CPU(name, type)								\
+DECLARE_DA_MON_DEFER_PER_CPU(name, type)							\
 DECLARE_DA_MON_MONITOR_HANDLER_IMPLICIT(name, type)
 
 /*
@@ -75,6 +75,7 @@ enum cachefiles_prepare_read_trace {
 	cachefiles_trace_read_found_hole,
 	cachefiles_trace_read_found_part,
 	cachefiles_trace_read_have_data,
+	cachefiles_trace_read_have_map,
 	cachefiles_trace_read_no_data,
 	cachefiles_trace_read_no_file,
 	cachefiles_trace_read_seek_error,
@@ -157,6 +158,7 @@ enum cachefiles_error_trace {
 	EM(cachefiles_trace_read_found_hole,	"found-hole")		\
 	EM(cachefiles_trace_read_found_part,	"found-part")		\
 	EM(cachefiles_trace_read_have_data,	"have-data ")		\
+	EM(cachefiles_trace_read_have_map,	"have-map  ")		\
 	EM(cachefiles_trace_read_no_data,	"no-data   ")		\
 	EM(cachefiles_trace_read_no_file,	"no-file   ")		\
 	EM(cachefiles_trace_read_seek_error,	"seek-error")		\
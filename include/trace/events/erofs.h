@@ -250,6 +250,32 @@ TRACE_EVENT(erofs_destroy_inode,
 	TP_printk("dev = (%d,%d), nid = %llu", show_dev_nid(__entry))
 );
 
+TRACE_EVENT(z_erofs_decompress_job,
+	TP_PROTO(struct super_block *sb, unsigned int nr, u64 wait_ns,
+		 u64 run_ns),
+
+	TP_ARGS(sb, nr, wait_ns, run_ns),
+
+	TP_STRUCT__entry(
+		__field(	dev_t,		dev		)
+		__field(	unsigned int,	nr		)
+		__field(	u64,		wait_ns		)
+		__field(	u64,		run_ns		)
+	),
+
+	TP_fast_assign(
+		__entry->dev	= sb->s_dev;
+		__entry->nr	= nr;
+		__entry->wait_ns = wait_ns;
+		__entry->run_ns	= run_ns;
+	),
+
+	TP_printk("dev = (%d,%d), pclusters %u, queued %llu ns, "
+		  "decompressed in %llu ns",
+		  show_dev(__entry->dev), __entry->nr,
+		  __entry->wait_ns, __entry->run_ns)
+);
+
 #endif /* _TRACE_EROFS_H */
 
  /* This part must be outside protection */
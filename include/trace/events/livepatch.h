@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM livepatch
+
+#if !defined(_TRACE_LIVEPATCH_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_LIVEPATCH_H
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(klp_transition_stuck,
+
+	TP_PROTO(const char *name, int target_state, unsigned int running,
+		 unsigned int unreliable, unsigned int sleeping,
+		 unsigned int other),
+
+	TP_ARGS(name, target_state, running, unreliable, sleeping, other),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(int, target_state)
+		__field(unsigned int, running)
+		__field(unsigned int, unreliable)
+		__field(unsigned int, sleeping)
+		__field(unsigned int, other)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->target_state = target_state;
+		__entry->running = running;
+		__entry->unreliable = unreliable;
+		__entry->sleeping = sleeping;
+		__entry->other = other;
+	),
+
+	TP_printk("patch=%s target=%s running=%u unreliable=%u sleeping=%u other=%u",
+		  __get_str(name),
+		  __entry->target_state ? "patched" : "unpatched",
+		  __entry->running,
+		  __entry->unreliable,
+		  __entry->sleeping,
+		  __entry->other)
+);
+
+#endif /* _TRACE_LIVEPATCH_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -245,6 +245,32 @@ TRACE_EVENT(device_pm_callback_end,
 		__get_str(driver), __get_str(device), __entry->error)
 );
 
+TRACE_EVENT(device_pm_wait,
+
+	TP_PROTO(struct device *dev, struct device *superior, const char *link,
+		 u64 wait_ns),
+
+	TP_ARGS(dev, superior, link, wait_ns),
+
+	TP_STRUCT__entry(
+		__string(device, dev_name(dev))
+		__string(superior, dev_name(superior))
+		__field(const char *, link)
+		__field(u64, wait_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(device, dev_name(dev));
+		__assign_str(superior, dev_name(superior));
+		__entry->link = link;
+		__entry->wait_ns = wait_ns;
+	),
+
+	TP_printk("%s waited %llu ns for %s %s", __get_str(device),
+		  (unsigned long long)__entry->wait_ns, __entry->link,
+		  __get_str(superior))
+);
+
 TRACE_EVENT(suspend_resume,
 
 	TP_PROTO(const char *action, int val, bool start),
@@ -786,6 +786,40 @@ TRACE_EVENT(xprtrdma_nomrs_err,
 	)
 );
 
+TRACE_EVENT(xprtrdma_mr_cache,
+	TP_PROTO(
+		const struct rpcrdma_xprt *r_xprt,
+		const struct rpcrdma_req *req,
+		bool hit
+	),
+
+	TP_ARGS(r_xprt, req, hit),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, task_id)
+		__field(unsigned int, client_id)
+		__field(bool, hit)
+		__field(unsigned long, hits)
+		__field(unsigned long, misses)
+	),
+
+	TP_fast_assign(
+		const struct rpc_rqst *rqst = &req->rl_slot;
+
+		__entry->task_id = rqst->rq_task->tk_pid;
+		__entry->client_id = rqst->rq_task->tk_client->cl_clid;
+		__entry->hit = hit;
+		__entry->hits = r_xprt->rx_stats.mr_cache_hits;
+		__entry->misses = r_xprt->rx_stats.mr_cache_misses;
+	),
+
+	TP_printk(SUNRPC_TRACE_TASK_SPECIFIER " %s hits=%lu misses=%lu",
+		__entry->task_id, __entry->client_id,
+		__entry->hit ? "hit" : "miss",
+		__entry->hits, __entry->misses
+	)
+);
+
 DEFINE_RDCH_EVENT(read);
 DEFINE_WRCH_EVENT(write);
 DEFINE_WRCH_EVENT(reply);
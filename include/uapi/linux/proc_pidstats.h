@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_PROC_PIDSTATS_H
+#define _UAPI_LINUX_PROC_PIDSTATS_H
+
+#include <linux/types.h>
+
+/*
+ * Record format of /proc/pidstats.  Reading the file returns one record per
+ * thread group visible in the reader's pid namespace, in tgid order.  Readers
+ * must step over records using @size, which may grow as fields are appended.
+ */
+
+/* The I/O counters are valid (the reader may ptrace-read the task) */
+#define PROC_PIDSTATS_F_IO	(1U << 0)
+
+struct proc_pidstats {
+	__u32	size;		/* sizeof(struct proc_pidstats) */
+	__u32	flags;		/* PROC_PIDSTATS_F_* */
+	__u32	pid;		/* tgid, in the reader's pid namespace */
+	__u32	ppid;
+	__u32	state;		/* as the state letter of /proc/PID/stat */
+	__u32	num_threads;
+	__u64	utime_ns;
+	__u64	stime_ns;
+	__u64	start_time_ns;	/* since boot */
+	__u64	minflt;
+	__u64	majflt;
+	__u64	vsize;		/* bytes */
+	__u64	rss;		/* pages */
+	__u64	rchar;
+	__u64	wchar;
+	__u64	read_bytes;
+	__u64	write_bytes;
+};
+
+#endif /* _UAPI_LINUX_PROC_PIDSTATS_H */
@@ -17,6 +17,9 @@
 #include <linux/init_syscalls.h>
 #include <linux/task_work.h>
 #include <linux/umh.h>
+#include <linux/vmalloc.h>
+#include <linux/xz.h>
+#include <linux/zstd.h>
 
 static __initdata bool csum_present;
 static __initdata u32 io_csum;
@@ -486,6 +489,180 @@ static unsigned long my_inptr __initdata; /* index of next byte to be processed
 
 #include <linux/decompress/generic.h>
 
+#ifdef CONFIG_RD_ZSTD
+/*
+ * Archives compressed as several independent zstd frames, e.g. by
+ * "zstd -T0 --block-size=..." or in the seekable format, are unpacked a
+ * batch of frames at a time, with the frames of a batch decompressed in
+ * parallel and then flushed in order.
+ */
+#define ZSTD_BATCH_FRAMES	16
+#define ZSTD_MAX_FRAME_SIZE	(16 << 20)
+
+/*
+ * Returns the number of bytes unpacked, or 0 if buf does not start with at
+ * least two frames that can be batched. *rest is set if unpacking stopped
+ * at a frame that has to go through the streaming decompressor instead.
+ */
+static unsigned long __init unpack_zstd_frames(char *buf, unsigned long len,
+					       bool *rest)
+{
+	struct zstd_frame_job jobs[ZSTD_BATCH_FRAMES];
+	unsigned int nr_workers = min_t(unsigned int, num_online_cpus(),
+					 ZSTD_BATCH_FRAMES);
+	unsigned long done = 0, pos;
+	zstd_frame_header header;
+	unsigned int nr, i;
+	size_t size;
+
+	*rest = false;
+	while (!message && done < len) {
+		for (nr = 0, pos = done; nr < ZSTD_BATCH_FRAMES && pos < len; nr++) {
+			if (zstd_get_frame_header(&header, buf + pos, len - pos))
+				break;
+			*rest = true;
+			if (header.frameType != ZSTD_frame ||
+			    header.frameContentSize > ZSTD_MAX_FRAME_SIZE)
+				break;
+			size = zstd_find_frame_compressed_size(buf + pos, len - pos);
+			if (zstd_is_error(size))
+				break;
+			jobs[nr].dst = vmalloc(max_t(size_t, header.frameContentSize, 1));
+			if (!jobs[nr].dst)
+				break;
+			*rest = false;
+			jobs[nr].dst_capacity = header.frameContentSize;
+			jobs[nr].src = buf + pos;
+			jobs[nr].src_size = size;
+			pos += size;
+		}
+		if (!nr || (!done && nr == 1)) {
+			while (nr--)
+				vfree(jobs[nr].dst);
+			if (!done)
+				*rest = false;
+			break;
+		}
+
+		if (zstd_decompress_frames(jobs, nr, nr_workers))
+			error("can't allocate zstd decompression contexts");
+		for (i = 0; i < nr; i++) {
+			if (!message && (zstd_is_error(jobs[i].result) ||
+					 jobs[i].result != jobs[i].dst_capacity))
+				error("decompressor failed");
+			if (!message)
+				flush_buffer(jobs[i].dst, jobs[i].result);
+			vfree(jobs[i].dst);
+		}
+		done = pos;
+		if (*rest)
+			break;
+	}
+	return done;
+}
+#else
+static unsigned long __init unpack_zstd_frames(char *buf, unsigned long len,
+					       bool *rest)
+{
+	*rest = false;
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_RD_XZ
+/*
+ * Single-Stream .xz archives made of several Blocks, as written by "xz -T",
+ * are unpacked a batch of Blocks at a time in the same way. The Index at
+ * the end of the Stream tells where every Block starts.
+ */
+#define XZ_BATCH_BLOCKS		16
+#define XZ_MAX_BLOCK_SIZE	(16 << 20)
+
+/*
+ * Returns the number of bytes unpacked, or 0 if buf is not a Stream of at
+ * least two Blocks that can be batched. A Block can't be handed over to the
+ * streaming decompressor on its own, so that is decided for the whole
+ * Stream before unpacking anything. If the first output buffer can't be
+ * allocated, 0 is returned as well and the streaming decompressor does it.
+ */
+static unsigned long __init unpack_xz_blocks(char *buf, unsigned long len)
+{
+	struct xz_block blocks[XZ_BATCH_BLOCKS];
+	unsigned int nr_workers = min_t(unsigned int, num_online_cpus(),
+					 XZ_BATCH_BLOCKS);
+	struct xz_index idx, scan, prev;
+	unsigned long max_size = 1;
+	unsigned int nr, i, batch;
+	bool started = false, nomem;
+
+	if (xz_index_init(&idx, (const u8 *)buf, len) != XZ_OK || idx.count < 2)
+		return 0;
+	scan = idx;
+	while (xz_index_next(&scan, &blocks[0])) {
+		if (blocks[0].out_size > XZ_MAX_BLOCK_SIZE)
+			return 0;
+		max_size = max_t(unsigned long, max_size, blocks[0].out_size);
+	}
+
+	/*
+	 * Keep the output buffers of a batch within a quarter of the available
+	 * memory, the unpacked files need to go somewhere as well.
+	 */
+	batch = clamp_t(unsigned long,
+			((unsigned long)si_mem_available() << PAGE_SHIFT) / 4 /
+			max_size, 1, XZ_BATCH_BLOCKS);
+
+	while (!message) {
+		nomem = false;
+		for (nr = 0; nr < batch; nr++) {
+			prev = idx;
+			if (!xz_index_next(&idx, &blocks[nr]))
+				break;
+			blocks[nr].out = __vmalloc(max_t(size_t, blocks[nr].out_size, 1),
+						   GFP_KERNEL | __GFP_NOWARN);
+			if (!blocks[nr].out) {
+				/* retry it in the next, smaller, batch */
+				idx = prev;
+				batch = max(nr, 1U);
+				nomem = true;
+				break;
+			}
+		}
+		if (!nr) {
+			if (nomem && !started)
+				return 0;
+			if (nomem)
+				error("can't allocate xz output buffer");
+			break;
+		}
+
+		if (xz_dec_blocks(blocks, nr, idx.check_type,
+				  nr_workers) != XZ_OK) {
+			if (!started) {
+				while (nr--)
+					vfree(blocks[nr].out);
+				return 0;
+			}
+			error("can't allocate xz decoders");
+		}
+		for (i = 0; i < nr; i++) {
+			if (!message && blocks[i].ret != XZ_STREAM_END)
+				error("decompressor failed");
+			if (!message)
+				flush_buffer(blocks[i].out, blocks[i].out_size);
+			vfree(blocks[i].out);
+		}
+		started = true;
+	}
+	return len;
+}
+#else
+static unsigned long __init unpack_xz_blocks(char *buf, unsigned long len)
+{
+	return 0;
+}
+#endif
+
 static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 {
 	long written;
@@ -522,8 +699,22 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		decompress = decompress_method(buf, len, &compress_name);
 		pr_debug("Detected %s compressed data\n", compress_name);
 		if (decompress) {
-			int res = decompress(buf, len, NULL, flush_buffer, NULL,
-				   &my_inptr, error);
+			unsigned long done = 0;
+			bool rest = true;
+			int res = 0;
+
+			my_inptr = 0;
+			if (!strcmp(compress_name, "zstd")) {
+				done = unpack_zstd_frames(buf, len, &rest);
+			} else if (!strcmp(compress_name, "xz")) {
+				done = unpack_xz_blocks(buf, len);
+				rest = false;
+			}
+			if (!done || rest)
+				res = decompress(buf + done, len - done, NULL,
+						 flush_buffer, NULL, &my_inptr,
+						 error);
+			my_inptr += done;
 			if (res)
 				error("decompressor failed");
 		} else if (compress_name) {
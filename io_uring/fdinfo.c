@@ -11,6 +11,7 @@
 
 #include "io_uring.h"
 #include "sqpoll.h"
+#include "tctx.h"
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
@@ -152,6 +153,17 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq_pid);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
+	if (ctx->flags & IORING_SETUP_SQPOLL) {
+		u64 batches = READ_ONCE(ctx->sq_batches);
+
+		seq_printf(m, "SqSubmitted:\t%llu\n", READ_ONCE(ctx->sq_submitted));
+		seq_printf(m, "SqBatches:\t%llu\n", batches);
+		seq_printf(m, "SqDeficit:\t%u\n", READ_ONCE(ctx->sq_deficit));
+		seq_printf(m, "SqAvgSubmitNs:\t%llu\n", batches ?
+			   div64_u64(READ_ONCE(ctx->sq_submit_ns), batches) : 0);
+		seq_printf(m, "SqMaxSubmitNs:\t%llu\n",
+			   READ_ONCE(ctx->sq_submit_max_ns));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -168,6 +180,26 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 		seq_printf(m, "%5u: 0x%llx/%u\n", i, buf->ubuf, len);
 	}
+	seq_printf(m, "IoWqSteal:\t%d\n", ctx->iowq_steal);
+	if (has_lock && ctx->iowq_steal) {
+		int node;
+
+		for_each_online_node(node) {
+			unsigned long steals = 0, stolen = 0;
+			struct io_tctx_node *tnode;
+
+			list_for_each_entry(tnode, &ctx->tctx_list, ctx_node) {
+				struct io_uring_task *tctx = tnode->task->io_uring;
+
+				if (tctx && tctx->io_wq)
+					io_wq_steal_stats(tctx->io_wq, node,
+							  &steals, &stolen);
+			}
+			seq_printf(m, "%5d: steals:%lu, stolen:%lu\n", node,
+				   steals, stolen);
+		}
+	}
+
 	if (has_lock && !xa_empty(&ctx->personalities)) {
 		unsigned long index;
 		const struct cred *cred;
@@ -32,6 +32,7 @@ enum {
 
 enum {
 	IO_WQ_BIT_EXIT		= 0,	/* wq exiting */
+	IO_WQ_BIT_STEAL		= 1,	/* idle workers may steal remote work */
 };
 
 enum {
@@ -107,6 +108,14 @@ struct io_wqe {
 	struct io_wq_work *hash_tail[IO_WQ_NR_HASH_BUCKETS];
 
 	cpumask_var_t cpu_mask;
+
+	/* work taken from other nodes by our workers, and vice versa */
+	atomic_long_t nr_steals;
+	atomic_long_t nr_stolen;
+
+	/* other nodes to steal from, nearest first */
+	int nr_steal_nodes;
+	int steal_nodes[];
 };
 
 /*
@@ -473,14 +482,13 @@ static bool io_wait_on_hash(struct io_wqe *wqe, unsigned int hash)
 	return ret;
 }
 
-static struct io_wq_work *io_get_next_work(struct io_wqe_acct *acct,
-					   struct io_worker *worker)
+static struct io_wq_work *io_get_next_work(struct io_wqe *wqe,
+					   struct io_wqe_acct *acct)
 	__must_hold(acct->lock)
 {
 	struct io_wq_work_node *node, *prev;
 	struct io_wq_work *work, *tail;
 	unsigned int stall_hash = -1U;
-	struct io_wqe *wqe = worker->wqe;
 
 	wq_list_for_each(node, prev, &acct->work_list) {
 		unsigned int hash;
@@ -544,16 +552,77 @@ static void io_assign_current_work(struct io_worker *worker,
 	raw_spin_unlock(&worker->lock);
 }
 
+/*
+ * Look for work on the queues of other nodes, nearest first. Only work of
+ * the same bounded/unbounded class as the worker is considered, so the
+ * per-node worker limits still hold. Hashed work is handled the same way
+ * the owning node would handle it, including marking the remote queue as
+ * stalled if everything left on it is waiting for a busy hash.
+ */
+static struct io_wq_work *io_wqe_steal_work(struct io_worker *worker,
+					    struct io_wqe_acct **src)
+{
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq *wq = wqe->wq;
+	int index = io_wqe_get_acct(worker)->index;
+	int i;
+
+	if (!test_bit(IO_WQ_BIT_STEAL, &wq->state))
+		return NULL;
+
+	for (i = 0; i < wqe->nr_steal_nodes; i++) {
+		struct io_wqe *remote = wq->wqes[wqe->steal_nodes[i]];
+		struct io_wqe_acct *acct = &remote->acct[index];
+		struct io_wq_work *work;
+
+		if (!io_acct_run_queue(acct))
+			continue;
+
+		raw_spin_lock(&acct->lock);
+		work = io_get_next_work(remote, acct);
+		raw_spin_unlock(&acct->lock);
+		if (work) {
+			atomic_long_inc(&wqe->nr_steals);
+			atomic_long_inc(&remote->nr_stolen);
+			*src = acct;
+			return work;
+		}
+	}
+
+	return NULL;
+}
+
+static bool io_wqe_steal_pending(struct io_worker *worker)
+{
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq *wq = wqe->wq;
+	int index = io_wqe_get_acct(worker)->index;
+	int i;
+
+	if (!test_bit(IO_WQ_BIT_STEAL, &wq->state))
+		return false;
+
+	for (i = 0; i < wqe->nr_steal_nodes; i++) {
+		struct io_wqe *remote = wq->wqes[wqe->steal_nodes[i]];
+
+		if (io_acct_run_queue(&remote->acct[index]))
+			return true;
+	}
+
+	return false;
+}
+
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work);
 
 static void io_worker_handle_work(struct io_worker *worker)
 {
-	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
+	struct io_wqe_acct *local_acct = io_wqe_get_acct(worker);
 	struct io_wqe *wqe = worker->wqe;
 	struct io_wq *wq = wqe->wq;
 	bool do_kill = test_bit(IO_WQ_BIT_EXIT, &wq->state);
 
 	do {
+		struct io_wqe_acct *acct = local_acct;
 		struct io_wq_work *work;
 
 		/*
@@ -564,8 +633,10 @@ static void io_worker_handle_work(struct io_worker *worker)
 		 * clear the stalled flag.
 		 */
 		raw_spin_lock(&acct->lock);
-		work = io_get_next_work(acct, worker);
+		work = io_get_next_work(wqe, acct);
 		raw_spin_unlock(&acct->lock);
+		if (!work && !do_kill)
+			work = io_wqe_steal_work(worker, &acct);
 		if (work) {
 			__io_worker_busy(wqe, worker);
 
@@ -638,7 +709,7 @@ static int io_wqe_worker(void *data)
 		long ret;
 
 		set_current_state(TASK_INTERRUPTIBLE);
-		while (io_acct_run_queue(acct))
+		while (io_acct_run_queue(acct) || io_wqe_steal_pending(worker))
 			io_worker_handle_work(worker);
 
 		raw_spin_lock(&wqe->lock);
@@ -910,6 +981,28 @@ static bool io_wq_work_match_item(struct io_wq_work *work, void *data)
 	return work == data;
 }
 
+/*
+ * Work was queued but no local worker was free to take it, and none will be
+ * created for it. If stealing is enabled, kick an idle worker on the nearest
+ * node that has one, it'll find the work through io_wqe_steal_work().
+ */
+static void io_wqe_wake_remote(struct io_wqe *wqe, struct io_wqe_acct *acct)
+{
+	int i;
+
+	if (!test_bit(IO_WQ_BIT_STEAL, &wqe->wq->state))
+		return;
+
+	rcu_read_lock();
+	for (i = 0; i < wqe->nr_steal_nodes; i++) {
+		struct io_wqe *remote = wqe->wq->wqes[wqe->steal_nodes[i]];
+
+		if (io_wqe_activate_free_worker(remote, &remote->acct[acct->index]))
+			break;
+	}
+	rcu_read_unlock();
+}
+
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 {
 	struct io_wqe_acct *acct = io_work_get_acct(wqe, work);
@@ -960,6 +1053,8 @@ static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work)
 		match.cancel_all	= false,
 
 		io_acct_cancel_pending_work(wqe, acct, &match);
+	} else if (do_create) {
+		io_wqe_wake_remote(wqe, acct);
 	}
 }
 
@@ -1142,6 +1237,26 @@ static int io_wqe_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 	return 1;
 }
 
+static void io_wqe_init_steal_nodes(struct io_wqe *wqe, int node)
+{
+	int other, i, nr = 0;
+
+	for_each_node(other) {
+		if (other == node)
+			continue;
+		/* insertion sort on distance, nearest node first */
+		for (i = nr; i > 0; i--) {
+			if (node_distance(node, wqe->steal_nodes[i - 1]) <=
+			    node_distance(node, other))
+				break;
+			wqe->steal_nodes[i] = wqe->steal_nodes[i - 1];
+		}
+		wqe->steal_nodes[i] = other;
+		nr++;
+	}
+	wqe->nr_steal_nodes = nr;
+}
+
 struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 {
 	int ret, node, i;
@@ -1171,10 +1286,12 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 
 		if (!node_online(alloc_node))
 			alloc_node = NUMA_NO_NODE;
-		wqe = kzalloc_node(sizeof(struct io_wqe), GFP_KERNEL, alloc_node);
+		wqe = kzalloc_node(struct_size(wqe, steal_nodes, nr_node_ids),
+				   GFP_KERNEL, alloc_node);
 		if (!wqe)
 			goto err;
 		wq->wqes[node] = wqe;
+		io_wqe_init_steal_nodes(wqe, node);
 		if (!alloc_cpumask_var(&wqe->cpu_mask, GFP_KERNEL))
 			goto err;
 		cpumask_copy(wqe->cpu_mask, cpumask_of_node(node));
@@ -1416,6 +1533,30 @@ int io_wq_max_workers(struct io_wq *wq, int *new_count)
 	return 0;
 }
 
+/*
+ * Allow idle workers to pick up work queued on other nodes, returns whether
+ * stealing was enabled before.
+ */
+bool io_wq_set_steal(struct io_wq *wq, bool enable)
+{
+	if (enable)
+		return test_and_set_bit(IO_WQ_BIT_STEAL, &wq->state);
+	return test_and_clear_bit(IO_WQ_BIT_STEAL, &wq->state);
+}
+
+/*
+ * Add the number of work items the workers of @node took from other nodes
+ * to @steals, and the number other nodes took from @node to @stolen.
+ */
+void io_wq_steal_stats(struct io_wq *wq, int node, unsigned long *steals,
+		       unsigned long *stolen)
+{
+	struct io_wqe *wqe = wq->wqes[node];
+
+	*steals += atomic_long_read(&wqe->nr_steals);
+	*stolen += atomic_long_read(&wqe->nr_stolen);
+}
+
 static __init int io_wq_init(void)
 {
 	int ret;
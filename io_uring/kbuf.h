@@ -4,6 +4,13 @@
 
 #include <uapi/linux/io_uring.h>
 
+#define IO_BUFFER_LIST_BUF_PER_PAGE (PAGE_SIZE / sizeof(struct io_uring_buf))
+
+enum {
+	/* ring buffers may be consumed in parts, see io_kbuf_commit() */
+	IOBL_INC	= 1,
+};
+
 struct io_buffer_list {
 	/*
 	 * If ->buf_nr_pages is set, then buf_pages/buf_ring are used. If not,
@@ -23,6 +30,7 @@ struct io_buffer_list {
 	__u16 nr_entries;
 	__u16 head;
 	__u16 mask;
+	__u16 flags;
 };
 
 struct io_buffer {
@@ -46,10 +54,47 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags);
 int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags);
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len, unsigned issue_flags);
 
 void io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 
+static inline struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						      __u16 head)
+{
+	head &= bl->mask;
+	if (head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	return (struct io_uring_buf *)
+		page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]) +
+		(head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
+/*
+ * Consume @len bytes of the buffer at the head of the ring. For classic
+ * rings the whole buffer is always consumed. For incremental rings the
+ * buffer entry is advanced past the transferred data and stays at the head
+ * until it has been used up, so the next selection appends to it. A
+ * transfer that failed or moved no data consumes the whole buffer, so
+ * userspace never sees a buffer marked as still in use without data.
+ * Returns false if the buffer is still owned by the kernel.
+ */
+static inline bool io_kbuf_commit(struct io_buffer_list *bl, int len)
+{
+	if ((bl->flags & IOBL_INC) && len > 0) {
+		struct io_uring_buf *buf = io_ring_head_to_buf(bl, bl->head);
+		u32 buf_len = READ_ONCE(buf->len);
+
+		if (len < buf_len) {
+			WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + len);
+			WRITE_ONCE(buf->len, buf_len - len);
+			return false;
+		}
+	}
+	bl->head++;
+	return true;
+}
+
 static inline void io_kbuf_recycle_ring(struct io_kiocb *req)
 {
 	/*
@@ -57,7 +102,10 @@ static inline void io_kbuf_recycle_ring(struct io_kiocb *req)
 	 * the flag and hence ensure that bl->head doesn't get incremented.
 	 * If the tail has already been incremented, hang on to it.
 	 * The exception is partial io, that case we should increment bl->head
-	 * to monopolize the buffer.
+	 * to monopolize the buffer. For incremental rings that consumes the
+	 * rest of the buffer too, like a selection from io-wq does: the
+	 * request keeps appending to it on retry, and as buf_list is cleared
+	 * the completion won't commit again nor flag IORING_CQE_F_BUF_MORE.
 	 */
 	if (req->buf_list) {
 		if (req->flags & REQ_F_PARTIAL_IO) {
@@ -92,7 +140,7 @@ static inline void io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 		io_kbuf_recycle_ring(req);
 }
 
-static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
+static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req, int len,
 					      struct list_head *list)
 {
 	unsigned int ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
@@ -100,7 +148,8 @@ static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
 	if (req->flags & REQ_F_BUFFER_RING) {
 		if (req->buf_list) {
 			req->buf_index = req->buf_list->bgid;
-			req->buf_list->head++;
+			if (!io_kbuf_commit(req->buf_list, len))
+				ret |= IORING_CQE_F_BUF_MORE;
 		}
 		req->flags &= ~REQ_F_BUFFER_RING;
 	} else {
@@ -118,15 +167,15 @@ static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf_list(req, &req->ctx->io_buffers_comp);
+	return __io_put_kbuf_list(req, req->cqe.res, &req->ctx->io_buffers_comp);
 }
 
-static inline unsigned int io_put_kbuf(struct io_kiocb *req,
+static inline unsigned int io_put_kbuf(struct io_kiocb *req, int len,
 				       unsigned issue_flags)
 {
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf(req, issue_flags);
+	return __io_put_kbuf(req, len, issue_flags);
 }
 #endif
@@ -863,7 +863,7 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf(req, ret, issue_flags);
 	if (kmsg->msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -964,7 +964,7 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf(req, ret, issue_flags);
 	if (msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -1015,6 +1015,8 @@ int io_send_zc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	notif->cqe.res = 0;
 	notif->cqe.flags = IORING_CQE_F_NOTIF;
 	req->flags |= REQ_F_NEED_CLEANUP;
+	if (unlikely(io_notif_batch_attach(notif)))
+		return -ENOMEM;
 	if (zc->flags & IORING_RECVSEND_FIXED_BUF) {
 		unsigned idx = READ_ONCE(sqe->buf_index);
 
@@ -1120,7 +1122,7 @@ int io_send_zc(struct io_kiocb *req, unsigned int issue_flags)
 	struct msghdr msg;
 	struct iovec iov;
 	struct socket *sock;
-	unsigned msg_flags;
+	unsigned msg_flags, cflags;
 	int ret, min_ret = 0;
 
 	sock = sock_from_file(req->file);
@@ -1205,11 +1207,12 @@ int io_send_zc(struct io_kiocb *req, unsigned int issue_flags)
 	 * If we're in io-wq we can't rely on tw ordering guarantees, defer
 	 * flushing notif to io_send_zc_cleanup()
 	 */
+	cflags = io_notif_send_cflags(zc->notif);
 	if (!(issue_flags & IO_URING_F_UNLOCKED)) {
 		io_notif_flush(zc->notif);
 		req->flags &= ~REQ_F_NEED_CLEANUP;
 	}
-	io_req_set_res(req, ret, IORING_CQE_F_MORE);
+	io_req_set_res(req, ret, cflags);
 	return IOU_OK;
 }
 
@@ -1218,7 +1221,7 @@ int io_sendmsg_zc(struct io_kiocb *req, unsigned int issue_flags)
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
 	struct io_async_msghdr iomsg, *kmsg;
 	struct socket *sock;
-	unsigned flags;
+	unsigned flags, cflags;
 	int ret, min_ret = 0;
 
 	sock = sock_from_file(req->file);
@@ -1280,11 +1283,12 @@ int io_sendmsg_zc(struct io_kiocb *req, unsigned int issue_flags)
 	 * If we're in io-wq we can't rely on tw ordering guarantees, defer
 	 * flushing notif to io_send_zc_cleanup()
 	 */
+	cflags = io_notif_send_cflags(sr->notif);
 	if (!(issue_flags & IO_URING_F_UNLOCKED)) {
 		io_notif_flush(sr->notif);
 		req->flags &= ~REQ_F_NEED_CLEANUP;
 	}
-	io_req_set_res(req, ret, IORING_CQE_F_MORE);
+	io_req_set_res(req, ret, cflags);
 	return IOU_OK;
 }
 
@@ -1297,7 +1301,7 @@ void io_sendrecv_fail(struct io_kiocb *req)
 
 	if ((req->flags & REQ_F_NEED_CLEANUP) &&
 	    (req->opcode == IORING_OP_SEND_ZC || req->opcode == IORING_OP_SENDMSG_ZC))
-		req->cqe.flags |= IORING_CQE_F_MORE;
+		req->cqe.flags |= io_notif_send_cflags(sr->notif);
 }
 
 int io_accept_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
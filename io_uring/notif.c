@@ -9,6 +9,21 @@
 #include "notif.h"
 #include "rsrc.h"
 
+static void io_notif_batch_put(struct io_notif_batch *batch)
+{
+	s32 res;
+
+	if (!refcount_dec_and_test(&batch->refs))
+		return;
+
+	res = batch->nr;
+	if (batch->zc_copied)
+		res |= IORING_NOTIF_USAGE_ZC_COPIED;
+	io_post_aux_cqe(batch->ctx, batch->seq, res,
+			IORING_CQE_F_NOTIF | IORING_CQE_F_NOTIF_RANGE, true);
+	kfree(batch);
+}
+
 static void __io_notif_complete_tw(struct io_kiocb *notif, bool *locked)
 {
 	struct io_notif_data *nd = io_notif_to_data(notif);
@@ -19,9 +34,16 @@ static void __io_notif_complete_tw(struct io_kiocb *notif, bool *locked)
 		nd->account_pages = 0;
 	}
 
-	if (nd->zc_report && (nd->zc_copied || !nd->zc_used))
+	if (nd->zc_report && (nd->zc_copied || !nd->zc_used)) {
 		notif->cqe.res |= IORING_NOTIF_USAGE_ZC_COPIED;
+		if (nd->batch)
+			nd->batch->zc_copied = true;
+	}
 
+	if (nd->batch) {
+		io_notif_batch_put(nd->batch);
+		nd->batch = NULL;
+	}
 	io_req_task_complete(notif, locked);
 }
 
@@ -64,6 +86,7 @@ struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx)
 
 	nd = io_notif_to_data(notif);
 	nd->account_pages = 0;
+	nd->batch = NULL;
 	nd->uarg.flags = SKBFL_ZEROCOPY_FRAG | SKBFL_DONT_ORPHAN;
 	nd->uarg.callback = io_uring_tx_zerocopy_callback;
 	nd->zc_report = nd->zc_used = nd->zc_copied = false;
@@ -82,3 +105,81 @@ void io_notif_flush(struct io_kiocb *notif)
 		io_req_task_work_add(notif);
 	}
 }
+
+/*
+ * Close the currently open notification window, if any. Its range CQE is
+ * posted once all sends in it have completed.
+ */
+void io_notif_batch_close(struct io_ring_ctx *ctx)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_notif_batch *batch = ctx->notif_batch;
+
+	if (batch) {
+		ctx->notif_batch = NULL;
+		io_notif_batch_put(batch);
+	}
+}
+
+/*
+ * If notification coalescing is enabled, attach the notif to the open
+ * window, opening a new one if needed. Every coalesced send gets the next
+ * 64-bit sequence number of the ring, in submission order.
+ */
+int io_notif_batch_attach(struct io_kiocb *notif)
+	__must_hold(&notif->ctx->uring_lock)
+{
+	struct io_ring_ctx *ctx = notif->ctx;
+	struct io_notif_batch *batch = ctx->notif_batch;
+
+	if (!ctx->notif_batch_nr)
+		return 0;
+
+	if (!batch) {
+		batch = kmalloc(sizeof(*batch), GFP_KERNEL);
+		if (!batch)
+			return -ENOMEM;
+		refcount_set(&batch->refs, 1);
+		batch->ctx = ctx;
+		batch->seq = ctx->notif_seq;
+		batch->nr = 0;
+		batch->zc_copied = false;
+		ctx->notif_batch = batch;
+	}
+
+	refcount_inc(&batch->refs);
+	batch->nr++;
+	ctx->notif_seq++;
+	io_notif_to_data(notif)->batch = batch;
+	notif->flags |= REQ_F_CQE_SKIP;
+
+	if (batch->nr >= ctx->notif_batch_nr)
+		io_notif_batch_close(ctx);
+	return 0;
+}
+
+int io_register_notif_batch(struct io_ring_ctx *ctx, void __user *arg)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_uring_notif_batch reg;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.flags & ~IORING_NOTIF_BATCH_FLUSH)
+		return -EINVAL;
+	if (reg.resv[0] || reg.resv[1])
+		return -EINVAL;
+	if (reg.nr > IO_NOTIF_BATCH_MAX)
+		return -EINVAL;
+
+	/* sends already in a window keep their window, resizing closes it */
+	if ((reg.flags & IORING_NOTIF_BATCH_FLUSH) ||
+	    reg.nr != ctx->notif_batch_nr)
+		io_notif_batch_close(ctx);
+	ctx->notif_batch_nr = reg.nr;
+
+	reg.seq = ctx->notif_seq;
+	if (copy_to_user(arg, &reg, sizeof(reg)))
+		return -EFAULT;
+	return 0;
+}
@@ -9,10 +9,27 @@
 
 #define IO_NOTIF_SPLICE_BATCH	32
 
+/* upper bound for the number of sends covered by one range notification */
+#define IO_NOTIF_BATCH_MAX	4096
+
+/*
+ * A window of consecutive zerocopy sends sharing a single notification.
+ * Holds one reference per attached send plus one while the window is still
+ * open for new sends. The range CQE is posted when the last one is dropped.
+ */
+struct io_notif_batch {
+	refcount_t		refs;
+	struct io_ring_ctx	*ctx;
+	u64			seq;
+	unsigned int		nr;
+	bool			zc_copied;
+};
+
 struct io_notif_data {
 	struct file		*file;
 	struct ubuf_info	uarg;
 	unsigned long		account_pages;
+	struct io_notif_batch	*batch;
 	bool			zc_report;
 	bool			zc_used;
 	bool			zc_copied;
@@ -20,12 +37,26 @@ struct io_notif_data {
 
 void io_notif_flush(struct io_kiocb *notif);
 struct io_kiocb *io_alloc_notif(struct io_ring_ctx *ctx);
+int io_notif_batch_attach(struct io_kiocb *notif);
+void io_notif_batch_close(struct io_ring_ctx *ctx);
+int io_register_notif_batch(struct io_ring_ctx *ctx, void __user *arg);
 
 static inline struct io_notif_data *io_notif_to_data(struct io_kiocb *notif)
 {
 	return io_kiocb_to_cmd(notif, struct io_notif_data);
 }
 
+/*
+ * CQE flags for the send request itself. Sends whose notification is
+ * coalesced into a range don't get an individual notification, so don't
+ * tell userspace to wait for one. Must be called before the notif is
+ * flushed.
+ */
+static inline unsigned int io_notif_send_cflags(struct io_kiocb *notif)
+{
+	return io_notif_to_data(notif)->batch ? 0 : IORING_CQE_F_MORE;
+}
+
 static inline int io_notif_account_mem(struct io_kiocb *notif, unsigned len)
 {
 	struct io_ring_ctx *ctx = notif->ctx;
@@ -19,6 +19,18 @@
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 
+/*
+ * Each round, every ring on a shared SQPOLL thread gets this many SQEs
+ * worth of budget added to its deficit. Budget left over because the
+ * ring could not submit everything is carried into the next round, up to
+ * IORING_SQPOLL_MAX_DEFICIT.
+ */
+#define IORING_SQPOLL_QUANTUM		IORING_SQPOLL_CAP_ENTRIES_VALUE
+#define IORING_SQPOLL_MAX_DEFICIT	(4 * IORING_SQPOLL_QUANTUM)
+
+/* keep spinning for this many average SQ inter-arrival gaps */
+#define IORING_SQPOLL_IDLE_GAPS		4
+
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
 	IO_SQ_THREAD_SHOULD_PARK,
@@ -164,15 +176,49 @@ static inline bool io_sqd_events_pending(struct io_sq_data *sqd)
 	return READ_ONCE(sqd->state);
 }
 
+/*
+ * Deficit round robin across the rings sharing a SQPOLL thread: a ring
+ * may submit up to its accumulated deficit, and whatever it submits is
+ * charged against it. An empty ring forfeits its deficit, so rings that
+ * were idle can't come back with a big burst allowance.
+ */
+static unsigned int io_sq_budget(struct io_ring_ctx *ctx,
+				 unsigned int to_submit)
+{
+	if (!to_submit) {
+		ctx->sq_deficit = 0;
+		return 0;
+	}
+
+	ctx->sq_deficit = min(ctx->sq_deficit + IORING_SQPOLL_QUANTUM,
+			      IORING_SQPOLL_MAX_DEFICIT);
+	return min(to_submit, ctx->sq_deficit);
+}
+
+static void io_sq_charge(struct io_ring_ctx *ctx, int submitted, u64 start)
+{
+	u64 delta = ktime_get_ns() - start;
+
+	if (submitted > 0) {
+		ctx->sq_deficit -= min_t(unsigned int, submitted,
+					 ctx->sq_deficit);
+		ctx->sq_submitted += submitted;
+	}
+	ctx->sq_batches++;
+	ctx->sq_submit_ns += delta;
+	if (delta > ctx->sq_submit_max_ns)
+		ctx->sq_submit_max_ns = delta;
+}
+
 static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 {
 	unsigned int to_submit;
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	/* if we're handling multiple rings, budget submits for fairness */
+	if (cap_entries)
+		to_submit = io_sq_budget(ctx, to_submit);
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -189,8 +235,12 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 		 * but also it is relied upon by io_ring_exit_work()
 		 */
 		if (to_submit && likely(!percpu_ref_is_dying(&ctx->refs)) &&
-		    !(ctx->flags & IORING_SETUP_R_DISABLED))
+		    !(ctx->flags & IORING_SETUP_R_DISABLED)) {
+			u64 start = ktime_get_ns();
+
 			ret = io_submit_sqes(ctx, to_submit);
+			io_sq_charge(ctx, ret, start);
+		}
 		mutex_unlock(&ctx->uring_lock);
 
 		if (to_submit && wq_has_sleeper(&ctx->sqo_sq_wait))
@@ -202,6 +252,39 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	return ret;
 }
 
+/*
+ * Track the average gap between rounds that found new SQEs, and derive
+ * how long to keep spinning from it. If SQEs arrive more often than
+ * sq_thread_idle, spinning for a few gaps is enough to catch the next one.
+ * sq_thread_idle is what the application asked for, so it always bounds
+ * the period, and is used as is when SQEs arrive less often than that.
+ */
+static void io_sqd_note_arrival(struct io_sq_data *sqd)
+{
+	u64 now = ktime_get_ns();
+
+	if (sqd->last_arrival_ns) {
+		u64 gap = now - sqd->last_arrival_ns;
+
+		if (sqd->arrival_gap_ns)
+			sqd->arrival_gap_ns = (7 * sqd->arrival_gap_ns + gap) / 8;
+		else
+			sqd->arrival_gap_ns = gap;
+	}
+	sqd->last_arrival_ns = now;
+}
+
+static unsigned long io_sqd_idle_period(struct io_sq_data *sqd)
+{
+	unsigned long idle;
+
+	if (!sqd->arrival_gap_ns)
+		return sqd->sq_thread_idle;
+
+	idle = nsecs_to_jiffies(sqd->arrival_gap_ns * IORING_SQPOLL_IDLE_GAPS);
+	return clamp_t(unsigned long, idle, 1, sqd->sq_thread_idle);
+}
+
 static bool io_sqd_handle_event(struct io_sq_data *sqd)
 {
 	bool did_sig = false;
@@ -237,27 +320,34 @@ static int io_sq_thread(void *data)
 
 	mutex_lock(&sqd->lock);
 	while (1) {
-		bool cap_entries, sqt_spin = false;
+		bool cap_entries, sqt_spin = false, submitted = false;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + io_sqd_idle_period(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 			int ret = __io_sq_thread(ctx, cap_entries);
 
+			if (ret > 0)
+				submitted = true;
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		/* don't let the same ring always go first */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
+		if (submitted)
+			io_sqd_note_arrival(sqd);
 		if (io_run_task_work())
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+				timeout = jiffies + io_sqd_idle_period(sqd);
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -302,7 +392,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + io_sqd_idle_period(sqd);
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -12,6 +12,9 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* SQ arrival tracking for the adaptive idle period */
+	u64			last_arrival_ns;
+	u64			arrival_gap_ns;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
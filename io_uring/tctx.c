@@ -111,6 +111,8 @@ int __io_uring_add_tctx_node(struct io_ring_ctx *ctx)
 			if (ret)
 				return ret;
 		}
+		if (ctx->iowq_steal)
+			io_wq_set_steal(tctx->io_wq, true);
 	}
 	if (!xa_load(&tctx->xa, (unsigned long)ctx)) {
 		node = kmalloc(sizeof(*node), GFP_KERNEL);
@@ -5403,7 +5403,7 @@ static void css_release_work_fn(struct work_struct *work)
 	if (ss) {
 		/* css release path */
 		if (!list_empty(&css->rstat_css_node)) {
-			cgroup_rstat_flush(cgrp);
+			cgroup_rstat_css_flush(css);
 			list_del_rcu(&css->rstat_css_node);
 		}
 
@@ -39,6 +39,7 @@
 #include <linux/mm.h>
 #include <linux/memory.h>
 #include <linux/export.h>
+#include <linux/moduleparam.h>
 #include <linux/mount.h>
 #include <linux/fs_context.h>
 #include <linux/namei.h>
@@ -1151,6 +1152,60 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
 	mutex_unlock(&sched_domains_mutex);
 }
 
+/*
+ * Copy of the last domains handed to the scheduler by cpuset updates, so
+ * that the changes which don't affect them (most task placement churn)
+ * don't tear down and rebuild the root domains and their deadline
+ * accounting.  cur_ndoms < 0 means the copy is not valid.
+ */
+static cpumask_var_t *cur_doms;
+static struct sched_domain_attr *cur_dattr;
+static int cur_ndoms = -1;
+
+static bool sched_domains_unchanged(int ndoms, cpumask_var_t *doms,
+				    struct sched_domain_attr *dattr)
+{
+	int i;
+
+	if (ndoms != cur_ndoms || !doms != !cur_doms || !dattr != !cur_dattr)
+		return false;
+
+	for (i = 0; doms && i < ndoms; i++)
+		if (!cpumask_equal(doms[i], cur_doms[i]))
+			return false;
+
+	return !dattr || !memcmp(dattr, cur_dattr, ndoms * sizeof(*dattr));
+}
+
+static void save_sched_domains(int ndoms, cpumask_var_t *doms,
+			       struct sched_domain_attr *dattr)
+{
+	int i;
+
+	if (cur_doms)
+		free_sched_domains(cur_doms, cur_ndoms);
+	kfree(cur_dattr);
+	cur_doms = NULL;
+	cur_dattr = NULL;
+	cur_ndoms = -1;
+
+	if (doms) {
+		cur_doms = alloc_sched_domains(ndoms);
+		if (!cur_doms)
+			return;
+		for (i = 0; i < ndoms; i++)
+			cpumask_copy(cur_doms[i], doms[i]);
+	}
+
+	if (dattr) {
+		cur_dattr = kmemdup(dattr, ndoms * sizeof(*dattr), GFP_KERNEL);
+		if (!cur_dattr)
+			return;
+	}
+
+	cur_ndoms = ndoms;
+}
+
 /*
  * Rebuild scheduler domains.
  *
@@ -1160,9 +1215,13 @@ partition_and_rebuild_sched_domains(int ndoms_new, cpumask_var_t doms_new[],
  * 'cpus' is removed, then call this routine to rebuild the
  * scheduler's dynamic sched domains.
  *
+ * Unless @force is set, nothing is done if the domains end up the same as
+ * the ones cpuset last handed to the scheduler.  Callers outside of cpuset
+ * (hotplug, energy model and topology updates) need the rebuild regardless.
+ *
  * Call with cpuset_mutex held.  Takes cpus_read_lock().
  */
-static void rebuild_sched_domains_locked(void)
+static void __rebuild_sched_domains_locked(bool force)
 {
 	struct cgroup_subsys_state *pos_css;
 	struct sched_domain_attr *attr;
@@ -1210,10 +1269,57 @@ static void rebuild_sched_domains_locked(void)
 	/* Generate domain masks and attrs */
 	ndoms = generate_sched_domains(&doms, &attr);
 
+	if (!force && sched_domains_unchanged(ndoms, doms, attr)) {
+		if (doms)
+			free_sched_domains(doms, ndoms);
+		kfree(attr);
+		return;
+	}
+	save_sched_domains(ndoms, doms, attr);
+
 	/* Have scheduler rebuild the domains */
 	partition_and_rebuild_sched_domains(ndoms, doms, attr);
 }
+
+/*
+ * With a non-zero delay, the rebuilds triggered by cpuset updates are
+ * deferred by that many milliseconds, so that a burst of updates (e.g.
+ * container churn) results in a single rebuild.
+ */
+static unsigned int rebuild_delay_ms;
+module_param(rebuild_delay_ms, uint, 0644);
+MODULE_PARM_DESC(rebuild_delay_ms,
+		 "Coalesce sched domain rebuilds over this many milliseconds");
+
+static void rebuild_sched_domains_workfn(struct work_struct *work)
+{
+	cpus_read_lock();
+	mutex_lock(&cpuset_mutex);
+	__rebuild_sched_domains_locked(false);
+	mutex_unlock(&cpuset_mutex);
+	cpus_read_unlock();
+}
+
+static DECLARE_DELAYED_WORK(rebuild_sched_domains_work,
+			    rebuild_sched_domains_workfn);
+
+static void rebuild_sched_domains_locked(void)
+{
+	unsigned int delay = READ_ONCE(rebuild_delay_ms);
+
+	if (delay) {
+		queue_delayed_work(system_unbound_wq, &rebuild_sched_domains_work,
+				   msecs_to_jiffies(delay));
+		return;
+	}
+
+	__rebuild_sched_domains_locked(false);
+}
 #else /* !CONFIG_SMP */
+static void __rebuild_sched_domains_locked(bool force)
+{
+}
+
 static void rebuild_sched_domains_locked(void)
 {
 }
@@ -1223,7 +1329,7 @@ void rebuild_sched_domains(void)
 {
 	cpus_read_lock();
 	mutex_lock(&cpuset_mutex);
-	rebuild_sched_domains_locked();
+	__rebuild_sched_domains_locked(true);
 	mutex_unlock(&cpuset_mutex);
 	cpus_read_unlock();
 }
@@ -33,11 +33,19 @@
 #include <linux/atomic.h>
 #include <linux/cgroup.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
 #include <linux/sched/task.h>
 
 #define PIDS_MAX (PID_MAX_LIMIT + 1ULL)
 #define PIDS_MAX_STR "max"
 
+/*
+ * Number of pids a CPU pre-charges up the hierarchy when its stock runs dry,
+ * and the most it is allowed to hold before handing them back.
+ */
+#define PIDS_CHARGE_BATCH	8
+#define PIDS_STOCK_MAX		(2 * PIDS_CHARGE_BATCH)
+
 struct pids_cgroup {
 	struct cgroup_subsys_state	css;
 
@@ -54,6 +62,16 @@ struct pids_cgroup {
 
 	/* Number of times fork failed because limit was hit. */
 	atomic64_t			events_limit;
+
+	/*
+	 * Pids already charged to this cgroup and its ancestors but not yet
+	 * handed out to a task, like the memcg stock.  Each CPU forks and
+	 * releases against its own stock so that short-lived tasks don't
+	 * bounce the shared counters.  These are atomics rather than plain
+	 * per-cpu counters so that a CPU hitting the limit can steal back
+	 * what others hold.
+	 */
+	atomic_t __percpu		*stock;
 };
 
 static struct pids_cgroup *css_pids(struct cgroup_subsys_state *css)
@@ -75,15 +93,33 @@ pids_css_alloc(struct cgroup_subsys_state *parent)
 	if (!pids)
 		return ERR_PTR(-ENOMEM);
 
+	pids->stock = alloc_percpu(atomic_t);
+	if (!pids->stock) {
+		kfree(pids);
+		return ERR_PTR(-ENOMEM);
+	}
+
 	atomic64_set(&pids->counter, 0);
 	atomic64_set(&pids->limit, PIDS_MAX);
 	atomic64_set(&pids->events_limit, 0);
 	return &pids->css;
 }
 
+static void pids_drain_stock(struct pids_cgroup *pids);
+
+static void pids_css_offline(struct cgroup_subsys_state *css)
+{
+	pids_drain_stock(css_pids(css));
+}
+
 static void pids_css_free(struct cgroup_subsys_state *css)
 {
-	kfree(css_pids(css));
+	struct pids_cgroup *pids = css_pids(css);
+
+	/* Dying tasks may have released into the stock after offlining */
+	pids_drain_stock(pids);
+	free_percpu(pids->stock);
+	kfree(pids);
 }
 
 static void pids_update_watermark(struct pids_cgroup *p, int64_t nr_pids)
@@ -151,11 +187,14 @@ static void pids_charge(struct pids_cgroup *pids, int num)
  * @pids: the pid cgroup state
  * @num: the number of pids to charge
  *
+ * @fail: if not %NULL, set to the cgroup whose limit was hit
+ *
  * This function follows the set limit. It will fail if the charge would cause
  * the new value to exceed the hierarchical limit. Returns 0 if the charge
  * succeeded, otherwise -EAGAIN.
  */
-static int pids_try_charge(struct pids_cgroup *pids, int num)
+static int pids_try_charge(struct pids_cgroup *pids, int num,
+			   struct pids_cgroup **fail)
 {
 	struct pids_cgroup *p, *q;
 
@@ -185,9 +224,113 @@ static int pids_try_charge(struct pids_cgroup *pids, int num)
 		pids_cancel(q, num);
 	pids_cancel(p, num);
 
+	if (fail)
+		*fail = p;
 	return -EAGAIN;
 }
 
+/**
+ * pids_drain_stock - give back the pids reserved in the per-cpu stocks
+ * @pids: the pid cgroup state
+ */
+static void pids_drain_stock(struct pids_cgroup *pids)
+{
+	int nr = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		nr += atomic_xchg(per_cpu_ptr(pids->stock, cpu), 0);
+	if (nr)
+		pids_uncharge(pids, nr);
+}
+
+/**
+ * pids_drain_stock_tree - drain the stocks charged against @pids' limit
+ * @pids: the pid cgroup state
+ *
+ * Every descendant's stock counts towards @pids->counter, so all of them
+ * have to be drained before a charge failing at @pids is final.
+ */
+static void pids_drain_stock_tree(struct pids_cgroup *pids)
+{
+	struct cgroup_subsys_state *css;
+
+	rcu_read_lock();
+	css_for_each_descendant_pre(css, &pids->css)
+		pids_drain_stock(css_pids(css));
+	rcu_read_unlock();
+}
+
+/**
+ * pids_try_charge_stock - charge the pid count through the per-cpu stock
+ * @pids: the pid cgroup state
+ * @num: the number of pids to charge
+ *
+ * Like pids_try_charge(), but takes the pids from the local stock when it
+ * has enough, and refills it with %PIDS_CHARGE_BATCH extra pids while the
+ * hierarchy is well below its limits.  Near a limit the charge is made
+ * exactly, and only fails once the reservations held in stocks underneath
+ * the limiting cgroup have been given back.
+ */
+static int pids_try_charge_stock(struct pids_cgroup *pids, int num)
+{
+	struct pids_cgroup *fail;
+	atomic_t *stock;
+	int old;
+
+	/* Nothing is accounted at the root */
+	if (!parent_pids(pids))
+		return 0;
+
+	/*
+	 * Migrating after picking the stock is harmless: any CPU's stock
+	 * holds pids charged to the same hierarchy.
+	 */
+	stock = raw_cpu_ptr(pids->stock);
+	old = atomic_read(stock);
+	while (old >= num) {
+		if (atomic_try_cmpxchg(stock, &old, old - num))
+			return 0;
+	}
+
+	if (!pids_try_charge(pids, num + PIDS_CHARGE_BATCH, NULL)) {
+		atomic_add(PIDS_CHARGE_BATCH, stock);
+		return 0;
+	}
+
+	if (!pids_try_charge(pids, num, &fail))
+		return 0;
+
+	pids_drain_stock_tree(fail);
+	return pids_try_charge(pids, num, NULL);
+}
+
+/**
+ * pids_uncharge_stock - return pids to the per-cpu stock
+ * @pids: the pid cgroup state
+ * @num: the number of pids to uncharge
+ *
+ * The pids stay charged up the hierarchy until the stock grows past
+ * %PIDS_STOCK_MAX or is drained.
+ */
+static void pids_uncharge_stock(struct pids_cgroup *pids, int num)
+{
+	atomic_t *stock;
+
+	if (!parent_pids(pids))
+		return;
+
+	/* Don't leave anything behind in a cgroup nobody can fork into */
+	if (!(pids->css.flags & CSS_ONLINE)) {
+		pids_uncharge(pids, num);
+		return;
+	}
+
+	stock = raw_cpu_ptr(pids->stock);
+	if (atomic_add_return(num, stock) > PIDS_STOCK_MAX)
+		pids_uncharge(pids, atomic_xchg(stock, 0));
+}
+
 static int pids_can_attach(struct cgroup_taskset *tset)
 {
 	struct task_struct *task;
@@ -246,7 +389,7 @@ static int pids_can_fork(struct task_struct *task, struct css_set *cset)
 	else
 		css = task_css_check(current, pids_cgrp_id, true);
 	pids = css_pids(css);
-	err = pids_try_charge(pids, 1);
+	err = pids_try_charge_stock(pids, 1);
 	if (err) {
 		/* Only log the first time events_limit is incremented. */
 		if (atomic64_inc_return(&pids->events_limit) == 1) {
@@ -269,14 +412,14 @@ static void pids_cancel_fork(struct task_struct *task, struct css_set *cset)
 	else
 		css = task_css_check(current, pids_cgrp_id, true);
 	pids = css_pids(css);
-	pids_uncharge(pids, 1);
+	pids_uncharge_stock(pids, 1);
 }
 
 static void pids_release(struct task_struct *task)
 {
 	struct pids_cgroup *pids = css_pids(task_css(task, pids_cgrp_id));
 
-	pids_uncharge(pids, 1);
+	pids_uncharge_stock(pids, 1);
 }
 
 static ssize_t pids_max_write(struct kernfs_open_file *of, char *buf,
@@ -306,6 +449,9 @@ static ssize_t pids_max_write(struct kernfs_open_file *of, char *buf,
 	 * critical that any racing fork()s follow the new limit.
 	 */
 	atomic64_set(&pids->limit, limit);
+
+	/* Don't let reservations taken under the old limit linger */
+	pids_drain_stock_tree(pids);
 	return nbytes;
 }
 
@@ -327,8 +473,21 @@ static s64 pids_current_read(struct cgroup_subsys_state *css,
 			     struct cftype *cft)
 {
 	struct pids_cgroup *pids = css_pids(css);
+	struct cgroup_subsys_state *pos;
+	int64_t nr = atomic64_read(&pids->counter);
+	int cpu;
+
+	/* Reserved pids sitting in stocks aren't in use */
+	rcu_read_lock();
+	css_for_each_descendant_pre(pos, css) {
+		struct pids_cgroup *p = css_pids(pos);
+
+		for_each_possible_cpu(cpu)
+			nr -= atomic_read(per_cpu_ptr(p->stock, cpu));
+	}
+	rcu_read_unlock();
 
-	return atomic64_read(&pids->counter);
+	return max_t(int64_t, nr, 0);
 }
 
 static s64 pids_peak_read(struct cgroup_subsys_state *css,
@@ -375,6 +534,7 @@ static struct cftype pids_files[] = {
 
 struct cgroup_subsys pids_cgrp_subsys = {
 	.css_alloc	= pids_css_alloc,
+	.css_offline	= pids_css_offline,
 	.css_free	= pids_css_free,
 	.can_attach 	= pids_can_attach,
 	.cancel_attach 	= pids_cancel_attach,
@@ -2,14 +2,33 @@
 #include "cgroup-internal.h"
 
 #include <linux/sched/cputime.h>
+#include <linux/moduleparam.h>
 
 #include <linux/bpf.h>
 #include <linux/btf.h>
 #include <linux/btf_ids.h>
 
-static DEFINE_SPINLOCK(cgroup_rstat_lock);
+/*
+ * Every updated tree has its own flush lock, so that readers of one
+ * controller's stats neither serialize against nor pay for the flushing of
+ * another's.
+ */
+static spinlock_t cgroup_rstat_lock[CGROUP_RSTAT_NR_TREES] = {
+	[0 ... CGROUP_RSTAT_NR_TREES - 1] =
+		__SPIN_LOCK_UNLOCKED(cgroup_rstat_lock),
+};
 static DEFINE_PER_CPU(raw_spinlock_t, cgroup_rstat_cpu_lock);
 
+/* number of updated trees handed out by cgroup_rstat_boot() */
+static int cgroup_rstat_nr_trees __read_mostly = 1;
+
+/*
+ * Readers going through the bounded flush helpers accept stats which were
+ * flushed at most this long ago.  0 makes every read flush.
+ */
+static unsigned int cgroup_rstat_max_age_ms __read_mostly;
+core_param(cgroup_rstat_max_age_ms, cgroup_rstat_max_age_ms, uint, 0644);
+
 static void cgroup_base_stat_flush(struct cgroup *cgrp, int cpu);
 
 static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
@@ -17,16 +36,12 @@ static struct cgroup_rstat_cpu *cgroup_rstat_cpu(struct cgroup *cgrp, int cpu)
 	return per_cpu_ptr(cgrp->rstat_cpu, cpu);
 }
 
-/**
- * cgroup_rstat_updated - keep track of updated rstat_cpu
- * @cgrp: target cgroup
- * @cpu: cpu on which rstat_cpu was updated
- *
- * @cgrp's rstat_cpu on @cpu was updated.  Put it on the parent's matching
- * rstat_cpu->updated_children list.  See the comment on top of
- * cgroup_rstat_cpu definition for details.
- */
-void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
+static int cgroup_rstat_css_tree(struct cgroup_subsys_state *css)
+{
+	return css->ss ? css->ss->rstat_tree : CGROUP_RSTAT_BASE;
+}
+
+static void __cgroup_rstat_updated(struct cgroup *cgrp, int cpu, int tree)
 {
 	raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu);
 	unsigned long flags;
@@ -39,7 +54,7 @@ void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 	 * instead of NULL, we can tell whether @cgrp is on the list by
 	 * testing the next pointer for NULL.
 	 */
-	if (data_race(cgroup_rstat_cpu(cgrp, cpu)->updated_next))
+	if (data_race(cgroup_rstat_cpu(cgrp, cpu)->tree[tree].updated_next))
 		return;
 
 	raw_spin_lock_irqsave(cpu_lock, flags);
@@ -54,18 +69,19 @@ void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 		 * Both additions and removals are bottom-up.  If a cgroup
 		 * is already in the tree, all ancestors are.
 		 */
-		if (rstatc->updated_next)
+		if (rstatc->tree[tree].updated_next)
 			break;
 
 		/* Root has no parent to link it to, but mark it busy */
 		if (!parent) {
-			rstatc->updated_next = cgrp;
+			rstatc->tree[tree].updated_next = cgrp;
 			break;
 		}
 
 		prstatc = cgroup_rstat_cpu(parent, cpu);
-		rstatc->updated_next = prstatc->updated_children;
-		prstatc->updated_children = cgrp;
+		rstatc->tree[tree].updated_next =
+			prstatc->tree[tree].updated_children;
+		prstatc->tree[tree].updated_children = cgrp;
 
 		cgrp = parent;
 	}
@@ -73,11 +89,46 @@ void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
 	raw_spin_unlock_irqrestore(cpu_lock, flags);
 }
 
+/**
+ * cgroup_rstat_updated - keep track of updated rstat_cpu
+ * @cgrp: target cgroup
+ * @cpu: cpu on which rstat_cpu was updated
+ *
+ * @cgrp's rstat_cpu on @cpu was updated.  Put it on the parent's matching
+ * rstat_cpu->updated_children list of every updated tree.  See the comment
+ * on top of cgroup_rstat_cpu definition for details.
+ *
+ * Controllers should prefer cgroup_rstat_css_updated(), which only queues
+ * their own tree.
+ */
+void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
+{
+	int tree;
+
+	for (tree = 0; tree < cgroup_rstat_nr_trees; tree++)
+		__cgroup_rstat_updated(cgrp, cpu, tree);
+}
+
+/**
+ * cgroup_rstat_css_updated - keep track of updated rstat_cpu for a controller
+ * @css: target css
+ * @cpu: cpu on which the stats of @css were updated
+ *
+ * Like cgroup_rstat_updated() but only queues @css->cgroup on the updated
+ * tree of @css's controller, so that only its ->css_rstat_flush() runs on
+ * the next flush of that tree.
+ */
+void cgroup_rstat_css_updated(struct cgroup_subsys_state *css, int cpu)
+{
+	__cgroup_rstat_updated(css->cgroup, cpu, cgroup_rstat_css_tree(css));
+}
+
 /**
  * cgroup_rstat_cpu_pop_updated - iterate and dismantle rstat_cpu updated tree
  * @pos: current position
  * @root: root of the tree to traversal
  * @cpu: target cpu
+ * @tree: updated tree to walk
  *
  * Walks the updated rstat_cpu tree on @cpu from @root.  %NULL @pos starts
  * the traversal and %NULL return indicates the end.  During traversal,
@@ -89,7 +140,8 @@ void cgroup_rstat_updated(struct cgroup *cgrp, int cpu)
  * guaranteed to be visited afterwards.
  */
 static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
-						   struct cgroup *root, int cpu)
+						   struct cgroup *root, int cpu,
+						   int tree)
 {
 	struct cgroup_rstat_cpu *rstatc;
 	struct cgroup *parent;
@@ -104,7 +156,7 @@ static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
 	if (!pos) {
 		pos = root;
 		/* return NULL if this subtree is not on-list */
-		if (!cgroup_rstat_cpu(pos, cpu)->updated_next)
+		if (!cgroup_rstat_cpu(pos, cpu)->tree[tree].updated_next)
 			return NULL;
 	} else {
 		pos = cgroup_parent(pos);
@@ -113,9 +165,9 @@ static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
 	/* walk down to the first leaf */
 	while (true) {
 		rstatc = cgroup_rstat_cpu(pos, cpu);
-		if (rstatc->updated_children == pos)
+		if (rstatc->tree[tree].updated_children == pos)
 			break;
-		pos = rstatc->updated_children;
+		pos = rstatc->tree[tree].updated_children;
 	}
 
 	/*
@@ -130,18 +182,18 @@ static struct cgroup *cgroup_rstat_cpu_pop_updated(struct cgroup *pos,
 		struct cgroup **nextp;
 
 		prstatc = cgroup_rstat_cpu(parent, cpu);
-		nextp = &prstatc->updated_children;
+		nextp = &prstatc->tree[tree].updated_children;
 		while (*nextp != pos) {
 			struct cgroup_rstat_cpu *nrstatc;
 
 			nrstatc = cgroup_rstat_cpu(*nextp, cpu);
 			WARN_ON_ONCE(*nextp == parent);
-			nextp = &nrstatc->updated_next;
+			nextp = &nrstatc->tree[tree].updated_next;
 		}
-		*nextp = rstatc->updated_next;
+		*nextp = rstatc->tree[tree].updated_next;
 	}
 
-	rstatc->updated_next = NULL;
+	rstatc->tree[tree].updated_next = NULL;
 	return pos;
 }
 
@@ -171,12 +223,13 @@ __weak noinline void bpf_rstat_flush(struct cgroup *cgrp,
 __diag_pop();
 
 /* see cgroup_rstat_flush() */
-static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
-	__releases(&cgroup_rstat_lock) __acquires(&cgroup_rstat_lock)
+static void cgroup_rstat_flush_locked(struct cgroup *cgrp, int tree,
+				      bool may_sleep)
+	__releases(&cgroup_rstat_lock[tree]) __acquires(&cgroup_rstat_lock[tree])
 {
 	int cpu;
 
-	lockdep_assert_held(&cgroup_rstat_lock);
+	lockdep_assert_held(&cgroup_rstat_lock[tree]);
 
 	for_each_possible_cpu(cpu) {
 		raw_spinlock_t *cpu_lock = per_cpu_ptr(&cgroup_rstat_cpu_lock,
@@ -193,29 +246,54 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
 		 * that interrupts are always disabled and later restored.
 		 */
 		raw_spin_lock_irqsave(cpu_lock, flags);
-		while ((pos = cgroup_rstat_cpu_pop_updated(pos, cgrp, cpu))) {
+		while ((pos = cgroup_rstat_cpu_pop_updated(pos, cgrp, cpu,
+							   tree))) {
 			struct cgroup_subsys_state *css;
 
-			cgroup_base_stat_flush(pos, cpu);
-			bpf_rstat_flush(pos, cgroup_parent(pos), cpu);
+			if (tree == CGROUP_RSTAT_BASE) {
+				cgroup_base_stat_flush(pos, cpu);
+				bpf_rstat_flush(pos, cgroup_parent(pos), cpu);
+			}
 
 			rcu_read_lock();
 			list_for_each_entry_rcu(css, &pos->rstat_css_list,
 						rstat_css_node)
-				css->ss->css_rstat_flush(css, cpu);
+				if (css->ss->rstat_tree == tree)
+					css->ss->css_rstat_flush(css, cpu);
 			rcu_read_unlock();
 		}
 		raw_spin_unlock_irqrestore(cpu_lock, flags);
 
 		/* if @may_sleep, play nice and yield if necessary */
 		if (may_sleep && (need_resched() ||
-				  spin_needbreak(&cgroup_rstat_lock))) {
-			spin_unlock_irq(&cgroup_rstat_lock);
+				  spin_needbreak(&cgroup_rstat_lock[tree]))) {
+			spin_unlock_irq(&cgroup_rstat_lock[tree]);
 			if (!cond_resched())
 				cpu_relax();
-			spin_lock_irq(&cgroup_rstat_lock);
+			spin_lock_irq(&cgroup_rstat_lock[tree]);
 		}
 	}
+
+	WRITE_ONCE(cgrp->rstat_flushed[tree], get_jiffies_64());
+}
+
+/* whether @tree of @cgrp's subtree was flushed within cgroup_rstat_max_age_ms */
+static bool cgroup_rstat_fresh(struct cgroup *cgrp, int tree)
+{
+	unsigned int max_age = READ_ONCE(cgroup_rstat_max_age_ms);
+
+	if (!max_age)
+		return false;
+
+	return get_jiffies_64() - READ_ONCE(cgrp->rstat_flushed[tree]) <
+		msecs_to_jiffies(max_age);
+}
+
+static void __cgroup_rstat_flush(struct cgroup *cgrp, int tree)
+{
+	spin_lock_irq(&cgroup_rstat_lock[tree]);
+	cgroup_rstat_flush_locked(cgrp, tree, true);
+	spin_unlock_irq(&cgroup_rstat_lock[tree]);
 }
 
 /**
@@ -226,6 +304,9 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
  * and propagate them upwards.  After this function returns, all cgroups in
  * the subtree have up-to-date ->stat.
  *
+ * This flushes the updated trees of all controllers.  Readers which only
+ * care about one controller should use cgroup_rstat_css_flush().
+ *
  * This also gets all cgroups in the subtree including @cgrp off the
  * ->updated_children lists.
  *
@@ -233,11 +314,12 @@ static void cgroup_rstat_flush_locked(struct cgroup *cgrp, bool may_sleep)
  */
 void cgroup_rstat_flush(struct cgroup *cgrp)
 {
+	int tree;
+
 	might_sleep();
 
-	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
-	spin_unlock_irq(&cgroup_rstat_lock);
+	for (tree = 0; tree < cgroup_rstat_nr_trees; tree++)
+		__cgroup_rstat_flush(cgrp, tree);
 }
 
 /**
@@ -249,41 +331,81 @@ void cgroup_rstat_flush(struct cgroup *cgrp)
 void cgroup_rstat_flush_irqsafe(struct cgroup *cgrp)
 {
 	unsigned long flags;
+	int tree;
+
+	for (tree = 0; tree < cgroup_rstat_nr_trees; tree++) {
+		spin_lock_irqsave(&cgroup_rstat_lock[tree], flags);
+		cgroup_rstat_flush_locked(cgrp, tree, false);
+		spin_unlock_irqrestore(&cgroup_rstat_lock[tree], flags);
+	}
+}
+
+/**
+ * cgroup_rstat_css_flush - flush the stats of one controller
+ * @css: target css
+ *
+ * Flush the updated tree of @css's controller in @css->cgroup's subtree,
+ * leaving the pending updates of other controllers alone.  @css may be
+ * &cgrp->self to flush the base stats.
+ *
+ * This function may block.
+ */
+void cgroup_rstat_css_flush(struct cgroup_subsys_state *css)
+{
+	might_sleep();
+	__cgroup_rstat_flush(css->cgroup, cgroup_rstat_css_tree(css));
+}
+
+/**
+ * cgroup_rstat_css_flush_bounded - flush the stats of one controller unless fresh
+ * @css: target css
+ *
+ * Like cgroup_rstat_css_flush() but skip the flush if @css->cgroup's subtree
+ * was flushed within the last cgroup_rstat_max_age_ms, for readers which are
+ * fine with stats that stale in exchange for not contending on the flush.
+ *
+ * This function may block.
+ */
+void cgroup_rstat_css_flush_bounded(struct cgroup_subsys_state *css)
+{
+	int tree = cgroup_rstat_css_tree(css);
 
-	spin_lock_irqsave(&cgroup_rstat_lock, flags);
-	cgroup_rstat_flush_locked(cgrp, false);
-	spin_unlock_irqrestore(&cgroup_rstat_lock, flags);
+	might_sleep();
+	if (!cgroup_rstat_fresh(css->cgroup, tree))
+		__cgroup_rstat_flush(css->cgroup, tree);
 }
 
 /**
- * cgroup_rstat_flush_hold - flush stats in @cgrp's subtree and hold
+ * cgroup_rstat_flush_hold - flush base stats in @cgrp's subtree and hold
  * @cgrp: target cgroup
  *
- * Flush stats in @cgrp's subtree and prevent further flushes.  Must be
+ * Flush the base stats in @cgrp's subtree, unless they are younger than
+ * cgroup_rstat_max_age_ms, and prevent further flushes of them.  Must be
  * paired with cgroup_rstat_flush_release().
  *
  * This function may block.
  */
 void cgroup_rstat_flush_hold(struct cgroup *cgrp)
-	__acquires(&cgroup_rstat_lock)
+	__acquires(&cgroup_rstat_lock[CGROUP_RSTAT_BASE])
 {
 	might_sleep();
-	spin_lock_irq(&cgroup_rstat_lock);
-	cgroup_rstat_flush_locked(cgrp, true);
+	spin_lock_irq(&cgroup_rstat_lock[CGROUP_RSTAT_BASE]);
+	if (!cgroup_rstat_fresh(cgrp, CGROUP_RSTAT_BASE))
+		cgroup_rstat_flush_locked(cgrp, CGROUP_RSTAT_BASE, true);
 }
 
 /**
  * cgroup_rstat_flush_release - release cgroup_rstat_flush_hold()
  */
 void cgroup_rstat_flush_release(void)
-	__releases(&cgroup_rstat_lock)
+	__releases(&cgroup_rstat_lock[CGROUP_RSTAT_BASE])
 {
-	spin_unlock_irq(&cgroup_rstat_lock);
+	spin_unlock_irq(&cgroup_rstat_lock[CGROUP_RSTAT_BASE]);
 }
 
 int cgroup_rstat_init(struct cgroup *cgrp)
 {
-	int cpu;
+	int cpu, tree;
 
 	/* the root cgrp has rstat_cpu preallocated */
 	if (!cgrp->rstat_cpu) {
@@ -296,7 +418,8 @@ int cgroup_rstat_init(struct cgroup *cgrp)
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
 
-		rstatc->updated_children = cgrp;
+		for (tree = 0; tree < CGROUP_RSTAT_NR_TREES; tree++)
+			rstatc->tree[tree].updated_children = cgrp;
 		u64_stats_init(&rstatc->bsync);
 	}
 
@@ -305,7 +428,7 @@ int cgroup_rstat_init(struct cgroup *cgrp)
 
 void cgroup_rstat_exit(struct cgroup *cgrp)
 {
-	int cpu;
+	int cpu, tree;
 
 	cgroup_rstat_flush(cgrp);
 
@@ -313,9 +436,11 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 	for_each_possible_cpu(cpu) {
 		struct cgroup_rstat_cpu *rstatc = cgroup_rstat_cpu(cgrp, cpu);
 
-		if (WARN_ON_ONCE(rstatc->updated_children != cgrp) ||
-		    WARN_ON_ONCE(rstatc->updated_next))
-			return;
+		for (tree = 0; tree < CGROUP_RSTAT_NR_TREES; tree++) {
+			if (WARN_ON_ONCE(rstatc->tree[tree].updated_children != cgrp) ||
+			    WARN_ON_ONCE(rstatc->tree[tree].updated_next))
+				return;
+		}
 	}
 
 	free_percpu(cgrp->rstat_cpu);
@@ -324,10 +449,22 @@ void cgroup_rstat_exit(struct cgroup *cgrp)
 
 void __init cgroup_rstat_boot(void)
 {
-	int cpu;
+	struct cgroup_subsys *ss;
+	int cpu, ssid;
 
 	for_each_possible_cpu(cpu)
 		raw_spin_lock_init(per_cpu_ptr(&cgroup_rstat_cpu_lock, cpu));
+
+	/*
+	 * Give each controller with stats to flush its own updated tree.
+	 * Those which don't fit share the base tree.
+	 */
+	for_each_subsys(ss, ssid) {
+		ss->rstat_tree = CGROUP_RSTAT_BASE;
+		if (ss->css_rstat_flush &&
+		    cgroup_rstat_nr_trees < CGROUP_RSTAT_NR_TREES)
+			ss->rstat_tree = cgroup_rstat_nr_trees++;
+	}
 }
 
 /*
@@ -402,7 +539,7 @@ static void cgroup_base_stat_cputime_account_end(struct cgroup *cgrp,
 						 unsigned long flags)
 {
 	u64_stats_update_end_irqrestore(&rstatc->bsync, flags);
-	cgroup_rstat_updated(cgrp, smp_processor_id());
+	__cgroup_rstat_updated(cgrp, smp_processor_id(), CGROUP_RSTAT_BASE);
 	put_cpu_ptr(rstatc);
 }
 
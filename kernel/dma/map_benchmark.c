@@ -16,6 +16,8 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/prandom.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
@@ -31,23 +33,94 @@ struct map_benchmark_data {
 	atomic64_t loops;
 };
 
+/*
+ * Per-thread state. The histograms are kept per thread so that recording
+ * a sample doesn't add cacheline contention to the path being measured.
+ */
+struct map_benchmark_thread {
+	struct map_benchmark_data *map;
+	int node;
+	u32 map_hist[DMA_MAP_HIST_BUCKETS];
+	u32 unmap_hist[DMA_MAP_HIST_BUCKETS];
+};
+
+static int map_benchmark_map(struct map_benchmark_data *map, void *buf,
+		struct scatterlist *sgl, int npages, dma_addr_t *dma_addr)
+{
+	size_t size = npages * PAGE_SIZE;
+	int i;
+
+	switch (map->bparam.mode) {
+	case DMA_MAP_PAGE_MODE:
+		*dma_addr = dma_map_page(map->dev, virt_to_page(buf), 0, size,
+					 map->dir);
+		break;
+	case DMA_MAP_SG_MODE:
+		sg_init_table(sgl, npages);
+		for (i = 0; i < npages; i++)
+			sg_set_buf(&sgl[i], buf + i * PAGE_SIZE, PAGE_SIZE);
+		return dma_map_sg(map->dev, sgl, npages, map->dir) ? 0 : -ENOMEM;
+	default:
+		*dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+		break;
+	}
+
+	return dma_mapping_error(map->dev, *dma_addr) ? -ENOMEM : 0;
+}
+
+static void map_benchmark_unmap(struct map_benchmark_data *map,
+		struct scatterlist *sgl, int npages, dma_addr_t dma_addr)
+{
+	size_t size = npages * PAGE_SIZE;
+
+	switch (map->bparam.mode) {
+	case DMA_MAP_PAGE_MODE:
+		dma_unmap_page(map->dev, dma_addr, size, map->dir);
+		break;
+	case DMA_MAP_SG_MODE:
+		dma_unmap_sg(map->dev, sgl, npages, map->dir);
+		break;
+	default:
+		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		break;
+	}
+}
+
 static int map_benchmark_thread(void *data)
 {
 	void *buf;
-	dma_addr_t dma_addr;
-	struct map_benchmark_data *map = data;
-	int npages = map->bparam.granule;
-	u64 size = npages * PAGE_SIZE;
+	dma_addr_t dma_addr = DMA_MAPPING_ERROR;
+	struct map_benchmark_thread *t = data;
+	struct map_benchmark_data *map = t->map;
+	int min_npages = map->bparam.granule;
+	int max_npages = max(map->bparam.granule, map->bparam.granule_max);
+	u64 max_size = max_npages * PAGE_SIZE;
+	struct scatterlist *sgl = NULL;
 	int ret = 0;
 
-	buf = alloc_pages_exact(size, GFP_KERNEL);
+	buf = alloc_pages_exact(max_size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
+	if (map->bparam.mode == DMA_MAP_SG_MODE) {
+		sgl = kmalloc_array_node(max_npages, sizeof(*sgl), GFP_KERNEL,
+					 t->node);
+		if (!sgl) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
 		ktime_t map_delta, unmap_delta;
+		int npages = min_npages;
+		u64 size;
+
+		if (max_npages > min_npages)
+			npages += prandom_u32_max(max_npages - min_npages + 1);
+		size = npages * PAGE_SIZE;
 
 		/*
 		 * for a non-coherent device, if we don't stain them in the
@@ -59,11 +132,9 @@ static int map_benchmark_thread(void *data)
 			memset(buf, 0x66, size);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
+		ret = map_benchmark_map(map, buf, sgl, npages, &dma_addr);
+		if (unlikely(ret)) {
+			pr_err("dma map failed on %s\n", dev_name(map->dev));
 			goto out;
 		}
 		map_etime = ktime_get();
@@ -73,7 +144,7 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		map_benchmark_unmap(map, sgl, npages, dma_addr);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -89,18 +160,71 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
 		atomic64_inc(&map->loops);
+
+		t->map_hist[min_t(u64, map_100ns, DMA_MAP_HIST_BUCKETS - 1)]++;
+		t->unmap_hist[min_t(u64, unmap_100ns, DMA_MAP_HIST_BUCKETS - 1)]++;
 	}
 
 out:
-	free_pages_exact(buf, size);
+	kfree(sgl);
+	free_pages_exact(buf, max_size);
 	return ret;
 }
 
+/* smallest bucket holding at least @permille of the @total samples */
+static u64 map_benchmark_percentile(const u64 *hist, u64 total,
+		unsigned int permille)
+{
+	u64 want = div64_u64(total * permille + 999, 1000);
+	u64 seen = 0;
+	int i;
+
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS - 1; i++) {
+		seen += hist[i];
+		if (seen >= want)
+			break;
+	}
+
+	return i;
+}
+
+static void map_benchmark_percentiles(struct map_benchmark_data *map,
+		struct map_benchmark_thread *t, u64 loops)
+{
+	int threads = map->bparam.threads;
+	u64 *map_hist, *unmap_hist;
+	int i, j;
+
+	map_hist = kcalloc(2 * DMA_MAP_HIST_BUCKETS, sizeof(*map_hist),
+			   GFP_KERNEL);
+	if (!map_hist)
+		return;
+	unmap_hist = map_hist + DMA_MAP_HIST_BUCKETS;
+
+	for (i = 0; i < threads; i++) {
+		for (j = 0; j < DMA_MAP_HIST_BUCKETS; j++) {
+			map_hist[j] += t[i].map_hist[j];
+			unmap_hist[j] += t[i].unmap_hist[j];
+		}
+	}
+
+	map->bparam.map_p50_100ns = map_benchmark_percentile(map_hist, loops, 500);
+	map->bparam.map_p99_100ns = map_benchmark_percentile(map_hist, loops, 990);
+	map->bparam.map_p999_100ns = map_benchmark_percentile(map_hist, loops, 999);
+	map->bparam.unmap_p50_100ns = map_benchmark_percentile(unmap_hist, loops, 500);
+	map->bparam.unmap_p99_100ns = map_benchmark_percentile(unmap_hist, loops, 990);
+	map->bparam.unmap_p999_100ns = map_benchmark_percentile(unmap_hist, loops, 999);
+
+	kfree(map_hist);
+}
+
 static int do_map_benchmark(struct map_benchmark_data *map)
 {
+	struct map_benchmark_thread *t;
 	struct task_struct **tsk;
 	int threads = map->bparam.threads;
 	int node = map->bparam.node;
+	int created = 0;
 	u64 loops;
 	int ret = 0;
 	int i;
@@ -109,16 +233,31 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	if (!tsk)
 		return -ENOMEM;
 
+	t = kvcalloc(threads, sizeof(*t), GFP_KERNEL);
+	if (!t) {
+		kfree(tsk);
+		return -ENOMEM;
+	}
+
 	get_device(map->dev);
 
 	for (i = 0; i < threads; i++) {
-		tsk[i] = kthread_create_on_node(map_benchmark_thread, map,
-				map->bparam.node, "dma-map-benchmark/%d", i);
+		if (map->bparam.node == DMA_MAP_NODE_INTERLEAVE) {
+			node = i ? next_online_node(node) : first_online_node;
+			if (node == MAX_NUMNODES)
+				node = first_online_node;
+		}
+
+		t[i].map = map;
+		t[i].node = node;
+		tsk[i] = kthread_create_on_node(map_benchmark_thread, &t[i],
+				node, "dma-map-benchmark/%d", i);
 		if (IS_ERR(tsk[i])) {
 			pr_err("create dma_map thread failed\n");
 			ret = PTR_ERR(tsk[i]);
 			goto out;
 		}
+		created++;
 
 		if (node != NUMA_NO_NODE)
 			kthread_bind_mask(tsk[i], cpumask_of_node(node));
@@ -166,12 +305,15 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		map_benchmark_percentiles(map, t, loops);
 	}
 
 out:
-	for (i = 0; i < threads; i++)
+	for (i = 0; i < created; i++)
 		put_task_struct(tsk[i]);
 	put_device(map->dev);
+	kvfree(t);
 	kfree(tsk);
 	return ret;
 }
@@ -182,13 +324,35 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 	struct map_benchmark_data *map = file->private_data;
 	void __user *argp = (void __user *)arg;
 	u64 old_dma_mask;
+	size_t size;
 	int ret;
 
-	if (copy_from_user(&map->bparam, argp, sizeof(map->bparam)))
+	switch (cmd) {
+	case DMA_MAP_BENCHMARK:
+		size = DMA_MAP_BENCHMARK_V1_SIZE;
+		break;
+	case DMA_MAP_BENCHMARK_V2:
+		size = sizeof(map->bparam);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	memset(&map->bparam, 0, sizeof(map->bparam));
+	if (copy_from_user(&map->bparam, argp, size))
 		return -EFAULT;
 
 	switch (cmd) {
 	case DMA_MAP_BENCHMARK:
+		/* this was tail padding in the original struct */
+		map->bparam.granule_max = 0;
+		fallthrough;
+	case DMA_MAP_BENCHMARK_V2:
+		if (map->bparam.reserved) {
+			pr_err("reserved field must be zero\n");
+			return -EINVAL;
+		}
+
 		if (map->bparam.threads == 0 ||
 		    map->bparam.threads > DMA_MAP_MAX_THREADS) {
 			pr_err("invalid thread number\n");
@@ -207,6 +371,7 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 		}
 
 		if (map->bparam.node != NUMA_NO_NODE &&
+		    map->bparam.node != DMA_MAP_NODE_INTERLEAVE &&
 		    (map->bparam.node < 0 || map->bparam.node >= MAX_NUMNODES ||
 		     !node_possible(map->bparam.node))) {
 			pr_err("invalid numa node\n");
@@ -218,6 +383,23 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.granule_max &&
+		    (map->bparam.granule_max < map->bparam.granule ||
+		     map->bparam.granule_max > 1024)) {
+			pr_err("invalid maximum granule size\n");
+			return -EINVAL;
+		}
+
+		switch (map->bparam.mode) {
+		case DMA_MAP_SINGLE_MODE:
+		case DMA_MAP_PAGE_MODE:
+		case DMA_MAP_SG_MODE:
+			break;
+		default:
+			pr_err("invalid benchmark mode\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -257,7 +439,7 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 		return -EINVAL;
 	}
 
-	if (copy_to_user(argp, &map->bparam, sizeof(map->bparam)))
+	if (copy_to_user(argp, &map->bparam, size))
 		return -EFAULT;
 
 	return ret;
@@ -32,8 +32,10 @@
 #include <linux/io.h>
 #include <linux/iommu-helper.h>
 #include <linux/init.h>
+#include <linux/log2.h>
 #include <linux/memblock.h>
 #include <linux/mm.h>
+#include <linux/percpu.h>
 #include <linux/pfn.h>
 #include <linux/scatterlist.h>
 #include <linux/set_memory.h>
@@ -534,6 +536,7 @@ void __init swiotlb_exit(void)
 		memblock_free_late(__pa(mem->slots), slots_size);
 	}
 
+	free_percpu(mem->pcp);
 	memset(mem, 0, sizeof(*mem));
 }
 
@@ -640,6 +643,189 @@ static unsigned int wrap_area_index(struct io_tlb_mem *mem, unsigned int index)
 	return index;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void inc_used_and_hiwater(struct io_tlb_mem *mem, unsigned int nslots)
+{
+	unsigned long old_hiwater, new_used;
+
+	new_used = atomic_long_add_return(nslots, &mem->total_used);
+	old_hiwater = atomic_long_read(&mem->used_hiwater);
+	do {
+		if (new_used <= old_hiwater)
+			break;
+	} while (!atomic_long_try_cmpxchg(&mem->used_hiwater,
+					  &old_hiwater, new_used));
+}
+
+static void dec_used(struct io_tlb_mem *mem, unsigned int nslots)
+{
+	atomic_long_sub(nslots, &mem->total_used);
+}
+
+static void inc_full_count(struct io_tlb_mem *mem)
+{
+	atomic_long_inc(&mem->full_count);
+}
+
+static void inc_contended(struct io_tlb_mem *mem)
+{
+	atomic_long_inc(&mem->contended);
+}
+#else /* !CONFIG_DEBUG_FS */
+static void inc_used_and_hiwater(struct io_tlb_mem *mem, unsigned int nslots)
+{
+}
+static void dec_used(struct io_tlb_mem *mem, unsigned int nslots)
+{
+}
+static void inc_full_count(struct io_tlb_mem *mem)
+{
+}
+static void inc_contended(struct io_tlb_mem *mem)
+{
+}
+#endif /* CONFIG_DEBUG_FS */
+
+/*
+ * Ensure that the allocation is at least slot-aligned and update
+ * 'iotlb_align_mask' to ignore bits that will be preserved when
+ * offsetting into the allocation.  Returns the slot stride to search with:
+ * for mappings with an alignment requirement don't bother looping to
+ * unaligned slots once we found an aligned one.  For allocations of
+ * PAGE_SIZE or larger only look for page aligned allocations.
+ */
+static unsigned int swiotlb_align_stride(size_t alloc_size,
+					 unsigned int *alloc_align_mask,
+					 unsigned int *iotlb_align_mask)
+{
+	unsigned int stride;
+
+	*alloc_align_mask |= (IO_TLB_SIZE - 1);
+	*iotlb_align_mask &= ~*alloc_align_mask;
+
+	stride = (*iotlb_align_mask >> IO_TLB_SHIFT) + 1;
+	if (alloc_size >= PAGE_SIZE)
+		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
+	return max(stride, (*alloc_align_mask >> IO_TLB_SHIFT) + 1);
+}
+
+/*
+ * Per-CPU caches of recently freed slot ranges, one stack per power of two
+ * number of slots.  Heavy bouncers such as encrypted guests then reuse
+ * their own ranges without touching the area locks.  A cached range stays
+ * allocated in its area, so the caches only fill while the area is at most
+ * half used, and a mapping that finds no space drains them all back into
+ * the free lists before it gives up.
+ */
+#define IO_TLB_PCP_CLASSES	5	/* ranges of up to 16 slots */
+#define IO_TLB_PCP_DEPTH	4
+
+struct io_tlb_pcp {
+	spinlock_t lock;
+	unsigned int count[IO_TLB_PCP_CLASSES];
+	unsigned int index[IO_TLB_PCP_CLASSES][IO_TLB_PCP_DEPTH];
+	unsigned long hits;
+};
+
+static int swiotlb_pcp_class(unsigned int nslots)
+{
+	if (!is_power_of_2(nslots) || ilog2(nslots) >= IO_TLB_PCP_CLASSES)
+		return -1;
+	return ilog2(nslots);
+}
+
+/* Whether the range at @slot_index meets the constraints of a mapping */
+static bool swiotlb_pcp_fits(struct device *dev, unsigned int slot_index,
+		phys_addr_t orig_addr, size_t alloc_size,
+		unsigned int alloc_align_mask)
+{
+	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	unsigned long boundary_mask = dma_get_seg_boundary(dev);
+	dma_addr_t tbl_dma_addr =
+		phys_to_dma_unencrypted(dev, mem->start) & boundary_mask;
+	unsigned int iotlb_align_mask = dma_get_min_align_mask(dev);
+	unsigned int stride;
+
+	stride = swiotlb_align_stride(alloc_size, &alloc_align_mask,
+				      &iotlb_align_mask);
+	if ((slot_index % mem->area_nslabs) % stride)
+		return false;
+	if (orig_addr &&
+	    (slot_addr(tbl_dma_addr, slot_index) & iotlb_align_mask) !=
+	    (orig_addr & iotlb_align_mask))
+		return false;
+	return !iommu_is_span_boundary(slot_index, nr_slots(alloc_size),
+				       nr_slots(tbl_dma_addr),
+				       get_max_slots(boundary_mask));
+}
+
+static int swiotlb_pcp_get(struct device *dev, phys_addr_t orig_addr,
+		size_t alloc_size, unsigned int alloc_align_mask)
+{
+	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	struct io_tlb_pcp __percpu *caches = READ_ONCE(mem->pcp);
+	unsigned int offset = swiotlb_align_offset(dev, orig_addr);
+	unsigned int nslots = nr_slots(alloc_size);
+	int cls = swiotlb_pcp_class(nslots);
+	int slot_index = -1;
+	struct io_tlb_pcp *pcp;
+	unsigned long flags;
+	unsigned int i;
+
+	if (!caches || cls < 0)
+		return -1;
+
+	pcp = raw_cpu_ptr(caches);
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->count[cls]) {
+		i = pcp->index[cls][pcp->count[cls] - 1];
+		if (swiotlb_pcp_fits(dev, i, orig_addr, alloc_size,
+				     alloc_align_mask)) {
+			slot_index = i;
+			pcp->count[cls]--;
+			pcp->hits++;
+		}
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	if (slot_index < 0)
+		return -1;
+
+	for (i = slot_index; i < slot_index + nslots; i++)
+		mem->slots[i].alloc_size = alloc_size - (offset +
+				((i - slot_index) << IO_TLB_SHIFT));
+	return slot_index;
+}
+
+static bool swiotlb_pcp_put(struct io_tlb_mem *mem, int index, int nslots)
+{
+	struct io_tlb_pcp __percpu *caches = READ_ONCE(mem->pcp);
+	struct io_tlb_area *area = &mem->areas[index / mem->area_nslabs];
+	int cls = swiotlb_pcp_class(nslots);
+	struct io_tlb_pcp *pcp;
+	unsigned long flags;
+	bool cached = false;
+	int i;
+
+	if (!caches || cls < 0 ||
+	    READ_ONCE(area->used) > mem->area_nslabs / 2)
+		return false;
+
+	/* The range may be handed out again as soon as it is cached */
+	for (i = index; i < index + nslots; i++)
+		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
+
+	pcp = raw_cpu_ptr(caches);
+	spin_lock_irqsave(&pcp->lock, flags);
+	if (pcp->count[cls] < IO_TLB_PCP_DEPTH) {
+		pcp->index[cls][pcp->count[cls]++] = index;
+		cached = true;
+	}
+	spin_unlock_irqrestore(&pcp->lock, flags);
+
+	return cached;
+}
+
 /*
  * Find a suitable number of IO TLB entries size that will fit this request and
  * allocate a buffer from that IO TLB pool.
@@ -665,25 +851,17 @@ static int swiotlb_do_find_slots(struct device *dev, int area_index,
 	BUG_ON(!nslots);
 	BUG_ON(area_index >= mem->nareas);
 
-	/*
-	 * Ensure that the allocation is at least slot-aligned and update
-	 * 'iotlb_align_mask' to ignore bits that will be preserved when
-	 * offsetting into the allocation.
-	 */
-	alloc_align_mask |= (IO_TLB_SIZE - 1);
-	iotlb_align_mask &= ~alloc_align_mask;
+	stride = swiotlb_align_stride(alloc_size, &alloc_align_mask,
+				      &iotlb_align_mask);
 
-	/*
-	 * For mappings with an alignment requirement don't bother looping to
-	 * unaligned slots once we found an aligned one.  For allocations of
-	 * PAGE_SIZE or larger only look for page aligned allocations.
-	 */
-	stride = (iotlb_align_mask >> IO_TLB_SHIFT) + 1;
-	if (alloc_size >= PAGE_SIZE)
-		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
-	stride = max(stride, (alloc_align_mask >> IO_TLB_SHIFT) + 1);
+	/* Don't bother taking the lock of an area that is obviously too full */
+	if (unlikely(nslots > mem->area_nslabs - READ_ONCE(area->used)))
+		return -1;
 
-	spin_lock_irqsave(&area->lock, flags);
+	if (!spin_trylock_irqsave(&area->lock, flags)) {
+		inc_contended(mem);
+		spin_lock_irqsave(&area->lock, flags);
+	}
 	if (unlikely(nslots > mem->area_nslabs - area->used))
 		goto not_found;
 
@@ -736,12 +914,13 @@ static int swiotlb_do_find_slots(struct device *dev, int area_index,
 		area->index = index + nslots;
 	else
 		area->index = 0;
-	area->used += nslots;
+	WRITE_ONCE(area->used, area->used + nslots);
 	spin_unlock_irqrestore(&area->lock, flags);
+	inc_used_and_hiwater(mem, nslots);
 	return slot_index;
 }
 
-static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
+static int swiotlb_search_areas(struct device *dev, phys_addr_t orig_addr,
 		size_t alloc_size, unsigned int alloc_align_mask)
 {
 	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
@@ -760,6 +939,56 @@ static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
 	return -1;
 }
 
+static void swiotlb_do_release_slots(struct io_tlb_mem *mem, int index,
+				     int nslots);
+
+/* Return every cached range to the free lists, %true if there were any */
+static bool swiotlb_pcp_drain(struct io_tlb_mem *mem)
+{
+	struct io_tlb_pcp __percpu *caches = READ_ONCE(mem->pcp);
+	struct io_tlb_pcp *pcp;
+	unsigned long flags;
+	bool drained = false;
+	int cpu, cls;
+
+	if (!caches)
+		return false;
+
+	for_each_possible_cpu(cpu) {
+		pcp = per_cpu_ptr(caches, cpu);
+		spin_lock_irqsave(&pcp->lock, flags);
+		for (cls = 0; cls < IO_TLB_PCP_CLASSES; cls++) {
+			while (pcp->count[cls]) {
+				pcp->count[cls]--;
+				swiotlb_do_release_slots(mem,
+					pcp->index[cls][pcp->count[cls]],
+					1 << cls);
+				drained = true;
+			}
+		}
+		spin_unlock_irqrestore(&pcp->lock, flags);
+	}
+	return drained;
+}
+
+static int swiotlb_find_slots(struct device *dev, phys_addr_t orig_addr,
+		size_t alloc_size, unsigned int alloc_align_mask)
+{
+	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	int index;
+
+	index = swiotlb_pcp_get(dev, orig_addr, alloc_size, alloc_align_mask);
+	if (index >= 0)
+		return index;
+
+	index = swiotlb_search_areas(dev, orig_addr, alloc_size,
+				     alloc_align_mask);
+	if (index == -1 && swiotlb_pcp_drain(mem))
+		index = swiotlb_search_areas(dev, orig_addr, alloc_size,
+					     alloc_align_mask);
+	return index;
+}
+
 static unsigned long mem_used(struct io_tlb_mem *mem)
 {
 	int i;
@@ -799,6 +1028,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 	index = swiotlb_find_slots(dev, orig_addr,
 				   alloc_size + offset, alloc_align_mask);
 	if (index == -1) {
+		inc_full_count(mem);
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
 	"swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
@@ -825,13 +1055,10 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 	return tlb_addr;
 }
 
-static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
+static void swiotlb_do_release_slots(struct io_tlb_mem *mem, int index,
+				     int nslots)
 {
-	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
 	unsigned long flags;
-	unsigned int offset = swiotlb_align_offset(dev, tlb_addr);
-	int index = (tlb_addr - offset - mem->start) >> IO_TLB_SHIFT;
-	int nslots = nr_slots(mem->slots[index].alloc_size + offset);
 	int aindex = index / mem->area_nslabs;
 	struct io_tlb_area *area = &mem->areas[aindex];
 	int count, i;
@@ -868,8 +1095,20 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
 	     i--)
 		mem->slots[i].list = ++count;
-	area->used -= nslots;
+	WRITE_ONCE(area->used, area->used - nslots);
 	spin_unlock_irqrestore(&area->lock, flags);
+	dec_used(mem, nslots);
+}
+
+static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
+{
+	struct io_tlb_mem *mem = dev->dma_io_tlb_mem;
+	unsigned int offset = swiotlb_align_offset(dev, tlb_addr);
+	int index = (tlb_addr - offset - mem->start) >> IO_TLB_SHIFT;
+	int nslots = nr_slots(mem->slots[index].alloc_size + offset);
+
+	if (!swiotlb_pcp_put(mem, index, nslots))
+		swiotlb_do_release_slots(mem, index, nslots);
 }
 
 /*
@@ -973,6 +1212,64 @@ static int io_tlb_used_get(void *data, u64 *val)
 }
 DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
 
+#ifdef CONFIG_DEBUG_FS
+static int io_tlb_hiwater_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->used_hiwater);
+	return 0;
+}
+
+static int io_tlb_hiwater_set(void *data, u64 val)
+{
+	struct io_tlb_mem *mem = data;
+
+	/* Only allow setting to zero */
+	if (val != 0)
+		return -EINVAL;
+
+	atomic_long_set(&mem->used_hiwater, val);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_hiwater, io_tlb_hiwater_get,
+			 io_tlb_hiwater_set, "%llu\n");
+
+static int io_tlb_full_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->full_count);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_full, io_tlb_full_get, NULL, "%llu\n");
+
+static int io_tlb_contended_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->contended);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_contended, io_tlb_contended_get, NULL,
+			 "%llu\n");
+
+static int io_tlb_pcp_hits_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+	struct io_tlb_pcp __percpu *caches = READ_ONCE(mem->pcp);
+	int cpu;
+
+	*val = 0;
+	if (caches)
+		for_each_possible_cpu(cpu)
+			*val += READ_ONCE(per_cpu_ptr(caches, cpu)->hits);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_pcp_hits, io_tlb_pcp_hits_get, NULL,
+			 "%llu\n");
+#endif /* CONFIG_DEBUG_FS */
+
 static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 					 const char *dirname)
 {
@@ -983,6 +1280,16 @@ static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 	debugfs_create_ulong("io_tlb_nslabs", 0400, mem->debugfs, &mem->nslabs);
 	debugfs_create_file("io_tlb_used", 0400, mem->debugfs, mem,
 			&fops_io_tlb_used);
+#ifdef CONFIG_DEBUG_FS
+	debugfs_create_file("io_tlb_used_hiwater", 0600, mem->debugfs, mem,
+			&fops_io_tlb_hiwater);
+	debugfs_create_file("io_tlb_full", 0400, mem->debugfs, mem,
+			&fops_io_tlb_full);
+	debugfs_create_file("io_tlb_contended", 0400, mem->debugfs, mem,
+			&fops_io_tlb_contended);
+	debugfs_create_file("io_tlb_pcp_hits", 0400, mem->debugfs, mem,
+			&fops_io_tlb_pcp_hits);
+#endif
 }
 
 static int __init __maybe_unused swiotlb_create_default_debugfs(void)
@@ -995,6 +1302,27 @@ static int __init __maybe_unused swiotlb_create_default_debugfs(void)
 late_initcall(swiotlb_create_default_debugfs);
 #endif
 
+/* The default pool is set up before the per-CPU allocator is available */
+static int __init swiotlb_pcp_init(void)
+{
+	struct io_tlb_mem *mem = &io_tlb_default_mem;
+	struct io_tlb_pcp __percpu *caches;
+	int cpu;
+
+	if (!mem->nslabs)
+		return 0;
+
+	caches = alloc_percpu(struct io_tlb_pcp);
+	if (!caches)
+		return -ENOMEM;
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(caches, cpu)->lock);
+
+	smp_store_release(&mem->pcp, caches);
+	return 0;
+}
+core_initcall(swiotlb_pcp_init);
+
 #ifdef CONFIG_DMA_RESTRICTED_POOL
 
 struct page *swiotlb_alloc(struct device *dev, size_t size)
@@ -37,6 +37,11 @@
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
 #include <linux/slab.h>
+#include <linux/mmu_notifier.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/sysctl.h>
+#include <linux/wait_bit.h>
 
 #include "futex.h"
 #include "../locking/rtmutex_common.h"
@@ -53,6 +58,24 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+/*
+ * Private futexes of a process with at least futex_private_hash_threads
+ * threads are hashed into a table hanging off its mm. The table is only
+ * replaced while mm->futex_ops shows no private futex operation in flight;
+ * plain waiters don't count while they sleep and are moved over to the new
+ * table, so a futex_q can never be left on a table that goes away.
+ */
+struct futex_private_hash {
+	unsigned int		 hashsize;
+	struct futex_hash_bucket queues[];
+};
+
+#define FUTEX_PRIVATE_HASH_MIN	16
+
+static unsigned int futex_private_hash_threads __read_mostly = 16;
+#endif
+
 
 /*
  * Fault injections for futexes.
@@ -112,14 +135,259 @@ late_initcall(fail_futex_debugfs);
  * We hash on the keys returned from get_futex_key (see below) and return the
  * corresponding hash bucket in the global hash.
  */
+static u32 futex_hash_val(union futex_key *key)
+{
+	return jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
+		      key->both.offset);
+}
+
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
-	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
-			  key->both.offset);
+	u32 hash = futex_hash_val(key);
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))) {
+		struct futex_private_hash *fph;
+
+		fph = READ_ONCE(key->private.mm->futex_phash);
+		if (fph)
+			return &fph->queues[hash & (fph->hashsize - 1)];
+	}
+#endif
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+static bool futex_key_is_private(union futex_key *key)
+{
+	return !(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED));
+}
+
+/*
+ * The table lives as long as the address space: the notifier's release
+ * callback runs from exit_mmap(), when no thread is left to use it.
+ */
+static struct mmu_notifier *futex_mn_alloc(struct mm_struct *mm)
+{
+	struct mmu_notifier *mn = kzalloc(sizeof(*mn), GFP_KERNEL);
+
+	return mn ? mn : ERR_PTR(-ENOMEM);
+}
+
+static void futex_mn_free(struct mmu_notifier *mn)
+{
+	kfree(mn);
+}
+
+static void futex_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	kvfree(mm->futex_phash);
+	mm->futex_phash = NULL;
+	mmu_notifier_put(mn);
+}
+
+static const struct mmu_notifier_ops futex_mn_ops = {
+	.release	= futex_mn_release,
+	.alloc_notifier	= futex_mn_alloc,
+	.free_notifier	= futex_mn_free,
+};
+
+/*
+ * dup_mm() copies the parent's futex_phash and futex_ops into the child.
+ * The child must not use either, it starts without a table of its own;
+ * futex_phash_owner tells the two apart without dereferencing the table.
+ */
+static void futex_private_hash_adopt(struct mm_struct *mm)
+{
+	mmap_write_lock(mm);
+	if (mm->futex_phash_owner != mm) {
+		mm->futex_phash = NULL;
+		atomic_set(&mm->futex_ops, 0);
+		smp_store_release(&mm->futex_phash_owner, mm);
+	}
+	mmap_write_unlock(mm);
+}
+
+/*
+ * Move the futex_q's of @mm's private futexes from @queues over to @fph.
+ * Only plain waiters can be queued while futex_ops is held at -1, and they
+ * follow q->lock_ptr just like after a requeue.
+ */
+static void futex_private_hash_move(struct mm_struct *mm,
+				    struct futex_hash_bucket *queues,
+				    unsigned long size,
+				    struct futex_private_hash *fph)
+{
+	struct futex_q *q, *next;
+	unsigned long i;
+
+	for (i = 0; i < size; i++) {
+		struct futex_hash_bucket *hb = &queues[i];
+
+		if (!futex_hb_waiters_pending(hb))
+			continue;
+
+		spin_lock(&hb->lock);
+		plist_for_each_entry_safe(q, next, &hb->chain, list) {
+			struct futex_hash_bucket *nhb;
+
+			if (!futex_key_is_private(&q->key) ||
+			    q->key.private.mm != mm)
+				continue;
+
+			nhb = &fph->queues[futex_hash_val(&q->key) &
+					   (fph->hashsize - 1)];
+			spin_lock_nested(&nhb->lock, SINGLE_DEPTH_NESTING);
+			plist_del(&q->list, &hb->chain);
+			futex_hb_waiters_dec(hb);
+			futex_hb_waiters_inc(nhb);
+			plist_add(&q->list, &nhb->chain);
+			q->lock_ptr = &nhb->lock;
+			spin_unlock(&nhb->lock);
+		}
+		spin_unlock(&hb->lock);
+	}
+}
+
+static void futex_private_hash_resize(struct mm_struct *mm)
+{
+	unsigned int threads = READ_ONCE(futex_private_hash_threads);
+	struct futex_private_hash *fph, *old;
+	struct mmu_notifier *mn = NULL;
+	unsigned long size;
+	unsigned int nr, i;
+
+	if (!threads)
+		return;
+
+	nr = get_nr_threads(current);
+	if (nr < threads)
+		return;
+
+	size = clamp_t(unsigned long, roundup_pow_of_two(4 * nr),
+		       FUTEX_PRIVATE_HASH_MIN, futex_hashsize);
+	old = READ_ONCE(mm->futex_phash);
+	if (old && old->hashsize >= size)
+		return;
+
+	/* Other operations are running, try again on a later one. */
+	if (atomic_read(&mm->futex_ops))
+		return;
+
+	/* The first table needs the notifier to be freed with the mm. */
+	if (!old) {
+		mn = mmu_notifier_get(&futex_mn_ops, mm);
+		if (IS_ERR(mn))
+			return;
+	}
+
+	fph = kvzalloc(struct_size(fph, queues, size),
+		       GFP_KERNEL_ACCOUNT | __GFP_NOWARN);
+	if (!fph)
+		goto out;
+
+	fph->hashsize = size;
+	for (i = 0; i < size; i++) {
+		atomic_set(&fph->queues[i].waiters, 0);
+		plist_head_init(&fph->queues[i].chain);
+		spin_lock_init(&fph->queues[i].lock);
+	}
+
+	if (atomic_cmpxchg(&mm->futex_ops, 0, -1) == 0) {
+		if (mm->futex_phash == old) {
+			if (old)
+				futex_private_hash_move(mm, old->queues,
+							old->hashsize, fph);
+			else
+				futex_private_hash_move(mm, futex_queues,
+							futex_hashsize, fph);
+			WRITE_ONCE(mm->futex_phash, fph);
+			fph = old;
+			/* The notifier reference now belongs to the table. */
+			mn = NULL;
+		}
+		atomic_set_release(&mm->futex_ops, 0);
+		/* Pairs with the barrier in wait_var_event() */
+		smp_mb();
+		wake_up_var(&mm->futex_ops);
+	}
+
+	kvfree(fph);
+out:
+	if (mn)
+		mmu_notifier_put(mn);
+}
+
+/**
+ * futex_private_hash_get - Pin the private futex hash of current's mm
+ *
+ * Every operation which hashes private futex keys runs between
+ * futex_private_hash_get() and futex_private_hash_put(), which keeps
+ * mm->futex_phash stable. On entry the table is grown when the thread
+ * count of the process outgrew it and no other operation is running.
+ *
+ * Context: Process context, may sleep.
+ * Return: the pinned mm, to be passed to futex_private_hash_put()
+ */
+struct mm_struct *futex_private_hash_get(void)
+{
+	struct mm_struct *mm = current->mm;
+
+	if (!mm)
+		return NULL;
+
+	if (unlikely(smp_load_acquire(&mm->futex_phash_owner) != mm))
+		futex_private_hash_adopt(mm);
+
+	futex_private_hash_resize(mm);
+	wait_var_event(&mm->futex_ops,
+		       atomic_inc_unless_negative(&mm->futex_ops));
+
+	return mm;
+}
+
+void futex_private_hash_put(struct mm_struct *mm)
+{
+	if (mm)
+		atomic_dec(&mm->futex_ops);
+}
+
+/**
+ * futex_private_hash_sleep - Unpin the private futex hash while @q sleeps
+ * @q:		the queued futex_q
+ *
+ * A plain waiter is only reached through q->lock_ptr until it is woken,
+ * so it lets the table be resized under it instead of holding the resize
+ * off for as long as it sleeps. PI and requeue-PI waiters keep the pin.
+ *
+ * Return: true if futex_private_hash_wake() must repin after the sleep
+ */
+bool futex_private_hash_sleep(struct futex_q *q)
+{
+	if (q->rt_waiter || !futex_key_is_private(&q->key))
+		return false;
+
+	futex_private_hash_put(current->mm);
+	return true;
+}
+
+void futex_private_hash_wake(void)
+{
+	futex_private_hash_get();
+}
+
+static struct ctl_table futex_sysctls[] = {
+	{
+		.procname	= "futex_private_hash_threads",
+		.data		= &futex_private_hash_threads,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
+	{ }
+};
+#endif
+
 
 /**
  * futex_setup_timer - set up the sleeping hrtimer.
@@ -956,6 +1224,7 @@ static void exit_pi_state_list(struct task_struct *curr)
 	struct futex_pi_state *pi_state;
 	struct futex_hash_bucket *hb;
 	union futex_key key = FUTEX_KEY_INIT;
+	struct mm_struct *mm = futex_private_hash_get();
 
 	/*
 	 * We are a ZOMBIE and nobody can enqueue itself on
@@ -1017,6 +1286,7 @@ static void exit_pi_state_list(struct task_struct *curr)
 		raw_spin_lock_irq(&curr->pi_lock);
 	}
 	raw_spin_unlock_irq(&curr->pi_lock);
+	futex_private_hash_put(mm);
 }
 #else
 static inline void exit_pi_state_list(struct task_struct *curr) { }
@@ -1154,6 +1424,9 @@ static int __init futex_init(void)
 		spin_lock_init(&futex_queues[i].lock);
 	}
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+	register_sysctl_init("kernel", futex_sysctls);
+#endif
 	return 0;
 }
 core_initcall(futex_init);
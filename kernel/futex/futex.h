@@ -125,6 +125,24 @@ futex_setup_timer(ktime_t *time, struct hrtimer_sleeper *timeout,
 
 extern struct futex_hash_bucket *futex_hash(union futex_key *key);
 
+#ifdef CONFIG_FUTEX_PRIVATE_HASH
+extern struct mm_struct *futex_private_hash_get(void);
+extern void futex_private_hash_put(struct mm_struct *mm);
+extern bool futex_private_hash_sleep(struct futex_q *q);
+extern void futex_private_hash_wake(void);
+#else
+static inline struct mm_struct *futex_private_hash_get(void)
+{
+	return NULL;
+}
+static inline void futex_private_hash_put(struct mm_struct *mm) { }
+static inline bool futex_private_hash_sleep(struct futex_q *q)
+{
+	return false;
+}
+static inline void futex_private_hash_wake(void) { }
+#endif
+
 /**
  * futex_match - Check whether two futex keys are equal
  * @key1:	Pointer to key1
@@ -284,6 +302,8 @@ extern int futex_wait_multiple(struct futex_vector *vs, unsigned int count,
 
 extern int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset);
 
+extern int futex_wake_multiple(struct futex_waitv *ws, unsigned int count);
+
 extern int futex_wake_op(u32 __user *uaddr1, unsigned int flags,
 			 u32 __user *uaddr2, int nr_wake, int nr_wake2, int op);
 
@@ -82,8 +82,8 @@ SYSCALL_DEFINE3(get_robust_list, int, pid,
 	return ret;
 }
 
-long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
-		u32 __user *uaddr2, u32 val2, u32 val3)
+static long __do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
+		       u32 __user *uaddr2, u32 val2, u32 val3)
 {
 	int cmd = op & FUTEX_CMD_MASK;
 	unsigned int flags = 0;
@@ -134,6 +134,22 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	return -ENOSYS;
 }
 
+long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
+		u32 __user *uaddr2, u32 val2, u32 val3)
+{
+	struct mm_struct *mm;
+	long ret;
+
+	if (!(op & FUTEX_PRIVATE_FLAG))
+		return __do_futex(uaddr, op, val, timeout, uaddr2, val2, val3);
+
+	mm = futex_private_hash_get();
+	ret = __do_futex(uaddr, op, val, timeout, uaddr2, val2, val3);
+	futex_private_hash_put(mm);
+
+	return ret;
+}
+
 static __always_inline bool futex_cmd_has_timeout(u32 cmd)
 {
 	switch (cmd) {
@@ -220,6 +236,58 @@ static int futex_parse_waitv(struct futex_vector *futexv,
 	return 0;
 }
 
+/**
+ * sys_futex_wakev - Wake waiters on a list of futexes
+ * @wakers:     List of futexes to wake
+ * @nr_futexes: Length of @wakers
+ * @flags:      Flags for the whole list, none defined yet
+ *
+ * Given an array of `struct futex_waitv`, wake up to `val` waiters on each
+ * uaddr, like a FUTEX_WAKE per entry but in a single syscall. Each entry has
+ * individual flags, FUTEX_32 is mandatory and FUTEX_PRIVATE_FLAG optional.
+ * Nothing is woken if any of the entries is invalid.
+ *
+ * Returns the total number of woken waiters.
+ */
+SYSCALL_DEFINE3(futex_wakev, struct futex_waitv __user *, wakers,
+		unsigned int, nr_futexes, unsigned int, flags)
+{
+	struct futex_waitv *ws;
+	struct mm_struct *mm;
+	unsigned int i;
+	int ret;
+
+	/* This syscall supports no flags for now */
+	if (flags)
+		return -EINVAL;
+
+	if (!nr_futexes || nr_futexes > FUTEX_WAITV_MAX || !wakers)
+		return -EINVAL;
+
+	ws = kmalloc_array(nr_futexes, sizeof(*ws), GFP_KERNEL);
+	if (!ws)
+		return -ENOMEM;
+
+	ret = -EFAULT;
+	if (copy_from_user(ws, wakers, nr_futexes * sizeof(*ws)))
+		goto out;
+
+	ret = -EINVAL;
+	for (i = 0; i < nr_futexes; i++) {
+		if ((ws[i].flags & ~FUTEXV_WAITER_MASK) || ws[i].__reserved)
+			goto out;
+		if (!(ws[i].flags & FUTEX_32))
+			goto out;
+	}
+
+	mm = futex_private_hash_get();
+	ret = futex_wake_multiple(ws, nr_futexes);
+	futex_private_hash_put(mm);
+out:
+	kfree(ws);
+	return ret;
+}
+
 /**
  * sys_futex_waitv - Wait on a list of futexes
  * @waiters:    List of futexes to wait on
@@ -292,8 +360,12 @@ SYSCALL_DEFINE5(futex_waitv, struct futex_waitv __user *, waiters,
 	}
 
 	ret = futex_parse_waitv(futexv, waiters, nr_futexes);
-	if (!ret)
+	if (!ret) {
+		struct mm_struct *mm = futex_private_hash_get();
+
 		ret = futex_wait_multiple(futexv, nr_futexes, timeout ? &to : NULL);
+		futex_private_hash_put(mm);
+	}
 
 	kfree(futexv);
 
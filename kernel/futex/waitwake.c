@@ -3,6 +3,7 @@
 #include <linux/sched/task.h>
 #include <linux/sched/signal.h>
 #include <linux/freezer.h>
+#include <linux/sort.h>
 
 #include "futex.h"
 
@@ -185,6 +186,105 @@ int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	return ret;
 }
 
+struct futex_wake_vec {
+	struct futex_hash_bucket	*hb;
+	union futex_key			key;
+	int				nr_wake;
+};
+
+static int futex_wake_vec_cmp(const void *a, const void *b)
+{
+	const struct futex_wake_vec *va = a, *vb = b;
+
+	if (va->hb < vb->hb)
+		return -1;
+	return va->hb > vb->hb;
+}
+
+/**
+ * futex_wake_multiple - Wake waiters on a list of futexes
+ * @ws:		List of futexes to wake, @ws[i].val holds the number of waiters
+ *		to wake on @ws[i].uaddr
+ * @count:	Length of @ws
+ *
+ * All keys are looked up before anything is woken. The entries are then
+ * walked sorted by hash bucket, so that every bucket lock is taken once and
+ * in address order, and all woken tasks are collected in a single wake queue.
+ *
+ * Return: the number of woken tasks, or an error code if nothing was woken
+ * and an entry failed
+ */
+int futex_wake_multiple(struct futex_waitv *ws, unsigned int count)
+{
+	struct futex_hash_bucket *hb = NULL;
+	struct futex_q *this, *next;
+	struct futex_wake_vec *vs;
+	int ret = 0, err = 0;
+	unsigned int i;
+	DEFINE_WAKE_Q(wake_q);
+
+	vs = kcalloc(count, sizeof(*vs), GFP_KERNEL);
+	if (!vs)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		bool shared = !(ws[i].flags & FUTEX_PRIVATE_FLAG);
+
+		vs[i].key = FUTEX_KEY_INIT;
+		err = get_futex_key(u64_to_user_ptr(ws[i].uaddr), shared,
+				    &vs[i].key, FUTEX_READ);
+		if (unlikely(err))
+			goto out;
+
+		vs[i].hb = futex_hash(&vs[i].key);
+		vs[i].nr_wake = min_t(u64, ws[i].val, INT_MAX);
+	}
+
+	sort(vs, count, sizeof(*vs), futex_wake_vec_cmp, NULL);
+
+	for (i = 0; i < count; i++) {
+		int woken = 0;
+
+		if (!vs[i].nr_wake)
+			continue;
+
+		if (vs[i].hb != hb) {
+			if (hb)
+				spin_unlock(&hb->lock);
+			hb = NULL;
+
+			/* Make sure we really have tasks to wakeup */
+			if (!futex_hb_waiters_pending(vs[i].hb))
+				continue;
+
+			hb = vs[i].hb;
+			spin_lock(&hb->lock);
+		}
+
+		plist_for_each_entry_safe(this, next, &hb->chain, list) {
+			if (!futex_match(&this->key, &vs[i].key))
+				continue;
+
+			if (this->pi_state || this->rt_waiter) {
+				err = -EINVAL;
+				break;
+			}
+
+			futex_wake_mark(&wake_q, this);
+			ret++;
+			if (++woken >= vs[i].nr_wake)
+				break;
+		}
+	}
+
+	if (hb)
+		spin_unlock(&hb->lock);
+	wake_up_q(&wake_q);
+out:
+	kfree(vs);
+	return ret ? ret : err;
+}
+
 static int futex_atomic_op_inuser(unsigned int encoded_op, u32 __user *uaddr)
 {
 	unsigned int op =	  (encoded_op & 0x70000000) >> 28;
@@ -351,8 +451,14 @@ void futex_wait_queue(struct futex_hash_bucket *hb, struct futex_q *q,
 		 * flagged for rescheduling. Only call schedule if there
 		 * is no timeout, or if it has yet to expire.
 		 */
-		if (!timeout || timeout->task)
+		if (!timeout || timeout->task) {
+			bool repin = futex_private_hash_sleep(q);
+
 			schedule();
+			__set_current_state(TASK_RUNNING);
+			if (repin)
+				futex_private_hash_wake();
+		}
 	}
 	__set_current_state(TASK_RUNNING);
 }
@@ -539,9 +645,12 @@ int futex_wait_multiple(struct futex_vector *vs, unsigned int count,
 			return ret;
 		}
 
+		/* Only reached through q->lock_ptr while asleep */
+		futex_private_hash_put(current->mm);
 		futex_sleep_multiple(vs, count, to);
 
 		__set_current_state(TASK_RUNNING);
+		futex_private_hash_get();
 
 		ret = unqueue_multiple(vs, count);
 		if (ret >= 0)
@@ -695,6 +804,8 @@ static long futex_wait_restart(struct restart_block *restart)
 {
 	u32 __user *uaddr = restart->futex.uaddr;
 	ktime_t t, *tp = NULL;
+	struct mm_struct *mm = NULL;
+	long ret;
 
 	if (restart->futex.flags & FLAGS_HAS_TIMEOUT) {
 		t = restart->futex.time;
@@ -702,7 +813,12 @@ static long futex_wait_restart(struct restart_block *restart)
 	}
 	restart->fn = do_no_restart_syscall;
 
-	return (long)futex_wait(uaddr, restart->futex.flags,
-				restart->futex.val, tp, restart->futex.bitset);
+	if (!(restart->futex.flags & FLAGS_SHARED))
+		mm = futex_private_hash_get();
+	ret = futex_wait(uaddr, restart->futex.flags,
+			 restart->futex.val, tp, restart->futex.bitset);
+	futex_private_hash_put(mm);
+
+	return ret;
 }
 
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Load aware balancing of non-managed interrupts
+ *
+ * Managed interrupts are spread at allocation time and non-managed ones
+ * end up wherever the default affinity and the irq chip put them, which
+ * with isolcpus/nohz_full tends to stack the busy vectors on a few of the
+ * remaining CPUs. When enabled, a periodic pass samples the per interrupt
+ * counts and moves interrupts from the busiest allowed CPU to the least
+ * loaded one until the imbalance drops below a threshold or the per pass
+ * migration budget is used up.
+ *
+ * Only interrupts whose affinity is still the default one, or which were
+ * last moved by the balancer itself, are considered, so an affinity set
+ * from user space is never overridden.
+ */
+
+#define pr_fmt(fmt) "genirq: " fmt
+
+#include <linux/cpu.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/kernel_stat.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/isolation.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "irq_balance."
+
+static unsigned int irq_balance_interval_ms;
+static unsigned int irq_balance_max_moves = 1;
+static unsigned int irq_balance_threshold = 1000;
+
+static unsigned long *irq_balance_load;
+static cpumask_var_t irq_balance_allowed;
+static bool irq_balance_primed;
+
+static void irq_balance_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_workfn);
+
+static int irq_balance_set_interval(const char *val,
+				    const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	/* Parsed on the command line, irq_balance_init() starts the work */
+	if (!ret && irq_balance_load)
+		mod_delayed_work(system_unbound_wq, &irq_balance_work, 0);
+
+	return ret;
+}
+
+static const struct kernel_param_ops irq_balance_interval_ops = {
+	.set = irq_balance_set_interval,
+	.get = param_get_uint,
+};
+
+module_param_cb(interval_ms, &irq_balance_interval_ops,
+		&irq_balance_interval_ms, 0644);
+MODULE_PARM_DESC(interval_ms, "Balancing period in milliseconds, 0 disables");
+module_param_named(max_moves, irq_balance_max_moves, uint, 0644);
+MODULE_PARM_DESC(max_moves, "Maximum number of interrupts moved per period");
+module_param_named(threshold, irq_balance_threshold, uint, 0644);
+MODULE_PARM_DESC(threshold, "Minimum imbalance, in interrupts per period, to act on");
+
+static bool irq_balance_candidate(unsigned int irq, struct irq_desc *desc,
+				  const struct cpumask *allowed)
+{
+	const struct cpumask *mask = irq_data_get_affinity_mask(&desc->irq_data);
+
+	if (!desc->action || !irq_can_set_affinity_usr(irq))
+		return false;
+
+	return cpumask_subset(allowed, mask) ||
+	       (desc->balance_moves &&
+		cpumask_equal(mask, cpumask_of(desc->balance_cpu)));
+}
+
+static unsigned int irq_balance_cpu(struct irq_desc *desc)
+{
+	return cpumask_first(irq_data_get_effective_affinity_mask(&desc->irq_data));
+}
+
+/* Record the number of interrupts each candidate took since the last pass */
+static void irq_balance_sample(const struct cpumask *allowed)
+{
+	struct irq_desc *desc;
+	unsigned int irq, cpu, count;
+
+	for_each_cpu(cpu, allowed)
+		irq_balance_load[cpu] = 0;
+
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		desc->balance_load = 0;
+
+		if (!irq_balance_candidate(irq, desc, allowed))
+			continue;
+
+		count = kstat_irqs_usr(irq);
+		desc->balance_load = count - desc->balance_count;
+		desc->balance_count = count;
+
+		cpu = irq_balance_cpu(desc);
+		if (cpu < nr_cpu_ids && cpumask_test_cpu(cpu, allowed))
+			irq_balance_load[cpu] += desc->balance_load;
+		else
+			desc->balance_load = 0;
+	}
+}
+
+/*
+ * Pick the busiest interrupt of @busiest that is not bigger than half of
+ * the @imbalance, moving anything bigger would just swap the roles of the
+ * two CPUs.
+ */
+static struct irq_desc *irq_balance_pick(unsigned int busiest,
+					 unsigned long imbalance)
+{
+	struct irq_desc *desc, *best = NULL;
+	unsigned int irq;
+
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+
+		if (!desc->balance_load || desc->balance_load > imbalance / 2 ||
+		    irq_balance_cpu(desc) != busiest)
+			continue;
+
+		if (!best || desc->balance_load > best->balance_load)
+			best = desc;
+	}
+
+	return best;
+}
+
+static void irq_balance_move(const struct cpumask *allowed)
+{
+	unsigned int moves, cpu, busiest, idlest;
+	struct irq_desc *desc;
+	unsigned long imbalance;
+
+	for (moves = 0; moves < READ_ONCE(irq_balance_max_moves); moves++) {
+		busiest = idlest = cpumask_first(allowed);
+		for_each_cpu(cpu, allowed) {
+			if (irq_balance_load[cpu] > irq_balance_load[busiest])
+				busiest = cpu;
+			if (irq_balance_load[cpu] < irq_balance_load[idlest])
+				idlest = cpu;
+		}
+
+		imbalance = irq_balance_load[busiest] - irq_balance_load[idlest];
+		if (imbalance < READ_ONCE(irq_balance_threshold))
+			break;
+
+		desc = irq_balance_pick(busiest, imbalance);
+		if (!desc)
+			break;
+
+		if (irq_set_affinity(irq_desc_get_irq(desc), cpumask_of(idlest))) {
+			desc->balance_load = 0;
+			continue;
+		}
+
+		pr_debug("IRQ %u: balanced from CPU%u to CPU%u\n",
+			 irq_desc_get_irq(desc), busiest, idlest);
+
+		irq_balance_load[busiest] -= desc->balance_load;
+		irq_balance_load[idlest] += desc->balance_load;
+		desc->balance_load = 0;
+		desc->balance_cpu = idlest;
+		desc->balance_moves++;
+	}
+}
+
+static void irq_balance_workfn(struct work_struct *work)
+{
+	unsigned int interval = READ_ONCE(irq_balance_interval_ms);
+
+	if (!interval) {
+		irq_balance_primed = false;
+		return;
+	}
+
+	/* Same ordering as CPU hotplug, which takes the sparse lock inside */
+	cpus_read_lock();
+	irq_lock_sparse();
+
+	cpumask_and(irq_balance_allowed, irq_default_affinity, cpu_online_mask);
+	cpumask_and(irq_balance_allowed, irq_balance_allowed,
+		    housekeeping_cpumask(HK_TYPE_MANAGED_IRQ));
+
+	if (cpumask_weight(irq_balance_allowed) > 1) {
+		irq_balance_sample(irq_balance_allowed);
+		/* The first sample covers everything since boot, skip it */
+		if (irq_balance_primed)
+			irq_balance_move(irq_balance_allowed);
+		irq_balance_primed = true;
+	}
+
+	irq_unlock_sparse();
+	cpus_read_unlock();
+
+	queue_delayed_work(system_unbound_wq, &irq_balance_work,
+			   msecs_to_jiffies(interval));
+}
+
+static int __init irq_balance_init(void)
+{
+	if (!zalloc_cpumask_var(&irq_balance_allowed, GFP_KERNEL))
+		return -ENOMEM;
+
+	irq_balance_load = kcalloc(nr_cpu_ids, sizeof(*irq_balance_load),
+				   GFP_KERNEL);
+	if (!irq_balance_load) {
+		free_cpumask_var(irq_balance_allowed);
+		return -ENOMEM;
+	}
+
+	queue_delayed_work(system_unbound_wq, &irq_balance_work, 0);
+	return 0;
+}
+late_initcall(irq_balance_init);
@@ -295,6 +295,19 @@ static int irq_spurious_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+#ifdef CONFIG_IRQ_LOAD_BALANCE
+static int irq_balance_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	unsigned int moves = READ_ONCE(desc->balance_moves);
+
+	seq_printf(m, "moves %u\n", moves);
+	if (moves)
+		seq_printf(m, "last_cpu %u\n", READ_ONCE(desc->balance_cpu));
+	return 0;
+}
+#endif
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -382,6 +395,10 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_single_data("effective_affinity_list", 0444, desc->dir,
 			irq_effective_aff_list_proc_show, irqp);
 # endif
+# ifdef CONFIG_IRQ_LOAD_BALANCE
+	proc_create_single_data("balance", 0444, desc->dir,
+			irq_balance_proc_show, irqp);
+# endif
 #endif
 	proc_create_single_data("spurious", 0444, desc->dir,
 			irq_spurious_proc_show, (void *)(long)irq);
@@ -405,6 +422,9 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 	remove_proc_entry("effective_affinity", desc->dir);
 	remove_proc_entry("effective_affinity_list", desc->dir);
 # endif
+# ifdef CONFIG_IRQ_LOAD_BALANCE
+	remove_proc_entry("balance", desc->dir);
+# endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
 
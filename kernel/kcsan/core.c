@@ -30,6 +30,7 @@ static bool kcsan_early_enable = IS_ENABLED(CONFIG_KCSAN_EARLY_ENABLE);
 unsigned int kcsan_udelay_task = CONFIG_KCSAN_UDELAY_TASK;
 unsigned int kcsan_udelay_interrupt = CONFIG_KCSAN_UDELAY_INTERRUPT;
 static long kcsan_skip_watch = CONFIG_KCSAN_SKIP_WATCH;
+static unsigned int kcsan_skip_watch_max_shift;
 static bool kcsan_interrupt_watcher = IS_ENABLED(CONFIG_KCSAN_INTERRUPT_WATCHER);
 
 #ifdef MODULE_PARAM_PREFIX
@@ -40,6 +41,7 @@ module_param_named(early_enable, kcsan_early_enable, bool, 0);
 module_param_named(udelay_task, kcsan_udelay_task, uint, 0644);
 module_param_named(udelay_interrupt, kcsan_udelay_interrupt, uint, 0644);
 module_param_named(skip_watch, kcsan_skip_watch, long, 0644);
+module_param_named(skip_watch_max_shift, kcsan_skip_watch_max_shift, uint, 0644);
 module_param_named(interrupt_watcher, kcsan_interrupt_watcher, bool, 0444);
 
 #ifdef CONFIG_KCSAN_WEAK_MEMORY
@@ -108,6 +110,26 @@ static atomic_long_t watchpoints[CONFIG_KCSAN_NUM_WATCHPOINTS + NUM_SLOTS-1];
  */
 static DEFINE_PER_CPU(long, kcsan_skip);
 
+/*
+ * Watchpoints that caught nothing after which a CPU doubles its skip count, up
+ * to skip_watch << skip_watch_max_shift. A watchpoint that catches a race drops
+ * the CPU straight back to skip_watch.
+ */
+#define SKIP_BACKOFF_WATCHPOINTS 64
+#define SKIP_BACKOFF_MAX_SHIFT 16
+
+struct kcsan_skip_backoff {
+	unsigned int shift;
+	unsigned int fruitless;
+};
+static DEFINE_PER_CPU(struct kcsan_skip_backoff, kcsan_skip_backoff);
+
+/*
+ * Non-atomic accesses checked by should_watch(), accounted one skip window at
+ * a time in reset_kcsan_skip() to keep the fast-path free of extra writes.
+ */
+static DEFINE_PER_CPU(unsigned long, kcsan_watch_checks);
+
 /* For kcsan_prandom_u32_max(). */
 static DEFINE_PER_CPU(u32, kcsan_rand_state);
 
@@ -305,11 +327,45 @@ static u32 kcsan_prandom_u32_max(u32 ep_ro)
 
 static inline void reset_kcsan_skip(void)
 {
-	long skip_count = kcsan_skip_watch -
+	long skip_watch = kcsan_skip_watch << raw_cpu_read(kcsan_skip_backoff.shift);
+	long skip_count = skip_watch -
 			  (IS_ENABLED(CONFIG_KCSAN_SKIP_WATCH_RANDOMIZE) ?
-				   kcsan_prandom_u32_max(kcsan_skip_watch) :
+				   kcsan_prandom_u32_max(skip_watch) :
 				   0);
 	this_cpu_write(kcsan_skip, skip_count);
+	this_cpu_add(kcsan_watch_checks, skip_count + 1);
+}
+
+/* Adjust this CPU's skip count to the race yield of its last watchpoint. */
+static void kcsan_skip_feedback(bool raced)
+{
+	struct kcsan_skip_backoff *backoff = raw_cpu_ptr(&kcsan_skip_backoff);
+	unsigned int max_shift = min_t(unsigned int, READ_ONCE(kcsan_skip_watch_max_shift),
+				       SKIP_BACKOFF_MAX_SHIFT);
+
+	/* Races with interrupts or migration only skew the heuristic. */
+	if (raced || backoff->shift > max_shift) {
+		backoff->shift = 0;
+		backoff->fruitless = 0;
+		return;
+	}
+
+	if (++backoff->fruitless < SKIP_BACKOFF_WATCHPOINTS)
+		return;
+	backoff->fruitless = 0;
+	if (backoff->shift < max_shift)
+		backoff->shift++;
+}
+
+unsigned long kcsan_watch_checks_sum(void)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += per_cpu(kcsan_watch_checks, cpu);
+
+	return sum;
 }
 
 static __always_inline bool kcsan_is_enabled(struct kcsan_ctx *ctx)
@@ -537,6 +593,7 @@ kcsan_setup_watchpoint(const volatile void *ptr, size_t size, int type, unsigned
 	unsigned long access_mask = ctx->access_mask;
 	unsigned long irq_flags = 0;
 	bool is_reorder_access;
+	bool raced = false;
 
 	/*
 	 * Always reset kcsan_skip counter in slow-path to avoid underflow; see
@@ -675,6 +732,7 @@ kcsan_setup_watchpoint(const volatile void *ptr, size_t size, int type, unsigned
 		if (is_assert && value_change == KCSAN_VALUE_CHANGE_TRUE)
 			atomic_long_inc(&kcsan_counters[KCSAN_COUNTER_ASSERT_FAILURES]);
 
+		raced = true;
 		kcsan_report_known_origin(ptr, size, type, ip,
 					  value_change, watchpoint - watchpoints,
 					  old, new, access_mask);
@@ -685,6 +743,8 @@ kcsan_setup_watchpoint(const volatile void *ptr, size_t size, int type, unsigned
 		if (is_assert)
 			atomic_long_inc(&kcsan_counters[KCSAN_COUNTER_ASSERT_FAILURES]);
 
+		raced = true;
+
 		if (IS_ENABLED(CONFIG_KCSAN_REPORT_RACE_UNKNOWN_ORIGIN) || is_assert) {
 			kcsan_report_unknown_origin(ptr, size, type, ip,
 						    old, new, access_mask);
@@ -697,6 +757,7 @@ kcsan_setup_watchpoint(const volatile void *ptr, size_t size, int type, unsigned
 	 */
 	remove_watchpoint(watchpoint);
 	atomic_long_dec(&kcsan_counters[KCSAN_COUNTER_USED_WATCHPOINTS]);
+	kcsan_skip_feedback(raced);
 
 out_unlock:
 	if (!interrupt_watcher)
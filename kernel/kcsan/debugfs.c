@@ -55,6 +55,13 @@ static struct {
 };
 static DEFINE_SPINLOCK(report_filterlist_lock);
 
+/* Previous sample of kcsan_watch_checks_sum(), for the per-second rate. */
+static struct {
+	unsigned long	checks;
+	unsigned long	jiffies;
+} watch_checks_sample;
+static DEFINE_SPINLOCK(watch_checks_lock);
+
 /*
  * The microbenchmark allows benchmarking KCSAN core runtime only. To run
  * multiple threads, pipe 'microbench=<iters>' from multiple tasks into the
@@ -195,6 +202,7 @@ static int show_info(struct seq_file *file, void *v)
 {
 	int i;
 	unsigned long flags;
+	unsigned long checks, rate = 0;
 
 	/* show stats */
 	seq_printf(file, "enabled: %i\n", READ_ONCE(kcsan_enabled));
@@ -203,6 +211,19 @@ static int show_info(struct seq_file *file, void *v)
 			   atomic_long_read(&kcsan_counters[i]));
 	}
 
+	/* show watchpoint checks, and their rate since the previous read */
+	checks = kcsan_watch_checks_sum();
+	spin_lock_irqsave(&watch_checks_lock, flags);
+	if (watch_checks_sample.jiffies && time_after(jiffies, watch_checks_sample.jiffies)) {
+		rate = (checks - watch_checks_sample.checks) * HZ /
+		       (jiffies - watch_checks_sample.jiffies);
+	}
+	watch_checks_sample.checks = checks;
+	watch_checks_sample.jiffies = jiffies;
+	spin_unlock_irqrestore(&watch_checks_lock, flags);
+	seq_printf(file, "watch_checks: %lu\n", checks);
+	seq_printf(file, "watch_checks_per_sec: %lu\n", rate);
+
 	/* show filter functions, and filter type */
 	spin_lock_irqsave(&report_filterlist_lock, flags);
 	seq_printf(file, "\n%s functions: %s\n",
@@ -89,6 +89,12 @@ enum kcsan_counter_id {
 };
 extern atomic_long_t kcsan_counters[KCSAN_COUNTER_COUNT];
 
+/*
+ * Returns the number of non-atomic accesses checked for setting up a
+ * watchpoint, summed over all CPUs.
+ */
+unsigned long kcsan_watch_checks_sum(void);
+
 /*
  * Returns true if data races in the function symbol that maps to func_addr
  * (offsets are ignored) should *not* be reported.
@@ -8,22 +8,49 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/cpu.h>
+#include <linux/mm.h>
+#include <linux/sched/stat.h>
+#include <linux/sched/task.h>
 #include <linux/stacktrace.h>
 #include "core.h"
 #include "patch.h"
 #include "transition.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/livepatch.h>
+
 #define MAX_STACK_ENTRIES  100
 #define STACK_ERR_BUF_SIZE 128
 
 #define SIGNALS_TIMEOUT 15
 
+/* Below this many threads, checking the stacks in parallel isn't worth it */
+#define KLP_PARALLEL_MIN_TASKS 4096
+
 struct klp_patch *klp_transition_patch;
 
 static int klp_target_state = KLP_UNDEFINED;
 
 static unsigned int klp_signals_cnt;
 
+static DEFINE_PER_CPU(unsigned long [MAX_STACK_ENTRIES], klp_stack_entries);
+
+/* Why tasks couldn't be switched during the last klp_try_complete_transition() */
+enum klp_stuck_reason {
+	KLP_STUCK_RUNNING,
+	KLP_STUCK_UNRELIABLE,
+	KLP_STUCK_SLEEPING,
+	KLP_STUCK_OTHER,
+	KLP_STUCK_MAX,
+};
+
+static atomic_t klp_stuck[KLP_STUCK_MAX];
+
+/* Tasks being checked by klp_check_tasks_fn() */
+static struct task_struct **klp_check_tasks;
+static unsigned int klp_check_nr;
+static atomic_t klp_check_next;
+
 /*
  * This work can be performed periodically to finish patching or unpatching any
  * "straggler" tasks which failed to transition in the first attempt.
@@ -240,12 +267,13 @@ static int klp_check_stack_func(struct klp_func *func, unsigned long *entries,
  */
 static int klp_check_stack(struct task_struct *task, const char **oldname)
 {
-	static unsigned long entries[MAX_STACK_ENTRIES];
+	/* task_call_func() keeps interrupts disabled */
+	unsigned long *entries = this_cpu_ptr(klp_stack_entries);
 	struct klp_object *obj;
 	struct klp_func *func;
 	int ret, nr_entries;
 
-	ret = stack_trace_save_tsk_reliable(task, entries, ARRAY_SIZE(entries));
+	ret = stack_trace_save_tsk_reliable(task, entries, MAX_STACK_ENTRIES);
 	if (ret < 0)
 		return -EINVAL;
 	nr_entries = ret;
@@ -267,14 +295,31 @@ static int klp_check_stack(struct task_struct *task, const char **oldname)
 
 static int klp_check_and_switch_task(struct task_struct *task, void *arg)
 {
+	const char **oldname = arg;
+	unsigned long switches;
 	int ret;
 
 	if (task_curr(task) && task != current)
 		return -EBUSY;
 
+	/*
+	 * A task which hasn't been scheduled since its stack was last found
+	 * not to be switchable still has the same stack, so don't walk it
+	 * again.  Only failures are cached, which keeps this safe when the
+	 * set of patched objects changes under the transition.
+	 */
+	switches = task->nvcsw + task->nivcsw + 1;
+	if (task->patch_check_switches == switches && task != current) {
+		*oldname = task->patch_check_func;
+		return task->patch_check_func ? -EADDRINUSE : -EINVAL;
+	}
+
 	ret = klp_check_stack(task, arg);
-	if (ret)
+	if (ret) {
+		task->patch_check_switches = switches;
+		task->patch_check_func = ret == -EADDRINUSE ? *oldname : NULL;
 		return ret;
+	}
 
 	clear_tsk_thread_flag(task, TIF_PATCH_PENDING);
 	task->patch_state = klp_target_state;
@@ -299,8 +344,10 @@ static bool klp_try_switch_task(struct task_struct *task)
 	 * For arches which don't have reliable stack traces, we have to rely
 	 * on other methods (e.g., switching tasks at kernel exit).
 	 */
-	if (!klp_have_reliable_stack())
+	if (!klp_have_reliable_stack()) {
+		atomic_inc(&klp_stuck[KLP_STUCK_UNRELIABLE]);
 		return false;
+	}
 
 	/*
 	 * Now try to check the stack for any to-be-patched or to-be-unpatched
@@ -315,19 +362,23 @@ static bool klp_try_switch_task(struct task_struct *task)
 	case -EBUSY:	/* klp_check_and_switch_task() */
 		pr_debug("%s: %s:%d is running\n",
 			 __func__, task->comm, task->pid);
+		atomic_inc(&klp_stuck[KLP_STUCK_RUNNING]);
 		break;
 	case -EINVAL:	/* klp_check_and_switch_task() */
 		pr_debug("%s: %s:%d has an unreliable stack\n",
 			 __func__, task->comm, task->pid);
+		atomic_inc(&klp_stuck[KLP_STUCK_UNRELIABLE]);
 		break;
 	case -EADDRINUSE: /* klp_check_and_switch_task() */
 		pr_debug("%s: %s:%d is sleeping on function %s\n",
 			 __func__, task->comm, task->pid, old_name);
+		atomic_inc(&klp_stuck[KLP_STUCK_SLEEPING]);
 		break;
 
 	default:
 		pr_debug("%s: Unknown error code (%d) when trying to switch %s:%d\n",
 			 __func__, ret, task->comm, task->pid);
+		atomic_inc(&klp_stuck[KLP_STUCK_OTHER]);
 		break;
 	}
 
@@ -373,6 +424,86 @@ static void klp_send_signals(void)
 	read_unlock(&tasklist_lock);
 }
 
+static void klp_check_tasks_fn(struct work_struct *work)
+{
+	unsigned int i;
+
+	while ((i = atomic_fetch_inc(&klp_check_next)) < klp_check_nr)
+		klp_try_switch_task(klp_check_tasks[i]);
+}
+
+/* Switch the normal tasks, returns false if some couldn't be switched. */
+static bool klp_try_switch_tasks_serial(void)
+{
+	struct task_struct *g, *task;
+	bool complete = true;
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, task)
+		if (!klp_try_switch_task(task))
+			complete = false;
+	read_unlock(&tasklist_lock);
+
+	return complete;
+}
+
+/* Ditto, with the stacks checked on all CPUs. */
+static bool klp_try_switch_tasks_parallel(void)
+{
+	struct task_struct *g, *task;
+	struct task_struct **tasks;
+	unsigned int max, nr = 0, i;
+	bool complete = true;
+
+	/* Leave some room for the tasks forked meanwhile */
+	max = READ_ONCE(nr_threads) + num_online_cpus();
+	tasks = kvmalloc_array(max, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks)
+		return klp_try_switch_tasks_serial();
+
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, task) {
+		if (task->patch_state == klp_target_state)
+			continue;
+		/* The ones which don't fit are caught by the check below */
+		if (nr == max)
+			break;
+		get_task_struct(task);
+		tasks[nr++] = task;
+	}
+	read_unlock(&tasklist_lock);
+
+	klp_check_tasks = tasks;
+	klp_check_nr = nr;
+	atomic_set(&klp_check_next, 0);
+
+	/* Falls back to doing it all here if the works can't be queued */
+	schedule_on_each_cpu(klp_check_tasks_fn);
+	klp_check_tasks_fn(NULL);
+
+	for (i = 0; i < nr; i++)
+		put_task_struct(tasks[i]);
+	kvfree(tasks);
+	klp_check_tasks = NULL;
+	klp_check_nr = 0;
+
+	/*
+	 * The tasks weren't switched under tasklist_lock, so a child forked
+	 * meanwhile may have copied the initial state of its parent. Such a
+	 * child is on the task list by now.
+	 */
+	read_lock(&tasklist_lock);
+	for_each_process_thread(g, task) {
+		if (task->patch_state != klp_target_state) {
+			complete = false;
+			break;
+		}
+	}
+	read_unlock(&tasklist_lock);
+
+	return complete;
+}
+
 /*
  * Try to switch all remaining tasks to the target patch state by walking the
  * stacks of sleeping tasks and looking for any to-be-patched or
@@ -384,12 +515,16 @@ static void klp_send_signals(void)
 void klp_try_complete_transition(void)
 {
 	unsigned int cpu;
-	struct task_struct *g, *task;
+	struct task_struct *task;
 	struct klp_patch *patch;
-	bool complete = true;
+	bool complete;
+	int i;
 
 	WARN_ON_ONCE(klp_target_state == KLP_UNDEFINED);
 
+	for (i = 0; i < KLP_STUCK_MAX; i++)
+		atomic_set(&klp_stuck[i], 0);
+
 	/*
 	 * Try to switch the tasks to the target patch state by walking their
 	 * stacks and looking for any to-be-patched or to-be-unpatched
@@ -398,12 +533,14 @@ void klp_try_complete_transition(void)
 	 *
 	 * Usually this will transition most (or all) of the tasks on a system
 	 * unless the patch includes changes to a very common function.
+	 *
+	 * On big systems, spread the stack checks over the CPUs.
 	 */
-	read_lock(&tasklist_lock);
-	for_each_process_thread(g, task)
-		if (!klp_try_switch_task(task))
-			complete = false;
-	read_unlock(&tasklist_lock);
+	if (READ_ONCE(nr_threads) >= KLP_PARALLEL_MIN_TASKS &&
+	    num_online_cpus() > 1 && klp_have_reliable_stack())
+		complete = klp_try_switch_tasks_parallel();
+	else
+		complete = klp_try_switch_tasks_serial();
 
 	/*
 	 * Ditto for the idle "swapper" tasks.
@@ -426,6 +563,13 @@ void klp_try_complete_transition(void)
 	cpus_read_unlock();
 
 	if (!complete) {
+		trace_klp_transition_stuck(klp_transition_patch->mod->name,
+					   klp_target_state,
+					   atomic_read(&klp_stuck[KLP_STUCK_RUNNING]),
+					   atomic_read(&klp_stuck[KLP_STUCK_UNRELIABLE]),
+					   atomic_read(&klp_stuck[KLP_STUCK_SLEEPING]),
+					   atomic_read(&klp_stuck[KLP_STUCK_OTHER]));
+
 		if (klp_signals_cnt && !(klp_signals_cnt % SIGNALS_TIMEOUT))
 			klp_send_signals();
 		klp_signals_cnt++;
@@ -476,9 +620,11 @@ void klp_start_transition(void)
 	 * kernel.
 	 */
 	read_lock(&tasklist_lock);
-	for_each_process_thread(g, task)
+	for_each_process_thread(g, task) {
+		task->patch_check_switches = 0;
 		if (task->patch_state != klp_target_state)
 			set_tsk_thread_flag(task, TIF_PATCH_PENDING);
+	}
 	read_unlock(&tasklist_lock);
 
 	/*
@@ -488,6 +634,7 @@ void klp_start_transition(void)
 	 */
 	for_each_possible_cpu(cpu) {
 		task = idle_task(cpu);
+		task->patch_check_switches = 0;
 		if (task->patch_state != klp_target_state)
 			set_tsk_thread_flag(task, TIF_PATCH_PENDING);
 	}
@@ -627,6 +774,7 @@ void klp_copy_process(struct task_struct *child)
 		clear_tsk_thread_flag(child, TIF_PATCH_PENDING);
 
 	child->patch_state = current->patch_state;
+	child->patch_check_switches = 0;
 }
 
 /*
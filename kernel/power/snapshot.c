@@ -1445,27 +1445,59 @@ static inline void copy_data_page(unsigned long dst_pfn, unsigned long src_pfn)
 }
 #endif /* CONFIG_HIGHMEM */
 
-static void copy_data_pages(struct memory_bitmap *copy_bm,
-			    struct memory_bitmap *orig_bm)
+/**
+ * mark_saveable_pages - Mark and count the saveable pages in one pass.
+ * @orig_bm: Bitmap to mark the saveable page frames in.
+ * @nr_normal: Return the number of saveable non-highmem pages.
+ * @nr_highmem: Return the number of saveable highmem pages.
+ *
+ * This is count_data_pages() and count_highmem_pages() with the bits set as
+ * they are found, so that copy_data_pages() doesn't need to walk all of the
+ * page frames again with interrupts off.
+ */
+static void mark_saveable_pages(struct memory_bitmap *orig_bm,
+				unsigned int *nr_normal,
+				unsigned int *nr_highmem)
 {
 	struct zone *zone;
-	unsigned long pfn;
+	unsigned long pfn, max_zone_pfn;
+
+	*nr_normal = 0;
+	*nr_highmem = 0;
 
 	for_each_populated_zone(zone) {
-		unsigned long max_zone_pfn;
+		unsigned int *n = is_highmem(zone) ? nr_highmem : nr_normal;
 
 		mark_free_pages(zone);
 		max_zone_pfn = zone_end_pfn(zone);
-		for (pfn = zone->zone_start_pfn; pfn < max_zone_pfn; pfn++)
-			if (page_is_saveable(zone, pfn))
+		for (pfn = zone->zone_start_pfn; pfn < max_zone_pfn; pfn++) {
+			if (page_is_saveable(zone, pfn)) {
 				memory_bm_set_bit(orig_bm, pfn);
+				(*n)++;
+			}
+		}
 	}
+}
+
+static void copy_data_pages(struct memory_bitmap *copy_bm,
+			    struct memory_bitmap *orig_bm)
+{
+	unsigned long pfn;
+
 	memory_bm_position_reset(orig_bm);
 	memory_bm_position_reset(copy_bm);
 	for(;;) {
 		pfn = memory_bm_next_pfn(orig_bm);
 		if (unlikely(pfn == BM_END_OF_MAP))
 			break;
+		/*
+		 * Pages allocated by swsusp_alloc() after being marked are
+		 * forbidden now, they must not be saved.
+		 */
+		if (unlikely(swsusp_page_is_forbidden(pfn_to_page(pfn)))) {
+			memory_bm_clear_current(orig_bm);
+			continue;
+		}
 		copy_data_page(memory_bm_next_pfn(copy_bm), pfn);
 	}
 }
@@ -2018,8 +2050,7 @@ asmlinkage __visible int swsusp_save(void)
 	pr_info("Creating image:\n");
 
 	drain_local_pages(NULL);
-	nr_pages = count_data_pages();
-	nr_highmem = count_highmem_pages();
+	mark_saveable_pages(&orig_bm, &nr_pages, &nr_highmem);
 	pr_info("Need to copy %u pages\n", nr_pages + nr_highmem);
 
 	if (!enough_free_mem(nr_pages, nr_highmem)) {
@@ -2032,11 +2063,6 @@ asmlinkage __visible int swsusp_save(void)
 		return -ENOMEM;
 	}
 
-	/*
-	 * During allocating of suspend pagedir, new cold pages may appear.
-	 * Kill them.
-	 */
-	drain_local_pages(NULL);
 	copy_data_pages(&copy_bm, &orig_bm);
 
 	/*
@@ -24,6 +24,8 @@
 #include <linux/pm.h>
 #include <linux/slab.h>
 #include <linux/lzo.h>
+#include <linux/lz4.h>
+#include <linux/moduleparam.h>
 #include <linux/vmalloc.h>
 #include <linux/cpumask.h>
 #include <linux/atomic.h>
@@ -45,6 +47,47 @@ u32 swsusp_hardware_signature;
 static bool clean_pages_on_read;
 static bool clean_pages_on_decompress;
 
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "hibernate."
+
+/*
+ * Compressor used for writing the image, the one used for reading it is
+ * recorded in the image header.
+ */
+static bool hib_use_lz4;
+
+static int hib_compressor_set(const char *val, const struct kernel_param *kp)
+{
+	if (sysfs_streq(val, "lzo")) {
+		hib_use_lz4 = false;
+	} else if (sysfs_streq(val, "lz4") &&
+		   IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4)) {
+		hib_use_lz4 = true;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int hib_compressor_get(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%s\n", hib_use_lz4 ? "lz4" : "lzo");
+}
+
+static const struct kernel_param_ops hib_compressor_ops = {
+	.set = hib_compressor_set,
+	.get = hib_compressor_get,
+};
+module_param_cb(compressor, &hib_compressor_ops, NULL, 0644);
+MODULE_PARM_DESC(compressor, "Image compressor, lzo or lz4");
+
+/* 0 means one thread per online CPU but the current one. */
+static unsigned int hib_compression_threads;
+module_param_named(compression_threads, hib_compression_threads, uint, 0644);
+MODULE_PARM_DESC(compression_threads,
+		 "Number of image (de)compression threads, 0 for automatic");
+
 /*
  *	The swap map is a data structure used for keeping track of each page
  *	written to a swap partition.  It consists of many swap_map_page
@@ -525,12 +568,35 @@ static int swap_writer_finish(struct swap_map_handle *handle,
 			             LZO_HEADER, PAGE_SIZE)
 #define LZO_CMP_SIZE	(LZO_CMP_PAGES * PAGE_SIZE)
 
+/* Compression workspace, large enough for either compressor. */
+#define LZO_WRK_SIZE	(LZO1X_1_MEM_COMPRESS > LZ4_MEM_COMPRESS ? \
+			 LZO1X_1_MEM_COMPRESS : LZ4_MEM_COMPRESS)
+
 /* Maximum number of threads for compression/decompression. */
-#define LZO_THREADS	3
+#define LZO_THREADS	32
 
-/* Minimum/maximum number of pages for read buffering. */
+/*
+ * Minimum/maximum number of pages for read buffering. The maximum is for
+ * every LZO_RD_THREADS threads, so that more threads don't starve.
+ */
 #define LZO_MIN_RD_PAGES	1024
 #define LZO_MAX_RD_PAGES	8192
+#define LZO_RD_THREADS		3
+
+static unsigned int hib_nr_threads(void)
+{
+	unsigned int nr_threads = hib_compression_threads;
+
+	if (!nr_threads)
+		nr_threads = num_online_cpus() - 1;
+
+	return clamp_val(nr_threads, 1, LZO_THREADS);
+}
+
+static unsigned long hib_max_rd_pages(unsigned int nr_threads)
+{
+	return LZO_MAX_RD_PAGES * DIV_ROUND_UP(nr_threads, LZO_RD_THREADS);
+}
 
 
 /**
@@ -624,22 +690,42 @@ static int crc32_threadfn(void *data)
 	return 0;
 }
 /**
- * Structure used for LZO data compression.
+ * Structure used for LZO/LZ4 data compression.
  */
 struct cmp_data {
 	struct task_struct *thr;                  /* thread */
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	int ret;                                  /* return code */
+	bool lz4;                                 /* use LZ4 instead of LZO */
 	wait_queue_head_t go;                     /* start compression */
 	wait_queue_head_t done;                   /* compression done */
 	size_t unc_len;                           /* uncompressed length */
 	size_t cmp_len;                           /* compressed length */
 	unsigned char unc[LZO_UNC_SIZE];          /* uncompressed buffer */
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
-	unsigned char wrk[LZO1X_1_MEM_COMPRESS];  /* compression workspace */
+	unsigned char wrk[LZO_WRK_SIZE];          /* compression workspace */
 };
 
+static int hib_compress(struct cmp_data *d)
+{
+	int len;
+
+	if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) || !d->lz4)
+		return lzo1x_1_compress(d->unc, d->unc_len,
+					d->cmp + LZO_HEADER, &d->cmp_len,
+					d->wrk);
+
+	/* The LZ4 bound is below the LZO one LZO_CMP_SIZE is made for */
+	len = LZ4_compress_default(d->unc, d->cmp + LZO_HEADER, d->unc_len,
+				   LZO_CMP_SIZE - LZO_HEADER, d->wrk);
+	if (len <= 0)
+		return -1;
+
+	d->cmp_len = len;
+	return 0;
+}
+
 /**
  * Compression function that runs in its own thread.
  */
@@ -659,9 +745,7 @@ static int lzo_compress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->ret = lzo1x_1_compress(d->unc, d->unc_len,
-		                          d->cmp + LZO_HEADER, &d->cmp_len,
-		                          d->wrk);
+		d->ret = hib_compress(d);
 		atomic_set_release(&d->stop, 1);
 		wake_up(&d->done);
 	}
@@ -669,14 +753,15 @@ static int lzo_compress_threadfn(void *data)
 }
 
 /**
- * save_image_lzo - Save the suspend image data compressed with LZO.
+ * save_image_lzo - Save the suspend image data compressed with LZO or LZ4.
  * @handle: Swap map handle to use for saving the image.
  * @snapshot: Image to read data from.
  * @nr_to_write: Number of pages to save.
+ * @lz4: Compress with LZ4 instead of LZO.
  */
 static int save_image_lzo(struct swap_map_handle *handle,
                           struct snapshot_handle *snapshot,
-                          unsigned int nr_to_write)
+                          unsigned int nr_to_write, bool lz4)
 {
 	unsigned int m;
 	int ret = 0;
@@ -697,8 +782,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	 * We'll limit the number of threads for compression to limit memory
 	 * footprint.
 	 */
-	nr_threads = num_online_cpus() - 1;
-	nr_threads = clamp_val(nr_threads, 1, LZO_THREADS);
+	nr_threads = hib_nr_threads();
 
 	page = (void *)__get_free_page(GFP_NOIO | __GFP_HIGH);
 	if (!page) {
@@ -727,6 +811,7 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	for (thr = 0; thr < nr_threads; thr++) {
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
+		data[thr].lz4 = lz4;
 
 		data[thr].thr = kthread_run(lzo_compress_threadfn,
 		                            &data[thr],
@@ -766,7 +851,8 @@ static int save_image_lzo(struct swap_map_handle *handle,
 	 */
 	handle->reqd_free_pages = reqd_free_pages();
 
-	pr_info("Using %u thread(s) for compression\n", nr_threads);
+	pr_info("Using %u thread(s) for %s compression\n", nr_threads,
+		lz4 ? "LZ4" : "LZO");
 	pr_info("Compressing and saving image data (%u pages)...\n",
 		nr_to_write);
 	m = nr_to_write / 10;
@@ -816,14 +902,14 @@ static int save_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				pr_err("LZO compression failed\n");
+				pr_err("Image compression failed\n");
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].cmp_len ||
 			             data[thr].cmp_len >
 			             lzo1x_worst_compress(data[thr].unc_len))) {
-				pr_err("Invalid LZO compressed length\n");
+				pr_err("Invalid compressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -938,10 +1024,13 @@ int swsusp_write(unsigned int flags)
 	}
 	header = (struct swsusp_info *)data_of(snapshot);
 	error = swap_write_page(&handle, header, NULL);
+	if (!(flags & SF_NOCOMPRESS_MODE) && READ_ONCE(hib_use_lz4))
+		flags |= SF_COMPRESSION_ALG_LZ4;
 	if (!error) {
 		error = (flags & SF_NOCOMPRESS_MODE) ?
 			save_image(&handle, &snapshot, pages - 1) :
-			save_image_lzo(&handle, &snapshot, pages - 1);
+			save_image_lzo(&handle, &snapshot, pages - 1,
+				       flags & SF_COMPRESSION_ALG_LZ4);
 	}
 out_finish:
 	error = swap_writer_finish(&handle, flags, error);
@@ -1108,13 +1197,14 @@ static int load_image(struct swap_map_handle *handle,
 }
 
 /**
- * Structure used for LZO data decompression.
+ * Structure used for LZO/LZ4 data decompression.
  */
 struct dec_data {
 	struct task_struct *thr;                  /* thread */
 	atomic_t ready;                           /* ready to start flag */
 	atomic_t stop;                            /* ready to stop flag */
 	int ret;                                  /* return code */
+	bool lz4;                                 /* use LZ4 instead of LZO */
 	wait_queue_head_t go;                     /* start decompression */
 	wait_queue_head_t done;                   /* decompression done */
 	size_t unc_len;                           /* uncompressed length */
@@ -1123,6 +1213,24 @@ struct dec_data {
 	unsigned char cmp[LZO_CMP_SIZE];          /* compressed buffer */
 };
 
+static int hib_decompress(struct dec_data *d)
+{
+	int len;
+
+	d->unc_len = LZO_UNC_SIZE;
+	if (!IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4) || !d->lz4)
+		return lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
+					     d->unc, &d->unc_len);
+
+	len = LZ4_decompress_safe(d->cmp + LZO_HEADER, d->unc, d->cmp_len,
+				  LZO_UNC_SIZE);
+	if (len < 0)
+		return -1;
+
+	d->unc_len = len;
+	return 0;
+}
+
 /**
  * Decompression function that runs in its own thread.
  */
@@ -1142,9 +1250,7 @@ static int lzo_decompress_threadfn(void *data)
 		}
 		atomic_set(&d->ready, 0);
 
-		d->unc_len = LZO_UNC_SIZE;
-		d->ret = lzo1x_decompress_safe(d->cmp + LZO_HEADER, d->cmp_len,
-		                               d->unc, &d->unc_len);
+		d->ret = hib_decompress(d);
 		if (clean_pages_on_decompress)
 			flush_icache_range((unsigned long)d->unc,
 					   (unsigned long)d->unc + d->unc_len);
@@ -1156,14 +1262,15 @@ static int lzo_decompress_threadfn(void *data)
 }
 
 /**
- * load_image_lzo - Load compressed image data and decompress them with LZO.
+ * load_image_lzo - Load compressed image data and decompress them.
  * @handle: Swap map handle to use for loading data.
  * @snapshot: Image to copy uncompressed data into.
  * @nr_to_read: Number of pages to load.
+ * @lz4: The image was compressed with LZ4 instead of LZO.
  */
 static int load_image_lzo(struct swap_map_handle *handle,
                           struct snapshot_handle *snapshot,
-                          unsigned int nr_to_read)
+                          unsigned int nr_to_read, bool lz4)
 {
 	unsigned int m;
 	int ret = 0;
@@ -1176,21 +1283,26 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	unsigned i, thr, run_threads, nr_threads;
 	unsigned ring = 0, pg = 0, ring_size = 0,
 	         have = 0, want, need, asked = 0;
-	unsigned long read_pages = 0;
+	unsigned long read_pages = 0, max_rd_pages;
 	unsigned char **page = NULL;
 	struct dec_data *data = NULL;
 	struct crc_data *crc = NULL;
 
 	hib_init_batch(&hb);
 
+	if (lz4 && !IS_ENABLED(CONFIG_HIBERNATION_COMP_LZ4)) {
+		pr_err("Image is LZ4 compressed, LZ4 support not built in\n");
+		return -EINVAL;
+	}
+
 	/*
 	 * We'll limit the number of threads for decompression to limit memory
 	 * footprint.
 	 */
-	nr_threads = num_online_cpus() - 1;
-	nr_threads = clamp_val(nr_threads, 1, LZO_THREADS);
+	nr_threads = hib_nr_threads();
+	max_rd_pages = hib_max_rd_pages(nr_threads);
 
-	page = vmalloc(array_size(LZO_MAX_RD_PAGES, sizeof(*page)));
+	page = vmalloc(array_size(max_rd_pages, sizeof(*page)));
 	if (!page) {
 		pr_err("Failed to allocate LZO page\n");
 		ret = -ENOMEM;
@@ -1219,6 +1331,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	for (thr = 0; thr < nr_threads; thr++) {
 		init_waitqueue_head(&data[thr].go);
 		init_waitqueue_head(&data[thr].done);
+		data[thr].lz4 = lz4;
 
 		data[thr].thr = kthread_run(lzo_decompress_threadfn,
 		                            &data[thr],
@@ -1261,7 +1374,7 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	 */
 	if (low_free_pages() > snapshot_get_image_size())
 		read_pages = (low_free_pages() - snapshot_get_image_size()) / 2;
-	read_pages = clamp_val(read_pages, LZO_MIN_RD_PAGES, LZO_MAX_RD_PAGES);
+	read_pages = clamp_val(read_pages, LZO_MIN_RD_PAGES, max_rd_pages);
 
 	for (i = 0; i < read_pages; i++) {
 		page[i] = (void *)__get_free_page(i < LZO_CMP_PAGES ?
@@ -1282,7 +1395,8 @@ static int load_image_lzo(struct swap_map_handle *handle,
 	}
 	want = ring_size = i;
 
-	pr_info("Using %u thread(s) for decompression\n", nr_threads);
+	pr_info("Using %u thread(s) for %s decompression\n", nr_threads,
+		lz4 ? "LZ4" : "LZO");
 	pr_info("Loading and decompressing image data (%u pages)...\n",
 		nr_to_read);
 	m = nr_to_read / 10;
@@ -1395,14 +1509,14 @@ static int load_image_lzo(struct swap_map_handle *handle,
 			ret = data[thr].ret;
 
 			if (ret < 0) {
-				pr_err("LZO decompression failed\n");
+				pr_err("Image decompression failed\n");
 				goto out_finish;
 			}
 
 			if (unlikely(!data[thr].unc_len ||
 			             data[thr].unc_len > LZO_UNC_SIZE ||
 			             data[thr].unc_len & (PAGE_SIZE - 1))) {
-				pr_err("Invalid LZO uncompressed length\n");
+				pr_err("Invalid uncompressed length\n");
 				ret = -1;
 				goto out_finish;
 			}
@@ -1499,7 +1613,8 @@ int swsusp_read(unsigned int *flags_p)
 	if (!error) {
 		error = (*flags_p & SF_NOCOMPRESS_MODE) ?
 			load_image(&handle, &snapshot, header->pages - 1) :
-			load_image_lzo(&handle, &snapshot, header->pages - 1);
+			load_image_lzo(&handle, &snapshot, header->pages - 1,
+				       *flags_p & SF_COMPRESSION_ALG_LZ4);
 	}
 	swap_reader_finish(&handle);
 end:
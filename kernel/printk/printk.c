@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -2145,6 +2146,289 @@ static u16 printk_sprint(char *text, u16 size, int facility,
 	return text_len;
 }
 
+#ifdef CONFIG_PRINTK_PERCPU_STAGE
+/*
+ * Per-CPU staging of printk records
+ *
+ * prb_reserve() moves the head ids of the shared ringbuffer with cmpxchg, so
+ * many CPUs printing at once keep bouncing those cache lines.  Ordinary
+ * messages are instead formatted into a small ring of the local CPU, which
+ * only that CPU writes to and only with interrupts disabled.  A lazy irq_work
+ * then merges the staged records of all CPUs into the ringbuffer in one
+ * batch, oldest timestamp first.  The records keep the timestamp and caller
+ * id of the printk() call, so their exact order stays reconstructable from
+ * ts_nsec by /dev/kmsg readers.
+ *
+ * Continuation lines, messages of LOGLEVEL_ERR and more severe ones, NMI
+ * context and messages not fitting a slot are stored directly, after this
+ * CPU's staged records were merged, so that the messages of a CPU stay in
+ * order.  Only the holder of printk_stage_lock consumes staged records, at
+ * most one batch at a time so that CPUs waiting for it to merge their own
+ * records before a direct store don't spin for long.
+ */
+#define PRINTK_STAGE_SLOTS	16
+#define PRINTK_STAGE_TEXT	256
+/* Records merged per flush, so that waiting for printk_stage_lock is bounded */
+#define PRINTK_STAGE_FLUSH_MAX	(PRINTK_STAGE_SLOTS * num_possible_cpus())
+
+struct printk_stage_rec {
+	u64 ts_nsec;
+	u32 caller_id;
+	u16 text_len;
+	u8 facility;
+	u8 level;
+	u8 flags;
+	bool has_dev_info;
+	struct dev_printk_info dev_info;
+	char text[PRINTK_STAGE_TEXT];
+};
+
+struct printk_stage {
+	unsigned int head;	/* written by the owning CPU */
+	unsigned int tail;	/* written under printk_stage_lock */
+	struct irq_work flush_work;
+	struct printk_stage_rec recs[PRINTK_STAGE_SLOTS];
+};
+
+static struct printk_stage __percpu *printk_stages;
+static DEFINE_RAW_SPINLOCK(printk_stage_lock);
+
+static void printk_stage_commit(struct printk_stage_rec *sr)
+{
+	struct prb_reserved_entry e;
+	struct printk_record r;
+
+	prb_rec_init_wr(&r, sr->text_len);
+	if (!prb_reserve(&e, prb, &r))
+		return;
+
+	memcpy(&r.text_buf[0], sr->text, sr->text_len);
+	r.info->text_len = sr->text_len;
+	r.info->facility = sr->facility;
+	r.info->level = sr->level;
+	r.info->flags = sr->flags;
+	r.info->ts_nsec = sr->ts_nsec;
+	r.info->caller_id = sr->caller_id;
+	if (sr->has_dev_info)
+		memcpy(&r.info->dev_info, &sr->dev_info, sizeof(r.info->dev_info));
+
+	/* A message without a trailing newline can be continued. */
+	if (!(sr->flags & LOG_NEWLINE))
+		prb_commit(&e);
+	else
+		prb_final_commit(&e);
+}
+
+/* Must be called with printk_stage_lock held. */
+static void __printk_stage_flush_cpu(struct printk_stage *st)
+{
+	/* Pairs with the release in printk_stage_store(). */
+	while (smp_load_acquire(&st->head) != st->tail) {
+		printk_stage_commit(&st->recs[st->tail % PRINTK_STAGE_SLOTS]);
+		smp_store_release(&st->tail, st->tail + 1);
+	}
+}
+
+/*
+ * Merge up to PRINTK_STAGE_FLUSH_MAX records, oldest first. Must be called
+ * with printk_stage_lock held.
+ */
+static unsigned int __printk_stage_flush(void)
+{
+	struct printk_stage *st, *oldest;
+	struct printk_stage_rec *sr;
+	unsigned int nr = 0;
+	u64 oldest_ts = 0;
+	int cpu;
+
+	while (nr < PRINTK_STAGE_FLUSH_MAX) {
+		oldest = NULL;
+		for_each_possible_cpu(cpu) {
+			st = per_cpu_ptr(printk_stages, cpu);
+			/* Pairs with the release in printk_stage_store(). */
+			if (smp_load_acquire(&st->head) == st->tail)
+				continue;
+			sr = &st->recs[st->tail % PRINTK_STAGE_SLOTS];
+			if (!oldest || sr->ts_nsec < oldest_ts) {
+				oldest = st;
+				oldest_ts = sr->ts_nsec;
+			}
+		}
+		if (!oldest)
+			break;
+
+		printk_stage_commit(&oldest->recs[oldest->tail %
+						  PRINTK_STAGE_SLOTS]);
+		/* Hand the slot back only once it has been copied. */
+		smp_store_release(&oldest->tail, oldest->tail + 1);
+		nr++;
+	}
+	return nr;
+}
+
+/*
+ * Merge the staged records of all CPUs into the ringbuffer. Returns false if
+ * another context is merging already, in which case nothing was done.
+ */
+static bool printk_stage_flush(unsigned int *nr)
+{
+	unsigned long flags;
+
+	if (!READ_ONCE(printk_stages))
+		return true;
+	if (!raw_spin_trylock_irqsave(&printk_stage_lock, flags))
+		return false;
+	*nr = __printk_stage_flush();
+	raw_spin_unlock_irqrestore(&printk_stage_lock, flags);
+	return true;
+}
+
+static void printk_stage_flush_all(void)
+{
+	unsigned int nr;
+
+	do {
+		nr = 0;
+	} while (printk_stage_flush(&nr) && nr == PRINTK_STAGE_FLUSH_MAX);
+}
+
+static void printk_stage_flush_work(struct irq_work *work)
+{
+	unsigned int nr = 0;
+
+	/*
+	 * Retry on the next tick if the current flusher may have missed ours,
+	 * or if there was more than one batch to merge.
+	 */
+	if (!printk_stage_flush(&nr) || nr == PRINTK_STAGE_FLUSH_MAX)
+		irq_work_queue(work);
+	if (nr)
+		defer_console_output();
+}
+
+/*
+ * Merge this CPU's staged records before it stores a message directly, so
+ * that its messages stay in order. Must be called with interrupts disabled.
+ */
+static void printk_stage_flush_local(void)
+{
+	struct printk_stage *st = READ_ONCE(printk_stages);
+	unsigned long flags;
+
+	if (!st)
+		return;
+	st = this_cpu_ptr(st);
+	if (READ_ONCE(st->head) == READ_ONCE(st->tail))
+		return;
+
+	/*
+	 * With interrupts off, the holder of the lock is another CPU, which
+	 * is done after one batch. NMIs and a panic can't wait for it though:
+	 * if it is busy, their message goes ahead of the staged ones, which
+	 * ts_nsec still orders correctly.
+	 */
+	if (in_nmi() || panic_in_progress()) {
+		if (!raw_spin_trylock_irqsave(&printk_stage_lock, flags))
+			return;
+	} else {
+		raw_spin_lock_irqsave(&printk_stage_lock, flags);
+	}
+
+	__printk_stage_flush();
+	/* What the batch did not get to goes in now, still in order */
+	__printk_stage_flush_cpu(st);
+	raw_spin_unlock_irqrestore(&printk_stage_lock, flags);
+}
+
+/*
+ * Try to format the message into a slot of this CPU's stage instead of the
+ * ringbuffer. Must be called with interrupts disabled. Returns the stored
+ * length, or -1 if the message needs to be stored directly.
+ */
+__printf(8, 0)
+static int printk_stage_store(int facility, int level,
+			      enum printk_info_flags flags,
+			      const struct dev_printk_info *dev_info,
+			      u64 ts_nsec, u32 caller_id, u16 reserve_size,
+			      const char *fmt, va_list args)
+{
+	struct printk_stage *st = READ_ONCE(printk_stages);
+	struct printk_stage_rec *sr;
+	unsigned int head, nr = 0;
+	va_list args2;
+	u16 text_len;
+
+	if (!st || in_nmi() || panic_in_progress())
+		return -1;
+	if ((flags & LOG_CONT) || level <= LOGLEVEL_ERR ||
+	    reserve_size > PRINTK_STAGE_TEXT)
+		return -1;
+
+	st = this_cpu_ptr(st);
+	head = st->head;
+	/* Pairs with the release in __printk_stage_flush(). */
+	if (head - smp_load_acquire(&st->tail) >= PRINTK_STAGE_SLOTS) {
+		printk_stage_flush(&nr);
+		if (head - smp_load_acquire(&st->tail) >= PRINTK_STAGE_SLOTS)
+			return -1;
+	}
+
+	sr = &st->recs[head % PRINTK_STAGE_SLOTS];
+	va_copy(args2, args);
+	text_len = printk_sprint(&sr->text[0], reserve_size, facility, &flags,
+				 fmt, args2);
+	va_end(args2);
+
+	sr->text_len = text_len;
+	sr->facility = facility;
+	sr->level = level & 7;
+	sr->flags = flags & 0x1f;
+	sr->ts_nsec = ts_nsec;
+	sr->caller_id = caller_id;
+	sr->has_dev_info = !!dev_info;
+	if (dev_info)
+		memcpy(&sr->dev_info, dev_info, sizeof(sr->dev_info));
+
+	/* Publish the record to the flusher. */
+	smp_store_release(&st->head, head + 1);
+	irq_work_queue(&st->flush_work);
+
+	return text_len;
+}
+
+static int __init printk_stage_init(void)
+{
+	struct printk_stage __percpu *stages;
+	int cpu;
+
+	stages = alloc_percpu(struct printk_stage);
+	if (!stages)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct printk_stage *st = per_cpu_ptr(stages, cpu);
+
+		st->flush_work = IRQ_WORK_INIT_LAZY(printk_stage_flush_work);
+	}
+	smp_store_release(&printk_stages, stages);
+	return 0;
+}
+early_initcall(printk_stage_init);
+#else /* !CONFIG_PRINTK_PERCPU_STAGE */
+static inline void printk_stage_flush_all(void) { }
+static inline void printk_stage_flush_local(void) { }
+
+static inline int printk_stage_store(int facility, int level,
+				     enum printk_info_flags flags,
+				     const struct dev_printk_info *dev_info,
+				     u64 ts_nsec, u32 caller_id,
+				     u16 reserve_size, const char *fmt,
+				     va_list args)
+{
+	return -1;
+}
+#endif /* CONFIG_PRINTK_PERCPU_STAGE */
+
 __printf(4, 0)
 int vprintk_store(int facility, int level,
 		  const struct dev_printk_info *dev_info,
@@ -2200,6 +2484,15 @@ int vprintk_store(int facility, int level,
 	if (dev_info)
 		flags |= LOG_NEWLINE;
 
+	ret = printk_stage_store(facility, level, flags, dev_info, ts_nsec,
+				 caller_id, reserve_size, fmt, args);
+	if (ret >= 0)
+		goto out;
+	ret = 0;
+
+	/* Keep this CPU's messages in order with the ones it staged. */
+	printk_stage_flush_local();
+
 	if (flags & LOG_CONT) {
 		prb_rec_init_wr(&r, reserve_size);
 		if (prb_reserve_in_last(&e, prb, &r, caller_id, LOG_LINE_MAX)) {
@@ -2283,8 +2576,11 @@ asmlinkage int vprintk_emit(int facility, int level,
 
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched) {
+	/*
+	 * If called from the scheduler, we can not call up(). With printer
+	 * threads, never print from the caller's context.
+	 */
+	if (!in_sched && !printk_threaded()) {
 		/*
 		 * The caller may be holding system-critical or
 		 * timing-sensitive locks. Disable preemption during
@@ -2334,6 +2630,7 @@ EXPORT_SYMBOL(_printk);
 
 static bool pr_flush(int timeout_ms, bool reset_on_progress);
 static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progress);
+static bool printk_threaded(void);
 
 #else /* CONFIG_PRINTK */
 
@@ -2347,6 +2644,8 @@ static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progre
 
 static u64 syslog_seq;
 
+static inline void printk_stage_flush_all(void) { }
+
 static size_t record_print_text(const struct printk_record *r,
 				bool syslog, bool time)
 {
@@ -2369,6 +2668,10 @@ static void call_console_driver(struct console *con, const char *text, size_t le
 static bool suppress_message_printing(int level) { return false; }
 static bool pr_flush(int timeout_ms, bool reset_on_progress) { return true; }
 static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progress) { return true; }
+#define printk_kthreads_running	false
+static bool printk_threaded(void) { return false; }
+static void printk_start_kthread(struct console *con) { }
+static void printk_stop_kthread(struct console *con) { }
 
 #endif /* CONFIG_PRINTK */
 
@@ -2863,6 +3166,210 @@ static bool console_flush_all(bool do_cond_resched, u64 *next_seq, bool *handove
 	return any_usable;
 }
 
+#ifdef CONFIG_PRINTK
+/*
+ * Console printer threads
+ *
+ * Once every registered console has a printer thread, printk() and
+ * console_unlock() only wake the threads up instead of writing the pending
+ * records out themselves.  Each thread takes the console_lock, writes the
+ * records of its own console in batches of one ->write() call each and
+ * releases the lock again, so the caller of printk() never waits for a slow
+ * console.  On panic, oops and once the system is going down, the records
+ * are printed directly again by whoever holds the console_lock.
+ */
+#define PRINTK_KTHREAD_BATCH_MAX	(2 * CONSOLE_LOG_MAX)
+
+struct printk_kthread {
+	struct console *con;
+	char text[CONSOLE_LOG_MAX];
+	char batch[PRINTK_KTHREAD_BATCH_MAX];
+	/* ext_text for extended consoles, dropped_text for the others */
+	char buf[];
+};
+
+/* printer threads are started for new consoles */
+static bool printk_kthreads_running;
+/* and all consoles have one */
+static bool printk_kthreads_available;
+
+static bool printk_threaded(void)
+{
+	return READ_ONCE(printk_kthreads_available) && !panic_in_progress() &&
+	       !oops_in_progress && system_state <= SYSTEM_RUNNING;
+}
+
+static bool printer_should_wake(struct console *con)
+{
+	if (kthread_should_stop())
+		return true;
+	if (!printk_threaded() || !(READ_ONCE(con->flags) & CON_ENABLED))
+		return false;
+	return prb_read_valid(prb, READ_ONCE(con->seq), NULL);
+}
+
+static void printk_kthread_write(struct console *con, const char *text,
+				 size_t len, char *dropped_text)
+{
+	unsigned long flags;
+
+	printk_safe_enter_irqsave(flags);
+	stop_critical_timings();	/* don't trace print latency */
+	call_console_driver(con, text, len, dropped_text);
+	start_critical_timings();
+	printk_safe_exit_irqrestore(flags);
+}
+
+/*
+ * Write out all records pending for the console of @pk, batching up to
+ * PRINTK_KTHREAD_BATCH_MAX bytes into each ->write() call. Stops early if the
+ * records should be printed directly instead.
+ *
+ * Requires the console_lock.
+ */
+static void printk_kthread_emit(struct printk_kthread *pk)
+{
+	struct console *con = pk->con;
+	bool extended = con->flags & CON_EXTENDED;
+	char *dropped_text = extended ? NULL : pk->buf;
+	struct printk_info info;
+	struct printk_record r;
+	size_t len, batch_len = 0;
+	char *write_text;
+
+	while (printk_threaded()) {
+		prb_rec_init_rd(&r, &info, pk->text, CONSOLE_LOG_MAX);
+		if (!prb_read_valid(prb, con->seq, &r))
+			break;
+
+		if (con->seq != r.info->seq) {
+			con->dropped += r.info->seq - con->seq;
+			con->seq = r.info->seq;
+		}
+
+		/* Skip record that has level above the console loglevel. */
+		if (suppress_message_printing(r.info->level)) {
+			con->seq++;
+			continue;
+		}
+
+		if (extended) {
+			write_text = pk->buf;
+			len = info_print_ext_header(pk->buf, CONSOLE_EXT_LOG_MAX,
+						    r.info);
+			len += msg_print_ext_body(pk->buf + len,
+						  CONSOLE_EXT_LOG_MAX - len,
+						  &r.text_buf[0], r.info->text_len,
+						  &r.info->dev_info);
+		} else {
+			write_text = pk->text;
+			len = record_print_text(&r,
+					console_msg_format & MSG_FORMAT_SYSLOG,
+					printk_time);
+		}
+
+		if (batch_len + len > PRINTK_KTHREAD_BATCH_MAX) {
+			printk_kthread_write(con, pk->batch, batch_len,
+					     dropped_text);
+			batch_len = 0;
+		}
+		if (len > PRINTK_KTHREAD_BATCH_MAX) {
+			printk_kthread_write(con, write_text, len, dropped_text);
+		} else {
+			memcpy(pk->batch + batch_len, write_text, len);
+			batch_len += len;
+		}
+		con->seq++;
+	}
+
+	if (batch_len)
+		printk_kthread_write(con, pk->batch, batch_len, dropped_text);
+}
+
+static int printk_kthread_func(void *data)
+{
+	struct printk_kthread *pk = data;
+	struct console *con = pk->con;
+	int error;
+
+	for (;;) {
+		error = wait_event_interruptible(log_wait,
+						 printer_should_wake(con));
+		if (kthread_should_stop())
+			break;
+		if (error)
+			continue;
+
+		console_lock();
+		if (!console_suspended && console_is_usable(con))
+			printk_kthread_emit(pk);
+		/* Flushes directly if the threads are not to be used anymore. */
+		console_unlock();
+
+		cond_resched();
+	}
+	return 0;
+}
+
+static void printk_start_kthread(struct console *con)
+{
+	struct printk_kthread *pk;
+	size_t buf_size;
+
+	buf_size = con->flags & CON_EXTENDED ? CONSOLE_EXT_LOG_MAX :
+					       DROPPED_TEXT_MAX;
+	pk = kmalloc(struct_size(pk, buf, buf_size), GFP_KERNEL);
+	if (!pk)
+		goto fail;
+	pk->con = con;
+
+	con->thread = kthread_run(printk_kthread_func, pk, "pr/%s%d",
+				  con->name, con->index);
+	if (IS_ERR(con->thread)) {
+		con->thread = NULL;
+		kfree(pk);
+		goto fail;
+	}
+	return;
+fail:
+	con_printk(KERN_ERR, con, "unable to start printing thread\n");
+	WRITE_ONCE(printk_kthreads_available, false);
+}
+
+/* Must not be called with the console_lock held. */
+static void printk_stop_kthread(struct console *con)
+{
+	struct printk_kthread *pk;
+
+	if (!con->thread)
+		return;
+
+	pk = kthread_data(con->thread);
+	kthread_stop(con->thread);
+	con->thread = NULL;
+	kfree(pk);
+}
+
+static int __init printk_start_kthreads(void)
+{
+	struct console *con;
+	bool available = true;
+
+	console_lock();
+	for_each_console(con) {
+		printk_start_kthread(con);
+		if (!con->thread)
+			available = false;
+	}
+	printk_kthreads_running = true;
+	WRITE_ONCE(printk_kthreads_available, available);
+	console_unlock();
+
+	return 0;
+}
+late_initcall(printk_start_kthreads);
+#endif /* CONFIG_PRINTK */
+
 /**
  * console_unlock - unlock the console system
  *
@@ -2887,6 +3394,13 @@ void console_unlock(void)
 		return;
 	}
 
+	/* The printer threads do the printing. */
+	if (printk_threaded()) {
+		__console_unlock();
+		wake_up_klogd();
+		return;
+	}
+
 	/*
 	 * Console drivers are called with interrupts disabled, so
 	 * @console_may_schedule should be cleared before; however, we may
@@ -2975,6 +3489,9 @@ void console_unblank(void)
  */
 void console_flush_on_panic(enum con_flush_mode mode)
 {
+	/* Records staged by the stopped CPUs are not in the ringbuffer yet. */
+	printk_stage_flush_all();
+
 	/*
 	 * If someone else is holding the console lock, trylock will fail
 	 * and may_schedule may be set.  Ignore and proceed to unlock so
@@ -3259,6 +3776,9 @@ void register_console(struct console *newcon)
 	console_unlock();
 	console_sysfs_notify();
 
+	if (printk_kthreads_running)
+		printk_start_kthread(newcon);
+
 	/*
 	 * By unregistering the bootconsoles after we enable the real console
 	 * we get the "console xxx enabled" message on all the consoles -
@@ -3319,6 +3839,8 @@ int unregister_console(struct console *console)
 	console_unlock();
 	console_sysfs_notify();
 
+	printk_stop_kthread(console);
+
 	if (console->exit)
 		res = console->exit(console);
 
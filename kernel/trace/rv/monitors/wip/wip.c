@@ -66,6 +66,7 @@ static struct rv_monitor rv_wip = {
 	.enable = enable_wip,
 	.disable = disable_wip,
 	.reset = da_monitor_reset_all_wip,
+	.get_events = da_monitor_events_wip,
 	.enabled = 0,
 };
 
@@ -335,6 +335,74 @@ static const struct file_operations interface_desc_fops = {
 	.read	= monitor_desc_read_data,
 };
 
+/*
+ * Interface for selecting deferred, batched evaluation of a monitor's events.
+ */
+static ssize_t monitor_deferred_read_data(struct file *filp, char __user *user_buf, size_t count,
+					  loff_t *ppos)
+{
+	struct rv_monitor_def *mdef = filp->private_data;
+	const char *buff;
+
+	buff = mdef->monitor->deferred ? "1\n" : "0\n";
+
+	return simple_read_from_buffer(user_buf, count, ppos, buff, strlen(buff)+1);
+}
+
+static ssize_t monitor_deferred_write_data(struct file *filp, const char __user *user_buf,
+					   size_t count, loff_t *ppos)
+{
+	struct rv_monitor_def *mdef = filp->private_data;
+	int retval;
+	bool val;
+
+	retval = kstrtobool_from_user(user_buf, count, &val);
+	if (retval)
+		return retval;
+
+	mutex_lock(&rv_interface_lock);
+
+	/* The event handlers rely on the mode not changing under them. */
+	if (mdef->monitor->enabled)
+		retval = -EBUSY;
+	else
+		WRITE_ONCE(mdef->monitor->deferred, val);
+
+	mutex_unlock(&rv_interface_lock);
+
+	return retval ? : count;
+}
+
+static const struct file_operations interface_deferred_fops = {
+	.open   = simple_open,
+	.llseek = no_llseek,
+	.write  = monitor_deferred_write_data,
+	.read   = monitor_deferred_read_data,
+};
+
+/*
+ * Interface to read the number of events evaluated and dropped in deferred mode.
+ */
+static ssize_t monitor_events_read_data(struct file *filp, char __user *user_buf, size_t count,
+					loff_t *ppos)
+{
+	struct rv_monitor_def *mdef = filp->private_data;
+	unsigned long handled, dropped;
+	char buff[64];
+
+	mdef->monitor->get_events(&handled, &dropped);
+
+	snprintf(buff, sizeof(buff), "handled: %lu\ndropped: %lu\n", handled, dropped);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buff, strlen(buff) + 1);
+}
+
+static const struct file_operations interface_events_fops = {
+	.open   = simple_open,
+	.llseek	= no_llseek,
+	.read	= monitor_events_read_data,
+};
+
 /*
  * During the registration of a monitor, this function creates
  * the monitor dir, where the specific options of the monitor
@@ -363,6 +431,22 @@ static int create_monitor_dir(struct rv_monitor_def *mdef)
 		goto out_remove_root;
 	}
 
+	if (mdef->monitor->get_events) {
+		tmp = rv_create_file("deferred", RV_MODE_WRITE, mdef->root_d, mdef,
+				     &interface_deferred_fops);
+		if (!tmp) {
+			retval = -ENOMEM;
+			goto out_remove_root;
+		}
+
+		tmp = rv_create_file("events", RV_MODE_READ, mdef->root_d, mdef,
+				     &interface_events_fops);
+		if (!tmp) {
+			retval = -ENOMEM;
+			goto out_remove_root;
+		}
+	}
+
 	retval = reactor_populate_monitor(mdef);
 	if (retval)
 		goto out_remove_root;
@@ -101,6 +101,22 @@ net_dim_get_def_tx_moderation(u8 cq_period_mode)
 }
 EXPORT_SYMBOL(net_dim_get_def_tx_moderation);
 
+void net_dim_set_rx_latency_target(struct dim *dim, u16 usec)
+{
+	u8 ix = 0;
+
+	if (!usec) {
+		dim_clear_profile_cap(dim);
+		return;
+	}
+
+	while (ix < NET_DIM_PARAMS_NUM_PROFILES - 1 &&
+	       rx_profile[dim->mode][ix + 1].usec <= usec)
+		ix++;
+	dim_set_profile_cap(dim, ix);
+}
+EXPORT_SYMBOL(net_dim_set_rx_latency_target);
+
 static int net_dim_step(struct dim *dim)
 {
 	if (dim->tired == (NET_DIM_PARAMS_NUM_PROFILES * 2))
@@ -111,7 +127,8 @@ static int net_dim_step(struct dim *dim)
 	case DIM_PARKING_TIRED:
 		break;
 	case DIM_GOING_RIGHT:
-		if (dim->profile_ix == (NET_DIM_PARAMS_NUM_PROFILES - 1))
+		if (dim->profile_ix >=
+		    dim_max_profile(dim, NET_DIM_PARAMS_NUM_PROFILES))
 			return DIM_ON_EDGE;
 		dim->profile_ix++;
 		dim->steps_right++;
@@ -162,6 +179,30 @@ static int net_dim_stats_compare(struct dim_stats *curr,
 	return DIM_STATS_SAME;
 }
 
+/*
+ * Latency target mode: the timer is already bounded by the profile cap, so
+ * fewer interrupts for the same packet rate is the only thing to gain.
+ */
+static int net_dim_latency_stats_compare(struct dim_stats *curr,
+					 struct dim_stats *prev)
+{
+	if (!prev->ppms)
+		return curr->ppms ? DIM_STATS_BETTER : DIM_STATS_SAME;
+
+	if (IS_SIGNIFICANT_DIFF(curr->ppms, prev->ppms) &&
+	    curr->ppms < prev->ppms)
+		return DIM_STATS_WORSE;
+
+	if (!prev->epms)
+		return DIM_STATS_SAME;
+
+	if (IS_SIGNIFICANT_DIFF(curr->epms, prev->epms))
+		return (curr->epms < prev->epms) ? DIM_STATS_BETTER :
+						   DIM_STATS_WORSE;
+
+	return DIM_STATS_SAME;
+}
+
 static bool net_dim_decision(struct dim_stats *curr_stats, struct dim *dim)
 {
 	int prev_state = dim->tune_state;
@@ -171,8 +212,10 @@ static bool net_dim_decision(struct dim_stats *curr_stats, struct dim *dim)
 
 	switch (dim->tune_state) {
 	case DIM_PARKING_ON_TOP:
-		stats_res = net_dim_stats_compare(curr_stats,
-						  &dim->prev_stats);
+		stats_res = dim->profile_cap ?
+			    net_dim_latency_stats_compare(curr_stats,
+							  &dim->prev_stats) :
+			    net_dim_stats_compare(curr_stats, &dim->prev_stats);
 		if (stats_res != DIM_STATS_SAME)
 			net_dim_exit_parking(dim);
 		break;
@@ -185,8 +228,10 @@ static bool net_dim_decision(struct dim_stats *curr_stats, struct dim *dim)
 
 	case DIM_GOING_RIGHT:
 	case DIM_GOING_LEFT:
-		stats_res = net_dim_stats_compare(curr_stats,
-						  &dim->prev_stats);
+		stats_res = dim->profile_cap ?
+			    net_dim_latency_stats_compare(curr_stats,
+							  &dim->prev_stats) :
+			    net_dim_stats_compare(curr_stats, &dim->prev_stats);
 		if (stats_res != DIM_STATS_BETTER)
 			dim_turn(dim);
 
@@ -8,7 +8,8 @@
 static int rdma_dim_step(struct dim *dim)
 {
 	if (dim->tune_state == DIM_GOING_RIGHT) {
-		if (dim->profile_ix == (RDMA_DIM_PARAMS_NUM_PROFILES - 1))
+		if (dim->profile_ix >=
+		    dim_max_profile(dim, RDMA_DIM_PARAMS_NUM_PROFILES))
 			return DIM_ON_EDGE;
 		dim->profile_ix++;
 		dim->steps_right++;
@@ -119,7 +119,20 @@ const struct raid6_recov_calls *const raid6_recov_algos[] = {
 #endif
 
 #define RAID6_TEST_DISKS	8
-#define RAID6_TEST_DISKS_ORDER	3
+#define RAID6_MIN_TEST_DISKS	4
+#define RAID6_MAX_TEST_DISKS	32
+
+/*
+ * Every disk gets 16 pages: the first page alone is the cache-resident
+ * working set, while all of them across a wide array no longer fit in the
+ * caches and measure streaming throughput.
+ */
+#define RAID6_STREAM_ORDER	4
+#define RAID6_STREAM_BYTES	(PAGE_SIZE << RAID6_STREAM_ORDER)
+
+static unsigned int raid6_test_disks = RAID6_TEST_DISKS;
+module_param_named(bench_disks, raid6_test_disks, uint, 0444);
+MODULE_PARM_DESC(bench_disks, "Number of disks to benchmark gen()/xor() with (4-32, default 8)");
 
 static inline const struct raid6_recov_calls *raid6_choose_recov(void)
 {
@@ -142,15 +155,41 @@ static inline const struct raid6_recov_calls *raid6_choose_recov(void)
 	return best;
 }
 
-static inline const struct raid6_calls *raid6_choose_gen(
-	void *(*const dptrs)[RAID6_TEST_DISKS], const int disks)
+/* Run gen() or xor() for a fixed time, return the throughput in MB/s */
+static unsigned long raid6_bench(const struct raid6_calls *algo, int disks,
+				 size_t bytes, void **dptrs, int xor)
 {
-	unsigned long perf, bestgenperf, j0, j1;
 	int start = (disks>>1)-1, stop = disks-3;	/* work on the second half of the disks */
+	unsigned long j0, j1;
+	u64 perf = 0;
+
+	preempt_disable();
+	j0 = jiffies;
+	while ((j1 = jiffies) == j0)
+		cpu_relax();
+	while (time_before(jiffies, j1 + (1<<RAID6_TIME_JIFFIES_LG2))) {
+		if (xor)
+			algo->xor_syndrome(disks, start, stop, bytes, dptrs);
+		else
+			algo->gen_syndrome(disks, bytes, dptrs);
+		perf++;
+	}
+	preempt_enable();
+
+	/* xor() only touches half of the data disks */
+	return (perf * HZ * (disks - 2) * bytes) >>
+		(20 + RAID6_TIME_JIFFIES_LG2 + xor);
+}
+
+static inline const struct raid6_calls *raid6_choose_gen(void **dptrs,
+							 const int disks)
+{
+	unsigned long cached, stream, bestgenperf = 0;
+	unsigned long bestcached = 0, beststream = 0;
 	const struct raid6_calls *const *algo;
 	const struct raid6_calls *best;
 
-	for (bestgenperf = 0, best = NULL, algo = raid6_algos; *algo; algo++) {
+	for (best = NULL, algo = raid6_algos; *algo; algo++) {
 		if (!best || (*algo)->priority >= best->priority) {
 			if ((*algo)->valid && !(*algo)->valid())
 				continue;
@@ -160,26 +199,19 @@ static inline const struct raid6_calls *raid6_choose_gen(
 				break;
 			}
 
-			perf = 0;
+			cached = raid6_bench(*algo, disks, PAGE_SIZE, dptrs, 0);
+			stream = raid6_bench(*algo, disks, RAID6_STREAM_BYTES,
+					     dptrs, 0);
 
-			preempt_disable();
-			j0 = jiffies;
-			while ((j1 = jiffies) == j0)
-				cpu_relax();
-			while (time_before(jiffies,
-					    j1 + (1<<RAID6_TIME_JIFFIES_LG2))) {
-				(*algo)->gen_syndrome(disks, PAGE_SIZE, *dptrs);
-				perf++;
-			}
-			preempt_enable();
-
-			if (perf > bestgenperf) {
-				bestgenperf = perf;
+			/* weigh the cached and the streaming case equally */
+			if (cached + stream > bestgenperf) {
+				bestgenperf = cached + stream;
+				bestcached = cached;
+				beststream = stream;
 				best = *algo;
 			}
-			pr_info("raid6: %-8s gen() %5ld MB/s\n", (*algo)->name,
-				(perf * HZ * (disks-2)) >>
-				(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2));
+			pr_info("raid6: %-8s gen() %5ld MB/s cached, %5ld MB/s streaming\n",
+				(*algo)->name, cached, stream);
 		}
 	}
 
@@ -196,29 +228,16 @@ static inline const struct raid6_calls *raid6_choose_gen(
 		goto out;
 	}
 
-	pr_info("raid6: using algorithm %s gen() %ld MB/s\n",
-		best->name,
-		(bestgenperf * HZ * (disks - 2)) >>
-		(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2));
+	pr_info("raid6: using algorithm %s gen() %ld MB/s cached, %ld MB/s streaming (%d disks)\n",
+		best->name, bestcached, beststream, disks);
 
 	if (best->xor_syndrome) {
-		perf = 0;
-
-		preempt_disable();
-		j0 = jiffies;
-		while ((j1 = jiffies) == j0)
-			cpu_relax();
-		while (time_before(jiffies,
-				   j1 + (1 << RAID6_TIME_JIFFIES_LG2))) {
-			best->xor_syndrome(disks, start, stop,
-					   PAGE_SIZE, *dptrs);
-			perf++;
-		}
-		preempt_enable();
+		cached = raid6_bench(best, disks, PAGE_SIZE, dptrs, 1);
+		stream = raid6_bench(best, disks, RAID6_STREAM_BYTES, dptrs,
+				     1);
 
-		pr_info("raid6: .... xor() %ld MB/s, rmw enabled\n",
-			(perf * HZ * (disks - 2)) >>
-			(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2 + 1));
+		pr_info("raid6: .... xor() %ld MB/s cached, %ld MB/s streaming, rmw enabled\n",
+			cached, stream);
 	}
 
 out:
@@ -231,43 +250,46 @@ static inline const struct raid6_calls *raid6_choose_gen(
 
 int __init raid6_select_algo(void)
 {
-	const int disks = RAID6_TEST_DISKS;
+	const int disks = raid6_test_disks < RAID6_MIN_TEST_DISKS ?
+		RAID6_MIN_TEST_DISKS : raid6_test_disks > RAID6_MAX_TEST_DISKS ?
+		RAID6_MAX_TEST_DISKS : raid6_test_disks;
 
-	const struct raid6_calls *gen_best;
+	const struct raid6_calls *gen_best = NULL;
 	const struct raid6_recov_calls *rec_best;
-	char *disk_ptr, *p;
-	void *dptrs[RAID6_TEST_DISKS];
-	int i, cycle;
-
-	/* prepare the buffer and fill it circularly with gfmul table */
-	disk_ptr = (char *)__get_free_pages(GFP_KERNEL, RAID6_TEST_DISKS_ORDER);
-	if (!disk_ptr) {
-		pr_err("raid6: Yikes!  No memory available.\n");
-		return -ENOMEM;
-	}
-
-	p = disk_ptr;
-	for (i = 0; i < disks; i++)
-		dptrs[i] = p + PAGE_SIZE * i;
-
-	cycle = ((disks - 2) * PAGE_SIZE) / 65536;
-	for (i = 0; i < cycle; i++) {
-		memcpy(p, raid6_gfmul, 65536);
-		p += 65536;
+	void *dptrs[RAID6_MAX_TEST_DISKS];
+	size_t off, len;
+	int i, ret = -ENOMEM;
+
+	/* prepare the buffers and fill the data disks with the gfmul table */
+	for (i = 0; i < disks; i++) {
+		dptrs[i] = (void *)__get_free_pages(GFP_KERNEL,
+						    RAID6_STREAM_ORDER);
+		if (!dptrs[i]) {
+			pr_err("raid6: Yikes!  No memory available.\n");
+			goto out;
+		}
+		if (i >= disks - 2)
+			continue;
+		for (off = 0; off < RAID6_STREAM_BYTES; off += len) {
+			len = RAID6_STREAM_BYTES - off;
+			if (len > 65536)
+				len = 65536;
+			memcpy(dptrs[i] + off, raid6_gfmul, len);
+		}
 	}
 
-	if ((disks - 2) * PAGE_SIZE % 65536)
-		memcpy(p, raid6_gfmul, (disks - 2) * PAGE_SIZE % 65536);
-
 	/* select raid gen_syndrome function */
-	gen_best = raid6_choose_gen(&dptrs, disks);
+	gen_best = raid6_choose_gen(dptrs, disks);
 
 	/* select raid recover functions */
 	rec_best = raid6_choose_recov();
 
-	free_pages((unsigned long)disk_ptr, RAID6_TEST_DISKS_ORDER);
+	ret = gen_best && rec_best ? 0 : -EINVAL;
+out:
+	while (i--)
+		free_pages((unsigned long)dptrs[i], RAID6_STREAM_ORDER);
 
-	return gen_best && rec_best ? 0 : -EINVAL;
+	return ret;
 }
 
 static void raid6_exit(void)
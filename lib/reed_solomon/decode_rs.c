@@ -61,6 +61,26 @@
 	for (i = 0; i < nroots; i++)
 		syn[i] = (((uint16_t) data[0]) ^ invmsk) & msk;
 
+	if (!rs->syn_tbl)
+		goto syn_slow;
+
+	/* Horner's scheme, with table driven multiplications by the roots */
+	for (j = 1; j < len; j++) {
+		u = (((uint16_t) data[j]) ^ invmsk) & msk;
+		for (i = 0, k = 0; i < nroots; i++, k += 16 * rs->syn_nibbles)
+			syn[i] = u ^ rs_syn_mul(rs->syn_tbl + k,
+						rs->syn_nibbles, syn[i]);
+	}
+
+	for (j = 0; j < nroots; j++) {
+		u = ((uint16_t) par[j]) & msk;
+		for (i = 0, k = 0; i < nroots; i++, k += 16 * rs->syn_nibbles)
+			syn[i] = u ^ rs_syn_mul(rs->syn_tbl + k,
+						rs->syn_nibbles, syn[i]);
+	}
+	goto syn_done;
+
+ syn_slow:
 	for (j = 1; j < len; j++) {
 		for (i = 0; i < nroots; i++) {
 			if (syn[i] == 0) {
@@ -86,6 +106,7 @@
 			}
 		}
 	}
+ syn_done:
 	s = syn;
 
 	/* Convert syndromes to index form, checking for nonzero condition */
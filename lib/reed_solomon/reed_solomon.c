@@ -54,6 +54,56 @@ static LIST_HEAD(codec_list);
 /* Protection for the list */
 static DEFINE_MUTEX(rslistlock);
 
+/* Limit the syndrome tables to 16KiB per codec */
+#define RS_SYN_TBL_MAX_ROOTS	128
+
+/*
+ * Build the tables for multiplying a syndrome with its root: the product
+ * of a symbol is the XOR of the products of its nibbles, so each root only
+ * needs 16 entries per nibble rather than a full nn + 1 entry table.
+ */
+static int codec_init_syn_tbl(struct rs_codec *rs, gfp_t gfp)
+{
+	int i, k, v, root, nibbles;
+	uint16_t *tbl, x;
+
+	rs->syn_nibbles = nibbles = DIV_ROUND_UP(rs->mm, 4);
+	if (rs->nroots > RS_SYN_TBL_MAX_ROOTS)
+		return 0;
+
+	rs->syn_tbl = kmalloc_array(rs->nroots * nibbles * 16,
+				    sizeof(uint16_t), gfp);
+	if (!rs->syn_tbl)
+		return -ENOMEM;
+
+	tbl = rs->syn_tbl;
+	for (i = 0, root = rs->fcr * rs->prim; i < rs->nroots;
+	     i++, root += rs->prim) {
+		for (k = 0; k < nibbles; k++) {
+			for (v = 0; v < 16; v++, tbl++) {
+				x = (v << (4 * k)) & rs->nn;
+				*tbl = x ? rs->alpha_to[rs_modnn(rs,
+						rs->index_of[x] + root)] : 0;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Multiply @x with a root, @tbl being that root's part of rs->syn_tbl */
+static inline uint16_t rs_syn_mul(const uint16_t *tbl, int nibbles, uint16_t x)
+{
+	uint16_t r = tbl[x & 0xf];
+
+	while (--nibbles) {
+		tbl += 16;
+		x >>= 4;
+		r ^= tbl[x & 0xf];
+	}
+	return r;
+}
+
 /**
  * codec_init - Initialize a Reed-Solomon codec
  * @symsize:	symbol size, bits (1-8)
@@ -152,11 +202,15 @@ static struct rs_codec *codec_init(int symsize, int gfpoly, int (*gffunc)(int),
 	for (i = 0; i <= nroots; i++)
 		rs->genpoly[i] = rs->index_of[rs->genpoly[i]];
 
+	if (codec_init_syn_tbl(rs, gfp))
+		goto err;
+
 	rs->users = 1;
 	list_add(&rs->list, &codec_list);
 	return rs;
 
 err:
+	kfree(rs->syn_tbl);
 	kfree(rs->genpoly);
 	kfree(rs->index_of);
 	kfree(rs->alpha_to);
@@ -188,6 +242,7 @@ void free_rs(struct rs_control *rs)
 		kfree(cd->alpha_to);
 		kfree(cd->index_of);
 		kfree(cd->genpoly);
+		kfree(cd->syn_tbl);
 		kfree(cd);
 	}
 	mutex_unlock(&rslistlock);
@@ -7,6 +7,7 @@
  */
 #include <linux/rslib.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
@@ -32,6 +33,7 @@ enum method {
 __param(int, v, V_PROGRESS, "Verbosity level");
 __param(int, ewsc, 1, "Erasures without symbol corruption");
 __param(int, bc, 1, "Test for correct behaviour beyond error correction capacity");
+__param(int, bench, 1, "Measure decoding throughput of error free words");
 
 struct etab {
 	int	symsize;
@@ -58,6 +60,15 @@ static struct etab Tab[] = {
 	{0, 0, 0, 0, 0, 0},
 };
 
+/* Codes to benchmark, ntrials is the number of words decoded */
+static struct etab BenchTab[] = {
+	/* The pstore ram ECC default */
+	{8,	0x11d,	0,	1,	16,	20000	},
+	{8,	0x187,	112,	11,	32,	20000	},
+	{10,	0x409,	0,	1,	4,	2000	},
+	{0, 0, 0, 0, 0, 0},
+};
+
 
 struct estat {
 	int	dwrong;
@@ -484,6 +495,58 @@ static int run_exercise(struct etab *e)
 	return retval;
 }
 
+/*
+ * Checking intact data is by far the most common use of the decoder, e.g.
+ * when pstore verifies its ram buffers on boot, and is dominated by computing
+ * the syndromes.
+ */
+static int run_bench(struct etab *e)
+{
+	int nn = (1 << e->symsize) - 1;
+	int dlen = nn - e->nroots;
+	struct rs_control *rsc;
+	struct wspace *ws;
+	int i, retval = -ENOMEM;
+	ktime_t start;
+	u64 ns;
+
+	rsc = init_rs(e->symsize, e->genpoly, e->fcs, e->prim, e->nroots);
+	if (!rsc)
+		return retval;
+
+	ws = alloc_ws(rsc->codec);
+	if (!ws)
+		goto err;
+
+	for (i = 0; i < dlen; i++)
+		ws->c[i] = get_random_u32() & nn;
+	memset(ws->c + dlen, 0, e->nroots * sizeof(*ws->c));
+	encode_rs16(rsc, ws->c, dlen, ws->c + dlen, 0);
+
+	retval = 0;
+	start = ktime_get();
+	for (i = 0; i < e->ntrials; i++)
+		retval |= decode_rs16(rsc, ws->c, ws->c + dlen, dlen,
+				      NULL, 0, NULL, 0, NULL);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (retval) {
+		pr_warn("    FAIL: errors found in a valid codeword\n");
+		retval = 1;
+	} else if (v >= V_PROGRESS) {
+		pr_info("Decoding (%d,%d)_%d code: %llu ksymbols/s\n",
+			nn, dlen, nn + 1,
+			div64_u64((u64)e->ntrials * nn * NSEC_PER_MSEC,
+				  ns ?: 1));
+	}
+
+	free_ws(ws);
+
+err:
+	free_rs(rsc);
+	return retval;
+}
+
 static int __init test_rslib_init(void)
 {
 	int i, fail = 0;
@@ -498,6 +561,16 @@ static int __init test_rslib_init(void)
 		fail |= retval;
 	}
 
+	for (i = 0; bench && BenchTab[i].symsize != 0; i++) {
+		int retval;
+
+		retval = run_bench(BenchTab + i);
+		if (retval < 0)
+			return -ENOMEM;
+
+		fail |= retval;
+	}
+
 	if (fail)
 		pr_warn("rslib: test failed\n");
 	else
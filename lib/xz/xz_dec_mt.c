@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Parallel decoding of multi-Block .xz Streams
+ *
+ * The Index of a Stream lists the Unpadded and Uncompressed Size of every
+ * Block. With the whole Stream in memory this is enough to find where each
+ * Block starts, and since every Block starts with a dictionary reset, the
+ * Blocks can be decoded by independent single-call decoders.
+ */
+
+#include <linux/atomic.h>
+#include <linux/cpumask.h>
+#include <linux/workqueue.h>
+
+#include "xz_private.h"
+#include "xz_stream.h"
+
+/* Decode a variable-length integer of the Index, see dec_vli(). */
+static bool index_vli(const uint8_t *buf, size_t size, size_t *pos,
+		      vli_type *vli)
+{
+	uint32_t shift = 0;
+	uint8_t byte;
+
+	*vli = 0;
+	while (*pos < size && shift < 7 * VLI_BYTES_MAX) {
+		byte = buf[(*pos)++];
+		*vli |= (vli_type)(byte & 0x7F) << shift;
+
+		/* Don't allow non-minimal encodings. */
+		if ((byte & 0x80) == 0)
+			return byte != 0 || shift == 0;
+
+		shift += 7;
+	}
+
+	return false;
+}
+
+enum xz_ret xz_index_init(struct xz_index *idx, const uint8_t *in,
+			  size_t in_size)
+{
+	const uint8_t *footer, *index;
+	vli_type unpadded, uncompressed;
+	vli_type blocks_size = 0;
+	size_t index_size, pos;
+	uint64_t i;
+
+	/* Stream Padding is a multiple of four null bytes. */
+	while (in_size >= 2 * STREAM_HEADER_SIZE + 4
+			&& get_unaligned_le32(in + in_size - 4) == 0)
+		in_size -= 4;
+
+	if (in_size < 2 * STREAM_HEADER_SIZE
+			|| !memeq(in, HEADER_MAGIC, HEADER_MAGIC_SIZE))
+		return XZ_FORMAT_ERROR;
+
+	footer = in + in_size - STREAM_HEADER_SIZE;
+	if (!memeq(footer + 10, FOOTER_MAGIC, FOOTER_MAGIC_SIZE))
+		return XZ_FORMAT_ERROR;
+
+	if (xz_crc32(in + HEADER_MAGIC_SIZE, 2, 0)
+			!= get_unaligned_le32(in + HEADER_MAGIC_SIZE + 2)
+			|| xz_crc32(footer + 4, 6, 0)
+				!= get_unaligned_le32(footer))
+		return XZ_DATA_ERROR;
+
+	/* Stream Flags in the Header and the Footer must match. */
+	if (footer[8] != in[HEADER_MAGIC_SIZE]
+			|| footer[9] != in[HEADER_MAGIC_SIZE + 1])
+		return XZ_DATA_ERROR;
+
+	if (in[HEADER_MAGIC_SIZE] != 0
+			|| in[HEADER_MAGIC_SIZE + 1] > XZ_CHECK_CRC32)
+		return XZ_OPTIONS_ERROR;
+
+	/* Backward Size is the size of the Index in four-byte units, minus 1 */
+	index_size = ((size_t)get_unaligned_le32(footer + 4) + 1) * 4;
+	if (index_size > in_size - 2 * STREAM_HEADER_SIZE)
+		return XZ_FORMAT_ERROR;
+
+	index = footer - index_size;
+	index_size -= 4;
+	if (index[0] != 0 || xz_crc32(index, index_size, 0)
+			!= get_unaligned_le32(index + index_size))
+		return XZ_DATA_ERROR;
+
+	pos = 1;
+	if (!index_vli(index, index_size, &pos, &idx->count))
+		return XZ_DATA_ERROR;
+
+	idx->records = index + pos;
+	idx->uncompressed = 0;
+	for (i = 0; i < idx->count; i++) {
+		if (!index_vli(index, index_size, &pos, &unpadded)
+				|| !index_vli(index, index_size, &pos,
+					      &uncompressed)
+				|| unpadded == 0 || unpadded > VLI_MAX
+				|| uncompressed > VLI_MAX)
+			return XZ_DATA_ERROR;
+
+		blocks_size += round_up(unpadded, 4);
+		idx->uncompressed += uncompressed;
+		if (blocks_size > in_size || idx->uncompressed > SIZE_MAX)
+			return XZ_FORMAT_ERROR;
+	}
+
+	/* Index Padding */
+	if (index_size - pos > 3)
+		return XZ_DATA_ERROR;
+	idx->records_size = pos - (idx->records - index);
+	while (pos < index_size)
+		if (index[pos++] != 0)
+			return XZ_DATA_ERROR;
+
+	/* The Blocks fill everything between the Stream Header and Index. */
+	if (STREAM_HEADER_SIZE + blocks_size != index - in)
+		return XZ_FORMAT_ERROR;
+
+	idx->check_type = in[HEADER_MAGIC_SIZE + 1];
+	idx->pos = 0;
+	idx->remaining = idx->count;
+	idx->block = in + STREAM_HEADER_SIZE;
+
+	return XZ_OK;
+}
+
+int xz_index_next(struct xz_index *idx, struct xz_block *block)
+{
+	vli_type unpadded, uncompressed;
+
+	/* xz_index_init() has already validated all the Records. */
+	if (idx->remaining == 0
+			|| !index_vli(idx->records, idx->records_size,
+				      &idx->pos, &unpadded)
+			|| !index_vli(idx->records, idx->records_size,
+				      &idx->pos, &uncompressed))
+		return 0;
+
+	block->in = idx->block;
+	block->in_size = round_up(unpadded, 4);
+	block->out_size = uncompressed;
+
+	idx->block += block->in_size;
+	--idx->remaining;
+
+	return 1;
+}
+
+struct xz_dec_blocks_state {
+	struct xz_block *blocks;
+	uint32_t nr_blocks;
+	uint8_t check_type;
+	atomic_t next;
+};
+
+struct xz_dec_blocks_worker {
+	struct work_struct work;
+	struct xz_dec_blocks_state *state;
+	struct xz_dec *s;
+};
+
+static void xz_dec_blocks_run(struct xz_dec_blocks_state *state,
+			      struct xz_dec *s)
+{
+	struct xz_block *block;
+	struct xz_buf b;
+	uint32_t i;
+
+	while ((i = atomic_inc_return(&state->next) - 1) < state->nr_blocks) {
+		block = &state->blocks[i];
+
+		b.in = block->in;
+		b.in_pos = 0;
+		b.in_size = block->in_size;
+		b.out = block->out;
+		b.out_pos = 0;
+		b.out_size = block->out_size;
+
+		block->ret = xz_dec_block_run(s, state->check_type, &b);
+
+		/* The Block must match the sizes stored in the Index. */
+		if (block->ret == XZ_STREAM_END && (b.in_pos != b.in_size
+				|| b.out_pos != b.out_size))
+			block->ret = XZ_DATA_ERROR;
+
+		cond_resched();
+	}
+}
+
+static void xz_dec_blocks_work(struct work_struct *work)
+{
+	struct xz_dec_blocks_worker *worker =
+		container_of(work, struct xz_dec_blocks_worker, work);
+
+	xz_dec_blocks_run(worker->state, worker->s);
+}
+
+enum xz_ret xz_dec_blocks(struct xz_block *blocks, uint32_t nr_blocks,
+			  uint8_t check_type, uint32_t max_workers)
+{
+	struct xz_dec_blocks_state state = {
+		.blocks = blocks,
+		.nr_blocks = nr_blocks,
+		.check_type = check_type,
+		.next = ATOMIC_INIT(0),
+	};
+	struct xz_dec_blocks_worker *workers;
+	uint32_t nr_workers, i;
+
+	if (nr_blocks == 0)
+		return XZ_OK;
+
+	nr_workers = max_workers ? max_workers : num_online_cpus();
+	nr_workers = min(nr_workers, nr_blocks);
+	workers = kcalloc(nr_workers, sizeof(*workers), GFP_KERNEL);
+	if (workers == NULL)
+		return XZ_MEM_ERROR;
+
+	/*
+	 * Single-call decoders use the output buffer as the dictionary, so
+	 * they are small. Go with fewer workers if memory is tight anyway.
+	 */
+	for (i = 0; i < nr_workers; i++) {
+		workers[i].s = xz_dec_init(XZ_SINGLE, 0);
+		if (workers[i].s == NULL)
+			break;
+
+		workers[i].state = &state;
+		INIT_WORK(&workers[i].work, xz_dec_blocks_work);
+	}
+
+	nr_workers = i;
+	if (nr_workers == 0) {
+		kfree(workers);
+		return XZ_MEM_ERROR;
+	}
+
+	/* The first worker's decoder is used by the caller. */
+	for (i = 1; i < nr_workers; i++)
+		queue_work(system_unbound_wq, &workers[i].work);
+	xz_dec_blocks_run(&state, workers[0].s);
+	for (i = 1; i < nr_workers; i++)
+		flush_work(&workers[i].work);
+
+	for (i = 0; i < nr_workers; i++)
+		xz_dec_end(workers[i].s);
+	kfree(workers);
+
+	return XZ_OK;
+}
@@ -57,6 +57,11 @@ struct xz_dec {
 	 */
 	bool allow_buf_error;
 
+#ifdef XZ_DEC_BLOCKS
+	/* True if decoding a lone Block for xz_dec_block_run() */
+	bool single_block;
+#endif
+
 	/* Information stored in Block Header */
 	struct {
 		/*
@@ -590,6 +595,12 @@ static enum xz_ret dec_main(struct xz_dec *s, struct xz_buf *b)
 			if (b->in_pos == b->in_size)
 				return XZ_OK;
 
+#ifdef XZ_DEC_BLOCKS
+			/* A lone Block cannot be followed by an Index. */
+			if (s->single_block && b->in[b->in_pos] == 0)
+				return XZ_DATA_ERROR;
+#endif
+
 			/* See if this is the beginning of the Index field. */
 			if (b->in[b->in_pos] == 0) {
 				s->in_start = b->in_pos++;
@@ -665,6 +676,11 @@ static enum xz_ret dec_main(struct xz_dec *s, struct xz_buf *b)
 			}
 #endif
 
+#ifdef XZ_DEC_BLOCKS
+			if (s->single_block)
+				return XZ_STREAM_END;
+#endif
+
 			s->sequence = SEQ_BLOCK_START;
 			break;
 
@@ -783,6 +799,34 @@ XZ_EXTERN enum xz_ret xz_dec_run(struct xz_dec *s, struct xz_buf *b)
 	return ret;
 }
 
+#ifdef XZ_DEC_BLOCKS
+enum xz_ret xz_dec_block_run(struct xz_dec *s, uint8_t check_type,
+			     struct xz_buf *b)
+{
+	size_t in_start = b->in_pos;
+	size_t out_start = b->out_pos;
+	enum xz_ret ret;
+
+	xz_dec_reset(s);
+	s->check_type = check_type;
+	s->single_block = true;
+	s->sequence = SEQ_BLOCK_START;
+
+	ret = dec_main(s, b);
+
+	/* Same as the single-call handling in xz_dec_run() */
+	if (ret == XZ_OK)
+		ret = b->in_pos == b->in_size ? XZ_DATA_ERROR : XZ_BUF_ERROR;
+
+	if (ret != XZ_STREAM_END) {
+		b->in_pos = in_start;
+		b->out_pos = out_start;
+	}
+
+	return ret;
+}
+#endif
+
 XZ_EXTERN struct xz_dec *xz_dec_init(enum xz_mode mode, uint32_t dict_max)
 {
 	struct xz_dec *s = kmalloc(sizeof(*s), GFP_KERNEL);
@@ -817,6 +861,9 @@ XZ_EXTERN void xz_dec_reset(struct xz_dec *s)
 {
 	s->sequence = SEQ_STREAM_HEADER;
 	s->allow_buf_error = false;
+#ifdef XZ_DEC_BLOCKS
+	s->single_block = false;
+#endif
 	s->pos = 0;
 	s->crc32 = 0;
 	memzero(&s->block, sizeof(s->block));
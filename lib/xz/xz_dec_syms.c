@@ -15,6 +15,10 @@ EXPORT_SYMBOL(xz_dec_reset);
 EXPORT_SYMBOL(xz_dec_run);
 EXPORT_SYMBOL(xz_dec_end);
 
+EXPORT_SYMBOL(xz_index_init);
+EXPORT_SYMBOL(xz_index_next);
+EXPORT_SYMBOL(xz_dec_blocks);
+
 #ifdef CONFIG_XZ_DEC_MICROLZMA
 EXPORT_SYMBOL(xz_dec_microlzma_alloc);
 EXPORT_SYMBOL(xz_dec_microlzma_reset);
@@ -40,6 +40,7 @@
 #		ifdef CONFIG_XZ_DEC_MICROLZMA
 #			define XZ_DEC_MICROLZMA
 #		endif
+#		define XZ_DEC_BLOCKS
 #		define memeq(a, b, size) (memcmp(a, b, size) == 0)
 #		define memzero(buf, size) memset(buf, 0, size)
 #	endif
@@ -132,6 +133,17 @@ XZ_EXTERN enum xz_ret xz_dec_lzma2_run(struct xz_dec_lzma2 *s,
 /* Free the memory allocated for the LZMA2 decoder. */
 XZ_EXTERN void xz_dec_lzma2_end(struct xz_dec_lzma2 *s);
 
+#ifdef XZ_DEC_BLOCKS
+/*
+ * Decode exactly one Block, from its Block Header up to and including the
+ * Check field, from b->in to b->out. check_type is the Check ID from the
+ * Stream Flags. s must have been allocated in XZ_SINGLE mode, and the
+ * return values are those of xz_dec_run() in single-call mode.
+ */
+extern enum xz_ret xz_dec_block_run(struct xz_dec *s, uint8_t check_type,
+				    struct xz_buf *b);
+#endif
+
 #ifdef XZ_DEC_BCJ
 /*
  * Allocate memory for BCJ decoders. xz_dec_bcj_reset() must be used before
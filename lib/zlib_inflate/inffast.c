@@ -3,6 +3,7 @@
  * For conditions of distribution and use, see copyright notice in zlib.h
  */
 
+#include <asm/unaligned.h>
 #include <linux/zutil.h>
 #include "inftrees.h"
 #include "inflate.h"
@@ -27,6 +28,38 @@ get_unaligned16(const unsigned short *p)
 	return mm.us;
 }
 
+/*
+ * Copy len bytes of a match from 'from' to 'out', a machine word at a time
+ * while the source is at least a word behind the output, so that the
+ * overlapping copy still repeats the pattern exactly as a byte loop would.
+ * Nothing is written beyond out + len. Returns the updated output pointer.
+ */
+static inline unsigned char *
+chunk_copy(unsigned char *out, const unsigned char *from, unsigned len)
+{
+    if (IS_ENABLED(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS) &&
+        out - from >= (long)sizeof(unsigned long)) {
+        while (len >= sizeof(unsigned long)) {
+            put_unaligned(get_unaligned((const unsigned long *)from),
+                          (unsigned long *)out);
+            out += sizeof(unsigned long);
+            from += sizeof(unsigned long);
+            len -= sizeof(unsigned long);
+        }
+    }
+    while (len--)
+        *out++ = *from++;
+    return out;
+}
+
+/* Copy len bytes from the window, which never overlaps the output. */
+static inline unsigned char *
+window_copy(unsigned char *out, const unsigned char *from, unsigned len)
+{
+    memcpy(out, from, len);
+    return out + len;
+}
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -189,9 +222,7 @@ void inflate_fast(z_streamp strm, unsigned start)
                         from += wsize - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                *out++ = *from++;
-                            } while (--op);
+                            out = window_copy(out, from, op);
                             from = out - dist;  /* rest from output */
                         }
                     }
@@ -200,16 +231,12 @@ void inflate_fast(z_streamp strm, unsigned start)
                         op -= write;
                         if (op < len) {         /* some from end of window */
                             len -= op;
-                            do {
-                                *out++ = *from++;
-                            } while (--op);
+                            out = window_copy(out, from, op);
                             from = window;
                             if (write < len) {  /* some from start of window */
                                 op = write;
                                 len -= op;
-                                do {
-                                    *out++ = *from++;
-                                } while (--op);
+                                out = window_copy(out, from, op);
                                 from = out - dist;      /* rest from output */
                             }
                         }
@@ -218,23 +245,16 @@ void inflate_fast(z_streamp strm, unsigned start)
                         from += write - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                *out++ = *from++;
-                            } while (--op);
+                            out = window_copy(out, from, op);
                             from = out - dist;  /* rest from output */
                         }
                     }
-                    while (len > 2) {
-                        *out++ = *from++;
-                        *out++ = *from++;
-                        *out++ = *from++;
-                        len -= 3;
-                    }
-                    if (len) {
-                        *out++ = *from++;
-                        if (len > 1)
-                            *out++ = *from++;
-                    }
+                    out = chunk_copy(out, from, len);
+                }
+                else if (IS_ENABLED(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS) &&
+                         dist >= sizeof(unsigned long)) {
+                    /* copy direct from output, a word at a time */
+                    out = chunk_copy(out, out - dist, len);
                 }
                 else {
 		    unsigned short *sout;
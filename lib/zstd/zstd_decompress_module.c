@@ -9,9 +9,13 @@
  * You may select, at your option, one of the above-listed licenses.
  */
 
+#include <linux/cpumask.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 #include <linux/string.h>
+#include <linux/workqueue.h>
 #include <linux/zstd.h>
 
 #include "common/zstd_deps.h"
@@ -101,5 +105,94 @@ size_t zstd_get_frame_header(zstd_frame_header *header, const void *src,
 }
 EXPORT_SYMBOL(zstd_get_frame_header);
 
+/* Parallel decompression symbols. */
+
+struct zstd_frames {
+	struct zstd_frame_job *jobs;
+	unsigned int nr_jobs;
+	atomic_t next;
+};
+
+struct zstd_frames_worker {
+	struct work_struct work;
+	struct zstd_frames *frames;
+	void *workspace;
+	zstd_dctx *dctx;
+};
+
+static void zstd_frames_run(struct zstd_frames *frames, zstd_dctx *dctx)
+{
+	struct zstd_frame_job *job;
+	unsigned int i;
+
+	while ((i = atomic_inc_return(&frames->next) - 1) < frames->nr_jobs) {
+		job = &frames->jobs[i];
+		job->result = ZSTD_decompressDCtx(dctx, job->dst,
+			job->dst_capacity, job->src, job->src_size);
+		cond_resched();
+	}
+}
+
+static void zstd_frames_work(struct work_struct *work)
+{
+	struct zstd_frames_worker *worker =
+		container_of(work, struct zstd_frames_worker, work);
+
+	zstd_frames_run(worker->frames, worker->dctx);
+}
+
+int zstd_decompress_frames(struct zstd_frame_job *jobs, unsigned int nr_jobs,
+	unsigned int max_workers)
+{
+	size_t workspace_size = zstd_dctx_workspace_bound();
+	struct zstd_frames frames = {
+		.jobs = jobs,
+		.nr_jobs = nr_jobs,
+		.next = ATOMIC_INIT(0),
+	};
+	struct zstd_frames_worker *workers;
+	unsigned int nr_workers, i;
+
+	if (!nr_jobs)
+		return 0;
+
+	nr_workers = max_workers ? max_workers : num_online_cpus();
+	nr_workers = min(nr_workers, nr_jobs);
+	workers = kcalloc(nr_workers, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return -ENOMEM;
+
+	/* Go with fewer workers if memory is tight. */
+	for (i = 0; i < nr_workers; i++) {
+		workers[i].workspace = kvmalloc(workspace_size, GFP_KERNEL);
+		workers[i].dctx = zstd_init_dctx(workers[i].workspace,
+			workspace_size);
+		if (!workers[i].dctx) {
+			kvfree(workers[i].workspace);
+			break;
+		}
+		workers[i].frames = &frames;
+		INIT_WORK(&workers[i].work, zstd_frames_work);
+	}
+	nr_workers = i;
+	if (!nr_workers) {
+		kfree(workers);
+		return -ENOMEM;
+	}
+
+	/* The first worker's context is used by the caller. */
+	for (i = 1; i < nr_workers; i++)
+		queue_work(system_unbound_wq, &workers[i].work);
+	zstd_frames_run(&frames, workers[0].dctx);
+	for (i = 1; i < nr_workers; i++)
+		flush_work(&workers[i].work);
+
+	for (i = 0; i < nr_workers; i++)
+		kvfree(workers[i].workspace);
+	kfree(workers);
+	return 0;
+}
+EXPORT_SYMBOL(zstd_decompress_frames);
+
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("Zstd Decompressor");
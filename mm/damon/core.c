@@ -12,7 +12,9 @@
 #include <linux/kthread.h>
 #include <linux/mm.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/string.h>
+#include <linux/workqueue.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/damon.h>
@@ -273,6 +275,10 @@ static struct damos_quota *damos_quota_init_priv(struct damos_quota *quota)
 	quota->charged_from = 0;
 	quota->charge_target_from = NULL;
 	quota->charge_addr_from = 0;
+	quota->queue = NULL;
+	quota->queue_len = 0;
+	quota->queue_cap = 0;
+	quota->queued = false;
 	return quota;
 }
 
@@ -288,6 +294,7 @@ struct damos *damon_new_scheme(struct damos_access_pattern *pattern,
 	scheme->pattern = *pattern;
 	scheme->action = action;
 	scheme->stat = (struct damos_stat){};
+	scheme->target_nid = NUMA_NO_NODE;
 	INIT_LIST_HEAD(&scheme->list);
 
 	scheme->quota = *(damos_quota_init_priv(quota));
@@ -310,6 +317,7 @@ static void damon_del_scheme(struct damos *s)
 
 static void damon_free_scheme(struct damos *s)
 {
+	kvfree(s->quota.queue);
 	kfree(s);
 }
 
@@ -444,6 +452,10 @@ int damon_set_attrs(struct damon_ctx *ctx, struct damon_attrs *attrs)
 		return -EINVAL;
 	if (attrs->min_nr_regions > attrs->max_nr_regions)
 		return -EINVAL;
+	if (attrs->cpu_budget > 1000)
+		return -EINVAL;
+	if (attrs->nr_workers > DAMON_MAX_WORKERS)
+		return -EINVAL;
 
 	ctx->attrs = *attrs;
 	return 0;
@@ -699,6 +711,49 @@ static bool damos_valid_target(struct damon_ctx *c, struct damon_target *t,
 	return c->ops.get_scheme_score(c, t, r, s) >= s->quota.min_score;
 }
 
+/*
+ * Applies @s to the first @sz bytes of @r, splitting @r if the quota is
+ * smaller, and updates the quota and the stats accordingly.
+ */
+static void damos_apply_scheme(struct damon_ctx *c, struct damon_target *t,
+		struct damon_region *r, struct damos *s, unsigned long sz)
+{
+	struct damos_quota *quota = &s->quota;
+	struct timespec64 begin, end;
+	unsigned long sz_applied = 0;
+	unsigned long ns;
+
+	if (c->ops.apply_scheme) {
+		if (quota->esz && quota->charged_sz + sz > quota->esz) {
+			sz = ALIGN_DOWN(quota->esz - quota->charged_sz,
+					DAMON_MIN_REGION);
+			if (!sz)
+				goto update_stat;
+			damon_split_region_at(t, r, sz);
+		}
+		ktime_get_coarse_ts64(&begin);
+		sz_applied = c->ops.apply_scheme(c, t, r, s);
+		ktime_get_coarse_ts64(&end);
+		ns = timespec64_to_ns(&end) - timespec64_to_ns(&begin);
+		quota->total_charged_ns += ns;
+		s->stat.ns_applied += ns;
+		quota->charged_sz += sz;
+		if (quota->esz && quota->charged_sz >= quota->esz) {
+			quota->charge_target_from = t;
+			quota->charge_addr_from = r->ar.end + 1;
+		}
+	}
+	if (s->action != DAMOS_STAT)
+		r->age = 0;
+
+update_stat:
+	s->stat.nr_tried++;
+	s->stat.sz_tried += sz;
+	if (sz_applied)
+		s->stat.nr_applied++;
+	s->stat.sz_applied += sz_applied;
+}
+
 static void damon_do_apply_schemes(struct damon_ctx *c,
 				   struct damon_target *t,
 				   struct damon_region *r)
@@ -708,12 +763,14 @@ static void damon_do_apply_schemes(struct damon_ctx *c,
 	damon_for_each_scheme(s, c) {
 		struct damos_quota *quota = &s->quota;
 		unsigned long sz = damon_sz_region(r);
-		struct timespec64 begin, end;
-		unsigned long sz_applied = 0;
 
 		if (!s->wmarks.activated)
 			continue;
 
+		/* Applied from the candidates queue instead */
+		if (quota->queued)
+			continue;
+
 		/* Check the quota */
 		if (quota->esz && quota->charged_sz >= quota->esz)
 			continue;
@@ -752,37 +809,69 @@ static void damon_do_apply_schemes(struct damon_ctx *c,
 		if (!damos_valid_target(c, t, r, s))
 			continue;
 
-		/* Apply the scheme */
-		if (c->ops.apply_scheme) {
-			if (quota->esz &&
-					quota->charged_sz + sz > quota->esz) {
-				sz = ALIGN_DOWN(quota->esz - quota->charged_sz,
-						DAMON_MIN_REGION);
-				if (!sz)
-					goto update_stat;
-				damon_split_region_at(t, r, sz);
-			}
-			ktime_get_coarse_ts64(&begin);
-			sz_applied = c->ops.apply_scheme(c, t, r, s);
-			ktime_get_coarse_ts64(&end);
-			quota->total_charged_ns += timespec64_to_ns(&end) -
-				timespec64_to_ns(&begin);
-			quota->charged_sz += sz;
-			if (quota->esz && quota->charged_sz >= quota->esz) {
-				quota->charge_target_from = t;
-				quota->charge_addr_from = r->ar.end + 1;
-			}
-		}
-		if (s->action != DAMOS_STAT)
-			r->age = 0;
+		damos_apply_scheme(c, t, r, s, sz);
+	}
+}
 
-update_stat:
-		s->stat.nr_tried++;
-		s->stat.sz_tried += sz;
-		if (sz_applied)
-			s->stat.nr_applied++;
-		s->stat.sz_applied += sz_applied;
+/*
+ * Prioritized candidates queue
+ *
+ * For schemes having a quota, the regions meeting the access pattern are
+ * scored only once, while the score histogram is built, and kept in a per
+ * scheme array that is then sorted in the descending order of the scores.
+ * Applying the scheme just pops the top of the array until the quota is
+ * charged or the minimum score is reached, instead of walking all regions
+ * and scoring each of them again.
+ */
+struct damos_candidate {
+	struct damon_target *t;
+	struct damon_region *r;
+	unsigned int score;
+};
+
+static int damos_candidate_cmp(const void *a, const void *b)
+{
+	const struct damos_candidate *ca = a, *cb = b;
+
+	return (int)cb->score - (int)ca->score;
+}
+
+static bool damos_reserve_queue(struct damos_quota *quota,
+		unsigned int nr_regions)
+{
+	struct damos_candidate *queue;
+
+	if (nr_regions <= quota->queue_cap)
+		return true;
+
+	queue = kvmalloc_array(nr_regions, sizeof(*queue), GFP_KERNEL);
+	if (!queue)
+		return false;
+	kvfree(quota->queue);
+	quota->queue = queue;
+	quota->queue_cap = nr_regions;
+	return true;
+}
+
+static void damos_apply_queued(struct damon_ctx *c, struct damos *s)
+{
+	struct damos_quota *quota = &s->quota;
+	struct damos_candidate *cand;
+	unsigned int i;
+
+	for (i = 0; i < quota->queue_len; i++) {
+		cand = &quota->queue[i];
+		if (quota->esz && cand->score < quota->min_score)
+			break;
+		if (quota->esz && quota->charged_sz >= quota->esz)
+			break;
+		/* could have been split by another scheme */
+		if (!__damos_valid_target(cand->r, s))
+			continue;
+		damos_apply_scheme(c, cand->t, cand->r, s,
+				damon_sz_region(cand->r));
 	}
+	quota->queue_len = 0;
 }
 
 /* Shouldn't be called if quota->ms and quota->sz are zero */
@@ -813,12 +902,17 @@ static void kdamond_apply_schemes(struct damon_ctx *c)
 	struct damon_target *t;
 	struct damon_region *r, *next_r;
 	struct damos *s;
+	unsigned int nr_regions = 0;
+
+	damon_for_each_target(t, c)
+		nr_regions += damon_nr_regions(t);
 
 	damon_for_each_scheme(s, c) {
 		struct damos_quota *quota = &s->quota;
 		unsigned long cumulated_sz;
 		unsigned int score, max_score = 0;
 
+		quota->queued = false;
 		if (!s->wmarks.activated)
 			continue;
 
@@ -840,6 +934,10 @@ static void kdamond_apply_schemes(struct damon_ctx *c)
 		if (!c->ops.get_scheme_score)
 			continue;
 
+		/* Without memory for the queue, rescore while walking */
+		quota->queued = damos_reserve_queue(quota, nr_regions);
+		quota->queue_len = 0;
+
 		/* Fill up the score histogram */
 		memset(quota->histogram, 0, sizeof(quota->histogram));
 		damon_for_each_target(t, c) {
@@ -851,6 +949,12 @@ static void kdamond_apply_schemes(struct damon_ctx *c)
 				quota->histogram[score] += damon_sz_region(r);
 				if (score > max_score)
 					max_score = score;
+				if (quota->queued)
+					quota->queue[quota->queue_len++] =
+						(struct damos_candidate){
+							.t = t, .r = r,
+							.score = score,
+						};
 			}
 		}
 
@@ -861,12 +965,22 @@ static void kdamond_apply_schemes(struct damon_ctx *c)
 				break;
 		}
 		quota->min_score = score;
+
+		if (quota->queued)
+			sort(quota->queue, quota->queue_len,
+					sizeof(*quota->queue),
+					damos_candidate_cmp, NULL);
 	}
 
 	damon_for_each_target(t, c) {
 		damon_for_each_region_safe(r, next_r, t)
 			damon_do_apply_schemes(c, t, r);
 	}
+
+	damon_for_each_scheme(s, c) {
+		if (s->quota.queued)
+			damos_apply_queued(c, s);
+	}
 }
 
 /*
@@ -1111,6 +1225,150 @@ static void kdamond_usleep(unsigned long usecs)
 		usleep_idle_range(usecs, usecs + 1);
 }
 
+/*
+ * Returns how long to sleep until the next sample, given that the access
+ * checks of the last one took @busy_ns.  Without a CPU budget, or while
+ * within it, that is simply the sampling interval.  Otherwise the sleep is
+ * stretched so that checks only take the budgeted share of the time, and
+ * smoothed so that one slow sample doesn't halve the sampling rate.
+ */
+static unsigned long kdamond_sample_sleep(struct damon_ctx *ctx, u64 busy_ns)
+{
+	unsigned long budget = ctx->attrs.cpu_budget;
+	unsigned long interval = ctx->attrs.sample_interval;
+	unsigned long sleep = interval;
+
+	if (budget && budget < 1000) {
+		u64 needed = div64_u64(busy_ns * (1000 - budget),
+				       budget * NSEC_PER_USEC);
+
+		sleep = min_t(u64, max_t(u64, needed, interval),
+			      max(ctx->attrs.aggr_interval, interval));
+	}
+
+	if (!ctx->sample_sleep_us)
+		ctx->sample_sleep_us = interval;
+	ctx->sample_sleep_us = (ctx->sample_sleep_us * 3 + sleep) / 4;
+	/* converge exactly once the pressure is gone */
+	if (sleep == interval && ctx->sample_sleep_us < interval + interval / 8)
+		ctx->sample_sleep_us = interval;
+	return ctx->sample_sleep_us;
+}
+
+/*
+ * Access checks sharding
+ *
+ * With &damon_attrs.nr_workers larger than one, the targets are dealt round
+ * robin to that many shards, and the per-target access check callbacks of
+ * each shard run from an unbound workqueue of the context.  kdamond waits for
+ * all of them before it goes on, so the targets list and the regions are
+ * never changed while the workers look at them.
+ */
+struct kdamond_shard {
+	struct work_struct work;
+	struct damon_ctx *ctx;
+	unsigned int idx;
+	unsigned int nr;
+	bool check;
+	unsigned int max_nr_accesses;
+};
+
+static void kdamond_shard_fn(struct work_struct *work)
+{
+	struct kdamond_shard *shard = container_of(work, struct kdamond_shard,
+			work);
+	struct damon_ctx *ctx = shard->ctx;
+	struct damon_target *t;
+	unsigned int i = 0;
+
+	shard->max_nr_accesses = 0;
+	damon_for_each_target(t, ctx) {
+		if (i++ % shard->nr != shard->idx)
+			continue;
+		if (shard->check)
+			shard->max_nr_accesses = max(shard->max_nr_accesses,
+					ctx->ops.check_accesses_target(ctx, t));
+		else
+			ctx->ops.prepare_access_checks_target(ctx, t);
+		cond_resched();
+	}
+}
+
+static unsigned int kdamond_nr_workers(struct damon_ctx *ctx)
+{
+	if (!ctx->ops.prepare_access_checks_target ||
+			!ctx->ops.check_accesses_target)
+		return 1;
+	return ctx->attrs.nr_workers ? ctx->attrs.nr_workers : 1;
+}
+
+static int kdamond_init_workers(struct damon_ctx *ctx)
+{
+	unsigned int i;
+
+	if (ctx->workers_wq)
+		return 0;
+
+	ctx->shards = kcalloc(DAMON_MAX_WORKERS, sizeof(*ctx->shards),
+			GFP_KERNEL);
+	if (!ctx->shards)
+		return -ENOMEM;
+	ctx->workers_wq = alloc_workqueue("kdamond.%d.wq", WQ_UNBOUND,
+			DAMON_MAX_WORKERS, current->pid);
+	if (!ctx->workers_wq) {
+		kfree(ctx->shards);
+		ctx->shards = NULL;
+		return -ENOMEM;
+	}
+	for (i = 0; i < DAMON_MAX_WORKERS; i++) {
+		INIT_WORK(&ctx->shards[i].work, kdamond_shard_fn);
+		ctx->shards[i].ctx = ctx;
+		ctx->shards[i].idx = i;
+	}
+	return 0;
+}
+
+static void kdamond_exit_workers(struct damon_ctx *ctx)
+{
+	if (!ctx->workers_wq)
+		return;
+	destroy_workqueue(ctx->workers_wq);
+	ctx->workers_wq = NULL;
+	kfree(ctx->shards);
+	ctx->shards = NULL;
+}
+
+/* Runs one of the access check steps, sharded if so requested */
+static unsigned int kdamond_run_shards(struct damon_ctx *ctx, bool check)
+{
+	unsigned int nr = kdamond_nr_workers(ctx);
+	unsigned int i, max_nr_accesses = 0;
+
+	/* fall back to kdamond alone if the workers can't be set up */
+	if (nr > 1 && kdamond_init_workers(ctx))
+		nr = 1;
+
+	if (nr == 1) {
+		if (!check && ctx->ops.prepare_access_checks)
+			ctx->ops.prepare_access_checks(ctx);
+		if (check && ctx->ops.check_accesses)
+			return ctx->ops.check_accesses(ctx);
+		return 0;
+	}
+
+	for (i = 0; i < nr; i++) {
+		ctx->shards[i].nr = nr;
+		ctx->shards[i].check = check;
+		queue_work(ctx->workers_wq, &ctx->shards[i].work);
+	}
+	flush_workqueue(ctx->workers_wq);
+
+	for (i = 0; i < nr; i++)
+		max_nr_accesses = max(max_nr_accesses,
+				ctx->shards[i].max_nr_accesses);
+	return max_nr_accesses;
+}
+
 /* Returns negative error code if it's not activated but should return */
 static int kdamond_wait_activation(struct damon_ctx *ctx)
 {
@@ -1149,6 +1407,7 @@ static int kdamond_fn(void *data)
 	struct damon_region *r, *next;
 	unsigned int max_nr_accesses = 0;
 	unsigned long sz_limit = 0;
+	u64 busy_ns = 0, start;
 
 	pr_debug("kdamond (%d) starts\n", current->pid);
 
@@ -1165,18 +1424,23 @@ static int kdamond_fn(void *data)
 		if (kdamond_wait_activation(ctx))
 			break;
 
-		if (ctx->ops.prepare_access_checks)
-			ctx->ops.prepare_access_checks(ctx);
+		start = ktime_get_ns();
+		kdamond_run_shards(ctx, false);
+		busy_ns += ktime_get_ns() - start;
 		if (ctx->callback.after_sampling &&
 				ctx->callback.after_sampling(ctx))
 			break;
 
-		kdamond_usleep(ctx->attrs.sample_interval);
+		kdamond_usleep(kdamond_sample_sleep(ctx, busy_ns));
 
-		if (ctx->ops.check_accesses)
-			max_nr_accesses = ctx->ops.check_accesses(ctx);
+		start = ktime_get_ns();
+		max_nr_accesses = kdamond_run_shards(ctx, true);
+		busy_ns = ktime_get_ns() - start;
 
 		if (kdamond_aggregate_interval_passed(ctx)) {
+			ctx->ops_stat = ctx->ops_stat_cur;
+			memset(&ctx->ops_stat_cur, 0,
+					sizeof(ctx->ops_stat_cur));
 			kdamond_merge_regions(ctx,
 					max_nr_accesses / 10,
 					sz_limit);
@@ -1206,6 +1470,7 @@ static int kdamond_fn(void *data)
 		ctx->callback.before_terminate(ctx);
 	if (ctx->ops.cleanup)
 		ctx->ops.cleanup(ctx);
+	kdamond_exit_workers(ctx);
 
 	pr_debug("kdamond (%d) finishes\n", current->pid);
 	mutex_lock(&ctx->kdamond_lock);
@@ -132,6 +132,9 @@ DEFINE_DAMON_MODULES_DAMOS_STATS_PARAMS(damon_lru_sort_cold_stat,
 		lru_sort_tried_cold_regions, lru_sorted_cold_regions,
 		cold_quota_exceeds);
 
+static struct damon_ops_stat damon_lru_sort_ops_stat;
+DEFINE_DAMON_MODULES_OPS_STATS_PARAMS(damon_lru_sort_ops_stat);
+
 static struct damos_access_pattern damon_lru_sort_stub_pattern = {
 	/* Find regions having PAGE_SIZE or larger size */
 	.min_sz_region = PAGE_SIZE,
@@ -330,6 +333,7 @@ static int damon_lru_sort_after_aggregation(struct damon_ctx *c)
 		else if (s->action == DAMOS_LRU_DEPRIO)
 			damon_lru_sort_cold_stat = s->stat;
 	}
+	damon_lru_sort_ops_stat = c->ops_stat;
 
 	return damon_lru_sort_handle_commit_inputs();
 }
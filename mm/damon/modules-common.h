@@ -44,3 +44,11 @@
 			0400);						\
 	module_param_named(nr_##qt_exceed_name, stat.qt_exceeds, ulong,	\
 			0400);
+
+#define DEFINE_DAMON_MODULES_OPS_STATS_PARAMS(stat)			\
+	module_param_named(nr_rmap_walks, stat.nr_rmap_walks, ulong,	\
+			0400);						\
+	module_param_named(nr_rmap_locks, stat.nr_rmap_locks, ulong,	\
+			0400);						\
+	module_param_named(rmap_walk_ns, stat.rmap_walk_ns, ulong,	\
+			0400);
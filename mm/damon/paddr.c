@@ -7,6 +7,7 @@
 
 #define pr_fmt(fmt) "damon-pa: " fmt
 
+#include <linux/migrate.h>
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
@@ -31,15 +32,173 @@ static bool __damon_pa_mkold(struct folio *folio, struct vm_area_struct *vma,
 	return true;
 }
 
-static void damon_pa_mkold(unsigned long paddr)
+/*
+ * Batched rmap walks
+ *
+ * Sampled folios of anon memory shared by many processes, or of the same
+ * file, mostly resolve to the same anon_vma tree or i_mmap tree.  Instead of
+ * one locked rmap_walk() per folio, up to DAMON_PA_BATCH sampled folios are
+ * collected, and each tree is locked once for all the folios of the batch
+ * that live in it, which are then walked with rmap_walk_locked().  KSM folios
+ * have their own locking and are always walked alone.
+ */
+#define DAMON_PA_BATCH	32
+
+struct damon_pa_batch {
+	struct damon_ctx *ctx;
+	struct rmap_walk_control *rwc;
+	unsigned int nr;
+	struct folio *folios[DAMON_PA_BATCH];
+	/* the caller's per-folio argument for rwc->rmap_one() */
+	void *args[DAMON_PA_BATCH];
+};
+
+static bool damon_pa_same_anon_root(struct folio *folio,
+		struct anon_vma *root)
+{
+	struct anon_vma *anon_vma;
+	bool same;
+
+	if (!folio_test_anon(folio) || folio_test_ksm(folio) ||
+			!folio_mapped(folio))
+		return false;
+
+	rcu_read_lock();
+	anon_vma = folio_anon_vma(folio);
+	same = anon_vma && READ_ONCE(anon_vma->root) == root;
+	rcu_read_unlock();
+	return same;
+}
+
+/* Walks batch->folios[@first] and the rest of the batch sharing its anon_vma */
+static void damon_pa_walk_anon(struct damon_pa_batch *batch, unsigned int first,
+		unsigned long *walked)
+{
+	struct damon_ctx *ctx = batch->ctx;
+	struct rmap_walk_control *rwc = batch->rwc;
+	struct anon_vma *anon_vma;
+	unsigned int i;
+
+	anon_vma = folio_lock_anon_vma_read(batch->folios[first], NULL);
+	if (!anon_vma) {
+		__set_bit(first, walked);
+		return;
+	}
+	ctx->ops_stat_cur.nr_rmap_locks++;
+
+	for (i = first; i < batch->nr; i++) {
+		if (test_bit(i, walked))
+			continue;
+		if (i != first && !damon_pa_same_anon_root(batch->folios[i],
+					anon_vma->root))
+			continue;
+		rwc->arg = batch->args[i];
+		rmap_walk_locked(batch->folios[i], rwc);
+		ctx->ops_stat_cur.nr_rmap_walks++;
+		__set_bit(i, walked);
+	}
+	anon_vma_unlock_read(anon_vma);
+}
+
+/* Walks batch->folios[@first] and the rest of the batch of the same file */
+static void damon_pa_walk_file(struct damon_pa_batch *batch, unsigned int first,
+		unsigned long *walked)
+{
+	struct damon_ctx *ctx = batch->ctx;
+	struct rmap_walk_control *rwc = batch->rwc;
+	struct address_space *mapping;
+	struct folio *folio;
+	unsigned int i;
+
+	folio = batch->folios[first];
+	__set_bit(first, walked);
+	if (!folio_trylock(folio))
+		return;
+	mapping = folio->mapping;
+	if (!mapping) {
+		folio_unlock(folio);
+		return;
+	}
+
+	i_mmap_lock_read(mapping);
+	ctx->ops_stat_cur.nr_rmap_locks++;
+	for (i = first; i < batch->nr; i++) {
+		if (i != first && test_bit(i, walked))
+			continue;
+		folio = batch->folios[i];
+		if (i != first) {
+			if (folio_test_anon(folio) ||
+					folio_raw_mapping(folio) != mapping ||
+					!folio_trylock(folio))
+				continue;
+			/* truncated since it was collected */
+			if (folio->mapping != mapping) {
+				folio_unlock(folio);
+				continue;
+			}
+		}
+		rwc->arg = batch->args[i];
+		rmap_walk_locked(folio, rwc);
+		ctx->ops_stat_cur.nr_rmap_walks++;
+		folio_unlock(folio);
+		__set_bit(i, walked);
+	}
+	i_mmap_unlock_read(mapping);
+}
+
+static void damon_pa_walk_batch(struct damon_pa_batch *batch)
+{
+	DECLARE_BITMAP(walked, DAMON_PA_BATCH);
+	struct damon_ctx *ctx = batch->ctx;
+	struct folio *folio;
+	u64 start = ktime_get_ns();
+	unsigned int i;
+
+	bitmap_zero(walked, DAMON_PA_BATCH);
+	for (i = 0; i < batch->nr; i++) {
+		if (test_bit(i, walked))
+			continue;
+		folio = batch->folios[i];
+		if (!folio_test_ksm(folio) && folio_test_anon(folio)) {
+			damon_pa_walk_anon(batch, i, walked);
+			continue;
+		}
+		if (!folio_test_ksm(folio)) {
+			damon_pa_walk_file(batch, i, walked);
+			continue;
+		}
+		if (folio_trylock(folio)) {
+			batch->rwc->arg = batch->args[i];
+			rmap_walk(folio, batch->rwc);
+			ctx->ops_stat_cur.nr_rmap_locks++;
+			ctx->ops_stat_cur.nr_rmap_walks++;
+			folio_unlock(folio);
+		}
+		__set_bit(i, walked);
+	}
+
+	for (i = 0; i < batch->nr; i++)
+		folio_put(batch->folios[i]);
+	batch->nr = 0;
+	ctx->ops_stat_cur.rmap_walk_ns += ktime_get_ns() - start;
+}
+
+/*
+ * Queues @folio, whose reference is taken over, for a batched rmap walk.  The
+ * caller makes sure there is room, and calls damon_pa_walk_batch() to flush.
+ */
+static void damon_pa_batch_add(struct damon_pa_batch *batch,
+		struct folio *folio, void *arg)
+{
+	batch->folios[batch->nr] = folio;
+	batch->args[batch->nr] = arg;
+	batch->nr++;
+}
+
+static void damon_pa_mkold(struct damon_pa_batch *batch, unsigned long paddr)
 {
 	struct folio *folio;
 	struct page *page = damon_get_page(PHYS_PFN(paddr));
-	struct rmap_walk_control rwc = {
-		.rmap_one = __damon_pa_mkold,
-		.anon_lock = folio_lock_anon_vma_read,
-	};
-	bool need_lock;
 
 	if (!page)
 		return;
@@ -47,38 +206,42 @@ static void damon_pa_mkold(unsigned long paddr)
 
 	if (!folio_mapped(folio) || !folio_raw_mapping(folio)) {
 		folio_set_idle(folio);
-		goto out;
+		folio_put(folio);
+		return;
 	}
 
-	need_lock = !folio_test_anon(folio) || folio_test_ksm(folio);
-	if (need_lock && !folio_trylock(folio))
-		goto out;
-
-	rmap_walk(folio, &rwc);
-
-	if (need_lock)
-		folio_unlock(folio);
-
-out:
-	folio_put(folio);
+	damon_pa_batch_add(batch, folio, NULL);
 }
 
-static void __damon_pa_prepare_access_check(struct damon_region *r)
+static void __damon_pa_prepare_access_check(struct damon_pa_batch *batch,
+		struct damon_region *r)
 {
 	r->sampling_addr = damon_rand(r->ar.start, r->ar.end);
 
-	damon_pa_mkold(r->sampling_addr);
+	damon_pa_mkold(batch, r->sampling_addr);
 }
 
 static void damon_pa_prepare_access_checks(struct damon_ctx *ctx)
 {
+	struct rmap_walk_control rwc = {
+		.rmap_one = __damon_pa_mkold,
+	};
+	struct damon_pa_batch batch = {
+		.ctx = ctx,
+		.rwc = &rwc,
+	};
 	struct damon_target *t;
 	struct damon_region *r;
 
 	damon_for_each_target(t, ctx) {
-		damon_for_each_region(r, t)
-			__damon_pa_prepare_access_check(r);
+		damon_for_each_region(r, t) {
+			__damon_pa_prepare_access_check(&batch, r);
+			if (batch.nr == DAMON_PA_BATCH)
+				damon_pa_walk_batch(&batch);
+		}
 	}
+	if (batch.nr)
+		damon_pa_walk_batch(&batch);
 }
 
 struct damon_pa_access_chk_result {
@@ -120,85 +283,120 @@ static bool __damon_pa_young(struct folio *folio, struct vm_area_struct *vma,
 	return !result->accessed;
 }
 
-static bool damon_pa_young(unsigned long paddr, unsigned long *page_sz)
+/*
+ * The regions of a check batch, and where each of them reads its result
+ * from.  Regions sampling the same folio as the previous one share its
+ * result, like the per-page result caching of the unbatched code did.
+ */
+struct damon_pa_check_batch {
+	struct damon_pa_batch walk;
+	unsigned int nr_regions;
+	struct damon_region *regions[DAMON_PA_BATCH];
+	struct damon_pa_access_chk_result *results[DAMON_PA_BATCH];
+	struct damon_pa_access_chk_result slots[DAMON_PA_BATCH];
+	struct folio *last_folio;
+	unsigned int max_nr_accesses;
+};
+
+static struct damon_pa_access_chk_result damon_pa_young_result = {
+	.page_sz = PAGE_SIZE,
+	.accessed = true,
+};
+
+static struct damon_pa_access_chk_result damon_pa_old_result = {
+	.page_sz = PAGE_SIZE,
+	.accessed = false,
+};
+
+static void damon_pa_check_batch_flush(struct damon_pa_check_batch *batch)
+{
+	struct damon_region *r;
+	unsigned int i;
+
+	if (batch->walk.nr)
+		damon_pa_walk_batch(&batch->walk);
+
+	for (i = 0; i < batch->nr_regions; i++) {
+		r = batch->regions[i];
+		if (batch->results[i]->accessed)
+			r->nr_accesses++;
+		batch->max_nr_accesses = max(r->nr_accesses,
+				batch->max_nr_accesses);
+	}
+	batch->nr_regions = 0;
+	batch->last_folio = NULL;
+}
+
+static void __damon_pa_check_access(struct damon_pa_check_batch *batch,
+		struct damon_region *r)
 {
+	struct damon_pa_access_chk_result *result;
+	unsigned int idx = batch->nr_regions++;
 	struct folio *folio;
-	struct page *page = damon_get_page(PHYS_PFN(paddr));
-	struct damon_pa_access_chk_result result = {
-		.page_sz = PAGE_SIZE,
-		.accessed = false,
-	};
-	struct rmap_walk_control rwc = {
-		.arg = &result,
-		.rmap_one = __damon_pa_young,
-		.anon_lock = folio_lock_anon_vma_read,
-	};
-	bool need_lock;
+	struct page *page;
 
-	if (!page)
-		return false;
+	batch->regions[idx] = r;
+	page = damon_get_page(PHYS_PFN(r->sampling_addr));
+	if (!page) {
+		batch->results[idx] = &damon_pa_old_result;
+		goto out;
+	}
 	folio = page_folio(page);
 
-	if (!folio_mapped(folio) || !folio_raw_mapping(folio)) {
-		if (folio_test_idle(folio))
-			result.accessed = false;
-		else
-			result.accessed = true;
+	/* If the region is in the last checked folio, reuse the result */
+	if (folio == batch->last_folio) {
+		batch->results[idx] = batch->results[idx - 1];
 		folio_put(folio);
 		goto out;
 	}
-
-	need_lock = !folio_test_anon(folio) || folio_test_ksm(folio);
-	if (need_lock && !folio_trylock(folio)) {
+	batch->last_folio = folio;
+
+	/*
+	 * A folio that lost its idle flag is known to be accessed, whether by
+	 * the LRU code or by the page table walks of MGLRU aging, without
+	 * having to look at its mappings.
+	 */
+	if (!folio_test_idle(folio) || !folio_mapped(folio) ||
+			!folio_raw_mapping(folio)) {
+		batch->results[idx] = folio_test_idle(folio) ?
+			&damon_pa_old_result : &damon_pa_young_result;
 		folio_put(folio);
-		return false;
+		goto out;
 	}
 
-	rmap_walk(folio, &rwc);
-
-	if (need_lock)
-		folio_unlock(folio);
-	folio_put(folio);
-
+	result = &batch->slots[batch->walk.nr];
+	*result = damon_pa_old_result;
+	batch->results[idx] = result;
+	damon_pa_batch_add(&batch->walk, folio, result);
 out:
-	*page_sz = result.page_sz;
-	return result.accessed;
-}
-
-static void __damon_pa_check_access(struct damon_region *r)
-{
-	static unsigned long last_addr;
-	static unsigned long last_page_sz = PAGE_SIZE;
-	static bool last_accessed;
-
-	/* If the region is in the last checked page, reuse the result */
-	if (ALIGN_DOWN(last_addr, last_page_sz) ==
-				ALIGN_DOWN(r->sampling_addr, last_page_sz)) {
-		if (last_accessed)
-			r->nr_accesses++;
-		return;
-	}
-
-	last_accessed = damon_pa_young(r->sampling_addr, &last_page_sz);
-	if (last_accessed)
-		r->nr_accesses++;
-
-	last_addr = r->sampling_addr;
+	if (batch->nr_regions == DAMON_PA_BATCH)
+		damon_pa_check_batch_flush(batch);
 }
 
 static unsigned int damon_pa_check_accesses(struct damon_ctx *ctx)
 {
+	struct rmap_walk_control rwc = {
+		.rmap_one = __damon_pa_young,
+	};
+	struct damon_pa_check_batch *batch;
 	struct damon_target *t;
 	struct damon_region *r;
-	unsigned int max_nr_accesses = 0;
+	unsigned int max_nr_accesses;
+
+	batch = kzalloc(sizeof(*batch), GFP_KERNEL);
+	if (!batch)
+		return 0;
+	batch->walk.ctx = ctx;
+	batch->walk.rwc = &rwc;
 
 	damon_for_each_target(t, ctx) {
-		damon_for_each_region(r, t) {
-			__damon_pa_check_access(r);
-			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
-		}
+		damon_for_each_region(r, t)
+			__damon_pa_check_access(batch, r);
 	}
+	damon_pa_check_batch_flush(batch);
 
+	max_nr_accesses = batch->max_nr_accesses;
+	kfree(batch);
 	return max_nr_accesses;
 }
 
@@ -260,6 +458,55 @@ static unsigned long damon_pa_deactivate_pages(struct damon_region *r)
 	return damon_pa_mark_accessed_or_deactivate(r, false);
 }
 
+/*
+ * Migrate the pages of the region to the scheme's target node, e.g. to promote
+ * hot pages from a CPU-less CXL or PMEM node to DRAM, or to demote cold ones.
+ * Like NUMA balancing, this is best effort: allocation on the target node is
+ * not allowed to reclaim and pages that cannot be migrated are put back.
+ */
+static unsigned long damon_pa_migrate(struct damon_region *r, struct damos *s)
+{
+	unsigned long addr;
+	unsigned int nr_succeeded = 0;
+	struct migration_target_control mtc = {
+		.nid = s->target_nid,
+		.gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_RECLAIM) |
+			__GFP_THISNODE | __GFP_NOWARN | __GFP_NOMEMALLOC,
+	};
+	LIST_HEAD(page_list);
+
+	if (s->target_nid == NUMA_NO_NODE || !node_online(s->target_nid))
+		return 0;
+
+	for (addr = r->ar.start; addr < r->ar.end; addr += PAGE_SIZE) {
+		struct page *page = damon_get_page(PHYS_PFN(addr));
+
+		if (!page)
+			continue;
+
+		if (page_to_nid(page) == s->target_nid || isolate_lru_page(page)) {
+			put_page(page);
+			continue;
+		}
+		mod_node_page_state(page_pgdat(page),
+				NR_ISOLATED_ANON + page_is_file_lru(page),
+				thp_nr_pages(page));
+		list_add(&page->lru, &page_list);
+		put_page(page);
+	}
+
+	if (!list_empty(&page_list)) {
+		if (migrate_pages(&page_list, alloc_migration_target, NULL,
+				(unsigned long)&mtc, MIGRATE_ASYNC,
+				s->action == DAMOS_MIGRATE_COLD ?
+				MR_DEMOTION : MR_NUMA_MISPLACED,
+				&nr_succeeded))
+			putback_movable_pages(&page_list);
+	}
+	cond_resched();
+	return nr_succeeded * PAGE_SIZE;
+}
+
 static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
@@ -271,6 +518,9 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		return damon_pa_mark_accessed(r);
 	case DAMOS_LRU_DEPRIO:
 		return damon_pa_deactivate_pages(r);
+	case DAMOS_MIGRATE_HOT:
+	case DAMOS_MIGRATE_COLD:
+		return damon_pa_migrate(r, scheme);
 	case DAMOS_STAT:
 		break;
 	default:
@@ -291,6 +541,10 @@ static int damon_pa_scheme_score(struct damon_ctx *context,
 		return damon_hot_score(context, r, scheme);
 	case DAMOS_LRU_DEPRIO:
 		return damon_cold_score(context, r, scheme);
+	case DAMOS_MIGRATE_HOT:
+		return damon_hot_score(context, r, scheme);
+	case DAMOS_MIGRATE_COLD:
+		return damon_cold_score(context, r, scheme);
 	default:
 		break;
 	}
@@ -113,6 +113,9 @@ static struct damos_stat damon_reclaim_stat;
 DEFINE_DAMON_MODULES_DAMOS_STATS_PARAMS(damon_reclaim_stat,
 		reclaim_tried_regions, reclaimed_regions, quota_exceeds);
 
+static struct damon_ops_stat damon_reclaim_ops_stat;
+DEFINE_DAMON_MODULES_OPS_STATS_PARAMS(damon_reclaim_ops_stat);
+
 static struct damon_ctx *ctx;
 static struct damon_target *target;
 
@@ -261,6 +264,7 @@ static int damon_reclaim_after_aggregation(struct damon_ctx *c)
 	/* update the stats parameter */
 	damon_for_each_scheme(s, c)
 		damon_reclaim_stat = s->stat;
+	damon_reclaim_ops_stat = c->ops_stat;
 
 	return damon_reclaim_handle_commit_inputs();
 }
@@ -388,15 +388,30 @@ static const struct mm_walk_ops damon_mkold_ops = {
 
 static void damon_va_mkold(struct mm_struct *mm, unsigned long addr)
 {
-	mmap_read_lock(mm);
+	mmap_assert_locked(mm);
 	walk_page_range(mm, addr, addr + 1, &damon_mkold_ops, NULL);
-	mmap_read_unlock(mm);
 }
 
 /*
  * Functions for the access checking of the regions
+ *
+ * The sampling addresses of a target are visited in one pass, in the
+ * ascending order of the regions list, under a single mmap_lock hold instead
+ * of taking the lock once per region.  With thousands of regions the lock
+ * round trips otherwise dominate.  The lock is only dropped when somebody
+ * else is waiting for it.
  */
 
+static void damon_va_relax_mmap_lock(struct mm_struct *mm)
+{
+	if (!mmap_lock_is_contended(mm) && !need_resched())
+		return;
+
+	mmap_read_unlock(mm);
+	cond_resched();
+	mmap_read_lock(mm);
+}
+
 static void __damon_va_prepare_access_check(struct mm_struct *mm,
 					struct damon_region *r)
 {
@@ -405,20 +420,30 @@ static void __damon_va_prepare_access_check(struct mm_struct *mm,
 	damon_va_mkold(mm, r->sampling_addr);
 }
 
-static void damon_va_prepare_access_checks(struct damon_ctx *ctx)
+static void damon_va_prepare_access_checks_target(struct damon_ctx *ctx,
+		struct damon_target *t)
 {
-	struct damon_target *t;
 	struct mm_struct *mm;
 	struct damon_region *r;
 
-	damon_for_each_target(t, ctx) {
-		mm = damon_get_mm(t);
-		if (!mm)
-			continue;
-		damon_for_each_region(r, t)
-			__damon_va_prepare_access_check(mm, r);
-		mmput(mm);
+	mm = damon_get_mm(t);
+	if (!mm)
+		return;
+	mmap_read_lock(mm);
+	damon_for_each_region(r, t) {
+		__damon_va_prepare_access_check(mm, r);
+		damon_va_relax_mmap_lock(mm);
 	}
+	mmap_read_unlock(mm);
+	mmput(mm);
+}
+
+static void damon_va_prepare_access_checks(struct damon_ctx *ctx)
+{
+	struct damon_target *t;
+
+	damon_for_each_target(t, ctx)
+		damon_va_prepare_access_checks_target(ctx, t);
 }
 
 struct damon_young_walk_private {
@@ -531,60 +556,77 @@ static bool damon_va_young(struct mm_struct *mm, unsigned long addr,
 		.young = false,
 	};
 
-	mmap_read_lock(mm);
+	mmap_assert_locked(mm);
 	walk_page_range(mm, addr, addr + 1, &damon_young_ops, &arg);
-	mmap_read_unlock(mm);
 	return arg.young;
 }
 
+/* The result of the last page checked, kept per target walk */
+struct damon_va_last_check {
+	unsigned long addr;
+	unsigned long page_sz;
+	bool accessed;
+};
+
 /*
  * Check whether the region was accessed after the last preparation
  *
  * mm	'mm_struct' for the given virtual address space
  * r	the region to be checked
+ * last	the result of the previous check in this walk of the target
  */
 static void __damon_va_check_access(struct mm_struct *mm,
-				struct damon_region *r, bool same_target)
+		struct damon_region *r, struct damon_va_last_check *last,
+		bool same_target)
 {
-	static unsigned long last_addr;
-	static unsigned long last_page_sz = PAGE_SIZE;
-	static bool last_accessed;
-
 	/* If the region is in the last checked page, reuse the result */
-	if (same_target && (ALIGN_DOWN(last_addr, last_page_sz) ==
-				ALIGN_DOWN(r->sampling_addr, last_page_sz))) {
-		if (last_accessed)
+	if (same_target && (ALIGN_DOWN(last->addr, last->page_sz) ==
+				ALIGN_DOWN(r->sampling_addr, last->page_sz))) {
+		if (last->accessed)
 			r->nr_accesses++;
 		return;
 	}
 
-	last_accessed = damon_va_young(mm, r->sampling_addr, &last_page_sz);
-	if (last_accessed)
+	last->accessed = damon_va_young(mm, r->sampling_addr, &last->page_sz);
+	if (last->accessed)
 		r->nr_accesses++;
 
-	last_addr = r->sampling_addr;
+	last->addr = r->sampling_addr;
 }
 
-static unsigned int damon_va_check_accesses(struct damon_ctx *ctx)
+static unsigned int damon_va_check_accesses_target(struct damon_ctx *ctx,
+		struct damon_target *t)
 {
-	struct damon_target *t;
+	struct damon_va_last_check last = { .page_sz = PAGE_SIZE };
 	struct mm_struct *mm;
 	struct damon_region *r;
 	unsigned int max_nr_accesses = 0;
-	bool same_target;
+	bool same_target = false;
 
-	damon_for_each_target(t, ctx) {
-		mm = damon_get_mm(t);
-		if (!mm)
-			continue;
-		same_target = false;
-		damon_for_each_region(r, t) {
-			__damon_va_check_access(mm, r, same_target);
-			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
-			same_target = true;
-		}
-		mmput(mm);
+	mm = damon_get_mm(t);
+	if (!mm)
+		return 0;
+	mmap_read_lock(mm);
+	damon_for_each_region(r, t) {
+		__damon_va_check_access(mm, r, &last, same_target);
+		max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
+		same_target = true;
+		damon_va_relax_mmap_lock(mm);
 	}
+	mmap_read_unlock(mm);
+	mmput(mm);
+
+	return max_nr_accesses;
+}
+
+static unsigned int damon_va_check_accesses(struct damon_ctx *ctx)
+{
+	struct damon_target *t;
+	unsigned int max_nr_accesses = 0;
+
+	damon_for_each_target(t, ctx)
+		max_nr_accesses = max(max_nr_accesses,
+				damon_va_check_accesses_target(ctx, t));
 
 	return max_nr_accesses;
 }
@@ -689,6 +731,9 @@ static int __init damon_va_initcall(void)
 		.update = damon_va_update,
 		.prepare_access_checks = damon_va_prepare_access_checks,
 		.check_accesses = damon_va_check_accesses,
+		.prepare_access_checks_target =
+			damon_va_prepare_access_checks_target,
+		.check_accesses_target = damon_va_check_accesses_target,
 		.reset_aggregated = NULL,
 		.target_valid = damon_va_target_valid,
 		.cleanup = NULL,
@@ -11,6 +11,7 @@
 #include <linux/gfp.h>
 #include <linux/hash.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
 #include <linux/mm.h>
 #include <linux/percpu.h>
 #include <linux/printk.h>
@@ -34,7 +35,6 @@ struct qlist_head {
 	struct qlist_node *head;
 	struct qlist_node *tail;
 	size_t bytes;
-	bool offline;
 };
 
 #define QLIST_INIT { NULL, NULL, 0 }
@@ -85,20 +85,63 @@ static void qlist_move_all(struct qlist_head *from, struct qlist_head *to)
 	(1024 > 4 * CONFIG_NR_CPUS ? 1024 : 4 * CONFIG_NR_CPUS)
 
 /*
- * The object quarantine consists of per-cpu queues and a global queue,
- * guarded by quarantine_lock.
+ * Objects are split into size classes, each with its own queues. Eviction
+ * picks the fullest queue, so that a burst of large objects is evicted on its
+ * own instead of pushing out many small objects long before their time.
+ */
+enum quarantine_class {
+	QUARANTINE_SMALL,
+	QUARANTINE_LARGE,
+	QUARANTINE_CLASSES,
+};
+
+/* Objects at least this large are quarantined as QUARANTINE_LARGE. */
+#define QUARANTINE_LARGE_SIZE 1024
+
+/*
+ * The object quarantine consists of per-cpu queues and per-node global queues,
+ * each guarded by its node's lock.
+ */
+struct cpu_quarantine {
+	struct qlist_head q[QUARANTINE_CLASSES];
+	bool offline;
+};
+
+static DEFINE_PER_CPU(struct cpu_quarantine, cpu_quarantine);
+
+/* Round-robin FIFO array of batches for one size class. */
+struct quarantine_ring {
+	struct qlist_head batches[QUARANTINE_BATCHES];
+	int head;
+	int tail;
+	/* Total size of all objects across all batches. */
+	unsigned long bytes;
+};
+
+struct node_quarantine {
+	raw_spinlock_t lock;
+	struct quarantine_ring ring[QUARANTINE_CLASSES];
+};
+
+/*
+ * Node 0's quarantine is static so that it is usable from early boot; it also
+ * takes objects freed on nodes that do not have a quarantine of their own.
  */
-static DEFINE_PER_CPU(struct qlist_head, cpu_quarantine);
-
-/* Round-robin FIFO array of batches. */
-static struct qlist_head global_quarantine[QUARANTINE_BATCHES];
-static int quarantine_head;
-static int quarantine_tail;
-/* Total size of all objects in global_quarantine across all batches. */
-static unsigned long quarantine_size;
-static DEFINE_RAW_SPINLOCK(quarantine_lock);
+static struct node_quarantine boot_node_quarantine = {
+	.lock = __RAW_SPIN_LOCK_UNLOCKED(boot_node_quarantine.lock),
+};
+static struct node_quarantine *node_quarantines[MAX_NUMNODES] = {
+	[0] = &boot_node_quarantine,
+};
+
+/* Total size of all objects in the global queues of all nodes. */
+static atomic_long_t quarantine_size;
 DEFINE_STATIC_SRCU(remove_cache_srcu);
 
+/* Background eviction thread, and whether it has been woken up. */
+static struct task_struct *quarantine_task;
+static bool quarantine_task_woken;
+
 #ifdef CONFIG_PREEMPT_RT
 struct cpu_shrink_qlist {
 	raw_spinlock_t lock;
@@ -114,7 +157,7 @@ static DEFINE_PER_CPU(struct cpu_shrink_qlist, shrink_qlist) = {
 static unsigned long quarantine_max_size;
 
 /*
- * Target size of a batch in global_quarantine.
+ * Target size of a batch in a quarantine_ring.
  * Usually equal to QUARANTINE_PERCPU_SIZE unless we have too much RAM.
  */
 static unsigned long quarantine_batch_size;
@@ -126,6 +169,26 @@ static unsigned long quarantine_batch_size;
  */
 #define QUARANTINE_FRACTION 32
 
+/*
+ * How far the quarantine may grow past quarantine_max_size, as a fraction of
+ * it, before allocations stop leaving eviction to quarantine_task and evict
+ * synchronously instead.
+ */
+#define QUARANTINE_SYNC_SLACK 8
+
+static struct node_quarantine *quarantine_node(int nid)
+{
+	struct node_quarantine *nq = READ_ONCE(node_quarantines[nid]);
+
+	return nq ? nq : &boot_node_quarantine;
+}
+
+static enum quarantine_class quarantine_class(struct kmem_cache *cache)
+{
+	return cache->size >= QUARANTINE_LARGE_SIZE ?
+		QUARANTINE_LARGE : QUARANTINE_SMALL;
+}
+
 static struct kmem_cache *qlink_to_cache(struct qlist_node *qlink)
 {
 	return virt_to_slab(qlink)->slab_cache;
@@ -190,9 +253,29 @@ static void qlist_free_all(struct qlist_head *q, struct kmem_cache *cache)
 	qlist_init(q);
 }
 
+static void quarantine_ring_put(struct quarantine_ring *ring,
+				struct qlist_head *from)
+{
+	WRITE_ONCE(ring->bytes, ring->bytes + from->bytes);
+	qlist_move_all(from, &ring->batches[ring->tail]);
+	if (ring->batches[ring->tail].bytes >=
+			READ_ONCE(quarantine_batch_size)) {
+		int new_tail;
+
+		new_tail = ring->tail + 1;
+		if (new_tail == QUARANTINE_BATCHES)
+			new_tail = 0;
+		if (new_tail != ring->head)
+			ring->tail = new_tail;
+	}
+}
+
 bool kasan_quarantine_put(struct kmem_cache *cache, void *object)
 {
 	unsigned long flags;
+	enum quarantine_class class;
+	struct cpu_quarantine *cq;
+	struct node_quarantine *nq;
 	struct qlist_head *q;
 	struct qlist_head temp = QLIST_INIT;
 	struct kasan_free_meta *meta = kasan_get_free_meta(cache, object);
@@ -214,29 +297,22 @@ bool kasan_quarantine_put(struct kmem_cache *cache, void *object)
 	 */
 	local_irq_save(flags);
 
-	q = this_cpu_ptr(&cpu_quarantine);
-	if (q->offline) {
+	cq = this_cpu_ptr(&cpu_quarantine);
+	if (cq->offline) {
 		local_irq_restore(flags);
 		return false;
 	}
+	class = quarantine_class(cache);
+	q = &cq->q[class];
 	qlist_put(q, &meta->quarantine_link, cache->size);
-	if (unlikely(q->bytes > QUARANTINE_PERCPU_SIZE)) {
+	if (unlikely(q->bytes > QUARANTINE_PERCPU_SIZE / QUARANTINE_CLASSES)) {
 		qlist_move_all(q, &temp);
+		atomic_long_add(temp.bytes, &quarantine_size);
 
-		raw_spin_lock(&quarantine_lock);
-		WRITE_ONCE(quarantine_size, quarantine_size + temp.bytes);
-		qlist_move_all(&temp, &global_quarantine[quarantine_tail]);
-		if (global_quarantine[quarantine_tail].bytes >=
-				READ_ONCE(quarantine_batch_size)) {
-			int new_tail;
-
-			new_tail = quarantine_tail + 1;
-			if (new_tail == QUARANTINE_BATCHES)
-				new_tail = 0;
-			if (new_tail != quarantine_head)
-				quarantine_tail = new_tail;
-		}
-		raw_spin_unlock(&quarantine_lock);
+		nq = quarantine_node(numa_node_id());
+		raw_spin_lock(&nq->lock);
+		quarantine_ring_put(&nq->ring[class], &temp);
+		raw_spin_unlock(&nq->lock);
 	}
 
 	local_irq_restore(flags);
@@ -244,15 +320,61 @@ bool kasan_quarantine_put(struct kmem_cache *cache, void *object)
 	return true;
 }
 
-void kasan_quarantine_reduce(void)
+static void quarantine_update_limits(void)
 {
 	size_t total_size, new_quarantine_size, percpu_quarantines;
+
+	/*
+	 * Update quarantine size in case of hotplug. Allocate a fraction of
+	 * the installed memory to quarantine minus per-cpu queue limits.
+	 */
+	total_size = (totalram_pages() << PAGE_SHIFT) /
+		QUARANTINE_FRACTION;
+	percpu_quarantines = QUARANTINE_PERCPU_SIZE * num_online_cpus();
+	new_quarantine_size = (total_size < percpu_quarantines) ?
+		0 : total_size - percpu_quarantines;
+	WRITE_ONCE(quarantine_max_size, new_quarantine_size);
+	/* Aim at consuming at most 1/2 of slots in quarantine. */
+	WRITE_ONCE(quarantine_batch_size, max((size_t)QUARANTINE_PERCPU_SIZE,
+		2 * total_size / QUARANTINE_BATCHES));
+}
+
+static bool quarantine_over_limit(void)
+{
+	return atomic_long_read(&quarantine_size) >
+		READ_ONCE(quarantine_max_size);
+}
+
+/*
+ * Evict the oldest batch of the fullest queue, across all nodes and size
+ * classes. Only the lock of the node owning that queue is taken.
+ */
+static void quarantine_evict(void)
+{
+	struct node_quarantine *nq, *victim = NULL;
+	struct quarantine_ring *ring;
+	struct qlist_head to_free = QLIST_INIT;
+	unsigned long bytes, victim_bytes = 0;
 	unsigned long flags;
+	int nid, class, victim_class = 0;
 	int srcu_idx;
-	struct qlist_head to_free = QLIST_INIT;
 
-	if (likely(READ_ONCE(quarantine_size) <=
-		   READ_ONCE(quarantine_max_size)))
+	quarantine_update_limits();
+
+	for_each_node(nid) {
+		nq = READ_ONCE(node_quarantines[nid]);
+		if (!nq)
+			continue;
+		for (class = 0; class < QUARANTINE_CLASSES; class++) {
+			bytes = READ_ONCE(nq->ring[class].bytes);
+			if (bytes > victim_bytes) {
+				victim = nq;
+				victim_class = class;
+				victim_bytes = bytes;
+			}
+		}
+	}
+	if (!victim)
 		return;
 
 	/*
@@ -265,34 +387,70 @@ void kasan_quarantine_reduce(void)
 	 * expected case).
 	 */
 	srcu_idx = srcu_read_lock(&remove_cache_srcu);
-	raw_spin_lock_irqsave(&quarantine_lock, flags);
+	raw_spin_lock_irqsave(&victim->lock, flags);
+
+	if (likely(quarantine_over_limit())) {
+		ring = &victim->ring[victim_class];
+		qlist_move_all(&ring->batches[ring->head], &to_free);
+		WRITE_ONCE(ring->bytes, ring->bytes - to_free.bytes);
+		atomic_long_sub(to_free.bytes, &quarantine_size);
+		/* Keep filling the current batch if it was the only one. */
+		if (ring->head != ring->tail) {
+			ring->head++;
+			if (ring->head == QUARANTINE_BATCHES)
+				ring->head = 0;
+		}
+	}
+
+	raw_spin_unlock_irqrestore(&victim->lock, flags);
+
+	qlist_free_all(&to_free, NULL);
+	srcu_read_unlock(&remove_cache_srcu, srcu_idx);
+}
+
+void kasan_quarantine_reduce(void)
+{
+	unsigned long max_size = READ_ONCE(quarantine_max_size);
+
+	if (likely(atomic_long_read(&quarantine_size) <= max_size))
+		return;
 
 	/*
-	 * Update quarantine size in case of hotplug. Allocate a fraction of
-	 * the installed memory to quarantine minus per-cpu queue limits.
+	 * Leave eviction to quarantine_task, unless it falls too far behind.
+	 * A wakeup lost to a racing quarantine_task going to sleep is made up
+	 * for by the next allocation, or by the synchronous fallback below.
 	 */
-	total_size = (totalram_pages() << PAGE_SHIFT) /
-		QUARANTINE_FRACTION;
-	percpu_quarantines = QUARANTINE_PERCPU_SIZE * num_online_cpus();
-	new_quarantine_size = (total_size < percpu_quarantines) ?
-		0 : total_size - percpu_quarantines;
-	WRITE_ONCE(quarantine_max_size, new_quarantine_size);
-	/* Aim at consuming at most 1/2 of slots in quarantine. */
-	WRITE_ONCE(quarantine_batch_size, max((size_t)QUARANTINE_PERCPU_SIZE,
-		2 * total_size / QUARANTINE_BATCHES));
-
-	if (likely(quarantine_size > quarantine_max_size)) {
-		qlist_move_all(&global_quarantine[quarantine_head], &to_free);
-		WRITE_ONCE(quarantine_size, quarantine_size - to_free.bytes);
-		quarantine_head++;
-		if (quarantine_head == QUARANTINE_BATCHES)
-			quarantine_head = 0;
+	if (READ_ONCE(quarantine_task) && atomic_long_read(&quarantine_size) <=
+			max_size + max_size / QUARANTINE_SYNC_SLACK) {
+		if (!READ_ONCE(quarantine_task_woken)) {
+			WRITE_ONCE(quarantine_task_woken, true);
+			wake_up_process(quarantine_task);
+		}
+		return;
 	}
 
-	raw_spin_unlock_irqrestore(&quarantine_lock, flags);
+	quarantine_evict();
+}
 
-	qlist_free_all(&to_free, NULL);
-	srcu_read_unlock(&remove_cache_srcu, srcu_idx);
+static int kasan_quarantined(void *unused)
+{
+	for (;;) {
+		WRITE_ONCE(quarantine_task_woken, false);
+		set_current_state(TASK_IDLE);
+		if (kthread_should_stop())
+			break;
+		if (!quarantine_over_limit()) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		quarantine_evict();
+		cond_resched();
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
 }
 
 static void qlist_move_cache(struct qlist_head *from,
@@ -344,24 +502,57 @@ static void __per_cpu_remove_cache(struct qlist_head *q, void *arg)
 
 static void per_cpu_remove_cache(void *arg)
 {
-	struct qlist_head *q;
+	struct cpu_quarantine *cq;
+	int class;
 
-	q = this_cpu_ptr(&cpu_quarantine);
+	cq = this_cpu_ptr(&cpu_quarantine);
 	/*
-	 * Ensure the ordering between the writing to q->offline and
+	 * Ensure the ordering between the writing to cq->offline and
 	 * per_cpu_remove_cache.  Prevent cpu_quarantine from being corrupted
 	 * by interrupt.
 	 */
-	if (READ_ONCE(q->offline))
+	if (READ_ONCE(cq->offline))
 		return;
-	__per_cpu_remove_cache(q, arg);
+	for (class = 0; class < QUARANTINE_CLASSES; class++)
+		__per_cpu_remove_cache(&cq->q[class], arg);
+}
+
+/* Move objects belonging to cache out of the global queues of one node. */
+static void node_remove_cache(struct node_quarantine *nq,
+			      struct qlist_head *to_free,
+			      struct kmem_cache *cache)
+{
+	struct quarantine_ring *ring;
+	unsigned long flags, i;
+	size_t bytes;
+	int class;
+
+	raw_spin_lock_irqsave(&nq->lock, flags);
+	for (class = 0; class < QUARANTINE_CLASSES; class++) {
+		ring = &nq->ring[class];
+		for (i = 0; i < QUARANTINE_BATCHES; i++) {
+			if (qlist_empty(&ring->batches[i]))
+				continue;
+			bytes = to_free->bytes;
+			qlist_move_cache(&ring->batches[i], to_free, cache);
+			bytes = to_free->bytes - bytes;
+			WRITE_ONCE(ring->bytes, ring->bytes - bytes);
+			atomic_long_sub(bytes, &quarantine_size);
+			/* Scanning whole quarantine can take a while. */
+			raw_spin_unlock_irqrestore(&nq->lock, flags);
+			cond_resched();
+			raw_spin_lock_irqsave(&nq->lock, flags);
+		}
+	}
+	raw_spin_unlock_irqrestore(&nq->lock, flags);
 }
 
 /* Free all quarantined objects belonging to cache. */
 void kasan_quarantine_remove_cache(struct kmem_cache *cache)
 {
-	unsigned long flags, i;
+	struct node_quarantine *nq;
 	struct qlist_head to_free = QLIST_INIT;
+	int nid;
 
 	/*
 	 * Must be careful to not miss any objects that are being moved from
@@ -375,6 +566,7 @@ void kasan_quarantine_remove_cache(struct kmem_cache *cache)
 #ifdef CONFIG_PREEMPT_RT
 	{
 		int cpu;
+		unsigned long flags;
 		struct cpu_shrink_qlist *sq;
 
 		for_each_online_cpu(cpu) {
@@ -387,17 +579,11 @@ void kasan_quarantine_remove_cache(struct kmem_cache *cache)
 	}
 #endif
 
-	raw_spin_lock_irqsave(&quarantine_lock, flags);
-	for (i = 0; i < QUARANTINE_BATCHES; i++) {
-		if (qlist_empty(&global_quarantine[i]))
-			continue;
-		qlist_move_cache(&global_quarantine[i], &to_free, cache);
-		/* Scanning whole quarantine can take a while. */
-		raw_spin_unlock_irqrestore(&quarantine_lock, flags);
-		cond_resched();
-		raw_spin_lock_irqsave(&quarantine_lock, flags);
+	for_each_node(nid) {
+		nq = READ_ONCE(node_quarantines[nid]);
+		if (nq)
+			node_remove_cache(nq, &to_free, cache);
 	}
-	raw_spin_unlock_irqrestore(&quarantine_lock, flags);
 
 	qlist_free_all(&to_free, cache);
 
@@ -412,23 +598,54 @@ static int kasan_cpu_online(unsigned int cpu)
 
 static int kasan_cpu_offline(unsigned int cpu)
 {
-	struct qlist_head *q;
+	struct cpu_quarantine *cq;
+	int class;
 
-	q = this_cpu_ptr(&cpu_quarantine);
-	/* Ensure the ordering between the writing to q->offline and
+	cq = this_cpu_ptr(&cpu_quarantine);
+	/* Ensure the ordering between the writing to cq->offline and
 	 * qlist_free_all. Otherwise, cpu_quarantine may be corrupted
 	 * by interrupt.
 	 */
-	WRITE_ONCE(q->offline, true);
+	WRITE_ONCE(cq->offline, true);
 	barrier();
-	qlist_free_all(q, NULL);
+	for (class = 0; class < QUARANTINE_CLASSES; class++)
+		qlist_free_all(&cq->q[class], NULL);
 	return 0;
 }
 
+static void __init kasan_node_quarantine_init(void)
+{
+	struct node_quarantine *nq;
+	int nid;
+
+	for_each_online_node(nid) {
+		if (node_quarantines[nid])
+			continue;
+		nq = kvzalloc_node(sizeof(*nq), GFP_KERNEL, nid);
+		if (!nq) {
+			pr_warn("kasan quarantine for node %d not allocated\n", nid);
+			continue;
+		}
+		raw_spin_lock_init(&nq->lock);
+		/* Pairs with READ_ONCE() in quarantine_node() and others. */
+		smp_store_release(&node_quarantines[nid], nq);
+	}
+}
+
 static int __init kasan_cpu_quarantine_init(void)
 {
+	struct task_struct *task;
 	int ret = 0;
 
+	kasan_node_quarantine_init();
+
+	task = kthread_run(kasan_quarantined, NULL, "kasan_quarantined");
+	if (IS_ERR(task))
+		pr_warn("kasan quarantine thread not started [%ld]\n",
+			PTR_ERR(task));
+	else
+		WRITE_ONCE(quarantine_task, task);
+
 	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "mm/kasan:online",
 				kasan_cpu_online, kasan_cpu_offline);
 	if (ret < 0)
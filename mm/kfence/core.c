@@ -108,6 +108,13 @@ module_param_named(deferrable, kfence_deferrable, bool, 0444);
 static bool kfence_check_on_panic __read_mostly;
 module_param_named(check_on_panic, kfence_check_on_panic, bool, 0444);
 
+/*
+ * If true, each CPU may sample one allocation per sample interval, gated by a
+ * per-CPU budget instead of the allocation gate and static key.
+ */
+static bool kfence_per_cpu_sample __read_mostly;
+module_param_named(per_cpu_sample, kfence_per_cpu_sample, bool, 0444);
+
 /* The pool of pages used for guard pages and objects. */
 char *__kfence_pool __read_mostly;
 EXPORT_SYMBOL(__kfence_pool); /* Export for test modules. */
@@ -132,6 +139,18 @@ DEFINE_STATIC_KEY_FALSE(kfence_allocation_key);
 /* Gates the allocation, ensuring only one succeeds in a given period. */
 atomic_t kfence_allocation_gate = ATOMIC_INIT(1);
 
+/* Enabled once at init with kfence.per_cpu_sample, and never toggled. */
+DEFINE_STATIC_KEY_FALSE(kfence_per_cpu_key);
+
+/* Number of sample intervals started; bumped by the allocation-gate timer. */
+unsigned long kfence_sample_gen;
+
+/* Last sample interval in which this CPU used its per-CPU sampling budget. */
+DEFINE_PER_CPU(unsigned long, kfence_cpu_sample_gen);
+
+/* Allocations that reached the sampling gate on this CPU. */
+static DEFINE_PER_CPU(unsigned long, kfence_gate_hits);
+
 /*
  * A Counting Bloom filter of allocation coverage: limits currently covered
  * allocations of the same source filling up the pool.
@@ -672,12 +691,26 @@ static bool kfence_init_pool_late(void)
 
 static int stats_show(struct seq_file *seq, void *v)
 {
-	int i;
+	unsigned long gen = READ_ONCE(kfence_sample_gen);
+	unsigned long hits = 0;
+	int i, cpu;
 
 	seq_printf(seq, "enabled: %i\n", READ_ONCE(kfence_enabled));
 	for (i = 0; i < KFENCE_COUNTER_COUNT; i++)
 		seq_printf(seq, "%s: %ld\n", counter_names[i], atomic_long_read(&counters[i]));
 
+	/*
+	 * Allocation hotness: how many allocations competed for each sample.
+	 * kfence_alloc() filters out allocations while the gate is closed, or
+	 * once the CPU's budget is used up, so this only counts the others.
+	 */
+	for_each_possible_cpu(cpu)
+		hits += per_cpu(kfence_gate_hits, cpu);
+	seq_printf(seq, "sample mode: %s\n", kfence_per_cpu_sample ? "per-cpu" : "global");
+	seq_printf(seq, "sample intervals: %lu\n", gen);
+	seq_printf(seq, "sampling gate hits: %lu\n", hits);
+	seq_printf(seq, "gate hits per interval: %lu\n", gen ? hits / gen : 0);
+
 	return 0;
 }
 DEFINE_SHOW_ATTRIBUTE(stats);
@@ -788,16 +821,19 @@ static DEFINE_IRQ_WORK(wake_up_kfence_timer_work, wake_up_kfence_timer);
  * static key cannot be done from an interrupt.
  *
  * Note: Toggling a static branch currently causes IPIs, and here we'll end up
- * with a total of 2 IPIs to all CPUs. If this ends up a problem in future (with
- * more aggressive sampling intervals), we could get away with a variant that
- * avoids IPIs, at the cost of not immediately capturing allocations if the
- * instructions remain cached.
+ * with a total of 2 IPIs to all CPUs. With kfence.per_cpu_sample, bumping
+ * kfence_sample_gen refills every CPU's sampling budget, and neither the gate
+ * nor the static key is touched.
  */
 static void toggle_allocation_gate(struct work_struct *work)
 {
 	if (!READ_ONCE(kfence_enabled))
 		return;
 
+	WRITE_ONCE(kfence_sample_gen, kfence_sample_gen + 1);
+	if (kfence_per_cpu_sample)
+		goto requeue;
+
 	atomic_set(&kfence_allocation_gate, 0);
 #ifdef CONFIG_KFENCE_STATIC_KEYS
 	/* Enable static key, and await allocation to happen. */
@@ -817,6 +853,7 @@ static void toggle_allocation_gate(struct work_struct *work)
 	/* Disable static key and reset timer. */
 	static_branch_disable(&kfence_allocation_key);
 #endif
+requeue:
 	queue_delayed_work(system_unbound_wq, &kfence_timer,
 			   msecs_to_jiffies(kfence_sample_interval));
 }
@@ -840,7 +877,9 @@ void __init kfence_alloc_pool(void)
 
 static void kfence_init_enable(void)
 {
-	if (!IS_ENABLED(CONFIG_KFENCE_STATIC_KEYS))
+	if (kfence_per_cpu_sample)
+		static_branch_enable(&kfence_per_cpu_key);
+	else if (!IS_ENABLED(CONFIG_KFENCE_STATIC_KEYS))
 		static_branch_enable(&kfence_allocation_key);
 
 	if (kfence_deferrable)
@@ -1009,6 +1048,17 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 	if (s->flags & SLAB_SKIP_KFENCE)
 		return NULL;
 
+	this_cpu_inc(kfence_gate_hits);
+
+	if (static_branch_unlikely(&kfence_per_cpu_key)) {
+		unsigned long gen = READ_ONCE(kfence_sample_gen);
+
+		/* Use up this CPU's budget; only one caller on it may win. */
+		if (this_cpu_xchg(kfence_cpu_sample_gen, gen) == gen)
+			return NULL;
+		goto sample;
+	}
+
 	if (atomic_inc_return(&kfence_allocation_gate) > 1)
 		return NULL;
 #ifdef CONFIG_KFENCE_STATIC_KEYS
@@ -1025,6 +1075,7 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 	}
 #endif
 
+sample:
 	if (!READ_ONCE(kfence_enabled))
 		return NULL;
 
@@ -14,6 +14,8 @@
 #include <linux/kmod.h>
 #include <linux/module.h>
 #include <linux/vmalloc.h>
+#include <linux/jhash.h>
+#include <linux/etherdevice.h>
 #include <linux/netfilter/x_tables.h>
 #include <linux/netfilter_bridge/ebtables.h>
 #include <linux/spinlock.h>
@@ -30,8 +32,9 @@
 
 /* Each cpu has its own set of counters, so there is no need for write_lock in
  * the softirq
- * For reading or updating the counters, the user context needs to
- * get a write_lock
+ * For updating the counters, the user context needs to get a write_lock;
+ * reading them only needs ebt_mutex, the per-cpu xt_recseq keeps the 64 bit
+ * values from tearing
  */
 
 /* The size of each set of counters is altered to get cache alignment */
@@ -40,6 +43,39 @@
 #define COUNTER_BASE(c, n, cpu) ((struct ebt_counter *)(((char *)c) + \
 				 COUNTER_OFFSET(n) * cpu))
 
+/* Runs of at least this many consecutive rules matching one exact source MAC
+ * get a hash index, so a frame only visits the rules of its own bucket
+ */
+#define EBT_MAC_RUN_MIN 4
+
+struct ebt_mac_hop {
+	/* position of the rule in its chain */
+	unsigned int pos;
+	/* offset of the rule in the entries blob */
+	unsigned int off;
+};
+
+struct ebt_mac_slot {
+	/* next rule of the run in the same bucket, or the end of the run;
+	 * next.off is 0 for rules that are not part of an indexed run
+	 */
+	struct ebt_mac_hop next;
+	/* only set for the first rule of a run */
+	unsigned int buckets;
+	unsigned int mask;
+};
+
+struct ebt_mac_index {
+	/* one slot per rule, indexed like the counters */
+	struct ebt_mac_slot *slots;
+	struct ebt_mac_hop buckets[];
+};
+
+static inline u32 ebt_mac_hash(const unsigned char *mac, u32 mask)
+{
+	return jhash(mac, ETH_ALEN, 0) & mask;
+}
+
 struct ebt_pernet {
 	struct list_head tables;
 };
@@ -203,7 +239,11 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 	struct ebt_entries *chaininfo;
 	const char *base;
 	const struct ebt_table_info *private;
+	const struct ebt_mac_slot *slots, *slot = NULL;
+	const struct ebt_mac_hop *hop;
 	struct xt_action_param acpar;
+	unsigned int addend;
+	bool hopping = false;
 
 	acpar.state   = state;
 	acpar.hotdrop = false;
@@ -222,8 +262,29 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 	counter_base = cb_base + private->hook_entry[hook]->counter_offset;
 	/* base for chain jumps */
 	base = private->entries;
+	slots = private->mac_index ? private->mac_index->slots : NULL;
 	i = 0;
 	while (i < nentries) {
+		if (slots) {
+			slot = &slots[chaininfo->counter_offset + i];
+			if (!slot->next.off) {
+				hopping = false;
+			} else if (slot->mask && !hopping) {
+				/* entering an indexed run: go straight to the
+				 * first rule that can match this source MAC
+				 */
+				hop = &private->mac_index->buckets[slot->buckets +
+					ebt_mac_hash(eth_hdr(skb)->h_source,
+						     slot->mask)];
+				hopping = true;
+				if (hop->pos != i) {
+					i = hop->pos;
+					point = (struct ebt_entry *)(base + hop->off);
+					continue;
+				}
+			}
+		}
+
 		if (ebt_basic_match(point, skb, state->in, state->out))
 			goto letscontinue;
 
@@ -234,7 +295,9 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 			return NF_DROP;
 		}
 
+		addend = xt_write_recseq_begin();
 		ADD_COUNTER(*(counter_base + i), skb->len, 1);
+		xt_write_recseq_end(addend);
 
 		/* these should only watch: not modify, nor tell us
 		 * what to do with the packet
@@ -246,9 +309,20 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 		if (!t->u.target->target)
 			verdict = ((struct ebt_standard_target *)t)->verdict;
 		else {
+			unsigned char src[ETH_ALEN];
+
+			if (hopping)
+				ether_addr_copy(src, eth_hdr(skb)->h_source);
 			acpar.target   = t->u.target;
 			acpar.targinfo = t->data;
 			verdict = t->u.target->target(skb, &acpar);
+			/* the bucket was picked for the old source MAC: if a
+			 * target such as snat changed it, walk the rest of the
+			 * run linearly
+			 */
+			if (hopping &&
+			    !ether_addr_equal(src, eth_hdr(skb)->h_source))
+				hopping = false;
 		}
 		if (verdict == EBT_ACCEPT) {
 			read_unlock_bh(&table->lock);
@@ -267,6 +341,7 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 
 			sp--;
 			/* put all the local variables right */
+			hopping = false;
 			i = cs[sp].n;
 			chaininfo = cs[sp].chaininfo;
 			nentries = chaininfo->nentries;
@@ -284,6 +359,7 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 		}
 
 		/* jump to a udc */
+		hopping = false;
 		cs[sp].n = i + 1;
 		cs[sp].chaininfo = chaininfo;
 		cs[sp].e = ebt_next_entry(point);
@@ -301,6 +377,11 @@ unsigned int ebt_do_table(void *priv, struct sk_buff *skb,
 		sp++;
 		continue;
 letscontinue:
+		if (hopping) {
+			i = slot->next.pos;
+			point = (struct ebt_entry *)(base + slot->next.off);
+			continue;
+		}
 		point = ebt_next_entry(point);
 		i++;
 	}
@@ -388,6 +469,11 @@ static inline void ebt_free_table_info(struct ebt_table_info *info)
 			vfree(info->chainstack[i]);
 		vfree(info->chainstack);
 	}
+	if (info->mac_index) {
+		vfree(info->mac_index->slots);
+		vfree(info->mac_index);
+		info->mac_index = NULL;
+	}
 }
 static inline int
 ebt_check_match(struct ebt_entry_match *m, struct xt_mtchk_param *par,
@@ -863,6 +949,116 @@ static int check_chainloops(const struct ebt_entries *chain, struct ebt_cl_stack
 	return 0;
 }
 
+static bool ebt_mac_keyed(const struct ebt_entry *e)
+{
+	return (e->bitmask & EBT_SOURCEMAC) &&
+	       !(e->invflags & EBT_ISOURCE) &&
+	       is_broadcast_ether_addr(e->sourcemsk);
+}
+
+/* Chain the rules of one run by bucket. The first pass only records the
+ * offset of each rule, the second one links them back to front so every
+ * bucket lists its rules in table order and ends at the end of the run.
+ */
+static void ebt_mac_index_fill(struct ebt_mac_index *idx, const char *base,
+			       unsigned int first, unsigned int pos,
+			       unsigned int off, unsigned int len,
+			       unsigned int end_off, unsigned int bucket,
+			       unsigned int nbuckets)
+{
+	struct ebt_mac_slot *slot = &idx->slots[first];
+	struct ebt_mac_hop *buckets = &idx->buckets[bucket];
+	const struct ebt_entry *e;
+	unsigned int i, own;
+
+	for (i = 0; i < nbuckets; i++) {
+		buckets[i].pos = pos + len;
+		buckets[i].off = end_off;
+	}
+
+	for (i = 0; i < len; i++) {
+		slot[i].next.off = off;
+		e = (const struct ebt_entry *)(base + off);
+		off += e->next_offset;
+	}
+
+	while (i--) {
+		own = slot[i].next.off;
+		e = (const struct ebt_entry *)(base + own);
+		bucket = ebt_mac_hash(e->sourcemac, nbuckets - 1);
+		slot[i].next = buckets[bucket];
+		buckets[bucket].pos = pos + i;
+		buckets[bucket].off = own;
+	}
+
+	slot[0].buckets = buckets - idx->buckets;
+	slot[0].mask = nbuckets - 1;
+}
+
+/* Find the runs of exact source MAC rules in every chain. Without @idx only
+ * the number of buckets needed is returned.
+ */
+static unsigned int ebt_mac_index_walk(const struct ebt_table_info *info,
+				       struct ebt_mac_index *idx)
+{
+	const char *base = info->entries;
+	unsigned int off = 0, nbuckets = 0;
+
+	while (off < info->entries_size) {
+		const struct ebt_entries *chain = (const void *)(base + off);
+		unsigned int pos, start = 0, start_off = 0, run = 0, n;
+
+		off += sizeof(struct ebt_entries);
+		for (pos = 0; pos <= chain->nentries; pos++) {
+			const struct ebt_entry *e = (const void *)(base + off);
+
+			if (pos < chain->nentries && ebt_mac_keyed(e)) {
+				if (!run++) {
+					start = pos;
+					start_off = off;
+				}
+			} else {
+				if (run >= EBT_MAC_RUN_MIN) {
+					n = roundup_pow_of_two(run);
+					if (idx)
+						ebt_mac_index_fill(idx, base,
+							chain->counter_offset + start,
+							start, start_off, run, off,
+							nbuckets, n);
+					nbuckets += n;
+				}
+				run = 0;
+			}
+			if (pos < chain->nentries)
+				off += e->next_offset;
+		}
+	}
+	return nbuckets;
+}
+
+/* The index is only a shortcut, the table works fine without it */
+static void ebt_build_mac_index(struct ebt_table_info *newinfo)
+{
+	struct ebt_mac_index *idx;
+	unsigned int nbuckets;
+
+	nbuckets = ebt_mac_index_walk(newinfo, NULL);
+	if (!nbuckets)
+		return;
+
+	idx = vmalloc(struct_size(idx, buckets, nbuckets));
+	if (!idx)
+		return;
+	idx->slots = vzalloc(array_size(newinfo->nentries,
+					sizeof(*idx->slots)));
+	if (!idx->slots) {
+		vfree(idx);
+		return;
+	}
+	ebt_mac_index_walk(newinfo, idx);
+	newinfo->mac_index = idx;
+}
+
 /* do the parsing of the table/chains/entries/matches/watchers/targets, heh */
 static int translate_table(struct net *net, const char *name,
 			   struct ebt_table_info *newinfo)
@@ -978,6 +1174,8 @@ static int translate_table(struct net *net, const char *name,
 	if (ret != 0) {
 		EBT_ENTRY_ITERATE(newinfo->entries, newinfo->entries_size,
 				  ebt_cleanup_entry, net, &i);
+	} else {
+		ebt_build_mac_index(newinfo);
 	}
 	vfree(cl_s);
 	return ret;
@@ -1005,6 +1203,32 @@ static void get_counters(const struct ebt_counter *oldcounters,
 	}
 }
 
+/* called with ebt_mutex held; the softirq keeps running on the table */
+static void get_counters_lockless(const struct ebt_counter *oldcounters,
+				  struct ebt_counter *counters,
+				  unsigned int nentries)
+{
+	const struct ebt_counter *counter_base;
+	unsigned int i, cpu, start;
+	u64 bcnt, pcnt;
+
+	memset(counters, 0, array_size(nentries, sizeof(*counters)));
+	for_each_possible_cpu(cpu) {
+		seqcount_t *s = &per_cpu(xt_recseq, cpu);
+
+		counter_base = COUNTER_BASE(oldcounters, nentries, cpu);
+		for (i = 0; i < nentries; i++) {
+			do {
+				start = read_seqcount_begin(s);
+				bcnt = counter_base[i].bcnt;
+				pcnt = counter_base[i].pcnt;
+			} while (read_seqcount_retry(s, start));
+			ADD_COUNTER(counters[i], bcnt, pcnt);
+		}
+		cond_resched();
+	}
+}
+
 static int do_replace_finish(struct net *net, struct ebt_replace *repl,
 			      struct ebt_table_info *newinfo)
 {
@@ -1025,6 +1249,7 @@ static int do_replace_finish(struct net *net, struct ebt_replace *repl,
 	}
 
 	newinfo->chainstack = NULL;
+	newinfo->mac_index = NULL;
 	ret = ebt_verify_pointers(repl, newinfo);
 	if (ret != 0)
 		goto free_counterstmp;
@@ -1223,6 +1448,7 @@ int ebt_register_table(struct net *net, const struct ebt_table *input_table,
 
 	/* fill in newinfo and parse the entries */
 	newinfo->chainstack = NULL;
+	newinfo->mac_index = NULL;
 	for (i = 0; i < NF_BR_NUMHOOKS; i++) {
 		if ((repl->valid_hooks & (1 << i)) == 0)
 			newinfo->hook_entry[i] = NULL;
@@ -1530,9 +1756,7 @@ static int copy_counters_to_user(struct ebt_table *t,
 	if (!counterstmp)
 		return -ENOMEM;
 
-	write_lock_bh(&t->lock);
-	get_counters(oldcounters, counterstmp, nentries);
-	write_unlock_bh(&t->lock);
+	get_counters_lockless(oldcounters, counterstmp, nentries);
 
 	if (copy_to_user(user, counterstmp,
 	    array_size(nentries, sizeof(struct ebt_counter))))
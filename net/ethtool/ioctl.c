@@ -1938,7 +1938,7 @@ static int ethtool_get_strings(struct net_device *dev, void __user *useraddr)
 	gstrings.len = ret;
 
 	if (gstrings.len) {
-		data = vzalloc(array_size(gstrings.len, ETH_GSTRING_LEN));
+		data = kvcalloc(gstrings.len, ETH_GSTRING_LEN, GFP_KERNEL);
 		if (!data)
 			return -ENOMEM;
 
@@ -1958,7 +1958,7 @@ static int ethtool_get_strings(struct net_device *dev, void __user *useraddr)
 	ret = 0;
 
 out:
-	vfree(data);
+	kvfree(data);
 	return ret;
 }
 
@@ -2053,7 +2053,7 @@ static int ethtool_get_stats(struct net_device *dev, void __user *useraddr)
 	stats.n_stats = n_stats;
 
 	if (n_stats) {
-		data = vzalloc(array_size(n_stats, sizeof(u64)));
+		data = kvcalloc(n_stats, sizeof(u64), GFP_KERNEL);
 		if (!data)
 			return -ENOMEM;
 		ops->get_ethtool_stats(dev, &stats, data);
@@ -2070,7 +2070,7 @@ static int ethtool_get_stats(struct net_device *dev, void __user *useraddr)
 	ret = 0;
 
  out:
-	vfree(data);
+	kvfree(data);
 	return ret;
 }
 
@@ -2104,7 +2104,7 @@ static int ethtool_get_phy_stats(struct net_device *dev, void __user *useraddr)
 	stats.n_stats = n_stats;
 
 	if (n_stats) {
-		data = vzalloc(array_size(n_stats, sizeof(u64)));
+		data = kvcalloc(n_stats, sizeof(u64), GFP_KERNEL);
 		if (!data)
 			return -ENOMEM;
 
@@ -2129,7 +2129,7 @@ static int ethtool_get_phy_stats(struct net_device *dev, void __user *useraddr)
 	ret = 0;
 
  out:
-	vfree(data);
+	kvfree(data);
 	return ret;
 }
 
@@ -489,6 +489,9 @@ int hsr_dev_finalize(struct net_device *hsr_dev, struct net_device *slave[2],
 	INIT_LIST_HEAD(&hsr->node_db);
 	INIT_LIST_HEAD(&hsr->self_node_db);
 	spin_lock_init(&hsr->list_lock);
+	res = hsr_node_tbl_init(hsr);
+	if (res < 0)
+		return res;
 
 	eth_hw_addr_set(hsr_dev, slave[0]->dev_addr);
 
@@ -507,7 +510,7 @@ int hsr_dev_finalize(struct net_device *hsr_dev, struct net_device *slave[2],
 	res = hsr_create_self_node(hsr, hsr_dev->dev_addr,
 				   slave[1]->dev_addr);
 	if (res < 0)
-		return res;
+		goto err_del_nodes;
 
 	spin_lock_init(&hsr->seqnr_lock);
 	/* Overflow soon to find bugs easier: */
@@ -552,6 +555,8 @@ int hsr_dev_finalize(struct net_device *hsr_dev, struct net_device *slave[2],
 	hsr_del_ports(hsr);
 err_add_master:
 	hsr_del_self_node(hsr);
+err_del_nodes:
+	hsr_del_nodes(hsr);
 
 	if (unregister)
 		unregister_netdevice(hsr_dev);
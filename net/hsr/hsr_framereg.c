@@ -15,6 +15,7 @@
 #include <linux/etherdevice.h>
 #include <linux/slab.h>
 #include <linux/rculist.h>
+#include <linux/rhashtable.h>
 #include "hsr_main.h"
 #include "hsr_framereg.h"
 #include "hsr_netlink.h"
@@ -55,19 +56,101 @@ bool hsr_addr_is_self(struct hsr_priv *hsr, unsigned char *addr)
 	return false;
 }
 
+/* node_db is indexed by both addresses of a node, so that looking up the
+ * sender of a frame doesn't depend on the size of the ring. rhashtable
+ * resizes the tables behind the RCU readers' backs.
+ */
+static const struct rhashtable_params hsr_node_ht_params = {
+	.head_offset = offsetof(struct hsr_node, hnode_a),
+	.key_offset = offsetof(struct hsr_node, macaddress_A),
+	.key_len = ETH_ALEN,
+	.automatic_shrinking = true,
+};
+
+static const struct rhashtable_params hsr_node_b_ht_params = {
+	.head_offset = offsetof(struct hsr_node, hnode_b),
+	.key_offset = offsetof(struct hsr_node, macaddress_B),
+	.key_len = ETH_ALEN,
+	.automatic_shrinking = true,
+};
+
+int hsr_node_tbl_init(struct hsr_priv *hsr)
+{
+	int res;
+
+	res = rhashtable_init(&hsr->node_tbl, &hsr_node_ht_params);
+	if (res)
+		return res;
+
+	res = rhashtable_init(&hsr->node_tbl_b, &hsr_node_b_ht_params);
+	if (res)
+		rhashtable_destroy(&hsr->node_tbl);
+
+	return res;
+}
+
 /* Search for mac entry. Caller must hold rcu read lock.
  */
-static struct hsr_node *find_node_by_addr_A(struct list_head *node_db,
+static struct hsr_node *find_node_by_addr_A(struct hsr_priv *hsr,
 					    const unsigned char addr[ETH_ALEN])
+{
+	return rhashtable_lookup(&hsr->node_tbl, addr, hsr_node_ht_params);
+}
+
+/* Search for a node by either of its addresses. Caller must hold rcu read
+ * lock.
+ */
+static struct hsr_node *find_node_by_addr(struct hsr_priv *hsr,
+					  const unsigned char addr[ETH_ALEN])
 {
 	struct hsr_node *node;
 
-	list_for_each_entry_rcu(node, node_db, mac_list) {
-		if (ether_addr_equal(node->macaddress_A, addr))
-			return node;
+	node = find_node_by_addr_A(hsr, addr);
+	if (node)
+		return node;
+
+	return rhashtable_lookup(&hsr->node_tbl_b, addr, hsr_node_b_ht_params);
+}
+
+/* Take a node out of node_db. Caller must hold hsr->list_lock. */
+static void hsr_remove_node(struct hsr_priv *hsr, struct hsr_node *node)
+{
+	lockdep_assert_held(&hsr->list_lock);
+
+	if (node->removed)
+		return;
+
+	list_del_rcu(&node->mac_list);
+	rhashtable_remove_fast(&hsr->node_tbl, &node->hnode_a,
+			       hsr_node_ht_params);
+	if (node->hashed_b)
+		rhashtable_remove_fast(&hsr->node_tbl_b, &node->hnode_b,
+				       hsr_node_b_ht_params);
+	node->hashed_b = false;
+	node->removed = true;
+	/* Note that we need to free this entry later: */
+	kfree_rcu(node, rcu_head);
+}
+
+static void hsr_set_node_addr_B(struct hsr_priv *hsr, struct hsr_node *node,
+				const unsigned char addr[ETH_ALEN])
+{
+	spin_lock_bh(&hsr->list_lock);
+	if (node->hashed_b) {
+		if (ether_addr_equal(node->macaddress_B, addr))
+			goto out;
+		rhashtable_remove_fast(&hsr->node_tbl_b, &node->hnode_b,
+				       hsr_node_b_ht_params);
+		node->hashed_b = false;
 	}
 
-	return NULL;
+	ether_addr_copy(node->macaddress_B, addr);
+	if (!node->removed)
+		node->hashed_b = !rhashtable_lookup_insert_fast(&hsr->node_tbl_b,
+								&node->hnode_b,
+								hsr_node_b_ht_params);
+out:
+	spin_unlock_bh(&hsr->list_lock);
 }
 
 /* Helper for device init; the self_node_db is used in hsr_rcv() to recognize
@@ -116,13 +199,16 @@ void hsr_del_self_node(struct hsr_priv *hsr)
 	spin_unlock_bh(&hsr->list_lock);
 }
 
-void hsr_del_nodes(struct list_head *node_db)
+void hsr_del_nodes(struct hsr_priv *hsr)
 {
 	struct hsr_node *node;
 	struct hsr_node *tmp;
 
-	list_for_each_entry_safe(node, tmp, node_db, mac_list)
+	list_for_each_entry_safe(node, tmp, &hsr->node_db, mac_list)
 		kfree(node);
+
+	rhashtable_destroy(&hsr->node_tbl_b);
+	rhashtable_destroy(&hsr->node_tbl);
 }
 
 void prp_handle_san_frame(bool san, enum hsr_port_type port,
@@ -143,7 +229,6 @@ void prp_handle_san_frame(bool san, enum hsr_port_type port,
  * originating from the newly added node.
  */
 static struct hsr_node *hsr_add_node(struct hsr_priv *hsr,
-				     struct list_head *node_db,
 				     unsigned char addr[],
 				     u16 seq_out, bool san,
 				     enum hsr_port_type rx_port)
@@ -167,21 +252,25 @@ static struct hsr_node *hsr_add_node(struct hsr_priv *hsr,
 		new_node->time_in[i] = now;
 		new_node->time_out[i] = now;
 	}
-	for (i = 0; i < HSR_PT_PORTS; i++)
+	/* Everything up to seq_out counts as already sent */
+	for (i = 0; i < HSR_PT_PORTS; i++) {
 		new_node->seq_out[i] = seq_out;
+		new_node->seq_window[i] = ~0ULL;
+	}
 
 	if (san && hsr->proto_ops->handle_san_frame)
 		hsr->proto_ops->handle_san_frame(san, rx_port, new_node);
 
 	spin_lock_bh(&hsr->list_lock);
-	list_for_each_entry_rcu(node, node_db, mac_list,
-				lockdep_is_held(&hsr->list_lock)) {
-		if (ether_addr_equal(node->macaddress_A, addr))
-			goto out;
-		if (ether_addr_equal(node->macaddress_B, addr))
-			goto out;
-	}
-	list_add_tail_rcu(&new_node->mac_list, node_db);
+	rcu_read_lock();
+	node = find_node_by_addr(hsr, addr);
+	rcu_read_unlock();
+	if (node)
+		goto out;
+	if (rhashtable_insert_fast(&hsr->node_tbl, &new_node->hnode_a,
+				   hsr_node_ht_params))
+		goto out; /* No mem */
+	list_add_tail_rcu(&new_node->mac_list, &hsr->node_db);
 	spin_unlock_bh(&hsr->list_lock);
 	return new_node;
 out:
@@ -201,9 +290,8 @@ void prp_update_san_info(struct hsr_node *node, bool is_sup)
 
 /* Get the hsr_node from which 'skb' was sent.
  */
-struct hsr_node *hsr_get_node(struct hsr_port *port, struct list_head *node_db,
-			      struct sk_buff *skb, bool is_sup,
-			      enum hsr_port_type rx_port)
+struct hsr_node *hsr_get_node(struct hsr_port *port, struct sk_buff *skb,
+			      bool is_sup, enum hsr_port_type rx_port)
 {
 	struct hsr_priv *hsr = port->hsr;
 	struct hsr_node *node;
@@ -217,17 +305,11 @@ struct hsr_node *hsr_get_node(struct hsr_port *port, struct list_head *node_db,
 
 	ethhdr = (struct ethhdr *)skb_mac_header(skb);
 
-	list_for_each_entry_rcu(node, node_db, mac_list) {
-		if (ether_addr_equal(node->macaddress_A, ethhdr->h_source)) {
-			if (hsr->proto_ops->update_san_info)
-				hsr->proto_ops->update_san_info(node, is_sup);
-			return node;
-		}
-		if (ether_addr_equal(node->macaddress_B, ethhdr->h_source)) {
-			if (hsr->proto_ops->update_san_info)
-				hsr->proto_ops->update_san_info(node, is_sup);
-			return node;
-		}
+	node = find_node_by_addr(hsr, ethhdr->h_source);
+	if (node) {
+		if (hsr->proto_ops->update_san_info)
+			hsr->proto_ops->update_san_info(node, is_sup);
+		return node;
 	}
 
 	/* Everyone may create a node entry, connected node to a HSR/PRP
@@ -254,8 +336,7 @@ struct hsr_node *hsr_get_node(struct hsr_port *port, struct list_head *node_db,
 		}
 	}
 
-	return hsr_add_node(hsr, node_db, ethhdr->h_source, seq_out,
-			    san, rx_port);
+	return hsr_add_node(hsr, ethhdr->h_source, seq_out, san, rx_port);
 }
 
 /* Use the Supervision frame's info about an eventual macaddress_B for merging
@@ -271,7 +352,6 @@ void hsr_handle_sup_frame(struct hsr_frame_info *frame)
 	struct hsr_sup_tlv *hsr_sup_tlv;
 	struct hsr_node *node_real;
 	struct sk_buff *skb = NULL;
-	struct list_head *node_db;
 	struct ethhdr *ethhdr;
 	int i;
 	unsigned int pull_size = 0;
@@ -313,11 +393,10 @@ void hsr_handle_sup_frame(struct hsr_frame_info *frame)
 	hsr_sp = (struct hsr_sup_payload *)skb->data;
 
 	/* Merge node_curr (registered on macaddress_B) into node_real */
-	node_db = &port_rcv->hsr->node_db;
-	node_real = find_node_by_addr_A(node_db, hsr_sp->macaddress_A);
+	node_real = find_node_by_addr_A(hsr, hsr_sp->macaddress_A);
 	if (!node_real)
 		/* No frame received from AddrA of this node yet */
-		node_real = hsr_add_node(hsr, node_db, hsr_sp->macaddress_A,
+		node_real = hsr_add_node(hsr, hsr_sp->macaddress_A,
 					 HSR_SEQNR_START - 1, true,
 					 port_rcv->type);
 	if (!node_real)
@@ -357,7 +436,7 @@ void hsr_handle_sup_frame(struct hsr_frame_info *frame)
 		}
 	}
 
-	ether_addr_copy(node_real->macaddress_B, ethhdr->h_source);
+	hsr_set_node_addr_B(hsr, node_real, ethhdr->h_source);
 	spin_lock_bh(&node_real->seq_out_lock);
 	for (i = 0; i < HSR_PT_PORTS; i++) {
 		if (!node_curr->time_in_stale[i] &&
@@ -366,18 +445,16 @@ void hsr_handle_sup_frame(struct hsr_frame_info *frame)
 			node_real->time_in_stale[i] =
 						node_curr->time_in_stale[i];
 		}
-		if (seq_nr_after(node_curr->seq_out[i], node_real->seq_out[i]))
+		if (seq_nr_after(node_curr->seq_out[i], node_real->seq_out[i])) {
 			node_real->seq_out[i] = node_curr->seq_out[i];
+			node_real->seq_window[i] = node_curr->seq_window[i];
+		}
 	}
 	spin_unlock_bh(&node_real->seq_out_lock);
 	node_real->addr_B_port = port_rcv->type;
 
 	spin_lock_bh(&hsr->list_lock);
-	if (!node_curr->removed) {
-		list_del_rcu(&node_curr->mac_list);
-		node_curr->removed = true;
-		kfree_rcu(node_curr, rcu_head);
-	}
+	hsr_remove_node(hsr, node_curr);
 	spin_unlock_bh(&hsr->list_lock);
 
 done:
@@ -423,8 +500,7 @@ void hsr_addr_subst_dest(struct hsr_node *node_src, struct sk_buff *skb,
 	if (!is_unicast_ether_addr(eth_hdr(skb)->h_dest))
 		return;
 
-	node_dst = find_node_by_addr_A(&port->hsr->node_db,
-				       eth_hdr(skb)->h_dest);
+	node_dst = find_node_by_addr_A(port->hsr, eth_hdr(skb)->h_dest);
 	if (!node_dst) {
 		if (port->hsr->prot_version != PRP_V1 && net_ratelimit())
 			netdev_err(skb->dev, "%s: Unknown node\n", __func__);
@@ -455,6 +531,12 @@ void hsr_register_frame_in(struct hsr_node *node, struct hsr_port *port,
 /* 'skb' is a HSR Ethernet frame (with a HSR tag inserted), with a valid
  * ethhdr->h_source address and skb->mac_header set.
  *
+ * Duplicates are discarded with a sliding window as in IEC 62439-3: the
+ * HSR_SEQ_WINDOW sequence numbers up to the highest one sent on the port
+ * are remembered one by one, so frames that got reordered between the two
+ * LANs are still forwarded once. Anything older than the window counts as
+ * already sent.
+ *
  * Return:
  *	 1 if frame can be shown to have been sent recently on this interface,
  *	 0 otherwise, or
@@ -463,16 +545,36 @@ void hsr_register_frame_in(struct hsr_node *node, struct hsr_port *port,
 int hsr_register_frame_out(struct hsr_port *port, struct hsr_node *node,
 			   u16 sequence_nr)
 {
+	enum hsr_port_type pt = port->type;
+	u16 delta;
+
 	spin_lock_bh(&node->seq_out_lock);
-	if (seq_nr_before_or_eq(sequence_nr, node->seq_out[port->type]) &&
-	    time_is_after_jiffies(node->time_out[port->type] +
-	    msecs_to_jiffies(HSR_ENTRY_FORGET_TIME))) {
+	if (time_is_before_eq_jiffies(node->time_out[pt] +
+				      msecs_to_jiffies(HSR_ENTRY_FORGET_TIME))) {
+		/* Too long ago to tell, start over */
+		node->seq_window[pt] = 1;
+	} else if (seq_nr_after(sequence_nr, node->seq_out[pt])) {
+		delta = sequence_nr - node->seq_out[pt];
+		if (delta < HSR_SEQ_WINDOW)
+			node->seq_window[pt] = (node->seq_window[pt] << delta) | 1;
+		else
+			node->seq_window[pt] = 1;
+	} else {
+		delta = node->seq_out[pt] - sequence_nr;
+		if (delta >= HSR_SEQ_WINDOW ||
+		    node->seq_window[pt] & BIT_ULL(delta)) {
+			spin_unlock_bh(&node->seq_out_lock);
+			return 1;
+		}
+		/* A late frame we haven't seen yet */
+		node->seq_window[pt] |= BIT_ULL(delta);
+		node->time_out[pt] = jiffies;
 		spin_unlock_bh(&node->seq_out_lock);
-		return 1;
+		return 0;
 	}
 
-	node->time_out[port->type] = jiffies;
-	node->seq_out[port->type] = sequence_nr;
+	node->time_out[pt] = jiffies;
+	node->seq_out[pt] = sequence_nr;
 	spin_unlock_bh(&node->seq_out_lock);
 	return 0;
 }
@@ -553,12 +655,7 @@ void hsr_prune_nodes(struct timer_list *t)
 		if (time_is_before_jiffies(timestamp +
 				msecs_to_jiffies(HSR_NODE_FORGET_TIME))) {
 			hsr_nl_nodedown(hsr, node->macaddress_A);
-			if (!node->removed) {
-				list_del_rcu(&node->mac_list);
-				node->removed = true;
-				/* Note that we need to free this entry later: */
-				kfree_rcu(node, rcu_head);
-			}
+			hsr_remove_node(hsr, node);
 		}
 	}
 	spin_unlock_bh(&hsr->list_lock);
@@ -603,7 +700,7 @@ int hsr_get_node_data(struct hsr_priv *hsr,
 	struct hsr_port *port;
 	unsigned long tdiff;
 
-	node = find_node_by_addr_A(&hsr->node_db, addr);
+	node = find_node_by_addr_A(hsr, addr);
 	if (!node)
 		return -ENOENT;
 
@@ -28,11 +28,11 @@ struct hsr_frame_info {
 	bool is_from_san;
 };
 
+int hsr_node_tbl_init(struct hsr_priv *hsr);
 void hsr_del_self_node(struct hsr_priv *hsr);
-void hsr_del_nodes(struct list_head *node_db);
-struct hsr_node *hsr_get_node(struct hsr_port *port, struct list_head *node_db,
-			      struct sk_buff *skb, bool is_sup,
-			      enum hsr_port_type rx_port);
+void hsr_del_nodes(struct hsr_priv *hsr);
+struct hsr_node *hsr_get_node(struct hsr_port *port, struct sk_buff *skb,
+			      bool is_sup, enum hsr_port_type rx_port);
 void hsr_handle_sup_frame(struct hsr_frame_info *frame);
 bool hsr_addr_is_self(struct hsr_priv *hsr, unsigned char *addr);
 
@@ -67,8 +67,17 @@ void prp_handle_san_frame(bool san, enum hsr_port_type port,
 			  struct hsr_node *node);
 void prp_update_san_info(struct hsr_node *node, bool is_sup);
 
+/* Number of sequence numbers before seq_out that are tracked individually
+ * for duplicate discard, see hsr_register_frame_out().
+ */
+#define HSR_SEQ_WINDOW		64
+
 struct hsr_node {
 	struct list_head	mac_list;
+	struct rhash_head	hnode_a;
+	struct rhash_head	hnode_b;
+	/* hnode_b is in hsr->node_tbl_b, protected by hsr->list_lock */
+	bool			hashed_b;
 	/* Protect R/W access to seq_out */
 	spinlock_t		seq_out_lock;
 	unsigned char		macaddress_A[ETH_ALEN];
@@ -82,6 +91,8 @@ struct hsr_node {
 	bool			san_a;
 	bool			san_b;
 	u16			seq_out[HSR_PT_PORTS];
+	/* Bit n set: seq_out - n was already sent on that port */
+	u64			seq_window[HSR_PT_PORTS];
 	bool			removed;
 	struct rcu_head		rcu_head;
 };
@@ -12,6 +12,7 @@
 
 #include <linux/netdevice.h>
 #include <linux/list.h>
+#include <linux/rhashtable-types.h>
 #include <linux/if_vlan.h>
 #include <linux/if_hsr.h>
 
@@ -186,6 +187,8 @@ struct hsr_priv {
 	struct rcu_head		rcu_head;
 	struct list_head	ports;
 	struct list_head	node_db;	/* Known HSR nodes */
+	struct rhashtable	node_tbl;	/* node_db by macaddress_A */
+	struct rhashtable	node_tbl_b;	/* node_db by macaddress_B */
 	struct list_head	self_node_db;	/* MACs of slaves */
 	struct timer_list	announce_timer;	/* Supervision frame dispatch */
 	struct timer_list	prune_timer;
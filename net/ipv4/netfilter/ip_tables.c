@@ -39,6 +39,36 @@ void *ipt_alloc_initial_table(const struct xt_table *info)
 }
 EXPORT_SYMBOL_GPL(ipt_alloc_initial_table);
 
+/* Packets run through ipt_do_table() and the rules looked at for them */
+struct ipt_eval_stats {
+	u64 packets;
+	u64 rules;
+};
+
+static DEFINE_PER_CPU(struct ipt_eval_stats, ipt_eval_stats);
+
+static int ipt_eval_stats_get(char *buffer, const struct kernel_param *kp)
+{
+	u64 packets = 0, rules = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct ipt_eval_stats *s = per_cpu_ptr(&ipt_eval_stats,
+							     cpu);
+
+		packets += READ_ONCE(s->packets);
+		rules += READ_ONCE(s->rules);
+	}
+
+	return sysfs_emit(buffer, "%llu %llu\n", packets, rules);
+}
+
+static const struct kernel_param_ops ipt_eval_stats_ops = {
+	.get = ipt_eval_stats_get,
+};
+module_param_cb(eval_stats, &ipt_eval_stats_ops, NULL, 0444);
+MODULE_PARM_DESC(eval_stats, "Packets traversed and rules evaluated for them");
+
 /* Returns whether matches rule or not. */
 /* Performance critical - called for every packet */
 static inline bool
@@ -105,6 +135,35 @@ get_entry(const void *base, unsigned int offset)
 	return (struct ipt_entry *)(base + offset);
 }
 
+/* Kind of run the skip link in ipt_entry.comefrom steps over, kept in the
+ * low bits of the link as entries are at least 4 byte aligned.
+ */
+enum {
+	IPT_SKIP_NONE,
+	IPT_SKIP_PROTO,
+	IPT_SKIP_IN,
+	IPT_SKIP_OUT,
+	IPT_SKIP_MASK = 3,
+};
+
+/* Performance critical: whether no rule of @e's run can match the packet */
+static inline bool
+ipt_skip_run(const struct ipt_entry *e, const struct iphdr *ip,
+	     const char *indev, const char *outdev)
+{
+	switch (e->comefrom & IPT_SKIP_MASK) {
+	case IPT_SKIP_PROTO:
+		return ip->protocol != e->ip.proto;
+	case IPT_SKIP_IN:
+		return ifname_compare_aligned(indev, e->ip.iniface,
+					      e->ip.iniface_mask) != 0;
+	case IPT_SKIP_OUT:
+		return ifname_compare_aligned(outdev, e->ip.outiface,
+					      e->ip.outiface_mask) != 0;
+	}
+	return false;
+}
+
 /* All zeroes == unconditional rule. */
 /* Mildly perf critical (only if packet tracing is on) */
 static inline bool unconditional(const struct ipt_entry *e)
@@ -239,6 +298,7 @@ ipt_do_table(void *priv,
 	const struct xt_table_info *private;
 	struct xt_action_param acpar;
 	unsigned int addend;
+	unsigned int nrules = 0;
 
 	/* Initialization */
 	stackidx = 0;
@@ -282,6 +342,15 @@ ipt_do_table(void *priv,
 		struct xt_counters *counter;
 
 		WARN_ON(!e);
+		nrules++;
+		/* Step over a run of rules that all require a protocol or
+		 * interface this packet does not have, see build_skips().
+		 */
+		if (e->comefrom && ipt_skip_run(e, ip, indev, outdev)) {
+			e = get_entry(table_base, e->comefrom & ~IPT_SKIP_MASK);
+			continue;
+		}
+
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
@@ -355,6 +424,9 @@ ipt_do_table(void *priv,
 		}
 	} while (!acpar.hotdrop);
 
+	__this_cpu_inc(ipt_eval_stats.packets);
+	__this_cpu_add(ipt_eval_stats.rules, nrules);
+
 	xt_write_recseq_end(addend);
 	local_bh_enable();
 
@@ -656,6 +728,78 @@ cleanup_entry(struct ipt_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+/* Whether @e, like @run, can only match packets with the protocol, input
+ * or output interface (depending on @kind) that @run requires.
+ */
+static bool ipt_same_run(const struct ipt_entry *run,
+			 const struct ipt_entry *e, int kind)
+{
+	switch (kind) {
+	case IPT_SKIP_PROTO:
+		return e->ip.proto && !(e->ip.invflags & IPT_INV_PROTO) &&
+		       e->ip.proto == run->ip.proto;
+	case IPT_SKIP_IN:
+		return memchr_inv(e->ip.iniface_mask, 0, IFNAMSIZ) &&
+		       !(e->ip.invflags & IPT_INV_VIA_IN) &&
+		       !memcmp(e->ip.iniface, run->ip.iniface, IFNAMSIZ) &&
+		       !memcmp(e->ip.iniface_mask, run->ip.iniface_mask,
+			       IFNAMSIZ);
+	case IPT_SKIP_OUT:
+		return memchr_inv(e->ip.outiface_mask, 0, IFNAMSIZ) &&
+		       !(e->ip.invflags & IPT_INV_VIA_OUT) &&
+		       !memcmp(e->ip.outiface, run->ip.outiface, IFNAMSIZ) &&
+		       !memcmp(e->ip.outiface_mask, run->ip.outiface_mask,
+			       IFNAMSIZ);
+	}
+	return false;
+}
+
+/* Once all entries are checked, comefrom (the hook mask handed to the
+ * checkentry functions) has served its purpose.  The rules are cut into
+ * runs of consecutive rules that all require the same protocol, the same
+ * input interface or the same output interface, taking whichever of the
+ * three gives the longest run at each point.  Every rule of a run gets a
+ * link to the first rule behind it, tagged with the kind of run, so
+ * ipt_do_table() can step over the whole run for a packet that lacks what
+ * the run requires.  First match semantics are kept as no rule in the run
+ * could have matched, and jumps or returns into the middle of a run only
+ * skip its remainder.  Chain heads, tails and policies are unconditional,
+ * so runs never cross a chain boundary.
+ */
+static void build_skips(void *entry0, unsigned int size)
+{
+	struct ipt_entry *run = entry0, *end, *e;
+	unsigned int len, best_len;
+	int kind, best;
+
+	BUILD_BUG_ON(__alignof__(struct ipt_entry) <= IPT_SKIP_MASK);
+
+	while ((void *)run < entry0 + size) {
+		best = IPT_SKIP_NONE;
+		best_len = 1;
+		end = ipt_next_entry(run);
+
+		for (kind = IPT_SKIP_PROTO; kind <= IPT_SKIP_OUT; kind++) {
+			len = 0;
+			for (e = run; (void *)e < entry0 + size &&
+			     ipt_same_run(run, e, kind); e = ipt_next_entry(e))
+				len++;
+
+			/* A run at the very end has nothing to skip to */
+			if (len > best_len && (void *)e < entry0 + size) {
+				best = kind;
+				best_len = len;
+				end = e;
+			}
+		}
+
+		for (e = run; e != end; e = ipt_next_entry(e))
+			e->comefrom = best == IPT_SKIP_NONE ? 0 :
+				      ((void *)end - entry0) | best;
+		run = end;
+	}
+}
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -731,6 +875,8 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		return ret;
 	}
 
+	build_skips(entry0, newinfo->size);
+
 	return ret;
  out_free:
 	kvfree(offsets);
@@ -187,7 +187,8 @@ static void kcm_rfree(struct sk_buff *skb)
 	}
 }
 
-static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+static int __kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb,
+			       bool wake)
 {
 	struct sk_buff_head *list = &sk->sk_receive_queue;
 
@@ -207,12 +208,26 @@ static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
 
 	skb_queue_tail(list, skb);
 
-	if (!sock_flag(sk, SOCK_DEAD))
+	if (wake && !sock_flag(sk, SOCK_DEAD))
 		sk->sk_data_ready(sk);
 
 	return 0;
 }
 
+static int kcm_queue_rcv_skb(struct sock *sk, struct sk_buff *skb)
+{
+	return __kcm_queue_rcv_skb(sk, skb, true);
+}
+
+static void kcm_rcv_wake(struct kcm_sock *kcm)
+{
+	struct sock *sk = &kcm->sk;
+
+	if (!skb_queue_empty_lockless(&sk->sk_receive_queue) &&
+	    !sock_flag(sk, SOCK_DEAD))
+		sk->sk_data_ready(sk);
+}
+
 /* Requeue received messages for a kcm socket to other kcm sockets. This is
  * called with a kcm socket is receive disabled.
  * RX mux lock held.
@@ -358,7 +373,11 @@ static void psock_data_ready(struct sock *sk)
 	read_unlock_bh(&sk->sk_callback_lock);
 }
 
-/* Called with lower sock held */
+/* Called with lower sock held. The reserved KCM socket stays the same for
+ * the whole strp_read_sock() pass, so a burst of small messages is queued
+ * back to back and the reader is woken once from kcm_read_sock_done()
+ * instead of once per message.
+ */
 static void kcm_rcv_strparser(struct strparser *strp, struct sk_buff *skb)
 {
 	struct kcm_psock *psock = container_of(strp, struct kcm_psock, strp);
@@ -373,8 +392,11 @@ static void kcm_rcv_strparser(struct strparser *strp, struct sk_buff *skb)
 		return;
 	}
 
-	if (kcm_queue_rcv_skb(&kcm->sk, skb)) {
-		/* Should mean socket buffer full */
+	if (__kcm_queue_rcv_skb(&kcm->sk, skb, false)) {
+		/* Should mean socket buffer full. Wake the reader for what
+		 * was queued so far before moving on to another socket.
+		 */
+		kcm_rcv_wake(kcm);
 		unreserve_rx_kcm(psock, false);
 		goto try_queue;
 	}
@@ -394,6 +416,8 @@ static int kcm_read_sock_done(struct strparser *strp, int err)
 {
 	struct kcm_psock *psock = container_of(strp, struct kcm_psock, strp);
 
+	if (psock->rx_kcm)
+		kcm_rcv_wake(psock->rx_kcm);
 	unreserve_rx_kcm(psock, true);
 
 	return err;
@@ -60,6 +60,8 @@ static const struct snmp_mib mptcp_snmp_list[] = {
 	SNMP_MIB_ITEM("RcvWndShared", MPTCP_MIB_RCVWNDSHARED),
 	SNMP_MIB_ITEM("RcvWndConflictUpdate", MPTCP_MIB_RCVWNDCONFLICTUPDATE),
 	SNMP_MIB_ITEM("RcvWndConflict", MPTCP_MIB_RCVWNDCONFLICT),
+	SNMP_MIB_ITEM("RcvBatch", MPTCP_MIB_RCVBATCH),
+	SNMP_MIB_ITEM("RcvBatchMerge", MPTCP_MIB_RCVBATCHMERGE),
 	SNMP_MIB_SENTINEL
 };
 
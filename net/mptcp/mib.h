@@ -55,6 +55,8 @@ enum linux_mptcp_mib_field {
 					 * conflict with another subflow while updating msk rcv wnd
 					 */
 	MPTCP_MIB_RCVWNDCONFLICT,	/* Conflict with while updating msk rcv wnd */
+	MPTCP_MIB_RCVBATCH,		/* Runs of subflow data inserted into OoO queue */
+	MPTCP_MIB_RCVBATCHMERGE,	/* Segments merged into a run before OoO insertion */
 	__MPTCP_MIB_MAX
 };
 
@@ -330,6 +330,44 @@ static void mptcp_data_queue_ofo(struct mptcp_sock *msk, struct sk_buff *skb)
 	mptcp_set_owner_r(skb, sk);
 }
 
+static void mptcp_ofo_batch_flush(struct mptcp_sock *msk,
+				  struct sk_buff **batch)
+{
+	if (!*batch)
+		return;
+
+	MPTCP_INC_STATS(sock_net((struct sock *)msk), MPTCP_MIB_RCVBATCH);
+	mptcp_data_queue_ofo(msk, *batch);
+	*batch = NULL;
+}
+
+/* Out-of-order data moved from a single subflow is usually a contiguous
+ * run of the same DSS mapping: stitch it together first, so that the msk
+ * OoO tree sees one insertion per run instead of one per skb, even when
+ * the runs of several subflows interleave.
+ */
+static void mptcp_ofo_batch_add(struct mptcp_sock *msk,
+				struct sk_buff **batch, struct sk_buff *skb)
+{
+	struct sock *sk = (struct sock *)msk;
+
+	if (*batch &&
+	    !after64(MPTCP_SKB_CB(skb)->end_seq,
+		     atomic64_read(&msk->rcv_wnd_sent)) &&
+	    mptcp_ooo_try_coalesce(msk, *batch, skb)) {
+		MPTCP_INC_STATS(sock_net(sk), MPTCP_MIB_RCVBATCHMERGE);
+		return;
+	}
+
+	mptcp_ofo_batch_flush(msk, batch);
+
+	/* the batch head is charged like a queued skb, coalescing into it
+	 * accounts for the added truesize
+	 */
+	mptcp_set_owner_r(skb, sk);
+	*batch = skb;
+}
+
 static bool mptcp_rmem_schedule(struct sock *sk, struct sock *ssk, int size)
 {
 	struct mptcp_sock *msk = mptcp_sk(sk);
@@ -350,7 +388,7 @@ static bool mptcp_rmem_schedule(struct sock *sk, struct sock *ssk, int size)
 
 static bool __mptcp_move_skb(struct mptcp_sock *msk, struct sock *ssk,
 			     struct sk_buff *skb, unsigned int offset,
-			     size_t copy_len)
+			     size_t copy_len, struct sk_buff **ofo_batch)
 {
 	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
 	struct sock *sk = (struct sock *)msk;
@@ -388,7 +426,7 @@ static bool __mptcp_move_skb(struct mptcp_sock *msk, struct sock *ssk,
 		__skb_queue_tail(&sk->sk_receive_queue, skb);
 		return true;
 	} else if (after64(MPTCP_SKB_CB(skb)->map_seq, msk->ack_seq)) {
-		mptcp_data_queue_ofo(msk, skb);
+		mptcp_ofo_batch_add(msk, ofo_batch, skb);
 		return false;
 	}
 
@@ -634,6 +672,7 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 {
 	struct mptcp_subflow_context *subflow = mptcp_subflow_ctx(ssk);
 	struct sock *sk = (struct sock *)msk;
+	struct sk_buff *ofo_batch = NULL;
 	unsigned int moved = 0;
 	bool more_data_avail;
 	struct tcp_sock *tp;
@@ -696,7 +735,8 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 			if (tp->urg_data)
 				done = true;
 
-			if (__mptcp_move_skb(msk, ssk, skb, offset, len))
+			if (__mptcp_move_skb(msk, ssk, skb, offset, len,
+					     &ofo_batch))
 				moved += len;
 			seq += len;
 
@@ -717,6 +757,7 @@ static bool __mptcp_move_skbs_from_subflow(struct mptcp_sock *msk,
 		}
 	} while (more_data_avail);
 
+	mptcp_ofo_batch_flush(msk, &ofo_batch);
 	*bytes += moved;
 	return done;
 }
@@ -1456,7 +1497,7 @@ bool mptcp_subflow_active(struct mptcp_subflow_context *subflow)
  * returns the subflow that will transmit the next DSS
  * additionally updates the rtx timeout
  */
-static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
+struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 {
 	struct subflow_send_info send_info[SSK_MODE_MAX];
 	struct mptcp_subflow_context *subflow;
@@ -1609,7 +1650,7 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 			int ret = 0;
 
 			prev_ssk = ssk;
-			ssk = mptcp_subflow_get_send(msk);
+			ssk = mptcp_sched_get_send(msk);
 
 			/* First check. If the ssk has changed since
 			 * the last round, release prev_ssk
@@ -1678,7 +1719,7 @@ static void __mptcp_subflow_push_pending(struct sock *sk, struct sock *ssk)
 			 * check for a different subflow usage only after
 			 * spooling the first chunk of data
 			 */
-			xmit_ssk = first ? ssk : mptcp_subflow_get_send(mptcp_sk(sk));
+			xmit_ssk = first ? ssk : mptcp_sched_get_send(mptcp_sk(sk));
 			if (!xmit_ssk)
 				goto out;
 			if (xmit_ssk != ssk) {
@@ -2283,7 +2324,7 @@ static void mptcp_tout_timer(struct timer_list *t)
  *
  * A backup subflow is returned only if that is the only kind available.
  */
-static struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
+struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
 {
 	struct sock *backup = NULL, *pick = NULL;
 	struct mptcp_subflow_context *subflow;
@@ -2610,7 +2651,7 @@ static void __mptcp_retrans(struct sock *sk)
 	mptcp_clean_una_wakeup(sk);
 
 	/* first check ssk: need to kick "stale" logic */
-	ssk = mptcp_subflow_get_retrans(msk);
+	ssk = mptcp_sched_get_retrans(msk);
 	dfrag = mptcp_rtx_head(sk);
 	if (!dfrag) {
 		if (mptcp_data_fin_enabled(msk)) {
@@ -2820,6 +2861,13 @@ static int mptcp_init_sock(struct sock *sk)
 	if (ret)
 		return ret;
 
+	rcu_read_lock();
+	ret = mptcp_init_sched(mptcp_sk(sk),
+			       mptcp_sched_find(mptcp_get_scheduler(net)));
+	rcu_read_unlock();
+	if (ret)
+		return ret;
+
 	/* fetch the ca name; do it outside __mptcp_init_sock(), so that clone will
 	 * propagate the correct value
 	 */
@@ -3255,6 +3303,10 @@ struct sock *mptcp_sk_clone_init(const struct sock *sk,
 	msk->wnd_end = msk->snd_nxt + tcp_sk(ssk)->snd_wnd;
 	msk->setsockopt_seq = mptcp_sk(sk)->setsockopt_seq;
 
+	/* the listener's scheduler was copied without a reference */
+	msk->sched = NULL;
+	mptcp_init_sched(msk, mptcp_sk(sk)->sched);
+
 	if (mp_opt->suboptions & OPTIONS_MPTCP_MPC) {
 		msk->can_ack = true;
 		msk->remote_key = mp_opt->sndr_key;
@@ -3393,6 +3445,7 @@ static void mptcp_destroy(struct sock *sk)
 	/* allow the following to close even the initial subflow */
 	msk->free_first = 1;
 	mptcp_destroy_common(msk, 0);
+	mptcp_release_sched(msk);
 	sk_sockets_allocated_dec(sk);
 }
 
@@ -3413,7 +3466,7 @@ void __mptcp_check_push(struct sock *sk, struct sock *ssk)
 		return;
 
 	if (!sock_owned_by_user(sk)) {
-		struct sock *xmit_ssk = mptcp_subflow_get_send(mptcp_sk(sk));
+		struct sock *xmit_ssk = mptcp_sched_get_send(mptcp_sk(sk));
 
 		if (xmit_ssk == ssk)
 			__mptcp_subflow_push_pending(sk, ssk);
@@ -4078,6 +4131,7 @@ void __init mptcp_proto_init(void)
 	}
 
 	mptcp_subflow_init();
+	mptcp_sched_init();
 	mptcp_pm_init();
 	mptcp_token_init();
 
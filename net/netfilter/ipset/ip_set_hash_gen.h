@@ -6,6 +6,7 @@
 
 #include <linux/rcupdate.h>
 #include <linux/jhash.h>
+#include <linux/hash.h>
 #include <linux/types.h>
 #include <linux/netfilter/nfnetlink.h>
 #include <linux/netfilter/ipset/ip_set.h>
@@ -51,6 +52,7 @@ struct hbucket {
 	DECLARE_BITMAP(used, AHASH_MAX_TUNED);
 	u8 size;		/* size of the array */
 	u8 pos;			/* position of the first free entry */
+	u32 bloom;		/* HBLOOM() bits of the values ever stored */
 	unsigned char value[]	/* the array of the values */
 		__aligned(__alignof__(u64));
 };
@@ -88,6 +90,10 @@ struct htable {
 };
 
 #define hbucket(h, i)		((h)->bucket[i])
+/* Bucket bloom bit of an element, taken from all bits of its full hash so
+ * that it stays useful when the elements of a bucket share all index bits
+ */
+#define HBLOOM(hash)		(1U << hash_32(hash, 5))
 #define ext_size(n, dsize)	\
 	(sizeof(struct hbucket) + (n) * (dsize))
 
@@ -216,6 +222,7 @@ htable_size(u8 hbits)
 
 #undef htype
 #undef HKEY
+#undef HKEY_HASH
 
 #define mtype_data_equal	IPSET_TOKEN(MTYPE, _data_equal)
 #ifdef IP_SET_HASH_WITH_NETS
@@ -265,16 +272,19 @@ htable_size(u8 hbits)
 
 #define htype			MTYPE
 
-#define HKEY(data, initval, htable_bits)			\
+#define HKEY_HASH(data, initval)				\
 ({								\
 	const u32 *__k = (const u32 *)data;			\
 	u32 __l = HKEY_DATALEN / sizeof(u32);			\
 								\
 	BUILD_BUG_ON(HKEY_DATALEN % sizeof(u32) != 0);		\
 								\
-	jhash2(__k, __l, initval) & jhash_mask(htable_bits);	\
+	jhash2(__k, __l, initval);				\
 })
 
+#define HKEY(data, initval, htable_bits)			\
+	(HKEY_HASH(data, initval) & jhash_mask(htable_bits))
+
 /* The generic hash structure */
 struct htype {
 	struct htable __rcu *table; /* the hash table */
@@ -531,6 +541,7 @@ mtype_gc_do(struct ip_set *set, struct htype *h, struct htable *t, u32 r)
 				d++;
 			}
 			tmp->pos = d;
+			tmp->bloom = n->bloom;
 			t->hregion[r].ext_size -=
 				ext_size(AHASH_INIT_SIZE, dsize);
 			rcu_assign_pointer(hbucket(t, i), tmp);
@@ -619,6 +630,7 @@ mtype_resize(struct ip_set *set, bool retried)
 	struct mtype_elem *data;
 	struct mtype_elem *d;
 	struct hbucket *n, *m;
+	u32 hash;
 	struct list_head *l, *lt;
 	struct mtype_resize_ad *x;
 	u32 i, j, r, nr, key;
@@ -687,7 +699,8 @@ mtype_resize(struct ip_set *set, bool retried)
 				data = tmp;
 				mtype_data_reset_flags(data, &flags);
 #endif
-				key = HKEY(data, h->initval, htable_bits);
+				hash = HKEY_HASH(data, h->initval);
+				key = hash & jhash_mask(htable_bits);
 				m = __ipset_dereference(hbucket(t, key));
 				nr = ahash_region(key, htable_bits);
 				if (!m) {
@@ -730,6 +743,7 @@ mtype_resize(struct ip_set *set, bool retried)
 				}
 				d = ahash_data(m, m->pos, dsize);
 				memcpy(d, data, dsize);
+				m->bloom |= HBLOOM(hash);
 				set_bit(m->pos++, m->used);
 				t->hregion[nr].elements++;
 #ifdef IP_SET_HASH_WITH_NETS
@@ -834,11 +848,12 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	int i, j = -1, ret;
 	bool flag_exist = flags & IPSET_FLAG_EXIST;
 	bool deleted = false, forceadd = false, reuse = false;
-	u32 r, key, multi = 0, elements, maxelem;
+	u32 r, key, hash, multi = 0, elements, maxelem;
 
 	rcu_read_lock_bh();
 	t = rcu_dereference_bh(h->table);
-	key = HKEY(value, h->initval, t->htable_bits);
+	hash = HKEY_HASH(value, h->initval);
+	key = hash & jhash_mask(t->htable_bits);
 	r = ahash_region(key, t->htable_bits);
 	atomic_inc(&t->uref);
 	elements = t->hregion[r].elements;
@@ -971,6 +986,7 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	/* Must come last for the case when timed out entry is reused */
 	if (SET_WITH_TIMEOUT(set))
 		ip_set_timeout_set(ext_timeout(data, set), ext->timeout);
+	WRITE_ONCE(n->bloom, n->bloom | HBLOOM(hash));
 	smp_mb__before_atomic();
 	set_bit(j, n->used);
 	if (old != ERR_PTR(-ENOENT)) {
@@ -1106,6 +1122,7 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 				k++;
 			}
 			tmp->pos = k;
+			tmp->bloom = n->bloom;
 			t->hregion[r].ext_size -=
 				ext_size(AHASH_INIT_SIZE, dsize);
 			rcu_assign_pointer(hbucket(t, key), tmp);
@@ -1157,7 +1174,7 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 #else
 	int ret, i, j = 0;
 #endif
-	u32 key, multi = 0;
+	u32 key, hash, multi = 0;
 
 	pr_debug("test by nets\n");
 	for (; j < NLEN && h->nets[j].cidr[0] && !multi; j++) {
@@ -1171,9 +1188,10 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 #else
 		mtype_data_netmask(d, NCIDR_GET(h->nets[j].cidr[0]));
 #endif
-		key = HKEY(d, h->initval, t->htable_bits);
+		hash = HKEY_HASH(d, h->initval);
+		key = hash & jhash_mask(t->htable_bits);
 		n = rcu_dereference_bh(hbucket(t, key));
-		if (!n)
+		if (!n || !(READ_ONCE(n->bloom) & HBLOOM(hash)))
 			continue;
 		for (i = 0; i < n->pos; i++) {
 			if (!test_bit(i, n->used))
@@ -1208,7 +1226,7 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	struct hbucket *n;
 	struct mtype_elem *data;
 	int i, ret = 0;
-	u32 key, multi = 0;
+	u32 key, hash, multi = 0;
 
 	rcu_read_lock_bh();
 	t = rcu_dereference_bh(h->table);
@@ -1225,9 +1243,11 @@ mtype_test(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 	}
 #endif
 
-	key = HKEY(d, h->initval, t->htable_bits);
+	hash = HKEY_HASH(d, h->initval);
+	key = hash & jhash_mask(t->htable_bits);
 	n = rcu_dereference_bh(hbucket(t, key));
-	if (!n) {
+	/* The bloom word rejects most misses without touching the values */
+	if (!n || !(READ_ONCE(n->bloom) & HBLOOM(hash))) {
 		ret = 0;
 		goto out;
 	}
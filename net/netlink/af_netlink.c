@@ -608,6 +608,40 @@ static int netlink_insert(struct sock *sk, u32 portid)
 	return err;
 }
 
+/* must be called with netlink table grabbed */
+static void netlink_mc_group_update(struct sock *sk, unsigned int group,
+				    bool subscribe)
+{
+	struct netlink_mc_node *n = &nlk_sk(sk)->mc_nodes[group];
+
+	if (subscribe) {
+		n->sk = sk;
+		hlist_add_head(&n->node,
+			       &nl_table[sk->sk_protocol].mc_groups[group]);
+	} else {
+		hlist_del(&n->node);
+	}
+}
+
+/* must be called with netlink table grabbed; takes over @heads */
+static void netlink_mc_groups_grow(struct netlink_table *tbl,
+				   struct hlist_head *heads,
+				   unsigned int ngroups)
+{
+	unsigned int i;
+
+	if (ngroups <= tbl->mc_ngroups) {
+		kfree(heads);
+		return;
+	}
+
+	for (i = 0; i < tbl->mc_ngroups; i++)
+		hlist_move_list(&tbl->mc_groups[i], &heads[i]);
+	kfree(tbl->mc_groups);
+	tbl->mc_groups = heads;
+	tbl->mc_ngroups = ngroups;
+}
+
 static void netlink_remove(struct sock *sk)
 {
 	struct netlink_table *table;
@@ -621,6 +655,11 @@ static void netlink_remove(struct sock *sk)
 
 	netlink_table_grab();
 	if (nlk_sk(sk)->subscriptions) {
+		struct netlink_sock *nlk = nlk_sk(sk);
+		unsigned int i;
+
+		for_each_set_bit(i, nlk->groups, nlk->ngroups)
+			netlink_mc_group_update(sk, i, false);
 		__sk_del_bind_node(sk);
 		netlink_update_listeners(sk);
 	}
@@ -732,6 +771,8 @@ static void deferred_put_nlk_sk(struct rcu_head *head)
 
 	kfree(nlk->groups);
 	nlk->groups = NULL;
+	kfree(nlk->mc_nodes);
+	nlk->mc_nodes = NULL;
 
 	if (!refcount_dec_and_test(&sk->sk_refcnt))
 		return;
@@ -941,7 +982,8 @@ netlink_update_subscriptions(struct sock *sk, unsigned int subscriptions)
 static int netlink_realloc_groups(struct sock *sk)
 {
 	struct netlink_sock *nlk = nlk_sk(sk);
-	unsigned int groups;
+	struct netlink_mc_node *new_nodes;
+	unsigned int groups, i;
 	unsigned long *new_groups;
 	int err = 0;
 
@@ -956,14 +998,29 @@ static int netlink_realloc_groups(struct sock *sk)
 	if (nlk->ngroups >= groups)
 		goto out_unlock;
 
+	new_nodes = kcalloc(groups, sizeof(*new_nodes), GFP_ATOMIC);
+	if (new_nodes == NULL) {
+		err = -ENOMEM;
+		goto out_unlock;
+	}
+
 	new_groups = krealloc(nlk->groups, NLGRPSZ(groups), GFP_ATOMIC);
 	if (new_groups == NULL) {
+		kfree(new_nodes);
 		err = -ENOMEM;
 		goto out_unlock;
 	}
 	memset((char *)new_groups + NLGRPSZ(nlk->ngroups), 0,
 	       NLGRPSZ(groups) - NLGRPSZ(nlk->ngroups));
 
+	/* move subscribed groups over to the new nodes */
+	for_each_set_bit(i, new_groups, nlk->ngroups) {
+		new_nodes[i].sk = sk;
+		hlist_replace_rcu(&nlk->mc_nodes[i].node, &new_nodes[i].node);
+	}
+	kfree(nlk->mc_nodes);
+
+	nlk->mc_nodes = new_nodes;
 	nlk->groups = new_groups;
 	nlk->ngroups = groups;
  out_unlock:
@@ -993,7 +1050,8 @@ static int netlink_bind(struct socket *sock, struct sockaddr *addr,
 	struct netlink_sock *nlk = nlk_sk(sk);
 	struct sockaddr_nl *nladdr = (struct sockaddr_nl *)addr;
 	int err = 0;
-	unsigned long groups;
+	unsigned long groups, changed;
+	unsigned int bit;
 	bool bound;
 
 	if (addr_len < sizeof(struct sockaddr_nl))
@@ -1062,6 +1120,9 @@ static int netlink_bind(struct socket *sock, struct sockaddr *addr,
 	netlink_update_subscriptions(sk, nlk->subscriptions +
 					 hweight32(groups) -
 					 hweight32(nlk->groups[0]));
+	changed = (u32)nlk->groups[0] ^ groups;
+	for_each_set_bit(bit, &changed, BITS_PER_TYPE(u32))
+		netlink_mc_group_update(sk, bit, test_bit(bit, &groups));
 	nlk->groups[0] = (nlk->groups[0] & ~0xffffffffUL) | groups;
 	netlink_update_listeners(sk);
 	netlink_table_ungrab();
@@ -1495,9 +1556,10 @@ static void do_one_broadcast(struct sock *sk,
 int netlink_broadcast(struct sock *ssk, struct sk_buff *skb, u32 portid,
 		      u32 group, gfp_t allocation)
 {
+	struct netlink_table *tbl = &nl_table[ssk->sk_protocol];
 	struct net *net = sock_net(ssk);
 	struct netlink_broadcast_data info;
-	struct sock *sk;
+	struct netlink_mc_node *n;
 
 	skb = netlink_trim(skb, allocation);
 
@@ -1517,8 +1579,10 @@ int netlink_broadcast(struct sock *ssk, struct sk_buff *skb, u32 portid,
 
 	netlink_lock_table();
 
-	sk_for_each_bound(sk, &nl_table[ssk->sk_protocol].mc_list)
-		do_one_broadcast(sk, &info);
+	/* only visit the sockets subscribed to @group */
+	if (group && group <= tbl->mc_ngroups)
+		hlist_for_each_entry(n, &tbl->mc_groups[group - 1], node)
+			do_one_broadcast(n->sk, &info);
 
 	consume_skb(skb);
 
@@ -1584,9 +1648,10 @@ static int do_one_set_err(struct sock *sk, struct netlink_set_err_data *p)
  */
 int netlink_set_err(struct sock *ssk, u32 portid, u32 group, int code)
 {
+	struct netlink_table *tbl = &nl_table[ssk->sk_protocol];
 	struct netlink_set_err_data info;
+	struct netlink_mc_node *n;
 	unsigned long flags;
-	struct sock *sk;
 	int ret = 0;
 
 	info.exclude_sk = ssk;
@@ -1597,8 +1662,9 @@ int netlink_set_err(struct sock *ssk, u32 portid, u32 group, int code)
 
 	read_lock_irqsave(&nl_table_lock, flags);
 
-	sk_for_each_bound(sk, &nl_table[ssk->sk_protocol].mc_list)
-		ret += do_one_set_err(sk, &info);
+	if (group && group <= tbl->mc_ngroups)
+		hlist_for_each_entry(n, &tbl->mc_groups[group - 1], node)
+			ret += do_one_set_err(n->sk, &info);
 
 	read_unlock_irqrestore(&nl_table_lock, flags);
 	return ret;
@@ -1614,6 +1680,8 @@ static void netlink_update_socket_mc(struct netlink_sock *nlk,
 
 	old = test_bit(group - 1, nlk->groups);
 	subscriptions = nlk->subscriptions - old + new;
+	if (old != new)
+		netlink_mc_group_update(&nlk->sk, group - 1, new);
 	if (new)
 		__set_bit(group - 1, nlk->groups);
 	else
@@ -1690,6 +1758,12 @@ static int netlink_setsockopt(struct socket *sock, int level, int optname,
 	case NETLINK_GET_STRICT_CHK:
 		nr = NETLINK_F_STRICT_CHK;
 		break;
+	case NETLINK_DUMP_BUF_SIZE:
+		/* The user promises to receive with a buffer this large */
+		if (val > NETLINK_DUMP_BUF_MAX)
+			return -EINVAL;
+		WRITE_ONCE(nlk->dump_buf_size, val);
+		break;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -1754,6 +1828,16 @@ static int netlink_getsockopt(struct socket *sock, int level, int optname,
 	case NETLINK_GET_STRICT_CHK:
 		flag = NETLINK_F_STRICT_CHK;
 		break;
+	case NETLINK_DUMP_BUF_SIZE:
+		if (len < sizeof(int))
+			return -EINVAL;
+
+		len = sizeof(int);
+		val = READ_ONCE(nlk->dump_buf_size);
+		if (put_user(len, optlen) ||
+		    copy_to_user(optval, &val, len))
+			return -EFAULT;
+		return 0;
 	default:
 		return -ENOPROTOOPT;
 	}
@@ -1986,6 +2070,7 @@ __netlink_kernel_create(struct net *net, int unit, struct module *module,
 	struct netlink_sock *nlk;
 	struct listeners *listeners = NULL;
 	struct mutex *cb_mutex = cfg ? cfg->cb_mutex : NULL;
+	struct hlist_head *mc_groups = NULL;
 	unsigned int groups;
 
 	BUG_ON(!nl_table);
@@ -2010,6 +2095,10 @@ __netlink_kernel_create(struct net *net, int unit, struct module *module,
 	if (!listeners)
 		goto out_sock_release;
 
+	mc_groups = kcalloc(groups, sizeof(*mc_groups), GFP_KERNEL);
+	if (!mc_groups)
+		goto out_sock_release;
+
 	sk->sk_data_ready = netlink_data_ready;
 	if (cfg && cfg->input)
 		nlk_sk(sk)->netlink_rcv = cfg->input;
@@ -2023,6 +2112,7 @@ __netlink_kernel_create(struct net *net, int unit, struct module *module,
 	netlink_table_grab();
 	if (!nl_table[unit].registered) {
 		nl_table[unit].groups = groups;
+		netlink_mc_groups_grow(&nl_table[unit], mc_groups, groups);
 		rcu_assign_pointer(nl_table[unit].listeners, listeners);
 		nl_table[unit].cb_mutex = cb_mutex;
 		nl_table[unit].module = module;
@@ -2036,12 +2126,14 @@ __netlink_kernel_create(struct net *net, int unit, struct module *module,
 		nl_table[unit].registered = 1;
 	} else {
 		kfree(listeners);
+		kfree(mc_groups);
 		nl_table[unit].registered++;
 	}
 	netlink_table_ungrab();
 	return sk;
 
 out_sock_release:
+	kfree(mc_groups);
 	kfree(listeners);
 	netlink_kernel_release(sk);
 	return NULL;
@@ -2070,6 +2162,15 @@ int __netlink_change_ngroups(struct sock *sk, unsigned int groups)
 	if (groups < 32)
 		groups = 32;
 
+	if (tbl->mc_ngroups < groups) {
+		struct hlist_head *heads;
+
+		heads = kcalloc(groups, sizeof(*heads), GFP_ATOMIC);
+		if (!heads)
+			return -ENOMEM;
+		netlink_mc_groups_grow(tbl, heads, groups);
+	}
+
 	if (NLGRPSZ(tbl->groups) < NLGRPSZ(groups)) {
 		new = kzalloc(sizeof(*new) + NLGRPSZ(groups), GFP_ATOMIC);
 		if (!new)
@@ -2110,11 +2211,15 @@ int netlink_change_ngroups(struct sock *sk, unsigned int groups)
 
 void __netlink_clear_multicast_users(struct sock *ksk, unsigned int group)
 {
-	struct sock *sk;
 	struct netlink_table *tbl = &nl_table[ksk->sk_protocol];
+	struct netlink_mc_node *n;
+	struct hlist_node *tmp;
+
+	if (!group || group > tbl->mc_ngroups)
+		return;
 
-	sk_for_each_bound(sk, &tbl->mc_list)
-		netlink_update_socket_mc(nlk_sk(sk), group, 0);
+	hlist_for_each_entry_safe(n, tmp, &tbl->mc_groups[group - 1], node)
+		netlink_update_socket_mc(nlk_sk(n->sk), group, 0);
 }
 
 struct nlmsghdr *
@@ -2173,6 +2278,7 @@ static int netlink_dump(struct sock *sk)
 	struct module *module;
 	int err = -ENOBUFS;
 	int alloc_min_size;
+	u32 dump_buf_size;
 	int alloc_size;
 
 	mutex_lock(nlk->cb_mutex);
@@ -2192,8 +2298,17 @@ static int netlink_dump(struct sock *sk)
 	cb = &nlk->cb;
 	alloc_min_size = max_t(int, cb->min_dump_alloc, NLMSG_GOODSIZE);
 
+	/* A socket that set NETLINK_DUMP_BUF_SIZE gets dump skbs of that
+	 * size, bounded by its receive buffer. Like large unicast messages
+	 * they are vmalloc()ed, so no high order allocation is needed.
+	 */
 	max_recvmsg_len = READ_ONCE(nlk->max_recvmsg_len);
-	if (alloc_min_size < max_recvmsg_len) {
+	dump_buf_size = READ_ONCE(nlk->dump_buf_size);
+	if (alloc_min_size < dump_buf_size) {
+		alloc_size = min_t(int, dump_buf_size, READ_ONCE(sk->sk_rcvbuf));
+		alloc_size = max(alloc_size, alloc_min_size);
+		skb = netlink_alloc_large_skb(alloc_size, 0);
+	} else if (alloc_min_size < max_recvmsg_len) {
 		alloc_size = max_recvmsg_len;
 		skb = alloc_skb(alloc_size,
 				(GFP_KERNEL & ~__GFP_DIRECT_RECLAIM) |
@@ -2227,8 +2342,21 @@ static int netlink_dump(struct sock *sk)
 	netlink_skb_set_owner_r(skb, sk);
 
 	if (nlk->dump_done_errno > 0) {
+		unsigned int len;
+
+		/* With large dump skbs keep calling the dump callback as long
+		 * as it makes progress and another message of the minimum size
+		 * still fits, instead of returning to the user after every
+		 * callback iteration.
+		 */
 		cb->extack = &extack;
-		nlk->dump_done_errno = cb->dump(skb, cb);
+		do {
+			len = skb->len;
+			nlk->dump_done_errno = cb->dump(skb, cb);
+		} while (alloc_min_size < dump_buf_size &&
+			 nlk->dump_done_errno > 0 && skb->len > len &&
+			 !skb_has_frag_list(skb) &&
+			 skb_tailroom(skb) >= alloc_min_size);
 		cb->extack = NULL;
 	}
 
@@ -2803,16 +2931,19 @@ static void __net_exit netlink_net_exit(struct net *net)
 
 static void __init netlink_add_usersock_entry(void)
 {
+	struct hlist_head *mc_groups;
 	struct listeners *listeners;
 	int groups = 32;
 
 	listeners = kzalloc(sizeof(*listeners) + NLGRPSZ(groups), GFP_KERNEL);
-	if (!listeners)
+	mc_groups = kcalloc(groups, sizeof(*mc_groups), GFP_KERNEL);
+	if (!listeners || !mc_groups)
 		panic("netlink_add_usersock_entry: Cannot allocate listeners\n");
 
 	netlink_table_grab();
 
 	nl_table[NETLINK_USERSOCK].groups = groups;
+	netlink_mc_groups_grow(&nl_table[NETLINK_USERSOCK], mc_groups, groups);
 	rcu_assign_pointer(nl_table[NETLINK_USERSOCK].listeners, listeners);
 	nl_table[NETLINK_USERSOCK].module = THIS_MODULE;
 	nl_table[NETLINK_USERSOCK].registered = 1;
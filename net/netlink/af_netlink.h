@@ -19,9 +19,22 @@ enum {
 	NETLINK_F_STRICT_CHK,
 };
 
+/* Size of the skbs a dump on this socket is built in, see netlink_dump() */
+#ifndef NETLINK_DUMP_BUF_SIZE
+#define NETLINK_DUMP_BUF_SIZE	13
+#endif
+
+#define NETLINK_DUMP_BUF_MAX	(1 << 20)
+
 #define NLGRPSZ(x)	(ALIGN(x, sizeof(unsigned long) * 8) / 8)
 #define NLGRPLONGS(x)	(NLGRPSZ(x)/sizeof(unsigned long))
 
+/* Links a socket into the subscriber list of one multicast group */
+struct netlink_mc_node {
+	struct hlist_node	node;
+	struct sock		*sk;
+};
+
 struct netlink_sock {
 	/* struct sock has to be the first member of netlink_sock */
 	struct sock		sk;
@@ -32,8 +45,10 @@ struct netlink_sock {
 	u32			subscriptions;
 	u32			ngroups;
 	unsigned long		*groups;
+	struct netlink_mc_node	*mc_nodes;	/* one per group in ngroups */
 	unsigned long		state;
 	size_t			max_recvmsg_len;
+	u32			dump_buf_size;
 	wait_queue_head_t	wait;
 	bool			bound;
 	bool			cb_running;
@@ -61,6 +76,8 @@ static inline struct netlink_sock *nlk_sk(struct sock *sk)
 struct netlink_table {
 	struct rhashtable	hash;
 	struct hlist_head	mc_list;
+	struct hlist_head	*mc_groups;	/* subscribers of each group */
+	unsigned int		mc_ngroups;
 	struct listeners __rcu	*listeners;
 	unsigned int		flags;
 	unsigned int		groups;
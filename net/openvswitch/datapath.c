@@ -161,11 +161,157 @@ static int get_dpifindex(const struct datapath *dp)
 	return ifindex;
 }
 
+static unsigned int upcall_batch __read_mostly = 16;
+module_param(upcall_batch, uint, 0644);
+MODULE_PARM_DESC(upcall_batch,
+		 "Max upcalls per netlink message with OVS_DP_F_UPCALL_BATCH");
+
+static unsigned int upcall_batch_usecs __read_mostly = 100;
+module_param(upcall_batch_usecs, uint, 0644);
+MODULE_PARM_DESC(upcall_batch_usecs,
+		 "Max time a batched upcall waits to be sent, in microseconds");
+
+static unsigned int upcall_hash_rate __read_mostly;
+module_param(upcall_hash_rate, uint, 0644);
+MODULE_PARM_DESC(upcall_hash_rate,
+		 "Max miss upcalls per second for one flow hash on one CPU (0: unlimited)");
+
+#define OVS_UPCALL_BATCH_BYTES	(16 * 1024)
+
+static void ovs_upcall_batch_flush(struct dp_upcall_batch *b)
+{
+	struct sk_buff *skb = b->skb;
+	unsigned int count = b->count;
+
+	if (!skb)
+		return;
+
+	b->skb = NULL;
+	b->count = 0;
+	if (genlmsg_unicast(ovs_dp_get_net(b->dp), skb, b->portid)) {
+		struct dp_stats_percpu *stats = this_cpu_ptr(b->dp->stats_percpu);
+
+		u64_stats_update_begin(&stats->syncp);
+		stats->n_lost += count;
+		u64_stats_update_end(&stats->syncp);
+	}
+}
+
+static enum hrtimer_restart ovs_upcall_batch_timer(struct hrtimer *timer)
+{
+	ovs_upcall_batch_flush(container_of(timer, struct dp_upcall_batch,
+					    timer));
+	return HRTIMER_NORESTART;
+}
+
+/* Returns this CPU's batch datagram with room for an upcall of 'len'
+ * bytes of payload to 'portid', sending the pending batch first if it
+ * cannot take it.  Must be called with BH disabled.
+ */
+static struct sk_buff *ovs_upcall_batch_get(struct dp_upcall_batch *b,
+					    u32 portid, size_t len)
+{
+	size_t size = nlmsg_total_size(genlmsg_msg_size(len));
+
+	if (b->skb && (b->portid != portid || skb_tailroom(b->skb) < size))
+		ovs_upcall_batch_flush(b);
+
+	if (!b->skb) {
+		b->skb = genlmsg_new(max_t(size_t, len, OVS_UPCALL_BATCH_BYTES),
+				     GFP_ATOMIC);
+		if (!b->skb)
+			return NULL;
+		b->portid = portid;
+	}
+	return b->skb;
+}
+
+static void ovs_upcall_batch_commit(struct dp_upcall_batch *b)
+{
+	if (++b->count >= READ_ONCE(upcall_batch)) {
+		ovs_upcall_batch_flush(b);
+		return;
+	}
+
+	if (b->count == 1)
+		hrtimer_start(&b->timer,
+			      us_to_ktime(READ_ONCE(upcall_batch_usecs)),
+			      HRTIMER_MODE_REL_PINNED_SOFT);
+}
+
+static int ovs_upcall_batch_init(struct datapath *dp)
+{
+	int cpu;
+
+	dp->upcall_batch = alloc_percpu(struct dp_upcall_batch);
+	if (!dp->upcall_batch)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct dp_upcall_batch *b = per_cpu_ptr(dp->upcall_batch, cpu);
+
+		b->dp = dp;
+		hrtimer_init(&b->timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL_PINNED_SOFT);
+		b->timer.function = ovs_upcall_batch_timer;
+	}
+	return 0;
+}
+
+static void ovs_upcall_batch_destroy(struct datapath *dp)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct dp_upcall_batch *b = per_cpu_ptr(dp->upcall_batch, cpu);
+
+		hrtimer_cancel(&b->timer);
+		kfree_skb(b->skb);
+	}
+	free_percpu(dp->upcall_batch);
+}
+
+#define OVS_UPCALL_RL_BUCKETS	256
+
+struct ovs_upcall_rl_bucket {
+	u32 hash;
+	u32 count;
+	unsigned long stamp;
+};
+
+static DEFINE_PER_CPU(struct ovs_upcall_rl_bucket [OVS_UPCALL_RL_BUCKETS],
+		      ovs_upcall_rl);
+
+/* Keeps one source of misses, identified by its flow hash, from using up
+ * the upcall sockets: at most 'upcall_hash_rate' misses per second and
+ * CPU go up for a given hash.  Must be called with BH disabled.
+ */
+static bool ovs_upcall_ratelimited(struct sk_buff *skb)
+{
+	unsigned int rate = READ_ONCE(upcall_hash_rate);
+	struct ovs_upcall_rl_bucket *b;
+	u32 hash;
+
+	if (!rate)
+		return false;
+
+	hash = skb_get_hash(skb);
+	b = this_cpu_ptr(&ovs_upcall_rl[hash & (OVS_UPCALL_RL_BUCKETS - 1)]);
+	if (b->hash != hash || time_after(jiffies, b->stamp + HZ)) {
+		b->hash = hash;
+		b->stamp = jiffies;
+		b->count = 0;
+	}
+
+	return ++b->count > rate;
+}
+
 static void destroy_dp_rcu(struct rcu_head *rcu)
 {
 	struct datapath *dp = container_of(rcu, struct datapath, rcu);
 
 	ovs_flow_tbl_destroy(&dp->table);
+	ovs_upcall_batch_destroy(dp);
 	free_percpu(dp->stats_percpu);
 	kfree(dp->ports);
 	ovs_meters_exit(dp);
@@ -301,6 +447,12 @@ int ovs_dp_upcall(struct datapath *dp, struct sk_buff *skb,
 		goto err;
 	}
 
+	if (upcall_info->cmd == OVS_PACKET_CMD_MISS &&
+	    ovs_upcall_ratelimited(skb)) {
+		err = -ENOBUFS;
+		goto err;
+	}
+
 	if (!skb_is_gso(skb))
 		err = queue_userspace_packet(dp, skb, key, upcall_info, cutlen);
 	else
@@ -413,6 +565,8 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	struct ovs_header *upcall;
 	struct sk_buff *nskb = NULL;
 	struct sk_buff *user_skb = NULL; /* to be queued to userspace */
+	struct dp_upcall_batch *batch = NULL;
+	unsigned int msg_start = 0;
 	struct nlattr *nla;
 	size_t len;
 	unsigned int hlen;
@@ -445,22 +599,32 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	    (err = skb_csum_hwoffload_help(skb, 0)))
 		goto out;
 
+	if (dp->user_features & OVS_DP_F_UPCALL_BATCH &&
+	    READ_ONCE(upcall_batch) > 1)
+		batch = this_cpu_ptr(dp->upcall_batch);
+
 	/* Older versions of OVS user space enforce alignment of the last
 	 * Netlink attribute to NLA_ALIGNTO which would require extensive
 	 * padding logic. Only perform zerocopy if padding is not required.
+	 * Batched messages are appended one after the other and therefore
+	 * always carry a linear copy of the packet.
 	 */
-	if (dp->user_features & OVS_DP_F_UNALIGNED)
+	if (dp->user_features & OVS_DP_F_UNALIGNED && !batch)
 		hlen = skb_zerocopy_headlen(skb);
 	else
 		hlen = skb->len;
 
 	len = upcall_msg_size(upcall_info, hlen - cutlen,
 			      OVS_CB(skb)->acts_origlen);
-	user_skb = genlmsg_new(len, GFP_ATOMIC);
+	if (batch)
+		user_skb = ovs_upcall_batch_get(batch, upcall_info->portid, len);
+	else
+		user_skb = genlmsg_new(len, GFP_ATOMIC);
 	if (!user_skb) {
 		err = -ENOMEM;
 		goto out;
 	}
+	msg_start = user_skb->len;
 
 	upcall = genlmsg_put(user_skb, 0, 0, &dp_packet_genl_family,
 			     0, upcall_info->cmd);
@@ -551,13 +715,25 @@ static int queue_userspace_packet(struct datapath *dp, struct sk_buff *skb,
 	/* Pad OVS_PACKET_ATTR_PACKET if linear copy was performed */
 	pad_packet(dp, user_skb);
 
-	((struct nlmsghdr *) user_skb->data)->nlmsg_len = user_skb->len;
+	((struct nlmsghdr *)(user_skb->data + msg_start))->nlmsg_len =
+		user_skb->len - msg_start;
 
-	err = genlmsg_unicast(ovs_dp_get_net(dp), user_skb, upcall_info->portid);
+	if (batch) {
+		ovs_upcall_batch_commit(batch);
+		err = 0;
+	} else {
+		err = genlmsg_unicast(ovs_dp_get_net(dp), user_skb,
+				      upcall_info->portid);
+	}
 	user_skb = NULL;
 out:
 	if (err)
 		skb_tx_error(skb);
+	if (batch && user_skb) {
+		/* drop the partial message, keep the batch */
+		skb_trim(user_skb, msg_start);
+		user_skb = NULL;
+	}
 	consume_skb(user_skb);
 	consume_skb(nskb);
 
@@ -1691,7 +1867,8 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 		if (user_features & ~(OVS_DP_F_VPORT_PIDS |
 				      OVS_DP_F_UNALIGNED |
 				      OVS_DP_F_TC_RECIRC_SHARING |
-				      OVS_DP_F_DISPATCH_UPCALL_PER_CPU))
+				      OVS_DP_F_DISPATCH_UPCALL_PER_CPU |
+				      OVS_DP_F_UPCALL_BATCH))
 			return -EOPNOTSUPP;
 
 #if !IS_ENABLED(CONFIG_NET_TC_SKB_EXT)
@@ -1737,6 +1914,11 @@ static int ovs_dp_stats_init(struct datapath *dp)
 	if (!dp->stats_percpu)
 		return -ENOMEM;
 
+	if (ovs_upcall_batch_init(dp)) {
+		free_percpu(dp->stats_percpu);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -1853,6 +2035,7 @@ static int ovs_dp_cmd_new(struct sk_buff *skb, struct genl_info *info)
 err_destroy_ports:
 	kfree(dp->ports);
 err_destroy_stats:
+	ovs_upcall_batch_destroy(dp);
 	free_percpu(dp->stats_percpu);
 err_destroy_table:
 	ovs_flow_tbl_destroy(&dp->table);
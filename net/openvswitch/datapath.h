@@ -24,6 +24,11 @@
 #define DP_VPORT_HASH_BUCKETS       1024
 #define DP_MASKS_REBALANCE_INTERVAL 4000
 
+/* Aggregate several upcall messages per netlink datagram. */
+#ifndef OVS_DP_F_UPCALL_BATCH
+#define OVS_DP_F_UPCALL_BATCH	(1 << 4)
+#endif
+
 /**
  * struct dp_stats_percpu - per-cpu packet processing statistics for a given
  * datapath.
@@ -65,6 +70,23 @@ struct dp_nlsk_pids {
 	u32 pids[];
 };
 
+/**
+ * struct dp_upcall_batch - per-CPU upcall messages waiting to be sent.
+ *                          Used when OVS_DP_F_UPCALL_BATCH is enabled.
+ * @skb: Netlink datagram the pending upcall messages are built in.
+ * @dp: Datapath the batch belongs to.
+ * @portid: Netlink portid all messages in @skb are destined to.
+ * @count: Number of messages in @skb.
+ * @timer: Sends a partial batch once the flush timeout expires.
+ */
+struct dp_upcall_batch {
+	struct sk_buff *skb;
+	struct datapath *dp;
+	u32 portid;
+	unsigned int count;
+	struct hrtimer timer;
+};
+
 /**
  * struct datapath - datapath for flow-based packet switching
  * @rcu: RCU callback head for deferred destruction.
@@ -77,6 +99,7 @@ struct dp_nlsk_pids {
  * @max_headroom: the maximum headroom of all vports in this datapath; it will
  * be used by all the internal vports in this dp.
  * @upcall_portids: RCU protected 'struct dp_nlsk_pids'.
+ * @upcall_batch: Per-CPU upcall batches.
  *
  * Context: See the comment on locking at the top of datapath.c for additional
  * locking information.
@@ -105,6 +128,8 @@ struct datapath {
 	struct dp_meter_table meter_tbl;
 
 	struct dp_nlsk_pids __rcu *upcall_portids;
+
+	struct dp_upcall_batch __percpu *upcall_batch;
 };
 
 /**
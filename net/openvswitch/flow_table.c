@@ -458,6 +458,15 @@ static void flow_tbl_destroy_rcu_cb(struct rcu_head *rcu)
 	__table_instance_destroy(ti);
 }
 
+/* Retire the flow pointers remembered in the mask cache. A reader that
+ * sees the new generation also sees the table update that caused it.
+ */
+static void flow_tbl_bump_gen(struct flow_table *table)
+{
+	smp_wmb();
+	WRITE_ONCE(table->flow_gen, table->flow_gen + 1);
+}
+
 static void table_instance_flow_free(struct flow_table *table,
 				     struct table_instance *ti,
 				     struct table_instance *ufid_ti,
@@ -471,6 +480,8 @@ static void table_instance_flow_free(struct flow_table *table,
 		table->ufid_count--;
 	}
 
+	flow_tbl_bump_gen(table);
+
 	flow_mask_remove(table, flow->mask);
 }
 
@@ -686,6 +697,27 @@ static bool flow_cmp_masked_key(const struct sw_flow *flow,
 	return cmp_key(&flow->key, key, range->start, range->end);
 }
 
+/* Same as masking 'key' with the flow's mask and comparing the result,
+ * one long at a time over the mask's range, without the masked copy.
+ */
+static bool flow_cmp_key_under_mask(const struct sw_flow *flow,
+				    const struct sw_flow_key *key)
+{
+	const struct sw_flow_mask *mask = flow->mask;
+	int start = mask->range.start;
+	int end = mask->range.end;
+	const long *m = (const long *)((const u8 *)&mask->key + start);
+	const long *k = (const long *)((const u8 *)key + start);
+	const long *f = (const long *)((const u8 *)&flow->key + start);
+	int i;
+
+	for (i = start; i < end; i += sizeof(long))
+		if ((*k++ & *m++) ^ *f++)
+			return false;
+
+	return true;
+}
+
 static bool ovs_flow_cmp_unmasked_key(const struct sw_flow *flow,
 				      const struct sw_flow_match *match)
 {
@@ -775,12 +807,39 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 	return NULL;
 }
 
+/* Microflow hit: the entry's flow is only trusted if no flow was
+ * inserted or removed since it was recorded, which also keeps it from
+ * having been freed, and the packet still matches it.
+ */
+static struct sw_flow *mask_cache_flow(struct mask_array *ma,
+				       const struct mask_cache_entry *e,
+				       const struct sw_flow_key *key,
+				       unsigned long flow_gen)
+{
+	struct mask_array_stats *stats;
+	struct sw_flow *flow = e->flow;
+
+	if (!flow || e->flow_gen != flow_gen ||
+	    !flow_cmp_key_under_mask(flow, key))
+		return NULL;
+
+	if (likely(e->mask_index < ma->max)) {
+		stats = this_cpu_ptr(ma->masks_usage_stats);
+		u64_stats_update_begin(&stats->syncp);
+		stats->usage_cntrs[e->mask_index]++;
+		u64_stats_update_end(&stats->syncp);
+	}
+	return flow;
+}
+
 /*
  * mask_cache maps flow to probable mask. This cache is not tightly
  * coupled cache, It means updates to  mask list can result in inconsistent
  * cache entry in mask cache.
  * This is per cpu cache and is divided in MC_HASH_SEGS segments.
  * In case of a hash collision the entry is hashed in next segment.
+ * Each entry also remembers the flow it resolved to, so that a packet of
+ * the same microflow skips the masked hash and bucket walk altogether.
  * */
 struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 					  const struct sw_flow_key *key,
@@ -793,6 +852,7 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	struct table_instance *ti = rcu_dereference(tbl->ti);
 	struct mask_cache_entry *entries, *ce;
 	struct sw_flow *flow;
+	unsigned long flow_gen;
 	u32 hash;
 	int seg;
 
@@ -812,6 +872,10 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	if (key->recirc_id)
 		skb_hash = jhash_1word(skb_hash, key->recirc_id);
 
+	/* Paired with the smp_wmb() in flow_tbl_bump_gen(). */
+	flow_gen = READ_ONCE(tbl->flow_gen);
+	smp_rmb();
+
 	ce = NULL;
 	hash = skb_hash;
 	entries = this_cpu_ptr(mc->mask_cache);
@@ -823,10 +887,22 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 
 		e = &entries[index];
 		if (e->skb_hash == skb_hash) {
+			flow = mask_cache_flow(ma, e, key, flow_gen);
+			if (flow) {
+				(*n_mask_hit)++;
+				(*n_cache_hit)++;
+				return flow;
+			}
+
 			flow = flow_lookup(tbl, ti, ma, key, n_mask_hit,
 					   n_cache_hit, &e->mask_index);
-			if (!flow)
+			if (!flow) {
 				e->skb_hash = 0;
+				e->flow = NULL;
+			} else {
+				e->flow = flow;
+				e->flow_gen = flow_gen;
+			}
 			return flow;
 		}
 
@@ -839,8 +915,11 @@ struct sw_flow *ovs_flow_tbl_lookup_stats(struct flow_table *tbl,
 	/* Cache miss, do full lookup. */
 	flow = flow_lookup(tbl, ti, ma, key, n_mask_hit, n_cache_hit,
 			   &ce->mask_index);
-	if (flow)
+	if (flow) {
 		ce->skb_hash = skb_hash;
+		ce->flow = flow;
+		ce->flow_gen = flow_gen;
+	}
 
 	*n_cache_hit = 0;
 	return flow;
@@ -1092,6 +1171,8 @@ int ovs_flow_tbl_insert(struct flow_table *table, struct sw_flow *flow,
 	if (ovs_identifier_is_ufid(&flow->id))
 		flow_ufid_insert(table, flow);
 
+	/* The new flow may take precedence over a remembered one. */
+	flow_tbl_bump_gen(table);
 	return 0;
 }
 
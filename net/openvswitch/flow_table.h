@@ -25,6 +25,8 @@
 struct mask_cache_entry {
 	u32 skb_hash;
 	u32 mask_index;
+	unsigned long flow_gen;
+	struct sw_flow *flow;	/* Valid while flow_gen is current. */
 };
 
 struct mask_cache {
@@ -67,6 +69,7 @@ struct flow_table {
 	unsigned long last_rehash;
 	unsigned int count;
 	unsigned int ufid_count;
+	unsigned long flow_gen;	/* Bumped on every flow insertion and removal. */
 };
 
 extern struct kmem_cache *flow_stats_cache;
@@ -42,12 +42,23 @@ static u32 meter_hash(struct dp_meter_instance *ti, u32 id)
 	return id % ti->n_meters;
 }
 
+static void __ovs_meter_free(struct dp_meter *meter)
+{
+	free_percpu(meter->pcpu);
+	kfree(meter);
+}
+
+static void ovs_meter_free_rcu(struct rcu_head *rcu)
+{
+	__ovs_meter_free(container_of(rcu, struct dp_meter, rcu));
+}
+
 static void ovs_meter_free(struct dp_meter *meter)
 {
 	if (!meter)
 		return;
 
-	kfree_rcu(meter, rcu);
+	call_rcu(&meter->rcu, ovs_meter_free_rcu);
 }
 
 /* Call with ovs_mutex or RCU read lock. */
@@ -231,21 +242,53 @@ ovs_meter_cmd_reply_start(struct genl_info *info, u8 cmd,
 	return skb;
 }
 
+/* Fold in the packets metered on the per-CPU fast path.  Call with the
+ * meter lock held.
+ */
+static void dp_meter_read_stats(const struct dp_meter *meter,
+				struct ovs_flow_stats *stats, u64 *used)
+{
+	int cpu;
+
+	*stats = meter->stats;
+	*used = meter->used;
+
+	for_each_possible_cpu(cpu) {
+		const struct dp_meter_pcpu *pcpu = per_cpu_ptr(meter->pcpu, cpu);
+		u64 n_packets, n_bytes, pcpu_used;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin(&pcpu->syncp);
+			n_packets = pcpu->stats.n_packets;
+			n_bytes = pcpu->stats.n_bytes;
+			pcpu_used = pcpu->used;
+		} while (u64_stats_fetch_retry(&pcpu->syncp, start));
+
+		stats->n_packets += n_packets;
+		stats->n_bytes += n_bytes;
+		*used = max(*used, pcpu_used);
+	}
+}
+
 static int ovs_meter_cmd_reply_stats(struct sk_buff *reply, u32 meter_id,
 				     struct dp_meter *meter)
 {
+	struct ovs_flow_stats stats;
 	struct nlattr *nla;
 	struct dp_meter_band *band;
+	u64 used;
 	u16 i;
 
 	if (nla_put_u32(reply, OVS_METER_ATTR_ID, meter_id))
 		goto error;
 
+	dp_meter_read_stats(meter, &stats, &used);
 	if (nla_put(reply, OVS_METER_ATTR_STATS,
-		    sizeof(struct ovs_flow_stats), &meter->stats))
+		    sizeof(struct ovs_flow_stats), &stats))
 		goto error;
 
-	if (nla_put_u64_64bit(reply, OVS_METER_ATTR_USED, meter->used,
+	if (nla_put_u64_64bit(reply, OVS_METER_ATTR_USED, used,
 			      OVS_METER_ATTR_PAD))
 		goto error;
 
@@ -332,7 +375,7 @@ static struct dp_meter *dp_meter_create(struct nlattr **a)
 	u16 n_bands = 0;
 	struct dp_meter *meter;
 	struct dp_meter_band *band;
-	int err;
+	int err, cpu;
 
 	/* Validate attributes, count the bands. */
 	if (!a[OVS_METER_ATTR_BANDS])
@@ -347,6 +390,14 @@ static struct dp_meter *dp_meter_create(struct nlattr **a)
 	if (!meter)
 		return ERR_PTR(-ENOMEM);
 
+	meter->pcpu = alloc_percpu_gfp(struct dp_meter_pcpu, GFP_KERNEL_ACCOUNT);
+	if (!meter->pcpu) {
+		kfree(meter);
+		return ERR_PTR(-ENOMEM);
+	}
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(meter->pcpu, cpu)->syncp);
+
 	meter->id = nla_get_u32(a[OVS_METER_ATTR_ID]);
 	meter->used = div_u64(ktime_get_ns(), 1000 * 1000);
 	meter->kbps = a[OVS_METER_ATTR_KBPS] ? 1 : 0;
@@ -393,6 +444,9 @@ static struct dp_meter *dp_meter_create(struct nlattr **a)
 		 */
 		band->bucket = band->burst_size * 1000ULL;
 		band_max_delta_t = div_u64(band->bucket, band->rate);
+		/* Bound the tokens parked on the CPUs, see ovs_meter_execute(). */
+		band->quantum = div_u64(band->bucket >> DP_METER_PCPU_ERR_SHIFT,
+					num_possible_cpus());
 		if (band_max_delta_t > meter->max_delta_t)
 			meter->max_delta_t = band_max_delta_t;
 		band++;
@@ -401,7 +455,7 @@ static struct dp_meter *dp_meter_create(struct nlattr **a)
 	return meter;
 
 exit_free_meter:
-	kfree(meter);
+	__ovs_meter_free(meter);
 	return ERR_PTR(err);
 }
 
@@ -478,7 +532,7 @@ static int ovs_meter_cmd_set(struct sk_buff *skb, struct genl_info *info)
 	ovs_unlock();
 	nlmsg_free(reply);
 exit_free_meter:
-	kfree(meter);
+	__ovs_meter_free(meter);
 	return err;
 }
 
@@ -586,16 +640,53 @@ static int ovs_meter_cmd_del(struct sk_buff *skb, struct genl_info *info)
 	return err;
 }
 
+/* Try to meter the packet with the tokens this CPU borrowed earlier.
+ * Only packets that fit into every band can go this way, exceeding a band
+ * is always decided under the meter lock.
+ */
+static bool ovs_meter_execute_pcpu(struct dp_meter *meter,
+				   struct dp_meter_pcpu *pcpu,
+				   long long int now_ms, u32 cost, u32 len)
+{
+	int i;
+
+	if (now_ms - (long long int)pcpu->filled > DP_METER_PCPU_MAX_AGE_MS)
+		return false;
+
+	for (i = 0; i < meter->n_bands; ++i)
+		if (pcpu->tokens[i] < cost)
+			return false;
+
+	for (i = 0; i < meter->n_bands; ++i)
+		pcpu->tokens[i] -= cost;
+
+	u64_stats_update_begin(&pcpu->syncp);
+	pcpu->stats.n_packets += 1;
+	pcpu->stats.n_bytes += len;
+	pcpu->used = now_ms;
+	u64_stats_update_end(&pcpu->syncp);
+
+	return true;
+}
+
 /* Meter action execution.
  *
  * Return true 'meter_id' drop band is triggered. The 'skb' should be
  * dropped by the caller'.
+ *
+ * To keep busy meters shared by many CPUs off the meter lock, each CPU
+ * borrows up to 'quantum' tokens from the bands whenever it has to take
+ * the lock, and meters the following packets against those alone.  What
+ * is left is handed back on the next locked update, at the latest once
+ * DP_METER_PCPU_MAX_AGE_MS have passed, so the tokens parked on all the
+ * CPUs together never exceed 1/2^DP_METER_PCPU_ERR_SHIFT of the burst.
  */
 bool ovs_meter_execute(struct datapath *dp, struct sk_buff *skb,
 		       struct sw_flow_key *key, u32 meter_id)
 {
 	long long int now_ms = div_u64(ktime_get_ns(), 1000 * 1000);
 	long long int long_delta_ms;
+	struct dp_meter_pcpu *pcpu;
 	struct dp_meter_band *band;
 	struct dp_meter *meter;
 	int i, band_exceeded_max = -1;
@@ -608,6 +699,22 @@ bool ovs_meter_execute(struct datapath *dp, struct sk_buff *skb,
 	if (!meter)
 		return false;
 
+	/* Bucket rate is either in kilobits per second, or in packets per
+	 * second.  We maintain the bucket in the units of either bits or
+	 * 1/1000th of a packet, correspondingly.
+	 * Then, when rate is multiplied with milliseconds, we get the
+	 * bucket units:
+	 * msec * kbps = bits, and
+	 * msec * packets/sec = 1/1000 packets.
+	 *
+	 * 'cost' is the number of bucket units in this packet.
+	 */
+	cost = (meter->kbps) ? skb->len * 8 : 1000;
+
+	pcpu = this_cpu_ptr(meter->pcpu);
+	if (ovs_meter_execute_pcpu(meter, pcpu, now_ms, cost, skb->len))
+		return false;
+
 	/* Lock the meter while using it. */
 	spin_lock(&meter->lock);
 
@@ -633,37 +740,34 @@ bool ovs_meter_execute(struct datapath *dp, struct sk_buff *skb,
 	meter->stats.n_packets += 1;
 	meter->stats.n_bytes += skb->len;
 
-	/* Bucket rate is either in kilobits per second, or in packets per
-	 * second.  We maintain the bucket in the units of either bits or
-	 * 1/1000th of a packet, correspondingly.
-	 * Then, when rate is multiplied with milliseconds, we get the
-	 * bucket units:
-	 * msec * kbps = bits, and
-	 * msec * packets/sec = 1/1000 packets.
-	 *
-	 * 'cost' is the number of bucket units in this packet.
-	 */
-	cost = (meter->kbps) ? skb->len * 8 : 1000;
-
 	/* Update all bands and find the one hit with the highest rate. */
 	for (i = 0; i < meter->n_bands; ++i) {
 		long long int max_bucket_size;
+		u64 borrow;
 
 		band = &meter->bands[i];
 		max_bucket_size = band->burst_size * 1000LL;
 
-		band->bucket += delta_ms * band->rate;
+		/* Take back what this CPU did not use. */
+		band->bucket += delta_ms * band->rate + pcpu->tokens[i];
+		pcpu->tokens[i] = 0;
 		if (band->bucket > max_bucket_size)
 			band->bucket = max_bucket_size;
 
 		if (band->bucket >= cost) {
 			band->bucket -= cost;
+
+			borrow = min(band->quantum, band->bucket);
+			band->bucket -= borrow;
+			pcpu->tokens[i] = borrow;
 		} else if (band->rate > band_exceeded_rate) {
 			band_exceeded_rate = band->rate;
 			band_exceeded_max = i;
 		}
 	}
 
+	pcpu->filled = now_ms;
+
 	if (band_exceeded_max >= 0) {
 		/* Update band statistics. */
 		band = &meter->bands[band_exceeded_max];
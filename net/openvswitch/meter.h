@@ -14,6 +14,7 @@
 #include <linux/genetlink.h>
 #include <linux/skbuff.h>
 #include <linux/bits.h>
+#include <linux/u64_stats_sync.h>
 
 #include "flow.h"
 struct datapath;
@@ -22,12 +23,29 @@ struct datapath;
 #define DP_METER_ARRAY_SIZE_MIN	BIT_ULL(10)
 #define DP_METER_NUM_MAX	(200000UL)
 
+/* All CPUs together may hold at most 1/8th of a band's burst size. */
+#define DP_METER_PCPU_ERR_SHIFT	3
+/* Tokens borrowed by a CPU are handed back after this long. */
+#define DP_METER_PCPU_MAX_AGE_MS	10
+
 struct dp_meter_band {
 	u32 type;
 	u32 rate;
 	u32 burst_size;
 	u64 bucket; /* 1/1000 packets, or in bits */
+	u64 quantum; /* tokens a CPU borrows from 'bucket' at a time */
+	struct ovs_flow_stats stats;
+};
+
+/* Tokens borrowed from the meter bands, so that packets can be metered
+ * without taking the meter lock.
+ */
+struct dp_meter_pcpu {
+	struct u64_stats_sync syncp;
 	struct ovs_flow_stats stats;
+	u64 used;
+	u64 filled; /* when 'tokens' were borrowed, in ms */
+	u64 tokens[DP_MAX_BANDS];
 };
 
 struct dp_meter {
@@ -39,6 +57,7 @@ struct dp_meter {
 	u32 max_delta_t;
 	u64 used;
 	struct ovs_flow_stats stats;
+	struct dp_meter_pcpu __percpu *pcpu;
 	struct dp_meter_band bands[];
 };
 
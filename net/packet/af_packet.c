@@ -546,25 +546,38 @@ static void prb_del_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 	del_timer_sync(&pkc->retire_blk_timer);
 }
 
+static void __prb_shutdown_retire_blk_timer(struct tpacket_kbdq_core *pkc)
+{
+	spin_lock_bh(pkc->rx_lock);
+	pkc->delete_blk_timer = 1;
+	spin_unlock_bh(pkc->rx_lock);
+
+	prb_del_retire_blk_timer(pkc);
+}
+
 static void prb_shutdown_retire_blk_timer(struct packet_sock *po,
 		struct sk_buff_head *rb_queue)
 {
-	struct tpacket_kbdq_core *pkc;
-
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	struct tpacket_kbdq_core *rings;
+	unsigned int cpu;
 
 	spin_lock_bh(&rb_queue->lock);
-	pkc->delete_blk_timer = 1;
+	rings = po->rx_ring.prb_cpu_rings;
+	po->rx_ring.prb_cpu_rings = NULL;
 	spin_unlock_bh(&rb_queue->lock);
 
-	prb_del_retire_blk_timer(pkc);
+	if (!rings) {
+		__prb_shutdown_retire_blk_timer(GET_PBDQC_FROM_RB(&po->rx_ring));
+		return;
+	}
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++)
+		__prb_shutdown_retire_blk_timer(&rings[cpu]);
+	kfree(rings);
 }
 
-static void prb_setup_retire_blk_timer(struct packet_sock *po)
+static void prb_setup_retire_blk_timer(struct tpacket_kbdq_core *pkc)
 {
-	struct tpacket_kbdq_core *pkc;
-
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	timer_setup(&pkc->retire_blk_timer, prb_retire_rx_blk_timer_expired,
 		    0);
 	pkc->retire_blk_timer.expires = jiffies;
@@ -613,39 +626,96 @@ static void prb_init_ft_ops(struct tpacket_kbdq_core *p1,
 	p1->feature_req_word = req_u->req3.tp_feature_req_word;
 }
 
-static void init_prb_bdqc(struct packet_sock *po,
-			struct packet_ring_buffer *rb,
-			struct pgv *pg_vec,
-			union tpacket_req_u *req_u)
+static void prb_init_core(struct packet_sock *po,
+			  struct tpacket_kbdq_core *p1,
+			  struct pgv *pg_vec, unsigned int block_nr,
+			  unsigned short retire_blk_tov,
+			  union tpacket_req_u *req_u)
 {
-	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
-	struct tpacket_block_desc *pbd;
-
 	memset(p1, 0x0, sizeof(*p1));
 
+	p1->po = po;
+	p1->rx_lock = &po->sk.sk_receive_queue.lock;
 	p1->knxt_seq_num = 1;
 	p1->pkbdq = pg_vec;
-	pbd = (struct tpacket_block_desc *)pg_vec[0].buffer;
 	p1->pkblk_start	= pg_vec[0].buffer;
 	p1->kblk_size = req_u->req3.tp_block_size;
-	p1->knum_blocks	= req_u->req3.tp_block_nr;
+	p1->knum_blocks	= block_nr;
 	p1->hdrlen = po->tp_hdrlen;
 	p1->version = po->tp_version;
 	p1->last_kactive_blk_num = 0;
-	po->stats.stats3.tp_freeze_q_cnt = 0;
-	if (req_u->req3.tp_retire_blk_tov)
-		p1->retire_blk_tov = req_u->req3.tp_retire_blk_tov;
-	else
-		p1->retire_blk_tov = prb_calc_retire_blk_tmo(po,
-						req_u->req3.tp_block_size);
+	p1->retire_blk_tov = retire_blk_tov;
 	p1->tov_in_jiffies = msecs_to_jiffies(p1->retire_blk_tov);
 	p1->blk_sizeof_priv = req_u->req3.tp_sizeof_priv;
 	rwlock_init(&p1->blk_fill_in_prog_lock);
 
 	p1->max_frame_len = p1->kblk_size - BLK_PLUS_PRIV(p1->blk_sizeof_priv);
 	prb_init_ft_ops(p1, req_u);
-	prb_setup_retire_blk_timer(po);
-	prb_open_block(p1, pbd);
+}
+
+/* With TP_FT_REQ_PERCPU_BLOCKS the blocks of the mapping are handed out
+ * in nr_cpu_ids contiguous sub-rings of tp_block_nr / nr_cpu_ids blocks,
+ * sub-ring N being filled only by packets received on CPU N. Each sub-ring
+ * has its own lock, retire timer and sequence numbers, so receive CPUs
+ * never contend on the ring; user space walks every sub-ring in turn and
+ * a single poll() on the socket reports any of them having a block ready.
+ */
+static int init_prb_bdqc(struct packet_sock *po,
+			struct packet_ring_buffer *rb,
+			struct pgv *pg_vec,
+			union tpacket_req_u *req_u)
+{
+	struct tpacket_kbdq_core *p1 = GET_PBDQC_FROM_RB(rb);
+	unsigned int block_nr = req_u->req3.tp_block_nr;
+	struct tpacket_kbdq_core *rings;
+	unsigned short retire_blk_tov;
+	unsigned int cpu;
+
+	if (req_u->req3.tp_retire_blk_tov)
+		retire_blk_tov = req_u->req3.tp_retire_blk_tov;
+	else
+		retire_blk_tov = prb_calc_retire_blk_tmo(po,
+						req_u->req3.tp_block_size);
+
+	po->stats.stats3.tp_freeze_q_cnt = 0;
+	prb_init_core(po, p1, pg_vec, block_nr, retire_blk_tov, req_u);
+
+	if (!(p1->feature_req_word & TP_FT_REQ_PERCPU_BLOCKS)) {
+		prb_setup_retire_blk_timer(p1);
+		prb_open_block(p1, (struct tpacket_block_desc *)pg_vec[0].buffer);
+		return 0;
+	}
+
+	if (block_nr % nr_cpu_ids)
+		return -EINVAL;
+	block_nr /= nr_cpu_ids;
+
+	rings = kcalloc(nr_cpu_ids, sizeof(*rings), GFP_KERNEL);
+	if (!rings)
+		return -ENOMEM;
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		struct tpacket_kbdq_core *pkc = &rings[cpu];
+		struct pgv *pkbdq = &pg_vec[cpu * block_nr];
+
+		prb_init_core(po, pkc, pkbdq, block_nr, retire_blk_tov, req_u);
+		spin_lock_init(&pkc->percpu_lock);
+		pkc->rx_lock = &pkc->percpu_lock;
+		prb_setup_retire_blk_timer(pkc);
+		prb_open_block(pkc, (struct tpacket_block_desc *)pkbdq[0].buffer);
+	}
+	rb->prb_cpu_rings = rings;
+	return 0;
+}
+
+/* The block queue written to from this CPU */
+static struct tpacket_kbdq_core *prb_rx_core(const struct packet_sock *po)
+{
+	struct tpacket_kbdq_core *rings = po->rx_ring.prb_cpu_rings;
+
+	if (rings)
+		return &rings[smp_processor_id()];
+	return GET_PBDQC_FROM_RB(&po->rx_ring);
 }
 
 /*  Do NOT update the last_blk_num first.
@@ -683,13 +753,12 @@ static void _prb_refresh_rx_retire_blk_timer(struct tpacket_kbdq_core *pkc)
  */
 static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 {
-	struct packet_sock *po =
-		from_timer(po, t, rx_ring.prb_bdqc.retire_blk_timer);
-	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
+	struct tpacket_kbdq_core *pkc = from_timer(pkc, t, retire_blk_timer);
+	struct packet_sock *po = pkc->po;
 	unsigned int frozen;
 	struct tpacket_block_desc *pbd;
 
-	spin_lock(&po->sk.sk_receive_queue.lock);
+	spin_lock(pkc->rx_lock);
 
 	frozen = prb_queue_frozen(pkc);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
@@ -751,7 +820,7 @@ static void prb_retire_rx_blk_timer_expired(struct timer_list *t)
 	_prb_refresh_rx_retire_blk_timer(pkc);
 
 out:
-	spin_unlock(&po->sk.sk_receive_queue.lock);
+	spin_unlock(pkc->rx_lock);
 }
 
 static void prb_flush_block(struct tpacket_kbdq_core *pkc1,
@@ -915,7 +984,10 @@ static void prb_freeze_queue(struct tpacket_kbdq_core *pkc,
 				  struct packet_sock *po)
 {
 	pkc->reset_pending_on_curr_blk = 1;
-	po->stats.stats3.tp_freeze_q_cnt++;
+	if (po->rx_ring.prb_cpu_rings)
+		pkc->tp_freeze_q_cnt++;
+	else
+		po->stats.stats3.tp_freeze_q_cnt++;
 }
 
 #define TOTAL_PKT_LEN_INCL_ALIGN(length) (ALIGN((length), V3_ALIGNMENT))
@@ -987,11 +1059,9 @@ static int prb_queue_frozen(struct tpacket_kbdq_core *pkc)
 	return pkc->reset_pending_on_curr_blk;
 }
 
-static void prb_clear_blk_fill_status(struct packet_ring_buffer *rb)
+static void prb_clear_blk_fill_status(struct tpacket_kbdq_core *pkc)
 	__releases(&pkc->blk_fill_in_prog_lock)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
-
 	read_unlock(&pkc->blk_fill_in_prog_lock);
 }
 
@@ -1051,17 +1121,16 @@ static void prb_fill_curr_block(char *curr,
 	prb_run_all_ft_ops(pkc, ppd);
 }
 
-/* Assumes caller has the sk->rx_queue.lock */
+/* Assumes caller has the pkc->rx_lock */
 static void *__packet_lookup_frame_in_block(struct packet_sock *po,
+					    struct tpacket_kbdq_core *pkc,
 					    struct sk_buff *skb,
 					    unsigned int len
 					    )
 {
-	struct tpacket_kbdq_core *pkc;
 	struct tpacket_block_desc *pbd;
 	char *curr, *end;
 
-	pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	pbd = GET_CURR_PBLOCK_DESC_FROM_CORE(pkc);
 
 	/* Queue is frozen when user space is lagging behind */
@@ -1114,6 +1183,7 @@ static void *__packet_lookup_frame_in_block(struct packet_sock *po,
 }
 
 static void *packet_current_rx_frame(struct packet_sock *po,
+					    struct tpacket_kbdq_core *pkc,
 					    struct sk_buff *skb,
 					    int status, unsigned int len)
 {
@@ -1125,7 +1195,7 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 					po->rx_ring.head, status);
 		return curr;
 	case TPACKET_V3:
-		return __packet_lookup_frame_in_block(po, skb, len);
+		return __packet_lookup_frame_in_block(po, pkc, skb, len);
 	default:
 		WARN(1, "TPACKET version not supported\n");
 		BUG();
@@ -1133,12 +1203,10 @@ static void *packet_current_rx_frame(struct packet_sock *po,
 	}
 }
 
-static void *prb_lookup_block(const struct packet_sock *po,
-			      const struct packet_ring_buffer *rb,
+static void *prb_lookup_block(const struct tpacket_kbdq_core *pkc,
 			      unsigned int idx,
 			      int status)
 {
-	struct tpacket_kbdq_core *pkc  = GET_PBDQC_FROM_RB(rb);
 	struct tpacket_block_desc *pbd = GET_PBLOCK_DESC(pkc, idx);
 
 	if (status != BLOCK_STATUS(pbd))
@@ -1146,13 +1214,14 @@ static void *prb_lookup_block(const struct packet_sock *po,
 	return pbd;
 }
 
-static int prb_previous_blk_num(struct packet_ring_buffer *rb)
+static int prb_previous_blk_num(const struct tpacket_kbdq_core *pkc)
 {
-	unsigned int prev;
-	if (rb->prb_bdqc.kactive_blk_num)
-		prev = rb->prb_bdqc.kactive_blk_num-1;
+	unsigned int prev, active = READ_ONCE(pkc->kactive_blk_num);
+
+	if (active)
+		prev = active - 1;
 	else
-		prev = rb->prb_bdqc.knum_blocks-1;
+		prev = pkc->knum_blocks - 1;
 	return prev;
 }
 
@@ -1161,8 +1230,22 @@ static void *__prb_previous_block(struct packet_sock *po,
 					 struct packet_ring_buffer *rb,
 					 int status)
 {
-	unsigned int previous = prb_previous_blk_num(rb);
-	return prb_lookup_block(po, rb, previous, status);
+	struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(rb);
+	unsigned int cpu;
+	void *pbd = NULL;
+
+	if (!rb->prb_cpu_rings)
+		return prb_lookup_block(pkc, prb_previous_blk_num(pkc),
+					status);
+
+	/* NULL as soon as one sub-ring's last block is not in @status */
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		pkc = &rb->prb_cpu_rings[cpu];
+		pbd = prb_lookup_block(pkc, prb_previous_blk_num(pkc), status);
+		if (!pbd)
+			return NULL;
+	}
+	return pbd;
 }
 
 static void *packet_previous_rx_frame(struct packet_sock *po,
@@ -1264,15 +1347,24 @@ static bool __tpacket_has_room(const struct packet_sock *po, int pow_off)
 
 static bool __tpacket_v3_has_room(const struct packet_sock *po, int pow_off)
 {
+	const struct tpacket_kbdq_core *pkc = GET_PBDQC_FROM_RB(&po->rx_ring);
 	int idx, len;
 
-	len = READ_ONCE(po->rx_ring.prb_bdqc.knum_blocks);
-	idx = READ_ONCE(po->rx_ring.prb_bdqc.kactive_blk_num);
+	/*
+	 * This is also reached from recvmsg() and poll() through
+	 * packet_rcv_try_clear_pressure(), with preemption enabled. This is
+	 * only an estimate, so the ring of whatever CPU we are on will do.
+	 */
+	if (po->rx_ring.prb_cpu_rings)
+		pkc = &po->rx_ring.prb_cpu_rings[raw_smp_processor_id()];
+
+	len = READ_ONCE(pkc->knum_blocks);
+	idx = READ_ONCE(pkc->kactive_blk_num);
 	if (pow_off)
 		idx += len >> pow_off;
 	if (idx >= len)
 		idx -= len;
-	return prb_lookup_block(po, &po->rx_ring, idx, TP_STATUS_KERNEL);
+	return prb_lookup_block(pkc, idx, TP_STATUS_KERNEL);
 }
 
 static int __packet_rcv_has_room(const struct packet_sock *po,
@@ -2255,6 +2347,8 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	bool is_drop_n_account = false;
 	unsigned int slot_id = 0;
 	bool do_vnet = false;
+	struct tpacket_kbdq_core *pkc = NULL;
+	spinlock_t *rx_lock;
 
 	/* struct tpacket{2,3}_hdr is aligned to a multiple of TPACKET_ALIGNMENT.
 	 * We may add members to them until current aligned size without forcing
@@ -2356,8 +2450,13 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			do_vnet = false;
 		}
 	}
-	spin_lock(&sk->sk_receive_queue.lock);
-	h.raw = packet_current_rx_frame(po, skb,
+	rx_lock = &sk->sk_receive_queue.lock;
+	if (po->tp_version == TPACKET_V3) {
+		pkc = prb_rx_core(po);
+		rx_lock = pkc->rx_lock;
+	}
+	spin_lock(rx_lock);
+	h.raw = packet_current_rx_frame(po, pkc, skb,
 					TP_STATUS_KERNEL, (macoff+snaplen));
 	if (!h.raw)
 		goto drop_n_account;
@@ -2374,7 +2473,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 				    sizeof(struct virtio_net_hdr),
 				    vio_le(), true, 0)) {
 		if (po->tp_version == TPACKET_V3)
-			prb_clear_blk_fill_status(&po->rx_ring);
+			prb_clear_blk_fill_status(pkc);
 		goto drop_n_account;
 	}
 
@@ -2390,13 +2489,16 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 			status |= TP_STATUS_LOSING;
 	}
 
-	po->stats.stats1.tp_packets++;
+	if (po->rx_ring.prb_cpu_rings)
+		pkc->tp_packets++;
+	else
+		po->stats.stats1.tp_packets++;
 	if (copy_skb) {
 		status |= TP_STATUS_COPY;
 		skb_clear_delivery_time(copy_skb);
 		__skb_queue_tail(&sk->sk_receive_queue, copy_skb);
 	}
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(rx_lock);
 
 	skb_copy_bits(skb, 0, h.raw + macoff, snaplen);
 
@@ -2489,7 +2591,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 		spin_unlock(&sk->sk_receive_queue.lock);
 		sk->sk_data_ready(sk);
 	} else if (po->tp_version == TPACKET_V3) {
-		prb_clear_blk_fill_status(&po->rx_ring);
+		prb_clear_blk_fill_status(pkc);
 	}
 
 drop_n_restore:
@@ -2505,7 +2607,7 @@ static int tpacket_rcv(struct sk_buff *skb, struct net_device *dev,
 	return 0;
 
 drop_n_account:
-	spin_unlock(&sk->sk_receive_queue.lock);
+	spin_unlock(rx_lock);
 	atomic_inc(&po->tp_drops);
 	is_drop_n_account = true;
 
@@ -4017,6 +4119,24 @@ packet_setsockopt(struct socket *sock, int level, int optname, sockptr_t optval,
 	}
 }
 
+/* Caller holds sk_receive_queue.lock, which keeps the sub-rings around */
+static void packet_fold_cpu_ring_stats(struct packet_sock *po,
+				       struct tpacket_stats_v3 *st)
+{
+	unsigned int cpu;
+
+	for (cpu = 0; cpu < nr_cpu_ids; cpu++) {
+		struct tpacket_kbdq_core *pkc = &po->rx_ring.prb_cpu_rings[cpu];
+
+		spin_lock(pkc->rx_lock);
+		st->tp_packets += pkc->tp_packets;
+		st->tp_freeze_q_cnt += pkc->tp_freeze_q_cnt;
+		pkc->tp_packets = 0;
+		pkc->tp_freeze_q_cnt = 0;
+		spin_unlock(pkc->rx_lock);
+	}
+}
+
 static int packet_getsockopt(struct socket *sock, int level, int optname,
 			     char __user *optval, int __user *optlen)
 {
@@ -4043,6 +4163,8 @@ static int packet_getsockopt(struct socket *sock, int level, int optname,
 		spin_lock_bh(&sk->sk_receive_queue.lock);
 		memcpy(&st, &po->stats, sizeof(st));
 		memset(&po->stats, 0, sizeof(po->stats));
+		if (po->rx_ring.prb_cpu_rings)
+			packet_fold_cpu_ring_stats(po, &st.stats3);
 		spin_unlock_bh(&sk->sk_receive_queue.lock);
 		drops = atomic_xchg(&po->tp_drops, 0);
 
@@ -4438,7 +4560,9 @@ static int packet_set_ring(struct sock *sk, union tpacket_req_u *req_u,
 		case TPACKET_V3:
 			/* Block transmit is not supported yet */
 			if (!tx_ring) {
-				init_prb_bdqc(po, rb, pg_vec, req_u);
+				err = init_prb_bdqc(po, rb, pg_vec, req_u);
+				if (err)
+					goto out_free_pg_vec;
 			} else {
 				struct tpacket_req3 *req3 = &req_u->req3;
 
@@ -4,6 +4,13 @@
 
 #include <linux/refcount.h>
 
+/* Split the TPACKET_V3 rx ring into one block sub-ring per possible CPU,
+ * see init_prb_bdqc().
+ */
+#ifndef TP_FT_REQ_PERCPU_BLOCKS
+#define TP_FT_REQ_PERCPU_BLOCKS	0x2
+#endif
+
 struct packet_mclist {
 	struct packet_mclist	*next;
 	int			ifindex;
@@ -41,6 +48,16 @@ struct tpacket_kbdq_core {
 
 	rwlock_t	blk_fill_in_prog_lock;
 
+	/* Writers to this queue serialize on rx_lock: sk_receive_queue.lock
+	 * for a single ring, or percpu_lock for a per-CPU sub-ring, which
+	 * then also accounts its own packets and freezes.
+	 */
+	struct packet_sock *po;
+	spinlock_t	*rx_lock;
+	spinlock_t	percpu_lock;
+	unsigned int	tp_packets;
+	unsigned int	tp_freeze_q_cnt;
+
 	/* Default is set to 8ms */
 #define DEFAULT_PRB_RETIRE_TOV	(8)
 
@@ -74,6 +91,9 @@ struct packet_ring_buffer {
 		unsigned long			*rx_owner_map;
 		struct tpacket_kbdq_core	prb_bdqc;
 	};
+
+	/* nr_cpu_ids sub-rings of a TP_FT_REQ_PERCPU_BLOCKS rx ring */
+	struct tpacket_kbdq_core	*prb_cpu_rings;
 };
 
 extern struct mutex fanout_mutex;
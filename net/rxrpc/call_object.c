@@ -64,6 +64,21 @@ void rxrpc_reduce_call_timer(struct rxrpc_call *call,
 			     unsigned long now,
 			     enum rxrpc_timer_trace why)
 {
+	/*
+	 * Every transmitted packet pushes out one or more of the call's
+	 * deadlines, almost always to later than the timer is already due.
+	 * When the timer fires, rxrpc_process_call() rearms it from all the
+	 * deadlines anyway, so in that case there's no need to take a ref
+	 * only for timer_reduce() to do nothing.  The barrier orders the
+	 * caller's update of the deadline before the check.
+	 */
+	smp_mb();
+	if (timer_pending(&call->timer) &&
+	    time_before_eq(READ_ONCE(call->timer.expires), expire_at)) {
+		trace_rxrpc_timer(call, why, now);
+		return;
+	}
+
 	if (rxrpc_try_get_call(call, rxrpc_call_got_timer)) {
 		trace_rxrpc_timer(call, why, now);
 		if (timer_reduce(&call->timer, expire_at))
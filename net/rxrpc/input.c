@@ -16,6 +16,7 @@
 #include <linux/in6.h>
 #include <linux/icmp.h>
 #include <linux/gfp.h>
+#include <linux/kthread.h>
 #include <net/sock.h>
 #include <net/af_rxrpc.h>
 #include <net/ip.h>
@@ -1230,17 +1231,12 @@ int rxrpc_extract_header(struct rxrpc_skb_priv *sp, struct sk_buff *skb)
 
 /*
  * handle data received on the local endpoint
- * - may be called in interrupt context
  *
- * [!] Note that as this is called from the encap_rcv hook, the socket is not
- * held locked by the caller and nothing prevents sk_user_data on the UDP from
- * being cleared in the middle of processing this function.
- *
- * Called with the RCU read lock held from the IP layer via UDP.
+ * Called from the endpoint's I/O thread with the RCU read lock held and
+ * BHs disabled, as the IP layer would call it.
  */
-int rxrpc_input_packet(struct sock *udp_sk, struct sk_buff *skb)
+static int rxrpc_input_packet(struct rxrpc_local *local, struct sk_buff *skb)
 {
-	struct rxrpc_local *local = rcu_dereference_sk_user_data(udp_sk);
 	struct rxrpc_connection *conn;
 	struct rxrpc_channel *chan;
 	struct rxrpc_call *call = NULL;
@@ -1249,14 +1245,7 @@ int rxrpc_input_packet(struct sock *udp_sk, struct sk_buff *skb)
 	struct rxrpc_sock *rx = NULL;
 	unsigned int channel;
 
-	_enter("%p", udp_sk);
-
-	if (unlikely(!local)) {
-		kfree_skb(skb);
-		return 0;
-	}
-	if (skb->tstamp == 0)
-		skb->tstamp = ktime_get_real();
+	_enter("%p", local);
 
 	rxrpc_new_skb(skb, rxrpc_skb_received);
 
@@ -1500,3 +1489,79 @@ int rxrpc_input_packet(struct sock *udp_sk, struct sk_buff *skb)
 	_leave(" [badmsg]");
 	return 0;
 }
+
+/*
+ * Take a packet from the UDP encap_rcv hook and hand it to the endpoint's
+ * I/O thread.
+ * - may be called in interrupt context
+ *
+ * [!] Note that as this is called from the encap_rcv hook, the socket is not
+ * held locked by the caller and nothing prevents sk_user_data on the UDP from
+ * being cleared in the middle of processing this function.
+ *
+ * Called with the RCU read lock held from the IP layer via UDP.
+ */
+int rxrpc_encap_rcv(struct sock *udp_sk, struct sk_buff *skb)
+{
+	struct rxrpc_local *local = rcu_dereference_sk_user_data(udp_sk);
+
+	if (unlikely(!local)) {
+		kfree_skb(skb);
+		return 0;
+	}
+	if (skb->tstamp == 0)
+		skb->tstamp = ktime_get_real();
+
+	skb_dst_force(skb);
+	skb_queue_tail(&local->rx_queue, skb);
+	wake_up_process(local->io_thread);
+	return 0;
+}
+
+/*
+ * Per-endpoint I/O thread.  Everything that arrived since the last wakeup is
+ * taken off the queue in one go and processed as a batch, so that a burst of
+ * DATA and ACK packets costs a single wakeup and the softirq only has to queue
+ * the packets.
+ */
+int rxrpc_io_thread(void *data)
+{
+	struct rxrpc_local *local = data;
+	struct sk_buff_head rx_queue;
+	struct sk_buff *skb;
+
+	skb_queue_head_init(&rx_queue);
+
+	for (;;) {
+		if (!skb_queue_empty(&local->rx_queue)) {
+			spin_lock_irq(&local->rx_queue.lock);
+			skb_queue_splice_tail_init(&local->rx_queue, &rx_queue);
+			spin_unlock_irq(&local->rx_queue.lock);
+		}
+
+		while ((skb = __skb_dequeue(&rx_queue))) {
+			if (local->dead) {
+				kfree_skb(skb);
+				continue;
+			}
+			rcu_read_lock();
+			local_bh_disable();
+			rxrpc_input_packet(local, skb);
+			local_bh_enable();
+			rcu_read_unlock();
+			cond_resched();
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!skb_queue_empty(&local->rx_queue)) {
+			__set_current_state(TASK_RUNNING);
+			continue;
+		}
+		if (kthread_should_stop())
+			break;
+		schedule();
+	}
+
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
@@ -8,6 +8,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/module.h>
+#include <linux/kthread.h>
 #include <linux/net.h>
 #include <linux/skbuff.h>
 #include <linux/slab.h>
@@ -85,6 +86,7 @@ static struct rxrpc_local *rxrpc_alloc_local(struct rxrpc_net *rxnet,
 		INIT_HLIST_NODE(&local->link);
 		INIT_WORK(&local->processor, rxrpc_local_processor);
 		init_rwsem(&local->defrag_sem);
+		skb_queue_head_init(&local->rx_queue);
 		skb_queue_head_init(&local->reject_queue);
 		skb_queue_head_init(&local->event_queue);
 		local->client_bundles = RB_ROOT;
@@ -110,6 +112,7 @@ static int rxrpc_open_socket(struct rxrpc_local *local, struct net *net)
 	struct udp_tunnel_sock_cfg tuncfg = {NULL};
 	struct sockaddr_rxrpc *srx = &local->srx;
 	struct udp_port_cfg udp_conf = {0};
+	struct task_struct *io_thread;
 	struct sock *usk;
 	int ret;
 
@@ -135,8 +138,20 @@ static int rxrpc_open_socket(struct rxrpc_local *local, struct net *net)
 		return ret;
 	}
 
+	/* The thread must exist before the first packet can be queued for it */
+	io_thread = kthread_run(rxrpc_io_thread, local,
+				"krxrpcio/%d", local->debug_id);
+	if (IS_ERR(io_thread)) {
+		sock_release(local->socket);
+		local->socket = NULL;
+		ret = PTR_ERR(io_thread);
+		_leave(" = %d [thread]", ret);
+		return ret;
+	}
+	local->io_thread = io_thread;
+
 	tuncfg.encap_type = UDP_ENCAP_RXRPC;
-	tuncfg.encap_rcv = rxrpc_input_packet;
+	tuncfg.encap_rcv = rxrpc_encap_rcv;
 	tuncfg.encap_err_rcv = rxrpc_encap_err_rcv;
 	tuncfg.sk_user_data = local;
 	setup_udp_tunnel_sock(net, local->socket, &tuncfg);
@@ -389,9 +404,19 @@ static void rxrpc_local_destroyer(struct rxrpc_local *local)
 		sock_release(socket);
 	}
 
+	if (local->io_thread) {
+		/* Let any encap_rcv that still saw the endpoint finish queueing
+		 * and waking the thread before the thread goes away.
+		 */
+		synchronize_rcu();
+		kthread_stop(local->io_thread);
+		local->io_thread = NULL;
+	}
+
 	/* At this point, there should be no more packets coming in to the
 	 * local endpoint.
 	 */
+	skb_queue_purge(&local->rx_queue);
 	rxrpc_purge_queue(&local->reject_queue);
 	rxrpc_purge_queue(&local->event_queue);
 }
@@ -299,7 +299,12 @@ static struct rpcrdma_mr_seg *rpcrdma_mr_prepare(struct rpcrdma_xprt *r_xprt,
 						 struct rpcrdma_mr **mr)
 {
 	*mr = rpcrdma_mr_pop(&req->rl_free_mrs);
-	if (!*mr) {
+	if (*mr) {
+		r_xprt->rx_stats.mr_cache_hits++;
+		trace_xprtrdma_mr_cache(r_xprt, req, true);
+	} else {
+		r_xprt->rx_stats.mr_cache_misses++;
+		trace_xprtrdma_mr_cache(r_xprt, req, false);
 		*mr = rpcrdma_mr_get(r_xprt);
 		if (!*mr)
 			goto out_getmr_err;
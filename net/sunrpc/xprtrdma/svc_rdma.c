@@ -62,6 +62,12 @@ static unsigned int max_max_requests = 16384;
 unsigned int svcrdma_max_req_size = RPCRDMA_DEF_INLINE_THRESH;
 static unsigned int min_max_inline = RPCRDMA_DEF_INLINE_THRESH;
 static unsigned int max_max_inline = RPCRDMA_MAX_INLINE_THRESH;
+unsigned int svcrdma_cq_poll_ctx = IB_POLL_WORKQUEUE;
+/* Completion handlers take the transport locks without _bh and allocate
+ * receive contexts with GFP_KERNEL, so they must run in process context.
+ */
+static unsigned int min_cq_poll_ctx = IB_POLL_WORKQUEUE;
+static unsigned int max_cq_poll_ctx = IB_POLL_UNBOUND_WORKQUEUE;
 static unsigned int svcrdma_stat_unused;
 static unsigned int zero;
 
@@ -135,6 +141,15 @@ static struct ctl_table svcrdma_parm_table[] = {
 		.extra1		= &min_ord,
 		.extra2		= &max_ord,
 	},
+	{
+		.procname	= "cq_poll_ctx",
+		.data		= &svcrdma_cq_poll_ctx,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &min_cq_poll_ctx,
+		.extra2		= &max_cq_poll_ctx,
+	},
 
 	{
 		.procname	= "rdma_stat_read",
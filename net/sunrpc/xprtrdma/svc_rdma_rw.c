@@ -62,8 +62,10 @@ svc_rdma_get_rw_ctxt(struct svcxprt_rdma *rdma, unsigned int sges)
 	if (node) {
 		ctxt = llist_entry(node, struct svc_rdma_rw_ctxt, rw_node);
 	} else {
-		ctxt = kmalloc(struct_size(ctxt, rw_first_sgl, SG_CHUNK_SIZE),
-			       GFP_KERNEL);
+		ctxt = kmalloc_node(struct_size(ctxt, rw_first_sgl,
+						SG_CHUNK_SIZE),
+				    GFP_KERNEL,
+				    ibdev_to_node(rdma->sc_pd->device));
 		if (!ctxt)
 			goto out_noctx;
 
@@ -371,6 +371,7 @@ static struct svc_xprt *svc_rdma_accept(struct svc_xprt *xprt)
 	struct rpcrdma_connect_private pmsg;
 	struct ib_qp_init_attr qp_attr;
 	unsigned int ctxts, rq_depth;
+	enum ib_poll_context poll_ctx;
 	struct ib_device *dev;
 	int ret = 0;
 	RPC_IFDEBUG(struct sockaddr *sap);
@@ -431,12 +432,18 @@ static struct svc_xprt *svc_rdma_accept(struct svc_xprt *xprt)
 		trace_svcrdma_pd_err(newxprt, PTR_ERR(newxprt->sc_pd));
 		goto errout;
 	}
+	/* ib_alloc_cq_any() spreads the CQs of successive connections
+	 * over the device's completion vectors. The polling context is
+	 * sampled once per connection; IB_POLL_UNBOUND_WORKQUEUE lets the
+	 * scheduler move completion handling off a loaded core.
+	 */
+	poll_ctx = READ_ONCE(svcrdma_cq_poll_ctx);
 	newxprt->sc_sq_cq = ib_alloc_cq_any(dev, newxprt, newxprt->sc_sq_depth,
-					    IB_POLL_WORKQUEUE);
+					    poll_ctx);
 	if (IS_ERR(newxprt->sc_sq_cq))
 		goto errout;
 	newxprt->sc_rq_cq =
-		ib_alloc_cq_any(dev, newxprt, rq_depth, IB_POLL_WORKQUEUE);
+		ib_alloc_cq_any(dev, newxprt, rq_depth, poll_ctx);
 	if (IS_ERR(newxprt->sc_rq_cq))
 		goto errout;
 
@@ -395,6 +395,8 @@ struct rpcrdma_stats {
 	unsigned long		write_chunk_count;
 	unsigned long		reply_chunk_count;
 	unsigned long long	total_rdma_request;
+	unsigned long		mr_cache_hits;
+	unsigned long		mr_cache_misses;
 
 	/* rarely accessed error counters */
 	unsigned long long	pullup_copy_count;
@@ -1307,6 +1307,11 @@ static int tls_sw_do_sendpage(struct sock *sk, struct page *page,
 			full_record = true;
 		}
 
+		/* The page is only referenced. Encryption reads the plaintext
+		 * straight from it, e.g. the page cache for sendfile(), and
+		 * writes the ciphertext into the pages of msg_en, which are
+		 * then handed to TCP as they are.
+		 */
 		sk_msg_page_add(msg_pl, page, copy, offset);
 		msg_pl->sg.copybreak = 0;
 		msg_pl->sg.curr = msg_pl->sg.end;
@@ -1390,6 +1395,23 @@ int tls_sw_sendpage(struct sock *sk, struct page *page,
 	return ret;
 }
 
+/* Data let in by flushing the backlog while the reader holds the socket lock
+ * is only handed to the strparser work, which then has to wait for the lock.
+ * Parse it in place so the reader can keep submitting records for (async)
+ * decryption rather than stopping at the last record that was ready when
+ * it started.
+ */
+static bool tls_rx_rec_ready(struct sock *sk, struct tls_sw_context_rx *ctx)
+{
+	if (tls_strp_msg_ready(ctx))
+		return true;
+	if (skb_queue_empty(&sk->sk_receive_queue))
+		return false;
+
+	tls_strp_check_rcv(&ctx->strp);
+	return tls_strp_msg_ready(ctx);
+}
+
 static int
 tls_rx_rec_wait(struct sock *sk, struct sk_psock *psock, bool nonblock,
 		bool released)
@@ -2088,7 +2110,7 @@ int tls_sw_recvmsg(struct sock *sk,
 	zc_capable = !bpf_strp_enabled && !is_kvec && !is_peek &&
 		ctx->zc_capable;
 	decrypted = 0;
-	while (len && (decrypted + copied < target || tls_strp_msg_ready(ctx))) {
+	while (len && (decrypted + copied < target || tls_rx_rec_ready(sk, ctx))) {
 		struct tls_decrypt_arg darg;
 		int to_decrypt, chunk;
 
@@ -44,6 +44,12 @@ struct virtio_vsock {
 	struct work_struct send_pkt_work;
 	struct sk_buff_head send_pkt_queue;
 
+	/* header, linear payload and one entry per page frag of zerocopy
+	 * packets; too big for the stack of the tx worker
+	 */
+	struct scatterlist *out_sgs[MAX_SKB_FRAGS + 2];
+	struct scatterlist out_bufs[MAX_SKB_FRAGS + 2];
+
 	atomic_t queued_replies;
 
 	/* The following fields are protected by rx_lock.  vqs[VSOCK_VQ_RX]
@@ -100,8 +106,9 @@ virtio_transport_send_pkt_work(struct work_struct *work)
 	vq = vsock->vqs[VSOCK_VQ_TX];
 
 	for (;;) {
-		struct scatterlist hdr, buf, *sgs[2];
-		int ret, in_sg = 0, out_sg = 0;
+		struct scatterlist **sgs = vsock->out_sgs;
+		struct scatterlist *bufs = vsock->out_bufs;
+		int i, ret, in_sg = 0, out_sg = 0;
 		struct sk_buff *skb;
 		bool reply;
 
@@ -111,11 +118,23 @@ virtio_transport_send_pkt_work(struct work_struct *work)
 
 		reply = virtio_vsock_skb_reply(skb);
 
-		sg_init_one(&hdr, virtio_vsock_hdr(skb), sizeof(*virtio_vsock_hdr(skb)));
-		sgs[out_sg++] = &hdr;
-		if (skb->len > 0) {
-			sg_init_one(&buf, skb->data, skb->len);
-			sgs[out_sg++] = &buf;
+		sg_init_one(&bufs[out_sg], virtio_vsock_hdr(skb),
+			    sizeof(*virtio_vsock_hdr(skb)));
+		sgs[out_sg] = &bufs[out_sg];
+		out_sg++;
+		if (skb_headlen(skb) > 0) {
+			sg_init_one(&bufs[out_sg], skb->data, skb_headlen(skb));
+			sgs[out_sg] = &bufs[out_sg];
+			out_sg++;
+		}
+		for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+			const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+
+			sg_init_table(&bufs[out_sg], 1);
+			sg_set_page(&bufs[out_sg], skb_frag_page(frag),
+				    skb_frag_size(frag), skb_frag_off(frag));
+			sgs[out_sg] = &bufs[out_sg];
+			out_sg++;
 		}
 
 		ret = virtqueue_add_sgs(vq, sgs, out_sg, in_sg, skb, GFP_KERNEL);
@@ -26,6 +26,9 @@
 /* Threshold for detecting small packets to copy */
 #define GOOD_COPY_LEN  128
 
+/* Below this size pinning the user pages costs more than copying them */
+#define VIRTIO_VSOCK_ZCOPY_MIN_LEN	PAGE_SIZE
+
 static const struct virtio_transport *
 virtio_transport_get_ops(struct vsock_sock *vsk)
 {
@@ -37,6 +40,60 @@ virtio_transport_get_ops(struct vsock_sock *vsk)
 	return container_of(t, struct virtio_transport, transport);
 }
 
+static bool virtio_transport_can_zcopy(struct virtio_vsock_pkt_info *info,
+				       size_t len)
+{
+	struct iov_iter iter;
+	struct sock *sk;
+
+	if (!info->msg || !info->vsk || len < VIRTIO_VSOCK_ZCOPY_MIN_LEN)
+		return false;
+
+	sk = sk_vsock(info->vsk);
+	if (!(info->msg->msg_flags & MSG_ZEROCOPY) ||
+	    !sock_flag(sk, SOCK_ZEROCOPY) ||
+	    !iter_is_iovec(&info->msg->msg_iter))
+		return false;
+
+	/* every page of the payload takes a frag; fall back to copying
+	 * rather than failing half way through the iterator
+	 */
+	iter = info->msg->msg_iter;
+	iov_iter_truncate(&iter, len);
+	return iov_iter_npages(&iter, MAX_SKB_FRAGS + 1) <= MAX_SKB_FRAGS;
+}
+
+/* Pin the user pages of the payload into the frags of @skb. The pages stay
+ * referenced until the device is done with the buffer and the skb is freed;
+ * the completion is then reported on the socket error queue.
+ */
+static int virtio_transport_fill_zcopy(struct sk_buff *skb,
+				       struct virtio_vsock_pkt_info *info,
+				       size_t len)
+{
+	struct sock *sk = sk_vsock(info->vsk);
+	struct ubuf_info *uarg;
+	int err;
+
+	uarg = msg_zerocopy_realloc(sk, len, NULL);
+	if (!uarg)
+		return -ENOMEM;
+
+	/* skb->sk is already set, so the pinned pages are charged to
+	 * sk_wmem_alloc and released with the skb
+	 */
+	err = __zerocopy_sg_from_iter(info->msg, NULL, skb,
+				      &info->msg->msg_iter, len);
+	if (err) {
+		net_zcopy_put_abort(uarg, true);
+		return err;
+	}
+
+	skb_zcopy_set(skb, uarg, NULL);
+	net_zcopy_put(uarg);
+	return 0;
+}
+
 /* Returns a new packet on success, otherwise returns NULL.
  *
  * If NULL is returned, errp is set to a negative errno.
@@ -49,12 +106,15 @@ virtio_transport_alloc_skb(struct virtio_vsock_pkt_info *info,
 			   u32 dst_cid,
 			   u32 dst_port)
 {
-	const size_t skb_len = VIRTIO_VSOCK_SKB_HEADROOM + len;
+	bool zcopy = virtio_transport_can_zcopy(info, len);
 	struct virtio_vsock_hdr *hdr;
 	struct sk_buff *skb;
+	size_t skb_len;
 	void *payload;
 	int err;
 
+	/* zerocopy packets only carry the header in the linear area */
+	skb_len = VIRTIO_VSOCK_SKB_HEADROOM + (zcopy ? 0 : len);
 	skb = virtio_vsock_alloc_skb(skb_len, GFP_KERNEL);
 	if (!skb)
 		return NULL;
@@ -71,9 +131,18 @@ virtio_transport_alloc_skb(struct virtio_vsock_pkt_info *info,
 	hdr->buf_alloc	= cpu_to_le32(0);
 	hdr->fwd_cnt	= cpu_to_le32(0);
 
+	if (info->vsk && !skb_set_owner_sk_safe(skb, sk_vsock(info->vsk))) {
+		WARN_ONCE(1, "failed to allocate skb on vsock socket with sk_refcnt == 0\n");
+		goto out;
+	}
+
 	if (info->msg && len > 0) {
-		payload = skb_put(skb, len);
-		err = memcpy_from_msg(payload, info->msg, len);
+		if (zcopy) {
+			err = virtio_transport_fill_zcopy(skb, info, len);
+		} else {
+			payload = skb_put(skb, len);
+			err = memcpy_from_msg(payload, info->msg, len);
+		}
 		if (err)
 			goto out;
 
@@ -96,11 +165,6 @@ virtio_transport_alloc_skb(struct virtio_vsock_pkt_info *info,
 					 info->op,
 					 info->flags);
 
-	if (info->vsk && !skb_set_owner_sk_safe(skb, sk_vsock(info->vsk))) {
-		WARN_ONCE(1, "failed to allocate skb on vsock socket with sk_refcnt == 0\n");
-		goto out;
-	}
-
 	return skb;
 
 out:
@@ -116,15 +180,13 @@ static struct sk_buff *virtio_transport_build_skb(void *opaque)
 	struct af_vsockmon_hdr *hdr;
 	struct sk_buff *skb;
 	size_t payload_len;
-	void *payload_buf;
 
 	/* A packet could be split to fit the RX buffer, so we can retrieve
 	 * the payload length from the header and the buffer pointer taking
 	 * care of the offset in the original packet.
 	 */
 	pkt_hdr = virtio_vsock_hdr(pkt);
-	payload_len = pkt->len;
-	payload_buf = pkt->data;
+	payload_len = pkt->len - VIRTIO_VSOCK_SKB_CB(pkt)->offset;
 
 	skb = alloc_skb(sizeof(*hdr) + sizeof(*pkt_hdr) + payload_len,
 			GFP_ATOMIC);
@@ -167,7 +229,12 @@ static struct sk_buff *virtio_transport_build_skb(void *opaque)
 	skb_put_data(skb, pkt_hdr, sizeof(*pkt_hdr));
 
 	if (payload_len) {
-		skb_put_data(skb, payload_buf, payload_len);
+		/* zerocopy packets keep the payload in page frags */
+		if (skb_copy_bits(pkt, VIRTIO_VSOCK_SKB_CB(pkt)->offset,
+				  skb_put(skb, payload_len), payload_len)) {
+			kfree_skb(skb);
+			return NULL;
+		}
 	}
 
 	return skb;
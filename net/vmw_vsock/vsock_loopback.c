@@ -31,6 +31,14 @@ static int vsock_loopback_send_pkt(struct sk_buff *skb)
 	struct vsock_loopback *vsock = &the_vsock_loopback;
 	int len = skb->len;
 
+	/* the receive side copies out of the linear area, so zerocopy
+	 * packets are flattened here; this also completes their pages
+	 */
+	if (skb_linearize(skb)) {
+		kfree_skb(skb);
+		return -ENOMEM;
+	}
+
 	skb_queue_tail(&vsock->pkt_queue, skb);
 
 	queue_work(vsock->workqueue, &vsock->pkt_work);
@@ -31,6 +31,7 @@
 #include "xsk.h"
 
 #define TX_BATCH_SIZE 32
+#define TX_BULK_SIZE 16
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
@@ -39,7 +40,7 @@ void xsk_set_rx_need_wakeup(struct xsk_buff_pool *pool)
 	if (pool->cached_need_wakeup & XDP_WAKEUP_RX)
 		return;
 
-	pool->fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+	xskq_set_need_wakeup(pool->fq);
 	pool->cached_need_wakeup |= XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_set_rx_need_wakeup);
@@ -66,7 +67,7 @@ void xsk_clear_rx_need_wakeup(struct xsk_buff_pool *pool)
 	if (!(pool->cached_need_wakeup & XDP_WAKEUP_RX))
 		return;
 
-	pool->fq->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	xskq_clear_need_wakeup(pool->fq);
 	pool->cached_need_wakeup &= ~XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_clear_rx_need_wakeup);
@@ -141,7 +142,7 @@ static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, 0);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -169,17 +170,107 @@ static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+/* Copy @len bytes of packet data starting @off bytes into @from, walking the
+ * linear part first and then any frags.
+ */
+static void xsk_copy_xdp_data(void *to, struct xdp_buff *from, u32 off, u32 len)
+{
+	u32 linear = from->data_end - from->data;
+	struct skb_shared_info *sinfo;
+	u32 copy, i;
+
+	if (off < linear) {
+		copy = min(len, linear - off);
+		memcpy(to, from->data + off, copy);
+		to += copy;
+		len -= copy;
+		off = 0;
+	} else {
+		off -= linear;
+	}
+
+	if (!len)
+		return;
+
+	sinfo = xdp_get_shared_info_from_buff(from);
+	for (i = 0; i < sinfo->nr_frags && len; i++) {
+		skb_frag_t *frag = &sinfo->frags[i];
+		u32 size = skb_frag_size(frag);
+
+		if (off >= size) {
+			off -= size;
+			continue;
+		}
+
+		copy = min(len, size - off);
+		memcpy(to, skb_frag_address(frag) + off, copy);
+		to += copy;
+		len -= copy;
+		off = 0;
+	}
+}
+
+/* Copy a packet that does not fit in one chunk into as many as it needs,
+ * chaining the Rx descriptors with XDP_PKT_CONTD.
+ */
+static int __xsk_rcv_mb(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+{
+	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
+	struct xdp_buff *bufs[XSK_DESC_MAX_FRAGS];
+	u32 nr, i, off, copy;
+
+	nr = DIV_ROUND_UP(len, frame_size);
+	if (!xs->rx->sg || nr > XSK_DESC_MAX_FRAGS) {
+		xs->rx_dropped++;
+		return -ENOSPC;
+	}
+
+	if (xskq_prod_nb_free(xs->rx, nr) < nr) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
+	}
+
+	for (i = 0; i < nr; i++) {
+		bufs[i] = xsk_buff_alloc(xs->pool);
+		if (!bufs[i]) {
+			while (i--)
+				xsk_buff_free(bufs[i]);
+			xs->rx_dropped++;
+			return -ENOMEM;
+		}
+	}
+
+	if (!xdp_data_meta_unsupported(xdp)) {
+		u32 metalen = xdp->data - xdp->data_meta;
+
+		memcpy(bufs[0]->data - metalen, xdp->data_meta, metalen);
+	}
+
+	for (i = 0, off = 0; i < nr; i++, off += copy) {
+		struct xdp_buff_xsk *xskb = container_of(bufs[i], struct xdp_buff_xsk, xdp);
+
+		copy = min(len - off, frame_size);
+		xsk_copy_xdp_data(bufs[i]->data, xdp, off, copy);
+
+		/* Cannot fail, the ring space was checked above */
+		xskq_prod_reserve_desc(xs->rx, xp_get_handle(xskb), copy,
+				       i + 1 < nr ? XDP_PKT_CONTD : 0);
+		xp_release(xskb);
+	}
+
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
 	struct xdp_buff *xsk_xdp;
 	int err;
 	u32 len;
 
-	len = xdp->data_end - xdp->data;
-	if (len > xsk_pool_get_rx_frame_size(xs->pool)) {
-		xs->rx_dropped++;
-		return -ENOSPC;
-	}
+	len = xdp_get_buff_len(xdp);
+	if (unlikely(xdp_buff_has_frags(xdp) ||
+		     len > xsk_pool_get_rx_frame_size(xs->pool)))
+		return __xsk_rcv_mb(xs, xdp, len);
 
 	xsk_xdp = xsk_buff_alloc(xs->pool);
 	if (!xsk_xdp) {
@@ -257,6 +348,10 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 		return err;
 
 	if (xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL) {
+		/* Zero-copy drivers here only ever build single buffer frames */
+		if (WARN_ON_ONCE(xdp_buff_has_frags(xdp)))
+			return -EOPNOTSUPP;
+
 		len = xdp->data_end - xdp->data;
 		return __xsk_rcv_zc(xs, xdp, len);
 	}
@@ -357,6 +452,7 @@ static u32 xsk_tx_peek_release_fallback(struct xsk_buff_pool *pool, u32 max_entr
 
 u32 xsk_tx_peek_release_desc_batch(struct xsk_buff_pool *pool, u32 nb_pkts)
 {
+	u32 budget = nb_pkts;
 	struct xdp_sock *xs;
 
 	rcu_read_lock();
@@ -384,7 +480,11 @@ u32 xsk_tx_peek_release_desc_batch(struct xsk_buff_pool *pool, u32 nb_pkts)
 	if (!nb_pkts)
 		goto out;
 
-	nb_pkts = xskq_cons_read_desc_batch(xs->tx, pool, nb_pkts);
+	/* Only the driver's budget, not a lack of entries or completion
+	 * slots, can keep a packet from ever fitting in a batch.
+	 */
+	nb_pkts = xskq_cons_read_desc_batch(xs->tx, pool, nb_pkts,
+					    nb_pkts == budget);
 	if (!nb_pkts) {
 		xs->tx->queue_empty_descs++;
 		goto out;
@@ -407,28 +507,100 @@ static int xsk_wakeup(struct xdp_sock *xs, u8 flags)
 	return dev->netdev_ops->ndo_xsk_wakeup(dev, xs->queue_id, flags);
 }
 
-static void xsk_destruct_skb(struct sk_buff *skb)
+/* Addresses of the descriptors a multi-buffer skb was built from. A single
+ * buffer skb keeps its address in destructor_arg itself.
+ */
+struct xsk_addrs {
+	u32 nr_descs;
+	u64 addrs[];
+};
+
+/* Completion slots are only reserved when a packet is queued. The addresses
+ * are written when it completes, into the first slot not yet published, so
+ * that skbs completing out of order never publish each other's buffers.
+ */
+static void xsk_cq_submit_addrs(struct xdp_sock *xs, u64 *addrs, u32 nr_descs)
 {
-	u64 addr = (u64)(long)skb_shinfo(skb)->destructor_arg;
-	struct xdp_sock *xs = xdp_sk(skb->sk);
+	struct xsk_queue *cq = xs->pool->cq;
 	unsigned long flags;
+	u32 idx, i;
 
 	spin_lock_irqsave(&xs->pool->cq_lock, flags);
-	xskq_prod_submit_addr(xs->pool->cq, addr);
+	idx = xskq_get_prod(cq);
+	for (i = 0; i < nr_descs; i++)
+		xskq_prod_write_addr(cq, idx++, addrs[i]);
+	xskq_prod_submit_n(cq, nr_descs);
 	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+}
+
+static void xsk_destruct_skb(struct sk_buff *skb)
+{
+	u64 addr = (u64)(long)skb_shinfo(skb)->destructor_arg;
 
+	xsk_cq_submit_addrs(xdp_sk(skb->sk), &addr, 1);
 	sock_wfree(skb);
 }
 
+static void xsk_destruct_skb_mb(struct sk_buff *skb)
+{
+	struct xsk_addrs *addrs = skb_shinfo(skb)->destructor_arg;
+
+	xsk_cq_submit_addrs(xdp_sk(skb->sk), addrs->addrs, addrs->nr_descs);
+	kfree(addrs);
+	sock_wfree(skb);
+}
+
+static int xsk_skb_set_destructor(struct sk_buff *skb, struct xdp_desc *descs,
+				  u32 nr_descs)
+{
+	struct xsk_addrs *addrs;
+	u32 i;
+
+	if (nr_descs == 1) {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)descs[0].addr;
+		skb->destructor = xsk_destruct_skb;
+		return 0;
+	}
+
+	addrs = kmalloc(struct_size(addrs, addrs, nr_descs), GFP_KERNEL);
+	if (!addrs)
+		return -ENOMEM;
+
+	addrs->nr_descs = nr_descs;
+	for (i = 0; i < nr_descs; i++)
+		addrs->addrs[i] = descs[i].addr;
+
+	skb_shinfo(skb)->destructor_arg = addrs;
+	skb->destructor = xsk_destruct_skb_mb;
+	return 0;
+}
+
+/* Detach the descriptors from an skb that was not sent, returning their number. */
+static u32 xsk_skb_clear_destructor(struct sk_buff *skb)
+{
+	struct xsk_addrs *addrs;
+	u32 nr_descs = 1;
+
+	if (skb->destructor == xsk_destruct_skb_mb) {
+		addrs = skb_shinfo(skb)->destructor_arg;
+		nr_descs = addrs->nr_descs;
+		kfree(addrs);
+	}
+
+	skb->destructor = sock_wfree;
+	return nr_descs;
+}
+
 static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
-					      struct xdp_desc *desc)
+					      struct xdp_desc *descs,
+					      u32 nr_descs)
 {
 	struct xsk_buff_pool *pool = xs->pool;
 	u32 hr, len, ts, offset, copy, copied;
 	struct sk_buff *skb;
 	struct page *page;
 	void *buffer;
-	int err, i;
+	int err, i, d;
 	u64 addr;
 
 	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
@@ -439,53 +611,61 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 
 	skb_reserve(skb, hr);
 
-	addr = desc->addr;
-	len = desc->len;
-	ts = pool->unaligned ? len : pool->chunk_size;
+	for (d = 0, i = 0; d < nr_descs; d++) {
+		addr = descs[d].addr;
+		len = descs[d].len;
+		ts = pool->unaligned ? len : pool->chunk_size;
 
-	buffer = xsk_buff_raw_get_data(pool, addr);
-	offset = offset_in_page(buffer);
-	addr = buffer - pool->addrs;
+		buffer = xsk_buff_raw_get_data(pool, addr);
+		offset = offset_in_page(buffer);
+		addr = buffer - pool->addrs;
 
-	for (copied = 0, i = 0; copied < len; i++) {
-		page = pool->umem->pgs[addr >> PAGE_SHIFT];
-		get_page(page);
+		for (copied = 0; copied < len; i++) {
+			if (unlikely(i == MAX_SKB_FRAGS)) {
+				kfree_skb(skb);
+				return ERR_PTR(-EOVERFLOW);
+			}
 
-		copy = min_t(u32, PAGE_SIZE - offset, len - copied);
-		skb_fill_page_desc(skb, i, page, offset, copy);
+			page = pool->umem->pgs[addr >> PAGE_SHIFT];
+			get_page(page);
 
-		copied += copy;
-		addr += copy;
-		offset = 0;
-	}
+			copy = min_t(u32, PAGE_SIZE - offset, len - copied);
+			skb_fill_page_desc(skb, i, page, offset, copy);
+
+			copied += copy;
+			addr += copy;
+			offset = 0;
+		}
 
-	skb->len += len;
-	skb->data_len += len;
-	skb->truesize += ts;
+		skb->len += len;
+		skb->data_len += len;
+		skb->truesize += ts;
 
-	refcount_add(ts, &xs->sk.sk_wmem_alloc);
+		refcount_add(ts, &xs->sk.sk_wmem_alloc);
+	}
 
 	return skb;
 }
 
 static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
-				     struct xdp_desc *desc)
+				     struct xdp_desc *descs, u32 nr_descs)
 {
 	struct net_device *dev = xs->dev;
 	struct sk_buff *skb;
 
 	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
-		skb = xsk_build_skb_zerocopy(xs, desc);
+		skb = xsk_build_skb_zerocopy(xs, descs, nr_descs);
 		if (IS_ERR(skb))
 			return skb;
 	} else {
-		u32 hr, tr, len;
+		u32 hr, tr, len, off, i;
 		void *buffer;
 		int err;
 
 		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
 		tr = dev->needed_tailroom;
-		len = desc->len;
+		for (len = 0, i = 0; i < nr_descs; i++)
+			len += descs[i].len;
 
 		skb = sock_alloc_send_skb(&xs->sk, hr + len + tr, 1, &err);
 		if (unlikely(!skb))
@@ -494,29 +674,98 @@ static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
 		skb_reserve(skb, hr);
 		skb_put(skb, len);
 
-		buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		if (unlikely(err)) {
-			kfree_skb(skb);
-			return ERR_PTR(err);
+		for (off = 0, i = 0; i < nr_descs; off += descs[i++].len) {
+			buffer = xsk_buff_raw_get_data(xs->pool, descs[i].addr);
+			err = skb_store_bits(skb, off, buffer, descs[i].len);
+			if (unlikely(err)) {
+				kfree_skb(skb);
+				return ERR_PTR(err);
+			}
 		}
 	}
 
 	skb->dev = dev;
 	skb->priority = xs->sk.sk_priority;
 	skb->mark = READ_ONCE(xs->sk.sk_mark);
-	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
-	skb->destructor = xsk_destruct_skb;
 
 	return skb;
 }
 
+static void xsk_cq_cancel(struct xdp_sock *xs, u32 nr_descs)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	xskq_prod_cancel_n(xs->pool->cq, nr_descs);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+}
+
+/* The checks __dev_direct_xmit() does before taking the Tx lock. The skb is
+ * freed if it can't be sent.
+ */
+static struct sk_buff *xsk_validate_xmit_skb(struct xdp_sock *xs,
+					     struct sk_buff *skb)
+{
+	struct net_device *dev = xs->dev;
+	struct sk_buff *orig_skb = skb;
+	bool again = false;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		goto drop;
+
+	skb = validate_xmit_skb_list(skb, dev, &again);
+	if (skb != orig_skb)
+		goto drop;
+
+	skb_set_queue_mapping(skb, xs->queue_id);
+	return skb;
+
+drop:
+	dev_core_stats_tx_dropped_inc(dev);
+	kfree_skb_list(skb);
+	return NULL;
+}
+
+/* Hand a batch of skbs to the driver under a single Tx lock, with xmit_more
+ * set on all but the last one so that the doorbell is rung once per batch.
+ * Returns the number of skbs the driver took.
+ */
+static u32 xsk_direct_xmit_bulk(struct xdp_sock *xs, struct sk_buff **skbs,
+				u32 nr_skbs)
+{
+	struct net_device *dev = xs->dev;
+	struct netdev_queue *txq;
+	u32 i;
+
+	txq = netdev_get_tx_queue(dev, xs->queue_id);
+
+	local_bh_disable();
+	dev_xmit_recursion_inc();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	for (i = 0; i < nr_skbs; i++) {
+		if (netif_xmit_frozen_or_drv_stopped(txq))
+			break;
+		if (!dev_xmit_complete(netdev_start_xmit(skbs[i], dev, txq,
+							 i + 1 < nr_skbs)))
+			break;
+	}
+	HARD_TX_UNLOCK(dev, txq);
+	dev_xmit_recursion_dec();
+	local_bh_enable();
+
+	return i;
+}
+
 static int __xsk_generic_xmit(struct sock *sk)
 {
+	struct xdp_desc descs[XSK_DESC_MAX_FRAGS];
+	u64 addrs[XSK_DESC_MAX_FRAGS];
 	struct xdp_sock *xs = xdp_sk(sk);
-	u32 max_batch = TX_BATCH_SIZE;
-	bool sent_frame = false;
-	struct xdp_desc desc;
+	u32 max_batch = xs->tx->max_tx_budget ? : TX_BATCH_SIZE;
+	u32 nr_skbs, nr_sent, nr_descs, nr_dropped, i;
+	struct sk_buff *skbs[TX_BULK_SIZE];
+	bool sent_frame = false, done = false;
+	u32 cons[TX_BULK_SIZE];
 	struct sk_buff *skb;
 	unsigned long flags;
 	int err = 0;
@@ -532,59 +781,113 @@ static int __xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
-		}
+	while (!done) {
+		nr_dropped = 0;
 
-		/* This is the backpressure mechanism for the Tx path.
-		 * Reserve space in the completion queue and only proceed
-		 * if there is space in it. This avoids having to implement
-		 * any buffering in the Tx path.
-		 */
-		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
-		}
-		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+		for (nr_skbs = 0; nr_skbs < TX_BULK_SIZE; nr_skbs++) {
+			/* Only batch packets that are already in the cached part
+			 * of the ring. Fetching more entries publishes the
+			 * consumer pointer, which must not move past packets
+			 * that may still be handed back to user-space.
+			 */
+			if (nr_skbs && xs->tx->cached_cons == xs->tx->cached_prod)
+				break;
+
+			nr_descs = xskq_cons_peek_pkt(xs->tx, descs,
+						      XSK_DESC_MAX_FRAGS,
+						      xs->pool);
+			if (!nr_descs) {
+				xs->tx->queue_empty_descs++;
+				done = true;
+				break;
+			}
+
+			if (max_batch-- == 0) {
+				err = -EAGAIN;
+				done = true;
+				break;
+			}
 
-		skb = xsk_build_skb(xs, &desc);
-		if (IS_ERR(skb)) {
-			err = PTR_ERR(skb);
+			/* This is the backpressure mechanism for the Tx path.
+			 * Reserve space in the completion queue and only proceed
+			 * if there is space in it for every descriptor of the
+			 * packet. This avoids having to implement any buffering
+			 * in the Tx path.
+			 */
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			if (xskq_prod_nb_free(xs->pool->cq, nr_descs) < nr_descs) {
+				spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+				done = true;
+				break;
+			}
+			xskq_prod_reserve_n(xs->pool->cq, nr_descs);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+
+			skb = xsk_build_skb(xs, descs, nr_descs);
+			if (PTR_ERR_OR_ZERO(skb) == -EOVERFLOW) {
+				/* Too many frags to ever be sent, drop it */
+				xs->tx->invalid_descs += nr_descs;
+				nr_dropped = nr_descs;
+				break;
+			}
+			if (IS_ERR(skb)) {
+				err = PTR_ERR(skb);
+				xsk_cq_cancel(xs, nr_descs);
+				done = true;
+				break;
+			}
+
+			skb = xsk_validate_xmit_skb(xs, skb);
+			if (!skb) {
+				/* Completed once the packets before it are sent */
+				nr_dropped = nr_descs;
+				err = -EBUSY;
+				done = true;
+				break;
+			}
+
+			err = xsk_skb_set_destructor(skb, descs, nr_descs);
+			if (unlikely(err)) {
+				kfree_skb(skb);
+				xsk_cq_cancel(xs, nr_descs);
+				done = true;
+				break;
+			}
+
+			cons[nr_skbs] = xs->tx->cached_cons;
+			xskq_cons_release_n(xs->tx, nr_descs);
+			skbs[nr_skbs] = skb;
 		}
 
-		err = __dev_direct_xmit(skb, xs->queue_id);
-		if  (err == NETDEV_TX_BUSY) {
-			/* Tell user-space to retry the send */
-			skb->destructor = sock_wfree;
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			/* Free skb without triggering the perf drop trace */
-			consume_skb(skb);
+		nr_sent = nr_skbs ? xsk_direct_xmit_bulk(xs, skbs, nr_skbs) : 0;
+		if (nr_sent)
+			sent_frame = true;
+
+		if (nr_sent < nr_skbs) {
+			/* Tell user-space to retry the send of the rest */
+			for (nr_descs = nr_dropped, i = nr_sent; i < nr_skbs; i++) {
+				skb = skbs[i];
+				nr_descs += xsk_skb_clear_destructor(skb);
+				/* Free skb without triggering the perf drop trace */
+				consume_skb(skb);
+			}
+			xsk_cq_cancel(xs, nr_descs);
+			xs->tx->cached_cons = cons[nr_sent];
 			err = -EAGAIN;
 			goto out;
 		}
 
-		xskq_cons_release(xs->tx);
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
+		if (nr_dropped) {
+			/* SKB completed but not sent. It was the last packet
+			 * peeked, so its descriptors are still in descs.
+			 */
+			for (i = 0; i < nr_dropped; i++)
+				addrs[i] = descs[i].addr;
+			xsk_cq_submit_addrs(xs, addrs, nr_dropped);
+			xskq_cons_release_n(xs->tx, nr_dropped);
 		}
-
-		sent_frame = true;
 	}
 
-	xs->tx->queue_empty_descs++;
-
 out:
 	if (sent_frame)
 		if (xsk_tx_writeable(xs))
@@ -896,7 +1199,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG | XDP_SHARE_RINGS))
 		return -EINVAL;
 
 	bound_dev_if = READ_ONCE(sk->sk_bound_dev_if);
@@ -923,12 +1226,17 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	qid = sxdp->sxdp_queue_id;
 
+	if (xs->rx)
+		xs->rx->sg = !!(flags & XDP_USE_SG);
+	if (xs->tx)
+		xs->tx->sg = !!(flags & XDP_USE_SG);
+
 	if (flags & XDP_SHARED_UMEM) {
 		struct xdp_sock *umem_xs;
 		struct socket *sock;
 
 		if ((flags & XDP_COPY) || (flags & XDP_ZEROCOPY) ||
-		    (flags & XDP_USE_NEED_WAKEUP)) {
+		    (flags & XDP_USE_NEED_WAKEUP) || (flags & XDP_SHARE_RINGS)) {
 			/* Cannot specify flags for shared sockets. */
 			err = -EINVAL;
 			goto out_unlock;
@@ -953,6 +1261,13 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			goto out_unlock;
 		}
 
+		if ((flags & XDP_USE_SG) && umem_xs->umem->zc) {
+			/* Multi-buffer needs copy mode, see xp_assign_dev() */
+			err = -EOPNOTSUPP;
+			sockfd_put(sock);
+			goto out_unlock;
+		}
+
 		if (umem_xs->queue_id != qid || umem_xs->dev != dev) {
 			/* Share the umem with another socket on another qid
 			 * and/or device.
@@ -1014,12 +1329,31 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			goto out_unlock;
 		}
 
+		if (flags & XDP_SHARE_RINGS) {
+			err = xp_share_rings(xs->pool);
+			if (err) {
+				xp_destroy(xs->pool);
+				xs->pool = NULL;
+				goto out_unlock;
+			}
+		}
+
 		err = xp_assign_dev(xs->pool, dev, qid, flags);
 		if (err) {
+			if (flags & XDP_SHARE_RINGS) {
+				xskq_destroy(xs->pool->fq);
+				xskq_destroy(xs->pool->cq);
+			}
 			xp_destroy(xs->pool);
 			xs->pool = NULL;
 			goto out_unlock;
 		}
+
+		/* The pool's caches hold their own references. */
+		if (flags & XDP_SHARE_RINGS) {
+			xskq_destroy(xs->fq_tmp);
+			xskq_destroy(xs->cq_tmp);
+		}
 	}
 
 	/* FQ and CQ are now owned by the buffer pool and cleaned up with it. */
@@ -1121,6 +1455,24 @@ static int xsk_setsockopt(struct socket *sock, int level, int optname,
 		mutex_unlock(&xs->mutex);
 		return 0;
 	}
+	case XDP_MAX_TX_SKB_BUDGET:
+	{
+		unsigned int budget;
+
+		if (optlen < sizeof(budget))
+			return -EINVAL;
+		if (copy_from_sockptr(&budget, optval, sizeof(budget)))
+			return -EFAULT;
+
+		mutex_lock(&xs->mutex);
+		if (!xs->tx || !budget || budget > xs->tx->nentries) {
+			mutex_unlock(&xs->mutex);
+			return -EINVAL;
+		}
+		WRITE_ONCE(xs->tx->max_tx_budget, budget);
+		mutex_unlock(&xs->mutex);
+		return 0;
+	}
 	case XDP_UMEM_FILL_RING:
 	case XDP_UMEM_COMPLETION_RING:
 	{
@@ -11,6 +11,33 @@
 #define XSK_NEXT_PG_CONTIG_SHIFT 0
 #define XSK_NEXT_PG_CONTIG_MASK BIT_ULL(XSK_NEXT_PG_CONTIG_SHIFT)
 
+/* Multi-buffer support: a socket bound with XDP_USE_SG may split a packet
+ * over several Rx/Tx descriptors, all but the last of which carry
+ * XDP_PKT_CONTD in their options field.
+ */
+#ifndef XDP_USE_SG
+#define XDP_USE_SG	(1 << 4)
+#endif
+#ifndef XDP_PKT_CONTD
+#define XDP_PKT_CONTD	(1 << 0)
+#endif
+
+/* Maximum number of descriptors a single packet may be made of. */
+#define XSK_DESC_MAX_FRAGS	(MAX_SKB_FRAGS + 1)
+
+/* Bind flag: the fill and completion rings of this socket's umem may be
+ * shared by XDP_SHARED_UMEM sockets on other queues that register no rings
+ * of their own. Each queue then works on a kernel-side cache of those rings.
+ */
+#ifndef XDP_SHARE_RINGS
+#define XDP_SHARE_RINGS	(1 << 5)
+#endif
+
+/* Socket option: maximum number of packets sent per copy-mode Tx call. */
+#ifndef XDP_MAX_TX_SKB_BUDGET
+#define XDP_MAX_TX_SKB_BUDGET	9
+#endif
+
 struct xdp_ring_offset_v1 {
 	__u64 producer;
 	__u64 consumer;
@@ -44,5 +71,6 @@ void xsk_map_try_sock_delete(struct xsk_map *map, struct xdp_sock *xs,
 void xsk_clear_pool_at_qid(struct net_device *dev, u16 queue_id);
 int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 			u16 queue_id);
+int xp_share_rings(struct xsk_buff_pool *pool);
 
 #endif /* XSK_H_ */
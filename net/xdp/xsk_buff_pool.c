@@ -178,6 +178,12 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 		/* For copy-mode, we are done. */
 		return 0;
 
+	/* No zero-copy driver in this tree chains buffers, see xsk_rcv() */
+	if (flags & XDP_USE_SG) {
+		err = -EOPNOTSUPP;
+		goto err_unreg_pool;
+	}
+
 	if (!netdev->netdev_ops->ndo_bpf ||
 	    !netdev->netdev_ops->ndo_xsk_wakeup) {
 		err = -EOPNOTSUPP;
@@ -212,13 +218,61 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 	return err;
 }
 
+/* Put caches in front of the pool's fill and completion rings so that pools
+ * on other queues can share them, see xp_assign_dev_shared(). The caches take
+ * their own references to the rings, the socket's are left untouched.
+ */
+int xp_share_rings(struct xsk_buff_pool *pool)
+{
+	struct xsk_queue *fq, *cq;
+
+	fq = xskq_create_cache(pool->fq);
+	cq = xskq_create_cache(pool->cq);
+	if (!fq || !cq) {
+		xskq_destroy(fq);
+		xskq_destroy(cq);
+		return -ENOMEM;
+	}
+
+	pool->fq = fq;
+	pool->cq = cq;
+
+	return 0;
+}
+
+static int xp_attach_shared_rings(struct xsk_buff_pool *pool,
+				  struct xsk_buff_pool *umem_pool)
+{
+	pool->fq = xskq_create_cache(umem_pool->fq->parent);
+	pool->cq = xskq_create_cache(umem_pool->cq->parent);
+	if (!pool->fq || !pool->cq) {
+		xskq_destroy(pool->fq);
+		xskq_destroy(pool->cq);
+		pool->fq = NULL;
+		pool->cq = NULL;
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 int xp_assign_dev_shared(struct xsk_buff_pool *pool, struct xdp_sock *umem_xs,
 			 struct net_device *dev, u16 queue_id)
 {
 	u16 flags;
 	struct xdp_umem *umem = umem_xs->umem;
+	bool shared = false;
+	int err;
+
+	/* Use the umem owner's rings if it shares them and we have none. */
+	if (!pool->fq && !pool->cq && umem_xs->pool->fq->parent) {
+		err = xp_attach_shared_rings(pool, umem_xs->pool);
+		if (err)
+			return err;
+		shared = true;
+	}
 
-	/* One fill and completion ring required for each queue id. */
+	/* Otherwise one fill and completion ring required for each queue id. */
 	if (!pool->fq || !pool->cq)
 		return -EINVAL;
 
@@ -226,7 +280,15 @@ int xp_assign_dev_shared(struct xsk_buff_pool *pool, struct xdp_sock *umem_xs,
 	if (umem_xs->pool->uses_need_wakeup)
 		flags |= XDP_USE_NEED_WAKEUP;
 
-	return xp_assign_dev(pool, dev, queue_id, flags);
+	err = xp_assign_dev(pool, dev, queue_id, flags);
+	if (err && shared) {
+		xskq_destroy(pool->fq);
+		xskq_destroy(pool->cq);
+		pool->fq = NULL;
+		pool->cq = NULL;
+	}
+
+	return err;
 }
 
 void xp_clear_dev(struct xsk_buff_pool *pool)
@@ -32,6 +32,9 @@ struct xsk_queue *xskq_create(u32 nentries, bool umem_queue)
 
 	q->nentries = nentries;
 	q->ring_mask = nentries - 1;
+	spin_lock_init(&q->lock);
+	INIT_LIST_HEAD(&q->stash);
+	refcount_set(&q->users, 1);
 
 	gfp_flags = GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN |
 		    __GFP_COMP  | __GFP_NORETRY;
@@ -47,11 +50,213 @@ struct xsk_queue *xskq_create(u32 nentries, bool umem_queue)
 	return q;
 }
 
+static void xskq_free(struct xsk_queue *q)
+{
+	page_frag_free(q->ring);
+	kfree(q);
+}
+
+static bool xskq_cache_release(struct xsk_queue *q);
+
 void xskq_destroy(struct xsk_queue *q)
 {
+	struct xsk_queue *parent, *cache, *tmp;
+
+	if (!q || !refcount_dec_and_test(&q->users))
+		return;
+
+	parent = q->parent;
+	if (parent) {
+		/* The shared ring frees a stashed cache once it is empty */
+		if (xskq_cache_release(q))
+			q = NULL;
+		xskq_destroy(parent);
+	} else {
+		list_for_each_entry_safe(cache, tmp, &q->stash, stash_node)
+			xskq_free(cache);
+	}
+
+	if (q)
+		xskq_free(q);
+}
+
+/* Maximum number of entries moved between a cache and its shared ring at a
+ * time, so that one busy queue does not drain the fill ring at the expense
+ * of the others.
+ */
+#define XSKQ_CACHE_BATCH	256
+
+/* A cache going away may still hold fill entries pulled from the shared
+ * ring, or completions not yet pushed to it. It is then kept on the shared
+ * ring's stash and the remaining caches move its entries on before their
+ * own. Called with the last reference to @q dropped, returns true if it was
+ * stashed.
+ */
+static bool xskq_cache_release(struct xsk_queue *q)
+{
+	struct xsk_queue *parent = q->parent;
+	unsigned long flags;
+	bool stashed;
+
+	/* The pool consumed a fill cache up to cached_cons, while
+	 * xskq_cache_flush() consumed a completion cache up to ring->consumer.
+	 * What is left starts at whichever of the two is further on.
+	 */
+	if ((s32)(q->ring->consumer - q->cached_cons) > 0)
+		q->cached_cons = q->ring->consumer;
+
+	spin_lock_irqsave(&parent->lock, flags);
+	if ((q->ring->flags & XDP_RING_NEED_WAKEUP) && !--parent->nr_need_wakeup)
+		parent->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+
+	stashed = q->cached_cons != q->ring->producer;
+	if (stashed)
+		list_add_tail(&q->stash_node, &parent->stash);
+	spin_unlock_irqrestore(&parent->lock, flags);
+
+	return stashed;
+}
+
+/* Take the next entry left in a stashed cache, freeing the caches found
+ * empty. Called with the shared ring's lock held.
+ */
+static bool xskq_cache_unstash(struct xsk_queue *parent, u64 *addr)
+{
+	struct xsk_queue *q;
+
+	while ((q = list_first_entry_or_null(&parent->stash, struct xsk_queue,
+					     stash_node))) {
+		if (q->cached_cons != q->ring->producer) {
+			__xskq_cons_read_addr_unchecked(q, q->cached_cons++, addr);
+			return true;
+		}
+
+		list_del(&q->stash_node);
+		xskq_free(q);
+	}
+
+	return false;
+}
+
+/* A cache is a kernel-only fill or completion ring standing in front of a
+ * ring shared by the pools of several queues. The pool uses it exactly like
+ * its own ring, lock free, while entries are moved to or from the shared
+ * ring in batches under the shared ring's lock.
+ */
+struct xsk_queue *xskq_create_cache(struct xsk_queue *parent)
+{
+	struct xsk_queue *q;
+
+	q = xskq_create(parent->nentries, true);
 	if (!q)
+		return NULL;
+
+	refcount_inc(&parent->users);
+	q->parent = parent;
+
+	return q;
+}
+
+/* Called by the consumer of a fill ring cache when it needs more entries. */
+void xskq_cache_refill(struct xsk_queue *q)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+	struct xsk_queue *parent = q->parent;
+	struct xdp_umem_ring *pring = (struct xdp_umem_ring *)parent->ring;
+	u32 prod = q->ring->producer;
+	unsigned long flags;
+	u32 nb, i;
+	u64 addr;
+
+	nb = q->nentries - (prod - READ_ONCE(q->ring->consumer));
+	nb = min_t(u32, nb, XSKQ_CACHE_BATCH);
+	if (!nb)
 		return;
 
-	page_frag_free(q->ring);
-	kfree(q);
+	spin_lock_irqsave(&parent->lock, flags);
+	for (i = 0; i < nb && xskq_cache_unstash(parent, &addr); i++)
+		ring->desc[prod++ & q->ring_mask] = addr;
+
+	nb = xskq_cons_nb_entries(parent, nb - i);
+	for (i = 0; i < nb; i++)
+		ring->desc[prod++ & q->ring_mask] =
+			pring->desc[parent->cached_cons++ & parent->ring_mask];
+	if (nb)
+		__xskq_cons_release(parent);
+	spin_unlock_irqrestore(&parent->lock, flags);
+
+	smp_store_release(&q->ring->producer, prod);
+}
+
+/* Called by the producer of a completion ring cache to pass entries on. */
+void xskq_cache_flush(struct xsk_queue *q)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+	struct xsk_queue *parent = q->parent;
+	struct xdp_umem_ring *pring = (struct xdp_umem_ring *)parent->ring;
+	u32 cons = q->ring->consumer;
+	u32 nb, free, i;
+	unsigned long flags;
+	u64 addr;
+
+	nb = min_t(u32, q->ring->producer - cons, XSKQ_CACHE_BATCH);
+	if (!nb)
+		return;
+
+	spin_lock_irqsave(&parent->lock, flags);
+	free = xskq_prod_nb_free(parent, XSKQ_CACHE_BATCH);
+	for (i = 0; i < free && xskq_cache_unstash(parent, &addr); i++)
+		pring->desc[parent->cached_prod++ & parent->ring_mask] = addr;
+
+	nb = min(nb, free - i);
+	for (i = 0; i < nb; i++)
+		pring->desc[parent->cached_prod++ & parent->ring_mask] =
+			ring->desc[cons++ & q->ring_mask];
+	if (parent->cached_prod != parent->ring->producer)
+		__xskq_prod_submit(parent, parent->cached_prod);
+	spin_unlock_irqrestore(&parent->lock, flags);
+
+	smp_store_release(&q->ring->consumer, cons);
+}
+
+/* The need_wakeup flag of a shared fill ring stays set for as long as any of
+ * the queues caching it wants to be woken up. Each cache records its own
+ * request in the flags of its kernel-only ring.
+ */
+void xskq_set_need_wakeup(struct xsk_queue *q)
+{
+	struct xsk_queue *parent = q->parent;
+	unsigned long flags;
+
+	if (!parent) {
+		q->ring->flags |= XDP_RING_NEED_WAKEUP;
+		return;
+	}
+
+	spin_lock_irqsave(&parent->lock, flags);
+	if (!(q->ring->flags & XDP_RING_NEED_WAKEUP)) {
+		q->ring->flags |= XDP_RING_NEED_WAKEUP;
+		if (!parent->nr_need_wakeup++)
+			parent->ring->flags |= XDP_RING_NEED_WAKEUP;
+	}
+	spin_unlock_irqrestore(&parent->lock, flags);
+}
+
+void xskq_clear_need_wakeup(struct xsk_queue *q)
+{
+	struct xsk_queue *parent = q->parent;
+	unsigned long flags;
+
+	if (!parent) {
+		q->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+		return;
+	}
+
+	spin_lock_irqsave(&parent->lock, flags);
+	if (q->ring->flags & XDP_RING_NEED_WAKEUP) {
+		q->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+		if (!--parent->nr_need_wakeup)
+			parent->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	}
+	spin_unlock_irqrestore(&parent->lock, flags);
 }
@@ -45,8 +45,26 @@ struct xsk_queue {
 	struct xdp_ring *ring;
 	u64 invalid_descs;
 	u64 queue_empty_descs;
+	/* Packets may span several descriptors chained with XDP_PKT_CONTD */
+	bool sg;
+	/* Drop descriptors up to the end of the current packet */
+	bool skip_pkt;
+	/* Copy-mode Tx budget per call, 0 for the default */
+	u32 max_tx_budget;
+	/* Shared fill or completion ring this queue caches, see xskq_create_cache() */
+	struct xsk_queue *parent;
+	/* Serializes the caches of a shared ring */
+	spinlock_t lock;
+	u32 nr_need_wakeup;
+	/* Caches that went away with entries left, see xskq_cache_release() */
+	struct list_head stash;
+	struct list_head stash_node;
+	refcount_t users;
 };
 
+void xskq_cache_refill(struct xsk_queue *q);
+void xskq_cache_flush(struct xsk_queue *q);
+
 /* The structure of the shared state of the rings are a simple
  * circular buffer, as outlined in
  * Documentation/core-api/circular-buffers.rst. For the Rx and
@@ -144,7 +162,7 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 	if (chunk >= pool->addrs_cnt)
 		return false;
 
-	if (desc->options)
+	if (desc->options & ~XDP_PKT_CONTD)
 		return false;
 	return true;
 }
@@ -165,7 +183,7 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
 
-	if (desc->options)
+	if (desc->options & ~XDP_PKT_CONTD)
 		return false;
 	return true;
 }
@@ -181,13 +199,20 @@ static inline bool xskq_cons_is_valid_desc(struct xsk_queue *q,
 					   struct xdp_desc *d,
 					   struct xsk_buff_pool *pool)
 {
-	if (!xp_validate_desc(pool, d)) {
+	if (!xp_validate_desc(pool, d) ||
+	    (!q->sg && (d->options & XDP_PKT_CONTD))) {
 		q->invalid_descs++;
 		return false;
 	}
 	return true;
 }
 
+/* Drop what is left of the packet @desc was part of. */
+static inline void xskq_cons_drop_pkt(struct xsk_queue *q, struct xdp_desc *desc)
+{
+	q->skip_pkt = q->sg && (desc->options & XDP_PKT_CONTD);
+}
+
 static inline bool xskq_cons_read_desc(struct xsk_queue *q,
 				       struct xdp_desc *desc,
 				       struct xsk_buff_pool *pool)
@@ -211,10 +236,14 @@ static inline void xskq_cons_release_n(struct xsk_queue *q, u32 cnt)
 	q->cached_cons += cnt;
 }
 
+/* Read up to @max descriptors, never ending in the middle of a packet. With
+ * @drop_partial, a packet too long to ever fit in @max descriptors is dropped
+ * rather than left on the ring, where it would block all that follow it.
+ */
 static inline u32 xskq_cons_read_desc_batch(struct xsk_queue *q, struct xsk_buff_pool *pool,
-					    u32 max)
+					    u32 max, bool drop_partial)
 {
-	u32 cached_cons = q->cached_cons, nb_entries = 0;
+	u32 cached_cons = q->cached_cons, nb_entries = 0, nr_frags = 0;
 	struct xdp_desc *descs = pool->tx_descs;
 
 	while (cached_cons != q->cached_prod && nb_entries < max) {
@@ -222,21 +251,112 @@ static inline u32 xskq_cons_read_desc_batch(struct xsk_queue *q, struct xsk_buff
 		u32 idx = cached_cons & q->ring_mask;
 
 		descs[nb_entries] = ring->desc[idx];
+		cached_cons++;
+		if (unlikely(q->skip_pkt)) {
+			q->skip_pkt = descs[nb_entries].options & XDP_PKT_CONTD;
+			continue;
+		}
+
 		if (unlikely(!xskq_cons_is_valid_desc(q, &descs[nb_entries], pool))) {
-			/* Skip the entry */
-			cached_cons++;
+			/* Skip the entry, and the packet it was part of */
+			xskq_cons_drop_pkt(q, &descs[nb_entries]);
+			nb_entries -= nr_frags;
+			nr_frags = 0;
 			continue;
 		}
 
 		nb_entries++;
-		cached_cons++;
+		if (!(descs[nb_entries - 1].options & XDP_PKT_CONTD)) {
+			nr_frags = 0;
+		} else if (++nr_frags == XSK_DESC_MAX_FRAGS) {
+			q->invalid_descs++;
+			q->skip_pkt = true;
+			nb_entries -= nr_frags;
+			nr_frags = 0;
+		}
+	}
+
+	if (unlikely(drop_partial && nr_frags == max)) {
+		q->invalid_descs++;
+		q->skip_pkt = true;
+		nb_entries = 0;
+		nr_frags = 0;
 	}
 
+	/* Leave a trailing partial packet on the ring for the next batch */
+	cached_cons -= nr_frags;
+	nb_entries -= nr_frags;
+
 	/* Release valid plus any invalid entries */
 	xskq_cons_release_n(q, cached_cons - q->cached_cons);
 	return nb_entries;
 }
 
+/* Read the descriptors making up the next packet into @descs, following the
+ * XDP_PKT_CONTD chain, without releasing them. Packets containing an invalid
+ * descriptor, or made of more than @max descriptors, are dropped as a whole,
+ * including the part of them not on the ring yet. Returns the
+ * number of descriptors, or 0 if the ring does not hold a complete packet.
+ * The caller releases the entries with xskq_cons_release_n().
+ */
+static inline u32 xskq_cons_peek_pkt(struct xsk_queue *q, struct xdp_desc *descs,
+				     u32 max, struct xsk_buff_pool *pool)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 cached_cons, nr;
+	bool valid;
+
+	if (q->cached_prod == q->cached_cons)
+		xskq_cons_get_entries(q);
+
+again:
+	cached_cons = q->cached_cons;
+	valid = true;
+	nr = 0;
+
+	for (;;) {
+		struct xdp_desc *desc = &descs[nr];
+
+		if (cached_cons == q->cached_prod) {
+			/* Don't publish the consumer, the packet isn't done */
+			__xskq_cons_peek(q);
+			if (cached_cons == q->cached_prod)
+				return 0;
+		}
+
+		*desc = ring->desc[cached_cons++ & q->ring_mask];
+		if (unlikely(q->skip_pkt)) {
+			q->skip_pkt = desc->options & XDP_PKT_CONTD;
+			valid = false;
+			break;
+		}
+
+		if (!xskq_cons_is_valid_desc(q, desc, pool)) {
+			/* The rest of the chain can't be trusted either */
+			xskq_cons_drop_pkt(q, desc);
+			valid = false;
+			break;
+		}
+
+		if (!(desc->options & XDP_PKT_CONTD))
+			break;
+
+		if (++nr == max) {
+			q->invalid_descs++;
+			q->skip_pkt = true;
+			valid = false;
+			break;
+		}
+	}
+
+	if (!valid) {
+		q->cached_cons = cached_cons;
+		goto again;
+	}
+
+	return nr + 1;
+}
+
 /* Functions for consumers */
 
 static inline void __xskq_cons_release(struct xsk_queue *q)
@@ -246,6 +366,9 @@ static inline void __xskq_cons_release(struct xsk_queue *q)
 
 static inline void __xskq_cons_peek(struct xsk_queue *q)
 {
+	if (unlikely(q->parent))
+		xskq_cache_refill(q);
+
 	/* Refresh the local pointer */
 	q->cached_prod = smp_load_acquire(&q->ring->producer);  /* C, matches B */
 }
@@ -314,6 +437,9 @@ static inline u32 xskq_prod_nb_free(struct xsk_queue *q, u32 max)
 	if (free_entries >= max)
 		return max;
 
+	if (unlikely(q->parent))
+		xskq_cache_flush(q);
+
 	/* Refresh the local tail pointer */
 	q->cached_cons = READ_ONCE(q->ring->consumer);
 	free_entries = q->nentries - (q->cached_prod - q->cached_cons);
@@ -331,6 +457,11 @@ static inline void xskq_prod_cancel(struct xsk_queue *q)
 	q->cached_prod--;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
 static inline int xskq_prod_reserve(struct xsk_queue *q)
 {
 	if (xskq_prod_is_full(q))
@@ -353,6 +484,24 @@ static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 	return 0;
 }
 
+static inline void xskq_prod_reserve_n(struct xsk_queue *q, u32 cnt)
+{
+	/* A, matches D */
+	q->cached_prod += cnt;
+}
+
+static inline u32 xskq_get_prod(struct xsk_queue *q)
+{
+	return READ_ONCE(q->ring->producer);
+}
+
+static inline void xskq_prod_write_addr(struct xsk_queue *q, u32 idx, u64 addr)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+
+	ring->desc[idx & q->ring_mask] = addr;
+}
+
 static inline void xskq_prod_write_addr_batch(struct xsk_queue *q, struct xdp_desc *descs,
 					      u32 nb_entries)
 {
@@ -367,7 +516,7 @@ static inline void xskq_prod_write_addr_batch(struct xsk_queue *q, struct xdp_de
 }
 
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 flags)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -379,6 +528,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = flags;
 
 	return 0;
 }
@@ -386,6 +536,9 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 static inline void __xskq_prod_submit(struct xsk_queue *q, u32 idx)
 {
 	smp_store_release(&q->ring->producer, idx); /* B, matches C */
+
+	if (unlikely(q->parent))
+		xskq_cache_flush(q);
 }
 
 static inline void xskq_prod_submit(struct xsk_queue *q)
@@ -393,16 +546,6 @@ static inline void xskq_prod_submit(struct xsk_queue *q)
 	__xskq_prod_submit(q, q->cached_prod);
 }
 
-static inline void xskq_prod_submit_addr(struct xsk_queue *q, u64 addr)
-{
-	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
-	u32 idx = q->ring->producer;
-
-	ring->desc[idx++ & q->ring_mask] = addr;
-
-	__xskq_prod_submit(q, idx);
-}
-
 static inline void xskq_prod_submit_n(struct xsk_queue *q, u32 nb_entries)
 {
 	__xskq_prod_submit(q, q->ring->producer + nb_entries);
@@ -427,6 +570,9 @@ static inline u64 xskq_nb_queue_empty_descs(struct xsk_queue *q)
 }
 
 struct xsk_queue *xskq_create(u32 nentries, bool umem_queue);
+struct xsk_queue *xskq_create_cache(struct xsk_queue *parent);
 void xskq_destroy(struct xsk_queue *q_ops);
+void xskq_set_need_wakeup(struct xsk_queue *q);
+void xskq_clear_need_wakeup(struct xsk_queue *q);
 
 #endif /* _LINUX_XSK_QUEUE_H */
@@ -12,6 +12,7 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/dmaengine.h>
+#include <linux/hrtimer.h>
 #include <linux/slab.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -19,11 +20,23 @@
 
 #include <sound/dmaengine_pcm.h>
 
+static bool timer_wakeup;
+module_param(timer_wakeup, bool, 0644);
+MODULE_PARM_DESC(timer_wakeup,
+		 "Wake up applications at avail_min from an hrtimer sampling the DMA residue");
+
+/* Lower bound of the sampling interval in timer_wakeup mode. */
+#define DMAENGINE_PCM_TIMER_MIN_NS	(250 * NSEC_PER_USEC)
+
 struct dmaengine_pcm_runtime_data {
 	struct dma_chan *dma_chan;
 	dma_cookie_t cookie;
 
 	unsigned int pos;
+
+	struct snd_pcm_substream *substream;
+	struct hrtimer timer;
+	bool use_timer;
 };
 
 static inline struct dmaengine_pcm_runtime_data *substream_to_prtd(
@@ -145,6 +158,75 @@ static void dmaengine_pcm_dma_complete(void *arg)
 	snd_pcm_period_elapsed(substream);
 }
 
+/*
+ * Time until avail_min frames will be available at the current rate, assuming
+ * avail frames are available now.  Once avail_min has been reached, sleepers
+ * have been woken up and we only need to notice the application catching up.
+ */
+static u64 dmaengine_pcm_timer_interval(struct snd_pcm_runtime *runtime,
+					snd_pcm_sframes_t avail)
+{
+	snd_pcm_uframes_t frames = runtime->control->avail_min;
+	u64 ns;
+
+	if (avail >= 0 && avail < frames)
+		frames -= avail;
+
+	ns = div_u64((u64)frames * NSEC_PER_SEC, runtime->rate);
+
+	return max_t(u64, ns, DMAENGINE_PCM_TIMER_MIN_NS);
+}
+
+static enum hrtimer_restart dmaengine_pcm_timer(struct hrtimer *timer)
+{
+	struct dmaengine_pcm_runtime_data *prtd =
+		container_of(timer, struct dmaengine_pcm_runtime_data, timer);
+	struct snd_pcm_substream *substream = prtd->substream;
+	snd_pcm_sframes_t avail;
+
+	avail = snd_pcm_sample_hw_ptr(substream);
+	if (avail < 0)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer,
+		ns_to_ktime(dmaengine_pcm_timer_interval(substream->runtime,
+							 avail)));
+
+	return HRTIMER_RESTART;
+}
+
+static void dmaengine_pcm_timer_start(struct snd_pcm_substream *substream)
+{
+	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	snd_pcm_sframes_t avail;
+
+	if (!prtd->use_timer)
+		return;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		avail = snd_pcm_playback_avail(runtime);
+	else
+		avail = snd_pcm_capture_avail(runtime);
+
+	hrtimer_start(&prtd->timer,
+		      ns_to_ktime(dmaengine_pcm_timer_interval(runtime, avail)),
+		      HRTIMER_MODE_REL);
+}
+
+static void dmaengine_pcm_timer_stop(struct snd_pcm_substream *substream)
+{
+	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
+
+	/*
+	 * Called with the stream lock held, which the callback takes as well,
+	 * so don't wait for it.  A running callback sees the stream stopped
+	 * and doesn't rearm the timer.
+	 */
+	if (prtd->use_timer)
+		hrtimer_try_to_cancel(&prtd->timer);
+}
+
 static int dmaengine_pcm_prepare_and_submit(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
@@ -196,21 +278,26 @@ int snd_dmaengine_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		if (ret)
 			return ret;
 		dma_async_issue_pending(prtd->dma_chan);
+		dmaengine_pcm_timer_start(substream);
 		break;
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		dmaengine_resume(prtd->dma_chan);
+		dmaengine_pcm_timer_start(substream);
 		break;
 	case SNDRV_PCM_TRIGGER_SUSPEND:
+		dmaengine_pcm_timer_stop(substream);
 		if (runtime->info & SNDRV_PCM_INFO_PAUSE)
 			dmaengine_pause(prtd->dma_chan);
 		else
 			dmaengine_terminate_async(prtd->dma_chan);
 		break;
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		dmaengine_pcm_timer_stop(substream);
 		dmaengine_pause(prtd->dma_chan);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
+		dmaengine_pcm_timer_stop(substream);
 		dmaengine_terminate_async(prtd->dma_chan);
 		break;
 	default:
@@ -306,6 +393,7 @@ int snd_dmaengine_pcm_open(struct snd_pcm_substream *substream,
 	struct dma_chan *chan)
 {
 	struct dmaengine_pcm_runtime_data *prtd;
+	struct dma_slave_caps dma_caps;
 	int ret;
 
 	if (!chan)
@@ -321,6 +409,20 @@ int snd_dmaengine_pcm_open(struct snd_pcm_substream *substream,
 		return -ENOMEM;
 
 	prtd->dma_chan = chan;
+	prtd->substream = substream;
+
+	/*
+	 * Sampling the position between periods only helps if the residue is
+	 * reported at burst granularity, and the timer callback runs in hard
+	 * interrupt context.
+	 */
+	if (timer_wakeup && !substream->pcm->nonatomic &&
+	    !dma_get_slave_caps(chan, &dma_caps) &&
+	    dma_caps.residue_granularity == DMA_RESIDUE_GRANULARITY_BURST) {
+		hrtimer_init(&prtd->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+		prtd->timer.function = dmaengine_pcm_timer;
+		prtd->use_timer = true;
+	}
 
 	substream->runtime->private_data = prtd;
 
@@ -359,6 +461,8 @@ int snd_dmaengine_pcm_close(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
 
+	if (prtd->use_timer)
+		hrtimer_cancel(&prtd->timer);
 	dmaengine_synchronize(prtd->dma_chan);
 	kfree(prtd);
 
@@ -379,6 +483,8 @@ int snd_dmaengine_pcm_close_release_chan(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
 
+	if (prtd->use_timer)
+		hrtimer_cancel(&prtd->timer);
 	dmaengine_synchronize(prtd->dma_chan);
 	dma_release_channel(prtd->dma_chan);
 	kfree(prtd);
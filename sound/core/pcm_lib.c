@@ -1851,6 +1851,50 @@ void snd_pcm_period_elapsed(struct snd_pcm_substream *substream)
 }
 EXPORT_SYMBOL(snd_pcm_period_elapsed);
 
+/**
+ * snd_pcm_sample_hw_ptr() - update the hardware pointer between periods
+ * @substream: the instance of PCM substream.
+ *
+ * For drivers which sample the DMA position from a timer rather than waiting
+ * for the next period interrupt.  The hardware pointer is updated and any
+ * sleeper whose avail_min has been reached is woken up, but nothing is
+ * accounted as an elapsed period.  It acquires the stream lock and can be
+ * called from atomic context, so it must not be used on nonatomic PCMs.
+ *
+ * Return: the number of frames available to the application, or a negative
+ * error code if the stream is not running.
+ */
+snd_pcm_sframes_t snd_pcm_sample_hw_ptr(struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime;
+	snd_pcm_sframes_t avail;
+	unsigned long flags;
+
+	if (PCM_RUNTIME_CHECK(substream))
+		return -ENXIO;
+	runtime = substream->runtime;
+
+	snd_pcm_stream_lock_irqsave(substream, flags);
+	if (!snd_pcm_running(substream)) {
+		avail = -EBADFD;
+		goto unlock;
+	}
+
+	avail = snd_pcm_update_hw_ptr0(substream, 0);
+	if (avail < 0)
+		goto unlock;
+
+	if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		avail = snd_pcm_playback_avail(runtime);
+	else
+		avail = snd_pcm_capture_avail(runtime);
+ unlock:
+	snd_pcm_stream_unlock_irqrestore(substream, flags);
+
+	return avail;
+}
+EXPORT_SYMBOL(snd_pcm_sample_hw_ptr);
+
 /*
  * Wait until avail_min data becomes available
  * Returns a negative error code if any error occurs during operation.
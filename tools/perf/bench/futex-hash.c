@@ -50,8 +50,11 @@ struct worker {
 static struct bench_futex_parameters params = {
 	.nfutexes = 1024,
 	.runtime  = 10,
+	.private_hash = -1,
 };
 
+#define PRIVATE_HASH_SYSCTL "/proc/sys/kernel/futex_private_hash_threads"
+
 static const struct option options[] = {
 	OPT_UINTEGER('t', "threads", &params.nthreads, "Specify amount of threads"),
 	OPT_UINTEGER('r', "runtime", &params.runtime, "Specify runtime (in seconds)"),
@@ -59,6 +62,8 @@ static const struct option options[] = {
 	OPT_BOOLEAN( 's', "silent",  &params.silent, "Silent mode: do not display data/details"),
 	OPT_BOOLEAN( 'S', "shared",  &params.fshared, "Use shared futexes instead of private ones"),
 	OPT_BOOLEAN( 'm', "mlockall", &params.mlockall, "Lock all current and future memory"),
+	OPT_INTEGER( 'p', "private-hash", &params.private_hash,
+		     "Thread count at which processes get a private futex hash (0 disables it)"),
 	OPT_END()
 };
 
@@ -110,6 +115,19 @@ static void toggle_done(int sig __maybe_unused,
 	timersub(&bench__end, &bench__start, &bench__runtime);
 }
 
+static int private_hash_access(int *threads, bool set)
+{
+	FILE *fp = fopen(PRIVATE_HASH_SYSCTL, set ? "w" : "r");
+	int ret;
+
+	if (!fp)
+		return -1;
+	ret = set ? fprintf(fp, "%d\n", *threads) : fscanf(fp, "%d", threads);
+	if (fclose(fp) || ret <= 0)
+		return -1;
+	return 0;
+}
+
 static void print_summary(void)
 {
 	unsigned long avg = avg_stats(&throughput_stats);
@@ -131,6 +149,7 @@ int bench_futex_hash(int argc, const char **argv)
 	struct perf_cpu_map *cpu;
 	int nrcpus;
 	size_t size;
+	int saved_private_hash = -1;
 
 	argc = parse_options(argc, argv, options, bench_futex_hash_usage, 0);
 	if (argc) {
@@ -162,8 +181,16 @@ int bench_futex_hash(int argc, const char **argv)
 	if (!params.fshared)
 		futex_flag = FUTEX_PRIVATE_FLAG;
 
+	if (params.private_hash >= 0) {
+		if (private_hash_access(&saved_private_hash, false) ||
+		    private_hash_access(&params.private_hash, true))
+			err(EXIT_FAILURE, "%s", PRIVATE_HASH_SYSCTL);
+	}
+
 	printf("Run summary [PID %d]: %d threads, each operating on %d [%s] futexes for %d secs.\n\n",
 	       getpid(), params.nthreads, params.nfutexes, params.fshared ? "shared":"private", params.runtime);
+	if (params.private_hash > 0)
+		printf("Private futex hash from %d threads on.\n\n", params.private_hash);
 
 	init_stats(&throughput_stats);
 	mutex_init(&thread_lock);
@@ -220,6 +247,10 @@ int bench_futex_hash(int argc, const char **argv)
 	}
 
 	/* cleanup & report results */
+	if (saved_private_hash >= 0 &&
+	    private_hash_access(&saved_private_hash, true))
+		warn("%s", PRIVATE_HASH_SYSCTL);
+
 	cond_destroy(&thread_parent);
 	cond_destroy(&thread_worker);
 	mutex_destroy(&thread_lock);
@@ -0,0 +1,385 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * io-uring.c
+ *
+ * io: Benchmark for block I/O latency through io_uring
+ *
+ * Drives random O_DIRECT reads (or writes) against a block device, meant to
+ * be a null_blk or zram instance so that the numbers reflect the block layer
+ * and io_uring rather than a medium, keeping a fixed number of requests in
+ * flight.  Optionally sweeps the queue depth in powers of two, completes by
+ * polling instead of interrupts and uses registered buffers and files.
+ *
+ * Completion latencies are collected in a log2 histogram and reported as
+ * percentiles.  Offsets come from a seeded generator, so runs with the same
+ * options issue the same sequence of requests.
+ */
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/stat.h"
+#include <subcmd/parse-options.h>
+#include "../builtin.h"
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include <linux/kernel.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+static const char	*filename = "/dev/nullb0";
+static unsigned int	qd = 32;
+static unsigned int	bs = 4096;
+static unsigned int	nr_ios = 1000000;
+static unsigned int	seed = 1;
+static bool		sweep;
+static bool		iopoll;
+static bool		fixed_bufs;
+static bool		fixed_files;
+static bool		do_write;
+static bool		histogram;
+
+static const struct option options[] = {
+	OPT_STRING('f', "file", &filename, "path", "Block device to drive"),
+	OPT_UINTEGER('q', "qd", &qd, "Queue depth, or the maximum with --sweep"),
+	OPT_UINTEGER('b', "bs", &bs, "Block size in bytes"),
+	OPT_UINTEGER('n', "nr-ios", &nr_ios, "Number of I/Os per queue depth"),
+	OPT_UINTEGER('s', "seed", &seed, "Seed for the offset sequence"),
+	OPT_BOOLEAN('S', "sweep", &sweep, "Run queue depths 1, 2, 4, ... up to --qd"),
+	OPT_BOOLEAN('p', "poll", &iopoll, "Complete by polling (IORING_SETUP_IOPOLL)"),
+	OPT_BOOLEAN('B', "fixed-bufs", &fixed_bufs, "Use registered buffers"),
+	OPT_BOOLEAN('F', "fixed-files", &fixed_files, "Use a registered file"),
+	OPT_BOOLEAN('w', "write", &do_write, "Write instead of read"),
+	OPT_BOOLEAN('H', "histogram", &histogram, "Print the full latency histogram"),
+	OPT_END()
+};
+
+static const char * const bench_io_uring_usage[] = {
+	"perf bench io uring <options>",
+	NULL
+};
+
+/* Bucket n counts latencies in [2^n, 2^(n+1)) ns */
+#define LAT_BUCKETS	40
+
+struct io_ring {
+	int			fd;
+	unsigned int		*sq_head;
+	unsigned int		*sq_tail;
+	unsigned int		*sq_mask;
+	unsigned int		*sq_array;
+	unsigned int		*cq_head;
+	unsigned int		*cq_tail;
+	unsigned int		*cq_mask;
+	struct io_uring_sqe	*sqes;
+	struct io_uring_cqe	*cqes;
+	void			*sq_ptr, *cq_ptr;
+	size_t			sq_len, cq_len, sqes_len;
+};
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static u64 next_offset(u64 *state, u64 nr_blocks)
+{
+	/* xorshift64, good enough to scatter requests reproducibly */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return (*state % nr_blocks) * bs;
+}
+
+static int ring_setup(struct io_ring *ring, unsigned int entries)
+{
+	struct io_uring_params p;
+
+	memset(&p, 0, sizeof(p));
+	if (iopoll)
+		p.flags |= IORING_SETUP_IOPOLL;
+
+	ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ring->fd < 0)
+		return -errno;
+
+	ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ptr == MAP_FAILED)
+		return -errno;
+
+	ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+	if (ring->cq_ptr == MAP_FAILED)
+		return -errno;
+
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+			  MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED)
+		return -errno;
+
+	ring->sq_head = ring->sq_ptr + p.sq_off.head;
+	ring->sq_tail = ring->sq_ptr + p.sq_off.tail;
+	ring->sq_mask = ring->sq_ptr + p.sq_off.ring_mask;
+	ring->sq_array = ring->sq_ptr + p.sq_off.array;
+	ring->cq_head = ring->cq_ptr + p.cq_off.head;
+	ring->cq_tail = ring->cq_ptr + p.cq_off.tail;
+	ring->cq_mask = ring->cq_ptr + p.cq_off.ring_mask;
+	ring->cqes = ring->cq_ptr + p.cq_off.cqes;
+
+	return 0;
+}
+
+static void ring_exit(struct io_ring *ring)
+{
+	munmap(ring->sqes, ring->sqes_len);
+	munmap(ring->cq_ptr, ring->cq_len);
+	munmap(ring->sq_ptr, ring->sq_len);
+	close(ring->fd);
+}
+
+static void queue_io(struct io_ring *ring, int fd, void *buf, unsigned int idx,
+		     u64 offset)
+{
+	unsigned int tail = *ring->sq_tail;
+	unsigned int slot = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+	memset(sqe, 0, sizeof(*sqe));
+	if (fixed_bufs) {
+		sqe->opcode = do_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->buf_index = idx;
+	} else {
+		sqe->opcode = do_write ? IORING_OP_WRITE : IORING_OP_READ;
+	}
+	if (fixed_files) {
+		sqe->fd = 0;
+		sqe->flags = IOSQE_FIXED_FILE;
+	} else {
+		sqe->fd = fd;
+	}
+	sqe->addr = (unsigned long)buf;
+	sqe->len = bs;
+	sqe->off = offset;
+	sqe->user_data = idx;
+
+	ring->sq_array[slot] = slot;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void print_histogram(u64 *lat, u64 count)
+{
+	u64 seen = 0;
+	int i;
+
+	printf(" %14s %14s %8s\n", "from [nsec]", "count", "cumul");
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		if (!lat[i])
+			continue;
+		seen += lat[i];
+		printf(" %14llu %14" PRIu64 " %7.3f%%\n", 1ULL << i, lat[i],
+		       100.0 * seen / count);
+	}
+}
+
+static u64 percentile(u64 *lat, u64 count, double pct)
+{
+	u64 target = count * pct / 100.0, seen = 0;
+	int i;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		seen += lat[i];
+		if (seen > target)
+			break;
+	}
+
+	/* Upper edge of the bucket, the latency was at most that */
+	return i < LAT_BUCKETS ? 2ULL << i : 0;
+}
+
+static int run_qd(int fd, u64 nr_blocks, unsigned int depth, char *bufs)
+{
+	struct io_ring ring;
+	struct stats lat_stats;
+	u64 lat[LAT_BUCKETS] = { 0 };
+	u64 *start;
+	u64 state = seed, issued = 0, done = 0, t0, elapsed;
+	unsigned int i, inflight = 0;
+	int ret;
+
+	ret = ring_setup(&ring, depth);
+	if (ret < 0) {
+		fprintf(stderr, "io_uring setup failed: %s\n", strerror(-ret));
+		return ret;
+	}
+
+	if (fixed_bufs) {
+		struct iovec *iov = calloc(depth, sizeof(*iov));
+
+		if (!iov)
+			err(EXIT_FAILURE, "calloc");
+		for (i = 0; i < depth; i++) {
+			iov[i].iov_base = bufs + (size_t)i * bs;
+			iov[i].iov_len = bs;
+		}
+		ret = syscall(__NR_io_uring_register, ring.fd,
+			      IORING_REGISTER_BUFFERS, iov, depth);
+		free(iov);
+		if (ret < 0)
+			err(EXIT_FAILURE, "IORING_REGISTER_BUFFERS");
+	}
+
+	if (fixed_files) {
+		ret = syscall(__NR_io_uring_register, ring.fd,
+			      IORING_REGISTER_FILES, &fd, 1);
+		if (ret < 0)
+			err(EXIT_FAILURE, "IORING_REGISTER_FILES");
+	}
+
+	start = calloc(depth, sizeof(*start));
+	if (!start)
+		err(EXIT_FAILURE, "calloc");
+
+	init_stats(&lat_stats);
+	t0 = now_ns();
+
+	while (done < nr_ios) {
+		unsigned int to_submit = 0, head, tail;
+
+		/* Keep the queue full */
+		for (i = 0; i < depth && inflight < depth && issued < nr_ios; i++) {
+			if (start[i])
+				continue;
+			start[i] = now_ns();
+			queue_io(&ring, fd, bufs + (size_t)i * bs, i,
+				 next_offset(&state, nr_blocks));
+			inflight++;
+			issued++;
+			to_submit++;
+		}
+
+		ret = syscall(__NR_io_uring_enter, ring.fd, to_submit, 1,
+			      IORING_ENTER_GETEVENTS, NULL, 0);
+		if (ret < 0 && errno != EINTR && errno != EAGAIN)
+			err(EXIT_FAILURE, "io_uring_enter");
+
+		head = *ring.cq_head;
+		tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; head++) {
+			struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+			unsigned int idx = cqe->user_data;
+			u64 ns = now_ns() - start[idx];
+
+			if (cqe->res != (int)bs) {
+				fprintf(stderr, "I/O failed: %s\n",
+					cqe->res < 0 ? strerror(-cqe->res) : "short");
+				exit(EXIT_FAILURE);
+			}
+
+			lat[ns ? min(63 - __builtin_clzll(ns), LAT_BUCKETS - 1) : 0]++;
+			update_stats(&lat_stats, ns);
+			start[idx] = 0;
+			inflight--;
+			done++;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	elapsed = now_ns() - t0;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# QD %u: %'" PRIu64 " %s of %u bytes\n", depth, done,
+		       do_write ? "writes" : "reads", bs);
+		printf(" %14.0f IOPS\n", done * 1e9 / elapsed);
+		printf(" %14.0f nsecs avg (+- %.2f%%)\n", avg_stats(&lat_stats),
+		       rel_stddev_stats(stddev_stats(&lat_stats),
+					avg_stats(&lat_stats)));
+		printf(" %14llu nsecs p50\n", (unsigned long long)percentile(lat, done, 50));
+		printf(" %14llu nsecs p90\n", (unsigned long long)percentile(lat, done, 90));
+		printf(" %14llu nsecs p99\n", (unsigned long long)percentile(lat, done, 99));
+		printf(" %14llu nsecs p99.9\n", (unsigned long long)percentile(lat, done, 99.9));
+		if (histogram)
+			print_histogram(lat, done);
+		printf("\n");
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%u %.0f %.0f %llu %llu\n", depth, done * 1e9 / elapsed,
+		       avg_stats(&lat_stats),
+		       (unsigned long long)percentile(lat, done, 50),
+		       (unsigned long long)percentile(lat, done, 99));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	free(start);
+	ring_exit(&ring);
+	return 0;
+}
+
+int bench_io_uring(int argc, const char **argv)
+{
+	unsigned int depth;
+	u64 size;
+	char *bufs;
+	int fd, ret = 0;
+
+	argc = parse_options(argc, argv, options, bench_io_uring_usage, 0);
+	if (argc)
+		usage_with_options(bench_io_uring_usage, options);
+
+	if (!qd || !bs || bs % 512)
+		errx(EXIT_FAILURE, "queue depth must be non-zero, block size a multiple of 512");
+
+	fd = open(filename, (do_write ? O_RDWR : O_RDONLY) | O_DIRECT);
+	if (fd < 0)
+		err(EXIT_FAILURE, "open %s", filename);
+
+	if (ioctl(fd, BLKGETSIZE64, &size) < 0)
+		err(EXIT_FAILURE, "BLKGETSIZE64");
+	if (size < bs)
+		errx(EXIT_FAILURE, "%s is smaller than one block", filename);
+
+	if (posix_memalign((void **)&bufs, 4096, (size_t)qd * bs))
+		errx(EXIT_FAILURE, "posix_memalign");
+	memset(bufs, 0xa5, (size_t)qd * bs);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %s, %s completions%s%s\n\n", filename,
+		       iopoll ? "polled" : "irq",
+		       fixed_bufs ? ", fixed buffers" : "",
+		       fixed_files ? ", registered file" : "");
+
+	for (depth = sweep ? 1 : qd; depth <= qd; depth *= 2) {
+		ret = run_qd(fd, size / bs, depth, bufs);
+		if (ret)
+			break;
+	}
+
+	free(bufs);
+	close(fd);
+	return ret;
+}
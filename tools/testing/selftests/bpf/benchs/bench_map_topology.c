@@ -0,0 +1,701 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Ringbuf, perf buffer, per-CPU hash and LRU hash benchmarks with the
+ * producers placed relative to the consumer by CPU topology: on SMT
+ * siblings of the consumer's core, on other cores sharing its last level
+ * cache, or on a different NUMA node.
+ */
+#include <argp.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "bpf_util.h"
+#include "testing_helpers.h"
+#include "map_topology_bench.skel.h"
+
+#define MAX_BATCH	1024
+#define MAX_CPUS	1024
+
+/* keep in sync with progs/map_topology_bench.c */
+struct topo_sample {
+	__u64 ts;
+	__u64 cpu;
+};
+
+enum {
+	TOPO_PROD_OPS,
+	TOPO_CONS_OPS,
+	TOPO_DROPS,
+	TOPO_NR_COUNTERS,
+};
+
+enum topo_placement {
+	TOPO_ANY,
+	TOPO_SAME_CORE,
+	TOPO_SAME_LLC,
+	TOPO_CROSS_NODE,
+};
+
+static const char * const topo_placement_names[] = {
+	[TOPO_ANY] = "any",
+	[TOPO_SAME_CORE] = "same-core",
+	[TOPO_SAME_LLC] = "same-llc",
+	[TOPO_CROSS_NODE] = "cross-node",
+};
+
+static struct {
+	enum topo_placement placement;
+	int cpu;
+	int batch_cnt;
+	int nr_keys;
+	int map_entries;
+	int ringbuf_sz; /* in bytes */
+	int perfbuf_sz; /* per-CPU size, in pages */
+} args = {
+	.placement = TOPO_ANY,
+	.cpu = 0,
+	.batch_cnt = 100,
+	.nr_keys = 1024,
+	.map_entries = 1024,
+	.ringbuf_sz = 4 * 1024 * 1024,
+	.perfbuf_sz = 128,
+};
+
+enum {
+	ARG_TOPO_PLACEMENT = 8000,
+	ARG_TOPO_CPU = 8001,
+	ARG_TOPO_BATCH_CNT = 8002,
+	ARG_TOPO_NR_KEYS = 8003,
+	ARG_TOPO_MAP_ENTRIES = 8004,
+	ARG_TOPO_RINGBUF_SZ = 8005,
+	ARG_TOPO_PERFBUF_SZ = 8006,
+};
+
+static const struct argp_option opts[] = {
+	{ "topo-placement", ARG_TOPO_PLACEMENT, "PLACEMENT", 0,
+	  "Producer placement relative to the consumer: any, same-core, same-llc or cross-node"},
+	{ "topo-cpu", ARG_TOPO_CPU, "CPU", 0, "CPU to run the consumer on"},
+	{ "topo-batch-cnt", ARG_TOPO_BATCH_CNT, "CNT", 0, "Records or map operations per BPF program run"},
+	{ "topo-nr-keys", ARG_TOPO_NR_KEYS, "KEYS", 0, "Number of distinct hash keys used"},
+	{ "topo-map-entries", ARG_TOPO_MAP_ENTRIES, "ENTRIES", 0, "Hash map max_entries"},
+	{ "topo-ringbuf-sz", ARG_TOPO_RINGBUF_SZ, "BYTES", 0, "Ring buffer size"},
+	{ "topo-perfbuf-sz", ARG_TOPO_PERFBUF_SZ, "PAGES", 0, "Per-CPU perf buffer size"},
+	{},
+};
+
+static int topo_parse_num(const char *arg, int min, int max, struct argp_state *state)
+{
+	long val = strtol(arg, NULL, 10);
+
+	if (val < min || val > max) {
+		fprintf(stderr, "Invalid value %s, must be within [%d, %d]\n",
+			arg, min, max);
+		argp_usage(state);
+	}
+	return val;
+}
+
+static error_t parse_arg(int key, char *arg, struct argp_state *state)
+{
+	int i;
+
+	switch (key) {
+	case ARG_TOPO_PLACEMENT:
+		for (i = 0; i < ARRAY_SIZE(topo_placement_names); i++) {
+			if (!strcmp(arg, topo_placement_names[i]))
+				break;
+		}
+		if (i == ARRAY_SIZE(topo_placement_names)) {
+			fprintf(stderr, "Invalid placement %s\n", arg);
+			argp_usage(state);
+		}
+		args.placement = i;
+		break;
+	case ARG_TOPO_CPU:
+		args.cpu = topo_parse_num(arg, 0, MAX_CPUS - 1, state);
+		break;
+	case ARG_TOPO_BATCH_CNT:
+		args.batch_cnt = topo_parse_num(arg, 1, MAX_BATCH, state);
+		break;
+	case ARG_TOPO_NR_KEYS:
+		args.nr_keys = topo_parse_num(arg, 1, INT_MAX, state);
+		break;
+	case ARG_TOPO_MAP_ENTRIES:
+		args.map_entries = topo_parse_num(arg, 1, INT_MAX, state);
+		break;
+	case ARG_TOPO_RINGBUF_SZ:
+		args.ringbuf_sz = topo_parse_num(arg, 4096, INT_MAX, state);
+		break;
+	case ARG_TOPO_PERFBUF_SZ:
+		args.perfbuf_sz = topo_parse_num(arg, 1, INT_MAX, state);
+		break;
+	default:
+		return ARGP_ERR_UNKNOWN;
+	}
+	return 0;
+}
+
+/* exported into benchmark runner */
+const struct argp bench_map_topology_argp = {
+	.options = opts,
+	.parser = parse_arg,
+};
+
+/* CPU topology, from sysfs */
+
+static int topo_read_cpulist(const char *path, bool **set, int *set_len)
+{
+	char buf[4096];
+	FILE *f;
+	int err;
+
+	f = fopen(path, "r");
+	if (!f)
+		return -errno;
+	err = fgets(buf, sizeof(buf), f) ? 0 : -EINVAL;
+	fclose(f);
+	if (err)
+		return err;
+
+	buf[strcspn(buf, "\n")] = '\0';
+	return parse_num_list(buf, set, set_len);
+}
+
+static int topo_read_core_cpus(int cpu, bool **set, int *set_len)
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+	return topo_read_cpulist(path, set, set_len);
+}
+
+static int topo_read_llc_cpus(int cpu, bool **set, int *set_len)
+{
+	int i, level, llc = -1, llc_level = -1;
+	char path[PATH_MAX];
+	FILE *f;
+
+	/* the last level cache is the highest level one listed */
+	for (i = 0; ; i++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, i);
+		f = fopen(path, "r");
+		if (!f)
+			break;
+		if (fscanf(f, "%d", &level) == 1 && level > llc_level) {
+			llc_level = level;
+			llc = i;
+		}
+		fclose(f);
+	}
+	if (llc < 0)
+		return -ENOENT;
+
+	snprintf(path, sizeof(path),
+		 "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+		 cpu, llc);
+	return topo_read_cpulist(path, set, set_len);
+}
+
+static int topo_read_node_cpus(int cpu, bool **set, int *set_len)
+{
+	char path[PATH_MAX];
+	int node, err;
+
+	for (node = 0; ; node++) {
+		snprintf(path, sizeof(path),
+			 "/sys/devices/system/node/node%d/cpulist", node);
+		err = topo_read_cpulist(path, set, set_len);
+		if (err)
+			return err;
+		if (cpu < *set_len && (*set)[cpu])
+			return 0;
+		free(*set);
+		*set = NULL;
+	}
+}
+
+/*
+ * Pin the consumer to --topo-cpu and hand the runner the set of CPUs in
+ * the requested relation to it for the producers.
+ */
+static void topo_apply_placement(void)
+{
+	bool *online = NULL, *near = NULL, *excl = NULL, *prod, *cons;
+	int online_len, near_len = 0, excl_len = 0, nr_prod = 0, i, err;
+
+	if (args.placement == TOPO_ANY)
+		return;
+
+	if (env.prod_cpus.cpus || env.cons_cpus.cpus) {
+		fprintf(stderr, "--topo-placement can't be combined with --prod-affinity or --cons-affinity\n");
+		exit(1);
+	}
+
+	err = topo_read_cpulist("/sys/devices/system/cpu/online", &online, &online_len);
+	if (err || args.cpu >= online_len || !online[args.cpu]) {
+		fprintf(stderr, "CPU %d is not online\n", args.cpu);
+		exit(1);
+	}
+
+	switch (args.placement) {
+	case TOPO_SAME_CORE:
+		err = topo_read_core_cpus(args.cpu, &near, &near_len);
+		break;
+	case TOPO_SAME_LLC:
+		err = topo_read_llc_cpus(args.cpu, &near, &near_len);
+		if (!err)
+			err = topo_read_core_cpus(args.cpu, &excl, &excl_len);
+		break;
+	case TOPO_CROSS_NODE:
+		err = topo_read_node_cpus(args.cpu, &excl, &excl_len);
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+	if (err) {
+		fprintf(stderr, "failed to read %s topology of CPU %d: %d\n",
+			topo_placement_names[args.placement], args.cpu, err);
+		exit(1);
+	}
+
+	prod = calloc(online_len, sizeof(*prod));
+	cons = calloc(args.cpu + 1, sizeof(*cons));
+	if (!prod || !cons) {
+		fprintf(stderr, "failed to allocate CPU sets\n");
+		exit(1);
+	}
+
+	for (i = 0; i < online_len; i++) {
+		prod[i] = online[i] && i != args.cpu &&
+			  (!near || (i < near_len && near[i])) &&
+			  !(excl && i < excl_len && excl[i]);
+		nr_prod += prod[i];
+	}
+
+	if (nr_prod < env.producer_cnt) {
+		fprintf(stderr, "only %d CPUs are %s to CPU %d, %d producers requested\n",
+			nr_prod, topo_placement_names[args.placement], args.cpu,
+			env.producer_cnt);
+		exit(1);
+	}
+
+	cons[args.cpu] = true;
+	env.cons_cpus.cpus = cons;
+	env.cons_cpus.cpus_len = args.cpu + 1;
+	env.prod_cpus.cpus = prod;
+	env.prod_cpus.cpus_len = online_len;
+	env.affinity = true;
+
+	if (env.verbose) {
+		printf("Consumer on CPU %d, producers on CPUs", args.cpu);
+		for (i = 0; i < online_len; i++) {
+			if (prod[i])
+				printf(" %d", i);
+		}
+		printf("\n");
+	}
+
+	free(online);
+	free(near);
+	free(excl);
+}
+
+/* Delivery latency histogram: log2 buckets, each split in four */
+
+#define LAT_SUB_BITS	2
+#define LAT_BUCKETS	(64 << LAT_SUB_BITS)
+
+static int lat_bucket(__u64 ns)
+{
+	int msb;
+
+	if (ns < (1 << LAT_SUB_BITS))
+		return ns;
+
+	msb = 63 - __builtin_clzll(ns);
+	return (msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS |
+	       ((ns >> (msb - LAT_SUB_BITS)) & ((1 << LAT_SUB_BITS) - 1));
+}
+
+static __u64 lat_bucket_start(int b)
+{
+	int msb;
+
+	if (b < (1 << LAT_SUB_BITS))
+		return b;
+
+	msb = (b >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+	return (__u64)((1 << LAT_SUB_BITS) | (b & ((1 << LAT_SUB_BITS) - 1)))
+	       << (msb - LAT_SUB_BITS);
+}
+
+static struct topo_ctx {
+	struct map_topology_bench *skel;
+	struct ring_buffer *ringbuf;
+	struct perf_buffer *perfbuf;
+	bool is_buf;
+	int nr_cpus;
+	__u64 *percpu_vals;
+	__u64 last[TOPO_NR_COUNTERS];
+	int iters;
+	/* only touched by the single consumer thread */
+	__u64 lat_hist[LAT_BUCKETS];
+	/* snapshot at the end of warmup */
+	__u64 lat_warmup[LAT_BUCKETS];
+} ctx;
+
+static struct counter buf_hits;
+static struct counter buf_lost;
+
+static void topo_validate(void)
+{
+	if (env.consumer_cnt != 1) {
+		fprintf(stderr, "benchmark doesn't support multi-consumer!\n");
+		exit(1);
+	}
+
+	topo_apply_placement();
+}
+
+static __u64 topo_counter(__u32 idx)
+{
+	__u64 sum = 0;
+	int i;
+
+	if (bpf_map_lookup_elem(bpf_map__fd(ctx.skel->maps.counters), &idx,
+				ctx.percpu_vals))
+		return ctx.last[idx];
+
+	for (i = 0; i < ctx.nr_cpus; i++)
+		sum += ctx.percpu_vals[i];
+	return sum;
+}
+
+static long topo_counter_delta(__u32 idx)
+{
+	__u64 cur = topo_counter(idx);
+	long delta = cur - ctx.last[idx];
+
+	ctx.last[idx] = cur;
+	return delta;
+}
+
+static void topo_measure(struct bench_res *res)
+{
+	if (ctx.is_buf) {
+		res->hits = atomic_swap(&buf_hits.value, 0);
+		res->drops = atomic_swap(&buf_lost.value, 0) +
+			     topo_counter_delta(TOPO_DROPS);
+	} else {
+		res->hits = topo_counter_delta(TOPO_PROD_OPS) +
+			    topo_counter_delta(TOPO_CONS_OPS);
+		res->drops = topo_counter_delta(TOPO_DROPS);
+	}
+
+	if (++ctx.iters == env.warmup_sec)
+		memcpy(ctx.lat_warmup, ctx.lat_hist, sizeof(ctx.lat_warmup));
+}
+
+static void topo_record(const struct topo_sample *s)
+{
+	__u64 now = get_time_ns();
+
+	ctx.lat_hist[lat_bucket(now > s->ts ? now - s->ts : 0)]++;
+	atomic_inc(&buf_hits.value);
+}
+
+static int topo_cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void topo_report_final(struct bench_res res[], int res_cnt)
+{
+	static const double pcts[] = { 50, 90, 99, 99.9 };
+	__u64 total = 0, seen = 0, hist[LAT_BUCKETS];
+	double *tput;
+	int i, b;
+
+	hits_drops_report_final(res, res_cnt);
+
+	if (res_cnt <= 0)
+		return;
+
+	tput = calloc(res_cnt, sizeof(*tput));
+	if (!tput)
+		return;
+	for (i = 0; i < res_cnt; i++)
+		tput[i] = res[i].hits / 1000000.0;
+	qsort(tput, res_cnt, sizeof(*tput), topo_cmp_double);
+
+	/* per-second throughput, low percentiles are the interesting ones */
+	printf("Throughput: min %.3lfM/s, p10 %.3lfM/s, p50 %.3lfM/s, p90 %.3lfM/s, max %.3lfM/s\n",
+	       tput[0], tput[(res_cnt - 1) / 10], tput[(res_cnt - 1) / 2],
+	       tput[(res_cnt - 1) * 9 / 10], tput[res_cnt - 1]);
+	free(tput);
+
+	if (!ctx.is_buf)
+		return;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		hist[b] = ctx.lat_hist[b] - ctx.lat_warmup[b];
+		total += hist[b];
+	}
+	if (!total)
+		return;
+
+	/* report the upper edge of the bucket each percentile falls into */
+	printf("Latency:");
+	for (i = 0, b = 0; i < ARRAY_SIZE(pcts); i++) {
+		__u64 target = total * pcts[i] / 100;
+
+		for (; b < LAT_BUCKETS - 1 && seen + hist[b] <= target; b++)
+			seen += hist[b];
+		printf("%s p%g <%lluns", i ? "," : "", pcts[i],
+		       (unsigned long long)lat_bucket_start(b + 1));
+	}
+	printf(" (%llu samples)\n", (unsigned long long)total);
+}
+
+static void *topo_producer(void *input)
+{
+	while (true)
+		(void)syscall(__NR_getpgid);
+	return NULL;
+}
+
+enum topo_kind {
+	TOPO_RINGBUF,
+	TOPO_PERFBUF,
+	TOPO_PERCPU_HASH,
+	TOPO_LRU_HASH,
+};
+
+static void topo_populate(struct bpf_map *map)
+{
+	int fd = bpf_map__fd(map);
+	__u32 key;
+
+	/* start from a map holding every key which fits */
+	memset(ctx.percpu_vals, 0, ctx.nr_cpus * sizeof(*ctx.percpu_vals));
+	for (key = 0; key < args.nr_keys && key < args.map_entries; key++)
+		bpf_map_update_elem(fd, &key, ctx.percpu_vals, BPF_ANY);
+}
+
+static void topo_setup(enum topo_kind kind)
+{
+	struct bpf_program *prog, *progs[2];
+	struct map_topology_bench *skel;
+	int i, cpu, nr_progs = 0, nr_lookup = 0;
+
+	setup_libbpf();
+
+	ctx.nr_cpus = bpf_num_possible_cpus();
+	ctx.percpu_vals = calloc(ctx.nr_cpus, sizeof(*ctx.percpu_vals));
+	if (!ctx.percpu_vals) {
+		fprintf(stderr, "failed to allocate per-CPU values\n");
+		exit(1);
+	}
+
+	skel = map_topology_bench__open();
+	if (!skel) {
+		fprintf(stderr, "failed to open skeleton\n");
+		exit(1);
+	}
+	ctx.skel = skel;
+
+	skel->rodata->tgid = getpid();
+	skel->rodata->batch_cnt = args.batch_cnt;
+	skel->rodata->nr_keys = args.nr_keys;
+
+	/* per-CPU hash lookups read the copies of the producing CPUs */
+	for (cpu = 0; cpu < ctx.nr_cpus && nr_lookup < MAX_CPUS; cpu++) {
+		if (env.prod_cpus.cpus) {
+			if (cpu >= env.prod_cpus.cpus_len ||
+			    nr_lookup == env.producer_cnt)
+				break;
+			if (!env.prod_cpus.cpus[cpu])
+				continue;
+		}
+		skel->rodata->lookup_cpus[nr_lookup++] = cpu;
+	}
+	skel->rodata->nr_lookup_cpus = nr_lookup ?: 1;
+
+	bpf_map__set_max_entries(skel->maps.ringbuf, args.ringbuf_sz);
+	bpf_map__set_max_entries(skel->maps.percpu_hash, args.map_entries);
+	bpf_map__set_max_entries(skel->maps.lru_hash, args.map_entries);
+
+	switch (kind) {
+	case TOPO_RINGBUF:
+		progs[nr_progs++] = skel->progs.topo_ringbuf_produce;
+		break;
+	case TOPO_PERFBUF:
+		progs[nr_progs++] = skel->progs.topo_perfbuf_produce;
+		break;
+	case TOPO_PERCPU_HASH:
+		progs[nr_progs++] = skel->progs.topo_percpu_update;
+		progs[nr_progs++] = skel->progs.topo_percpu_lookup;
+		break;
+	case TOPO_LRU_HASH:
+		progs[nr_progs++] = skel->progs.topo_lru_update;
+		progs[nr_progs++] = skel->progs.topo_lru_lookup;
+		break;
+	}
+
+	bpf_object__for_each_program(prog, skel->obj)
+		bpf_program__set_autoload(prog, false);
+	for (i = 0; i < nr_progs; i++)
+		bpf_program__set_autoload(progs[i], true);
+
+	if (map_topology_bench__load(skel)) {
+		fprintf(stderr, "failed to load skeleton\n");
+		exit(1);
+	}
+
+	if (kind == TOPO_PERCPU_HASH)
+		topo_populate(skel->maps.percpu_hash);
+	else if (kind == TOPO_LRU_HASH)
+		topo_populate(skel->maps.lru_hash);
+
+	for (i = 0; i < nr_progs; i++) {
+		if (!bpf_program__attach(progs[i])) {
+			fprintf(stderr, "failed to attach program!\n");
+			exit(1);
+		}
+	}
+}
+
+/* TOPO-RINGBUF benchmark */
+
+static int topo_ringbuf_sample(void *input, void *data, size_t len)
+{
+	topo_record(data);
+	return 0;
+}
+
+static void topo_ringbuf_setup(void)
+{
+	ctx.is_buf = true;
+	topo_setup(TOPO_RINGBUF);
+
+	ctx.ringbuf = ring_buffer__new(bpf_map__fd(ctx.skel->maps.ringbuf),
+				       topo_ringbuf_sample, NULL, NULL);
+	if (!ctx.ringbuf) {
+		fprintf(stderr, "failed to create ringbuf\n");
+		exit(1);
+	}
+}
+
+static void *topo_ringbuf_consumer(void *input)
+{
+	while (ring_buffer__poll(ctx.ringbuf, -1) >= 0)
+		;
+	fprintf(stderr, "ringbuf polling failed!\n");
+	return NULL;
+}
+
+/* TOPO-PERFBUF benchmark */
+
+static void topo_perfbuf_sample(void *input, int cpu, void *data, __u32 len)
+{
+	topo_record(data);
+}
+
+static void topo_perfbuf_lost(void *input, int cpu, __u64 cnt)
+{
+	atomic_add(&buf_lost.value, cnt);
+}
+
+static void topo_perfbuf_setup(void)
+{
+	ctx.is_buf = true;
+	topo_setup(TOPO_PERFBUF);
+
+	ctx.perfbuf = perf_buffer__new(bpf_map__fd(ctx.skel->maps.perfbuf),
+				       args.perfbuf_sz, topo_perfbuf_sample,
+				       topo_perfbuf_lost, NULL, NULL);
+	if (!ctx.perfbuf) {
+		fprintf(stderr, "failed to create perfbuf\n");
+		exit(1);
+	}
+}
+
+static void *topo_perfbuf_consumer(void *input)
+{
+	while (perf_buffer__poll(ctx.perfbuf, -1) >= 0)
+		;
+	fprintf(stderr, "perfbuf polling failed!\n");
+	return NULL;
+}
+
+/* TOPO-PERCPU-HASH and TOPO-LRU-HASH benchmarks */
+
+static void topo_percpu_hash_setup(void)
+{
+	topo_setup(TOPO_PERCPU_HASH);
+}
+
+static void topo_lru_hash_setup(void)
+{
+	topo_setup(TOPO_LRU_HASH);
+}
+
+/* the consumer looks up what the producers keep updating */
+static void *topo_hash_consumer(void *input)
+{
+	while (true)
+		(void)syscall(__NR_getppid);
+	return NULL;
+}
+
+const struct bench bench_topo_ringbuf = {
+	.name = "topo-ringbuf",
+	.validate = topo_validate,
+	.setup = topo_ringbuf_setup,
+	.producer_thread = topo_producer,
+	.consumer_thread = topo_ringbuf_consumer,
+	.measure = topo_measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = topo_report_final,
+};
+
+const struct bench bench_topo_perfbuf = {
+	.name = "topo-perfbuf",
+	.validate = topo_validate,
+	.setup = topo_perfbuf_setup,
+	.producer_thread = topo_producer,
+	.consumer_thread = topo_perfbuf_consumer,
+	.measure = topo_measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = topo_report_final,
+};
+
+const struct bench bench_topo_percpu_hash = {
+	.name = "topo-percpu-hash",
+	.validate = topo_validate,
+	.setup = topo_percpu_hash_setup,
+	.producer_thread = topo_producer,
+	.consumer_thread = topo_hash_consumer,
+	.measure = topo_measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = topo_report_final,
+};
+
+const struct bench bench_topo_lru_hash = {
+	.name = "topo-lru-hash",
+	.validate = topo_validate,
+	.setup = topo_lru_hash_setup,
+	.producer_thread = topo_producer,
+	.consumer_thread = topo_hash_consumer,
+	.measure = topo_measure,
+	.report_progress = hits_drops_report_progress,
+	.report_final = topo_report_final,
+};
@@ -0,0 +1,17 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+
+source ./benchs/run_common.sh
+
+set -eufo pipefail
+
+for b in topo-ringbuf topo-perfbuf topo-percpu-hash topo-lru-hash; do
+for placement in same-core same-llc cross-node; do
+for p in 1 2 4; do
+	subtitle "$b, $placement, producers: $p"
+	$RUN_BENCH -p $p --topo-placement $placement $b 2>&1 | \
+		grep -E '^(Summary|Throughput|Latency):' || echo "not supported"
+	printf "\n"
+done
+done
+done
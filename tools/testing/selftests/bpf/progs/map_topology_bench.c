@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/bpf.h>
+#include <stdbool.h>
+#include <bpf/bpf_helpers.h>
+
+char _license[] SEC("license") = "GPL";
+
+#define MAX_BATCH	1024
+#define MAX_CPUS	1024
+
+/* keep in sync with benchs/bench_map_topology.c */
+struct topo_sample {
+	__u64 ts;
+	__u64 cpu;
+};
+
+enum {
+	TOPO_PROD_OPS,
+	TOPO_CONS_OPS,
+	TOPO_DROPS,
+	TOPO_NR_COUNTERS,
+};
+
+struct {
+	__uint(type, BPF_MAP_TYPE_RINGBUF);
+} ringbuf SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERF_EVENT_ARRAY);
+	__uint(key_size, sizeof(int));
+	__uint(value_size, sizeof(int));
+} perfbuf SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+	__uint(max_entries, 1);
+	__type(key, __u32);
+	__type(value, __u64);
+} percpu_hash SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__uint(max_entries, 1);
+	__type(key, __u32);
+	__type(value, __u64);
+} lru_hash SEC(".maps");
+
+/* per-CPU so that counting doesn't add cross-CPU traffic of its own */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__uint(max_entries, TOPO_NR_COUNTERS);
+	__type(key, __u32);
+	__type(value, __u64);
+} counters SEC(".maps");
+
+const volatile int tgid = 0;
+const volatile __u32 batch_cnt = 0;
+const volatile __u32 nr_keys = 1;
+/* CPUs whose per-CPU hash copies the consumer reads */
+const volatile __u32 lookup_cpus[MAX_CPUS] = {};
+const volatile __u32 nr_lookup_cpus = 1;
+
+static __always_inline bool topo_ours(void)
+{
+	return (bpf_get_current_pid_tgid() >> 32) == tgid;
+}
+
+static __always_inline void topo_count(__u32 idx, __u64 n)
+{
+	__u64 *cnt = bpf_map_lookup_elem(&counters, &idx);
+
+	if (cnt)
+		*cnt += n;
+}
+
+SEC("tp/syscalls/sys_enter_getpgid")
+int topo_ringbuf_produce(void *ctx)
+{
+	struct topo_sample *s;
+	__u32 i;
+
+	if (!topo_ours())
+		return 0;
+
+	for (i = 0; i < MAX_BATCH && i < batch_cnt; i++) {
+		s = bpf_ringbuf_reserve(&ringbuf, sizeof(*s), 0);
+		if (!s) {
+			topo_count(TOPO_DROPS, 1);
+			continue;
+		}
+		s->ts = bpf_ktime_get_ns();
+		s->cpu = bpf_get_smp_processor_id();
+		bpf_ringbuf_submit(s, 0);
+	}
+	topo_count(TOPO_PROD_OPS, i);
+	return 0;
+}
+
+SEC("tp/syscalls/sys_enter_getpgid")
+int topo_perfbuf_produce(void *ctx)
+{
+	struct topo_sample s;
+	__u32 i;
+
+	if (!topo_ours())
+		return 0;
+
+	for (i = 0; i < MAX_BATCH && i < batch_cnt; i++) {
+		s.ts = bpf_ktime_get_ns();
+		s.cpu = bpf_get_smp_processor_id();
+		if (bpf_perf_event_output(ctx, &perfbuf, BPF_F_CURRENT_CPU,
+					  &s, sizeof(s)))
+			topo_count(TOPO_DROPS, 1);
+	}
+	topo_count(TOPO_PROD_OPS, i);
+	return 0;
+}
+
+static __always_inline void topo_update(void *map)
+{
+	__u32 i, key;
+	__u64 val;
+
+	if (!topo_ours())
+		return;
+
+	for (i = 0; i < MAX_BATCH && i < batch_cnt; i++) {
+		key = bpf_get_prandom_u32() % nr_keys;
+		val = i;
+		if (bpf_map_update_elem(map, &key, &val, BPF_ANY))
+			topo_count(TOPO_DROPS, 1);
+	}
+	topo_count(TOPO_PROD_OPS, i);
+}
+
+SEC("tp/syscalls/sys_enter_getpgid")
+int topo_percpu_update(void *ctx)
+{
+	topo_update(&percpu_hash);
+	return 0;
+}
+
+SEC("tp/syscalls/sys_enter_getpgid")
+int topo_lru_update(void *ctx)
+{
+	topo_update(&lru_hash);
+	return 0;
+}
+
+SEC("tp/syscalls/sys_enter_getppid")
+int topo_percpu_lookup(void *ctx)
+{
+	__u32 i, key, cpu;
+
+	if (!topo_ours())
+		return 0;
+
+	for (i = 0; i < MAX_BATCH && i < batch_cnt; i++) {
+		key = bpf_get_prandom_u32() % nr_keys;
+		/* read the copies the producers are writing to */
+		cpu = lookup_cpus[(i % nr_lookup_cpus) & (MAX_CPUS - 1)];
+		if (!bpf_map_lookup_percpu_elem(&percpu_hash, &key, cpu))
+			topo_count(TOPO_DROPS, 1);
+	}
+	topo_count(TOPO_CONS_OPS, i);
+	return 0;
+}
+
+SEC("tp/syscalls/sys_enter_getppid")
+int topo_lru_lookup(void *ctx)
+{
+	__u32 i, key;
+
+	if (!topo_ours())
+		return 0;
+
+	for (i = 0; i < MAX_BATCH && i < batch_cnt; i++) {
+		key = bpf_get_prandom_u32() % nr_keys;
+		if (!bpf_map_lookup_elem(&lru_hash, &key))
+			topo_count(TOPO_DROPS, 1);
+	}
+	topo_count(TOPO_CONS_OPS, i);
+	return 0;
+}
@@ -21,6 +21,12 @@ static char *directions[] = {
 	"FROM_DEVICE",
 };
 
+static char *modes[] = {
+	"SINGLE",
+	"PAGE",
+	"SG",
+};
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
@@ -31,11 +37,13 @@ int main(int argc, char **argv)
 	int bits = 32, xdelay = 0, dir = DMA_MAP_BIDIRECTIONAL;
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
+	/* default fixed granule, dma_map_single */
+	int granule_max = 0, mode = DMA_MAP_SINGLE_MODE;
 
-	int cmd = DMA_MAP_BENCHMARK;
+	int cmd = DMA_MAP_BENCHMARK_V2;
 	char *p;
 
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:G:m:")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -58,6 +66,12 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'G':
+			granule_max = atoi(optarg);
+			break;
+		case 'm':
+			mode = atoi(optarg);
+			break;
 		default:
 			return -1;
 		}
@@ -98,6 +112,17 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (granule_max && (granule_max < granule || granule_max > 1024)) {
+		fprintf(stderr, "invalid maximum granule size\n");
+		exit(1);
+	}
+
+	if (mode != DMA_MAP_SINGLE_MODE && mode != DMA_MAP_PAGE_MODE &&
+			mode != DMA_MAP_SG_MODE) {
+		fprintf(stderr, "invalid benchmark mode\n");
+		exit(1);
+	}
+
 	fd = open("/sys/kernel/debug/dma_map_benchmark", O_RDWR);
 	if (fd == -1) {
 		perror("open");
@@ -112,6 +137,8 @@ int main(int argc, char **argv)
 	map.dma_dir = dir;
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
+	map.granule_max = granule_max;
+	map.mode = mode;
 
 	if (ioctl(fd, cmd, &map)) {
 		perror("ioctl");
@@ -124,6 +151,13 @@ int main(int argc, char **argv)
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	printf("mode:%s granule_max:%d\n", modes[mode], granule_max);
+	printf("map latency(us) p50:%.1f p99:%.1f p99.9:%.1f\n",
+			map.map_p50_100ns/10.0, map.map_p99_100ns/10.0,
+			map.map_p999_100ns/10.0);
+	printf("unmap latency(us) p50:%.1f p99:%.1f p99.9:%.1f\n",
+			map.unmap_p50_100ns/10.0, map.unmap_p99_100ns/10.0,
+			map.unmap_p999_100ns/10.0);
 
 	return 0;
 }
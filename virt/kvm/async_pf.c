@@ -19,6 +19,16 @@
 
 static struct kmem_cache *async_pf_cache;
 
+/*
+ * Faults whose hva falls in the same 16-page block as a fault still waiting
+ * for its work item to run are coalesced into that work item: it faults all
+ * of their pages in under one mmap_lock and posts all their completions in
+ * one go, instead of a work item and a wakeup per fault.  Each fault keeps
+ * its own arch token, as the guest protocols take one per "page ready".
+ */
+#define ASYNC_PF_COALESCE_SHIFT	(PAGE_SHIFT + 4)
+#define ASYNC_PF_COALESCE_MAX	((1 << (ASYNC_PF_COALESCE_SHIFT - PAGE_SHIFT)) - 1)
+
 int kvm_async_pf_init(void)
 {
 	async_pf_cache = KMEM_CACHE(kvm_async_pf, 0);
@@ -50,11 +60,17 @@ static void async_pf_execute(struct work_struct *work)
 	struct kvm_vcpu *vcpu = apf->vcpu;
 	unsigned long addr = apf->addr;
 	gpa_t cr2_or_gpa = apf->cr2_or_gpa;
+	struct kvm_async_pf *c, *tmp;
 	int locked = 1;
 	bool first;
 
 	might_sleep();
 
+	/* No more faults get coalesced into this one from here on */
+	spin_lock(&vcpu->async_pf.lock);
+	apf->started = true;
+	spin_unlock(&vcpu->async_pf.lock);
+
 	/*
 	 * This work is run asynchronously to the task which owns
 	 * mm and might be done in another context, so we must
@@ -63,16 +79,35 @@ static void async_pf_execute(struct work_struct *work)
 	mmap_read_lock(mm);
 	get_user_pages_remote(mm, addr, 1, FOLL_WRITE, NULL, NULL,
 			&locked);
+	list_for_each_entry(c, &apf->coalesced, coalesced) {
+		if (!locked) {
+			mmap_read_lock(mm);
+			locked = 1;
+		}
+		get_user_pages_remote(mm, c->addr, 1, FOLL_WRITE, NULL, NULL,
+				      &locked);
+	}
 	if (locked)
 		mmap_read_unlock(mm);
 
-	if (IS_ENABLED(CONFIG_KVM_ASYNC_PF_SYNC))
+	if (IS_ENABLED(CONFIG_KVM_ASYNC_PF_SYNC)) {
 		kvm_arch_async_page_present(vcpu, apf);
+		list_for_each_entry(c, &apf->coalesced, coalesced)
+			kvm_arch_async_page_present(vcpu, c);
+	}
+
+	list_for_each_entry(c, &apf->coalesced, coalesced)
+		trace_kvm_async_pf_completed(c->addr, c->cr2_or_gpa);
 
 	spin_lock(&vcpu->async_pf.lock);
 	first = list_empty(&vcpu->async_pf.done);
 	list_add_tail(&apf->link, &vcpu->async_pf.done);
 	apf->vcpu = NULL;
+	/* the coalesced faults may be freed once the lock is dropped */
+	list_for_each_entry_safe(c, tmp, &apf->coalesced, coalesced) {
+		list_add_tail(&c->link, &vcpu->async_pf.done);
+		c->vcpu = NULL;
+	}
 	spin_unlock(&vcpu->async_pf.lock);
 
 	if (!IS_ENABLED(CONFIG_KVM_ASYNC_PF_SYNC) && first)
@@ -129,16 +164,33 @@ void kvm_clear_async_pf_completion_queue(struct kvm_vcpu *vcpu)
 		if (!work->vcpu)
 			continue;
 
+		/*
+		 * Coalesced faults are completed, or cancelled, along with
+		 * the work item they were coalesced into.
+		 */
+		if (work->leader)
+			continue;
+
 		spin_unlock(&vcpu->async_pf.lock);
 #ifdef CONFIG_KVM_ASYNC_PF_SYNC
 		flush_work(&work->work);
+		spin_lock(&vcpu->async_pf.lock);
 #else
 		if (cancel_work_sync(&work->work)) {
+			struct kvm_async_pf *c, *tmp;
+
 			mmput(work->mm);
+			spin_lock(&vcpu->async_pf.lock);
+			list_for_each_entry_safe(c, tmp, &work->coalesced,
+						 coalesced) {
+				list_del(&c->queue);
+				kmem_cache_free(async_pf_cache, c);
+			}
 			kmem_cache_free(async_pf_cache, work);
+		} else {
+			spin_lock(&vcpu->async_pf.lock);
 		}
 #endif
-		spin_lock(&vcpu->async_pf.lock);
 	}
 
 	while (!list_empty(&vcpu->async_pf.done)) {
@@ -178,6 +230,36 @@ void kvm_check_async_pf_completion(struct kvm_vcpu *vcpu)
 	}
 }
 
+/*
+ * Coalesce @work into a queued fault on the same block whose work item hasn't
+ * started yet.  Returns false if there is none and @work needs its own.
+ */
+static bool kvm_async_pf_coalesce(struct kvm_vcpu *vcpu,
+				  struct kvm_async_pf *work)
+{
+	unsigned long block = work->addr >> ASYNC_PF_COALESCE_SHIFT;
+	struct kvm_async_pf *leader;
+	bool coalesced = false;
+
+	spin_lock(&vcpu->async_pf.lock);
+	list_for_each_entry_reverse(leader, &vcpu->async_pf.queue, queue) {
+		if (leader == work || !leader->vcpu || leader->wakeup_all ||
+		    leader->leader || leader->started ||
+		    leader->nr_coalesced >= ASYNC_PF_COALESCE_MAX ||
+		    leader->addr >> ASYNC_PF_COALESCE_SHIFT != block)
+			continue;
+
+		work->leader = leader;
+		list_add_tail(&work->coalesced, &leader->coalesced);
+		leader->nr_coalesced++;
+		coalesced = true;
+		break;
+	}
+	spin_unlock(&vcpu->async_pf.lock);
+
+	return coalesced;
+}
+
 /*
  * Try to schedule a job to handle page fault asynchronously. Returns 'true' on
  * success, 'false' on failure (page fault has to be handled synchronously).
@@ -208,7 +290,7 @@ bool kvm_setup_async_pf(struct kvm_vcpu *vcpu, gpa_t cr2_or_gpa,
 	work->addr = hva;
 	work->arch = *arch;
 	work->mm = current->mm;
-	mmget(work->mm);
+	INIT_LIST_HEAD(&work->coalesced);
 
 	INIT_WORK(&work->work, async_pf_execute);
 
@@ -216,6 +298,11 @@ bool kvm_setup_async_pf(struct kvm_vcpu *vcpu, gpa_t cr2_or_gpa,
 	vcpu->async_pf.queued++;
 	work->notpresent_injected = kvm_arch_async_page_not_present(vcpu, work);
 
+	/* coalesced faults rely on the leader's reference to the mm */
+	if (kvm_async_pf_coalesce(vcpu, work))
+		return true;
+
+	mmget(work->mm);
 	schedule_work(&work->work);
 
 	return true;
@@ -235,6 +322,7 @@ int kvm_async_pf_wakeup_all(struct kvm_vcpu *vcpu)
 
 	work->wakeup_all = true;
 	INIT_LIST_HEAD(&work->queue); /* for list_del to work */
+	INIT_LIST_HEAD(&work->coalesced);
 
 	spin_lock(&vcpu->async_pf.lock);
 	first = list_empty(&vcpu->async_pf.done);
@@ -9,6 +9,8 @@
 #include <linux/kvm.h>
 #include <linux/errno.h>
 #include <linux/uaccess.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 /**
  * kvm_stats_read() - Common function to read from the binary statistics
@@ -142,3 +144,98 @@ ssize_t kvm_stats_read(char *id, const struct kvm_stats_header *header,
 	*offset = pos;
 	return len;
 }
+
+/*
+ * The mmap-able stats page holds a 64-bit generation counter at offset 0
+ * followed by a copy of the stats data block, in the same layout as the
+ * "Stats Data" part of the file (see kvm_stats_read()).
+ */
+#define KVM_STATS_PAGE_DATA_OFFSET	sizeof(u64)
+
+static size_t kvm_stats_page_size(size_t size_stats)
+{
+	return PAGE_ALIGN(KVM_STATS_PAGE_DATA_OFFSET + size_stats);
+}
+
+/**
+ * kvm_stats_publish() - Copy the live stats values into the stats page.
+ *
+ * @page: stats page allocated by kvm_stats_mmap()
+ * @stats: start address of stats data block for a vm or a vcpu
+ * @size_stats: the size of stats data block pointed by @stats
+ *
+ * The generation counter is odd while the copy is in progress.  Concurrent
+ * publishers (e.g. several vCPUs putting the VM stats) don't wait for each
+ * other: whoever fails to make the counter odd just skips the update, as the
+ * winner is copying values that are at least as recent.
+ */
+void kvm_stats_publish(void *page, const void *stats, size_t size_stats)
+{
+	u64 *seq = page;
+	u64 old;
+
+	old = READ_ONCE(*seq);
+	if ((old & 1) || cmpxchg64(seq, old, old + 1) != old)
+		return;
+
+	smp_wmb();
+	memcpy(page + KVM_STATS_PAGE_DATA_OFFSET, stats, size_stats);
+	smp_store_release(seq, old + 2);
+}
+
+/**
+ * kvm_stats_mmap() - Common function to mmap the binary statistics file
+ * descriptor.
+ *
+ * @pagep: where the stats page of the vm or vcpu is installed
+ * @stats: start address of stats data block for a vm or a vcpu
+ * @size_stats: the size of stats data block pointed by @stats
+ * @vma: the mapping being set up
+ *
+ * Map a read-only shadow of the stats data block, so that monitoring agents
+ * can sample the values without any syscall.  The page starts with a 64-bit
+ * generation counter, and the stats data follows at offset 8; the order and
+ * size of the values are given by the descriptors read from the fd.  Readers
+ * use the counter like a seqcount:
+ *
+ *	do {
+ *		seq = READ_ONCE(page->seq);	(acquire)
+ *		copy the values
+ *	} while ((seq & 1) || seq != READ_ONCE(page->seq));
+ *
+ * The page is refreshed whenever the vcpu is scheduled out or put (for vm
+ * stats, at most once per jiffy, from whichever vcpu is put first), and by
+ * a work item every 100ms while any stats page of the vm is mapped.
+ * The values therefore lag the ones returned by read() by at most about
+ * 100ms, plus however long that work item waits to run.
+ *
+ * Return: 0 on success, negative errno otherwise
+ */
+int kvm_stats_mmap(void **pagep, const void *stats, size_t size_stats,
+		   struct vm_area_struct *vma)
+{
+	size_t size = kvm_stats_page_size(size_stats);
+	void *page;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > size)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	page = READ_ONCE(*pagep);
+	if (!page) {
+		page = vmalloc_user(size);
+		if (!page)
+			return -ENOMEM;
+		if (cmpxchg(pagep, NULL, page)) {
+			vfree(page);
+			page = READ_ONCE(*pagep);
+		}
+	}
+
+	/* Don't hand out a page that is stale until the next vcpu_put() */
+	kvm_stats_publish(page, stats, size_stats);
+
+	return remap_vmalloc_range(vma, page, 0);
+}
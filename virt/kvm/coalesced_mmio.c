@@ -40,9 +40,9 @@ static int coalesced_mmio_in_range(struct kvm_coalesced_mmio_dev *dev,
 	return 1;
 }
 
-static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
+static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_ring *ring,
+				   u32 last)
 {
-	struct kvm_coalesced_mmio_ring *ring;
 	unsigned avail;
 
 	/* Are we able to batch it ? */
@@ -51,7 +51,6 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	 * check if we don't meet the first used entry
 	 * there is always one unused entry in the buffer
 	 */
-	ring = dev->kvm->coalesced_mmio_ring;
 	avail = (ring->first - last - 1) % KVM_COALESCED_MMIO_MAX;
 	if (avail == 0) {
 		/* full */
@@ -61,25 +60,20 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	return 1;
 }
 
-static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
-				struct kvm_io_device *this, gpa_t addr,
-				int len, const void *val)
+/*
+ * The caller makes sure there is a single producer for @ring: the owning vCPU
+ * for per-vCPU rings, kvm->ring_lock for the shared one.
+ */
+static bool coalesced_mmio_ring_insert(struct kvm_coalesced_mmio_ring *ring,
+				       struct kvm_coalesced_mmio_dev *dev,
+				       gpa_t addr, int len, const void *val)
 {
-	struct kvm_coalesced_mmio_dev *dev = to_mmio(this);
-	struct kvm_coalesced_mmio_ring *ring = dev->kvm->coalesced_mmio_ring;
 	__u32 insert;
 
-	if (!coalesced_mmio_in_range(dev, addr, len))
-		return -EOPNOTSUPP;
-
-	spin_lock(&dev->kvm->ring_lock);
-
 	insert = READ_ONCE(ring->last);
-	if (!coalesced_mmio_has_room(dev, insert) ||
-	    insert >= KVM_COALESCED_MMIO_MAX) {
-		spin_unlock(&dev->kvm->ring_lock);
-		return -EOPNOTSUPP;
-	}
+	if (!coalesced_mmio_has_room(ring, insert) ||
+	    insert >= KVM_COALESCED_MMIO_MAX)
+		return false;
 
 	/* copy data in first free entry of the ring */
 
@@ -89,7 +83,39 @@ static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 	ring->coalesced_mmio[insert].pio = dev->zone.pio;
 	smp_wmb();
 	ring->last = (insert + 1) % KVM_COALESCED_MMIO_MAX;
-	spin_unlock(&dev->kvm->ring_lock);
+	return true;
+}
+
+static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
+				struct kvm_io_device *this, gpa_t addr,
+				int len, const void *val)
+{
+	struct kvm_coalesced_mmio_dev *dev = to_mmio(this);
+	bool queued;
+
+	if (!coalesced_mmio_in_range(dev, addr, len))
+		return -EOPNOTSUPP;
+
+	if (vcpu && vcpu->coalesced_mmio_ring) {
+		queued = coalesced_mmio_ring_insert(vcpu->coalesced_mmio_ring,
+						    dev, addr, len, val);
+	} else {
+		spin_lock(&dev->kvm->ring_lock);
+		queued = coalesced_mmio_ring_insert(dev->kvm->coalesced_mmio_ring,
+						    dev, addr, len, val);
+		spin_unlock(&dev->kvm->ring_lock);
+	}
+
+	/*
+	 * A full ring turns the write into a regular exit; the VMM drains
+	 * the ring before handling it, which keeps the writes in order.
+	 */
+	if (!queued) {
+		if (vcpu)
+			++vcpu->stat.generic.coalesced_mmio_ring_full;
+		return -EOPNOTSUPP;
+	}
+
 	return 0;
 }
 
@@ -134,6 +160,54 @@ void kvm_coalesced_mmio_free(struct kvm *kvm)
 		free_page((unsigned long)kvm->coalesced_mmio_ring);
 }
 
+/*
+ * Give each vCPU created from now on a ring of its own, mapped from the vCPU
+ * fd at KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET.  A vCPU only ever appends to its
+ * own ring, so coalesced writes no longer serialize on kvm->ring_lock, and
+ * the VMM drains the rings in batches; a vCPU must have its ring drained
+ * before any of its exits is handled.
+ */
+int kvm_coalesced_mmio_enable_vcpu_rings(struct kvm *kvm)
+{
+	int r = 0;
+
+	if (!KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET)
+		return -EINVAL;
+
+	mutex_lock(&kvm->lock);
+
+	/* The rings are allocated along with the vCPUs */
+	if (kvm->created_vcpus)
+		r = -EINVAL;
+	else
+		kvm->coalesced_mmio_vcpu_rings = true;
+
+	mutex_unlock(&kvm->lock);
+	return r;
+}
+
+int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu)
+{
+	struct page *page;
+
+	if (!vcpu->kvm->coalesced_mmio_vcpu_rings)
+		return 0;
+
+	page = alloc_page(GFP_KERNEL_ACCOUNT | __GFP_ZERO);
+	if (!page)
+		return -ENOMEM;
+
+	vcpu->coalesced_mmio_ring = page_address(page);
+	return 0;
+}
+
+void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu)
+{
+	if (vcpu->coalesced_mmio_ring)
+		free_page((unsigned long)vcpu->coalesced_mmio_ring);
+	vcpu->coalesced_mmio_ring = NULL;
+}
+
 int kvm_vm_ioctl_register_coalesced_mmio(struct kvm *kvm,
 					 struct kvm_coalesced_mmio_zone *zone)
 {
@@ -15,6 +15,11 @@
 
 #include <linux/list.h>
 
+/* Architectures not defining it don't offer per-vCPU rings */
+#ifndef KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET
+#define KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET 0
+#endif
+
 struct kvm_coalesced_mmio_dev {
 	struct list_head list;
 	struct kvm_io_device dev;
@@ -28,11 +33,16 @@ int kvm_vm_ioctl_register_coalesced_mmio(struct kvm *kvm,
 					struct kvm_coalesced_mmio_zone *zone);
 int kvm_vm_ioctl_unregister_coalesced_mmio(struct kvm *kvm,
 					struct kvm_coalesced_mmio_zone *zone);
+int kvm_coalesced_mmio_enable_vcpu_rings(struct kvm *kvm);
+int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu);
+void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu);
 
 #else
 
 static inline int kvm_coalesced_mmio_init(struct kvm *kvm) { return 0; }
 static inline void kvm_coalesced_mmio_free(struct kvm *kvm) { }
+static inline int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu) { return 0; }
+static inline void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu) { }
 
 #endif
 
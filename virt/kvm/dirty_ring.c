@@ -36,25 +36,138 @@ static bool kvm_dirty_ring_full(struct kvm_dirty_ring *ring)
 	return kvm_dirty_ring_used(ring) >= ring->size;
 }
 
-static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+/*
+ * Write protect @npages pages from @gfn_offset in @slot.  Architectures
+ * which can write protect a whole range in one page table walk, huge pages
+ * included, override this; the default goes BITS_PER_LONG pages at a time.
+ */
+void __weak kvm_arch_mmu_enable_log_dirty_pt_range(struct kvm *kvm,
+						   struct kvm_memory_slot *slot,
+						   gfn_t gfn_offset, u64 npages)
+{
+	while (npages) {
+		u64 n = min_t(u64, npages, BITS_PER_LONG);
+		unsigned long mask = n == BITS_PER_LONG ? ~0UL : (1UL << n) - 1;
+
+		kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, slot, gfn_offset,
+							mask);
+		gfn_offset += n;
+		npages -= n;
+	}
+}
+
+static struct kvm_memory_slot *kvm_dirty_ring_memslot(struct kvm *kvm,
+						      u32 slot)
 {
-	struct kvm_memory_slot *memslot;
 	int as_id, id;
 
 	as_id = slot >> 16;
 	id = (u16)slot;
 
 	if (as_id >= KVM_ADDRESS_SPACE_NUM || id >= KVM_USER_MEM_SLOTS)
-		return;
+		return NULL;
+
+	return id_to_memslot(__kvm_memslots(kvm, as_id), id);
+}
 
-	memslot = id_to_memslot(__kvm_memslots(kvm, as_id), id);
+/* Called with the MMU lock held */
+static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+{
+	struct kvm_memory_slot *memslot = kvm_dirty_ring_memslot(kvm, slot);
 
 	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
 		return;
 
-	KVM_MMU_LOCK(kvm);
 	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
+}
+
+/* Called with the MMU lock held */
+static void kvm_reset_dirty_range(struct kvm *kvm, u32 slot, u64 offset,
+				  u64 npages)
+{
+	struct kvm_memory_slot *memslot = kvm_dirty_ring_memslot(kvm, slot);
+
+	if (!memslot || offset + npages > memslot->npages)
+		return;
+
+	kvm_arch_mmu_enable_log_dirty_pt_range(kvm, memslot, offset, npages);
+}
+
+/* Drop the MMU lock every so many write protect calls of a reset. */
+#define KVM_DIRTY_RING_RESET_BATCH	64
+
+/**
+ * struct kvm_dirty_ring_reset - state of kvm_dirty_ring_reset()
+ *
+ * @slot:	slot of the pending run
+ * @offset:	first page of the pending run
+ * @npages:	length of the pending run, 0 if there is none
+ * @calls:	write protect calls issued, for the per-vCPU stats
+ * @batch:	write protect calls issued since the MMU lock was taken
+ *
+ * Harvested pages are first coalesced into BITS_PER_LONG wide masks.  Masks
+ * without holes which continue the pending run are folded into it, so that
+ * a linear scan of guest memory ends up as a single range to write protect.
+ */
+struct kvm_dirty_ring_reset {
+	u32 slot;
+	u64 offset;
+	u64 npages;
+	u64 calls;
+	unsigned int batch;
+};
+
+static void kvm_dirty_ring_reset_relax(struct kvm *kvm,
+				       struct kvm_dirty_ring_reset *rs)
+{
+	rs->calls++;
+	if (++rs->batch < KVM_DIRTY_RING_RESET_BATCH && !need_resched())
+		return;
+
 	KVM_MMU_UNLOCK(kvm);
+	cond_resched();
+	KVM_MMU_LOCK(kvm);
+	rs->batch = 0;
+}
+
+static void kvm_dirty_ring_reset_run(struct kvm *kvm,
+				     struct kvm_dirty_ring_reset *rs)
+{
+	if (!rs->npages)
+		return;
+
+	kvm_reset_dirty_range(kvm, rs->slot, rs->offset, rs->npages);
+	rs->npages = 0;
+	kvm_dirty_ring_reset_relax(kvm, rs);
+}
+
+static void kvm_dirty_ring_reset_mask(struct kvm *kvm,
+				      struct kvm_dirty_ring_reset *rs,
+				      u32 slot, u64 offset, unsigned long mask)
+{
+	/* bit 0 is always set, so this means no holes */
+	bool dense = !(mask & (mask + 1));
+
+	if (!mask)
+		return;
+
+	if (dense && rs->npages && rs->slot == slot &&
+	    rs->offset + rs->npages == offset) {
+		rs->npages += __fls(mask) + 1;
+		return;
+	}
+
+	kvm_dirty_ring_reset_run(kvm, rs);
+
+	if (dense) {
+		rs->slot = slot;
+		rs->offset = offset;
+		rs->npages = __fls(mask) + 1;
+		return;
+	}
+
+	kvm_reset_dirty_gfn(kvm, slot, offset, mask);
+	kvm_dirty_ring_reset_relax(kvm, rs);
 }
 
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
@@ -89,6 +202,8 @@ static inline bool kvm_dirty_gfn_harvested(struct kvm_dirty_gfn *gfn)
 
 int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 {
+	struct kvm_vcpu *vcpu = container_of(ring, struct kvm_vcpu, dirty_ring);
+	struct kvm_dirty_ring_reset rs = {};
 	u32 cur_slot, next_slot;
 	u64 cur_offset, next_offset;
 	unsigned long mask;
@@ -99,6 +214,8 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 	/* This is only needed to make compilers happy */
 	cur_slot = cur_offset = mask = 0;
 
+	KVM_MMU_LOCK(kvm);
+
 	while (true) {
 		entry = &ring->dirty_gfns[ring->reset_index & (ring->size - 1)];
 
@@ -133,14 +250,20 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 				continue;
 			}
 		}
-		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+		kvm_dirty_ring_reset_mask(kvm, &rs, cur_slot, cur_offset, mask);
 		cur_slot = next_slot;
 		cur_offset = next_offset;
 		mask = 1;
 		first_round = false;
 	}
 
-	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+	kvm_dirty_ring_reset_mask(kvm, &rs, cur_slot, cur_offset, mask);
+	kvm_dirty_ring_reset_run(kvm, &rs);
+
+	KVM_MMU_UNLOCK(kvm);
+
+	vcpu->stat.generic.dirty_ring_reset_entries += count;
+	vcpu->stat.generic.dirty_ring_reset_ranges += rs.calls;
 
 	trace_kvm_dirty_ring_reset(ring);
 
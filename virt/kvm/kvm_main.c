@@ -228,10 +228,92 @@ void vcpu_load(struct kvm_vcpu *vcpu)
 }
 EXPORT_SYMBOL_GPL(vcpu_load);
 
+/*
+ * A vCPU that keeps running in guest mode is never put, so its stats page
+ * is also refreshed from a work item at least this often.
+ */
+#define KVM_STATS_PAGE_PERIOD	(HZ / 10)
+
+static void kvm_stats_page_work(struct work_struct *work)
+{
+	struct kvm *kvm = container_of(to_delayed_work(work), struct kvm,
+				       stats_page_work);
+	struct kvm_vcpu *vcpu;
+	unsigned long i;
+	void *page;
+
+	page = READ_ONCE(kvm->stats_page);
+	if (page)
+		kvm_stats_publish(page, &kvm->stat, sizeof(kvm->stat));
+
+	kvm_for_each_vcpu(i, vcpu, kvm) {
+		page = READ_ONCE(vcpu->stats_page);
+		if (page)
+			kvm_stats_publish(page, &vcpu->stat,
+					  sizeof(vcpu->stat));
+	}
+
+	if (atomic_read(&kvm->stats_page_maps))
+		schedule_delayed_work(&kvm->stats_page_work,
+				      KVM_STATS_PAGE_PERIOD);
+}
+
+/*
+ * Count the mappings of the VM and vCPU stats pages, so that the work item
+ * stops rearming itself once the last one goes away.  The mapping holds the
+ * stats file, and with it a reference to the VM.
+ */
+static void kvm_stats_vma_open(struct vm_area_struct *vma)
+{
+	struct kvm *kvm = vma->vm_private_data;
+
+	atomic_inc(&kvm->stats_page_maps);
+}
+
+static void kvm_stats_vma_close(struct vm_area_struct *vma)
+{
+	struct kvm *kvm = vma->vm_private_data;
+
+	atomic_dec(&kvm->stats_page_maps);
+}
+
+static const struct vm_operations_struct kvm_stats_vm_ops = {
+	.open = kvm_stats_vma_open,
+	.close = kvm_stats_vma_close,
+};
+
+static void kvm_stats_page_mapped(struct kvm *kvm, struct vm_area_struct *vma)
+{
+	vma->vm_ops = &kvm_stats_vm_ops;
+	vma->vm_private_data = kvm;
+	kvm_stats_vma_open(vma);
+
+	schedule_delayed_work(&kvm->stats_page_work, KVM_STATS_PAGE_PERIOD);
+}
+
+/* Refresh the mmap-able stats pages, if userspace has mapped any. */
+static void kvm_vcpu_stats_publish(struct kvm_vcpu *vcpu)
+{
+	struct kvm *kvm = vcpu->kvm;
+	unsigned long now = jiffies;
+	void *page;
+
+	page = READ_ONCE(vcpu->stats_page);
+	if (page)
+		kvm_stats_publish(page, &vcpu->stat, sizeof(vcpu->stat));
+
+	page = READ_ONCE(kvm->stats_page);
+	if (page && READ_ONCE(kvm->stats_page_stamp) != now) {
+		WRITE_ONCE(kvm->stats_page_stamp, now);
+		kvm_stats_publish(page, &kvm->stat, sizeof(kvm->stat));
+	}
+}
+
 void vcpu_put(struct kvm_vcpu *vcpu)
 {
 	preempt_disable();
 	kvm_arch_vcpu_put(vcpu);
+	kvm_vcpu_stats_publish(vcpu);
 	preempt_notifier_unregister(&vcpu->preempt_notifier);
 	__this_cpu_write(kvm_running_vcpu, NULL);
 	preempt_enable();
@@ -494,6 +576,8 @@ static void kvm_vcpu_destroy(struct kvm_vcpu *vcpu)
 {
 	kvm_arch_vcpu_destroy(vcpu);
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
+	vfree(vcpu->stats_page);
 
 	/*
 	 * No need for rcu_read_lock as VCPU_RUN is the only place that changes
@@ -1158,6 +1242,7 @@ static struct kvm *kvm_create_vm(unsigned long type, const char *fdname)
 	__module_get(kvm_chardev_ops.owner);
 
 	KVM_MMU_LOCK_INIT(kvm);
+	INIT_DELAYED_WORK(&kvm->stats_page_work, kvm_stats_page_work);
 	mmgrab(current->mm);
 	kvm->mm = current->mm;
 	kvm_eventfd_init(kvm);
@@ -1303,6 +1388,7 @@ static void kvm_destroy_vm(struct kvm *kvm)
 	kvm_destroy_pm_notifier(kvm);
 	kvm_uevent_notify_change(KVM_EVENT_DESTROY_VM, kvm);
 	kvm_destroy_vm_debugfs(kvm);
+	cancel_delayed_work_sync(&kvm->stats_page_work);
 	kvm_arch_sync_events(kvm);
 	mutex_lock(&kvm_lock);
 	list_del(&kvm->vm_list);
@@ -1341,6 +1427,7 @@ static void kvm_destroy_vm(struct kvm *kvm)
 	}
 	cleanup_srcu_struct(&kvm->irq_srcu);
 	cleanup_srcu_struct(&kvm->srcu);
+	vfree(kvm->stats_page);
 	kvm_arch_free_vm(kvm);
 	preempt_notifier_dec();
 	hardware_disable_all();
@@ -3819,6 +3906,10 @@ static vm_fault_t kvm_vcpu_fault(struct vm_fault *vmf)
 #ifdef CONFIG_KVM_MMIO
 	else if (vmf->pgoff == KVM_COALESCED_MMIO_PAGE_OFFSET)
 		page = virt_to_page(vcpu->kvm->coalesced_mmio_ring);
+	else if (KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET &&
+		 vmf->pgoff == KVM_COALESCED_MMIO_VCPU_PAGE_OFFSET &&
+		 vcpu->coalesced_mmio_ring)
+		page = virt_to_page(vcpu->coalesced_mmio_ring);
 #endif
 	else if (kvm_page_in_dirty_ring(vcpu->kvm, vmf->pgoff))
 		page = kvm_dirty_ring_get_page(
@@ -3958,6 +4049,10 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 			goto arch_vcpu_destroy;
 	}
 
+	r = kvm_coalesced_mmio_vcpu_init(vcpu);
+	if (r)
+		goto dirty_ring_free;
+
 	mutex_lock(&kvm->lock);
 	if (kvm_get_vcpu_by_id(kvm, id)) {
 		r = -EEXIST;
@@ -3997,6 +4092,8 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 	xa_release(&kvm->vcpu_array, vcpu->vcpu_idx);
 unlock_vcpu_destroy:
 	mutex_unlock(&kvm->lock);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
+dirty_ring_free:
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
 arch_vcpu_destroy:
 	kvm_arch_vcpu_destroy(vcpu);
@@ -4032,6 +4129,18 @@ static ssize_t kvm_vcpu_stats_read(struct file *file, char __user *user_buffer,
 			sizeof(vcpu->stat), user_buffer, size, offset);
 }
 
+static int kvm_vcpu_stats_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct kvm_vcpu *vcpu = file->private_data;
+	int r;
+
+	r = kvm_stats_mmap(&vcpu->stats_page, &vcpu->stat,
+			   sizeof(vcpu->stat), vma);
+	if (!r)
+		kvm_stats_page_mapped(vcpu->kvm, vma);
+	return r;
+}
+
 static int kvm_vcpu_stats_release(struct inode *inode, struct file *file)
 {
 	struct kvm_vcpu *vcpu = file->private_data;
@@ -4042,6 +4151,7 @@ static int kvm_vcpu_stats_release(struct inode *inode, struct file *file)
 
 static const struct file_operations kvm_vcpu_stats_fops = {
 	.read = kvm_vcpu_stats_read,
+	.mmap = kvm_vcpu_stats_mmap,
 	.release = kvm_vcpu_stats_release,
 	.llseek = noop_llseek,
 };
@@ -4655,6 +4765,14 @@ static int kvm_vm_ioctl_enable_cap_generic(struct kvm *kvm,
 			return -EINVAL;
 
 		return kvm_vm_ioctl_enable_dirty_log_ring(kvm, cap->args[0]);
+#ifdef CONFIG_KVM_MMIO
+	case KVM_CAP_COALESCED_MMIO:
+		/* args[0] == 1 switches the vCPUs to rings of their own */
+		if (cap->flags || cap->args[0] != 1)
+			return -EINVAL;
+
+		return kvm_coalesced_mmio_enable_vcpu_rings(kvm);
+#endif
 	default:
 		return kvm_vm_ioctl_enable_cap(kvm, cap);
 	}
@@ -4670,6 +4788,18 @@ static ssize_t kvm_vm_stats_read(struct file *file, char __user *user_buffer,
 				sizeof(kvm->stat), user_buffer, size, offset);
 }
 
+static int kvm_vm_stats_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct kvm *kvm = file->private_data;
+	int r;
+
+	r = kvm_stats_mmap(&kvm->stats_page, &kvm->stat,
+			   sizeof(kvm->stat), vma);
+	if (!r)
+		kvm_stats_page_mapped(kvm, vma);
+	return r;
+}
+
 static int kvm_vm_stats_release(struct inode *inode, struct file *file)
 {
 	struct kvm *kvm = file->private_data;
@@ -4680,6 +4810,7 @@ static int kvm_vm_stats_release(struct inode *inode, struct file *file)
 
 static const struct file_operations kvm_vm_stats_fops = {
 	.read = kvm_vm_stats_read,
+	.mmap = kvm_vm_stats_mmap,
 	.release = kvm_vm_stats_release,
 	.llseek = noop_llseek,
 };
@@ -5819,6 +5950,7 @@ static void kvm_sched_out(struct preempt_notifier *pn,
 		WRITE_ONCE(vcpu->ready, true);
 	}
 	kvm_arch_vcpu_put(vcpu);
+	kvm_vcpu_stats_publish(vcpu);
 	__this_cpu_write(kvm_running_vcpu, NULL);
 }
 